@@ -0,0 +1,142 @@
+// Benchmark harness shared by bench_runtime and the transpiled-module benchmarks
+//
+// Each case runs `warmup` untimed iterations, then `reps` timed ones; the
+// report gives min / mean / p50 / p90 / p99 per case in nanoseconds, as a
+// table on stderr and optionally as JSON (one object per run) so results
+// from two runtime versions can be diffed with scripts/compare_bench.py.
+//
+// Options: --reps N  --warmup N  --filter SUBSTR  --json FILE ("-" = stdout)
+// Arguments after `--` are left for the program (the Lua `arg` table).
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace l2c_bench {
+
+// Keep a computed value alive without emitting code for it
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Options {
+    int reps = 20;
+    int warmup = 3;
+    std::string filter;
+    std::string json;
+    std::vector<char*> rest;  // argv[0] followed by the arguments after `--`
+};
+
+inline Options parse_options(int argc, char* argv[]) {
+    Options opt;
+    opt.rest.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        auto value = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s: missing value for %s\n", argv[0], flag);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--reps")) opt.reps = std::max(1, std::atoi(value("--reps")));
+        else if (!std::strcmp(argv[i], "--warmup")) opt.warmup = std::max(0, std::atoi(value("--warmup")));
+        else if (!std::strcmp(argv[i], "--filter")) opt.filter = value("--filter");
+        else if (!std::strcmp(argv[i], "--json")) opt.json = value("--json");
+        else if (!std::strcmp(argv[i], "--")) {
+            opt.rest.insert(opt.rest.end(), argv + i + 1, argv + argc);
+            break;
+        } else {
+            std::fprintf(stderr, "%s: unknown option %s\n", argv[0], argv[i]);
+            std::exit(2);
+        }
+    }
+    return opt;
+}
+
+struct Result {
+    std::string name;
+    uint64_t ops;                  // operations per timed iteration
+    std::vector<double> samples;   // ns per iteration, sorted
+};
+
+inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    double rank = p / 100.0 * (double)(sorted.size() - 1);
+    size_t lo = (size_t)rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - (double)lo);
+}
+
+inline double mean(const std::vector<double>& v) {
+    double sum = 0;
+    for (double x : v) sum += x;
+    return v.empty() ? 0 : sum / (double)v.size();
+}
+
+class Runner {
+public:
+    explicit Runner(Options opt) : opt_(std::move(opt)) {}
+
+    const Options& options() const { return opt_; }
+
+    // Time fn() `reps` times; ops is the number of primitive operations one
+    // call performs, used to report ns/op
+    template<typename Fn>
+    void run(const char* name, uint64_t ops, Fn&& fn) {
+        if (!opt_.filter.empty() && !std::strstr(name, opt_.filter.c_str())) return;
+        for (int i = 0; i < opt_.warmup; i++) fn();
+        Result r{name, ops ? ops : 1, {}};
+        r.samples.reserve(opt_.reps);
+        for (int i = 0; i < opt_.reps; i++) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            r.samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+        std::sort(r.samples.begin(), r.samples.end());
+        results_.push_back(std::move(r));
+    }
+
+    // Print the table and write JSON; returns the process exit code
+    int report(const char* suite) const {
+        std::fprintf(stderr, "%-28s %12s %12s %12s %12s %10s\n",
+                     "benchmark", "min(ns)", "p50(ns)", "p90(ns)", "p99(ns)", "ns/op");
+        for (const Result& r : results_) {
+            std::fprintf(stderr, "%-28s %12.0f %12.0f %12.0f %12.0f %10.2f\n",
+                         r.name.c_str(), r.samples.front(), percentile(r.samples, 50),
+                         percentile(r.samples, 90), percentile(r.samples, 99),
+                         percentile(r.samples, 50) / (double)r.ops);
+        }
+        if (opt_.json.empty()) return 0;
+        FILE* out = opt_.json == "-" ? stdout : std::fopen(opt_.json.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", opt_.json.c_str());
+            return 1;
+        }
+        std::fprintf(out, "{\"suite\": \"%s\", \"reps\": %d, \"warmup\": %d, \"benchmarks\": [", suite, opt_.reps, opt_.warmup);
+        for (size_t i = 0; i < results_.size(); i++) {
+            const Result& r = results_[i];
+            std::fprintf(out, "%s\n  {\"name\": \"%s\", \"ops\": %llu, \"min_ns\": %.1f, \"mean_ns\": %.1f, "
+                              "\"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f}",
+                         i ? "," : "", r.name.c_str(), (unsigned long long)r.ops, r.samples.front(),
+                         mean(r.samples), percentile(r.samples, 50), percentile(r.samples, 90),
+                         percentile(r.samples, 99), r.samples.back());
+        }
+        std::fprintf(out, "\n]}\n");
+        if (out != stdout) std::fclose(out);
+        return 0;
+    }
+
+private:
+    Options opt_;
+    std::vector<Result> results_;
+};
+
+}  // namespace l2c_bench
@@ -0,0 +1,150 @@
+// Micro-benchmarks of the lua_table runtime primitives
+//
+//   bench_runtime [--reps N] [--warmup N] [--filter SUBSTR] [--json FILE]
+//
+// Every case reports ns per timed iteration and per primitive operation;
+// see bench_harness.hpp for the JSON format.
+#include "l2c_runtime_lua_table.hpp"
+#include "bench_harness.hpp"
+
+#include <string>
+#include <vector>
+
+using l2c_bench::do_not_optimize;
+
+namespace {
+
+constexpr int32_t N = 100000;    // elements per table in the access cases
+constexpr int32_t KEYS = 4096;   // distinct string keys
+
+// Integer keys that never land in the array part
+inline int32_t scattered(int32_t i) { return i * 7919 + 1000003; }
+
+TValue make_array(int32_t n) {
+    TValue t = TValue::Table(LuaTable::create(n, 0));
+    for (int32_t i = 1; i <= n; i++) t.toTable()->rawset(TValue::Integer(i), TValue::Number(i));
+    return t;
+}
+
+TValue make_hash(int32_t n) {
+    TValue t = TValue::Table(LuaTable::create(0, n));
+    for (int32_t i = 1; i <= n; i++) t.toTable()->rawset(TValue::Integer(scattered(i)), TValue::Number(i));
+    return t;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    l2c_bench::Runner bench(l2c_bench::parse_options(argc, argv));
+
+    TValue arr = make_array(N);
+    TValue hash = make_hash(N);
+
+    std::vector<TValue> interned, plain;
+    std::vector<std::string> names;
+    for (int32_t i = 0; i < KEYS; i++) names.push_back("key_" + std::to_string(i));
+    for (const std::string& s : names) {
+        interned.push_back(l2c::intern(s.c_str()));
+        plain.push_back(TValue::String(s.c_str()));
+    }
+    TValue strtab = TValue::Table(LuaTable::create(0, KEYS));
+    for (int32_t i = 0; i < KEYS; i++) strtab.toTable()->rawset(interned[i], TValue::Number(i));
+
+    bench.run("array_rawset", N, [&] {
+        LuaTable* t = arr.toTable();
+        for (int32_t i = 1; i <= N; i++) t->rawset(TValue::Integer(i), TValue::Number(i));
+    });
+    bench.run("array_rawget", N, [&] {
+        LuaTable* t = arr.toTable();
+        double sum = 0;
+        for (int32_t i = 1; i <= N; i++) sum += t->rawget(TValue::Integer(i)).toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("hash_rawset", N, [&] {
+        LuaTable* t = hash.toTable();
+        for (int32_t i = 1; i <= N; i++) t->rawset(TValue::Integer(scattered(i)), TValue::Number(i));
+    });
+    bench.run("hash_rawget", N, [&] {
+        LuaTable* t = hash.toTable();
+        double sum = 0;
+        for (int32_t i = 1; i <= N; i++) sum += t->rawget(TValue::Integer(scattered(i))).toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("string_key_interned", KEYS, [&] {
+        LuaTable* t = strtab.toTable();
+        double sum = 0;
+        for (const TValue& k : interned) sum += t->rawget(k).toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("string_key_plain", KEYS, [&] {
+        LuaTable* t = strtab.toTable();
+        double sum = 0;
+        for (const TValue& k : plain) sum += t->rawget(k).toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("next_array_hash", 2 * N, [&] {
+        double sum = 0;
+        for (LuaTable* t : {arr.toTable(), hash.toTable()}) {
+            TValue k, v;
+            while (t->next(k, v)) sum += v.toNumber();
+        }
+        do_not_optimize(sum);
+    });
+    bench.run("pairs_iter_array_hash", 2 * N, [&] {
+        double sum = 0;
+        for (l2c::PairsIter it(arr); it.next(); ) sum += it.val.toNumber();
+        for (l2c::PairsIter it(hash); it.next(); ) sum += it.val.toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("grow_array_append", N, [&] {
+        TValue t = TValue::Table(LuaTable::create(0, 0));
+        for (int32_t i = 1; i <= N; i++) t.toTable()->rawset(TValue::Integer(i), TValue::Boolean(true));
+        do_not_optimize(t);
+    });
+    bench.run("grow_array_reverse", N, [&] {
+        // Fill t[N] down to t[1], then read it in order
+        TValue t = TValue::Table(LuaTable::create(0, 0));
+        for (int32_t i = N; i >= 1; i--) t.toTable()->rawset(TValue::Integer(i), TValue::Number(i));
+        double sum = 0;
+        for (int32_t i = 1; i <= N; i++) sum += t.toTable()->rawget(TValue::Integer(i)).toNumber();
+        do_not_optimize(sum);
+    });
+    bench.run("grow_hash_rehash", N, [&] {
+        TValue t = TValue::Table(LuaTable::create(0, 0));
+        for (int32_t i = 1; i <= N; i++) t.toTable()->rawset(TValue::Integer(scattered(i)), TValue::Boolean(true));
+        do_not_optimize(t);
+    });
+    bench.run("churn_set_clear", N, [&] {
+        LuaTable* t = strtab.toTable();
+        for (int32_t i = 0; i < N; i++) {
+            const TValue& k = interned[i % KEYS];
+            t->rawset(k, TValue::Nil());
+            t->rawset(k, TValue::Number(i));
+        }
+    });
+
+    // Operand tables with a metatable holding __add, and plain ones without
+    TValue mt = TValue::Table(LuaTable::create(0, 4));
+    mt.toTable()->rawset(l2c::intern("__add"), TValue::Boolean(true));
+    TValue withMt = TValue::Table(LuaTable::create(0, 0));
+    withMt.toTable()->metatable = mt.toTable();
+    TValue withoutMt = TValue::Table(LuaTable::create(0, 0));
+    bench.run("get_metamethod_hit", N, [&] {
+        int hits = 0;
+        for (int32_t i = 0; i < N; i++) hits += get_metamethod(withMt, TValue::Number(i), TM_ADD).has_value();
+        do_not_optimize(hits);
+    });
+    bench.run("get_metamethod_miss", N, [&] {
+        int hits = 0;
+        for (int32_t i = 0; i < N; i++) hits += get_metamethod(withoutMt, TValue::Number(i), TM_ADD).has_value();
+        do_not_optimize(hits);
+    });
+
+    bench.run("concat_str_num_str", KEYS, [&] {
+        size_t len = 0;
+        for (int32_t i = 0; i < KEYS; i++) len += std::strlen(l2c::concat(names[i].c_str(), (double)i, "_x"));
+        do_not_optimize(len);
+    });
+
+    return bench.report("runtime");
+}
@@ -0,0 +1,140 @@
+"""Array loop analyzer for Lua2C++ transpiler
+
+Finds the numeric for-loops whose `t[i + k]` accesses can go straight to
+the tables' array parts, such as `for i = 1, n do t[i] = t[i] .. s end`:
+once a guard before the loop has seen that each table's array part
+holds the whole range, no access inside needs the proxy, key
+normalization, bounds check or hash fallback.
+"""
+
+from dataclasses import dataclass
+from typing import Any, Dict, List, Set, Tuple
+from ..core.types import ASTAnnotationStore
+from .parallel_analyzer import _children, _is_dot, _stmts
+from .vector_analyzer import index_offset
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.Method, astnodes.AnonymousFunction)
+_CALLS = (astnodes.Call, astnodes.Invoke)
+
+
+@dataclass
+class ArraySpan:
+    """One table a loop indexes at t[i + k]
+
+    table: a Name of the table, to generate its value from
+    first, last: the smallest and largest k
+    """
+    table: Any
+    first: int
+    last: int
+
+
+class ArrayLoopAnalyzer:
+    """Marks the numeric for-loops that can index array parts directly
+
+    A loop qualifies when its body calls nothing, defines no function,
+    has no goto or label (the body is generated twice) and never rebinds
+    the loop variable; its slots are the accesses t[i + k] of locals t
+    from outside the loop that it doesn't rebind either. Every store in
+    the body must be to a slot, so nothing can resize a table's array
+    part: l2c::array_span then checks once, before the loop, that the
+    part covers each table's range, and the loop runs as usual where it
+    doesn't. Operators count as calling nothing, metamethods
+    notwithstanding. Parallel and vector loops keep their own kernels.
+
+    Annotations:
+        Fornum: 'array_loop' -> {table name: ArraySpan}, in first-use order
+        Index: 'array_slot' -> (loop variable, k)
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the loops whose slots can index array parts
+
+        Returns:
+            How many loops were marked
+        """
+        self._loops = 0
+        self._block(chunk.body, set())
+        return self._loops
+
+    def _block(self, block: Any, scope: Set[str]) -> None:
+        scope = set(scope)
+        for stmt in _stmts(block):
+            if isinstance(stmt, astnodes.LocalFunction):
+                scope.add(stmt.name.id)
+            if isinstance(stmt, astnodes.Fornum):
+                self._mark(stmt, scope)
+            self._nested(stmt, scope)
+            if isinstance(stmt, astnodes.LocalAssign):
+                scope.update(t.id for t in stmt.targets)
+
+    def _nested(self, node: Any, scope: Set[str]) -> None:
+        """The blocks of a statement, and of the functions in its expressions"""
+        bound: Set[str] = set()
+        if isinstance(node, _FUNCTIONS):
+            bound = {a.id for a in node.args if isinstance(a, astnodes.Name)}
+            if isinstance(node, astnodes.Method):
+                bound.add("self")
+        elif isinstance(node, astnodes.Fornum):
+            bound = {node.target.id}
+        elif isinstance(node, astnodes.Forin):
+            bound = {t.id for t in node.targets}
+        for child in _children(node):
+            if isinstance(child, astnodes.Block):
+                self._block(child, scope | bound)
+            else:
+                self._nested(child, scope)
+
+    def _mark(self, loop: astnodes.Fornum, scope: Set[str]) -> None:
+        if ASTAnnotationStore.get_annotation(loop, 'parallel_loop') \
+                or ASTAnnotationStore.get_annotation(loop, 'vector_loop'):
+            return
+        var = loop.target.id
+        nodes = self._walk(loop.body)
+        bound: Set[str] = set()
+        for node in nodes:
+            if isinstance(node, _CALLS + _FUNCTIONS + (astnodes.Goto, astnodes.Label)):
+                return
+            if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                bound.update(t.id for t in node.targets if isinstance(t, astnodes.Name))
+            elif isinstance(node, astnodes.Fornum):
+                bound.add(node.target.id)
+            elif isinstance(node, astnodes.Forin):
+                bound.update(t.id for t in node.targets)
+        if var in bound:
+            return
+
+        spans: Dict[str, ArraySpan] = {}
+        slots: List[Tuple[Any, int]] = []
+        for node in nodes:
+            if not isinstance(node, astnodes.Index) or _is_dot(node) or not isinstance(node.value, astnodes.Name):
+                continue
+            name = node.value.id
+            k = index_offset(node.idx, var)
+            if k is None or name not in scope or name in bound:
+                continue
+            span = spans.setdefault(name, ArraySpan(node.value, k, k))
+            span.first, span.last = min(span.first, k), max(span.last, k)
+            slots.append((node, k))
+        stored = [t for node in nodes if isinstance(node, astnodes.Assign)
+                  for t in node.targets if isinstance(t, astnodes.Index)]
+        if not spans or any(all(t is not slot for slot, _ in slots) for t in stored):
+            return
+        for slot, k in slots:
+            ASTAnnotationStore.set_annotation(slot, 'array_slot', (var, k))
+        ASTAnnotationStore.set_annotation(loop, 'array_loop', spans)
+        self._loops += 1
+
+    def _walk(self, node: Any) -> List[Any]:
+        """node's descendants, each before its own"""
+        found = []
+        for child in _children(node):
+            found.append(child)
+            found.extend(self._walk(child))
+        return found
@@ -0,0 +1,274 @@
+"""Closure analyzer for Lua2C++ transpiler
+
+Works out which locals each anonymous function captures and how, so the
+lua_table runtime can give every lambda an exact capture list instead of
+[&]: a local nobody assigns once it is declared is copied into the
+closure, and a local that is also assigned lives in a shared l2c::Upvalue
+cell (lua_table.hpp), which keeps the sharing Lua gives upvalues after
+the declaring function returns.
+"""
+
+from typing import Any, Dict, List, Optional, Set, Tuple
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+# How a closure captures a local
+VALUE = "value"     # copied into the lambda
+BOX = "box"         # the l2c::Upvalue handle is copied
+REF = "ref"         # by reference, for assigned locals that can't be boxed
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+def _is_dot(node: Any) -> bool:
+    return str(getattr(node, 'notation', '')) == "IndexNotation.DOT"
+
+
+class _Local:
+    """One binding of a local, with the Name nodes resolved to it"""
+
+    def __init__(self, name: str, owner: Any, decl: Optional[Any] = None,
+                 capturable: bool = True) -> None:
+        self.name = name
+        self.owner = owner              # the function (or chunk) declaring it
+        self.decl = decl                # LocalAssign, when it can be boxed
+        self.capturable = capturable    # False for module state and local functions
+        self.assigned = False
+        self.names: List[Any] = []
+
+
+class ClosureAnalyzer:
+    """Computes the capture list of every anonymous function
+
+    Names are scope-resolved: parameters, `local` declarations, loop
+    variables and local functions bind for the rest of their block. A free
+    local of a closure is captured by every anonymous function between its
+    use and its declaration. Chunk-level locals that live in module state,
+    and local functions, are not captured: the lambda names them directly.
+
+    A captured local assigned anywhere after its declaration is boxed when
+    it is declared alone (`local x = e` or `local x`); one declared any
+    other way (parameter, loop variable, multiple declaration) is captured
+    by reference, as before.
+
+    Annotations:
+        AnonymousFunction: 'captures' -> [(name, VALUE | BOX | REF)], in first-use order
+        AnonymousFunction: 'mutable_captures' -> True when it stores into a
+            table it holds by value (t[k] = v would pick the const operator[])
+            or calls a local it holds by value (a lambda may be mutable)
+        LocalAssign: 'upvalue_box' -> True for a boxed declaration
+        Name: 'upvalue' -> True for every use of a boxed local
+    """
+
+    def __init__(self, module_state: Optional[Set[str]] = None) -> None:
+        self._module_state = module_state or set()
+        self._scopes: List[Dict[str, _Local]] = []
+        self._functions: List[Any] = []
+        self._captures: Dict[int, Tuple[Any, Dict[str, _Local]]] = {}
+        self._stores: Dict[int, Set[int]] = {}
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate every anonymous function of the chunk
+
+        Returns:
+            Number of locals boxed
+        """
+        self._functions = [chunk]
+        self._scopes = [{}]
+        body = chunk.body.body if isinstance(chunk.body, astnodes.Block) else chunk.body
+        self._statements(body)
+
+        boxed: Set[int] = set()
+        for node, captured in self._captures.values():
+            captures = []
+            mutable = False
+            for name, local in captured.items():
+                if not local.assigned:
+                    mode = VALUE
+                    mutable = mutable or id(local) in self._stores.get(id(node), set())
+                elif local.decl is not None:
+                    mode = BOX
+                    if id(local) not in boxed:
+                        boxed.add(id(local))
+                        ASTAnnotationStore.set_annotation(local.decl, 'upvalue_box', True)
+                        for name_node in local.names:
+                            ASTAnnotationStore.set_annotation(name_node, 'upvalue', True)
+                else:
+                    mode = REF
+                captures.append((name, mode))
+            ASTAnnotationStore.set_annotation(node, 'captures', captures)
+            if mutable:
+                ASTAnnotationStore.set_annotation(node, 'mutable_captures', True)
+        return len(boxed)
+
+    # Scopes
+
+    def _declare(self, name_node: Any, decl: Optional[Any] = None, capturable: bool = True) -> None:
+        local = _Local(name_node.id, self._functions[-1], decl, capturable)
+        local.names.append(name_node)
+        self._scopes[-1][name_node.id] = local
+
+    def _resolve(self, name: str) -> Optional[_Local]:
+        for scope in reversed(self._scopes):
+            if name in scope:
+                return scope[name]
+        return None
+
+    def _use(self, node: astnodes.Name) -> Optional[_Local]:
+        local = self._resolve(node.id)
+        if local is None:
+            return None
+        local.names.append(node)
+        if local.capturable and local.owner is not self._functions[-1]:
+            # Every anonymous function between the use and the declaration
+            for func in reversed(self._functions):
+                if func is local.owner:
+                    break
+                if isinstance(func, astnodes.AnonymousFunction):
+                    self._captures[id(func)][1].setdefault(local.name, local)
+        return local
+
+    def _block(self, block: Any, extra: Any = None) -> None:
+        self._scopes.append({})
+        body = block.body if isinstance(block, astnodes.Block) else block
+        self._statements(body if isinstance(body, list) else [body])
+        if extra is not None:
+            self._visit(extra)      # repeat ... until sees the body's locals
+        self._scopes.pop()
+
+    def _statements(self, stmts: List[Any]) -> None:
+        for stmt in stmts:
+            self._visit(stmt)
+
+    # Walk
+
+    def _visit(self, node: Any) -> None:
+        if node is None or not isinstance(node, astnodes.Node):
+            return
+        if isinstance(node, astnodes.Name):
+            self._use(node)
+        elif isinstance(node, astnodes.LocalAssign):
+            self._local_assign(node)
+        elif isinstance(node, astnodes.Assign):
+            for value in node.values:
+                self._visit(value)
+            for target in node.targets:
+                self._store(target)
+        elif isinstance(node, astnodes.LocalFunction):
+            self._declare(node.name, capturable=False)
+            self._function(node, node.args, node.body)
+        elif isinstance(node, astnodes.Function):
+            self._store(node.name)
+            self._function(node, node.args, node.body)
+        elif isinstance(node, astnodes.Method):
+            self._visit(node.source)
+            self._function(node, [astnodes.Name("self")] + list(node.args), node.body)
+        elif isinstance(node, astnodes.AnonymousFunction):
+            self._function(node, node.args, node.body)
+        elif isinstance(node, astnodes.Fornum):
+            for expr in (node.start, node.stop, node.step):
+                self._visit(expr)
+            self._scopes.append({})
+            self._declare(node.target)
+            self._block(node.body)
+            self._scopes.pop()
+        elif isinstance(node, astnodes.Forin):
+            iters = node.iter if isinstance(node.iter, list) else [node.iter]
+            for expr in iters:
+                self._visit(expr)
+            self._scopes.append({})
+            for target in node.targets:
+                self._declare(target)
+            self._block(node.body)
+            self._scopes.pop()
+        elif isinstance(node, astnodes.Repeat):
+            self._block(node.body, node.test)
+        elif isinstance(node, (astnodes.While, astnodes.If, astnodes.ElseIf)):
+            self._visit(node.test)
+            self._block(node.body)
+            if not isinstance(node, astnodes.While):
+                orelse = node.orelse
+                if isinstance(orelse, astnodes.ElseIf):
+                    self._visit(orelse)
+                elif orelse is not None:
+                    self._block(orelse)
+        elif isinstance(node, (astnodes.Do, astnodes.Block)):
+            self._block(node.body if isinstance(node, astnodes.Do) else node)
+        elif isinstance(node, astnodes.Index):
+            self._visit(node.value)
+            if not _is_dot(node):
+                self._visit(node.idx)
+        elif isinstance(node, astnodes.Invoke):
+            self._visit(node.source)
+            for arg in node.args:
+                self._visit(arg)
+        elif isinstance(node, astnodes.Field):
+            if getattr(node, 'between_brackets', False) or not isinstance(node.key, astnodes.Name):
+                self._visit(node.key)
+            self._visit(node.value)
+        elif isinstance(node, astnodes.Call):
+            self._visit(node.func)
+            for arg in node.args:
+                self._visit(arg)
+            if isinstance(node.func, astnodes.Name):
+                # A lambda held by value may be mutable itself
+                self._mark_store(node.func.id)
+        elif isinstance(node, (astnodes.Goto, astnodes.Label)):
+            return
+        else:
+            for child in _children(node):
+                self._visit(child)
+
+    def _local_assign(self, node: astnodes.LocalAssign) -> None:
+        for value in node.values:
+            self._visit(value)
+        alone = len(node.targets) == 1 and len(node.values) <= 1
+        top_level = len(self._functions) == 1 and len(self._scopes) == 1
+        for target in node.targets:
+            if top_level and target.id in self._module_state:
+                self._declare(target, capturable=False)
+            else:
+                self._declare(target, node if alone else None)
+
+    def _store(self, target: Any) -> None:
+        if isinstance(target, astnodes.Name):
+            local = self._use(target)
+            if local is not None:
+                local.assigned = True
+            return
+        self._visit(target)
+        if isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name):
+            self._mark_store(target.value.id)
+
+    def _mark_store(self, name: str) -> None:
+        local = self._resolve(name)
+        if local is not None:
+            self._stores.setdefault(id(self._functions[-1]), set()).add(id(local))
+
+    def _function(self, node: Any, args: List[Any], body: Any) -> None:
+        if isinstance(node, astnodes.AnonymousFunction):
+            self._captures[id(node)] = (node, {})
+        self._functions.append(node)
+        self._scopes.append({})
+        for arg in args:
+            if isinstance(arg, astnodes.Name):
+                self._declare(arg)
+        stmts = body.body if isinstance(body, astnodes.Block) else body
+        self._statements(stmts if isinstance(stmts, list) else [stmts])
+        self._scopes.pop()
+        self._functions.pop()
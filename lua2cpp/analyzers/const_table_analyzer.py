@@ -0,0 +1,183 @@
+"""Constant table analyzer for Lua2C++ transpiler
+
+Finds module-level lookup tables built from constants and only ever
+read, such as `local KEYWORDS = {"and", "break", "do"}`, so the lua_table
+runtime can lay their contents out once per process, in static storage,
+instead of building them in every module init.
+"""
+
+from typing import Any, Dict, List, Optional, Set, Tuple
+from ..core.types import ASTAnnotationStore
+from .parallel_analyzer import _children, _stmts
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.Method, astnodes.AnonymousFunction)
+
+# Library functions that only read a table argument and never return it
+_READERS = {"next", "rawget", "rawlen", "unpack", ("table", "concat"), ("table", "unpack")}
+# ...and the iterators that return it, read only as a generic for's
+_ITERATORS = {"ipairs", "pairs"}
+
+
+def _is_constant(node: Any) -> bool:
+    if isinstance(node, astnodes.UMinusOp):
+        return isinstance(node.operand, astnodes.Number)
+    return isinstance(node, (astnodes.Number, astnodes.String, astnodes.TrueExpr, astnodes.FalseExpr))
+
+
+def _reader(func: Any) -> Optional[str]:
+    """The global a reading library function is found through, or None"""
+    if isinstance(func, astnodes.Name):
+        return func.id if func.id in _READERS else None
+    if (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+            and isinstance(func.idx, astnodes.Name) and (func.value.id, func.idx.id) in _READERS):
+        return func.value.id
+    return None
+
+
+class ConstTableAnalyzer:
+    """Marks the constant module tables that scripts never change
+
+    A candidate is a module-level `local t = {...}` whose fields are all
+    constants (numbers, strings, booleans), positional or under string
+    keys. It qualifies when every use of t anywhere in the module reads
+    it: `t[k]` and `t.k` as values, `#t`, `for ... in pairs(t)` (or
+    ipairs), or t passed to a library function that only reads it
+    (table.concat, rawget...).
+    Storing into it, calling a method on it, passing, returning or
+    assigning it, or naming it in `function t.f()` all disqualify it, so
+    nothing can change its contents or hand it to code that might. Names
+    are not scope-resolved: t must have no other binding in the module,
+    a global of the same name counts as a use, and a library function
+    whose name the module rebinds counts as any other function. Record
+    constructors keep their shape instead.
+
+    Annotations:
+        Table: 'const_table' -> True
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the constructors of the constant module tables
+
+        Returns:
+            How many tables were marked
+        """
+        candidates: Dict[str, astnodes.Table] = {}
+        for stmt in _stmts(chunk.body):
+            if isinstance(stmt, astnodes.LocalAssign) and len(stmt.targets) == len(stmt.values):
+                for target, value in zip(stmt.targets, stmt.values):
+                    if isinstance(target, astnodes.Name) and self._is_candidate(value):
+                        candidates[target.id] = value
+
+        self._bindings: Dict[str, int] = {}
+        self._escaped: Set[str] = set()
+        self._via: List[Tuple[str, str]] = []  # (table, library global) of each library read
+        self._walk(chunk.body)
+        self._escaped.update(name for name, lib in self._via if lib in self._bindings)
+
+        marked = 0
+        for name, table in candidates.items():
+            if self._bindings.get(name) == 1 and name not in self._escaped:
+                ASTAnnotationStore.set_annotation(table, 'const_table', True)
+                marked += 1
+        return marked
+
+    @staticmethod
+    def _is_candidate(node: Any) -> bool:
+        if not isinstance(node, astnodes.Table) or not node.fields:
+            return False
+        if ASTAnnotationStore.get_annotation(node, 'record_shape') is not None:
+            return False
+        for field in node.fields:
+            if not _is_constant(field.value):
+                return False
+            if field.key is None:
+                continue
+            if getattr(field, 'between_brackets', False):
+                if not isinstance(field.key, astnodes.String):
+                    return False
+            elif not isinstance(field.key, astnodes.Name):
+                return False
+        return True
+
+    def _bind(self, targets: List[Any]) -> None:
+        for target in targets:
+            if isinstance(target, astnodes.Name):
+                self._bindings[target.id] = self._bindings.get(target.id, 0) + 1
+
+    def _read(self, node: Any, via: Optional[str] = None) -> None:
+        """node as a table being read, through library global via if given:
+        a Name there is a harmless use"""
+        if not isinstance(node, astnodes.Name):
+            self._walk(node)
+        elif via is not None:
+            self._via.append((node.id, via))
+
+    def _walk(self, node: Any) -> None:
+        if isinstance(node, list):
+            for item in node:
+                self._walk(item)
+            return
+        if not isinstance(node, astnodes.Node):
+            return
+
+        if isinstance(node, astnodes.Name):
+            self._escaped.add(node.id)
+        elif isinstance(node, astnodes.Index):
+            self._read(node.value)
+            if node.notation != astnodes.IndexNotation.DOT:
+                self._walk(node.idx)
+        elif isinstance(node, astnodes.ULengthOP):
+            self._read(node.operand)
+        elif isinstance(node, astnodes.Call) and _reader(node.func):
+            self._walk(node.func)
+            for arg in node.args:
+                self._read(arg, _reader(node.func))
+        # LocalAssign derives from Assign
+        elif isinstance(node, astnodes.LocalAssign):
+            self._bind(node.targets)
+            self._walk(node.values)
+        elif isinstance(node, astnodes.Assign):
+            for target in node.targets:
+                # A store: the stored-to table escapes like any other use
+                if isinstance(target, astnodes.Index):
+                    self._walk(target.value)
+                    if target.notation != astnodes.IndexNotation.DOT:
+                        self._walk(target.idx)
+                else:
+                    self._walk(target)
+            self._walk(node.values)
+        elif isinstance(node, astnodes.Fornum):
+            self._bind([node.target])
+            self._walk([node.start, node.stop, node.step, node.body])
+        elif isinstance(node, astnodes.Forin):
+            self._bind(node.targets)
+            iters = node.iter if isinstance(node.iter, list) else [node.iter]
+            if (len(iters) == 1 and isinstance(iters[0], astnodes.Call)
+                    and isinstance(iters[0].func, astnodes.Name) and iters[0].func.id in _ITERATORS):
+                self._walk(iters[0].func)
+                for arg in iters[0].args:
+                    self._read(arg, iters[0].func.id)
+            else:
+                self._walk(node.iter)
+            self._walk(node.body)
+        elif isinstance(node, _FUNCTIONS):
+            self._bind(list(node.args))
+            if isinstance(node, astnodes.LocalFunction):
+                self._bind([node.name])
+            elif isinstance(node, astnodes.Function):
+                # `function t.f()` stores into t
+                name = node.name
+                while isinstance(name, astnodes.Index):
+                    name = name.value
+                self._walk(name)
+            elif isinstance(node, astnodes.Method):
+                self._walk(node.source)
+            self._walk(node.body)
+        else:
+            self._walk(_children(node))
@@ -0,0 +1,151 @@
+"""Coroutine analyzer for Lua2C++ transpiler
+
+Finds the functions that can yield, so the lua_table runtime can lower
+them to C++20 coroutines (l2c::CoTask, lua_coroutine.hpp) and await
+their calls instead of running a thread on a stack of its own.
+"""
+
+from typing import Any, Dict, List, Optional, Set
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)
+
+# Awaited inside a lowered function
+AWAIT = "await"
+# Outside one: a call runs the callee to completion, a yield fails at runtime
+RUN = "run"
+
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+def is_yield_call(node: Any) -> bool:
+    """Is node a call to coroutine.yield?"""
+    return (isinstance(node, astnodes.Call) and isinstance(node.func, astnodes.Index)
+            and isinstance(node.func.value, astnodes.Name) and node.func.value.id == "coroutine"
+            and isinstance(node.func.idx, astnodes.Name) and node.func.idx.id == "yield"
+            and str(getattr(node.func, 'notation', '')) == "IndexNotation.DOT")
+
+
+class CoroutineAnalyzer:
+    """Marks the functions that yield and the calls that suspend
+
+    A function yields when its own body (not a nested function's) calls
+    coroutine.yield, or calls a yielding function by name. Candidates
+    are the top-level `local function f` and `function f` definitions
+    and anonymous functions anywhere; a varargs function can't be
+    lowered, nor a name that has any other binding in the chunk, so
+    the yields reached through them are left to fail at runtime.
+
+    Annotations:
+        LocalFunction, Function, AnonymousFunction: 'coroutine_arity' -> parameter count
+        Call: 'coroutine_call' -> (AWAIT or RUN, callee parameter count)
+        Call: 'coroutine_yield' -> AWAIT or RUN (coroutine.yield itself)
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> Dict[str, int]:
+        """Annotate the yielding functions and their call sites
+
+        Returns:
+            Parameter count of every yielding named function, by name
+        """
+        body = chunk.body.body if isinstance(chunk.body.body, list) else [chunk.body.body]
+        bindings: Dict[str, int] = {}
+        self._count_bindings(chunk, bindings)
+
+        named: Dict[str, Any] = {}
+        for stmt in body:
+            if (isinstance(stmt, (astnodes.LocalFunction, astnodes.Function))
+                    and isinstance(stmt.name, astnodes.Name) and bindings.get(stmt.name.id) == 1
+                    and self._lowerable(stmt)):
+                named[stmt.name.id] = stmt
+
+        # Fixpoint: calling a yielding function yields
+        yielding: Set[str] = set()
+        changed = True
+        while changed:
+            changed = False
+            for name, func in named.items():
+                if name not in yielding and self._yields(func.body, yielding):
+                    yielding.add(name)
+                    changed = True
+
+        arities = {name: self._arity(named[name]) for name in yielding}
+        for name in yielding:
+            ASTAnnotationStore.set_annotation(named[name], 'coroutine_arity', arities[name])
+        self._annotate(chunk, False, arities)
+        return arities
+
+    @staticmethod
+    def _lowerable(func: Any) -> bool:
+        return all(isinstance(arg, astnodes.Name) for arg in func.args)
+
+    @staticmethod
+    def _arity(func: Any) -> int:
+        return len(func.args)
+
+    def _count_bindings(self, node: Any, bindings: Dict[str, int]) -> None:
+        def bind(target: Any) -> None:
+            if isinstance(target, astnodes.Name):
+                bindings[target.id] = bindings.get(target.id, 0) + 1
+
+        if isinstance(node, (astnodes.LocalAssign, astnodes.Assign)):
+            for target in node.targets:
+                bind(target)
+        elif isinstance(node, astnodes.Fornum):
+            bind(node.target)
+        elif isinstance(node, astnodes.Forin):
+            for target in node.targets:
+                bind(target)
+        elif isinstance(node, _FUNCTIONS):
+            for arg in node.args:
+                bind(arg)
+            if isinstance(node, (astnodes.LocalFunction, astnodes.Function)):
+                bind(node.name)
+        for child in _children(node):
+            self._count_bindings(child, bindings)
+
+    def _yields(self, node: Any, yielding: Set[str]) -> bool:
+        """Does code under node, outside nested functions, suspend?"""
+        if isinstance(node, _FUNCTIONS):
+            return False
+        if is_yield_call(node):
+            return True
+        if (isinstance(node, astnodes.Call) and isinstance(node.func, astnodes.Name)
+                and node.func.id in yielding):
+            return True
+        return any(self._yields(child, yielding) for child in _children(node))
+
+    def _annotate(self, node: Any, lowered: bool, arities: Dict[str, int]) -> None:
+        """Mark the suspending calls under node; lowered: inside a lowered function"""
+        if isinstance(node, _FUNCTIONS):
+            if isinstance(node, astnodes.AnonymousFunction) and self._lowerable(node) \
+                    and self._yields(node.body, set(arities)):
+                ASTAnnotationStore.set_annotation(node, 'coroutine_arity', self._arity(node))
+            lowered = ASTAnnotationStore.get_annotation(node, 'coroutine_arity') is not None
+            self._annotate(node.body, lowered, arities)
+            return
+        mode = AWAIT if lowered else RUN
+        if is_yield_call(node):
+            ASTAnnotationStore.set_annotation(node, 'coroutine_yield', mode)
+        elif isinstance(node, astnodes.Call) and isinstance(node.func, astnodes.Name) \
+                and node.func.id in arities:
+            ASTAnnotationStore.set_annotation(node, 'coroutine_call', (mode, arities[node.func.id]))
+        for child in _children(node):
+            self._annotate(child, lowered, arities)
@@ -0,0 +1,194 @@
+"""Escape analyzer for Lua2C++ transpiler
+
+Finds tables built inside a function that never leave it, so the
+lua_table runtime can drop the LuaTable allocation and keep each field
+in a local of its own (scalar replacement).
+"""
+
+from typing import Any, Dict, List, Optional, Set, Tuple
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+# How a Name occurrence is used
+_FIELD = "field"        # value of `t.k`, read or stored
+_OTHER = "other"        # anything else: passed, returned, indexed, assigned...
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)
+
+
+def _is_dot_index(node: Any) -> bool:
+    return (isinstance(node, astnodes.Index) and isinstance(node.idx, astnodes.Name)
+            and str(getattr(node, 'notation', '')) == "IndexNotation.DOT")
+
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+class EscapeAnalyzer:
+    """Scalar-replaces function-local tables that don't escape
+
+    A candidate is `local t = {k = v, ...}` (identifier keys only, or an
+    empty constructor) in a function, where every later use of t is
+    `t.k`, read or stored, in the rest of the declaring block. Any other
+    use escapes: passing or returning t, `t[i]`, `#t`, `t:m()`,
+    `setmetatable(t, ...)`, assigning t, or naming it in a nested
+    function. Names are not scope-resolved, so t must have no other
+    binding in the function and no use outside that block.
+
+    Annotations:
+        LocalAssign: 'scalar_replaced' -> [(C++ variable, initializer or None)]
+        Index: 'scalar_field' -> C++ variable
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the replaceable tables of every function
+
+        Returns:
+            Number of tables scalar-replaced
+        """
+        replaced = 0
+        stack = [chunk]
+        while stack:
+            node = stack.pop()
+            if isinstance(node, _FUNCTIONS):
+                replaced += self._analyze_function(node)
+            stack.extend(_children(node))
+        return replaced
+
+    def _analyze_function(self, func: Any) -> int:
+        bindings: Dict[str, int] = {}
+        uses: Dict[str, List[Tuple[str, Any]]] = {}
+        candidates: List[Tuple[astnodes.LocalAssign, List[Any]]] = []
+        for arg in func.args:
+            if isinstance(arg, astnodes.Name):
+                bindings[arg.id] = bindings.get(arg.id, 0) + 1
+        self._walk(func.body, False, bindings, uses, candidates)
+
+        replaced = 0
+        declared: Set[str] = set(bindings) | set(uses)
+        for node, rest in candidates:
+            name = node.targets[0].id
+            if bindings.get(name) != 1:
+                continue
+            occurrences = uses.get(name, [])
+            if any(kind != _FIELD for kind, _ in occurrences):
+                continue
+            later: Dict[str, List[Tuple[str, Any]]] = {}
+            self._walk(rest, False, {}, later, [])
+            if len(later.get(name, [])) != len(occurrences):
+                continue
+
+            variables: Dict[str, str] = {}
+            fields: List[Tuple[str, Optional[Any]]] = []
+
+            def variable(key: str) -> str:
+                if key not in variables:
+                    var = f"{name}_{key}"
+                    while var in declared:
+                        var = f"_{var}"
+                    declared.add(var)
+                    variables[key] = var
+                return variables[key]
+
+            for field in node.values[0].fields:
+                fields.append((variable(field.key.id), field.value))
+            for _, index in occurrences:
+                key = index.idx.id
+                if key not in variables:
+                    fields.append((variable(key), None))
+                ASTAnnotationStore.set_annotation(index, 'scalar_field', variables[key])
+            ASTAnnotationStore.set_annotation(node, 'scalar_replaced', fields)
+            replaced += 1
+        return replaced
+
+    @staticmethod
+    def _is_candidate(node: Any) -> bool:
+        if not isinstance(node, astnodes.LocalAssign) or len(node.targets) != 1 or len(node.values) != 1:
+            return False
+        table = node.values[0]
+        if not isinstance(node.targets[0], astnodes.Name) or not isinstance(table, astnodes.Table):
+            return False
+        keys = []
+        for field in table.fields:
+            if (field.key is None or getattr(field, 'between_brackets', False)
+                    or not isinstance(field.key, astnodes.Name) or isinstance(field.value, astnodes.Varargs)):
+                return False
+            keys.append(field.key.id)
+        return len(set(keys)) == len(keys)
+
+    def _walk(self, node: Any, nested: bool, bindings: Dict[str, int],
+              uses: Dict[str, List[Tuple[str, Any]]],
+              candidates: List[Tuple[astnodes.LocalAssign, List[Any]]]) -> None:
+        """Count the bindings and classify the uses of every name under node
+
+        Uses inside a nested function are captures, so they count as
+        escaping whatever their form.
+        """
+        def bind(target: Any) -> None:
+            if isinstance(target, astnodes.Name):
+                bindings[target.id] = bindings.get(target.id, 0) + 1
+
+        def use(name: astnodes.Name, kind: str, index: Any = None) -> None:
+            uses.setdefault(name.id, []).append((_OTHER if nested else kind, index))
+
+        if isinstance(node, list):
+            for item in node:
+                self._walk(item, nested, bindings, uses, candidates)
+            return
+        if not isinstance(node, astnodes.Node):
+            return
+
+        if isinstance(node, astnodes.Block):
+            body = node.body if isinstance(node.body, list) else [node.body]
+            for i, stmt in enumerate(body):
+                if not nested and self._is_candidate(stmt):
+                    candidates.append((stmt, body[i + 1:]))
+                self._walk(stmt, nested, bindings, uses, candidates)
+        elif isinstance(node, astnodes.Name):
+            use(node, _OTHER)
+        elif _is_dot_index(node):
+            if isinstance(node.value, astnodes.Name):
+                use(node.value, _FIELD, node)
+            else:
+                self._walk(node.value, nested, bindings, uses, candidates)
+        elif isinstance(node, astnodes.LocalAssign):
+            for target in node.targets:
+                bind(target)
+            self._walk(node.values, nested, bindings, uses, candidates)
+        elif isinstance(node, astnodes.Fornum):
+            bind(node.target)
+            self._walk([node.start, node.stop, node.step, node.body], nested, bindings, uses, candidates)
+        elif isinstance(node, astnodes.Forin):
+            for target in node.targets:
+                bind(target)
+            self._walk([node.iter, node.body], nested, bindings, uses, candidates)
+        elif isinstance(node, _FUNCTIONS):
+            for arg in node.args:
+                bind(arg)
+            if isinstance(node, astnodes.LocalFunction):
+                bind(node.name)
+            elif isinstance(node, astnodes.Function):
+                # `function t.m()` is not lowered as a field store
+                self._walk(node.name, True, bindings, uses, candidates)
+            self._walk(node.body, True, bindings, uses, candidates)
+        elif isinstance(node, astnodes.Invoke):
+            self._walk([node.source, node.args], nested, bindings, uses, candidates)
+        elif isinstance(node, astnodes.Field) and not getattr(node, 'between_brackets', False):
+            self._walk(node.value, nested, bindings, uses, candidates)
+        else:
+            self._walk(_children(node), nested, bindings, uses, candidates)
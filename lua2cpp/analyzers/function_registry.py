@@ -11,7 +11,7 @@ Architecture:
 """
 
 from dataclasses import dataclass, field
-from typing import Dict, List, Optional
+from typing import Dict, List, Optional, Set
 
 if __name__.startswith('lua2cpp.analyzers'):
     # When imported from within lua2cpp package
@@ -68,6 +68,11 @@ class FunctionSignature:
         return_type: Inferred return type (None if unknown)
         is_local: True if this is a local function
         call_sites: List of all call sites for this function
+        concrete_param_types: C++ parameter types once the call sites settle them
+            (None while the function is emitted as a template)
+        call_count: Calls seen by an instrumented run (--profile)
+        observed_param_types: Lua type names an instrumented run saw per parameter index
+        observed_return_types: Lua type names of the values it returned
     """
     name: str
     param_names: List[str]
@@ -75,6 +80,10 @@ class FunctionSignature:
     return_type: Optional['Type'] = None
     is_local: bool = False
     call_sites: List[CallSiteInfo] = field(default_factory=list)
+    concrete_param_types: Optional[List[str]] = None
+    call_count: int = 0
+    observed_param_types: Dict[int, Set[str]] = field(default_factory=dict)
+    observed_return_types: Set[str] = field(default_factory=set)
 
     def get_param_index(self, param_name: str) -> Optional[int]:
         """Get the index of a parameter by name
@@ -117,6 +126,18 @@ class FunctionSignature:
         """
         return self.call_sites.copy()
 
+    def observed_as(self, param_index: int, type_name: str) -> bool:
+        """Check if a profiled run only ever passed type_name for a parameter
+
+        Args:
+            param_index: Parameter index
+            type_name: Lua type name ("number", "table", ...)
+
+        Returns:
+            True if the parameter was observed with exactly that type
+        """
+        return self.observed_param_types.get(param_index) == {type_name}
+
 
 class FunctionSignatureRegistry:
     """Registry for tracking function signatures and call sites
@@ -187,6 +208,76 @@ class FunctionSignatureRegistry:
 
         return signature
 
+    def set_concrete_signature(self, name: str, param_types: Optional[List[str]]) -> None:
+        """Set the C++ parameter types a function is emitted with
+
+        Args:
+            name: Function name
+            param_types: One C++ type per parameter, or None for a template
+        """
+        signature = self.signatures.get(name)
+        if signature:
+            signature.concrete_param_types = param_types
+
+    def get_concrete_signature(self, name: str) -> Optional[List[str]]:
+        """Get the C++ parameter types of a function with a concrete signature
+
+        Args:
+            name: Function name
+
+        Returns:
+            One C++ type per parameter, or None if it is a template
+        """
+        signature = self.signatures.get(name)
+        return signature.concrete_param_types if signature else None
+
+    def record_observed_types(
+        self,
+        name: str,
+        param_names: List[str],
+        calls: int,
+        param_types: List[Set[str]],
+        return_types: Set[str]
+    ) -> Optional[FunctionSignature]:
+        """Record the argument and return types an instrumented run observed
+
+        Registers the function (as non-local) if it isn't known yet, so
+        nested and table functions can carry profile data too.
+
+        Args:
+            name: Function name
+            param_names: Ordered list of parameter names
+            calls: Number of calls in the profile
+            param_types: Lua type names seen per parameter
+            return_types: Lua type names of the returned values
+
+        Returns:
+            The function's signature, or None if another function with
+            different parameters is registered under the name
+        """
+        signature = self.signatures.get(name)
+        if signature is None:
+            signature = self.register_function(name, param_names, is_local=False)
+        elif signature.param_names != param_names:
+            return None
+        signature.call_count += calls
+        for index, types in enumerate(param_types[:len(param_names)]):
+            signature.observed_param_types.setdefault(index, set()).update(types)
+        signature.observed_return_types |= return_types
+        return signature
+
+    def get_hot_functions(self, min_calls: int) -> List[str]:
+        """Get functions a profiled run called at least min_calls times
+
+        Args:
+            min_calls: Call count threshold
+
+        Returns:
+            Function names, most called first
+        """
+        hot = [sig for sig in self.signatures.values() if sig.call_count >= min_calls]
+        return [sig.name for sig in sorted(hot, key=lambda sig: -sig.call_count)]
+
     def has_function(self, name: str) -> bool:
         """Check if a function is registered
 
@@ -0,0 +1,82 @@
+"""Hot path analyzer for Lua2C++ transpiler
+
+Finds the arithmetic that runs inside loops, so the lua_table runtime
+can give each operation whose operands aren't proven numbers a guarded
+fast path: raw double arithmetic when both operands hold floats, a
+direct array-part read when an indexed operand is a plain table, and
+the generic TValue operator otherwise.
+"""
+
+from typing import Any
+from ..core.types import ASTAnnotationStore
+from .parallel_analyzer import _children, _is_dot
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.Method, astnodes.AnonymousFunction)
+_GUARDED_OPS = (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp, astnodes.FloatDivOp)
+
+
+class HotPathAnalyzer:
+    """Marks the arithmetic of loop bodies for guarded fast paths
+
+    An operation is hot when it runs once per iteration of an enclosing
+    loop of its own function: in the body of any loop, or in the
+    condition of a while or repeat loop. A closure defined in a loop
+    counts as a function of its own. Of a hot operation's operands, the
+    ones indexing a table by a computed key (`t[i]`, not `t.k` or
+    `t["k"]`, which have inline caches) are marked too.
+
+    Whether an operand is a proven number is left to the generator,
+    which knows the unboxed locals.
+
+    Annotations:
+        AddOp/SubOp/MultOp/FloatDivOp: 'guarded_op' -> True
+        Index: 'guarded_index' -> True
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the hot arithmetic of every function and the module body
+
+        Returns:
+            How many operations were marked
+        """
+        self._marked = 0
+        self._walk(chunk.body, False)
+        return self._marked
+
+    def _walk(self, node: Any, hot: bool) -> None:
+        if isinstance(node, list):
+            for item in node:
+                self._walk(item, hot)
+            return
+        if not isinstance(node, astnodes.Node):
+            return
+
+        if isinstance(node, _FUNCTIONS):
+            self._walk(node.body, False)
+            return
+        if isinstance(node, astnodes.Fornum):
+            self._walk([node.start, node.stop, node.step], hot)
+            self._walk(node.body, True)
+            return
+        if isinstance(node, astnodes.Forin):
+            self._walk(node.iter, hot)
+            self._walk(node.body, True)
+            return
+        if isinstance(node, (astnodes.While, astnodes.Repeat)):
+            self._walk([node.test, node.body], True)
+            return
+
+        if hot and isinstance(node, _GUARDED_OPS):
+            ASTAnnotationStore.set_annotation(node, 'guarded_op', True)
+            self._marked += 1
+            for operand in (node.left, node.right):
+                if (isinstance(operand, astnodes.Index) and not _is_dot(operand)
+                        and not isinstance(operand.idx, astnodes.String)):
+                    ASTAnnotationStore.set_annotation(operand, 'guarded_index', True)
+        self._walk(_children(node), hot)
@@ -0,0 +1,436 @@
+"""Load analyzer for Lua2C++ transpiler
+
+Finds constant-key table reads (`x.k`, `x["k"]`) that can share one load:
+repeated reads of the same local's field in a basic block, and reads in
+a loop that no iteration can change. The lua_table runtime loads each
+into a TValue once, ahead of the statement or loop, instead of hashing
+or probing the key at every read.
+"""
+
+from dataclasses import dataclass, field
+from typing import Any, Dict, List, Optional, Set, Tuple
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.Method, astnodes.AnonymousFunction)
+_CALLS = (astnodes.Call, astnodes.Invoke)
+_LOOPS = (astnodes.While, astnodes.Repeat, astnodes.Fornum, astnodes.Forin)
+_SIMPLE = (astnodes.LocalAssign, astnodes.Assign, astnodes.Return, astnodes.Call, astnodes.Invoke)
+
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+def _stmts(block: Any) -> List[Any]:
+    body = block.body if isinstance(block, astnodes.Block) else block
+    return body if isinstance(body, list) else [body]
+
+
+def _constant_key(node: astnodes.Index) -> Optional[str]:
+    if str(getattr(node, 'notation', '')) == "IndexNotation.DOT" and isinstance(node.idx, astnodes.Name):
+        return node.idx.id
+    if isinstance(node.idx, astnodes.String):
+        s = node.idx.s
+        return s.decode() if isinstance(s, bytes) else s
+    return None
+
+
+@dataclass
+class _Load:
+    """Reads of one (local, key) sharing a load, declared before stmt"""
+    stmt: Any
+    invariant: bool = False     # stmt is a loop, loaded once for all iterations
+    reads: List[Any] = field(default_factory=list)
+
+
+class LoadAnalyzer:
+    """Shares constant-key reads of locals' fields
+
+    Reads in a basic block: within the simple statements (local, =,
+    return, call) of a block, between two statements that can change
+    what x.k holds, every read of x.k uses the first one's value. The
+    statements that can are, in order: one that calls anything (a call
+    can store anywhere), one that stores to some table's k or to a
+    computed non-numeric key, and one that assigns or redeclares x. A
+    read only joins when every call in its own statement encloses it,
+    so the calls run after it.
+
+    Loop-invariant reads: a loop without calls or goto, and a generic
+    for only over pairs/ipairs, gets its reads of x.k loaded before the
+    loop when nothing in it assigns x or stores to k (or to a computed
+    non-numeric key).
+
+    Only tables provably without a metatable share reads: a read of any
+    other table may itself run __index, and any read, store, operator or
+    call may run a metamethod that changes its fields, as __newindex
+    storing p.f for `mt.z = 99` does. That rules out parameters, call
+    results and whatever a table was loaded from. A base qualifies when
+    every binding of its name is a table constructor, all in one
+    function, and every use is `x.k`, `x[e]`, `#x` or a store to one of
+    those: it never reaches setmetatable or anything that could call it.
+    Then only stores to its fields change them. They must all be in the
+    declaring function, whose activation owns the table; other functions
+    share reads of it only when it is bound once and never stored to.
+    Names are not scope-resolved, so any other use of one (a parameter,
+    a loop variable, passing it) disqualifies every local of that name.
+
+    Reads never fail (indexing a non-table gives nil in the runtime), so
+    a shared load may run where one of the reads would not have. Bases
+    are locals only; functions with gotos are left alone, a load
+    declaration could sit between a goto and its label. The debug
+    library, which can reach any local, is not accounted for.
+
+    Annotations:
+        statement or loop: 'hoisted_loads' -> [(C++ variable, Index to load)]
+        Index: 'load' -> C++ variable holding its value
+    """
+
+    def __init__(self) -> None:
+        self._loads: List[_Load] = []
+        self._scopes: List[Set[str]] = []
+        self._counters: List[Set[str]] = []
+        self._claimed: Set[int] = set()
+        self._plain: Dict[str, Tuple[Any, bool]] = {}
+        self._bodies: List[Any] = []
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the shared loads of every function
+
+        Returns:
+            Number of table reads that no longer load
+        """
+        self._loads = []
+        self._scopes = [set()]
+        self._counters = [set()]
+        self._claimed = set()
+        self._plain = self._plain_tables(chunk)
+        self._bodies = []
+        self._function(chunk.body, [])
+        saved = 0
+        count = 0
+        for load in self._loads:
+            if len(load.reads) < 2 and not load.invariant:
+                continue
+            var = f"_l2c_load_{count}"
+            count += 1
+            hoisted = ASTAnnotationStore.get_annotation(load.stmt, 'hoisted_loads') or []
+            hoisted.append((var, load.reads[0]))
+            ASTAnnotationStore.set_annotation(load.stmt, 'hoisted_loads', hoisted)
+            for read in load.reads:
+                ASTAnnotationStore.set_annotation(read, 'load', var)
+            saved += len(load.reads) - (0 if load.invariant else 1)
+        return saved
+
+    # Functions and blocks
+
+    def _function(self, body: Any, args: List[Any]) -> None:
+        if self._has_goto(body):
+            self._skip(body)
+            return
+        self._scopes.append({a.id for a in args if isinstance(a, astnodes.Name)})
+        self._counters.append(set())
+        self._bodies.append(body)
+        self._block(body)
+        self._bodies.pop()
+        self._counters.pop()
+        self._scopes.pop()
+
+    def _block(self, block: Any) -> None:
+        self._scopes.append(set())
+        available: Dict[Tuple[str, str], _Load] = {}
+        for stmt in _stmts(block):
+            if isinstance(stmt, _SIMPLE):
+                self._simple(stmt, available)
+                self._expression_functions(stmt)
+                continue
+            available = {}
+            if isinstance(stmt, _LOOPS):
+                self._loop(stmt)
+            self._nested(stmt)
+        self._scopes.pop()
+
+    def _nested(self, stmt: Any) -> None:
+        """The blocks and functions of a compound statement"""
+        if isinstance(stmt, astnodes.LocalFunction):
+            self._scopes[-1].add(stmt.name.id)
+        if isinstance(stmt, _FUNCTIONS):
+            self._function(stmt.body, list(stmt.args) + ([astnodes.Name("self")]
+                                                         if isinstance(stmt, astnodes.Method) else []))
+            return
+        if isinstance(stmt, (astnodes.Fornum, astnodes.Forin)):
+            targets = [stmt.target] if isinstance(stmt, astnodes.Fornum) else stmt.targets
+            self._scopes.append({t.id for t in targets})
+            self._counters.append({stmt.target.id} if isinstance(stmt, astnodes.Fornum) else set())
+            self._block(stmt.body)
+            self._counters.pop()
+            self._scopes.pop()
+        elif isinstance(stmt, (astnodes.While, astnodes.Repeat, astnodes.Do)):
+            self._block(stmt.body)
+        elif isinstance(stmt, (astnodes.If, astnodes.ElseIf)):
+            self._block(stmt.body)
+            if isinstance(stmt.orelse, astnodes.ElseIf):
+                self._nested(stmt.orelse)
+            elif stmt.orelse is not None:
+                self._block(stmt.orelse)
+        elif isinstance(stmt, astnodes.Block):
+            self._block(stmt)
+        self._expression_functions(stmt)
+
+    def _expression_functions(self, node: Any) -> None:
+        """Anonymous functions in a statement's own expressions"""
+        for child in _children(node):
+            if isinstance(child, astnodes.AnonymousFunction):
+                self._function(child.body, child.args)
+            elif not isinstance(child, (astnodes.Block, astnodes.ElseIf) + _FUNCTIONS):
+                self._expression_functions(child)
+
+    def _skip(self, body: Any) -> None:
+        """Still visit the functions nested in a function left alone"""
+        for node in self._walk(body, into_functions=False):
+            if isinstance(node, _FUNCTIONS):
+                args = list(node.args) + ([astnodes.Name("self")] if isinstance(node, astnodes.Method) else [])
+                self._function(node.body, args)
+
+    # Basic blocks
+
+    def _simple(self, stmt: Any, available: Dict[Tuple[str, str], _Load]) -> None:
+        reads: List[Tuple[Any, Tuple[Any, ...]]] = []
+        calls: List[Any] = []
+        self._reads(stmt, (), reads, calls, top=True)
+        for read, enclosing in reads:
+            key = self._key(read)
+            if key is None or id(read) in self._claimed:
+                continue
+            if any(all(call is not e for e in enclosing) for call in calls):
+                continue
+            if key not in available:
+                available[key] = _Load(stmt)
+                self._loads.append(available[key])
+            available[key].reads.append(read)
+
+        # What the statement changes for the next ones
+        if calls:
+            available.clear()
+        targets = stmt.targets if isinstance(stmt, (astnodes.Assign, astnodes.LocalAssign)) else []
+        for target in targets:
+            if isinstance(target, astnodes.Name):
+                for key in [k for k in available if k[0] == target.id]:
+                    del available[key]
+            elif isinstance(target, astnodes.Index):
+                stored = _constant_key(target)
+                if stored is None and not self._numeric(target.idx):
+                    available.clear()
+                for key in [k for k in available if k[1] == stored]:
+                    del available[key]
+        if isinstance(stmt, astnodes.LocalAssign):
+            self._scopes[-1].update(t.id for t in stmt.targets)
+
+    def _reads(self, node: Any, enclosing: Tuple[Any, ...], reads: List[Tuple[Any, Tuple[Any, ...]]],
+               calls: List[Any], top: bool = False) -> None:
+        """Constant-key reads of node in evaluation, with their enclosing calls"""
+        if isinstance(node, _FUNCTIONS):
+            return
+        if isinstance(node, _CALLS):
+            calls.append(node)
+            enclosing = enclosing + (node,)
+        if isinstance(node, astnodes.Call) and isinstance(node.func, astnodes.Index):
+            # The function itself may be bound statically; only its table is read
+            self._reads(node.func.value, enclosing, reads, calls)
+            for arg in node.args:
+                self._reads(arg, enclosing, reads, calls)
+            return
+        if top and isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+            for value in node.values:
+                self._reads(value, enclosing, reads, calls)
+            for target in node.targets:
+                if isinstance(target, astnodes.Index):
+                    # A store: the table and a computed key are read
+                    self._reads(target.value, enclosing, reads, calls)
+                    if _constant_key(target) is None:
+                        self._reads(target.idx, enclosing, reads, calls)
+            return
+        if isinstance(node, astnodes.Index):
+            if isinstance(node.value, astnodes.Name) and _constant_key(node) is not None:
+                reads.append((node, enclosing))
+            self._reads(node.value, enclosing, reads, calls)
+            if _constant_key(node) is None:
+                self._reads(node.idx, enclosing, reads, calls)
+            return
+        for child in _children(node):
+            self._reads(child, enclosing, reads, calls)
+
+    def _key(self, read: astnodes.Index) -> Optional[Tuple[str, str]]:
+        name = read.value.id
+        if not any(name in scope for scope in self._scopes):
+            return None
+        plain = self._plain.get(name)
+        if plain is None or (plain[0] is not self._bodies[-1] and not plain[1]):
+            return None
+        if ASTAnnotationStore.get_annotation(read, 'scalar_field') is not None:
+            return None
+        return (name, _constant_key(read))
+
+    def _numeric(self, node: Any) -> bool:
+        """A key that is a number (ignoring metamethods)"""
+        if isinstance(node, (astnodes.Number, astnodes.AriOp, astnodes.ULengthOP, astnodes.UMinusOp)):
+            return True
+        return isinstance(node, astnodes.Name) and any(node.id in c for c in self._counters)
+
+    # Loops
+
+    def _loop(self, loop: Any) -> None:
+        if ASTAnnotationStore.get_annotation(loop, 'parallel_loop') \
+                or ASTAnnotationStore.get_annotation(loop, 'vector_loop'):
+            return
+        if isinstance(loop, astnodes.Forin):
+            it = loop.iter[0] if isinstance(loop.iter, list) else loop.iter
+            if not (isinstance(it, astnodes.Call) and isinstance(it.func, astnodes.Name)
+                    and it.func.id in ("pairs", "ipairs")):
+                return
+            inside: List[Any] = [loop.body] + list(loop.targets)
+        elif isinstance(loop, astnodes.Fornum):
+            inside = [loop.body, loop.target]
+        else:
+            inside = [loop.body, loop.test]
+        nodes = [n for part in inside for n in [part] + self._walk(part, into_functions=False)]
+        assigned: Set[str] = {loop.target.id} if isinstance(loop, astnodes.Fornum) else set()
+        if isinstance(loop, astnodes.Forin):
+            assigned.update(t.id for t in loop.targets)
+        stored: Set[str] = set()
+        counters = {loop.target.id} if isinstance(loop, astnodes.Fornum) else set()
+        for node in nodes:
+            if isinstance(node, _CALLS + (astnodes.Goto, astnodes.Label)):
+                return
+            if isinstance(node, astnodes.Fornum):
+                assigned.add(node.target.id)
+                counters.add(node.target.id)
+            elif isinstance(node, astnodes.Forin):
+                assigned.update(t.id for t in node.targets)
+            elif isinstance(node, astnodes.LocalFunction):
+                assigned.add(node.name.id)
+            elif isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                for target in node.targets:
+                    if isinstance(target, astnodes.Name):
+                        assigned.add(target.id)
+                    elif isinstance(target, astnodes.Index):
+                        key = _constant_key(target)
+                        if key is not None:
+                            stored.add(key)
+                        elif not (self._numeric(target.idx) or (isinstance(target.idx, astnodes.Name)
+                                                                 and target.idx.id in counters)):
+                            return
+        loads: Dict[Tuple[str, str], _Load] = {}
+        for node in nodes:
+            if not isinstance(node, astnodes.Index) or not isinstance(node.value, astnodes.Name):
+                continue
+            key = _constant_key(node)
+            if key is None or key in stored or node.value.id in assigned:
+                continue
+            if self._key(node) is None or id(node) in self._claimed:
+                continue
+            if (node.value.id, key) not in loads:
+                loads[(node.value.id, key)] = _Load(loop, invariant=True)
+                self._loads.append(loads[(node.value.id, key)])
+            loads[(node.value.id, key)].reads.append(node)
+            # Claimed now, so the analysis inside the loop leaves it
+            self._claimed.add(id(node))
+
+    # Helpers
+
+    def _walk(self, node: Any, into_functions: bool) -> List[Any]:
+        found = []
+        stack = _children(node)
+        while stack:
+            child = stack.pop()
+            found.append(child)
+            if into_functions or not isinstance(child, _FUNCTIONS):
+                stack.extend(_children(child))
+        return found
+
+    def _plain_tables(self, chunk: astnodes.Chunk) -> Dict[str, Tuple[Any, bool]]:
+        """Locals that only ever hold a table without a metatable
+
+        Returns:
+            Name -> (body of the declaring function, whether it is bound
+            once and never stored to)
+        """
+        bindings: Dict[str, List[Tuple[Any, bool]]] = {}
+        stores: Dict[str, Set[int]] = {}
+        escaped: Set[str] = set()
+
+        def escape(node: Any) -> None:
+            if node is not None:
+                escaped.update(n.id for n in [node] + self._walk(node, into_functions=True)
+                               if isinstance(n, astnodes.Name))
+
+        def visit(node: Any, body: Any) -> None:
+            if isinstance(node, _FUNCTIONS):
+                escape(node.source if isinstance(node, astnodes.Method) else getattr(node, 'name', None))
+                for arg in node.args:
+                    escape(arg)
+                visit(node.body, node.body)
+            elif isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                for i, target in enumerate(node.targets):
+                    value = node.values[i] if i < len(node.values) else None
+                    if isinstance(target, astnodes.Name):
+                        constructed = isinstance(value, astnodes.Table)
+                        if not constructed:
+                            escaped.add(target.id)
+                        bindings.setdefault(target.id, []).append(
+                            (body, constructed and isinstance(node, astnodes.LocalAssign)))
+                    elif isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name):
+                        stores.setdefault(target.value.id, set()).add(id(body))
+                        if _constant_key(target) is None:
+                            visit(target.idx, body)
+                    else:
+                        visit(target, body)
+                for value in node.values:
+                    visit(value, body)
+            elif isinstance(node, astnodes.Index):
+                if not isinstance(node.value, astnodes.Name):
+                    visit(node.value, body)
+                if _constant_key(node) is None:
+                    visit(node.idx, body)
+            elif isinstance(node, astnodes.ULengthOP) and isinstance(node.operand, astnodes.Name):
+                return
+            elif isinstance(node, astnodes.Invoke):
+                visit(node.source, body)
+                for arg in node.args:
+                    visit(arg, body)
+            elif isinstance(node, astnodes.Field):
+                if node.between_brackets:
+                    visit(node.key, body)
+                visit(node.value, body)
+            elif isinstance(node, astnodes.Name):
+                escaped.add(node.id)
+            elif not isinstance(node, (astnodes.Goto, astnodes.Label)):
+                for child in _children(node):
+                    visit(child, body)
+
+        visit(chunk.body, chunk.body)
+        plain: Dict[str, Tuple[Any, bool]] = {}
+        for name, bound in bindings.items():
+            body = bound[0][0]
+            if name in escaped or any(b is not body for b, _ in bound) \
+                    or stores.get(name, {id(body)}) != {id(body)}:
+                continue
+            plain[name] = (body, len(bound) == 1 and bound[0][1] and name not in stores)
+        return plain
+
+    def _has_goto(self, body: Any) -> bool:
+        return any(isinstance(n, (astnodes.Goto, astnodes.Label)) for n in self._walk(body, into_functions=False))
@@ -0,0 +1,423 @@
+"""Parallel loop analyzer for Lua2C++ transpiler
+
+Finds the numeric for-loops whose iterations are independent, so that
+`--parallel` can run them on all cores through l2c::parallel_for
+(lua_parallel.hpp) instead of one after another.
+"""
+
+from dataclasses import dataclass, field
+from typing import Any, Dict, List, Optional, Set
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)
+
+# math functions that only compute a number from numbers
+PURE_MATH = {'abs', 'acos', 'asin', 'atan', 'ceil', 'cos', 'deg', 'exp', 'floor', 'fmod',
+             'log', 'max', 'min', 'rad', 'sin', 'sqrt', 'tan'}
+_MATH_CONSTANTS = {'pi', 'huge'}
+
+_OPERATORS = (astnodes.AriOp, astnodes.BitOp, astnodes.RelOp, astnodes.LoOp)
+_UNARY = (astnodes.UMinusOp, astnodes.ULNotOp, astnodes.UBNotOp)
+
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+def _stmts(block: Any) -> List[Any]:
+    body = block.body if isinstance(block, astnodes.Block) else block
+    return body if isinstance(body, list) else [body]
+
+
+def _is_dot(node: Any) -> bool:
+    return str(getattr(node, 'notation', '')) == "IndexNotation.DOT"
+
+
+@dataclass
+class ParallelLoop:
+    """What l2c::parallel_for needs to know about one loop
+
+    written: tables stored to at the loop index, in first-store order
+    read: tables indexed (or measured with #) by the iterations
+    reductions: accumulators `x = x + e`, in first-use order
+    outer: every variable from outside the loop that the iterations read
+    locals: the locals the loop body declares
+    """
+    written: List[str] = field(default_factory=list)
+    read: List[str] = field(default_factory=list)
+    reductions: List[str] = field(default_factory=list)
+    outer: List[str] = field(default_factory=list)
+    locals: List[str] = field(default_factory=list)
+
+
+class _NotParallel(Exception):
+    pass
+
+
+class _BodyChecker:
+    """Checks one loop body, or one candidate pure function body
+
+    Accepts only code that computes from numbers and reads tables whose
+    contents no iteration changes. A loop body reads the locals visible
+    outside it, indexes them and stores to `t[i]` (i the loop variable);
+    a function body sees only its own locals and indexes nothing.
+    """
+
+    def __init__(self, pure: Set[str], outer: Set[str], loop_var: Optional[str] = None,
+                 counts: Optional[Dict[str, int]] = None) -> None:
+        self.pure = pure
+        self.outer = outer
+        self.loop_var = loop_var
+        self.counts = counts or {}
+        self.info = ParallelLoop()
+        self.uses: Set[str] = set()  # outer names read other than as store targets
+        self.work = False
+
+    def block(self, block: Any, scope: Set[str], depth: int) -> None:
+        scope = set(scope)
+        for stmt in _stmts(block):
+            self.stmt(stmt, scope, depth)
+
+    def stmt(self, node: Any, scope: Set[str], depth: int) -> None:
+        if isinstance(node, astnodes.LocalAssign):
+            for value in node.values:
+                self.expr(value, scope)
+            self.declare(scope, *(t.id for t in node.targets))
+        elif isinstance(node, astnodes.Assign):
+            self.assign(node, scope)
+        elif isinstance(node, (astnodes.If, astnodes.ElseIf)):
+            self.expr(node.test, scope)
+            self.block(node.body, scope, depth)
+            if isinstance(node.orelse, (astnodes.If, astnodes.ElseIf)):
+                self.stmt(node.orelse, scope, depth)
+            elif node.orelse is not None:
+                self.block(node.orelse, scope, depth)
+        elif isinstance(node, astnodes.While):
+            self.expr(node.test, scope)
+            self.block(node.body, scope, depth + 1)
+            self.work = True
+        elif isinstance(node, astnodes.Repeat):
+            inner = set(scope)
+            for stmt in _stmts(node.body):
+                self.stmt(stmt, inner, depth + 1)
+            self.expr(node.test, inner)  # sees the body's locals
+            self.work = True
+        elif isinstance(node, astnodes.Fornum):
+            for bound in (node.start, node.stop, node.step):
+                self.expr(bound, scope)
+            inner = set(scope)
+            self.declare(inner, node.target.id)
+            self.block(node.body, inner, depth + 1)
+            self.work = True
+        elif isinstance(node, astnodes.Do):
+            self.block(node.body, scope, depth)
+        elif isinstance(node, astnodes.Call):
+            self.expr(node, scope)
+        elif isinstance(node, astnodes.Return) and self.loop_var is None:
+            for value in node.values or []:
+                self.expr(value, scope)
+        elif isinstance(node, astnodes.Break) and (depth > 0 or self.loop_var is None):
+            pass
+        elif not isinstance(node, (astnodes.SemiColon, astnodes.Semicolon)):
+            # return, goto, functions, method calls...
+            raise _NotParallel()
+
+    def declare(self, scope: Set[str], *names: str) -> None:
+        scope.update(names)
+        self.info.locals.extend(n for n in names if n not in self.info.locals)
+
+    def assign(self, node: astnodes.Assign, scope: Set[str]) -> None:
+        if len(node.targets) != 1 or len(node.values) != 1:
+            if not all(isinstance(t, astnodes.Name) and t.id in scope for t in node.targets):
+                raise _NotParallel()
+            for value in node.values:
+                self.expr(value, scope)
+            return
+        target, value = node.targets[0], node.values[0]
+        if isinstance(target, astnodes.Name) and target.id in scope:
+            self.expr(value, scope)
+        elif isinstance(target, astnodes.Name) and self._is_reduction(target.id, value, scope):
+            if target.id not in self.info.reductions:
+                self.info.reductions.append(target.id)
+            ASTAnnotationStore.set_annotation(node, 'parallel_reduction',
+                                              self.info.reductions.index(target.id))
+            self.expr(value.right, scope)
+        elif (isinstance(target, astnodes.Index) and not _is_dot(target)
+              and isinstance(target.value, astnodes.Name) and self._outer(target.value.id, scope)
+              and isinstance(target.idx, astnodes.Name) and target.idx.id == self.loop_var
+              and target.idx.id not in scope):
+            if target.value.id not in self.info.written:
+                self.info.written.append(target.value.id)
+            ASTAnnotationStore.set_annotation(node, 'parallel_store', True)
+            self.expr(value, scope)
+        else:
+            raise _NotParallel()
+
+    def _is_reduction(self, name: str, value: Any, scope: Set[str]) -> bool:
+        """`x = x + e` with x from outside, named nowhere else in the loop"""
+        return (self.loop_var is not None and self._outer(name, scope)
+                and isinstance(value, astnodes.AddOp) and isinstance(value.left, astnodes.Name)
+                and value.left.id == name and self.counts.get(name) == 2)
+
+    def _outer(self, name: str, scope: Set[str]) -> bool:
+        return (self.loop_var is not None and name != self.loop_var
+                and name not in scope and name in self.outer)
+
+    def expr(self, node: Any, scope: Set[str]) -> None:
+        if node is None or isinstance(node, (astnodes.Number, astnodes.Nil,
+                                             astnodes.TrueExpr, astnodes.FalseExpr)):
+            return
+        if isinstance(node, astnodes.Name):
+            if node.id in scope or node.id == self.loop_var:
+                return
+            if self._outer(node.id, scope) and node.id not in self.pure:
+                self.uses.add(node.id)
+                return
+            raise _NotParallel()
+        if isinstance(node, _OPERATORS) and not isinstance(node, astnodes.Concat):
+            self.expr(node.left, scope)
+            self.expr(node.right, scope)
+        elif isinstance(node, _UNARY):
+            self.expr(node.operand, scope)
+        elif isinstance(node, astnodes.ULengthOP):
+            self.indexed(node.operand, scope)
+        elif isinstance(node, astnodes.Index):
+            if (isinstance(node.value, astnodes.Name) and node.value.id == 'math'
+                    and 'math' not in scope and _is_dot(node) and node.idx.id in _MATH_CONSTANTS):
+                return
+            self.indexed(node.value, scope)
+            if not _is_dot(node):
+                self.expr(node.idx, scope)
+        elif isinstance(node, astnodes.Call):
+            func = node.func
+            if isinstance(func, astnodes.Name) and func.id in self.pure and func.id not in scope:
+                self.work = True
+            elif not (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+                      and func.value.id == 'math' and 'math' not in scope and _is_dot(func)
+                      and func.idx.id in PURE_MATH):
+                raise _NotParallel()
+            for arg in node.args:
+                if isinstance(arg, astnodes.Varargs):
+                    raise _NotParallel()
+                self.expr(arg, scope)
+        else:
+            # strings, concatenation, constructors, functions, method calls...
+            raise _NotParallel()
+
+    def indexed(self, node: Any, scope: Set[str]) -> None:
+        """Only tables from outside the loop are read (their metatables are checked)"""
+        if not (isinstance(node, astnodes.Name) and self._outer(node.id, scope)):
+            raise _NotParallel()
+        self.uses.add(node.id)
+        if node.id not in self.info.read:
+            self.info.read.append(node.id)
+
+
+class ParallelAnalyzer:
+    """Marks the numeric for-loops that can run as l2c::parallel_for
+
+    A loop qualifies when its step is 1 and its iterations can't see each
+    other's effects:
+    - they assign only their own locals, accumulators `x = x + e` and
+      `t[i] = e` stores at the loop index;
+    - no iteration reads a table that one stores to;
+    - they call only math functions and pure functions: top-level local or
+      global functions with one binding that index nothing, see nothing but
+      their own locals and call only pure functions;
+    - no concatenation, strings, constructors or closures, which would
+      allocate, and no return or break out of the loop.
+    Only loops with enough work per iteration to pay for the threads are
+    chosen: a nested loop, or a call to a pure function. Only the outermost
+    loop of a nest is a candidate: a loop inside any other loop stays
+    serial, as starting the threads on every pass of the outer loop costs
+    more than its short runs gain.
+
+    Annotations:
+        Fornum: 'parallel_loop' -> ParallelLoop
+        Assign: 'parallel_store' -> True (a `t[i] = e` store)
+        Assign: 'parallel_reduction' -> index of its accumulator
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the loops that can run in parallel
+
+        Returns:
+            How many loops were marked
+        """
+        bindings: Dict[str, int] = {}
+        self._functions: Set[str] = set()
+        self._count_bindings(chunk, bindings)
+        functions = {}
+        aliases = set()
+        for stmt in _stmts(chunk.body):
+            if (isinstance(stmt, (astnodes.LocalFunction, astnodes.Function))
+                    and isinstance(stmt.name, astnodes.Name) and bindings.get(stmt.name.id) == 1
+                    and all(isinstance(arg, astnodes.Name) for arg in stmt.args)):
+                functions[stmt.name.id] = stmt
+            elif (isinstance(stmt, astnodes.LocalAssign) and len(stmt.targets) == 1
+                  and len(stmt.values) == 1 and bindings.get(stmt.targets[0].id) == 1):
+                # local sqrt = math.sqrt
+                value = stmt.values[0]
+                if (isinstance(value, astnodes.Index) and isinstance(value.value, astnodes.Name)
+                        and value.value.id == 'math' and _is_dot(value) and value.idx.id in PURE_MATH):
+                    aliases.add(stmt.targets[0].id)
+
+        # Greatest fixpoint, so recursive functions can be pure
+        self._pure = set(functions) | aliases
+        changed = True
+        while changed:
+            changed = False
+            for name in sorted(self._pure - aliases):
+                func = functions[name]
+                try:
+                    _BodyChecker(self._pure, set()).block(func.body, {a.id for a in func.args}, 0)
+                except _NotParallel:
+                    self._pure.discard(name)
+                    changed = True
+
+        self._loops = 0
+        self._in_loop = False
+        self._visit_block(chunk.body, set())
+        return self._loops
+
+    def _count_bindings(self, node: Any, bindings: Dict[str, int]) -> None:
+        def bind(target: Any) -> None:
+            if isinstance(target, astnodes.Name):
+                bindings[target.id] = bindings.get(target.id, 0) + 1
+
+        if isinstance(node, (astnodes.LocalAssign, astnodes.Assign)):
+            for target in node.targets:
+                bind(target)
+        elif isinstance(node, astnodes.Fornum):
+            bind(node.target)
+        elif isinstance(node, astnodes.Forin):
+            for target in node.targets:
+                bind(target)
+        elif isinstance(node, _FUNCTIONS):
+            for arg in node.args:
+                bind(arg)
+            if isinstance(node, (astnodes.LocalFunction, astnodes.Function)):
+                bind(node.name)
+                if isinstance(node.name, astnodes.Name):
+                    self._functions.add(node.name.id)
+        for child in _children(node):
+            self._count_bindings(child, bindings)
+
+    # ---- finding candidate loops, tracking the locals in scope ----
+
+    def _visit_block(self, block: Any, scope: Set[str]) -> None:
+        scope = set(scope)
+        for stmt in _stmts(block):
+            self._visit_stmt(stmt, scope)
+
+    def _visit_stmt(self, node: Any, scope: Set[str]) -> None:
+        if isinstance(node, astnodes.LocalAssign):
+            for value in node.values:
+                self._visit(value, scope)
+            scope.update(t.id for t in node.targets)
+        elif isinstance(node, astnodes.LocalFunction):
+            scope.add(node.name.id)
+            self._visit_function(node, scope)
+        elif isinstance(node, _FUNCTIONS + (astnodes.Method,)):
+            self._visit_function(node, scope)
+        elif isinstance(node, astnodes.Fornum):
+            for bound in (node.start, node.stop, node.step):
+                self._visit(bound, scope)
+            if self._in_loop or not self._mark(node, scope):
+                self._visit_loop(node.body, scope | {node.target.id})
+        elif isinstance(node, astnodes.Forin):
+            for value in node.iter:
+                self._visit(value, scope)
+            self._visit_loop(node.body, scope | {t.id for t in node.targets})
+        elif isinstance(node, astnodes.While):
+            self._visit(node.test, scope)
+            self._visit_loop(node.body, scope)
+        elif isinstance(node, astnodes.Repeat):
+            outer, self._in_loop = self._in_loop, True
+            inner = set(scope)
+            for stmt in _stmts(node.body):
+                self._visit_stmt(stmt, inner)
+            self._visit(node.test, inner)
+            self._in_loop = outer
+        else:
+            for child in _children(node):
+                if isinstance(child, astnodes.Block):
+                    self._visit_block(child, scope)
+                elif isinstance(child, (astnodes.If, astnodes.ElseIf)):
+                    self._visit_stmt(child, scope)
+                else:
+                    self._visit(child, scope)
+
+    def _visit_loop(self, body: Any, scope: Set[str]) -> None:
+        outer, self._in_loop = self._in_loop, True
+        self._visit_block(body, scope)
+        self._in_loop = outer
+
+    def _visit_function(self, node: Any, scope: Set[str]) -> None:
+        inner = scope | {a.id for a in node.args if isinstance(a, astnodes.Name)}
+        if isinstance(node, astnodes.Method):
+            inner.add('self')
+        # A function's loops are outermost within it
+        outer, self._in_loop = self._in_loop, False
+        self._visit_block(node.body, inner)
+        self._in_loop = outer
+
+    def _visit(self, node: Any, scope: Set[str]) -> None:
+        """Expressions: only the functions inside them hold loops"""
+        if isinstance(node, astnodes.AnonymousFunction):
+            self._visit_function(node, scope)
+        elif isinstance(node, astnodes.Node):
+            for child in _children(node):
+                self._visit(child, scope)
+
+    def _mark(self, loop: astnodes.Fornum, scope: Set[str]) -> bool:
+        if not (isinstance(loop.step, astnodes.Number) and loop.step.n == 1):
+            return False
+        counts: Dict[str, int] = {}
+        self._count_names(loop.body, counts)
+        # Function names aren't values a loop may read: naming one makes a closure
+        checker = _BodyChecker(self._pure, scope - self._functions - self._pure, loop.target.id, counts)
+        try:
+            checker.block(loop.body, set(), 0)
+        except _NotParallel:
+            self._clear(loop.body)
+            return False
+        info = checker.info
+        stored = set(info.written)
+        if not checker.work or stored & checker.uses or stored & set(info.reductions) \
+                or checker.uses & set(info.reductions):
+            self._clear(loop.body)
+            return False
+        info.outer = sorted(checker.uses)
+        ASTAnnotationStore.set_annotation(loop, 'parallel_loop', info)
+        self._loops += 1
+        return True
+
+    def _count_names(self, node: Any, counts: Dict[str, int]) -> None:
+        if isinstance(node, astnodes.Name):
+            counts[node.id] = counts.get(node.id, 0) + 1
+        for child in _children(node):
+            self._count_names(child, counts)
+
+    def _clear(self, node: Any) -> None:
+        """Drop the store and accumulator marks of a loop that stays serial"""
+        if isinstance(node, astnodes.Assign):
+            ASTAnnotationStore.set_annotation(node, 'parallel_store', None)
+            ASTAnnotationStore.set_annotation(node, 'parallel_reduction', None)
+        for child in _children(node):
+            self._clear(child)
@@ -0,0 +1,142 @@
+"""Record shape analyzer for Lua2C++ transpiler
+
+Detects record-like table constructors ({re = x, im = y}) whose key set
+is fixed, so the lua_table runtime can store their fields inline and
+generated field accesses become a shape check and a fixed-offset load.
+"""
+
+from typing import Dict, List, Optional, Set, Tuple
+from ..core.ast_visitor import ASTVisitor
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+Shape = Tuple[str, ...]
+
+
+def _is_dot_index(node: astnodes.Index) -> bool:
+    return str(getattr(node, 'notation', '')) == "IndexNotation.DOT" and isinstance(node.idx, astnodes.Name)
+
+
+class ShapeAnalyzer(ASTVisitor):
+    """Finds record shapes and binds `x.k` accesses to shape slots
+
+    A shape is the ordered key tuple of a constructor whose fields are all
+    distinct identifier keys (at most MAX_FIELDS, no metamethod names).
+    A shape is dropped when a name it is assigned to later receives a
+    field outside the shape or a computed-key store. Names are not
+    scope-resolved: accesses are guarded by the runtime shape check, so
+    a wrong guess only costs the generic lookup.
+
+    Annotations:
+        Table: 'record_shape' -> shape index
+        Index: 'shape_field' -> (shape index, slot)
+    """
+
+    MAX_FIELDS = 16
+
+    def __init__(self) -> None:
+        super().__init__()
+        self._shapes: List[Shape] = []
+        self._shape_ids: Dict[Shape, int] = {}
+        self._constructors: List[Tuple[astnodes.Table, int]] = []
+        self._bindings: Dict[str, Set[int]] = {}
+        self._field_stores: List[Tuple[str, Optional[str]]] = []
+        self._field_accesses: List[astnodes.Index] = []
+
+    def analyze(self, chunk: astnodes.Chunk) -> List[Shape]:
+        """Annotate record constructors and field accesses
+
+        Returns:
+            Shapes in index order (dropped shapes keep their index but
+            have no annotated constructors or accesses)
+        """
+        self.visit(chunk)
+
+        unstable: Set[int] = set()
+        for name, key in self._field_stores:
+            for shape_id in self._bindings.get(name, ()):
+                if key is None or key not in self._shapes[shape_id]:
+                    unstable.add(shape_id)
+
+        for table, shape_id in self._constructors:
+            if shape_id not in unstable:
+                ASTAnnotationStore.set_annotation(table, 'record_shape', shape_id)
+
+        stable = [i for i in range(len(self._shapes)) if i not in unstable]
+        for node in self._field_accesses:
+            shape_id = self._bind_access(node, stable)
+            if shape_id is not None:
+                slot = self._shapes[shape_id].index(node.idx.id)
+                ASTAnnotationStore.set_annotation(node, 'shape_field', (shape_id, slot))
+        return list(self._shapes)
+
+    def _bind_access(self, node: astnodes.Index, stable: List[int]) -> Optional[int]:
+        key = node.idx.id
+        candidates = [i for i in stable if key in self._shapes[i]]
+        if len(candidates) == 1:
+            return candidates[0]
+        if isinstance(node.value, astnodes.Name):
+            bound = [i for i in candidates if i in self._bindings.get(node.value.id, ())]
+            if len(bound) == 1:
+                return bound[0]
+        return None
+
+    def _record_shape(self, node: astnodes.Table) -> Optional[Shape]:
+        if not node.fields or len(node.fields) > self.MAX_FIELDS:
+            return None
+        keys = []
+        for field in node.fields:
+            if (field.key is None or getattr(field, 'between_brackets', False)
+                    or not isinstance(field.key, astnodes.Name)):
+                return None
+            if isinstance(field.value, astnodes.Varargs) or field.key.id.startswith("__"):
+                return None
+            keys.append(field.key.id)
+        if len(set(keys)) != len(keys):
+            return None
+        return tuple(keys)
+
+    def _shape_id(self, shape: Shape) -> int:
+        if shape not in self._shape_ids:
+            self._shape_ids[shape] = len(self._shapes)
+            self._shapes.append(shape)
+        return self._shape_ids[shape]
+
+    def visit_Table(self, node: astnodes.Table) -> None:
+        shape = self._record_shape(node)
+        if shape is not None:
+            self._constructors.append((node, self._shape_id(shape)))
+        self.generic_visit(node)
+
+    def _visit_assignment(self, node) -> None:
+        for i, target in enumerate(node.targets):
+            value = node.values[i] if i < len(node.values) else None
+            if isinstance(target, astnodes.Name) and isinstance(value, astnodes.Table):
+                shape = self._record_shape(value)
+                if shape is not None:
+                    self._bindings.setdefault(target.id, set()).add(self._shape_id(shape))
+            elif isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name):
+                if _is_dot_index(target):
+                    self._field_stores.append((target.value.id, target.idx.id))
+                elif isinstance(target.idx, astnodes.String):
+                    content = target.idx.s.decode() if isinstance(target.idx.s, bytes) else target.idx.s
+                    self._field_stores.append((target.value.id, content))
+                else:
+                    self._field_stores.append((target.value.id, None))
+        self.generic_visit(node)
+
+    def visit_Assign(self, node: astnodes.Assign) -> None:
+        self._visit_assignment(node)
+
+    def visit_LocalAssign(self, node: astnodes.LocalAssign) -> None:
+        self._visit_assignment(node)
+
+    def visit_Index(self, node: astnodes.Index) -> None:
+        if _is_dot_index(node):
+            self._field_accesses.append(node)
+        self.generic_visit(node)
@@ -0,0 +1,103 @@
+"""Tail call analyzer for Lua2C++ transpiler
+
+Finds the calls a local function makes to itself in tail position
+(`return f(...)`), so the lua_table runtime can compile them to a jump
+back to the top of the function with the parameters rebound, as Lua's
+proper tail calls run in constant stack.
+"""
+
+from typing import Any, List
+from ..core.types import ASTAnnotationStore
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+_FUNCTIONS = (astnodes.Function, astnodes.LocalFunction, astnodes.Method, astnodes.AnonymousFunction)
+
+
+def _children(node: Any) -> List[Any]:
+    children = []
+    for attr in dir(node):
+        if attr.startswith('_'):
+            continue
+        child = getattr(node, attr, None)
+        if isinstance(child, astnodes.Node):
+            children.append(child)
+        elif isinstance(child, list):
+            children.extend(c for c in child if isinstance(c, astnodes.Node))
+    return children
+
+
+def _descendants(node: Any) -> List[Any]:
+    found = []
+    stack = _children(node)
+    while stack:
+        child = stack.pop()
+        found.append(child)
+        stack.extend(_children(child))
+    return found
+
+
+class TailCallAnalyzer:
+    """Marks the self tail calls of local functions
+
+    A self tail call is `return f(a, b, ...)` in the body of
+    `local function f(x, y, ...)`, passing one argument per parameter.
+    The function must have no `...`, contain no nested function (a
+    closure could see a parameter the jump rebinds) and never have its
+    name rebound, by assignment or a nested declaration.
+
+    Annotations:
+        LocalFunction: 'self_tail_calls' -> number of self tail calls
+        Return: 'self_tail_call' -> True
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the self tail calls of every local function
+
+        Returns:
+            Number of self tail calls found
+        """
+        nodes = _descendants(chunk)
+        assigned = {target.id for node in nodes if isinstance(node, astnodes.Assign)
+                    for target in node.targets if isinstance(target, astnodes.Name)}
+        found = 0
+        for node in nodes:
+            if isinstance(node, astnodes.LocalFunction) and node.name.id not in assigned:
+                found += self._analyze_function(node)
+        return found
+
+    def _analyze_function(self, func: astnodes.LocalFunction) -> int:
+        name = func.name.id
+        if any(not isinstance(arg, astnodes.Name) or arg.id == name for arg in func.args):
+            return 0
+        body = _descendants(func.body)
+        returns = []
+        for node in body:
+            if isinstance(node, _FUNCTIONS):
+                return 0
+            if isinstance(node, astnodes.LocalAssign) and any(t.id == name for t in node.targets):
+                return 0
+            if isinstance(node, astnodes.Fornum) and node.target.id == name:
+                return 0
+            if isinstance(node, astnodes.Forin) and any(t.id == name for t in node.targets):
+                return 0
+            if isinstance(node, astnodes.Return) and self._is_self_call(node, name, len(func.args)):
+                returns.append(node)
+        for node in returns:
+            ASTAnnotationStore.set_annotation(node, 'self_tail_call', True)
+        if returns:
+            ASTAnnotationStore.set_annotation(func, 'self_tail_calls', len(returns))
+        return len(returns)
+
+    @staticmethod
+    def _is_self_call(node: astnodes.Return, name: str, arity: int) -> bool:
+        if len(node.values) != 1:
+            return False
+        call = node.values[0]
+        return (isinstance(call, astnodes.Call) and isinstance(call.func, astnodes.Name)
+                and call.func.id == name and len(call.args) == arity
+                and not any(isinstance(arg, astnodes.Varargs) for arg in call.args))
@@ -0,0 +1,127 @@
+"""Type-feedback profiles for profile-guided transpilation
+
+`lua2cpp --instrument` emits code that counts the calls of every named
+function and records which Lua types each argument and returned value
+had (tests/cpp/runtime/lua_profile.hpp). Running the instrumented build
+writes that as JSON; `--profile FILE` loads it back so TypeResolver can
+pick concrete signatures for the hot functions.
+
+Format:
+    {"version": 1, "functions": [
+        {"module": "mandel", "name": "level", "line": 12, "calls": 4096,
+         "params": [["number"], ["number", "table"]], "returns": ["number"]}]}
+
+A function is identified by its C++ name (`T_m` for `function T.m`) and
+the line of its definition, so edits that move a function only lose
+its line match while the name stays unique in the module.
+"""
+
+import json
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Set
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+# Calls a function needs in the profile before it is specialized
+HOT_CALL_THRESHOLD = 1000
+
+PROFILE_VERSION = 1
+
+
+@dataclass
+class FunctionProfile:
+    """Observed behaviour of one function definition
+
+    Attributes:
+        name: C++ function name
+        line: Line of the definition (0 if unknown)
+        calls: Number of calls
+        params: Lua type names seen per parameter
+        returns: Lua type names of the single values returned
+    """
+    name: str
+    line: int
+    calls: int
+    params: List[Set[str]] = field(default_factory=list)
+    returns: Set[str] = field(default_factory=set)
+
+    def is_hot(self, threshold: int = HOT_CALL_THRESHOLD) -> bool:
+        return self.calls >= threshold
+
+
+class TypeProfile:
+    """Function profiles of one run, indexed by module"""
+
+    def __init__(self) -> None:
+        self._functions: Dict[str, List[FunctionProfile]] = {}
+
+    @classmethod
+    def load(cls, path: Path) -> 'TypeProfile':
+        """Read a profile written by an instrumented build
+
+        Raises:
+            OSError: If the file can't be read
+            ValueError: If it is not a version 1 profile
+        """
+        with open(path, 'r', encoding='utf-8') as f:
+            try:
+                data = json.load(f)
+            except json.JSONDecodeError as e:
+                raise ValueError(f"{path}: not a profile: {e}")
+        if not isinstance(data, dict) or data.get("version") != PROFILE_VERSION:
+            raise ValueError(f"{path}: unsupported profile version {data.get('version') if isinstance(data, dict) else None}")
+        profile = cls()
+        for entry in data.get("functions", []):
+            profile.add(entry.get("module", ""), FunctionProfile(
+                name=entry["name"],
+                line=int(entry.get("line", 0)),
+                calls=int(entry.get("calls", 0)),
+                params=[set(types) for types in entry.get("params", [])],
+                returns=set(entry.get("returns", [])),
+            ))
+        return profile
+
+    def add(self, module: str, function: FunctionProfile) -> None:
+        """Add a function's profile, merging it with one for the same definition"""
+        entries = self._functions.setdefault(module, [])
+        for existing in entries:
+            if existing.name == function.name and existing.line == function.line:
+                existing.calls += function.calls
+                for i, types in enumerate(function.params):
+                    if i < len(existing.params):
+                        existing.params[i] |= types
+                    else:
+                        existing.params.append(set(types))
+                existing.returns |= function.returns
+                return
+        entries.append(function)
+
+    def lookup(self, module: str, name: str, line: int) -> Optional[FunctionProfile]:
+        """The profile of a definition: matched by name and line, or by name alone if unique"""
+        candidates = [f for f in self._functions.get(module, []) if f.name == name]
+        for candidate in candidates:
+            if candidate.line == line:
+                return candidate
+        return candidates[0] if len(candidates) == 1 else None
+
+
+def function_profile_name(node: Any) -> Optional[str]:
+    """The C++ name a Function/LocalFunction definition is profiled under"""
+    if isinstance(node, astnodes.LocalFunction) and isinstance(node.name, astnodes.Name):
+        return node.name.id
+    if isinstance(node, astnodes.Function):
+        if isinstance(node.name, astnodes.Name):
+            return node.name.id
+        if isinstance(node.name, astnodes.Index) and isinstance(node.name.value, astnodes.Name) \
+                and isinstance(node.name.idx, astnodes.Name):
+            return f"{node.name.value.id}_{node.name.idx.id}"
+    return None
+
+
+def function_line(node: Any) -> int:
+    return getattr(node, 'line', None) or 0
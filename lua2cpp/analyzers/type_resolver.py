@@ -5,23 +5,30 @@ function boundaries using bidirectional analysis.
 
 Structure:
 - Pass 1: Collect function signatures
-- Pass 2: Local type inference within functions
-- Pass 3: Iterative inter-procedural type propagation
+- Pass 2: Local type inference within functions, number-only table hints
+- Pass 3: Inter-procedural type propagation over a worklist of functions,
+  then concrete signatures for local functions whose call sites settle
+  their types
 - Pass 4: Validation and finalization
+- Pass 5: Profile feedback (only with a --profile type profile)
 
 Design Principles:
 - Bidirectional propagation (arguments ↔ parameters)
 - ANY/VARIANT types for conflicting type information
-- Iterative fixed-point algorithm
+- Worklist fixed point: only functions whose inputs changed are revisited
 - Comprehensive call graph tracking
 """
 
-from typing import Dict, Optional
+import heapq
+import time
+from typing import Any, Callable, Dict, List, Optional, Set, Tuple
 from luaparser import astnodes
 
 from ..core.scope import ScopeManager
 from ..core.symbol_table import SymbolTable
-from ..core.types import Type, TypeKind, ASTAnnotationStore
+from ..core.types import Type, TypeKind, ASTAnnotationStore, is_wide_integer
+from .function_registry import FunctionSignature
+from .type_profile import TypeProfile, function_profile_name, function_line
 
 
 class TypeResolver:
@@ -35,7 +42,9 @@ class TypeResolver:
         self,
         scope_manager: ScopeManager,
         symbol_table: SymbolTable,
-        function_registry: 'FunctionSignatureRegistry'
+        function_registry: 'FunctionSignatureRegistry',
+        profile: Optional[TypeProfile] = None,
+        module_name: str = ""
     ) -> None:
         """Initialize type resolver
 
@@ -43,14 +52,32 @@ class TypeResolver:
             scope_manager: Scope manager for tracking variable scoping
             symbol_table: Symbol table for variable resolution
             function_registry: Function signature registry for inter-procedural analysis
+            profile: Optional type profile from an instrumented run
+            module_name: Module the profile entries are looked up under
         """
         self.scope_manager = scope_manager
         self.symbol_table = symbol_table
         self.function_registry = function_registry
+        self.profile = profile
+        self.module_name = module_name
 
         self._current_function: Optional[str] = None
+        # Visits of one function in the propagation worklist before its
+        # parameters are left as they are
         self._max_iterations: int = 10
         self.inferred_types: Dict[str, Type] = {}
+        # (pass, seconds) of the last resolve_chunk, and what propagation did
+        self.pass_times: List[Tuple[str, float]] = []
+        self.propagation_stats: Dict[str, int] = {}
+
+        # Chunk-wide facts gathered with the call sites (see _collect_call_sites)
+        self._defined_at: Dict[str, int] = {}
+        self._local_functions: Dict[str, astnodes.LocalFunction] = {}
+        self._call_nodes: Dict[str, List[astnodes.Call]] = {}
+        self._bindings: Dict[str, List[Tuple[str, Any]]] = {}
+        self._assigned: Set[str] = set()
+        self._escaping: Set[str] = set()
+        self._references: Dict[str, Set[str]] = {}
 
     def resolve_chunk(self, chunk: astnodes.Chunk) -> None:
         """Perform multi-pass type resolution on entire chunk
@@ -64,10 +91,19 @@ class TypeResolver:
         Args:
             chunk: AST chunk to analyze
         """
-        self._collect_function_signatures(chunk)
-        self._infer_local_types(chunk)
-        self._propagate_types_interprocedurally()
-        self._validate_and_finalize()
+        self.pass_times = []
+        self._timed("signatures", lambda: self._collect_function_signatures(chunk))
+        self._timed("local types", lambda: self._infer_local_types(chunk))
+        self._timed("number arrays", lambda: self._infer_number_arrays(chunk))
+        self._timed("propagation", self._propagate_types_interprocedurally)
+        self._timed("validation", self._validate_and_finalize)
+        if self.profile is not None:
+            self._timed("profile feedback", lambda: self._apply_profile_feedback(chunk))
+
+    def _timed(self, name: str, run: Callable[[], None]) -> None:
+        start = time.perf_counter()
+        run()
+        self.pass_times.append((name, time.perf_counter() - start))
 
     def _collect_function_signatures(self, chunk: astnodes.Chunk) -> None:
         """Pass 1: Collect all function definitions
@@ -86,6 +122,104 @@ class TypeResolver:
                 self.function_registry.register_function(
                     func_name, param_names, is_local=True
                 )
+        self._collect_call_sites(chunk)
+
+    def _collect_call_sites(self, chunk: astnodes.Chunk) -> None:
+        """Pass 1b: Record the calls of top-level local functions
+
+        Also gathers what concrete signatures depend on. Names are not
+        scope-resolved, so everything is counted chunk-wide: the bindings
+        of each name (locals, parameters, loop variables, local
+        functions), the names ever assigned, the names used other than as
+        a callee, and the names each top-level local function refers to.
+
+        Args:
+            chunk: AST chunk to analyze
+        """
+        body = chunk.body.body if isinstance(chunk.body.body, list) else [chunk.body.body]
+        for index, stmt in enumerate(body):
+            if isinstance(stmt, (astnodes.LocalFunction, astnodes.Function)) and isinstance(stmt.name, astnodes.Name):
+                self._defined_at.setdefault(stmt.name.id, index)
+                if isinstance(stmt, astnodes.LocalFunction):
+                    self._local_functions.setdefault(stmt.name.id, stmt)
+
+        def bind(target, kind: str, value: Any = None) -> None:
+            if isinstance(target, astnodes.Name):
+                self._bindings.setdefault(target.id, []).append((kind, value))
+
+        def refer(name: str, owner: Optional[str]) -> None:
+            if owner is not None:
+                self._references[owner].add(name)
+
+        def walk(node, owner: Optional[str]) -> None:
+            if isinstance(node, list):
+                for item in node:
+                    walk(item, owner)
+                return
+            if not isinstance(node, astnodes.Node):
+                return
+            if isinstance(node, astnodes.Name):
+                self._escaping.add(node.id)
+                refer(node.id, owner)
+            elif isinstance(node, astnodes.LocalAssign):
+                values = node.values or []
+                for i, target in enumerate(node.targets):
+                    bind(target, 'local', values[i] if i < len(values) else None)
+                walk(values, owner)
+            elif isinstance(node, astnodes.Assign):
+                for target in node.targets:
+                    if isinstance(target, astnodes.Name):
+                        self._assigned.add(target.id)
+                        refer(target.id, owner)
+                    else:
+                        walk(target, owner)
+                walk(node.values, owner)
+            elif isinstance(node, astnodes.Fornum):
+                bind(node.target, 'loop')
+                walk([node.start, node.stop, node.step, node.body], owner)
+            elif isinstance(node, astnodes.Forin):
+                for target in node.targets:
+                    bind(target, 'other')
+                walk([node.iter, node.body], owner)
+            elif isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)):
+                for arg in node.args:
+                    bind(arg, 'param', node)
+                if isinstance(node, astnodes.LocalFunction):
+                    bind(node.name, 'function', node)
+                elif isinstance(node, astnodes.Function):
+                    if isinstance(node.name, astnodes.Name):
+                        self._assigned.add(node.name.id)
+                    else:
+                        walk(node.name, owner)
+                if owner is None and isinstance(node, astnodes.LocalFunction) \
+                        and self._local_functions.get(node.name.id) is node:
+                    owner = node.name.id
+                    self._references[owner] = set()
+                walk(node.body, owner)
+            elif isinstance(node, astnodes.Call) and isinstance(node.func, astnodes.Name):
+                callee = node.func.id
+                refer(callee, owner)
+                if callee in self._local_functions:
+                    self._call_nodes.setdefault(callee, []).append(node)
+                    self.function_registry.record_call_site(
+                        owner or "<chunk>", callee,
+                        [a.id if isinstance(a, astnodes.Name) else None for a in node.args],
+                        line=getattr(node, 'line', None))
+                walk(node.args, owner)
+            elif isinstance(node, astnodes.Index) and str(getattr(node, 'notation', '')) == "IndexNotation.DOT":
+                walk(node.value, owner)
+            elif isinstance(node, astnodes.Invoke):
+                walk([node.source, node.args], owner)
+            elif isinstance(node, astnodes.Field) and not getattr(node, 'between_brackets', False):
+                walk(node.value, owner)
+            else:
+                for attr in dir(node):
+                    if not attr.startswith('_'):
+                        child = getattr(node, attr, None)
+                        if isinstance(child, (astnodes.Node, list)):
+                            walk(child, owner)
+
+        walk(body, None)
 
     def _infer_local_types(self, chunk: astnodes.Chunk) -> None:
         """Pass 2: Infer types within function bodies
@@ -99,32 +233,226 @@ class TypeResolver:
         for stmt in chunk.body.body:
             self._infer_statement(stmt)
 
+    # math library functions that always return a number
+    _NUMBER_FUNCTIONS = frozenset({
+        'abs', 'acos', 'asin', 'atan', 'ceil', 'cos', 'exp', 'floor', 'fmod',
+        'log', 'max', 'min', 'random', 'sin', 'sqrt', 'tan',
+    })
+
+    def _infer_number_arrays(self, chunk: astnodes.Chunk) -> None:
+        """Pass 2b: Mark table constructors of tables that only hold numbers
+
+        A name qualifies when every value it is assigned is a table
+        constructor, no field is stored by name, and every `t[k] = v` stores
+        a numeric expression. Numeric scalars are solved together with the
+        tables (`v[i] = sum` where `sum = sum + u[j]`), starting optimistic
+        and dropping names until a fixed point. Names are not scope-resolved:
+        the result is a hint, and number-only tables fall back to generic
+        storage on the first store of anything else.
+
+        Marked constructors carry the 'number_array' annotation.
+        """
+        ctors: Dict[str, List[astnodes.Table]] = {}
+        values: Dict[str, List[Optional[astnodes.Node]]] = {}
+        stores: Dict[str, List[astnodes.Node]] = {}
+        loop_vars: Set[str] = set()
+        blocked: Set[str] = set()
+
+        def record_assign(targets, assigned) -> None:
+            for i, target in enumerate(targets):
+                value = assigned[i] if i < len(assigned) else None
+                if isinstance(target, astnodes.Name):
+                    if isinstance(value, astnodes.Table):
+                        ctors.setdefault(target.id, []).append(value)
+                    else:
+                        values.setdefault(target.id, []).append(value)
+                elif isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name):
+                    is_dot = str(getattr(target, 'notation', '')) == "IndexNotation.DOT"
+                    if is_dot or isinstance(target.idx, astnodes.String):
+                        blocked.add(target.value.id)
+                    else:
+                        stores.setdefault(target.value.id, []).append(value)
+
+        def walk(node) -> None:
+            if isinstance(node, list):
+                for item in node:
+                    walk(item)
+                return
+            if not isinstance(node, astnodes.Node):
+                return
+            if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                record_assign(node.targets, node.values or [])
+            elif isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)):
+                blocked.update(a.id for a in node.args if isinstance(a, astnodes.Name))
+            elif isinstance(node, astnodes.Forin):
+                blocked.update(t.id for t in node.targets if isinstance(t, astnodes.Name))
+            elif isinstance(node, astnodes.Fornum):
+                loop_vars.add(node.target.id)
+            for attr in dir(node):
+                if not attr.startswith('_'):
+                    child = getattr(node, attr, None)
+                    if isinstance(child, (astnodes.Node, list)):
+                        walk(child)
+
+        walk(chunk.body)
+
+        numbers = ((set(values) | loop_vars) - blocked) - set(ctors)
+        arrays = {name for name in ctors
+                  if name not in blocked and name not in values and name not in loop_vars
+                  and all(f.key is None for t in ctors[name] for f in t.fields)
+                  and (name in stores or any(t.fields for t in ctors[name]))}
+
+        def is_number(expr) -> bool:
+            if is_wide_integer(expr):
+                return False
+            if isinstance(expr, astnodes.Number):
+                return True
+            if isinstance(expr, astnodes.Name):
+                return expr.id in numbers
+            if isinstance(expr, astnodes.Index):
+                return isinstance(expr.value, astnodes.Name) and expr.value.id in arrays
+            if isinstance(expr, (astnodes.UMinusOp, astnodes.UBNotOp, astnodes.ULengthOP)):
+                return isinstance(expr, astnodes.ULengthOP) or is_number(expr.operand)
+            if isinstance(expr, self._ARITHMETIC_OPS):
+                return is_number(expr.left) and is_number(expr.right)
+            if isinstance(expr, astnodes.Call) and isinstance(expr.func, astnodes.Index):
+                func = expr.func
+                return (isinstance(func.value, astnodes.Name) and func.value.id == 'math'
+                        and isinstance(func.idx, astnodes.Name) and func.idx.id in self._NUMBER_FUNCTIONS)
+            return False
+
+        changed = True
+        while changed:
+            changed = False
+            for name in list(numbers):
+                if not all(is_number(v) for v in values.get(name, [])):
+                    numbers.discard(name)
+                    changed = True
+            for name in list(arrays):
+                fields_ok = all(is_number(f.value) for t in ctors[name] for f in t.fields)
+                if not fields_ok or not all(is_number(v) for v in stores.get(name, [])):
+                    arrays.discard(name)
+                    changed = True
+
+        for name in arrays:
+            for table in ctors[name]:
+                ASTAnnotationStore.set_annotation(table, 'number_array', True)
+
     def _propagate_types_interprocedurally(self) -> None:
-        """Pass 3: Iterative type propagation until fixed point
+        """Pass 3: Worklist type propagation until fixed point
 
         Performs bidirectional type propagation:
         - Arguments → Parameters: Types from call sites propagate to function params
         - Parameters → Arguments: Parameter types propagate back to arguments
 
-        Uses iterative fixed-point algorithm to handle cyclic dependencies.
-        Stops when no changes occur or max iterations reached.
+        Functions are visited callers first, by the strongly connected
+        components of the call graph, so the argument types of most calls
+        are final before their callee is visited. A visit recomputes the
+        function's parameters from its call sites; when that types an
+        argument for the first time, the functions it is also passed to
+        go back on the worklist, and nothing else is revisited. Since
+        merges only widen, that terminates; _max_iterations bounds the
+        visits to any one function all the same.
 
         Conflict Resolution:
         - Conflicting types are merged into ANY/VARIANT types
         - Most specific types are preferred (NUMBER > TABLE > UNKNOWN)
         """
-        changed = True
-        iteration = 0
-
-        while changed and iteration < self._max_iterations:
-            changed = False
-            iteration += 1
-
-            changed |= self._propagate_args_to_params()
-            changed |= self._propagate_params_to_args()
-
-            if not changed and iteration < self._max_iterations:
-                break
+        signatures = self.function_registry.signatures
+        components = self._call_graph_components()
+        rank = {name: (order, position)
+                for order, component in enumerate(components)
+                for position, name in enumerate(component)}
+
+        # Argument symbol -> functions it is passed to
+        receivers: Dict[str, Set[str]] = {}
+        for func_name, signature in signatures.items():
+            for call_site in signature.call_sites:
+                for arg_symbol_name in call_site.arg_symbols:
+                    if arg_symbol_name:
+                        receivers.setdefault(arg_symbol_name, set()).add(func_name)
+
+        worklist = [(rank[name], name) for name in signatures]
+        heapq.heapify(worklist)
+        queued = set(signatures)
+        visits: Dict[str, int] = {}
+        while worklist:
+            _, func_name = heapq.heappop(worklist)
+            queued.discard(func_name)
+            visits[func_name] = visits.get(func_name, 0) + 1
+            signature = signatures[func_name]
+            self._args_to_params(func_name, signature)
+            for symbol in self._params_to_args(func_name, signature):
+                for receiver in receivers.get(symbol, ()):
+                    if receiver not in queued and visits.get(receiver, 0) < self._max_iterations:
+                        queued.add(receiver)
+                        heapq.heappush(worklist, (rank[receiver], receiver))
+
+        self.propagation_stats = {
+            "functions": len(signatures),
+            "components": len(components),
+            "visits": sum(visits.values()),
+        }
+        self._settle_concrete_signatures()
+
+    def _call_graph_components(self) -> List[List[str]]:
+        """Strongly connected components of the call graph, callers first
+
+        Tarjan's algorithm, iteratively so deep call chains don't hit the
+        recursion limit. Functions keep registry order within a component
+        and where the graph leaves the order open. Callers that aren't
+        registered functions (the chunk, nested functions) are left out.
+        """
+        signatures = self.function_registry.signatures
+        callees: Dict[str, List[str]] = {name: [] for name in signatures}
+        for func_name, signature in signatures.items():
+            for call_site in signature.call_sites:
+                caller = call_site.caller_name
+                if caller in callees and func_name not in callees[caller]:
+                    callees[caller].append(func_name)
+
+        index: Dict[str, int] = {}
+        lowlink: Dict[str, int] = {}
+        stack: List[str] = []
+        on_stack: Set[str] = set()
+        components: List[List[str]] = []
+        for root in reversed(list(signatures)):
+            if root in index:
+                continue
+            work = [(root, 0)]
+            while work:
+                node, child = work.pop()
+                if child == 0:
+                    index[node] = lowlink[node] = len(index)
+                    stack.append(node)
+                    on_stack.add(node)
+                if child < len(callees[node]):
+                    work.append((node, child + 1))
+                    callee = callees[node][child]
+                    if callee not in index:
+                        work.append((callee, 0))
+                    elif callee in on_stack:
+                        lowlink[node] = min(lowlink[node], index[callee])
+                    continue
+                if lowlink[node] == index[node]:
+                    component = []
+                    while True:
+                        member = stack.pop()
+                        on_stack.discard(member)
+                        component.append(member)
+                        if member == node:
+                            break
+                    components.append(component)
+                if work:
+                    parent = work[-1][0]
+                    lowlink[parent] = min(lowlink[parent], lowlink[node])
+
+        # Tarjan emits callees first
+        order = {name: position for position, name in enumerate(signatures)}
+        components.reverse()
+        for component in components:
+            component.sort(key=order.__getitem__)
+        return components
 
     def _propagate_args_to_params(self) -> bool:
         """Propagate types from arguments to parameters
@@ -138,52 +466,61 @@ class TypeResolver:
             True if any changes were made, False otherwise
         """
         changed = False
+        for func_name, signature in self.function_registry.signatures.items():
+            changed |= self._args_to_params(func_name, signature)
+        return changed
+
+    def _args_to_params(self, func_name: str, signature: FunctionSignature) -> bool:
+        """Merge the argument types at one function's call sites into its parameters
+
+        Returns:
+            True if any parameter changed, False otherwise
+        """
+        changed = False
         from ..core.types import TableTypeInfo
 
-        for func_name, signature in self.function_registry.signatures.items():
-            for call_site in signature.call_sites:
-                # For each argument at this call site
-                for arg_idx, arg_symbol_name in enumerate(call_site.arg_symbols):
-                    if not arg_symbol_name:
-                        # Argument is not a simple name (e.g., expression)
-                        continue
-
-                    # Get argument's type
-                    arg_type = self.inferred_types.get(arg_symbol_name)
-                    if not arg_type:
-                        # Argument has no type info yet
-                        continue
-
-                    # Get parameter's current table info
-                    param_table_info = self.function_registry.get_param_table_info(
-                        func_name, arg_idx
-                    )
+        for call_site in signature.call_sites:
+            # For each argument at this call site
+            for arg_idx, arg_symbol_name in enumerate(call_site.arg_symbols):
+                if not arg_symbol_name:
+                    # Argument is not a simple name (e.g., expression)
+                    continue
 
-                    if not param_table_info:
-                        # Initialize parameter table info from argument
-                        # Store argument type as value_type in param table info
-                        new_table_info = TableTypeInfo(
-                            is_array=True,  # Default to array for now
-                            value_type=arg_type
-                        )
-                        self.function_registry.update_param_table_info(
-                            func_name, arg_idx, new_table_info
+                # Get argument's type
+                arg_type = self.inferred_types.get(arg_symbol_name)
+                if not arg_type:
+                    # Argument has no type info yet
+                    continue
+
+                # Get parameter's current table info
+                param_table_info = self.function_registry.get_param_table_info(
+                    func_name, arg_idx
+                )
+
+                if not param_table_info:
+                    # Initialize parameter table info from argument
+                    # Store argument type as value_type in param table info
+                    new_table_info = TableTypeInfo(
+                        is_array=True,  # Default to array for now
+                        value_type=arg_type
+                    )
+                    changed |= self.function_registry.update_param_table_info(
+                        func_name, arg_idx, new_table_info
+                    )
+                else:
+                    # Merge table info (handle conflicts)
+                    if param_table_info.value_type:
+                        # Merge argument type with parameter type
+                        merged_type = self._merge_types(
+                            param_table_info.value_type, arg_type
                         )
-                        changed = True
-                    else:
-                        # Merge table info (handle conflicts)
-                        if param_table_info.value_type:
-                            # Merge argument type with parameter type
-                            merged_type = self._merge_types(
-                                param_table_info.value_type, arg_type
-                            )
-                            if merged_type != param_table_info.value_type:
-                                param_table_info.value_type = merged_type
-                                changed = True
-                        else:
-                            # Set argument type as parameter value type
-                            param_table_info.value_type = arg_type
+                        if merged_type != param_table_info.value_type:
+                            param_table_info.value_type = merged_type
                             changed = True
+                    else:
+                        # Set argument type as parameter value type
+                        param_table_info.value_type = arg_type
+                        changed = True
 
         return changed
 
@@ -199,39 +536,147 @@ class TypeResolver:
             True if any changes were made, False otherwise
         """
         changed = False
-
         for func_name, signature in self.function_registry.signatures.items():
-            for param_idx, param_name in enumerate(signature.param_names):
-                # Get parameter's table info
-                param_table_info = self.function_registry.get_param_table_info(
-                    func_name, param_idx
-                )
-                if not param_table_info or not param_table_info.value_type:
-                    # Parameter has no type info or value_type is not set
-                    continue
-
-                # Propagate to all call sites
-                for call_site in signature.call_sites:
-                    arg_symbol_name = call_site.get_arg_symbol(param_idx)
-                    if not arg_symbol_name:
-                        # Argument is not a simple name
-                        continue
+            if self._params_to_args(func_name, signature):
+                changed = True
+        return changed
 
-                    # Get argument's current type
-                    arg_type = self.inferred_types.get(arg_symbol_name)
+    def _params_to_args(self, func_name: str, signature: FunctionSignature) -> List[str]:
+        """Type the untyped arguments at one function's call sites from its parameters
 
-                    if not arg_type:
-                        # Initialize argument type from parameter
-                        self.inferred_types[arg_symbol_name] = param_table_info.value_type
-                        changed = True
-                    else:
-                        # Merge argument type with parameter type
-                        merged_type = self._merge_types(arg_type, param_table_info.value_type)
-                        if merged_type != arg_type:
-                            self.inferred_types[arg_symbol_name] = merged_type
-                            changed = True
+        Returns:
+            The argument symbols typed for the first time
+        """
+        typed = []
+
+        for param_idx, param_name in enumerate(signature.param_names):
+            # Get parameter's table info
+            param_table_info = self.function_registry.get_param_table_info(
+                func_name, param_idx
+            )
+            if not param_table_info or not param_table_info.value_type:
+                # Parameter has no type info or value_type is not set
+                continue
+
+            # Propagate to all call sites
+            for call_site in signature.call_sites:
+                arg_symbol_name = call_site.get_arg_symbol(param_idx)
+                if not arg_symbol_name:
+                    # Argument is not a simple name
+                    continue
 
-        return changed
+                # Get argument's current type
+                arg_type = self.inferred_types.get(arg_symbol_name)
+
+                # Only names with no inference of their own: the parameter's
+                # type may come from another caller's argument, which says
+                # nothing about this one
+                if not arg_type:
+                    # Initialize argument type from parameter
+                    self.inferred_types[arg_symbol_name] = param_table_info.value_type
+                    typed.append(arg_symbol_name)
+
+        return typed
+
+    # Arithmetic whose result is a number when both operands are
+    _ARITHMETIC_OPS = (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp, astnodes.FloatDivOp,
+                       astnodes.FloorDivOp, astnodes.ModOp, astnodes.ExpoOp, astnodes.BitOp)
+
+    def _settle_concrete_signatures(self) -> None:
+        """Give local functions with settled call sites a non-template signature
+
+        A top-level local function qualifies when its name is bound once,
+        never assigned and only ever called, every call passes exactly its
+        parameters, and every function it refers to is defined before it
+        (a non-template body can't rely on lookup at instantiation). A
+        parameter is `double` when it is never assigned and every argument
+        passed to it is provably a number, else `TValue`. That is solved
+        optimistically to a fixed point, since the arguments are often the
+        callers' own numeric parameters; dropping one re-checks only the
+        parameters whose arguments relied on it. Functions that don't qualify are
+        genuinely polymorphic and stay templates.
+
+        Annotations:
+            LocalFunction: 'concrete_params' -> C++ type per parameter
+            Call argument: 'box_arg' -> True where it is passed as TValue
+        """
+        candidates: Dict[str, astnodes.LocalFunction] = {}
+        for name, node in self._local_functions.items():
+            calls = self._call_nodes.get(name, [])
+            if not node.args or not calls or any(isinstance(a, astnodes.Varargs) for a in node.args):
+                continue
+            if len(self._bindings.get(name, [])) != 1 or name in self._assigned or name in self._escaping:
+                continue
+            if any(len(c.args) != len(node.args) or any(isinstance(a, astnodes.Varargs) for a in c.args)
+                   for c in calls):
+                continue
+            position = self._defined_at[name]
+            if any(self._defined_at.get(ref, -1) > position for ref in self._references.get(name, ())):
+                continue
+            candidates[name] = node
+
+        doubles = {(name, arg.id) for name, node in candidates.items() for arg in node.args
+                   if arg.id not in self._assigned and len(self._bindings.get(arg.id, [])) == 1}
+
+        # consulted collects the double parameters an answer relies on
+        def name_is_number(name: str, visiting: Set[str], consulted: Set[Tuple[str, str]]) -> bool:
+            bindings = self._bindings.get(name, [])
+            if name in visiting or len(bindings) != 1 or name in self._assigned:
+                return False
+            kind, value = bindings[0]
+            if kind == 'loop':
+                return True
+            if kind == 'local':
+                return value is not None and is_number(value, visiting | {name}, consulted)
+            if kind == 'param' and isinstance(value, astnodes.LocalFunction):
+                if candidates.get(value.name.id) is not value or (value.name.id, name) not in doubles:
+                    return False
+                consulted.add((value.name.id, name))
+                return True
+            return False
+
+        def is_number(expr, visiting: Set[str], consulted: Set[Tuple[str, str]]) -> bool:
+            if is_wide_integer(expr):
+                return False
+            if isinstance(expr, astnodes.Number) or isinstance(expr, astnodes.ULengthOP):
+                return True
+            if isinstance(expr, astnodes.Name):
+                return name_is_number(expr.id, visiting, consulted)
+            if isinstance(expr, (astnodes.UMinusOp, astnodes.UBNotOp)):
+                return is_number(expr.operand, visiting, consulted)
+            if isinstance(expr, self._ARITHMETIC_OPS):
+                return is_number(expr.left, visiting, consulted) and is_number(expr.right, visiting, consulted)
+            if isinstance(expr, astnodes.Call) and isinstance(expr.func, astnodes.Index):
+                func = expr.func
+                return (isinstance(func.value, astnodes.Name) and func.value.id == 'math'
+                        and isinstance(func.idx, astnodes.Name) and func.idx.id in self._NUMBER_FUNCTIONS)
+            return False
+
+        # Parameter -> the parameters whose arguments were numbers through it
+        dependents: Dict[Tuple[str, str], Set[Tuple[str, str]]] = {}
+        pending = sorted(doubles)
+        while pending:
+            double = pending.pop()
+            if double not in doubles:
+                continue
+            name, param = double
+            index = [a.id for a in candidates[name].args].index(param)
+            consulted: Set[Tuple[str, str]] = set()
+            if all(is_number(call.args[index], set(), consulted) for call in self._call_nodes[name]):
+                for source in consulted:
+                    dependents.setdefault(source, set()).add(double)
+            else:
+                doubles.discard(double)
+                pending.extend(dependents.pop(double, ()))
+
+        for name, node in candidates.items():
+            param_types = ["double" if (name, arg.id) in doubles else "TValue" for arg in node.args]
+            ASTAnnotationStore.set_annotation(node, 'concrete_params', param_types)
+            self.function_registry.set_concrete_signature(name, param_types)
+            for call in self._call_nodes[name]:
+                for arg, param_type in zip(call.args, param_types):
+                    if param_type == "TValue":
+                        ASTAnnotationStore.set_annotation(arg, 'box_arg', True)
 
     def _merge_types(self, existing: Type, new_type: Type) -> Type:
         """Merge conflicting types into ANY/VARIANT type
@@ -255,6 +700,12 @@ class TypeResolver:
         if new_type.kind == TypeKind.UNKNOWN:
             return existing
 
+        # Widen an ANY only by kinds it doesn't have yet, so merges settle
+        if existing.kind == TypeKind.ANY:
+            if any(t.kind == new_type.kind for t in existing.subtypes):
+                return existing
+            return Type(TypeKind.ANY, subtypes=existing.subtypes + [new_type])
+
         return Type(TypeKind.ANY, subtypes=[existing, new_type])
 
     def _validate_and_finalize(self) -> None:
@@ -299,6 +750,69 @@ class TypeResolver:
         # Finalize type information on all symbols
         self._finalize_type_information()
 
+    def _apply_profile_feedback(self, chunk: astnodes.Chunk) -> None:
+        """Pass 5: Speculate on the parameter types a profiled run observed
+
+        Records every profiled function's observed types in the registry.
+        In a hot function (HOT_CALL_THRESHOLD calls), a parameter that was
+        only ever a number and is never assigned, even from a nested
+        closure, is speculated on: the generators emit a guarded entry
+        that re-enters the function with such arguments unboxed to double
+        and falls back to the generic instantiation when a guard fails.
+
+        Speculated functions carry the 'speculated_params' annotation
+        (parameter names, in order).
+        """
+        definitions: List[astnodes.Node] = []
+        assigned: Dict[int, Set[str]] = {}
+
+        def walk(node, owners: List[astnodes.Node]) -> None:
+            if isinstance(node, list):
+                for item in node:
+                    walk(item, owners)
+                return
+            if not isinstance(node, astnodes.Node):
+                return
+            if isinstance(node, (astnodes.Function, astnodes.LocalFunction)):
+                definitions.append(node)
+            if isinstance(node, astnodes.Assign):
+                names = {t.id for t in node.targets if isinstance(t, astnodes.Name)}
+                for owner in owners:
+                    assigned.setdefault(id(owner), set()).update(names)
+            if isinstance(node, (astnodes.Function, astnodes.LocalFunction)):
+                owners = owners + [node]
+            for attr in dir(node):
+                if not attr.startswith('_'):
+                    child = getattr(node, attr, None)
+                    if isinstance(child, (astnodes.Node, list)):
+                        walk(child, owners)
+
+        walk(chunk.body, [])
+
+        for node in definitions:
+            name = function_profile_name(node)
+            if name is None or any(isinstance(a, astnodes.Varargs) for a in node.args):
+                continue
+            observed = self.profile.lookup(self.module_name, name, function_line(node))
+            if observed is None:
+                continue
+            param_names = [a.id for a in node.args if isinstance(a, astnodes.Name)]
+            signature = self.function_registry.record_observed_types(
+                name, param_names, observed.calls, observed.params, observed.returns)
+            if signature is None or not observed.is_hot():
+                continue
+            reassigned = assigned.get(id(node), set())
+            concrete = signature.concrete_param_types or []
+            speculated = [p for i, p in enumerate(param_names)
+                          if signature.observed_as(i, "number") and p not in reassigned
+                          and not (i < len(concrete) and concrete[i] == "double")]
+            if speculated:
+                # The guarded entry needs the template; arguments boxed for a
+                # TValue parameter still bind to it
+                ASTAnnotationStore.set_annotation(node, 'concrete_params', None)
+                self.function_registry.set_concrete_signature(name, None)
+                ASTAnnotationStore.set_annotation(node, 'speculated_params', speculated)
+
     def _infer_statement(self, stmt: astnodes.Node) -> None:
         """Infer types in a statement
 
@@ -372,6 +886,15 @@ class TypeResolver:
         self._current_function = old_function
 
     def _infer_expression(self, expr: astnodes.Node) -> Type:
+        if is_wide_integer(expr):
+            # A TValue, not a double (see is_wide_integer)
+            for child in (getattr(expr, 'left', None), getattr(expr, 'right', None),
+                          getattr(expr, 'operand', None)):
+                if child is not None:
+                    self._infer_expression(child)
+            type_info = Type(TypeKind.UNKNOWN)
+            ASTAnnotationStore.set_type(expr, type_info)
+            return type_info
         if isinstance(expr, astnodes.Number):
             type_info = Type(TypeKind.NUMBER, is_constant=True)
             ASTAnnotationStore.set_type(expr, type_info)
@@ -415,9 +938,7 @@ class TypeResolver:
             type_info = Type(TypeKind.FUNCTION)
             ASTAnnotationStore.set_type(expr, type_info)
             return type_info
-        elif isinstance(expr, (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp,
-                                astnodes.FloatDivOp, astnodes.FloorDivOp,
-                                astnodes.ModOp, astnodes.ExpoOp)):
+        elif isinstance(expr, self._ARITHMETIC_OPS):
             left_type = self._infer_expression(expr.left)
             self._infer_expression(expr.right)
             type_info = self._infer_arithmetic_result(left_type)
@@ -443,7 +964,7 @@ class TypeResolver:
             type_info = self._merge_types(left_type, right_type)
             ASTAnnotationStore.set_type(expr, type_info)
             return type_info
-        elif isinstance(expr, astnodes.UMinusOp):
+        elif isinstance(expr, (astnodes.UMinusOp, astnodes.UBNotOp)):
             type_info = self._infer_expression(expr.operand)
             ASTAnnotationStore.set_type(expr, type_info)
             return type_info
@@ -475,6 +996,13 @@ class TypeResolver:
             return self.inferred_types[symbol]
         return Type(TypeKind.UNKNOWN)
 
+    def expression_type(self, expr: astnodes.Node) -> Type:
+        """Infer the type of an expression from its literals and operators
+
+        Names take the types inferred so far (UNKNOWN outside resolve_chunk).
+        """
+        return self._infer_expression(expr)
+
     def annotate_node(self, node: astnodes.Node, type_obj: Type) -> None:
         """Attach type information to AST node using ASTAnnotationStore
 
@@ -0,0 +1,274 @@
+"""Vector loop analyzer for Lua2C++ transpiler
+
+Finds the numeric for-loops that only compute with floats from number
+arrays, such as `for i = 1, n do y[i] = a * x[i] + y[i] end` and
+`for i = 1, n do s = s + x[i] * y[i] end`, so that they can index the
+arrays' doubles directly (lua_vector.hpp) in a loop the C++ compiler can
+vectorize.
+"""
+
+from dataclasses import dataclass, field
+from typing import Any, Dict, List, Optional, Tuple
+from ..core.types import ASTAnnotationStore
+from .parallel_analyzer import _children, _is_dot, _stmts
+
+try:
+    from luaparser import astnodes
+except ImportError:
+    raise ImportError("luaparser is required. Install with: pip install luaparser")
+
+
+# math functions a kernel calls, and their runtime overloads on doubles
+VECTOR_MATH = {'sqrt': 'l2c::math_sqrt', 'abs': 'l2c::math_abs'}
+
+_ARITHMETIC = (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp, astnodes.FloatDivOp,
+               astnodes.ModOp, astnodes.ExpoOp)
+
+
+def index_offset(idx: Any, loop_var: str) -> Optional[int]:
+    """k for an index `i`, `i + k`, `k + i` or `i - k` (k an integer literal)"""
+    def literal(node: Any) -> Optional[int]:
+        if isinstance(node, astnodes.Number) and isinstance(node.n, int) and abs(node.n) < 2**31:
+            return node.n
+        return None
+
+    def is_var(node: Any) -> bool:
+        return isinstance(node, astnodes.Name) and node.id == loop_var
+
+    if is_var(idx):
+        return 0
+    if isinstance(idx, astnodes.AddOp):
+        if is_var(idx.left) and literal(idx.right) is not None:
+            return literal(idx.right)
+        if is_var(idx.right) and literal(idx.left) is not None:
+            return literal(idx.left)
+    if isinstance(idx, astnodes.SubOp) and is_var(idx.left) and literal(idx.right) is not None:
+        return -literal(idx.right)
+    return None
+
+
+@dataclass
+class VectorLoop:
+    """What the kernel of one loop needs to know
+
+    tables: tables indexed by the loop, in first-use order
+    offsets: per table, the smallest and largest k of its t[i + k]
+    written: the tables stored to
+    scalars: variables from outside the loop read as numbers
+    reductions: accumulators `x = x + e`, in first-use order
+    locals: the locals the loop body declares
+    """
+    tables: List[str] = field(default_factory=list)
+    offsets: Dict[str, Tuple[int, int]] = field(default_factory=dict)
+    written: List[str] = field(default_factory=list)
+    scalars: List[str] = field(default_factory=list)
+    reductions: List[str] = field(default_factory=list)
+    locals: List[str] = field(default_factory=list)
+
+    @property
+    def independent(self) -> bool:
+        """Every access is t[i + k] for one k, so no iteration reads another's store"""
+        return len({k for bounds in self.offsets.values() for k in bounds}) == 1
+
+
+class _NotVector(Exception):
+    pass
+
+
+class _KernelChecker:
+    """Checks that a loop body is straight-line float arithmetic
+
+    The body declares locals, assigns them, stores to t[i + k] and adds to
+    accumulators; its expressions use numbers, its locals, the loop
+    variable, scalars and elements t[i + k] from outside the loop, and
+    the math functions in VECTOR_MATH.
+    """
+
+    def __init__(self, loop_var: str, math: Optional[Dict[str, str]], counts: Dict[str, int]) -> None:
+        self.loop_var = loop_var
+        # None when 'math' may not be the library; else its aliases
+        self.math = math
+        self.counts = counts
+        self.info = VectorLoop()
+
+    def block(self, block: Any) -> None:
+        for stmt in _stmts(block):
+            self.stmt(stmt)
+
+    def stmt(self, node: Any) -> None:
+        if isinstance(node, astnodes.LocalAssign):
+            if len(node.targets) != 1 or len(node.values) != 1:
+                raise _NotVector()
+            self.expr(node.values[0])
+            name = node.targets[0].id
+            if name in self.info.locals or not self._new(name):
+                raise _NotVector()
+            self.info.locals.append(name)
+        elif isinstance(node, astnodes.Assign):
+            self.assign(node)
+        elif not isinstance(node, (astnodes.SemiColon, astnodes.Semicolon)):
+            raise _NotVector()
+
+    def assign(self, node: astnodes.Assign) -> None:
+        if len(node.targets) != 1 or len(node.values) != 1:
+            raise _NotVector()
+        target, value = node.targets[0], node.values[0]
+        if isinstance(target, astnodes.Name) and target.id in self.info.locals:
+            self.expr(value)
+        elif (isinstance(target, astnodes.Name) and self._new(target.id)
+              and isinstance(value, astnodes.AddOp) and isinstance(value.left, astnodes.Name)
+              and value.left.id == target.id and self.counts.get(target.id) == 2):
+            # s = s + e, s named nowhere else in the loop
+            self.info.reductions.append(target.id)
+            self.expr(value.right)
+        elif isinstance(target, astnodes.Index):
+            self.element(target)
+            if target.value.id not in self.info.written:
+                self.info.written.append(target.value.id)
+            self.expr(value)
+        else:
+            raise _NotVector()
+
+    def _new(self, name: str) -> bool:
+        """A name the body hasn't used in another role yet"""
+        info = self.info
+        return (name != self.loop_var and name not in info.tables and name not in info.scalars
+                and name not in info.reductions and name not in info.locals)
+
+    def element(self, node: astnodes.Index) -> None:
+        """t[i + k] of a table t from outside the loop"""
+        if _is_dot(node) or not isinstance(node.value, astnodes.Name):
+            raise _NotVector()
+        name = node.value.id
+        k = index_offset(node.idx, self.loop_var)
+        if k is None or (name not in self.info.tables and not self._new(name)):
+            raise _NotVector()
+        if name not in self.info.tables:
+            self.info.tables.append(name)
+        low, high = self.info.offsets.get(name, (k, k))
+        self.info.offsets[name] = (min(low, k), max(high, k))
+
+    def expr(self, node: Any) -> None:
+        if isinstance(node, astnodes.Number):
+            return
+        if isinstance(node, astnodes.Name):
+            name = node.id
+            if name == self.loop_var or name in self.info.locals or name in self.info.scalars:
+                return
+            if not self._new(name) or (self.math is not None and (name == 'math' or name in self.math)):
+                raise _NotVector()
+            self.info.scalars.append(name)
+        elif isinstance(node, _ARITHMETIC):
+            self.expr(node.left)
+            self.expr(node.right)
+        elif isinstance(node, astnodes.UMinusOp):
+            self.expr(node.operand)
+        elif isinstance(node, astnodes.Index):
+            self.element(node)
+        elif isinstance(node, astnodes.Call):
+            function = self.math_function(node.func)
+            if function is None or len(node.args) != 1:
+                raise _NotVector()
+            ASTAnnotationStore.set_annotation(node, 'vector_math', function)
+            self.expr(node.args[0])
+        else:
+            raise _NotVector()
+
+    def math_function(self, func: Any) -> Optional[str]:
+        """The VECTOR_MATH entry `math.f` or an alias `f` of it names"""
+        if self.math is None:
+            return None
+        if isinstance(func, astnodes.Name) and func.id in self.math:
+            return self.math[func.id]
+        if (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+                and func.value.id == 'math' and _is_dot(func) and func.idx.id in VECTOR_MATH):
+            return func.idx.id
+        return None
+
+
+class VectorAnalyzer:
+    """Marks the numeric for-loops that can run as kernels over number arrays
+
+    A loop qualifies when its step is 1 and its body is straight-line
+    code (see _KernelChecker) that indexes at least one table. Whether
+    every table is an array of floats covering the range, and every
+    scalar a number, is only known when the loop starts: the generated
+    kernel checks, and the loop runs as usual where it can't.
+
+    Annotations:
+        Fornum: 'vector_loop' -> VectorLoop
+        Call: 'vector_math' -> the VECTOR_MATH function it calls
+    """
+
+    def analyze(self, chunk: astnodes.Chunk) -> int:
+        """Annotate the loops that can run as vector kernels
+
+        Returns:
+            How many loops were marked
+        """
+        bindings: Dict[str, int] = {}
+        self._count_bindings(chunk, bindings)
+        # The names of math functions that can't be rebound: 'math' itself,
+        # and top-level aliases `local sqrt = math.sqrt`
+        self._math: Optional[Dict[str, str]] = None
+        if 'math' not in bindings:
+            self._math = {}
+            for stmt in _stmts(chunk.body):
+                if (isinstance(stmt, astnodes.LocalAssign) and len(stmt.targets) == 1
+                        and len(stmt.values) == 1 and bindings.get(stmt.targets[0].id) == 1):
+                    value = stmt.values[0]
+                    if (isinstance(value, astnodes.Index) and isinstance(value.value, astnodes.Name)
+                            and value.value.id == 'math' and _is_dot(value)
+                            and value.idx.id in VECTOR_MATH):
+                        self._math[stmt.targets[0].id] = value.idx.id
+        self._loops = 0
+        self._visit(chunk)
+        return self._loops
+
+    def _count_bindings(self, node: Any, bindings: Dict[str, int]) -> None:
+        def bind(target: Any) -> None:
+            if isinstance(target, astnodes.Name):
+                bindings[target.id] = bindings.get(target.id, 0) + 1
+
+        if isinstance(node, (astnodes.LocalAssign, astnodes.Assign)):
+            for target in node.targets:
+                bind(target)
+        elif isinstance(node, (astnodes.Fornum, astnodes.Forin)):
+            for target in (node.targets if isinstance(node, astnodes.Forin) else [node.target]):
+                bind(target)
+        elif isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction,
+                               astnodes.Method)):
+            for arg in node.args:
+                bind(arg)
+            if isinstance(node, (astnodes.LocalFunction, astnodes.Function)):
+                bind(node.name)
+        for child in _children(node):
+            self._count_bindings(child, bindings)
+
+    def _visit(self, node: Any) -> None:
+        if isinstance(node, astnodes.Fornum) and self._mark(node):
+            return
+        for child in _children(node):
+            self._visit(child)
+
+    def _mark(self, loop: astnodes.Fornum) -> bool:
+        if not (isinstance(loop.step, astnodes.Number) and loop.step.n == 1):
+            return False
+        counts: Dict[str, int] = {}
+        self._count_names(loop.body, counts)
+        checker = _KernelChecker(loop.target.id, self._math, counts)
+        try:
+            checker.block(loop.body)
+        except _NotVector:
+            return False
+        if not checker.info.tables:
+            return False
+        ASTAnnotationStore.set_annotation(loop, 'vector_loop', checker.info)
+        self._loops += 1
+        return True
+
+    def _count_names(self, node: Any, counts: Dict[str, int]) -> None:
+        if isinstance(node, astnodes.Name):
+            counts[node.id] = counts.get(node.id, 0) + 1
+        for child in _children(node):
+            self._count_names(child, counts)
@@ -0,0 +1,154 @@
+"""Content-addressed transpile cache
+
+A module's generated .cpp and .hpp are stored under a key that hashes
+everything that can change them:
+
+- the Lua source bytes
+- the module's path, which names its init function and heads its output
+- the options that affect code generation (runtime, instrumentation,
+  the profile's contents, call conventions, --header collection)
+- the transpiler itself: a hash of the lua2cpp package sources, so an
+  edited checkout never reuses output of the old code
+- the exported signatures of the modules it depends on: the declarations
+  of their --lib headers
+
+An unchanged module is then neither parsed nor type-resolved. Outputs are
+written with write_if_changed, so a rerun leaves their timestamps alone
+and the C++ build downstream has nothing to redo.
+
+Entries live in `<output dir>/.lua2cpp-cache/<2 hex>/<key>.json` unless
+--cache-dir says otherwise; --no-cache turns the cache off. Stale entries
+are never read again and can be deleted with the directory at any time.
+"""
+
+import hashlib
+import json
+import os
+import tempfile
+from dataclasses import asdict, dataclass, field
+from functools import lru_cache
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+from ..core.call_convention import CallConventionRegistry
+
+
+CACHE_DIR_NAME = ".lua2cpp-cache"
+
+# Bump when the entry layout changes
+CACHE_FORMAT = 1
+
+
+@dataclass
+class CacheEntry:
+    """Outputs of one transpiled module
+
+    Attributes:
+        cpp: Generated C++ source
+        hpp: Generated --lib header
+        init_func: Name of the module init function
+        library_calls: (module, func, line) of each library call (with --header)
+        global_functions: Global functions called (with --header)
+    """
+    cpp: str
+    hpp: str
+    init_func: str = ""
+    library_calls: List[List[Any]] = field(default_factory=list)
+    global_functions: List[str] = field(default_factory=list)
+
+
+@lru_cache(maxsize=1)
+def transpiler_fingerprint() -> str:
+    """Hash of the transpiler's own sources"""
+    package = Path(__file__).resolve().parent.parent
+    h = hashlib.sha256()
+    for path in sorted(package.rglob("*.py")):
+        h.update(path.relative_to(package).as_posix().encode())
+        h.update(b"\0")
+        h.update(path.read_bytes())
+    return h.hexdigest()
+
+
+def signature_digest(header: str) -> str:
+    """Hash of the declarations a module header exports (comments ignored)"""
+    lines = [line.strip() for line in header.splitlines()]
+    return hashlib.sha256("\n".join(l for l in lines if l and not l.startswith("//")).encode()).hexdigest()
+
+
+def cache_options(runtime: str, instrument: bool, profile_path: Optional[Path],
+                  convention_registry: CallConventionRegistry, collect_library_calls: bool,
+                  parallel: bool = False) -> Dict[str, Any]:
+    """The options that affect a module's generated code"""
+    profile = hashlib.sha256(profile_path.read_bytes()).hexdigest() if profile_path else None
+    return {
+        "runtime": runtime,
+        "instrument": instrument,
+        "parallel": parallel,
+        "profile": profile,
+        "conventions": convention_registry.fingerprint(),
+        "library_calls": collect_library_calls,
+    }
+
+
+def write_if_changed(path: Path, content: str) -> bool:
+    """Write content unless the file already holds it; True if written"""
+    try:
+        if path.read_text(encoding='utf-8') == content:
+            return False
+    except (OSError, UnicodeDecodeError):
+        pass
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(content, encoding='utf-8')
+    return True
+
+
+class TranspileCache:
+    """Transpiled modules on disk, keyed by content"""
+
+    def __init__(self, directory: Path) -> None:
+        self.directory = directory
+
+    @staticmethod
+    def key(source: bytes, path: Path, options: Dict[str, Any], dependencies: Dict[str, str]) -> str:
+        """Cache key of a module
+
+        Args:
+            source: Lua source bytes
+            path: The module's Lua file, as transpile_file gets it
+            options: cache_options() of the run
+            dependencies: Module name -> signature_digest() of each dependency
+        """
+        h = hashlib.sha256()
+        h.update(json.dumps({
+            "format": CACHE_FORMAT,
+            "transpiler": transpiler_fingerprint(),
+            "path": str(path),
+            "options": options,
+            "dependencies": dependencies,
+        }, sort_keys=True).encode())
+        h.update(b"\0")
+        h.update(source)
+        return h.hexdigest()
+
+    def _path(self, key: str) -> Path:
+        return self.directory / key[:2] / f"{key}.json"
+
+    def load(self, key: str) -> Optional[CacheEntry]:
+        """The entry stored under key; None if missing or unreadable"""
+        try:
+            with open(self._path(key), 'r', encoding='utf-8') as f:
+                return CacheEntry(**json.load(f))
+        except (OSError, ValueError, TypeError):
+            return None
+
+    def store(self, key: str, entry: CacheEntry) -> None:
+        """Store an entry; concurrent writers of one key are harmless"""
+        path = self._path(key)
+        try:
+            path.parent.mkdir(parents=True, exist_ok=True)
+            fd, tmp = tempfile.mkstemp(dir=path.parent, suffix=".tmp")
+            with os.fdopen(fd, 'w', encoding='utf-8') as f:
+                json.dump(asdict(entry), f)
+            os.replace(tmp, path)
+        except OSError:
+            pass  # a cache that can't be written only costs the next run time
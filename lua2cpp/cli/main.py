@@ -19,12 +19,15 @@ except ImportError:
 
 from lua2cpp.generators import CppEmitter
 from lua2cpp.generators.header_generator import HeaderGenerator
-from ..core.library_call_collector import LibraryCallCollector, LibraryCallCollector as Collector
+from ..core.library_call_collector import LibraryCall, LibraryCallCollector, LibraryCallCollector as Collector
 from ..analyzers.y_combinator_detector import YCombinatorDetector
 from ..core.call_convention import CallConventionRegistry
+from ..core.library_registry import LibraryFunctionRegistry
+from ..analyzers.type_profile import TypeProfile
+from .cache import CACHE_DIR_NAME, CacheEntry, TranspileCache, cache_options, signature_digest, write_if_changed
 
 
-def transpile_file(input_file: Path, collect_library_calls: bool = False, output_dir: Optional[Path] = None, verbose: bool = False, convention_registry: Optional[CallConventionRegistry] = None, runtime: str = "table") -> Tuple[str, List, Optional[Collector], Any]:
+def transpile_file(input_file: Path, collect_library_calls: bool = False, output_dir: Optional[Path] = None, verbose: bool = False, convention_registry: Optional[CallConventionRegistry] = None, runtime: str = "table", instrument: bool = False, profile: Optional[TypeProfile] = None, library_registry: Optional[LibraryFunctionRegistry] = None, parallel: bool = False) -> Tuple[str, List, Optional[Collector], Any]:
     """Transpile a single Lua file to C++
 
     Args:
@@ -33,6 +36,11 @@ def transpile_file(input_file: Path, collect_library_calls: bool = False, output
         output_dir: Optional output directory for generated files
         verbose: If True, print verbose file generation details
         convention_registry: Optional registry for call conventions
+        runtime: "table" or "lua_table"
+        instrument: Emit code that writes a type profile at exit (lua_table)
+        profile: Type profile to specialize hot functions on (lua_table)
+        library_registry: Optional library registry shared between modules
+        parallel: Run independent numeric loops on all cores (lua_table)
 
     Returns:
         Tuple of (generated C++ code, list of LibraryCall objects if collect_library_calls=True else [], emitter)
@@ -72,13 +80,24 @@ def transpile_file(input_file: Path, collect_library_calls: bool = False, output
     collector = None
     library_calls = []
     if collect_library_calls:
-        collector = LibraryCallCollector()
+        collector = LibraryCallCollector(library_registry)
         collector.visit(tree)
         library_calls = collector.get_library_calls()
 
-    emitter = CppEmitter(convention_registry=convention_registry, runtime=runtime)
+    emitter = CppEmitter(convention_registry=convention_registry, runtime=runtime,
+                         instrument=instrument, profile=profile, library_registry=library_registry,
+                         parallel=parallel)
     cpp_code = emitter.generate_file(tree, input_file)
 
+    if verbose:
+        resolver = emitter.get_type_resolver()
+        stats = resolver.propagation_stats
+        print(f"Type resolution: {input_file}")
+        for name, seconds in resolver.pass_times:
+            detail = (f" ({stats['functions']} functions, {stats['components']} call graph components,"
+                      f" {stats['visits']} visits)") if name == "propagation" and stats else ""
+            print(f"  {name}: {seconds * 1000:.1f} ms{detail}")
+
     if y_warnings:
         warning_block = "// WARNING: Y-combinator patterns detected that may not compile in C++17:\n"
         for w in y_warnings:
@@ -152,18 +171,30 @@ def extract_function_signatures(cpp_code: str) -> List[str]:
     return signatures
 
 
-def generate_lib_header(cpp_code: str, module_name: str, has_g_table: bool = False) -> str:
+def generate_lib_header(cpp_code: str, module_name: str, has_g_table: bool = False,
+                        runtime: str = "table") -> str:
     """Generate .hpp header file with forward declarations.
 
+    For the lua_table runtime only the module init function is declared:
+    every other function of the module is internal to its .cpp, and most
+    are templates that can't be declared without their definitions. The
+    header is what a main compiled as a separate TU includes.
+
     Args:
         cpp_code: Generated C++ source code
         module_name: Name of the module (input filename stem)
         has_g_table: Whether this module uses the G table
+        runtime: Runtime the module was generated for
 
     Returns:
         Header file content with forward declarations
     """
     signatures = extract_function_signatures(cpp_code)
+    if runtime == "lua_table":
+        runtime_header = '#include "../runtime/l2c_runtime_lua_table.hpp"'
+        signatures = [sig for sig in signatures if re.search(r'\b\w+_module_init\(', sig)]
+    else:
+        runtime_header = '#include "../runtime/globals.hpp"'
 
     header_lines = [
         f'// Auto-generated header for {module_name}',
@@ -171,7 +202,7 @@ def generate_lib_header(cpp_code: str, module_name: str, has_g_table: bool = Fal
         '',
         '#pragma once',
         '',
-        '#include "../runtime/globals.hpp"',
+        runtime_header,
         '',
     ]
 
@@ -188,6 +219,24 @@ def generate_lib_header(cpp_code: str, module_name: str, has_g_table: bool = Fal
     return '\n'.join(header_lines)
 
 
+def transpile_entry(path: Path, runtime: str, collect_library_calls: bool = False,
+                    **options: Any) -> CacheEntry:
+    """Transpile one module into what the cache stores
+
+    Raises:
+        Whatever transpile_file raises
+    """
+    cpp_code, library_calls, collector, emitter = transpile_file(
+        path, collect_library_calls=collect_library_calls, runtime=runtime, **options)
+    return CacheEntry(
+        cpp=cpp_code,
+        hpp=generate_lib_header(cpp_code, path.stem, emitter._has_g_table, runtime),
+        init_func=f"{emitter._module_prefix}_module_init",
+        library_calls=[[call.module, call.func, call.line] for call in library_calls],
+        global_functions=sorted({call.func for call in collector.get_global_calls()}) if collector else [],
+    )
+
+
 def main():
     """Main entry point for the CLI."""
     emitter = None
@@ -197,7 +246,7 @@ def main():
     parser.add_argument(
         "input",
         type=Path,
-        help="Input Lua file to transpile"
+        help="Input Lua file to transpile, or a project directory"
     )
     parser.add_argument(
         "-o", "--output",
@@ -243,8 +292,69 @@ def main():
         default="table",
         help="Select runtime: 'table' (default TABLE struct) or 'lua_table' (TValue/LuaTable)"
     )
+    parser.add_argument(
+        "--instrument",
+        action="store_true",
+        help="Record argument/return types and call counts per function; the build writes "
+             "$L2C_PROFILE_OUT (default l2c.profile.json) at exit (lua_table runtime)"
+    )
+    parser.add_argument(
+        "--profile",
+        type=Path,
+        metavar="FILE",
+        help="Specialize hot functions on the types an --instrument run observed (lua_table runtime)"
+    )
+    parser.add_argument(
+        "--parallel",
+        action="store_true",
+        help="Run numeric for-loops with independent iterations on all cores; "
+             "$L2C_THREADS caps the threads used (lua_table runtime)"
+    )
+
+    parser.add_argument(
+        "--project",
+        action="store_true",
+        help="Transpile every module of a project: a directory of Lua files, or a manifest "
+             "listing one Lua file per line (implied when input is a directory)"
+    )
+    parser.add_argument(
+        "-j", "--jobs",
+        type=int,
+        default=0,
+        metavar="N",
+        help="Worker processes for --project (default: one per CPU)"
+    )
+
+    parser.add_argument(
+        "--cache-dir",
+        type=Path,
+        metavar="DIR",
+        help=f"Reuse unchanged modules from this cache (default: OUTPUT_DIR/{CACHE_DIR_NAME})"
+    )
+    parser.add_argument(
+        "--no-cache",
+        action="store_true",
+        help="Always transpile; don't read or write the cache"
+    )
 
     args = parser.parse_args()
+    project_mode = args.project or args.input.is_dir()
+    if project_mode and args.output:
+        parser.error("-o/--output can't be used with a project; use --output-dir")
+    if args.jobs < 0:
+        parser.error("--jobs can't be negative")
+    if (args.instrument or args.profile) and args.runtime != "lua_table":
+        parser.error("--instrument and --profile need --runtime=lua_table")
+    if args.parallel and args.runtime != "lua_table":
+        parser.error("--parallel needs --runtime=lua_table")
+
+    profile = None
+    if args.profile:
+        try:
+            profile = TypeProfile.load(args.profile)
+        except (OSError, ValueError) as e:
+            print(f"Error: Cannot load profile {args.profile}: {e}", file=sys.stderr)
+            sys.exit(1)
 
     try:
         args.output_dir.mkdir(parents=True, exist_ok=True)
@@ -266,15 +376,61 @@ def main():
     if args.convention:
         convention_registry.load_from_cli(args.convention)
 
-    try:
-        cpp_code, library_calls, collector, emitter = transpile_file(
+    cache = None if args.no_cache else TranspileCache(args.cache_dir or args.output_dir / CACHE_DIR_NAME)
+    options = cache_options(args.runtime, args.instrument, args.profile, convention_registry, args.header,
+                            parallel=args.parallel)
+
+    if project_mode:
+        from .project import transpile_project
+        sys.exit(transpile_project(
             args.input,
+            args.output_dir,
+            jobs=args.jobs,
+            convention_registry=convention_registry,
+            runtime=args.runtime,
+            instrument=args.instrument,
+            profile=profile,
+            parallel=args.parallel,
             collect_library_calls=args.header,
-            output_dir=args.output_dir,
             verbose=args.verbose,
-            convention_registry=convention_registry,
-            runtime=args.runtime
-        )
+            cache=cache,
+            cache_options=options
+        ))
+
+    key, entry = None, None
+    if cache:
+        try:
+            source = args.input.read_bytes()
+        except OSError:
+            source = None  # transpile_file reports it
+        if source is not None:
+            from .project import scan_dependencies
+            # Modules already generated next to this one count as its dependencies
+            dependencies = {}
+            for dep in sorted(scan_dependencies(source.decode('utf-8', errors='replace'), args.input.stem)):
+                dep_header = args.output_dir / f"{dep}.hpp"
+                if dep_header.is_file():
+                    dependencies[dep] = signature_digest(dep_header.read_text(encoding='utf-8', errors='replace'))
+            key = cache.key(source, args.input, options, dependencies)
+            entry = cache.load(key)
+    if entry is not None and args.verbose:
+        print(f"Cached: {args.input}")
+
+    try:
+        if entry is None:
+            entry = transpile_entry(
+                args.input,
+                args.runtime,
+                collect_library_calls=args.header,
+                output_dir=args.output_dir,
+                verbose=args.verbose,
+                convention_registry=convention_registry,
+                instrument=args.instrument,
+                profile=profile,
+                parallel=args.parallel
+            )
+            if key:
+                cache.store(key, entry)
     except FileNotFoundError as e:
         print(f"Error: {e}", file=sys.stderr)
         sys.exit(1)
@@ -297,9 +453,12 @@ def main():
     if args.verbose:
         print(f"Transpiling: {args.input} → {output_file}")
 
+    cpp_code = entry.cpp
+    library_calls = [LibraryCall(*call) for call in entry.library_calls]
+    collector = None
+
     try:
-        with open(output_file, 'w', encoding='utf-8') as f:
-            f.write(cpp_code)
+        written = write_if_changed(output_file, cpp_code)
     except PermissionError as e:
         print(f"Error: Permission denied when writing to {output_file}: {e}", file=sys.stderr)
         sys.exit(1)
@@ -308,15 +467,13 @@ def main():
         traceback.print_exc()
         sys.exit(1)
 
-    print(f"Generated: {output_file}")
+    print(f"{'Generated' if written else 'Up to date'}: {output_file}")
 
     if args.lib:
         try:
-            hpp_content = generate_lib_header(cpp_code, args.input.stem, emitter._has_g_table)
             hpp_file = output_file.parent / f"{args.input.stem}.hpp"
-            with open(hpp_file, 'w', encoding='utf-8') as f:
-                f.write(hpp_content)
-            print(f"Generated: {hpp_file}")
+            written = write_if_changed(hpp_file, entry.hpp)
+            print(f"{'Generated' if written else 'Up to date'}: {hpp_file}")
         except Exception as e:
             print(f"Error generating library header file: {e}", file=sys.stderr)
             traceback.print_exc()
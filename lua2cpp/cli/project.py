@@ -0,0 +1,372 @@
+"""Project mode: transpile a tree of Lua modules in parallel
+
+`lua2cpp DIR` (or `lua2cpp --project MANIFEST`) transpiles every module
+of a project instead of a single file. A manifest lists one Lua file per
+line, relative to the manifest's directory; blank lines and `#` comments
+are ignored. A module is named by its path without `.lua`, the way
+`require` names it with `/` for `.` ("engine/event").
+
+Dependencies come from `require "mod"` calls and from the engine export
+symbols CppEmitter resolves to other modules (MODULE_EXPORTS). They are
+found with a text scan, so a match in a comment or string only adds an
+edge. A module is transpiled once the modules it depends on have been,
+by a pool of worker processes; each worker builds one library registry
+and gets one copy of the convention config, shared by all its modules.
+When a module fails, the modules depending on it are skipped.
+
+Output mirrors the source tree: `<out>/engine/event.cpp` and `.hpp`.
+With a TranspileCache (cache.py), a module is looked up under its source,
+the options and its dependencies' exported signatures before it is
+transpiled, and outputs are only rewritten when they change. The
+consolidated header `<out>/lua2cpp_project.hpp` includes every
+module header in dependency order; with --header a single state.h
+covers the library calls of the whole project.
+"""
+
+import os
+import re
+import sys
+import time
+from concurrent.futures import FIRST_COMPLETED, Future, ProcessPoolExecutor, wait
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Set
+
+from ..core.call_convention import CallConventionRegistry
+from ..core.library_call_collector import LibraryCall
+from ..core.library_registry import LibraryFunctionRegistry
+from ..analyzers.type_profile import TypeProfile
+from ..generators.cpp_emitter import MODULE_EXPORTS
+from ..generators.header_generator import HeaderGenerator
+from .cache import TranspileCache, signature_digest, write_if_changed
+
+
+PROJECT_HEADER = "lua2cpp_project.hpp"
+
+_REQUIRE = re.compile(r'\brequire\s*\(?\s*(["\'])([^"\'\n]+)\1')
+_EXPORT_SYMBOLS = re.compile(r'\b(' + '|'.join(sorted(MODULE_EXPORTS, key=len, reverse=True)) + r')\b')
+
+
+@dataclass
+class Module:
+    """One Lua module of a project
+
+    Attributes:
+        name: Module path as `require` names it, with '/' separators
+        path: Lua source file
+        deps: Project modules it depends on
+    """
+    name: str
+    path: Path
+    deps: Set[str] = field(default_factory=set)
+
+
+@dataclass
+class ModuleResult:
+    """Outcome of transpiling one module
+
+    Attributes:
+        name: Module name
+        cpp_path: Generated .cpp (None on failure)
+        hpp_path: Generated .hpp (None on failure)
+        init_func: Name of the module's init function
+        error: Error message, or None on success
+        library_calls: Library calls found (with --header)
+        global_functions: Global functions called (with --header)
+        seconds: Time spent in the worker
+        signature: signature_digest() of the header, for dependents' cache keys
+        cached: Whether the outputs came from the cache
+        written: Whether an output file changed
+    """
+    name: str
+    cpp_path: Optional[Path] = None
+    hpp_path: Optional[Path] = None
+    init_func: str = ""
+    error: Optional[str] = None
+    library_calls: List[LibraryCall] = field(default_factory=list)
+    global_functions: Set[str] = field(default_factory=set)
+    seconds: float = 0.0
+    signature: str = ""
+    cached: bool = False
+    written: bool = False
+
+
+def module_name(path: str) -> str:
+    """Normalize a require argument or relative path to a module name"""
+    name = path.replace('\\', '/')
+    if name.endswith('.lua'):
+        name = name[:-4]
+    elif '/' not in name:
+        name = name.replace('.', '/')
+    return name
+
+
+def discover_modules(source: Path) -> Dict[str, Path]:
+    """Modules of a project directory (every *.lua below it) or manifest
+
+    Raises:
+        FileNotFoundError: If the directory, manifest or a listed file is missing
+    """
+    if source.is_dir():
+        return {module_name(p.relative_to(source).as_posix()): p
+                for p in sorted(source.rglob("*.lua"))}
+    if not source.exists():
+        raise FileNotFoundError(f"Project not found: {source}")
+    modules: Dict[str, Path] = {}
+    for line in source.read_text(encoding='utf-8').splitlines():
+        entry = line.split('#', 1)[0].strip()
+        if not entry:
+            continue
+        path = source.parent / entry
+        if not path.is_file():
+            raise FileNotFoundError(f"{source}: module not found: {entry}")
+        modules[module_name(Path(entry).as_posix())] = path
+    return modules
+
+
+def scan_dependencies(source: str, name: str, modules: Optional[Set[str]] = None) -> Set[str]:
+    """Modules a module's source refers to, limited to modules if given"""
+    deps = {module_name(m.group(2)) for m in _REQUIRE.finditer(source)}
+    deps |= {MODULE_EXPORTS[m.group(1)][0] for m in _EXPORT_SYMBOLS.finditer(source)}
+    deps.discard(name)
+    return deps if modules is None else deps & modules
+
+
+def build_graph(modules: Dict[str, Path]) -> Dict[str, Module]:
+    """The dependency graph of a project's modules"""
+    names = set(modules)
+    graph = {}
+    for name, path in modules.items():
+        source = path.read_text(encoding='utf-8', errors='replace')
+        graph[name] = Module(name, path, scan_dependencies(source, name, names))
+    return graph
+
+
+def dependency_order(graph: Dict[str, Module]) -> List[str]:
+    """Module names with dependencies first; modules in a cycle are
+    appended in name order"""
+    order: List[str] = []
+    state: Dict[str, int] = {}  # 1 visiting, 2 done
+
+    def visit(name: str) -> None:
+        if state.get(name):
+            return
+        state[name] = 1
+        for dep in sorted(graph[name].deps):
+            visit(dep)
+        state[name] = 2
+        order.append(name)
+
+    for name in sorted(graph):
+        visit(name)
+    return order
+
+
+# Per-process worker state, set up once by _init_worker
+_worker: Dict[str, Any] = {}
+
+
+def _init_worker(convention_registry: CallConventionRegistry, runtime: str, instrument: bool,
+                 profile: Optional[TypeProfile], parallel: bool, collect_library_calls: bool,
+                 cache: Optional[TranspileCache], cache_options: Dict[str, Any]) -> None:
+    _worker.update(
+        cache=cache,
+        cache_options=cache_options,
+        convention_registry=convention_registry,
+        library_registry=LibraryFunctionRegistry(),
+        runtime=runtime,
+        instrument=instrument,
+        profile=profile,
+        parallel=parallel,
+        collect_library_calls=collect_library_calls,
+    )
+
+
+def _transpile_module(name: str, path: Path, output_dir: Path, dependencies: Dict[str, str]) -> ModuleResult:
+    from .main import transpile_entry
+
+    start = time.perf_counter()
+    result = ModuleResult(name)
+    cache: Optional[TranspileCache] = _worker["cache"]
+    try:
+        key = cache.key(path.read_bytes(), path, _worker["cache_options"], dependencies) if cache else None
+        entry = cache.load(key) if cache else None
+        result.cached = entry is not None
+        if entry is None:
+            entry = transpile_entry(
+                path,
+                _worker["runtime"],
+                collect_library_calls=_worker["collect_library_calls"],
+                convention_registry=_worker["convention_registry"],
+                instrument=_worker["instrument"],
+                profile=_worker["profile"],
+                parallel=_worker["parallel"],
+                library_registry=_worker["library_registry"],
+            )
+            if cache:
+                cache.store(key, entry)
+        cpp_path = output_dir / f"{name}.cpp"
+        hpp_path = output_dir / f"{name}.hpp"
+        result.written = write_if_changed(cpp_path, entry.cpp)
+        result.written |= write_if_changed(hpp_path, entry.hpp)
+    except Exception as e:
+        result.error = f"{type(e).__name__}: {e}"
+    else:
+        result.cpp_path, result.hpp_path = cpp_path, hpp_path
+        result.init_func = entry.init_func
+        result.signature = signature_digest(entry.hpp)
+        result.library_calls = [LibraryCall(*call) for call in entry.library_calls]
+        result.global_functions = set(entry.global_functions)
+    result.seconds = time.perf_counter() - start
+    return result
+
+
+def generate_project_header(order: List[str], results: Dict[str, ModuleResult], output_dir: Path) -> str:
+    """Consolidated header including every generated module header"""
+    lines = [
+        '// Auto-generated project header',
+        '// Generated by lua2cpp',
+        '',
+        '#pragma once',
+        '',
+    ]
+    for name in order:
+        result = results.get(name)
+        if result and result.hpp_path:
+            lines.append(f'#include "{result.hpp_path.relative_to(output_dir).as_posix()}"')
+    lines.append('')
+    return '\n'.join(lines)
+
+
+def transpile_project(source: Path, output_dir: Path, jobs: int = 0,
+                      convention_registry: Optional[CallConventionRegistry] = None,
+                      runtime: str = "table", instrument: bool = False,
+                      profile: Optional[TypeProfile] = None, parallel: bool = False,
+                      collect_library_calls: bool = False, verbose: bool = False,
+                      cache: Optional[TranspileCache] = None,
+                      cache_options: Optional[Dict[str, Any]] = None) -> int:
+    """Transpile every module of a project
+
+    Args:
+        source: Project directory or manifest
+        output_dir: Root of the generated tree
+        jobs: Worker processes (0: one per CPU, 1: transpile in this process)
+        cache: Cache to reuse unchanged modules from, if any
+        cache_options: cache_options() of the run, part of every cache key
+
+    Returns:
+        Exit status: 0 if every module was transpiled, 1 otherwise
+    """
+    start = time.perf_counter()
+    try:
+        graph = build_graph(discover_modules(source))
+    except (OSError, UnicodeDecodeError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        return 1
+    if not graph:
+        print(f"Error: no Lua modules in {source}", file=sys.stderr)
+        return 1
+    jobs = min(jobs or os.cpu_count() or 1, len(graph))
+    convention_registry = convention_registry or CallConventionRegistry()
+    init_args = (convention_registry, runtime, instrument, profile, parallel, collect_library_calls,
+                 cache, cache_options or {})
+
+    dependents: Dict[str, Set[str]] = {name: set() for name in graph}
+    waiting: Dict[str, Set[str]] = {}
+    for name, module in graph.items():
+        waiting[name] = set(module.deps)
+        for dep in module.deps:
+            dependents[dep].add(name)
+    results: Dict[str, ModuleResult] = {}
+    ready = sorted(name for name, deps in waiting.items() if not deps)
+    for name in ready:
+        del waiting[name]
+
+    def finish(result: ModuleResult) -> None:
+        pending = [result]
+        while pending:
+            result = pending.pop()
+            results[result.name] = result
+            report(result)
+            for dependent in sorted(dependents[result.name]):
+                if dependent not in waiting:
+                    continue
+                if result.error:
+                    del waiting[dependent]
+                    pending.append(ModuleResult(dependent, error=f"skipped: {result.name} failed"))
+                    continue
+                waiting[dependent].discard(result.name)
+                if not waiting[dependent]:
+                    del waiting[dependent]
+                    ready.append(dependent)
+
+    def report(result: ModuleResult) -> None:
+        if result.error:
+            print(f"Error: {graph[result.name].path}: {result.error}", file=sys.stderr)
+        else:
+            timing = f" ({result.seconds:.2f}s{', cached' if result.cached else ''})" if verbose else ""
+            print(f"{'Generated' if result.written else 'Up to date'}: {result.cpp_path}{timing}")
+
+    pool = ProcessPoolExecutor(jobs, initializer=_init_worker, initargs=init_args) if jobs > 1 else None
+    if pool is None:
+        _init_worker(*init_args)
+    running: Dict[Future, str] = {}
+    try:
+        while ready or running or waiting:
+            if not ready and not running:
+                # A cycle: modules don't need each other's output to transpile,
+                # so release one and let the rest follow
+                name = min(waiting)
+                print(f"Warning: dependency cycle: transpiling {name} before {', '.join(sorted(waiting[name]))}",
+                      file=sys.stderr)
+                del waiting[name]
+                ready.append(name)
+            while ready:
+                name = ready.pop(0)
+                deps = {dep: results[dep].signature for dep in sorted(graph[name].deps) if dep in results}
+                if pool is None:
+                    future: Future = Future()
+                    future.set_result(_transpile_module(name, graph[name].path, output_dir, deps))
+                else:
+                    future = pool.submit(_transpile_module, name, graph[name].path, output_dir, deps)
+                running[future] = name
+            done, _ = wait(running, return_when=FIRST_COMPLETED)
+            for future in sorted(done, key=lambda f: running[f]):
+                name = running.pop(future)
+                try:
+                    finish(future.result())
+                except Exception as e:
+                    finish(ModuleResult(name, error=f"worker failed: {e}"))
+    finally:
+        if pool is not None:
+            pool.shutdown()
+
+    order = dependency_order(graph)
+    failed = sorted(name for name, result in results.items() if result.error)
+    inits: Dict[str, str] = {}
+    for name in order:
+        result = results[name]
+        if result.init_func in inits:
+            print(f"Warning: {name} and {inits[result.init_func]} both define {result.init_func}()",
+                  file=sys.stderr)
+        elif result.init_func:
+            inits[result.init_func] = name
+
+    project_header = output_dir / PROJECT_HEADER
+    if write_if_changed(project_header, generate_project_header(order, results, output_dir)):
+        print(f"Generated: {project_header}")
+
+    if collect_library_calls:
+        library_calls = [call for name in order for call in results[name].library_calls]
+        global_functions = set().union(*(results[name].global_functions for name in order))
+        # get_length is used by the # operator, not called by name
+        global_functions.add("get_length")
+        state_h = output_dir / "state.h"
+        if write_if_changed(state_h, HeaderGenerator().generate_header(library_calls, global_functions)):
+            print(f"Generated: {state_h}")
+
+    if verbose or failed:
+        print(f"{len(graph) - len(failed)}/{len(graph)} modules transpiled in "
+              f"{time.perf_counter() - start:.2f}s with {jobs} worker(s)",
+              file=sys.stderr if failed else sys.stdout)
+    return 1 if failed else 0
@@ -168,6 +168,13 @@ class CallConventionRegistry:
                              cpp_namespace=namespace,
                              flatten_depth=depth)
     
+    def fingerprint(self) -> str:
+        """Stable text form of every registered convention (for caching)."""
+        return ";".join(
+            f"{module}={c.convention.value}:{c.cpp_prefix}:{c.cpp_namespace}:{c.flatten_depth}"
+            for module, c in sorted(self._modules.items())
+        )
+
     def __repr__(self) -> str:
         return f"CallConventionRegistry(modules={list(self._modules.keys())})"
 
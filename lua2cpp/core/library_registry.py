@@ -40,6 +40,12 @@ class LibraryFunctionRegistry:
         "os", "package", "debug", "coroutine"
     }
 
+    # Library members that are values rather than functions
+    CONSTANTS = {("math", "pi"), ("math", "huge"), ("math", "maxinteger"), ("math", "mininteger")}
+
+    # ...of which these are TValues (64-bit integers), not constexpr NUMBERs
+    VALUE_CONSTANTS = {("math", "maxinteger"), ("math", "mininteger")}
+
     def __init__(self) -> None:
         """Initialize registry with all standard library functions"""
         self._functions: Dict[str, Dict[str, LibraryFunction]] = {}
@@ -284,6 +290,34 @@ class LibraryFunctionRegistry:
             return self._functions[module_name][func_name]
         return None
 
+    def cpp_binding(self, module_name: str, func_name: str) -> str:
+        """Get the C++ function (or constant) a library member compiles to
+
+        Calls bind to it directly, so the C++ compiler sees the typed
+        signature and can inline it: string functions are string_lib::
+        overloads, the others l2c::<cpp_name>. Names the registry doesn't
+        know follow the same scheme.
+
+        Args:
+            module_name: Library module name (e.g., "math")
+            func_name: Member name (e.g., "floor")
+
+        Returns:
+            Qualified C++ name (e.g., "l2c::math_floor")
+        """
+        if module_name == "string":
+            return f"string_lib::{'char_' if func_name == 'char' else func_name}"
+        info = self.get_library_info(module_name, func_name)
+        return f"l2c::{info.cpp_name if info else f'{module_name}_{func_name}'}"
+
+    def is_constant(self, module_name: str, func_name: str) -> bool:
+        """Check if a library member is a value (math.pi) rather than a function"""
+        return (module_name, func_name) in self.CONSTANTS
+
+    def is_value_constant(self, module_name: str, func_name: str) -> bool:
+        """Check if a library constant is a TValue, which C++ can't declare constexpr"""
+        return (module_name, func_name) in self.VALUE_CONSTANTS
+
     def is_global_function(self, name: str) -> bool:
         """Check if a function is a global Lua function
 
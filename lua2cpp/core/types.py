@@ -164,3 +164,37 @@ class ASTAnnotationStore:
             True if annotation exists, False otherwise
         """
         return hasattr(node, f'_l2c_{key}')
+
+
+def is_wide_integer(node: Any) -> bool:
+    """Check if an expression is an integer a double may not hold exactly
+
+    These are the results of bitwise operators, integer literals past
+    2^53, math.maxinteger and math.mininteger, and arithmetic and
+    negation on any of them. They stay TValues, where an integer keeps
+    all 64 bits, rather than NUMBERs.
+    """
+    from luaparser import astnodes
+
+    if isinstance(node, astnodes.Number):
+        return isinstance(node.n, int) and 2**53 < node.n < 2**63
+    if integer_limit(node) is not None:
+        return True
+    if isinstance(node, (astnodes.BitOp, astnodes.UBNotOp)):
+        return True
+    if isinstance(node, astnodes.UMinusOp):
+        return is_wide_integer(node.operand)
+    if isinstance(node, (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp,
+                         astnodes.FloorDivOp, astnodes.ModOp)):
+        return is_wide_integer(node.left) or is_wide_integer(node.right)
+    return False
+
+
+def integer_limit(node: Any) -> Optional[str]:
+    """The C++ constant for math.maxinteger or math.mininteger, else None"""
+    from luaparser import astnodes
+
+    if (isinstance(node, astnodes.Index) and isinstance(node.value, astnodes.Name)
+            and node.value.id == 'math' and isinstance(node.idx, astnodes.Name)):
+        return {'maxinteger': "INT64_MAX", 'mininteger': "INT64_MIN"}.get(node.idx.id)
+    return None
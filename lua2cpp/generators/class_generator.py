@@ -8,6 +8,8 @@ Translation rules (from oop_translation_spec.md):
 - function Class:init(...) -> Class::Class(...) constructor
 - self.x -> this->x
 - Parent.init(self, ...) -> parent constructor call in initializer list
+- self:method(...) -> bound to the method that runs for this's class,
+  tested against the overriding subclasses' type ids (object.hpp)
 """
 
 from typing import List, Dict, Optional, Set, Tuple, Any
@@ -19,6 +21,12 @@ except ImportError:
     raise ImportError("luaparser is required. Install with: pip install luaparser")
 
 from ..core.ast_visitor import ASTVisitor
+from ..core.scope import ScopeManager
+from ..core.symbol_table import SymbolTable
+from ..core.types import TypeKind
+from ..analyzers.function_registry import FunctionSignatureRegistry
+from ..analyzers.type_resolver import TypeResolver
+from .expr_generator import MethodReceiver
 
 
 @dataclass
@@ -38,6 +46,43 @@ class ClassInfo:
     parent: str
     methods: List[MethodInfo] = field(default_factory=list)
     member_vars: Set[str] = field(default_factory=set)
+    # self.k its methods store -> the values stored (None where unknown),
+    # the self.k they name at all, and those stored at the top of init
+    field_values: Dict[str, List[Any]] = field(default_factory=dict)
+    field_reads: Set[str] = field(default_factory=set)
+    init_fields: Set[str] = field(default_factory=set)
+    # Type ids of the class and its subclasses (assign_type_ids)
+    type_first: int = 0
+    type_last: int = 0
+    subclasses: List[str] = field(default_factory=list)
+
+    def defines(self, method_name: str) -> bool:
+        return any(m.name == method_name and not m.is_constructor for m in self.methods)
+
+
+def assign_type_ids(classes: Dict[str, ClassInfo]) -> None:
+    """Number the classes in preorder of the class tree, from 1
+
+    A class's subclasses then take the ids right after its own, so
+    Object::is<T>() is a range check. Classes whose parent isn't one of
+    `classes` (Object, or a class from elsewhere) start trees; leaves are
+    the classes left without subclasses.
+    """
+    for class_info in classes.values():
+        class_info.subclasses = [c.name for c in classes.values() if c.parent == class_info.name]
+    next_id = 1
+
+    def number(class_info: ClassInfo) -> None:
+        nonlocal next_id
+        class_info.type_first = next_id
+        next_id += 1
+        for name in class_info.subclasses:
+            number(classes[name])
+        class_info.type_last = next_id - 1
+
+    for class_info in classes.values():
+        if class_info.parent not in classes:
+            number(class_info)
 
 
 class ClassDetector(ASTVisitor):
@@ -57,6 +102,7 @@ class ClassDetector(ASTVisitor):
     def detect(self, chunk: astnodes.Chunk) -> Dict[str, ClassInfo]:
         """Scan AST and return detected classes"""
         self.visit(chunk)
+        assign_type_ids(self.classes)
         return self.classes
     
     def visit_Assign(self, node: astnodes.Assign) -> None:
@@ -111,6 +157,7 @@ class ClassDetector(ASTVisitor):
                         parent_init_call=parent_init
                     )
                     self.classes[class_name].methods.append(method)
+                    self._collect_fields(self.classes[class_name], method)
         
         # Handle function Class:method(...) pattern (colon syntax in function name)
         elif hasattr(node.name, 'id') and ':' in str(type(node.name)):
@@ -145,6 +192,54 @@ class ClassDetector(ASTVisitor):
                     parent_init_call=parent_init
                 )
                 self.classes[class_name].methods.append(method)
+                self._collect_fields(self.classes[class_name], method)
+    
+    def _collect_fields(self, class_info: ClassInfo, method: MethodInfo) -> None:
+        """Record the fields a method reads and stores on self"""
+        if "self" not in method.params or not method.body:
+            return
+        
+        def self_field(node: Any) -> Optional[str]:
+            if (isinstance(node, astnodes.Index) and isinstance(node.value, astnodes.Name)
+                    and node.value.id == "self" and isinstance(node.idx, astnodes.Name)
+                    and str(getattr(node, 'notation', '')) == "IndexNotation.DOT"):
+                return node.idx.id
+            return None
+        
+        def walk(node: Any, top_level: bool) -> None:
+            if isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.Method,
+                                 astnodes.AnonymousFunction)):
+                # A function of its own self isn't this object's
+                if isinstance(node, astnodes.Method) or any(
+                        isinstance(arg, astnodes.Name) and arg.id == "self" for arg in node.args):
+                    return
+            name = self_field(node)
+            if name is not None:
+                class_info.field_reads.add(name)
+            if isinstance(node, astnodes.Assign):
+                for i, target in enumerate(node.targets):
+                    name = self_field(target)
+                    if name is None:
+                        continue
+                    value = node.values[i] if i < len(node.values) else None
+                    class_info.field_values.setdefault(name, []).append(value)
+                    class_info.member_vars.add(name)
+                    if top_level and method.is_constructor:
+                        class_info.init_fields.add(name)
+            for attr_name in dir(node):
+                if attr_name.startswith('_'):
+                    continue
+                attr = getattr(node, attr_name, None)
+                if isinstance(attr, astnodes.Node):
+                    walk(attr, False)
+                elif isinstance(attr, list):
+                    for item in attr:
+                        if isinstance(item, astnodes.Node):
+                            walk(item, False)
+        
+        stmts = method.body.body if isinstance(method.body.body, list) else [method.body.body]
+        for stmt in stmts:
+            walk(stmt, True)
     
     def _find_parent_init_call(self, body: astnodes.Block, parent_class: str) -> Optional[Tuple[str, List[Any]]]:
         """Find ParentClass.init(self, ...) call in function body"""
@@ -188,10 +283,16 @@ class ClassGenerator:
         """
         self._stmt_gen = stmt_generator
         self._expr_gen = expr_generator
+        self._classes: Dict[str, ClassInfo] = {}
+        # Per class, the fields it declares as data members -> C++ type
+        self._members: Dict[str, Dict[str, str]] = {}
     
     def generate_class_header(self, classes: Dict[str, ClassInfo], module_name: str) -> str:
         """Generate complete .hpp header file with all class declarations
         
+        Method bodies follow all the declarations, so that a body can
+        call into any of the classes (self:method() may run a subclass's).
+        
         Args:
             classes: Dictionary of class name to ClassInfo
             module_name: Name for include guard
@@ -200,6 +301,7 @@ class ClassGenerator:
             Complete C++ header file content
         """
         lines = []
+        self.set_classes(classes)
         
         # Include guard
         guard_name = f"{module_name.upper()}_HPP"
@@ -224,53 +326,127 @@ class ClassGenerator:
             lines.append(self._generate_class_declaration(class_info))
             lines.append("")
         
+        # Then the methods of each class
+        for class_info in classes.values():
+            for method in class_info.methods:
+                if method.is_constructor:
+                    lines.append(self._generate_constructor(class_info, method))
+                else:
+                    lines.append(self._generate_method(class_info, method))
+                lines.append("")
+        
         # Close include guard
         lines.append(f"#endif // {guard_name}")
         
         return "\n".join(lines)
     
+    def set_classes(self, classes: Dict[str, ClassInfo]) -> None:
+        """Lay out the classes that are generated together"""
+        assign_type_ids(classes)
+        self._classes = classes
+        self._members = self._layout(classes)
+    
+    def _layout(self, classes: Dict[str, ClassInfo]) -> Dict[str, Dict[str, str]]:
+        """Decide which fields stored on self become data members, and their types
+        
+        A field is declared by the topmost class of the storing class's
+        chain whose methods name it, so methods all along the chain use
+        the same member. It is a NUMBER or BOOLEAN when every value stored
+        is one (TypeResolver.expression_type) and the class's init stores
+        it, else it holds any value, nil at first. Fields named like a
+        method, or only stored outside the methods, stay in Object::fields.
+        
+        Returns:
+            class -> field -> C++ type
+        """
+        reserved = {"fields", "type_id", "type_first", "type_last", "init", "is", "field", "set_field"}
+        method_names = {m.name for c in classes.values() for m in c.methods}
+        resolver = TypeResolver(ScopeManager(), SymbolTable(ScopeManager()), FunctionSignatureRegistry())
+        values: Dict[Tuple[str, str], List[Any]] = {}
+        for class_info in classes.values():
+            chain: List[ClassInfo] = []
+            current: Optional[ClassInfo] = class_info
+            while current is not None:
+                chain.append(current)
+                current = classes.get(current.parent)
+            for name, stored in class_info.field_values.items():
+                if name in reserved or name in method_names:
+                    continue
+                home = [c for c in chain if name in c.field_reads][-1]
+                values.setdefault((home.name, name), []).extend(stored)
+        
+        members: Dict[str, Dict[str, str]] = {name: {} for name in classes}
+        for (home, name), stored in values.items():
+            kinds = {resolver.expression_type(v).kind if v is not None else TypeKind.UNKNOWN for v in stored}
+            cpp_type = "TABLE"
+            if name in classes[home].init_fields and kinds == {TypeKind.NUMBER}:
+                cpp_type = "NUMBER"
+            elif name in classes[home].init_fields and kinds == {TypeKind.BOOLEAN}:
+                cpp_type = "BOOLEAN"
+            members[home][name] = cpp_type
+        return members
+    
+    def _visible_members(self, class_info: ClassInfo) -> Set[str]:
+        """The data members of a class and of its ancestors"""
+        names: Set[str] = set()
+        current: Optional[ClassInfo] = class_info
+        while current is not None:
+            names.update(self._members.get(current.name, {}))
+            current = self._classes.get(current.parent)
+        return names
+    
     def _generate_class_declaration(self, class_info: ClassInfo) -> str:
         """Generate single class declaration"""
         lines = []
         
-        # Class header with inheritance
+        # Class header with inheritance; leaves are final
+        final = "" if class_info.subclasses else " final"
         if class_info.parent:
-            lines.append(f"class {class_info.name} : public {class_info.parent} {{")
+            lines.append(f"class {class_info.name}{final} : public {class_info.parent} {{")
         else:
-            lines.append(f"class {class_info.name} {{")
+            lines.append(f"class {class_info.name}{final} {{")
         
         lines.append("public:")
+        lines.append(f"    static constexpr uint32_t type_first = {class_info.type_first};")
+        lines.append(f"    static constexpr uint32_t type_last = {class_info.type_last};")
+        for name, cpp_type in self._members.get(class_info.name, {}).items():
+            lines.append(f"    {cpp_type} {name}{{}};")
         
-        # Generate methods
+        # Declare methods; without an init, the parent's runs
+        if not any(method.is_constructor for method in class_info.methods):
+            parent = f" : {class_info.parent}(std::forward<Args>(args)...)" if class_info.parent else ""
+            lines.append(f"    template<typename... Args>")
+            lines.append(f"    {class_info.name}(Args&&... args){parent} {{ type_id = type_first; }}")
         for method in class_info.methods:
+            params_str = self._params(method)
             if method.is_constructor:
-                lines.append(self._generate_constructor(class_info, method))
+                lines.append(f"    {class_info.name}({params_str});")
             else:
-                lines.append(self._generate_method(class_info, method))
+                lines.append(f"    void {method.name}({params_str});")
         
         lines.append("};")
         
         return "\n".join(lines)
     
+    def _params(self, method: MethodInfo) -> str:
+        """C++ parameter list of a method (skip 'self' parameter)"""
+        return ", ".join(f"auto {p}" for p in method.params if p != "self")
+    
     def _generate_constructor(self, class_info: ClassInfo, method: MethodInfo) -> str:
         """Generate C++ constructor from init method"""
         lines = []
 
-        # Build parameter list (skip 'self' parameter)
-        params = [p for p in method.params if p != "self"]
-        param_strs = [f"auto {p}" for p in params]
-        params_str = ", ".join(param_strs) if param_strs else ""
-
         # Constructor signature (NO initializer list - parent init in body)
-        lines.append(f"    {class_info.name}({params_str}) {{")
+        lines.append(f"inline {class_info.name}::{class_info.name}({self._params(method)}) {{")
+        lines.append("    type_id = type_first;")
 
         # Translate body, including parent init call
         if self._stmt_gen and method.body:
-            body_lines = self._translate_constructor_body(method.body, class_info.parent)
+            body_lines = self._translate_constructor_body(method.body, class_info)
             for line in body_lines:
-                lines.append(f"        {line}")
+                lines.append(f"    {line}")
 
-        lines.append("    }")
+        lines.append("}")
 
         return "\n".join(lines)
     
@@ -278,64 +454,100 @@ class ClassGenerator:
         """Generate C++ method from Lua method"""
         lines = []
         
-        # Build parameter list (skip 'self' parameter)
-        params = [p for p in method.params if p != "self"]
-        param_strs = [f"auto {p}" for p in params]
-        params_str = ", ".join(param_strs) if param_strs else ""
-        
         # Return type (void for now, could be inferred)
         return_type = "void"
         
-        lines.append(f"    {return_type} {method.name}({params_str}) {{")
+        lines.append(f"inline {return_type} {class_info.name}::{method.name}({self._params(method)}) {{")
         
         # Translate body with self -> this
         if self._stmt_gen and method.body:
-            body_lines = self._translate_body(method.body)
+            body_lines = self._translate_body(method.body, class_info)
             for line in body_lines:
-                lines.append(f"        {line}")
+                lines.append(f"    {line}")
         
-        lines.append("    }")
+        lines.append("}")
         
         return "\n".join(lines)
     
-    def _translate_constructor_body(self, body: astnodes.Block, parent_class: str) -> List[str]:
-        """Translate constructor body, including parent init call"""
-        lines = []
-
-        if not body or not hasattr(body, 'body'):
-            return lines
-
-        stmts = body.body if isinstance(body.body, list) else [body.body]
+    def method_dispatch(self, class_info: ClassInfo) -> Dict[str, List[Tuple[str, str]]]:
+        """How self:method() binds in the methods of a class
+        
+        self is an instance of the class or of one of its subclasses. Each
+        subclass that overrides the method is tested for, most derived
+        first, and the class's own (or inherited) method runs otherwise;
+        a final class's calls are bound outright.
+        
+        Returns:
+            method -> [(class tested, class whose method runs)], the
+            last case untested ('')
+        """
+        classes = self._classes
+        descendants: List[ClassInfo] = []
+        pending = list(class_info.subclasses)
+        while pending:
+            sub = classes[pending.pop()]
+            descendants.append(sub)
+            pending.extend(sub.subclasses)
+        descendants.sort(key=lambda c: c.type_first, reverse=True)
 
-        for stmt in stmts:
-            if self._stmt_gen:
-                code = self._stmt_gen.generate(stmt)
-                if code:
-                    # Translate self -> this
-                    code = self._translate_self_to_this(code)
-                    lines.append(code)
+        ancestors: List[ClassInfo] = []
+        current: Optional[ClassInfo] = class_info
+        while current is not None:
+            ancestors.append(current)
+            current = classes.get(current.parent)
 
-        return lines
-    
-    def _translate_body(self, body: astnodes.Block) -> List[str]:
-        """Translate method body with self -> this"""
+        dispatch: Dict[str, List[Tuple[str, str]]] = {}
+        for method_name in {m.name for c in ancestors + descendants for m in c.methods if not m.is_constructor}:
+            owner = next((c.name for c in ancestors if c.defines(method_name)), None)
+            if owner is None:
+                # Only some subclasses have it: left to the dynamic call
+                continue
+            cases = [(c.name, c.name) for c in descendants if c.defines(method_name)]
+            dispatch[method_name] = cases + [("", owner)]
+        return dispatch
+    
+    def _expr_generator(self):
+        if self._expr_gen is not None:
+            return self._expr_gen
+        return getattr(self._stmt_gen, '_expr_gen', None)
+    
+    def _translate_statements(self, body: astnodes.Block, class_info: Optional[ClassInfo]) -> List[str]:
+        """Translate a method body, binding self's method calls to class_info's"""
         lines = []
         
         if not body or not hasattr(body, 'body'):
             return lines
-            
+        
+        expr_gen = self._expr_generator()
+        bind = class_info is not None and expr_gen is not None and hasattr(expr_gen, 'set_method_receivers')
+        if bind:
+            expr_gen.set_method_receivers({"self": MethodReceiver(
+                "this", self.method_dispatch(class_info), set(self._classes), self._visible_members(class_info))})
+        
         stmts = body.body if isinstance(body.body, list) else [body.body]
         
-        for stmt in stmts:
-            if self._stmt_gen:
-                code = self._stmt_gen.generate(stmt)
-                if code:
-                    # Translate self -> this
-                    code = self._translate_self_to_this(code)
-                    lines.append(code)
+        try:
+            for stmt in stmts:
+                if self._stmt_gen:
+                    code = self._stmt_gen.generate(stmt)
+                    if code:
+                        # Translate self -> this
+                        code = self._translate_self_to_this(code)
+                        lines.append(code)
+        finally:
+            if bind:
+                expr_gen.set_method_receivers({})
         
         return lines
     
+    def _translate_constructor_body(self, body: astnodes.Block, class_info: Optional[ClassInfo] = None) -> List[str]:
+        """Translate constructor body, including parent init call"""
+        return self._translate_statements(body, class_info)
+    
+    def _translate_body(self, body: astnodes.Block, class_info: Optional[ClassInfo] = None) -> List[str]:
+        """Translate method body with self -> this"""
+        return self._translate_statements(body, class_info)
+    
     def _translate_self_to_this(self, code: str) -> str:
         """Replace self. with this-> in generated code"""
         return code.replace("self.", "this->")
@@ -453,6 +665,7 @@ def _generate_class_header(class_info: ClassInfo, all_classes: Dict[str, ClassIn
     
     # Create generator instance for class declaration
     generator = ClassGenerator(stmt_gen, expr_gen)
+    generator.set_classes(all_classes)
     lines.append(generator._generate_class_declaration(class_info))
     lines.append("")
     
@@ -509,6 +722,7 @@ def _generate_constructor_body(class_info: ClassInfo, method: MethodInfo) -> str
         params_str = ", ".join(param_strs) if param_strs else ""
 
         lines.append(f"{class_info.name}::{class_info.name}({params_str}) {{")
+        lines.append("    type_id = type_first;")
 
         # Call parent init if parent is Object (the base class)
         if class_info.parent == "Object":
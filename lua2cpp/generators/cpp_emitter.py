@@ -10,7 +10,7 @@ Architecture:
 - Module body with remaining statements
 """
 
-from typing import List, Optional, Set
+from typing import Any, Dict, List, Optional, Set, Tuple
 from pathlib import Path
 
 try:
@@ -23,6 +23,18 @@ from ..core.symbol_table import SymbolTable
 from ..core.types import Type, TypeKind, ASTAnnotationStore
 from ..analyzers.function_registry import FunctionSignatureRegistry
 from ..analyzers.type_resolver import TypeResolver
+from ..analyzers.type_profile import TypeProfile
+from ..analyzers.shape_analyzer import ShapeAnalyzer
+from ..analyzers.const_table_analyzer import ConstTableAnalyzer
+from ..analyzers.escape_analyzer import EscapeAnalyzer
+from ..analyzers.coroutine_analyzer import CoroutineAnalyzer
+from ..analyzers.parallel_analyzer import ParallelAnalyzer
+from ..analyzers.vector_analyzer import VectorAnalyzer
+from ..analyzers.closure_analyzer import ClosureAnalyzer
+from ..analyzers.tail_call_analyzer import TailCallAnalyzer
+from ..analyzers.load_analyzer import LoadAnalyzer
+from ..analyzers.array_loop_analyzer import ArrayLoopAnalyzer
+from ..analyzers.hot_path_analyzer import HotPathAnalyzer
 from .expr_generator import ExprGenerator
 from .stmt_generator import StmtGenerator
 from ..core.library_call_collector import LibraryCallCollector
@@ -31,6 +43,42 @@ from ..core.library_registry import LibraryFunctionRegistry
 from ..core.call_convention import CallConventionRegistry
 
 
+# Known export symbols of the game's engine modules, used to detect module
+# dependencies. Format: {symbol_name: (module_path, cpp_var_name)}
+MODULE_EXPORTS: Dict[str, Tuple[str, str]] = {
+    # engine/object exports
+    "Object": ("engine/object", "object_Object"),
+    # engine/node exports
+    "Node": ("engine/node", "node_Node"),
+    # engine/moveable exports
+    "Moveable": ("engine/moveable", "moveable_Moveable"),
+    # engine/sprite exports
+    "Sprite": ("engine/sprite", "sprite_Sprite"),
+    # game exports
+    "Game": ("game", "game_Game"),
+    # card exports
+    "Card": ("card", "card_Card"),
+    # cardarea exports
+    "CardArea": ("cardarea", "cardarea_CardArea"),
+    # blind exports
+    "Blind": ("blind", "blind_Blind"),
+    # tag exports
+    "Tag": ("tag", "tag_Tag"),
+    # back exports
+    "Back": ("back", "back_Back"),
+    # engine/event exports
+    "Event": ("engine/event", "event_Event"),
+    # engine/animatedsprite exports
+    "AnimatedSprite": ("engine/animatedsprite", "animatedsprite_AnimatedSprite"),
+    # engine/ui exports
+    "UI": ("engine/ui", "ui_UI"),
+    # engine/text exports
+    "Text": ("engine/text", "text_Text"),
+    # engine/particles exports
+    "Particles": ("engine/particles", "particles_Particles"),
+}
+
+
 class CppEmitter:
     """Emits complete C++ code from Lua AST
 
@@ -46,7 +94,9 @@ class CppEmitter:
     6. Returns complete C++ code
     """
 
-    def __init__(self, convention_registry: Optional[CallConventionRegistry] = None, runtime: str = "table") -> None:
+    def __init__(self, convention_registry: Optional[CallConventionRegistry] = None, runtime: str = "table",
+                 instrument: bool = False, profile: Optional[TypeProfile] = None,
+                 library_registry: Optional[LibraryFunctionRegistry] = None, parallel: bool = False) -> None:
         """Initialize C++ emitter with required components
 
         Creates ScopeManager, SymbolTable, and FunctionSignatureRegistry
@@ -55,13 +105,20 @@ class CppEmitter:
         Args:
             convention_registry: Optional registry for call conventions (default: create new)
             runtime: Runtime type: "table" (default TABLE struct) or "lua_table" (TValue/LuaTable)
+            instrument: Emit code that writes a type profile (lua_table runtime)
+            profile: Type profile of an instrumented run to specialize hot functions on
+            library_registry: Optional library registry shared between emitters (default: create new)
+            parallel: Run independent numeric loops on all cores (lua_table runtime)
         """
         self.scope_manager = ScopeManager()
         self.symbol_table = SymbolTable(self.scope_manager)
         self.function_registry = FunctionSignatureRegistry()
-        self._library_registry = LibraryFunctionRegistry()
+        self._library_registry = library_registry or LibraryFunctionRegistry()
         self._convention_registry = convention_registry or CallConventionRegistry()
         self._runtime = runtime
+        self._instrument = instrument
+        self._profile = profile
+        self._parallel = parallel
 
         # Generators for expressions and statements
         self._expr_gen = ExprGenerator(self._library_registry, convention_registry=self._convention_registry)
@@ -81,47 +138,16 @@ class CppEmitter:
         # Track whether 'love.*' API is used
         self._has_love: bool = False
 
-        # Module dependency tracking
-        # Maps known export symbol names to their module info
-        # Format: {symbol_name: (module_path, cpp_var_name)}
-        self._module_export_map = {
-            # engine/object exports
-            "Object": ("engine/object", "object_Object"),
-            # engine/node exports
-            "Node": ("engine/node", "node_Node"),
-            # engine/moveable exports
-            "Moveable": ("engine/moveable", "moveable_Moveable"),
-            # engine/sprite exports
-            "Sprite": ("engine/sprite", "sprite_Sprite"),
-            # game exports
-            "Game": ("game", "game_Game"),
-            # card exports
-            "Card": ("card", "card_Card"),
-            # cardarea exports
-            "CardArea": ("cardarea", "cardarea_CardArea"),
-            # blind exports
-            "Blind": ("blind", "blind_Blind"),
-            # tag exports
-            "Tag": ("tag", "tag_Tag"),
-            # back exports
-            "Back": ("back", "back_Back"),
-            # engine/event exports
-            "Event": ("engine/event", "event_Event"),
-            # engine/animatedsprite exports
-            "AnimatedSprite": ("engine/animatedsprite", "animatedsprite_AnimatedSprite"),
-            # engine/ui exports
-            "UI": ("engine/ui", "ui_UI"),
-            # engine/text exports
-            "Text": ("engine/text", "text_Text"),
-            # engine/particles exports
-            "Particles": ("engine/particles", "particles_Particles"),
-        }
+        # Module dependency tracking: {symbol_name: (module_path, cpp_var_name)}
+        self._module_export_map = dict(MODULE_EXPORTS)
         # Track detected module dependencies
         self._module_deps: Set[str] = set()  # Set of module paths
         self._module_externs: Set[str] = set()  # Set of extern variable names
 
         # Track module-level state variables (locals + implicit globals)
         self._module_state: set[str] = set()
+        # Start of module init (lua_table): root and create this thread's module state
+        self._module_state_init: List[str] = []
 
     def generate_file(self, chunk: astnodes.Chunk, input_file: Optional[Path] = None) -> str:
         """Generate complete C++ file from Lua AST chunk
@@ -161,7 +187,9 @@ class CppEmitter:
         self._type_resolver = TypeResolver(
             self.scope_manager,
             self.symbol_table,
-            self.function_registry
+            self.function_registry,
+            profile=self._profile if self._runtime == "lua_table" else None,
+            module_name=sanitized_filename
         )
         self._type_resolver.resolve_chunk(chunk)
 
@@ -177,22 +205,107 @@ class CppEmitter:
         # Propagate module context to StmtGenerator for name mangling
 
         self._stmt_gen.set_module_context(self._module_prefix, self._module_state)
+        self._stmt_gen.enable_key_interning(self._runtime == "lua_table")
+        self._stmt_gen.enable_typed_closures(self._runtime == "lua_table")
+        self._stmt_gen.enable_presized_tables(self._runtime == "lua_table")
+        self._stmt_gen.enable_integer_loops(self._runtime == "lua_table")
+        self._stmt_gen.enable_integer_ops(self._runtime == "lua_table")
+        self._stmt_gen.enable_inline_caches(self._runtime == "lua_table")
+        self._stmt_gen.enable_concat_builder(self._runtime == "lua_table")
+        self._stmt_gen.enable_string_equality(self._runtime == "lua_table")
+        self._stmt_gen.enable_compiled_patterns(self._runtime == "lua_table")
+        self._stmt_gen.enable_compiled_formats(self._runtime == "lua_table")
+        self._stmt_gen.enable_const_tables(self._runtime == "lua_table")
+        self._stmt_gen.enable_buffered_io(self._runtime == "lua_table")
+        self._stmt_gen.enable_table_iterators(self._runtime == "lua_table")
+        self._stmt_gen.enable_value_packs(self._runtime == "lua_table")
+        self._stmt_gen.enable_profiling(self._instrument and self._runtime == "lua_table")
+        self._stmt_gen.enable_speculation(self._runtime == "lua_table")
+        self._stmt_gen.enable_concrete_signatures(self._runtime == "lua_table")
+        self._stmt_gen.enable_scalar_replacement(self._runtime == "lua_table")
+        self._stmt_gen.enable_unboxed_locals(self._runtime == "lua_table")
+        self._stmt_gen.enable_coroutines(self._runtime == "lua_table")
+        self._stmt_gen.enable_precise_captures(self._runtime == "lua_table")
+        self._stmt_gen.enable_tail_calls(self._runtime == "lua_table")
+        self._stmt_gen.enable_shared_loads(self._runtime == "lua_table")
+        self._stmt_gen.enable_parallel_loops(self._parallel and self._runtime == "lua_table")
+        self._stmt_gen.enable_vector_loops(self._runtime == "lua_table")
+        self._stmt_gen.enable_array_loops(self._runtime == "lua_table")
+        self._stmt_gen.enable_guarded_ops(self._runtime == "lua_table")
+        self._stmt_gen.set_number_state({name for name in self._module_state
+                                         if self.get_inferred_type(name).kind == TypeKind.NUMBER})
+        self._stmt_gen.set_direct_functions(self._collect_direct_table_functions(chunk))
+        self._library_slots = self._collect_library_slots(chunk) if self._runtime == "lua_table" else {}
+        self._stmt_gen.set_library_slots(self._library_slots)
+        if self._runtime == "lua_table":
+            self._stmt_gen.set_record_shapes(ShapeAnalyzer().analyze(chunk))
+            ConstTableAnalyzer().analyze(chunk)
+            EscapeAnalyzer().analyze(chunk)
+            self._stmt_gen.set_coroutine_functions(CoroutineAnalyzer().analyze(chunk))
+            if self._parallel:
+                ParallelAnalyzer().analyze(chunk)
+            VectorAnalyzer().analyze(chunk)
+            ClosureAnalyzer(self._module_state).analyze(chunk)
+            TailCallAnalyzer().analyze(chunk)
+            LoadAnalyzer().analyze(chunk)
+            ArrayLoopAnalyzer().analyze(chunk)
+            HotPathAnalyzer().analyze(chunk)
+            self._stmt_gen.set_function_arities(self._collect_function_arities(chunk))
         # Collect library aliases (pre-pass before emitting namespace)
         self._collect_library_aliases(chunk)
+        self._stmt_gen.set_function_results(self._collect_named_functions(chunk))
 
 
 
+        # lua_table: each thread runs its own l2c::State, so module state is
+        # thread_local; module init roots it and creates its tables
+        self._module_state_init.clear()
         if self._module_state:
             lines.append("// Module state")
             for var_name in sorted(self._module_state):
                 var_type = self.get_inferred_type(var_name)
                 cpp_type = self._get_cpp_type_name(var_type.kind)
+                if self._runtime == "lua_table":
+                    lines.append(f"thread_local {cpp_type} {self._module_prefix}_{var_name};")
+                    if cpp_type == "TABLE":
+                        self._module_state_init.append(f"    {self._module_prefix}_{var_name} = NEW_TABLE;")
                 # Initialize TABLE variables with NEW_TABLE
-                if cpp_type == "TABLE":
+                elif cpp_type == "TABLE":
                     lines.append(f"TABLE {self._module_prefix}_{var_name} = NEW_TABLE;")
                 else:
                     lines.append(f"{cpp_type} {self._module_prefix}_{var_name};")
             lines.append("")
+        if self._library_slots:
+            lines.append("// Library members the module stores to")
+            for var in self._library_slots.values():
+                lines.append(f"thread_local TABLE {var};")
+            lines.append("")
+
+        # Module state and G live outside the stack: register them as GC roots
+        if self._runtime == "lua_table":
+            gc_roots = [
+                f"&{self._module_prefix}_{var_name}"
+                for var_name in sorted(self._module_state)
+                if self._get_cpp_type_name(self.get_inferred_type(var_name).kind) == "TABLE"
+            ]
+            gc_roots.extend(f"&{var}" for var in self._library_slots.values())
+            if self._has_g_table:
+                gc_roots.append("&G")
+            string_roots = [
+                f"&{self._module_prefix}_{var_name}"
+                for var_name in sorted(self._module_state)
+                if self._get_cpp_type_name(self.get_inferred_type(var_name).kind) == "STRING"
+            ]
+            roots = []
+            if gc_roots:
+                roots.append(f"    static thread_local const l2c::GCRoots _l2c_{self._module_prefix}_gc_roots{{{', '.join(gc_roots)}}};")
+            if string_roots:
+                roots.append(f"    static thread_local const l2c::GCRoots _l2c_{self._module_prefix}_gc_string_roots{{{', '.join(string_roots)}}};")
+            self._module_state_init[:0] = roots
+
+        # Interned literal keys are only known after code generation; remember
+        # where to emit them (before any function can reference them)
+        interned_keys_pos = len(lines)
 
         # Emit library alias namespace (BEFORE forward declarations so functions can use them)
         aliases = self._stmt_gen.get_library_aliases()
@@ -200,6 +313,12 @@ class CppEmitter:
             lines.append("// Library function aliases")
             lines.append("namespace l2c_aliases {")
             for alias_info in aliases.values():
+                if self._library_registry.is_constant(alias_info.library, alias_info.cpp_method):
+                    qualifier = "const" if self._library_registry.is_value_constant(
+                        alias_info.library, alias_info.cpp_method) else "constexpr"
+                    lines.append(f"    static {qualifier} auto {alias_info.lua_name} = {alias_info.cpp_qualified};")
+                    continue
+                # Calls bind to the function itself; this is the alias as a value
                 lines.append(
                     f"    static auto {alias_info.lua_name} = "
                     f"[](auto&&... args) {{ return {alias_info.cpp_qualified}(args...); }};"
@@ -239,6 +358,40 @@ class CppEmitter:
         module_init_code = self._generate_module_body_init(sanitized_filename, chunk)
         lines.append(module_init_code)
 
+        shape_decls = self._stmt_gen.get_record_shape_decls()
+        cache_decls = self._stmt_gen.get_inline_cache_decls()
+        interned_keys = self._stmt_gen.get_interned_keys()
+        key_lines = []
+        if interned_keys:
+            key_lines.append("// Interned table keys")
+            for var_name, literal in interned_keys.items():
+                key_lines.append(f"static const TValue {var_name} = l2c::intern({literal});")
+            key_lines.append("")
+            if shape_decls:
+                key_lines.append("// Record shapes")
+                key_lines.extend(shape_decls)
+                key_lines.append("")
+            if cache_decls:
+                key_lines.append("// Inline caches")
+                key_lines.extend(cache_decls)
+                key_lines.append("")
+        pattern_decls = self._stmt_gen.get_pattern_decls()
+        if pattern_decls:
+            key_lines.append("// Compiled patterns")
+            key_lines.extend(pattern_decls)
+            key_lines.append("")
+        format_decls = self._stmt_gen.get_format_decls()
+        if format_decls:
+            key_lines.append("// Compiled format strings")
+            key_lines.extend(format_decls)
+            key_lines.append("")
+        const_decls = self._stmt_gen.get_const_table_decls()
+        if const_decls:
+            key_lines.append("// Constant tables")
+            key_lines.extend(const_decls)
+            key_lines.append("")
+        lines[interned_keys_pos:interned_keys_pos] = key_lines
+
         # Add header comment if input_file provided
         if input_file:
             header_comment = f"// Auto-generated from {input_file}\n// Lua2Cpp Transpiler"
@@ -333,11 +486,21 @@ class CppEmitter:
                 func_name = stmt.name.id if hasattr(stmt.name, 'id') else "anonymous"
                 mangled_name = self._mangle_if_main(func_name)
 
+                if self._stmt_gen.is_coroutine(stmt):
+                    # Coroutines are plain functions of TValues: declarable, so
+                    # yielding functions may await each other in any order
+                    params = ", ".join("TValue" for _ in stmt.args)
+                    declarations.append(f"l2c::CoTask {mangled_name}({params});")
+                    continue
+
                 # Get return type
                 return_type = "auto"
                 type_info = ASTAnnotationStore.get_type(stmt)
                 if type_info is not None:
                     return_type = type_info.cpp_type()
+                if isinstance(stmt.name, astnodes.Name):
+                    # Multi-value functions are defined returning l2c::ReturnPack<N>
+                    return_type = self._stmt_gen.pack_return_type(stmt.body) or return_type
 
                 # Skip forward declaration for auto return type - C++ can't deduce auto from decl
                 if return_type == "auto":
@@ -351,6 +514,8 @@ class CppEmitter:
                 template_param_idx = 1
 
                 for arg in stmt.args:
+                    if isinstance(arg, astnodes.Varargs):
+                        continue
                     param_type = "auto"
                     arg_type_info = ASTAnnotationStore.get_type(arg)
                     if arg_type_info is not None:
@@ -361,9 +526,14 @@ class CppEmitter:
                     params.append(f"T{template_param_idx}")
                     template_param_idx += 1
 
+                template_decls = [f"typename {tp}" for tp in template_params]
+                if self._runtime == "lua_table" and any(isinstance(arg, astnodes.Varargs) for arg in stmt.args):
+                    template_decls.append("typename... VA")
+                    params.append("VA&&...")
+
                 # Build template declaration
-                if template_params:
-                    template_params_str = ", ".join(f"typename {tp}" for tp in template_params)
+                if template_decls:
+                    template_params_str = ", ".join(template_decls)
                     declaration = f"template<{template_params_str}> {return_type} {mangled_name}({', '.join(params)});"
                 else:
                     declaration = f"{return_type} {mangled_name}();"
@@ -647,6 +817,9 @@ class CppEmitter:
         lines.append(f"void {function_name}({params_str}) {{")
         lines.append(f"    // {function_name} - Module initialization")
         lines.append(f"    // This function contains all module-level statements")
+        if self._module_state_init:
+            lines.append("    // This thread's module state: GC roots and tables")
+            lines.extend(self._module_state_init)
 
         global_vars = self._collect_global_variables(chunk)
         for var_name in global_vars:
@@ -904,8 +1077,9 @@ class CppEmitter:
                         is_lib_ref = False
                         if hasattr(stmt, 'values') and i < len(stmt.values):
                             val = stmt.values[i]
-                            # If first value is a function call, it's multi-return
-                            is_multi_return = type(val).__name__ == "Call"
+                            # If first value is a function call, it's multi-return;
+                            # lua_table destructures it into the module state
+                            is_multi_return = type(val).__name__ == "Call" and self._runtime != "lua_table"
                             # Check for library reference like math.random
                             if hasattr(val, 'value') and hasattr(val.value, 'id'):
                                 lib_names = {'math', 'io', 'string', 'table', 'os'}
@@ -958,6 +1132,175 @@ class CppEmitter:
         return module_state
 
 
+    def _collect_direct_table_functions(self, chunk: astnodes.Chunk) -> Dict[Tuple[str, str], Tuple[str, int]]:
+        """Find `function T.m(...)` definitions that calls can bind to statically
+
+        A definition qualifies when it is the only top-level definition of
+        T.m, takes no varargs, and nothing else stores to T.m, to T under a
+        computed key, or to T itself (beyond its one initialization).
+
+        Returns:
+            (table, method) -> (C++ function name, parameter count)
+        """
+        body = chunk.body.body if isinstance(chunk.body.body, list) else [chunk.body.body]
+        library_tables = {'G'}
+        candidates: Dict[Tuple[str, str], Tuple[str, int]] = {}
+        top_level_defs: Set[int] = set()
+        for stmt in body:
+            if (isinstance(stmt, astnodes.Function) and isinstance(stmt.name, astnodes.Index)
+                    and isinstance(stmt.name.value, astnodes.Name)
+                    and isinstance(stmt.name.idx, astnodes.Name)):
+                key = (stmt.name.value.id, stmt.name.idx.id)
+                top_level_defs.add(id(stmt))
+                if key in candidates or any(isinstance(a, astnodes.Varargs) for a in stmt.args):
+                    candidates[key] = None
+                    continue
+                candidates[key] = (self._mangle_if_main(f"{key[0]}_{key[1]}"), len(stmt.args))
+        candidates = {k: v for k, v in candidates.items() if v is not None and k[0] not in library_tables}
+        if not candidates:
+            return {}
+
+        tables = {t for t, _ in candidates}
+        blocked_keys: Set[Tuple[str, str]] = set()
+        blocked_tables: Set[str] = set()
+        table_inits: Dict[str, int] = {}
+
+        def check_store(target: astnodes.Node) -> None:
+            if isinstance(target, astnodes.Name) and target.id in tables:
+                table_inits[target.id] = table_inits.get(target.id, 0) + 1
+            elif (isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name)
+                    and target.value.id in tables):
+                idx = target.idx
+                if isinstance(idx, astnodes.Name) and str(getattr(target, 'notation', '')) == "IndexNotation.DOT":
+                    blocked_keys.add((target.value.id, idx.id))
+                elif isinstance(idx, astnodes.String):
+                    content = idx.s.decode() if isinstance(idx.s, bytes) else idx.s
+                    blocked_keys.add((target.value.id, content))
+                else:
+                    blocked_tables.add(target.value.id)
+
+        def walk(node: astnodes.Node) -> None:
+            if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                for target in node.targets:
+                    check_store(target)
+            elif isinstance(node, astnodes.Function) and id(node) not in top_level_defs:
+                check_store(node.name)
+            for attr_name in dir(node):
+                if not attr_name.startswith('_') and attr_name not in ('fields', 'key'):
+                    attr = getattr(node, attr_name, None)
+                    if isinstance(attr, astnodes.Node):
+                        walk(attr)
+                    elif isinstance(attr, (list, tuple)):
+                        for item in attr:
+                            if isinstance(item, astnodes.Node):
+                                walk(item)
+
+        walk(chunk)
+        return {
+            key: target for key, target in candidates.items()
+            if key not in blocked_keys and key[0] not in blocked_tables
+            and table_inits.get(key[0], 0) <= 1
+        }
+
+    def _collect_function_arities(self, chunk: astnodes.Chunk) -> Dict[str, int]:
+        """Parameter counts of the top-level named functions calls bind to statically
+
+        Functions with varargs, coroutines and names defined twice are left out.
+
+        Returns:
+            C++ function name -> parameter count
+        """
+        body = chunk.body.body if isinstance(chunk.body.body, list) else [chunk.body.body]
+        arities: Dict[str, Optional[int]] = {}
+        for stmt in body:
+            if not isinstance(stmt, (astnodes.LocalFunction, astnodes.Function)) \
+                    or not isinstance(stmt.name, astnodes.Name):
+                continue
+            name = self._mangle_if_main(stmt.name.id)
+            if name in arities or self._stmt_gen.is_coroutine(stmt) \
+                    or any(isinstance(a, astnodes.Varargs) for a in stmt.args):
+                arities[name] = None
+                continue
+            arities[name] = len(stmt.args)
+        return {name: n for name, n in arities.items() if n is not None}
+
+    def _collect_named_functions(self, chunk: astnodes.Chunk) -> Dict[str, Any]:
+        """The top-level named functions calls bind to statically, by C++ name
+
+        Coroutines and names defined twice are left out.
+        """
+        body = chunk.body.body if isinstance(chunk.body.body, list) else [chunk.body.body]
+        functions: Dict[str, Any] = {}
+        excluded = set()
+        for stmt in body:
+            if not isinstance(stmt, (astnodes.LocalFunction, astnodes.Function)) \
+                    or not isinstance(stmt.name, astnodes.Name):
+                continue
+            name = self._mangle_if_main(stmt.name.id)
+            if name in functions or self._stmt_gen.is_coroutine(stmt):
+                excluded.add(name)
+            functions[name] = stmt
+        return {name: fn for name, fn in functions.items() if name not in excluded}
+
+    def _collect_library_slots(self, chunk: astnodes.Chunk) -> Dict[Tuple[str, str], str]:
+        """Find the library members the module stores to, like `function string.trim(s)`
+
+        Library members are otherwise bound at compile time
+        (LibraryFunctionRegistry.cpp_binding). A member the module assigns
+        or defines lives in a module-state variable instead, which its
+        reads, calls and stores go through. Libraries the module rebinds as
+        names are user tables and are left alone.
+
+        Returns:
+            (library, member) -> C++ variable
+        """
+        stored: List[Tuple[str, str]] = []
+        rebound: Set[str] = set()
+
+        def check_store(target: Any) -> None:
+            if isinstance(target, astnodes.Name):
+                rebound.add(target.id)
+            elif (isinstance(target, astnodes.Index) and isinstance(target.value, astnodes.Name)
+                    and self._library_registry.is_standard_library(target.value.id)):
+                key = None
+                if isinstance(target.idx, astnodes.Name) and str(getattr(target, 'notation', '')) == "IndexNotation.DOT":
+                    key = target.idx.id
+                elif isinstance(target.idx, astnodes.String):
+                    key = target.idx.s.decode() if isinstance(target.idx.s, bytes) else target.idx.s
+                if key is not None and key.isidentifier() and (target.value.id, key) not in stored:
+                    stored.append((target.value.id, key))
+
+        def walk(node: Any) -> None:
+            if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+                for target in node.targets:
+                    check_store(target)
+            elif isinstance(node, (astnodes.Function, astnodes.LocalFunction)):
+                check_store(node.name)
+            elif isinstance(node, astnodes.Method):
+                check_store(astnodes.Index(node.name, node.source, astnodes.IndexNotation.DOT))
+            if isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.Method,
+                                 astnodes.AnonymousFunction)):
+                for arg in node.args:
+                    check_store(arg)
+            elif isinstance(node, astnodes.Fornum):
+                check_store(node.target)
+            elif isinstance(node, astnodes.Forin):
+                for target in node.targets:
+                    check_store(target)
+            for attr_name in dir(node):
+                if not attr_name.startswith('_') and attr_name not in ('fields', 'key'):
+                    attr = getattr(node, attr_name, None)
+                    if isinstance(attr, astnodes.Node):
+                        walk(attr)
+                    elif isinstance(attr, (list, tuple)):
+                        for item in attr:
+                            if isinstance(item, astnodes.Node):
+                                walk(item)
+
+        walk(chunk)
+        return {(lib, key): f"_l2c_{self._module_prefix}_{lib}_{key}"
+                for lib, key in stored if lib not in rebound}
+
     def _collect_library_aliases(self, chunk: astnodes.Chunk) -> None:
         """Pre-pass to collect library function aliases like `local write = io.write`
         
@@ -989,18 +1332,9 @@ class CppEmitter:
                     if not isinstance(value.idx, astnodes.Name):
                         continue
                     
-                    lib_name = value.value.id
-                    if lib_name not in lib_map:
+                    if value.value.id not in lib_map:
                         continue
-                    
-                    # Import the AliasInfo from stmt_generator
-                    from .stmt_generator import AliasInfo
-                    alias_info = AliasInfo(
-                        lua_name=target.id,
-                        cpp_lib=lib_map[lib_name],
-                        cpp_method=value.idx.id,
-                        cpp_qualified=f"{lib_map[lib_name]}::{value.idx.id}"
-                    )
+                    alias_info = self._stmt_gen._extract_alias_info(target, value)
                     self._stmt_gen._library_aliases[alias_info.lua_name] = alias_info
 
     def _collect_implicit_globals_in_function(self, func_node, local_declared: Set[str]) -> Set[str]:
@@ -4,11 +4,12 @@ Generates C++ code from Lua AST expression nodes.
 Implements double-dispatch pattern for literal and name expressions.
 """
 
-from typing import Any, Optional, Set, TYPE_CHECKING, Dict
+from dataclasses import dataclass, field
+from typing import Any, Optional, Set, TYPE_CHECKING, Dict, List, Tuple
 from ..core.ast_visitor import ASTVisitor
 from ..core.library_registry import LibraryFunctionRegistry as _LibraryFunctionRegistry
 from ..core.call_convention import CallConventionRegistry, CallConvention, flatten_index_chain_parts, get_root_module
-from ..core.types import ASTAnnotationStore, TypeKind
+from ..core.types import ASTAnnotationStore, TypeKind, integer_limit, is_wide_integer
 
 try:
     from luaparser import astnodes
@@ -21,6 +22,26 @@ if TYPE_CHECKING:
     from ..core.library_registry import LibraryFunctionRegistry
 
 
+_DIGITS = "0123456789"
+# The conversions append_format implements
+_FORMAT_CONVERSIONS = "diouxXcsqfFeEgGaA"
+
+
+@dataclass
+class MethodReceiver:
+    """A variable whose class ClassGenerator knows, like self in its methods
+
+    this: the C++ pointer to the object
+    dispatch: per method, how calls bind (ClassGenerator.method_dispatch)
+    classes: the generated classes, which `obj:is(Class)` tests for
+    members: the fields the class declares as data members
+    """
+    this: str
+    dispatch: Dict[str, List[Tuple[str, str]]]
+    classes: Set[str]
+    members: Set[str] = field(default_factory=set)
+
+
 class ExprGenerator(ASTVisitor):
     """Generates C++ code from Lua AST expression nodes
 
@@ -55,12 +76,121 @@ class ExprGenerator(ASTVisitor):
         self._module_state: Set[str] = set()
         # Function-local variable tracking for proper scoping
         self._function_locals: Set[str] = set()
+        # Numeric for-loop variables held in int64_t counters
+        self._integer_locals: Set[str] = set()
+        # Locals whose C++ type is double / bool, and NUMBER module state
+        # (lua_table runtime): such values stay unboxed through `and`,
+        # `or`, `not` and loop bounds
+        self._unboxed_locals = False
+        self._number_locals: Set[str] = set()
+        self._bool_locals: Set[str] = set()
+        self._number_state: Set[str] = set()
         self._template_functions: Set[str] = set()
 
+        # Literal string keys interned once at module init (lua_table runtime)
+        # Maps C++ variable name -> escaped C++ string literal
+        self._intern_keys = False
+        self._interned_keys: Dict[str, str] = {}
+        self._interned_key_names: Dict[str, str] = {}
+        # Lambda-free, exactly sized table constructors (lua_table runtime)
+        self._presized_tables = False
+        # Record shapes from ShapeAnalyzer (lua_table runtime); the ones
+        # referenced by emitted code are declared at module scope
+        self._record_shapes: List[Tuple[str, ...]] = []
+        self._used_shapes: Set[int] = set()
+        # `..` chains as one l2c::concat call (lua_table runtime)
+        self._concat_builder = False
+        # == and ~= of two STRING values by content (lua_table runtime)
+        self._string_equality = False
+        # Per-site inline caches for constant-key field access (lua_table
+        # runtime): id(Index node) -> cache variable, cache variable -> site label
+        self._inline_caches = False
+        self._site_caches: Dict[int, str] = {}
+        self._cache_sites: Dict[str, str] = {}
+        # G.k resolves to one cache per global rather than per site:
+        # key -> cache variable
+        self._global_slots: Dict[str, str] = {}
+        # String-literal patterns compiled once at module init (lua_table
+        # runtime): escaped pattern -> l2c::Pattern variable
+        self._compiled_patterns = False
+        self._patterns: Dict[str, str] = {}
+        # Literal string.format formats split into segments at transpile
+        # time (lua_table runtime): escaped format -> (l2c::FormatSegment
+        # array variable, its initializer)
+        self._compiled_formats = False
+        self._formats: Dict[str, Tuple[str, str]] = {}
+        # Constructors ConstTableAnalyzer marked, laid out once at module
+        # scope (lua_table runtime): their l2c::ConstTable declarations
+        self._const_tables = False
+        self._const_table_decls: List[str] = []
+        # Guarded fast paths for the loop arithmetic HotPathAnalyzer marked
+        # (lua_table runtime); _guarded_read is the operand being read
+        self._guarded_ops = False
+        self._guarded_read: Optional[int] = None
+        # `...` of a vararg function is the C++ pack _l2c_va, copied to
+        # l2c::Values _l2c_varargs only for indexed uses (lua_table runtime)
+        self._value_packs = False
+        self._varargs_in_scope = False
+        # Arguments annotated 'box_arg' are passed to a concrete TValue
+        # parameter (lua_table runtime)
+        self._concrete_signatures = False
+        # `t.k` of a table EscapeAnalyzer scalar-replaced reads the local
+        # holding the field (lua_table runtime)
+        self._scalar_replacement = False
+        # `//`, `%` and the bitwise operators on proven integers compute in
+        # int64_t (lua_table runtime)
+        self._integer_ops = False
+
+        # Reads LoadAnalyzer annotated 'load' use the TValue the statement
+        # generator declared for them, once it has (lua_table runtime)
+        self._shared_loads = False
+        self._declared_loads: Set[str] = set()
+
+        # Slots ArrayLoopAnalyzer annotated 'array_slot' index the LuaTable*
+        # l2c::array_span found for (loop variable, table), while the
+        # statement generator is generating the loop body that guard admits
+        self._array_spans: Dict[Tuple[str, str], str] = {}
+
+        # Anonymous functions capture the list ClosureAnalyzer annotated,
+        # reading boxed locals through their l2c::Upvalue (lua_table runtime)
+        self._precise_captures = False
+
+        # Calls and yields annotated by CoroutineAnalyzer suspend the C++
+        # coroutine they are in; the yielding named functions, by arity
+        self._coroutines = False
+        self._coroutine_functions: Dict[str, int] = {}
+        # The Call generate_pack_source is generating: it awaits all values
+        self._pack_source: Any = None
+
+        # `function T.m` definitions that calls may bind to directly:
+        # (table, method) -> (C++ function name, parameter count)
+        self._direct_functions: Dict[Tuple[str, str], Tuple[str, int]] = {}
+        self._defined_direct_functions: Set[Tuple[str, str]] = set()
+        # Top-level named functions without varargs, by parameter count: a
+        # last multi-value argument spreads over their parameters
+        self._function_arities: Dict[str, int] = {}
+        # Top-level named functions returning several values (call_results),
+        # and those taking `...`, by the parameter count before it
+        self._function_results: Dict[str, int] = {}
+        self._vararg_functions: Dict[str, int] = {}
+        # Library members the module stores to (lua_table runtime):
+        # (library, name) -> the module-state variable holding the value
+        self._library_slots: Dict[Tuple[str, str], str] = {}
+        # Variables whose class ClassGenerator knows, like self in a method
+        self._method_receivers: Dict[str, MethodReceiver] = {}
+
     def set_module_context(self, prefix: str, module_state: Set[str]) -> None:
         self._module_prefix = prefix
         self._module_state = module_state
 
+    def module_state_var(self, name: str) -> Optional[str]:
+        """C++ variable of module state `name` where a local doesn't shadow it"""
+        if name in getattr(self._stmt_gen, '_library_aliases', {}) or name in self._integer_locals:
+            return None
+        if name in self._function_locals or name not in self._module_state:
+            return None
+        return f"{self._module_prefix}_{name}"
+
     def enter_function(self, local_names: Optional[Set[str]] = None):
         """Enter function scope with optional local variable names.
 
@@ -68,10 +198,14 @@ class ExprGenerator(ASTVisitor):
             local_names: Set of local variable names to track.
         """
         self._function_locals = local_names if local_names else set()
+        self._number_locals = set()
+        self._bool_locals = set()
 
     def exit_function(self):
         """Exit function scope, clear local variables."""
         self._function_locals = set()
+        self._number_locals = set()
+        self._bool_locals = set()
 
     def record_template_function(self, name: str) -> None:
         self._template_functions.add(name)
@@ -79,6 +213,655 @@ class ExprGenerator(ASTVisitor):
     def is_template_function(self, name: str) -> bool:
         return name in self._template_functions
 
+    def set_direct_functions(self, functions: Dict[Tuple[str, str], Tuple[str, int]]) -> None:
+        """Set the `function T.m` definitions eligible for direct calls"""
+        self._direct_functions = functions
+        self._defined_direct_functions = set()
+
+    def set_function_arities(self, arities: Dict[str, int]) -> None:
+        """Set the functions a multi-value argument can spread over"""
+        self._function_arities = arities
+
+    def set_function_results(self, results: Dict[str, int], varargs: Dict[str, int]) -> None:
+        """Set the functions returning several values, and those taking `...`"""
+        self._function_results = results
+        self._vararg_functions = varargs
+
+    def set_library_slots(self, slots: Dict[Tuple[str, str], str]) -> None:
+        """Set the library members the module stores to, and their variables"""
+        self._library_slots = slots
+
+    def set_method_receivers(self, receivers: Dict[str, MethodReceiver]) -> None:
+        """Set the variables whose class is known, for their fields and method calls"""
+        self._method_receivers = receivers
+
+    def _receiver_field(self, node: astnodes.Index) -> Optional[Tuple[MethodReceiver, str]]:
+        """(receiver, field) for `self.k` on a receiver of known class"""
+        if not (isinstance(node.value, astnodes.Name) and isinstance(node.idx, astnodes.Name)
+                and str(getattr(node, 'notation', '')) == "IndexNotation.DOT"):
+            return None
+        receiver = self._method_receivers.get(node.value.id)
+        return (receiver, node.idx.id) if receiver is not None else None
+
+    def library_slot(self, lib_name: str, name: str) -> Optional[str]:
+        """Variable holding lib.name when the module stores to it, else None
+
+        Every other library member is bound at compile time; these are
+        read, called and stored through the variable instead.
+        """
+        if lib_name in self._function_locals:
+            return None
+        return self._library_slots.get((lib_name, name))
+
+    def mark_function_defined(self, table_name: str, method_name: str) -> None:
+        """Record that T_m has been emitted, so later calls can name it"""
+        self._defined_direct_functions.add((table_name, method_name))
+
+    def _direct_call_target(self, node: astnodes.Call) -> Optional[str]:
+        """Get the C++ function a `T.m(args)` call can invoke directly
+
+        Bypasses the table lookup and closure call when T.m is a known,
+        never-reassigned definition that is already emitted (C++ needs it
+        declared before use) and the call passes exactly its parameters.
+        """
+        func = node.func
+        if not (isinstance(func, astnodes.Index)
+                and isinstance(func.value, astnodes.Name)
+                and isinstance(func.idx, astnodes.Name)
+                and str(getattr(func, 'notation', '')) == "IndexNotation.DOT"):
+            return None
+        key = (func.value.id, func.idx.id)
+        target = self._direct_functions.get(key)
+        if target is None or key not in self._defined_direct_functions:
+            return None
+        # A local of the same name shadows the module table
+        if func.value.id in self._function_locals:
+            return None
+        cpp_name, param_count = target
+        if len(node.args) != param_count:
+            return None
+        return cpp_name
+
+    def enable_key_interning(self, enabled: bool = True) -> None:
+        """Emit literal string table keys as interned TValues
+
+        Only the lua_table runtime provides l2c::intern, so this is off by default.
+        """
+        self._intern_keys = enabled
+
+    def enable_presized_tables(self, enabled: bool = True) -> None:
+        """Emit table constructors as l2c::TableCtor<nArr, nHash>{...}
+
+        Only the lua_table runtime provides l2c::TableCtor, so this is off by default.
+        """
+        self._presized_tables = enabled
+
+    def enable_concat_builder(self, enabled: bool = True) -> None:
+        """Emit each `..` chain as a single variadic l2c::concat(...) call
+
+        Only the lua_table runtime provides l2c::concat, so this is off by default.
+        """
+        self._concat_builder = enabled
+
+    def enable_string_equality(self, enabled: bool = True) -> None:
+        """Compare two STRING (const char*) operands of == and ~= by content
+
+        The lua_table runtime's strings from .., sub, format and the like
+        are collector-owned rather than interned, so equal strings in two
+        STRING locals need not share an address. Off by default.
+        """
+        self._string_equality = enabled
+
+    def enable_inline_caches(self, enabled: bool = True) -> None:
+        """Emit constant-key field accesses through per-site l2c::InlineCache cells
+
+        Requires key interning; only the lua_table runtime provides
+        l2c::getcached, so this is off by default.
+        """
+        self._inline_caches = enabled
+
+    def enable_compiled_patterns(self, enabled: bool = True) -> None:
+        """Pass string-literal patterns to find/match/gmatch/gsub as module-level l2c::Pattern
+
+        Only the lua_table runtime provides l2c::Pattern, so this is off by default.
+        """
+        self._compiled_patterns = enabled
+
+    def enable_compiled_formats(self, enabled: bool = True) -> None:
+        """Pass string.format calls with a literal format to l2c::format, split into segments
+
+        Only the lua_table runtime provides l2c::FormatSegment, so this is off by default.
+        """
+        self._compiled_formats = enabled
+
+    def enable_const_tables(self, enabled: bool = True) -> None:
+        """Emit the constructors ConstTableAnalyzer marked as module-level l2c::ConstTable data
+
+        Only the lua_table runtime provides l2c::ConstTable, so this is off by default.
+        """
+        self._const_tables = enabled
+
+    def enable_guarded_ops(self, enabled: bool = True) -> None:
+        """Emit hot arithmetic and indexing as l2c::guarded_* fast paths
+
+        Only the lua_table runtime provides them, so this is off by default.
+        """
+        self._guarded_ops = enabled
+
+    def enable_value_packs(self, enabled: bool = True) -> None:
+        """Lower `...` to a C++ parameter pack and select() to pack operations
+
+        A last multi-value argument (call_results) spreads its values over
+        the callee's parameters too. Only the lua_table runtime provides
+        l2c::Values, so this is off by default.
+        """
+        self._value_packs = enabled
+
+    def enable_concrete_signatures(self, enabled: bool = True) -> None:
+        """Box the arguments TypeResolver passes to a concrete TValue parameter"""
+        self._concrete_signatures = enabled
+
+    def enable_unboxed_locals(self, enabled: bool = True) -> None:
+        """Keep values proven to be numbers or booleans unboxed"""
+        self._unboxed_locals = enabled
+
+    def enable_integer_ops(self, enabled: bool = True) -> None:
+        """Compute Lua 5.4 integer operators on proven integers in int64_t"""
+        self._integer_ops = enabled
+
+    def enable_shared_loads(self, enabled: bool = True) -> None:
+        """Read x.k from the load LoadAnalyzer shares it with"""
+        self._shared_loads = enabled
+
+    def declare_loads(self, names: List[str]) -> None:
+        """The shared loads now in scope"""
+        self._declared_loads.update(names)
+
+    def array_slot(self, node: astnodes.Index) -> Optional[Tuple[str, str]]:
+        """(LuaTable*, array index) of a slot t[i + k] under its loop's guard, or None"""
+        slot = ASTAnnotationStore.get_annotation(node, 'array_slot')
+        if slot is None or not self._array_spans:
+            return None
+        var, k = slot
+        table = self._array_spans.get((var, node.value.id))
+        if table is None:
+            return None
+        k -= 1
+        return table, var if k == 0 else f"{var} {'+' if k > 0 else '-'} {abs(k)}"
+
+    def enable_precise_captures(self, enabled: bool = True) -> None:
+        """Give lambdas the capture lists ClosureAnalyzer annotated"""
+        self._precise_captures = enabled
+
+    def enable_coroutines(self, enabled: bool = True) -> None:
+        """Await the calls and yields CoroutineAnalyzer annotated"""
+        self._coroutines = enabled
+
+    def set_coroutine_functions(self, arities: Dict[str, int]) -> None:
+        """Set the named functions lowered to coroutines, with their parameter counts"""
+        self._coroutine_functions = arities
+
+    def coroutine_starter(self, node: Any) -> Optional[str]:
+        """For a Name of a yielding function, a closure starting it (ClosureImpl::start)"""
+        if not self._coroutines or not isinstance(node, astnodes.Name) \
+                or node.id not in self._coroutine_functions:
+            return None
+        name = "_l2c_main" if node.id == "main" else node.id
+        params = [f"a{k}" for k in range(1, self._coroutine_functions[node.id] + 1)]
+        return f"[]({', '.join(f'TValue {p}' for p in params)}) {{ return {name}({', '.join(params)}); }}"
+
+    def _coroutine_call(self, node: astnodes.Call, call: str, args: List[str]) -> Optional[str]:
+        """A call that suspends, or None: awaited in a coroutine, run to completion outside"""
+        if not self._coroutines:
+            return None
+        mode = ASTAnnotationStore.get_annotation(node, 'coroutine_yield')
+        if mode is not None:
+            awaitable = f"l2c::coroutine_yield({', '.join(args)})"
+            if mode != "await":
+                return f"l2c::co::yield_unlowered({', '.join(args)})"
+        else:
+            annotation = ASTAnnotationStore.get_annotation(node, 'coroutine_call')
+            if annotation is None:
+                return None
+            mode, arity = annotation
+            awaitable = f"{call}({', '.join((args + ['NIL'] * arity)[:arity])})"
+            if mode != "await":
+                return f"l2c::co::run({awaitable})"
+        if node is self._pack_source:
+            return f"(co_await l2c::co::all({awaitable}))"
+        return f"(co_await {awaitable})"
+
+    def set_number_state(self, names: Set[str]) -> None:
+        """Set the module state declared NUMBER"""
+        self._number_state = names
+
+    def declare_unboxed(self, name: str, init: Any, cpp_type: str = "auto") -> None:
+        """Record whether a local declared `cpp_type name = init` is a double or a bool
+
+        Pass init None for any declaration that is neither.
+        """
+        self._number_locals.discard(name)
+        self._bool_locals.discard(name)
+        if init is None or not self._unboxed_locals:
+            return
+        if cpp_type == "NUMBER" or (cpp_type == "auto" and self.number_expr(init) is not None):
+            self._number_locals.add(name)
+        elif cpp_type == "BOOLEAN" or (cpp_type == "auto" and self.is_boolean(init)):
+            self._bool_locals.add(name)
+
+    def declare_number(self, name: str) -> None:
+        """Record a local declared `double`"""
+        if self._unboxed_locals:
+            self._bool_locals.discard(name)
+            self._number_locals.add(name)
+
+    def save_unboxed(self, shadowed: Tuple[str, ...] = ()) -> Tuple[Set[str], Set[str]]:
+        """Save the unboxed locals, forgetting the names a new binding shadows"""
+        saved = (set(self._number_locals), set(self._bool_locals))
+        self._number_locals.difference_update(shadowed)
+        self._bool_locals.difference_update(shadowed)
+        return saved
+
+    def restore_unboxed(self, saved: Tuple[Set[str], Set[str]]) -> None:
+        self._number_locals, self._bool_locals = saved
+
+    def number_expr(self, node: Any) -> Optional[str]:
+        """Generate a double expression for a value proven to be a number
+
+        Numbers are literals, double and integer locals, NUMBER module
+        state, and arithmetic, `%`, `^` and `//` on numbers. Results of
+        bitwise operators and integer literals past 2^53 are left out, as
+        a double could not hold them exactly (see is_wide_integer).
+
+        Returns:
+            C++ double expression, or None if the value may be anything else
+        """
+        if not self._unboxed_locals:
+            return None
+        if isinstance(node, astnodes.Number):
+            return self.generate(node)
+        if isinstance(node, astnodes.Name):
+            name = node.id
+            if name in getattr(self._stmt_gen, '_library_aliases', {}):
+                return None
+            if name in self._integer_locals:
+                return f"static_cast<double>({name})"
+            if name in self._number_locals:
+                return name
+            if name not in self._function_locals and name in self._module_state and name in self._number_state:
+                return f"{self._module_prefix}_{name}"
+            return None
+        if is_wide_integer(node):
+            return None
+        if isinstance(node, astnodes.UMinusOp):
+            operand = self.number_expr(node.operand)
+            return f"-({operand})" if operand is not None else None
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
+        ops = {astnodes.AddOp: "({} + {})", astnodes.SubOp: "({} - {})", astnodes.MultOp: "({} * {})",
+               astnodes.FloatDivOp: "({} / {})", astnodes.ModOp: "l2c::mod({}, {})",
+               astnodes.ExpoOp: "std::pow({}, {})", astnodes.FloorDivOp: "l2c::floor_div({}, {})"}
+        template = ops.get(type(node))
+        if template is None:
+            return None
+        left = self.number_expr(node.left)
+        right = self.number_expr(node.right) if left is not None else None
+        if right is None:
+            return None
+        return template.format(left, right)
+
+    def is_boolean(self, node: Any) -> bool:
+        """Check if a value is proven to be a C++ bool
+
+        Comparisons, `not`, true and false always are; `and`/`or` of two
+        booleans and bool locals too.
+        """
+        if not self._unboxed_locals:
+            return False
+        if isinstance(node, (astnodes.EqToOp, astnodes.NotEqToOp, astnodes.LessThanOp, astnodes.GreaterThanOp,
+                             astnodes.LessOrEqThanOp, astnodes.GreaterOrEqThanOp, astnodes.ULNotOp,
+                             astnodes.TrueExpr, astnodes.FalseExpr)):
+            return True
+        if isinstance(node, (astnodes.AndLoOp, astnodes.OrLoOp)):
+            return self.is_boolean(node.left) and self.is_boolean(node.right)
+        if isinstance(node, astnodes.Name):
+            return node.id in self._bool_locals and node.id not in self._integer_locals
+        return False
+
+    def enable_scalar_replacement(self, enabled: bool = True) -> None:
+        """Lower the field accesses of scalar-replaced tables to their locals"""
+        self._scalar_replacement = enabled
+
+    def scalar_field(self, node: Any) -> Optional[str]:
+        """The local holding a scalar-replaced table's field `t.k`, or None"""
+        if not self._scalar_replacement or not isinstance(node, astnodes.Index):
+            return None
+        return ASTAnnotationStore.get_annotation(node, 'scalar_field')
+
+    def enter_varargs(self, in_scope: bool) -> bool:
+        """Set whether `...` names the enclosing function's pack; returns the previous state"""
+        previous = self._varargs_in_scope
+        self._varargs_in_scope = in_scope and self._value_packs
+        return previous
+
+    def generate_pack_source(self, node: Any) -> str:
+        """Generate a multi-value expression for l2c::take
+
+        `...` and select(n, ...) keep all their values as an l2c::Values,
+        and so do awaited yields and yielding calls.
+        """
+        if self._varargs_in_scope and isinstance(node, astnodes.Varargs):
+            return "_l2c_varargs"
+        select = self._select_varargs(node)
+        if select is not None and select.startswith("_l2c_varargs.select("):
+            return select
+        saved, self._pack_source = self._pack_source, node
+        try:
+            return self.generate(node)
+        finally:
+            self._pack_source = saved
+
+    def call_results(self, node: Any) -> Optional[int]:
+        """How many values a multi-value expression gives, None for a single value
+
+        N >= 2 for a fixed-arity l2c::ReturnPack<N>, 0 for an l2c::Values
+        whose length is only known at run time: `...`, select(n, ...),
+        table.unpack, find and match, and the functions returning those.
+        """
+        if not self._value_packs:
+            return None
+        if isinstance(node, astnodes.Varargs):
+            return 0 if self._varargs_in_scope else None
+        if isinstance(node, astnodes.Invoke):
+            method = node.func.id if isinstance(node.func, astnodes.Name) else None
+            return {'find': 0, 'match': 0, 'gsub': 2}.get(method)
+        if not isinstance(node, astnodes.Call):
+            return None
+        if self._select_varargs(node) is not None:
+            return None if self._select_varargs(node).startswith("NUMBER(") else 0
+        func = node.func
+        if isinstance(func, astnodes.Name):
+            alias = self._library_alias(func)
+            if alias is not None:
+                return self._library_results(alias.library, alias.cpp_method)
+            if func.id in self._function_locals:
+                return None
+            return self._function_results.get("_l2c_main" if func.id == "main" else func.id)
+        if (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+                and isinstance(func.idx, astnodes.Name) and func.value.id not in self._function_locals
+                and str(getattr(func, 'notation', '')) == "IndexNotation.DOT"
+                and self.library_slot(func.value.id, func.idx.id) is None):
+            return self._library_results(func.value.id, func.idx.id)
+        return None
+
+    @staticmethod
+    def _library_results(lib_name: str, name: str) -> Optional[int]:
+        if lib_name == 'string':
+            return {'find': 0, 'match': 0, 'gsub': 2}.get(name)
+        return 0 if (lib_name, name) == ('table', 'unpack') else None
+
+    def _first_result(self, node: Any, call: str) -> str:
+        """A multi-value call where one value is wanted: its first, as a TValue"""
+        if node is self._pack_source or self.call_results(node) is None:
+            return call
+        return f"l2c::as_value({call})"
+
+    def _select_varargs(self, node: Any) -> Optional[str]:
+        """select('#', ...) as the pack size, select(n, ...) as an l2c::Values suffix"""
+        if not (self._varargs_in_scope and isinstance(node, astnodes.Call)
+                and isinstance(node.func, astnodes.Name) and node.func.id == 'select'
+                and len(node.args) == 2 and isinstance(node.args[1], astnodes.Varargs)):
+            return None
+        count = node.args[0]
+        if isinstance(count, astnodes.String) and self._literal_key_content(count) == '#':
+            return "NUMBER(sizeof...(_l2c_va))"
+        return f"_l2c_varargs.select(int64_t(l2c::as_value({self.generate(count)}).asNumber()))"
+
+    def pattern_decls(self) -> List[str]:
+        """Module-scope l2c::Pattern declarations, one per distinct literal pattern"""
+        return [f'static const l2c::Pattern {var}{{"{literal}"}};' for literal, var in self._patterns.items()]
+
+    def format_decls(self) -> List[str]:
+        """Module-scope l2c::FormatSegment arrays, one per distinct literal format"""
+        return [f'static constexpr l2c::FormatSegment {var}[] = {{{init}}};' for var, init in self._formats.values()]
+
+    def const_table_decls(self) -> List[str]:
+        """Module-scope l2c::ConstTable declarations, one per constant table constructor"""
+        return self._const_table_decls
+
+    def compiled_pattern(self, node: Any) -> Optional[str]:
+        """Return the l2c::Pattern variable for a string-literal pattern argument, or None"""
+        if not self._compiled_patterns or not isinstance(node, astnodes.String):
+            return None
+        literal = self._escape_string(self._literal_key_content(node))
+        if literal not in self._patterns:
+            self._patterns[literal] = f"_l2c_pat_{len(self._patterns)}"
+        return self._patterns[literal]
+
+    def _pattern_args(self, method_name: str, arg_nodes: List[Any], args: List[str], index: int) -> List[str]:
+        """Substitute the precompiled pattern for args[index] of a pattern function
+
+        A find with a `plain` argument keeps its literal string.
+        """
+        if method_name not in ('find', 'match', 'gmatch', 'gsub') or len(arg_nodes) <= index:
+            return args
+        if method_name == 'find' and len(arg_nodes) > index + 2:
+            return args
+        var = self.compiled_pattern(arg_nodes[index])
+        if var is None:
+            return args
+        return args[:index] + [var] + args[index + 1:]
+
+    @staticmethod
+    def _format_segments(fmt: str) -> Optional[List[Tuple[str, str]]]:
+        """Split a string.format format into (text, spec) pairs, spec "" for the text after the last spec
+
+        Specs are delimited as find_spec_end does at run time. Returns None
+        when a conversion is unknown or the format holds a NUL, which the
+        runtime parser's C string stops at.
+        """
+        if '\0' in fmt:
+            return None
+        segments: List[Tuple[str, str]] = []
+        text = ""
+        i = 0
+        while i < len(fmt):
+            if fmt[i] != '%':
+                text += fmt[i]
+                i += 1
+                continue
+            if fmt.startswith('%%', i):
+                text += '%'
+                i += 2
+                continue
+            j = i + 1
+            while j < len(fmt) and fmt[j] in '-+ #0':
+                j += 1
+            while j < len(fmt) and fmt[j] in _DIGITS:
+                j += 1
+            if j < len(fmt) and fmt[j] == '.':
+                j += 1
+                while j < len(fmt) and fmt[j] in _DIGITS:
+                    j += 1
+            if j < len(fmt) and fmt[j] in 'lhLzj':
+                j += 1
+                if j < len(fmt) and fmt[j] == 'l':
+                    j += 1
+            # append_format keeps specs shorter than 30 characters
+            if j >= len(fmt) or fmt[j] not in _FORMAT_CONVERSIONS or j - i >= 29:
+                return None
+            segments.append((text, fmt[i:j + 1]))
+            text = ""
+            i = j + 1
+        if text:
+            segments.append((text, ""))
+        return segments
+
+    def _compiled_format(self, fmt_node: Any, args: List[str]) -> Optional[str]:
+        """l2c::format over the segments of a string-literal format taking args, or None
+
+        Calls with no argument, or more arguments than the format has
+        conversions, keep the run-time formatter.
+        """
+        if not self._compiled_formats or not args or not isinstance(fmt_node, astnodes.String):
+            return None
+        fmt = self._literal_key_content(fmt_node)
+        segments = self._format_segments(fmt)
+        if segments is None or len(args) > sum(1 for _, spec in segments if spec):
+            return None
+        literal = self._escape_string(fmt)
+        if literal not in self._formats:
+            init = ", ".join(
+                f'{{"{self._escape_string(text)}", "{spec}"}}' if spec else f'{{"{self._escape_string(text)}"}}'
+                for text, spec in segments)
+            self._formats[literal] = (f"_l2c_fmt_{len(self._formats)}", init)
+        return f"l2c::format({self._formats[literal][0]}, {', '.join(args)})"
+
+    def inline_cache_decls(self) -> List[str]:
+        """Module-scope l2c::InlineCache declarations, one per cached site"""
+        return [f'static thread_local l2c::InlineCache {var}{{"{site}"}};' for var, site in self._cache_sites.items()]
+
+    def _inline_cache(self, node: astnodes.Index) -> Optional[str]:
+        """Return the cache variable for a constant-key access site, or None"""
+        if not self._inline_caches:
+            return None
+        key = self._literal_key_content(node.idx)
+        if key is None or key.startswith("__"):
+            return None
+        if id(node) not in self._site_caches:
+            var = f"_l2c_ic_{len(self._cache_sites)}"
+            token = getattr(node, '_first_token', None)
+            line = f":{int(token.line)}" if token else ""
+            self._site_caches[id(node)] = var
+            self._cache_sites[var] = self._escape_string(f"{self._module_prefix}{line} {key}")
+        return self._site_caches[id(node)]
+
+    def _global_slot(self, node: astnodes.Index) -> Optional[Tuple[str, str]]:
+        """Return (cache variable, key variable) for G.k with a constant key k
+
+        Every site naming G.k shares one l2c::InlineCache, so the slot is
+        found at the first access and each later read or overwrite tests
+        it instead of hashing the key. G stays an ordinary table: a store
+        through a computed key, from another module or from a rehash only
+        sends the next access to the slow path, which refills the cache.
+        """
+        if not self._inline_caches:
+            return None
+        is_dot = hasattr(node, 'notation') and str(node.notation) == "IndexNotation.DOT"
+        key_var = self._literal_key_var(node.idx, is_dot)
+        key = self._literal_key_content(node.idx)
+        if key_var is None or key.startswith("__"):
+            return None
+        if key not in self._global_slots:
+            var = f"_l2c_global_{len(self._global_slots)}"
+            self._global_slots[key] = var
+            self._cache_sites[var] = self._escape_string(f"G.{key}")
+        return self._global_slots[key], key_var
+
+    def get_interned_keys(self) -> Dict[str, str]:
+        """Return interned key declarations: C++ variable name -> C++ string literal"""
+        return self._interned_keys
+
+    def interned_key(self, content: str) -> Optional[str]:
+        """Get the module-level variable holding the interned TValue for a literal key
+
+        Args:
+            content: Raw (unescaped) key string
+
+        Returns:
+            C++ variable name, or None if key interning is disabled
+        """
+        if not self._intern_keys:
+            return None
+        if content in self._interned_key_names:
+            return self._interned_key_names[content]
+        base = "".join(c if c.isalnum() or c == "_" else "_" for c in content)
+        var_name = f"_l2c_key_{base}"
+        if var_name in self._interned_keys:
+            var_name = f"{var_name}_{len(self._interned_keys)}"
+        self._interned_keys[var_name] = f'"{self._escape_string(content)}"'
+        self._interned_key_names[content] = var_name
+        return var_name
+
+    def set_record_shapes(self, shapes: List[Tuple[str, ...]]) -> None:
+        """Set the record shapes found by ShapeAnalyzer"""
+        self._record_shapes = shapes
+        self._used_shapes = set()
+
+    def _shape_var(self, shape_id: int) -> str:
+        self._used_shapes.add(shape_id)
+        return f"_l2c_shape_{shape_id}"
+
+    def record_shape_decls(self) -> List[str]:
+        """Module-scope l2c::Shape declarations for the shapes in use
+
+        Interns the shape keys, so call before reading the interned keys.
+        """
+        decls = []
+        for shape_id in sorted(self._used_shapes):
+            keys = ", ".join(self.interned_key(k) for k in self._record_shapes[shape_id])
+            decls.append(f"static const l2c::Shape _l2c_shape_{shape_id}{{{keys}}};")
+        return decls
+
+    def _shape_field(self, node: astnodes.Index) -> Optional[Tuple[str, int, str]]:
+        """Return (shape variable, slot, key variable) for a bound record field access"""
+        if not self._record_shapes or not self._intern_keys:
+            return None
+        field = ASTAnnotationStore.get_annotation(node, 'shape_field')
+        if field is None:
+            return None
+        if isinstance(node.value, astnodes.Name) and node.value.id == "G":
+            return None
+        convention = self._convention_registry.get_config(get_root_module(node)).convention
+        if convention in (CallConvention.NAMESPACE, CallConvention.FLAT, CallConvention.FLAT_NESTED):
+            return None
+        shape_id, slot = field
+        return self._shape_var(shape_id), slot, self.interned_key(node.idx.id)
+
+    def generate_field_store(self, node: Any, value_code: str) -> Optional[str]:
+        """Generate `x.k = value` for a bound record field or an inline-cached site, or None"""
+        if not isinstance(node, astnodes.Index):
+            return None
+        var = self.scalar_field(node)
+        if var is not None:
+            return f"{var} = l2c::as_value({value_code})"
+        slot = self.array_slot(node)
+        if slot is not None:
+            return f"{slot[0]}->arrayset({slot[1]}, l2c::as_value({value_code}))"
+        member = self._receiver_field(node)
+        if member is not None:
+            receiver, name = member
+            if name in receiver.members:
+                return f"{receiver.this}->{name} = {value_code}"
+            key = self.interned_key(name) or f'STRING("{name}")'
+            return f"{receiver.this}->set_field({key}, {value_code})"
+        field = self._shape_field(node)
+        if field is not None:
+            shape_var, slot, key_var = field
+            return f"l2c::setfield({self.generate(node.value)}, {shape_var}, {slot}, {key_var}, {value_code})"
+        site = self._cached_site(node)
+        if site is None:
+            return None
+        cache_var, key_var = site
+        return f"l2c::setcached({self.generate(node.value)}, {cache_var}, {key_var}, {value_code})"
+
+    def _cached_site(self, node: astnodes.Index) -> Optional[Tuple[str, str]]:
+        """Return (cache variable, key variable) for an inline-cached table access"""
+        if not self._inline_caches:
+            return None
+        if isinstance(node.value, astnodes.Name) and node.value.id == "G":
+            return self._global_slot(node)
+        convention = self._convention_registry.get_config(get_root_module(node)).convention
+        if convention in (CallConvention.NAMESPACE, CallConvention.FLAT, CallConvention.FLAT_NESTED):
+            return None
+        is_dot = hasattr(node, 'notation') and str(node.notation) == "IndexNotation.DOT"
+        key_var = self._literal_key_var(node.idx, is_dot)
+        if key_var is None:
+            return None
+        cache_var = self._inline_cache(node)
+        return (cache_var, key_var) if cache_var else None
+
     def generate(self, node: Any) -> str:
         """Generate C++ code from an expression node using double-dispatch
 
@@ -91,6 +874,8 @@ class ExprGenerator(ASTVisitor):
         return self.visit(node)
 
     def visit_Number(self, node: astnodes.Number) -> str:
+        if self._integer_ops and is_wide_integer(node):
+            return f"TValue::Int64(INT64_C({node.n}))"
         return f"NUMBER({node.n})"
 
     def visit_String(self, node: astnodes.String) -> str:
@@ -104,10 +889,15 @@ class ExprGenerator(ASTVisitor):
         """
         # String node's .s attribute contains bytes, need to decode
         content = node.s.decode() if isinstance(node.s, bytes) else node.s
+        return f'"{self._escape_string(content)}"'
+
+    @staticmethod
+    def _escape_string(content: str) -> str:
+        """Escape special characters for a C++ string literal
 
-        # Escape special characters for C++ output
-        # C++ string literals need escapes for: ", \, newline, tab, etc.
-        escaped = (
+        C++ string literals need escapes for: ", \\, newline, tab, etc.
+        """
+        return (
             content
             .replace('\\', '\\\\')
             .replace('"', '\\"')
@@ -115,7 +905,6 @@ class ExprGenerator(ASTVisitor):
             .replace('\r', '\\r')
             .replace('\t', '\\t')
         )
-        return f'"{escaped}"'
 
     def visit_TrueExpr(self, node: astnodes.TrueExpr) -> str:
         """Generate C++ true boolean literal
@@ -160,12 +949,18 @@ class ExprGenerator(ASTVisitor):
             str: Variable name as-is
         """
         name = node.id
+        # A local closures share lives in an l2c::Upvalue cell
+        if self._precise_captures and ASTAnnotationStore.get_annotation(node, 'upvalue'):
+            return f"(*{name})"
         # Check if this is a library alias FIRST (before function_locals)
         # Library aliases are emitted at file scope in l2c_aliases namespace
         if hasattr(self._stmt_gen, '_library_aliases'):
-            if name in self._stmt_gen._library_aliases:
+            if name in self._stmt_gen._library_aliases and name not in self._function_locals:
                 return f"l2c_aliases::{name}"
         
+        # Integer loop counters are read as doubles outside of table keys
+        if name in self._integer_locals:
+            return f"static_cast<double>({name})"
         # Check function-local variables (they shadow module state)
         # Check function-local variables first (they shadow module state)
         if name in self._function_locals:
@@ -193,6 +988,12 @@ class ExprGenerator(ASTVisitor):
         Returns:
             str: C++ addition expression
         """
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
+        guarded = self._guarded_op(node, "add", "({} + {})")
+        if guarded is not None:
+            return guarded
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"({left} + {right})"
@@ -206,6 +1007,12 @@ class ExprGenerator(ASTVisitor):
         Returns:
             str: C++ subtraction expression
         """
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
+        guarded = self._guarded_op(node, "sub", "({} - {})")
+        if guarded is not None:
+            return guarded
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"({left} - {right})"
@@ -219,35 +1026,117 @@ class ExprGenerator(ASTVisitor):
         Returns:
             str: C++ multiplication expression
         """
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
+        guarded = self._guarded_op(node, "mul", "({} * {})")
+        if guarded is not None:
+            return guarded
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"({left} * {right})"
 
     def visit_FloatDivOp(self, node: astnodes.FloatDivOp) -> str:
+        guarded = self._guarded_op(node, "div", "({} / {})")
+        if guarded is not None:
+            return guarded
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"({left} / {right})"
 
+    def _guarded_op(self, node: Any, name: str, template: str) -> Optional[str]:
+        """A hot operation (HotPathAnalyzer) as l2c::guarded_<name>(a, b), or None
+
+        An operand proven a number already takes the runtime's double
+        overloads, so the operation keeps its plain form then; only its
+        indexed operands get the guarded read.
+        """
+        if not self._guarded_ops or not ASTAnnotationStore.get_annotation(node, 'guarded_op'):
+            return None
+        left = self._guarded_operand(node.left)
+        right = self._guarded_operand(node.right)
+        if self.number_expr(node.left) is not None or self.number_expr(node.right) is not None:
+            return template.format(left, right)
+        return f"l2c::guarded_{name}({left}, {right})"
+
+    def _guarded_operand(self, node: Any) -> str:
+        """Generate an operand, reading `t[k]` through l2c::guarded_get if marked"""
+        if not ASTAnnotationStore.get_annotation(node, 'guarded_index'):
+            return self.generate(node)
+        saved, self._guarded_read = self._guarded_read, id(node)
+        try:
+            return self.generate(node)
+        finally:
+            self._guarded_read = saved
+
     def visit_ModOp(self, node: astnodes.ModOp) -> str:
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"l2c::mod({left}, {right})"
 
+    def _visit_bitwise(self, node: Any) -> str:
+        """`//` and the bitwise operators: in int64_t on proven integers,
+        else through the runtime's NUMBER or TValue overloads"""
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
+        number = self.number_expr(node)
+        if number is not None:
+            return number
+        if isinstance(node, astnodes.UBNotOp):
+            return f"l2c::bnot({self.generate(node.operand)})"
+        return self._BITWISE_OPS[type(node)].format(self.generate(node.left), self.generate(node.right))
+
+    visit_FloorDivOp = visit_BAndOp = visit_BOrOp = visit_BXorOp = _visit_bitwise
+    visit_BShiftLOp = visit_BShiftROp = visit_UBNotOp = _visit_bitwise
+
     def visit_ExpoOp(self, node: astnodes.ExpoOp) -> str:
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"std::pow({left}, {right})"
 
     def visit_Concat(self, node: astnodes.Concat) -> str:
+        if self._concat_builder:
+            parts = ", ".join(self.generate(operand) for operand in self._concat_operands(node))
+            return f"l2c::concat({parts})"
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"table_lib::concat({left}, {right})"
 
+    def _concat_operands(self, node: Any) -> List[Any]:
+        """Flatten a `..` chain into its operands, left to right"""
+        if isinstance(node, astnodes.Concat):
+            return self._concat_operands(node.left) + self._concat_operands(node.right)
+        return [node]
+
     def visit_EqToOp(self, node: astnodes.EqToOp) -> str:
         left = self.generate(node.left)
         right = self.generate(node.right)
+        if self._compares_strings(node):
+            return f"l2c::str_equals({left}, {right})"
         return f"({left} == {right})"
 
+    def _compares_strings(self, node: Any) -> bool:
+        """Whether == or ~= may compare two C++ const char*
+
+        That takes a string operand: a literal, a .. chain (l2c::concat)
+        or a value typed STRING; the other one may be any call. Then
+        l2c::str_equals compares two const char* by content and any other
+        pair as ==.
+        """
+        if not self._string_equality:
+            return False
+        return self._is_string_operand(node.left) or self._is_string_operand(node.right)
+
+    def _is_string_operand(self, node: Any) -> bool:
+        if isinstance(node, (astnodes.String, astnodes.Concat)):
+            return True
+        type_info = ASTAnnotationStore.get_type(node)
+        return type_info is not None and type_info.kind == TypeKind.STRING
+
     def visit_LessThanOp(self, node: astnodes.LessThanOp) -> str:
         left = self.generate(node.left)
         right = self.generate(node.right)
@@ -271,14 +1160,26 @@ class ExprGenerator(ASTVisitor):
     def visit_NotEqToOp(self, node: astnodes.NotEqToOp) -> str:
         left = self.generate(node.left)
         right = self.generate(node.right)
+        if self._compares_strings(node):
+            return f"(!l2c::str_equals({left}, {right}))"
         return f"({left} != {right})"
 
     def visit_AndLoOp(self, node: astnodes.AndLoOp) -> str:
+        if self.is_boolean(node):
+            return f"({self.generate(node.left)} && {self.generate(node.right)})"
+        if self.number_expr(node.left) is not None:
+            # A number is truthy
+            return self.generate(node.right)
         left = self.generate(node.left)
         right = self.generate(node.right)
         return f"(({left}) ? ({right}) : ({left}))"
 
     def visit_OrLoOp(self, node: astnodes.OrLoOp) -> str:
+        if self.is_boolean(node):
+            return f"({self.generate(node.left)} || {self.generate(node.right)})"
+        number = self.number_expr(node.left)
+        if number is not None:
+            return number
         # Check if left is AndLoOp (ternary pattern: cond and x or y)
         if isinstance(node.left, astnodes.AndLoOp):
             cond = self.generate(node.left.left)
@@ -305,6 +1206,9 @@ class ExprGenerator(ASTVisitor):
         return f"(({left}) ? ({left}) : ({right}))"
 
     def visit_UMinusOp(self, node: astnodes.UMinusOp) -> str:
+        integer = self._integer_op(node)
+        if integer is not None:
+            return integer
         operand = self.generate(node.operand)
         return f"-({operand})"
 
@@ -313,6 +1217,8 @@ class ExprGenerator(ASTVisitor):
         return f"l2c::get_length({operand})"
 
     def visit_ULNotOp(self, node: astnodes.ULNotOp) -> str:
+        if self.number_expr(node.operand) is not None:
+            return "false"
         operand = self.generate(node.operand)
         return f"(!{operand})"
 
@@ -330,8 +1236,17 @@ class ExprGenerator(ASTVisitor):
         return False
 
     def visit_Call(self, node: astnodes.Call) -> str:
+        select = self._select_varargs(node)
+        if select is not None:
+            # A single value: the first of the suffix
+            return select if select.startswith("NUMBER(") else f"{select}[1]"
+        return self._first_result(node, self._call(node))
+
+    def _call(self, node: astnodes.Call) -> str:
+        # Statically known T.m(...) calls the C++ function itself
+        direct_target = self._direct_call_target(node)
         # Generate the function name for the call (before potential mangling)
-        raw_func_name = self.generate(node.func)
+        raw_func_name = direct_target or self.generate(node.func)
         func = raw_func_name
         # Mangle 'main' function call to avoid C++ ::main conflict
         func = "_l2c_main" if func == "main" else func
@@ -348,16 +1263,25 @@ class ExprGenerator(ASTVisitor):
                 arg_name = arg.id
                 # Mangle 'main' to '_l2c_main' for consistency in the generated code
                 mangled_arg = "_l2c_main" if arg_name == "main" else arg_name
-                if self.is_template_function(arg_name):  # Check original name for registration
+                starter = self.coroutine_starter(arg)
+                if starter is not None:
+                    generated = starter
+                elif self.is_template_function(arg_name):  # Check original name for registration
                     # Wrap template function in lambda for template deduction
                     generated = f"[&](auto&&... args) {{ if constexpr (std::is_void_v<decltype({mangled_arg}(args...))>) {{ {mangled_arg}(args...); return multi_return(NIL, NIL); }} else {{ return multi_return({mangled_arg}(args...), NIL); }} }}"
                 else:
                     generated = self.generate(arg)
+            elif i == len(node.args) - 1 and not isinstance(arg, astnodes.Varargs) \
+                    and self.call_results(arg) is not None:
+                # All its values, for _spread_call
+                generated = self.generate_pack_source(arg)
             else:
                 generated = self.generate(arg)
             
             if generated is None:
                 raise TypeError(f"Cannot generate code for argument {i} of type {type(arg).__name__} in Call to {func}")
+            if self._concrete_signatures and ASTAnnotationStore.get_annotation(arg, 'box_arg'):
+                generated = f"l2c::as_value({generated})"
             args.append(generated)
         # Track call site arg count for this function using the pre-mangled name
         if raw_func_name not in self._call_site_arg_counts or len(node.args) > self._call_site_arg_counts[raw_func_name]:
@@ -367,6 +1291,21 @@ class ExprGenerator(ASTVisitor):
         if is_table_sort:
             self._in_table_sort_context = False
 
+        spread = self._spread_call(node, func, direct_target, args)
+        if spread is not None:
+            return spread
+        if node.args and not isinstance(node.args[-1], astnodes.Varargs) \
+                and self.call_results(node.args[-1]) is not None:
+            args[-1] = f"l2c::as_value({args[-1]})"
+        if direct_target:
+            return f"{func}({', '.join(args)})"
+        alias = self._library_alias(node.func)
+        if alias is not None:
+            return self._library_call(alias.library, alias.cpp_method, node.args, args)
+        suspending = self._coroutine_call(node, func, args)
+        if suspending is not None:
+            return suspending
+
         # Check if this is a call to a global library function (e.g., print, tonumber)
         if self._is_global_function_call(node):
             # Global library functions are in l2c namespace and don't need state parameter
@@ -385,6 +1324,46 @@ class ExprGenerator(ASTVisitor):
             args_str = ", ".join(args) if args else ""
             return f"{func}({args_str})"
 
+    def _spread_call(self, node: astnodes.Call, func: str, direct_target: Optional[str],
+                     args: List[str]) -> Optional[str]:
+        """A call whose last argument has several values (call_results), taking them all
+
+        print and io.write get them as an l2c::Spread; a function of known
+        arity gets the values its remaining parameters take through
+        l2c::spread, and a function taking `...` all of them through
+        l2c::spread_all. Other callees keep getting the first value.
+        """
+        if not node.args or isinstance(node.args[-1], astnodes.Varargs):
+            return None
+        results = self.call_results(node.args[-1])
+        if results is None:
+            return None
+        pack = args[-1] if results == 0 else f"l2c::Values::expand({args[-1]})"
+        if isinstance(node.func, astnodes.Name) and node.func.id == 'print' \
+                and self._is_global_function_call(node) and func in ('print', 'l2c::print'):
+            return f"l2c::print({', '.join(args[:-1] + [f'l2c::Spread{{{pack}}}'])})"
+        if (isinstance(node.func, astnodes.Index) and isinstance(node.func.value, astnodes.Name)
+                and node.func.value.id == 'io' and isinstance(node.func.idx, astnodes.Name)
+                and node.func.idx.id == 'write' and self.library_slot('io', 'write') is None
+                and node.func.value.id not in self._function_locals):
+            return f"l2c::io_write({', '.join(args[:-1] + [f'l2c::Spread{{{pack}}}'])})"
+        spread = None
+        if direct_target is not None:
+            arity = self._direct_functions[(node.func.value.id, node.func.idx.id)][1]
+        elif (isinstance(node.func, astnodes.Name) and node.func.id not in self._function_locals
+              and func == ("_l2c_main" if node.func.id == "main" else node.func.id)):
+            arity = self._function_arities.get(func, 0)
+            if func in self._vararg_functions:
+                spread = "l2c::spread_all" if results == 0 else f"l2c::spread<{results}>"
+        else:
+            return None
+        if spread is None:
+            if arity - (len(args) - 1) < 2:
+                return None
+            spread = f"l2c::spread<{arity - (len(args) - 1)}>"
+        fixed = "".join(f", {a}" for a in args[:-1])
+        return f"{spread}([&](auto&&... _l2c_a) -> decltype(auto) {{ return {func}(_l2c_a...); }}, {pack}{fixed})"
+
     def get_max_call_args(self, func_name: str) -> int:
         """Get the maximum arg count seen for a function."""
         return self._call_site_arg_counts.get(func_name, 0)
@@ -431,6 +1410,10 @@ class ExprGenerator(ASTVisitor):
             args_str = ", ".join(args) if args else ""
             return f"l2c::io_write({args_str})"
         
+        bound = self._bound_method_call(node)
+        if bound is not None:
+            return bound
+
         # Known string methods that should use string_lib::
         STRING_METHODS = {'sub', 'find', 'gmatch', 'gsub', 'format', 'lower', 'upper', 
                          'len', 'rep', 'reverse', 'byte', 'char', 'match', 'dump'}
@@ -439,11 +1422,8 @@ class ExprGenerator(ASTVisitor):
         obj = node.source
         method = node.func
         
-        # Get object name
-        if isinstance(obj, astnodes.Name):
-            obj_name = obj.id
-        else:
-            obj_name = self.generate(obj)
+        # Get object name (module-level locals are mangled like any other use)
+        obj_name = self.generate(obj)
         
         # Get method name
         if isinstance(method, astnodes.Name):
@@ -455,14 +1435,48 @@ class ExprGenerator(ASTVisitor):
         if method_name in STRING_METHODS:
             # String method: seq:sub(a,b) -> string_lib::sub(seq, a, b)
             args = [self.generate(arg) for arg in node.args]
+            if method_name == 'format':
+                compiled = self._compiled_format(obj, args)
+                if compiled is not None:
+                    return compiled
+            args = self._pattern_args(method_name, node.args, args, 0)
             args_str = ", ".join(args) if args else ""
-            return f"string_lib::{method_name}({obj_name}{', ' if args_str else ''}{args_str})"
+            return self._first_result(node, f"string_lib::{method_name}({obj_name}{', ' if args_str else ''}{args_str})")
         else:
             # Generic method call: obj:method() -> obj.method(obj)
             args = [self.generate(arg) for arg in node.args]
             args_str = ", ".join(args) if args else ""
             return f"{obj_name}.{method_name}({obj_name}{', ' if args_str else ''}{args_str})"
 
+    def _bound_method_call(self, node: astnodes.Invoke) -> Optional[str]:
+        """obj:method(args) on a receiver of known class, without a table lookup
+
+        Binds to the method that runs for the receiver's class, testing
+        the type id for each subclass overriding it: self:move(dt) ->
+        (this->is<Enemy>() ? static_cast<Enemy*>(this)->Enemy::move(dt) :
+        this->Entity::move(dt)).
+        """
+        if not isinstance(node.source, astnodes.Name) or not isinstance(node.func, astnodes.Name):
+            return None
+        receiver = self._method_receivers.get(node.source.id)
+        if receiver is None:
+            return None
+        this = receiver.this
+        method_name = node.func.id
+        if (method_name == "is" and len(node.args) == 1 and isinstance(node.args[0], astnodes.Name)
+                and node.args[0].id in receiver.classes):
+            return f"{this}->is<{node.args[0].id}>()"
+        cases = receiver.dispatch.get(method_name)
+        if cases is None:
+            return None
+        args_str = ", ".join(self.generate(arg) for arg in node.args)
+        tested, (_, owner) = cases[:-1], cases[-1]
+        code = f"{this}->{owner}::{method_name}({args_str})"
+        for class_name, owner in reversed(tested):
+            call = f"static_cast<{class_name}*>({this})->{owner}::{method_name}({args_str})"
+            code = f"({this}->is<{class_name}>() ? {call} : {code})"
+        return code
+
     def visit_Dots(self, node: astnodes.Dots) -> str:
         """Handle ... (varargs) in expressions.
         
@@ -472,6 +1486,18 @@ class ExprGenerator(ASTVisitor):
         # Generate a placeholder that won't break compilation
         return "/* variadic args */"
 
+    def visit_Varargs(self, node: astnodes.Varargs) -> str:
+        """Handle ... inside a vararg function (lua_table runtime)
+
+        As the last argument of a call it expands the _l2c_va pack, so the
+        callee sees every value; anywhere else it is the first value.
+        """
+        if not self._varargs_in_scope:
+            return self.visit_Dots(node)
+        if ASTAnnotationStore.get_annotation(node, 'vararg_expand'):
+            return "_l2c_va..."
+        return "_l2c_varargs[1]"
+
     def _is_global_function_call(self, node: astnodes.Call) -> bool:
         """Check if this is a call to a global Lua library function
 
@@ -505,61 +1531,33 @@ class ExprGenerator(ASTVisitor):
     def _generate_library_method_call(self, node: astnodes.Call, args: list) -> str:
         lib_name = node.func.value.id
         method_name = node.func.idx.id if hasattr(node.func.idx, 'id') else str(node.func.idx)
-        
-        lib_func_map = {
-            'io': {'write': 'io_write', 'flush': 'io_flush', 'read': 'io_read'},
-            'string': {'format': 'string_format', 'len': 'string_len', 'sub': 'string_sub', 
-                       'upper': 'string_upper', 'lower': 'string_lower', 'byte': 'string_byte',
-                       'char': 'string_char', 'rep': 'string_rep', 'find': 'string_find',
-                       'gsub': 'string_gsub', 'match': 'string_match', 'gmatch': 'string_gmatch'},
-            'math': {'sqrt': 'math_sqrt', 'abs': 'math_abs', 'floor': 'math_floor',
-                     'ceil': 'math_ceil', 'sin': 'math_sin', 'cos': 'math_cos',
-                     'tan': 'math_tan', 'log': 'math_log', 'exp': 'math_exp',
-                     'pow': 'math_pow', 'min': 'math_min', 'max': 'math_max',
-                     'random': 'math_random', 'randomseed': 'math_randomseed',
-                     'modf': 'math_modf', 'fmod': 'math_fmod', 'atan': 'math_atan',
-                     'asin': 'math_asin', 'acos': 'math_acos', 'deg': 'math_deg',
-                     'rad': 'math_rad', 'huge': 'math_huge'},
-            'table': {'unpack': 'table_unpack', 'remove': 'table_remove', 'sort': 'table_sort',
-                      'concat': 'table_concat', 'insert': 'table_insert', 'pack': 'table_pack'},
-            'os': {'clock': 'os_clock', 'time': 'os_time', 'date': 'os_date', 'exit': 'os_exit',
-                   'difftime': 'os_difftime', 'getenv': 'os_getenv', 'remove': 'os_remove',
-                   'rename': 'os_rename', 'tmpname': 'os_tmpname'},
-        }
-        
-        # Use appropriate namespace based on library
-        args_str = ", ".join(args) if args else ""
-        
-        # String library uses string_lib:: namespace (has TValue-aware implementations)
+        slot = self.library_slot(lib_name, method_name)
+        if slot is not None:
+            # The module stores to lib.name: call whatever it holds
+            return f"{slot}({', '.join(args)})"
+        return self._library_call(lib_name, method_name, node.args, args)
+
+    def _library_alias(self, func: Any) -> Optional[Any]:
+        """AliasInfo of a call through `local f = lib.name`, if func names one"""
+        if not isinstance(func, astnodes.Name) or func.id in self._function_locals:
+            return None
+        alias = getattr(self._stmt_gen, '_library_aliases', {}).get(func.id)
+        if alias is None or not alias.library or self._library_registry is None:
+            return None
+        if self._library_registry.is_constant(alias.library, alias.cpp_method):
+            return None
+        return alias
+
+    def _library_call(self, lib_name: str, method_name: str, arg_nodes: list, args: list) -> str:
+        """Call library function lib.name directly, through its C++ binding"""
         if lib_name == 'string':
-            method_map = {
-                'format': 'format', 'len': 'len', 'sub': 'sub',
-                'upper': 'upper', 'lower': 'lower', 'byte': 'byte',
-                'char': 'char_', 'rep': 'rep', 'find': 'find',
-                'gsub': 'gsub', 'match': 'match', 'gmatch': 'gmatch'
-            }
-            func_name = method_map.get(method_name, method_name)
-            return f"string_lib::{func_name}({args_str})"
-        
-        # Table, io, math, os libraries use l2c:: namespace
-        lib_func_map = {
-            'io': {'write': 'io_write', 'flush': 'io_flush', 'read': 'io_read'},
-            'math': {'sqrt': 'math_sqrt', 'abs': 'math_abs', 'floor': 'math_floor',
-                     'ceil': 'math_ceil', 'sin': 'math_sin', 'cos': 'math_cos',
-                     'tan': 'math_tan', 'log': 'math_log', 'exp': 'math_exp',
-                     'pow': 'math_pow', 'min': 'math_min', 'max': 'math_max',
-                     'random': 'math_random', 'randomseed': 'math_randomseed',
-                     'modf': 'math_modf', 'fmod': 'math_fmod', 'atan': 'math_atan',
-                     'asin': 'math_asin', 'acos': 'math_acos', 'deg': 'math_deg',
-                     'rad': 'math_rad', 'huge': 'math_huge'},
-            'table': {'unpack': 'table_unpack', 'remove': 'table_remove', 'sort': 'table_sort',
-                      'concat': 'table_concat', 'insert': 'table_insert', 'pack': 'table_pack'},
-            'os': {'clock': 'os_clock', 'time': 'os_time', 'date': 'os_date', 'exit': 'os_exit',
-                   'difftime': 'os_difftime', 'getenv': 'os_getenv', 'remove': 'os_remove',
-                   'rename': 'os_rename', 'tmpname': 'os_tmpname'},
-        }
-        func_name = lib_func_map.get(lib_name, {}).get(method_name, f"{lib_name}_{method_name}")
-        return f"l2c::{func_name}({args_str})"
+            # String library uses string_lib:: (has TValue-aware implementations)
+            if method_name == 'format' and arg_nodes:
+                compiled = self._compiled_format(arg_nodes[0], args[1:])
+                if compiled is not None:
+                    return compiled
+            args = self._pattern_args(method_name, arg_nodes, args, 1)
+        return f"{self._library_registry.cpp_binding(lib_name, method_name)}({', '.join(args)})"
 
     def _generate_g_table_access(self, node: astnodes.Index) -> str:
         """Generate C++ code for G table access using bracket notation
@@ -579,10 +1577,9 @@ class ExprGenerator(ASTVisitor):
         current = node
 
         while current is not None:
+            is_dot = str(getattr(current, 'notation', '')) == "IndexNotation.DOT"
             if isinstance(current.value, astnodes.Name):  # type: ignore[attr-defined]
-                if current.value.id == "G" and isinstance(current.idx, astnodes.Name):  # type: ignore[attr-defined]
-                    parts.append(f'"{current.idx.id}"')
-                elif isinstance(current.idx, astnodes.Name):  # type: ignore[attr-defined]
+                if isinstance(current.idx, astnodes.Name) and is_dot:  # type: ignore[attr-defined]
                     parts.append(f'"{current.idx.id}"')
                 elif isinstance(current.idx, astnodes.Number):  # type: ignore[attr-defined]
                     parts.append(f"{current.idx.n}")
@@ -617,7 +1614,8 @@ class ExprGenerator(ASTVisitor):
         - FLAT_NESTED: X_Y_Z() for flattened nested paths
         - TABLE: X["Y"] for dynamic table access
 
-        Special handling for G table: uses bracket notation G["x"] for all access patterns
+        Special handling for G table: uses bracket notation G["x"] for all access patterns,
+        or the global's slot cache for a constant key (lua_table runtime)
 
         Args:
             node: Index AST node with value and idx
@@ -625,8 +1623,29 @@ class ExprGenerator(ASTVisitor):
         Returns:
             str: Generated C++ code
         """
+        var = self.scalar_field(node)
+        if var is not None:
+            return var
+        if self._shared_loads:
+            load = ASTAnnotationStore.get_annotation(node, 'load')
+            if load in self._declared_loads:
+                return load
+        slot = self.array_slot(node)
+        if slot is not None:
+            return f"{slot[0]}->array[{slot[1]}]"
+        member = self._receiver_field(node)
+        if member is not None:
+            receiver, name = member
+            if name in receiver.members:
+                return f"{receiver.this}->{name}"
+            key = self.interned_key(name) or f'STRING("{name}")'
+            return f"{receiver.this}->field({key})"
+
         # Check if this is a G table access
         if isinstance(node.value, astnodes.Name) and node.value.id == "G":
+            slot = self._global_slot(node)
+            if slot is not None:
+                return f"l2c::getcached(G, {slot[0]}, {slot[1]})"
             return self._generate_g_table_access(node)
 
         # Get root module and its convention
@@ -635,7 +1654,17 @@ class ExprGenerator(ASTVisitor):
         
         if config.convention == CallConvention.NAMESPACE:
             # For NAMESPACE: generate X::Y or use cpp_namespace if specified
+            if isinstance(node.value, astnodes.Name) and isinstance(node.idx, astnodes.String):
+                key = node.idx.s.decode() if isinstance(node.idx.s, bytes) else node.idx.s
+                slot = self.library_slot(node.value.id, key)
+                if slot is not None:
+                    return slot
             if isinstance(node.value, astnodes.Name) and isinstance(node.idx, astnodes.Name):
+                slot = self.library_slot(node.value.id, node.idx.id)
+                if slot is not None:
+                    return slot
+                if self._library_registry and self._library_registry.is_constant(node.value.id, node.idx.id):
+                    return self._library_registry.cpp_binding(node.value.id, node.idx.id)
                 cpp_ns = config.cpp_namespace or node.value.id
                 return f"{cpp_ns}::{node.idx.id}"
             # Nested index - use namespace for first level, then ::
@@ -667,13 +1696,139 @@ class ExprGenerator(ASTVisitor):
         else:
             # TABLE or unknown convention: use bracket notation
             value = self.generate(node.value)
+            field = self._shape_field(node)
+            if field:
+                shape_var, slot, key_var = field
+                return f"l2c::getfield({value}, {shape_var}, {slot}, {key_var})"
+            is_dot = hasattr(node, 'notation') and str(node.notation) == "IndexNotation.DOT"
+            key_var = self._literal_key_var(node.idx, is_dot)
+            if key_var:
+                cache_var = self._inline_cache(node)
+                if cache_var:
+                    return f"l2c::getcached({value}, {cache_var}, {key_var})"
+                return f"{value}[{key_var}]"
+            guarded = self._guarded_read == id(node)
+            if self._has_integer_local(node.idx):
+                int_key = self.integer_expr(node.idx)
+                if int_key is not None:
+                    return f"l2c::guarded_get({value}, {int_key})" if guarded else f"{value}[{int_key}]"
             idx = self.generate(node.idx)
             
             if hasattr(node, 'notation') and str(node.notation) == "IndexNotation.DOT":
                 return f'{value}["{idx}"]'
+            elif guarded:
+                return f"l2c::guarded_get({value}, {idx})"
             else:
                 return f"{value}[{idx}]"
 
+    def _literal_key_var(self, idx: Any, name_is_literal: bool) -> Optional[str]:
+        """Return the interned key variable for a constant key, if any
+
+        Args:
+            idx: Key node (t.name / {name = v} or a String literal)
+            name_is_literal: True when a Name key is a field name, not a variable
+        """
+        if not self._intern_keys:
+            return None
+        if isinstance(idx, astnodes.Name) and name_is_literal:
+            return self.interned_key(idx.id)
+        if isinstance(idx, astnodes.String):
+            return self.interned_key(self._literal_key_content(idx))
+        return None
+
+    @staticmethod
+    def _literal_key_content(idx: Any) -> Optional[str]:
+        """Raw key string of a field name or String literal key"""
+        if isinstance(idx, astnodes.Name):
+            return idx.id
+        if isinstance(idx, astnodes.String):
+            return idx.s.decode() if isinstance(idx.s, bytes) else idx.s
+        return None
+
+    # Lua 5.4 integer operators on int64_t operands
+    _INTEGER_OPS = {astnodes.AddOp: "({} + {})", astnodes.SubOp: "({} - {})", astnodes.MultOp: "({} * {})",
+                    astnodes.FloorDivOp: "l2c::int_idiv({}, {})", astnodes.ModOp: "l2c::int_mod({}, {})",
+                    astnodes.BAndOp: "({} & {})", astnodes.BOrOp: "({} | {})", astnodes.BXorOp: "({} ^ {})",
+                    astnodes.BShiftLOp: "l2c::shift_left({}, {})",
+                    astnodes.BShiftROp: "l2c::shift_right({}, {})"}
+
+    # + - * modulo 2^64, for operands that may be that wide
+    _WRAPPING_OPS = {astnodes.AddOp: "l2c::int_add({}, {})", astnodes.SubOp: "l2c::int_sub({}, {})",
+                     astnodes.MultOp: "l2c::int_mul({}, {})"}
+
+    # The same operators on NUMBERs (or on TValues, keeping integers integers)
+    _BITWISE_OPS = {astnodes.FloorDivOp: "l2c::floor_div({}, {})", astnodes.BAndOp: "l2c::band({}, {})",
+                    astnodes.BOrOp: "l2c::bor({}, {})", astnodes.BXorOp: "l2c::bxor({}, {})",
+                    astnodes.BShiftLOp: "l2c::shl({}, {})", astnodes.BShiftROp: "l2c::shr({}, {})"}
+
+    def integer_expr(self, node: Any) -> Optional[str]:
+        """Generate an int64_t expression for a provably integral value
+
+        Integral values are integer literals, math.maxinteger and
+        math.mininteger, `#x`, integer loop counters and what
+        `+ - * // % & | ~ << >>` and negation make of them.
+
+        Returns:
+            C++ int64_t expression, or None if the value may be a float
+        """
+        if isinstance(node, astnodes.Number):
+            if not isinstance(node.n, int) or not -2**63 <= node.n < 2**63:
+                return None
+            return str(node.n) if -2**31 <= node.n < 2**31 else f"INT64_C({node.n})"
+        if isinstance(node, astnodes.Name):
+            return node.id if node.id in self._integer_locals else None
+        if integer_limit(node) is not None:
+            return integer_limit(node)
+        if isinstance(node, astnodes.ULengthOP):
+            return f"static_cast<int64_t>({self.generate(node)})"
+        if isinstance(node, (astnodes.UMinusOp, astnodes.UBNotOp)):
+            operand = self.integer_expr(node.operand)
+            if operand is None or (isinstance(node, astnodes.UBNotOp) and not self._integer_ops):
+                return None
+            if isinstance(node, astnodes.UBNotOp):
+                return f"(~{operand})"
+            return f"l2c::int_sub(0, {operand})" if is_wide_integer(node) else f"(-{operand})"
+        # Past 2^53, + - * may overflow, and Lua's wrap around
+        template = (self._WRAPPING_OPS.get(type(node)) if is_wide_integer(node) else None) \
+            or self._INTEGER_OPS.get(type(node))
+        if template is None or (not self._integer_ops
+                                and not isinstance(node, (astnodes.AddOp, astnodes.SubOp, astnodes.MultOp))):
+            return None
+        left = self.integer_expr(node.left)
+        right = self.integer_expr(node.right) if left is not None else None
+        if right is None:
+            return None
+        return template.format(left, right)
+
+    def _has_integer_local(self, node: Any) -> bool:
+        """Check if an index expression reads an integer loop counter"""
+        if isinstance(node, astnodes.Name):
+            return node.id in self._integer_locals
+        if isinstance(node, (astnodes.UMinusOp, astnodes.UBNotOp)):
+            return self._has_integer_local(node.operand)
+        if type(node) in self._INTEGER_OPS:
+            return self._has_integer_local(node.left) or self._has_integer_local(node.right)
+        return False
+
+    def _integer_op(self, node: Any) -> Optional[str]:
+        """An expression computing an operator in integers, or None
+
+        Used for `+ - * %` reading an integer loop counter, which is a
+        double like other numbers, and for the operators on any proven
+        integers that is_wide_integer finds a double can't hold, which are
+        an TValue::Int64. Other integer arithmetic (on literals
+        alone) stays in double as before.
+        """
+        if not self._integer_ops:
+            return None
+        wide = is_wide_integer(node)
+        if not wide and not isinstance(node, astnodes.FloorDivOp) and not self._has_integer_local(node):
+            return None
+        integer = self.integer_expr(node)
+        if integer is None:
+            return None
+        return f"TValue::Int64({integer})" if wide else f"static_cast<double>({integer})"
+
     def _is_library_index(self, node: astnodes.Index) -> bool:
         """Check if Index node represents a library function reference
 
@@ -729,12 +1884,43 @@ class ExprGenerator(ASTVisitor):
             str: C++ expression that creates and initializes the table
         """
         if not node.fields:
+            if self._presized_tables and ASTAnnotationStore.get_annotation(node, 'number_array'):
+                return "NEW_NUMBER_TABLE"
             return "NEW_TABLE"
 
+        if (self._varargs_in_scope and len(node.fields) == 1 and node.fields[0].key is None
+                and isinstance(node.fields[0].value, astnodes.Varargs)):
+            return "_l2c_varargs.table()"
+        if (all(f.key is None for f in node.fields) and not isinstance(node.fields[-1].value, astnodes.Varargs)
+                and self.call_results(node.fields[-1].value) is not None):
+            # {a, f()}: every value of the last call
+            values = [self.generate(f.value) for f in node.fields[:-1]]
+            values.append(self.generate_pack_source(node.fields[-1].value))
+            if len(values) == 1 and self.call_results(node.fields[-1].value) == 0:
+                return f"{values[0]}.table()"
+            return f"l2c::Values::expand({', '.join(values)}).table()"
+
+        shape_id = ASTAnnotationStore.get_annotation(node, 'record_shape')
+        if shape_id is not None and self._record_shapes and self._intern_keys:
+            values = ", ".join(self.generate(f.value) for f in node.fields)
+            return f"l2c::RecordCtor<{len(node.fields)}>{{{self._shape_var(shape_id)}, {values}}}.table"
+
+        if self._const_tables and ASTAnnotationStore.get_annotation(node, 'const_table'):
+            array_values, hash_items = self._table_items(node)
+            var = f"_l2c_const_{len(self._const_table_decls)}"
+            items = ", ".join(array_values + hash_items)
+            self._const_table_decls.append(
+                f"static const l2c::ConstTable<{len(array_values)}, {len(hash_items) // 2}> {var}{{{items}}};")
+            return f"{var}.table()"
+
+        if self._presized_tables and not any(isinstance(f.value, astnodes.Varargs) for f in node.fields):
+            return self._generate_presized_table(node)
+
         # Build table initialization as a lambda expression
         # [=]() { TABLE t = NEW_TABLE; t[1] = a; t[2] = b; return t; }()
+        # It runs in place, so with precise captures it copies nothing
         lines = []
-        lines.append("[=]() {")
+        lines.append("[&]() {" if self._precise_captures else "[=]() {")
         lines.append("    TABLE t = NEW_TABLE;")
 
         array_index = 1  # Lua arrays are 1-indexed
@@ -748,7 +1934,11 @@ class ExprGenerator(ASTVisitor):
             else:
                 # Hash part: t["key"] = value or t[key] = value
                 key = self.generate(field.key)
-                if hasattr(field.key, 'id'):
+                key_var = self._literal_key_var(
+                    field.key, not getattr(field, 'between_brackets', False))
+                if key_var:
+                    lines.append(f"    t[{key_var}] = {value};")
+                elif hasattr(field.key, 'id'):
                     # Simple name key: t["key"] = value
                     lines.append(f"    t[STRING(\"{field.key.id}\")] = {value};")
                 else:
@@ -760,8 +1950,52 @@ class ExprGenerator(ASTVisitor):
 
         return "\n".join(lines)
 
+    def _generate_presized_table(self, node: astnodes.Table) -> str:
+        """Generate l2c::TableCtor<nArr, nHash>{values..., key, value, ...}.table
+
+        Positional values fill the array part in one store; keyed fields
+        follow as key/value pairs, literal keys as interned TValues.
+        Tables the type resolver marks number-only start in ARRAY_NUMBER mode.
+        """
+        array_values, hash_items = self._table_items(node)
+        items = ", ".join(array_values + hash_items)
+        kind = ", ARRAY_NUMBER" if ASTAnnotationStore.get_annotation(node, 'number_array') else ""
+        return f"l2c::TableCtor<{len(array_values)}, {len(hash_items) // 2}{kind}>{{{items}}}.table"
+
+    def _table_items(self, node: astnodes.Table) -> Tuple[List[str], List[str]]:
+        """Return a constructor's positional values and its flattened key/value pairs"""
+        array_values = []
+        hash_items = []
+        for field in node.fields:
+            value = self.generate(field.value)
+            if field.key is None:
+                array_values.append(value)
+                continue
+            key_var = self._literal_key_var(
+                field.key, not getattr(field, 'between_brackets', False))
+            if key_var:
+                key = key_var
+            elif hasattr(field.key, 'id') and not getattr(field, 'between_brackets', False):
+                key = f'STRING("{field.key.id}")'
+            else:
+                key = self.generate(field.key)
+            hash_items.extend([key, value])
+        return array_values, hash_items
+
     def visit_AnonymousFunction(self, node: astnodes.AnonymousFunction) -> str:
         """Generate C++ lambda expression for anonymous function"""
+        # The parameters shadow unboxed locals of the enclosing function
+        saved = self.save_unboxed(tuple(a.id for a in node.args if isinstance(a, astnodes.Name)))
+        try:
+            return self._generate_anonymous_function(node)
+        finally:
+            self.restore_unboxed(saved)
+
+    def _generate_anonymous_function(self, node: astnodes.AnonymousFunction) -> str:
+        if self._stmt_gen is not None and self._stmt_gen.is_coroutine(node):
+            # Captured by value: the frame can outlive the enclosing call
+            params = ", ".join(f"TValue {arg.id}" for arg in node.args)
+            return f"[=]({params}) mutable -> l2c::CoTask {self._stmt_gen.coroutine_body(node)}"
         # Check if we're in a table.sort context - use concrete types for comparator
         if self._in_table_sort_context:
             # Use concrete types for table.sort comparator: const TValue& params, bool return
@@ -779,6 +2013,8 @@ class ExprGenerator(ASTVisitor):
             for arg in node.args:
                 if hasattr(arg, 'id'):
                     params.append(f"const auto& {arg.id}")
+                elif self._value_packs:
+                    params.append("auto&&... _l2c_va")
                 else:
                     params.append("const auto& arg")
             params_str = ", ".join(params)
@@ -790,12 +2026,44 @@ class ExprGenerator(ASTVisitor):
         if self._stmt_gen is None:
             body_str = "    /* Anonymous function body - stmt_gen not available */"
         else:
-            body_lines = []
+            saved, prologue = self._stmt_gen.begin_value_packs(node.args, node.body)
+            pack_type = self._stmt_gen.pack_return_type(node.body)
+            if pack_type and not self._in_table_sort_context:
+                return_type = pack_type
+            body_lines = [f"    {prologue}"] if prologue else []
             for stmt in node.body.body:
                 body_lines.append(f"    {self._stmt_gen.generate(stmt)}")
+            tail = self._stmt_gen.implicit_pack_return(node.body)
+            if tail:
+                body_lines.append(f"    {tail}")
+            self._stmt_gen.end_value_packs(saved)
             body_str = "\n".join(body_lines) if body_lines else ""
 
-        return f"[&]({params_str}) -> {return_type} {{\n{body_str}\n}}"
+        captures, mutable = self._capture_list(node)
+        return f"[{captures}]({params_str}){mutable} -> {return_type} {{\n{body_str}\n}}"
+
+    def _capture_list(self, node: astnodes.AnonymousFunction) -> Tuple[str, str]:
+        """The lambda's captures from ClosureAnalyzer, and ' mutable' if it needs it
+
+        Locals nobody assigns are copied, boxed ones copy their
+        l2c::Upvalue handle and the rest are taken by reference. Names
+        compiled to something other than a C++ local are not captured.
+        """
+        captures = ASTAnnotationStore.get_annotation(node, 'captures') if self._precise_captures else None
+        if captures is None:
+            return "&", ""
+        aliases = getattr(self._stmt_gen, '_library_aliases', {})
+        names = []
+        for name, mode in captures:
+            if name in aliases and name not in self._function_locals:
+                continue
+            receiver = self._method_receivers.get(name)
+            if receiver is not None:
+                names.append(receiver.this)
+            else:
+                names.append(f"&{name}" if mode == "ref" else name)
+        mutable = " mutable" if ASTAnnotationStore.get_annotation(node, 'mutable_captures') else ""
+        return ", ".join(names), mutable
 
     def visit_Assign(self, node: astnodes.Assign) -> str:
         """Generate C++ assignment expression
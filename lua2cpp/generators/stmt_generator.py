@@ -4,11 +4,14 @@ Generates C++ code from Lua AST statement nodes.
 Implements double-dispatch pattern for local assignments and return statements.
 """
 
-from typing import Any, Optional, List, TYPE_CHECKING, Set, Dict
+from typing import Any, Optional, List, TYPE_CHECKING, Set, Dict, Tuple
 from dataclasses import dataclass
 from ..core.ast_visitor import ASTVisitor
-from ..core.types import Type, ASTAnnotationStore
+from ..core.types import Type, ASTAnnotationStore, is_wide_integer
+from ..core.library_registry import LibraryFunctionRegistry
 from .expr_generator import ExprGenerator
+from ..analyzers.type_profile import function_profile_name, function_line
+from ..analyzers.vector_analyzer import VECTOR_MATH, index_offset
 
 
 @dataclass
@@ -21,7 +24,8 @@ class AliasInfo:
     lua_name: str          # The alias name in Lua (e.g., "write")
     cpp_lib: str           # C++ library namespace (e.g., "io", "math_lib")
     cpp_method: str        # C++ method name (e.g., "write")
-    cpp_qualified: str     # Fully qualified C++ name (e.g., "io::write")
+    cpp_qualified: str     # C++ binding calls compile to (e.g., "l2c::io_write")
+    library: str = ""      # Lua library (e.g., "io")
 
 try:
     from luaparser import astnodes
@@ -64,11 +68,470 @@ class StmtGenerator(ASTVisitor):
         self._current_function_return_type: str = ""
         # Track library function aliases (e.g., local write = io.write)
         self._library_aliases: Dict[str, AliasInfo] = {}
+        # lua_table closures adapt to the callee's arity
+        self._typed_closures = False
+        self._integer_loops = False
+        self._compiled_patterns = False
+        # for-in over io.lines() drives an l2c::LinesIter (lua_table runtime)
+        self._buffered_io = False
+        # pairs/ipairs for-in loops drive l2c::PairsIter / l2c::IpairsIter (lua_table runtime)
+        self._table_iterators = False
+        # Functions returning 2+ values return a fixed-arity l2c::ReturnPack,
+        # those returning `...` or a call's values an l2c::Values;
+        # _return_arity is the current function's, 0 for l2c::Values (lua_table runtime)
+        self._value_packs = False
+        self._return_arity = 1
+        self._drop_counter = 0
+        # --instrument: named functions record their argument and return types
+        # in an l2c::profile::Site; _profile_site is set inside such a body
+        self._profiling = False
+        self._profile_site = False
+        # --profile: functions annotated 'speculated_params' get a guarded entry
+        self._speculation = False
+        # Local functions annotated 'concrete_params' are plain functions
+        self._concrete_signatures = False
+        # LocalAssigns annotated 'scalar_replaced' declare a local per field
+        self._scalar_replacement = False
+        # Functions annotated 'coroutine_arity' become l2c::CoTask coroutines;
+        # _coroutine_frame is set inside such a body
+        self._coroutines = False
+        self._coroutine_frame = False
+        # LocalAssigns annotated 'upvalue_box' declare an l2c::Upvalue
+        self._precise_captures = False
+        # Statements and loops annotated 'hoisted_loads' are preceded by
+        # the loads they share (LoadAnalyzer)
+        self._shared_loads = False
+        # Returns annotated 'self_tail_call' rebind the parameters and jump
+        # back; _tail_call is (name, parameters, templated) inside such a body
+        self._tail_calls = False
+        self._tail_call: Optional[Tuple[str, List[str], bool]] = None
+        # --parallel: Fornums annotated 'parallel_loop' try l2c::parallel_for;
+        # _parallel_lane is set while generating the body its iterations run
+        self._parallel_loops = False
+        self._parallel_lane = False
+        # Fornums annotated 'vector_loop' get an l2c::number_span kernel
+        self._vector_loops = False
+        # Fornums annotated 'array_loop' get a copy indexing array parts,
+        # behind an l2c::array_span guard; _array_loops_count names them
+        self._array_loops = False
+        self._array_loops_count = 0
 
     def set_module_context(self, prefix: str, module_state: Set) -> None:
         """Propagate module context to internal ExprGenerator"""
         self._expr_gen.set_module_context(prefix, module_state)
 
+    def enable_key_interning(self, enabled: bool = True) -> None:
+        """Propagate literal key interning to internal ExprGenerator"""
+        self._expr_gen.enable_key_interning(enabled)
+
+    def get_interned_keys(self) -> Dict[str, str]:
+        return self._expr_gen.get_interned_keys()
+
+    def set_direct_functions(self, functions: Dict[Tuple[str, str], Tuple[str, int]]) -> None:
+        """Propagate direct-call candidates to internal ExprGenerator"""
+        self._expr_gen.set_direct_functions(functions)
+
+    def set_function_arities(self, arities: Dict[str, int]) -> None:
+        """Propagate the parameter counts of top-level functions to internal ExprGenerator"""
+        self._expr_gen.set_function_arities(arities)
+
+    def set_library_slots(self, slots: Dict[Tuple[str, str], str]) -> None:
+        """Propagate the stored-to library members to internal ExprGenerator"""
+        self._expr_gen.set_library_slots(slots)
+
+    def set_coroutine_functions(self, arities: Dict[str, int]) -> None:
+        """Propagate the yielding named functions to internal ExprGenerator"""
+        self._expr_gen.set_coroutine_functions(arities)
+
+    def enable_presized_tables(self, enabled: bool = True) -> None:
+        """Propagate presized table constructors to internal ExprGenerator"""
+        self._expr_gen.enable_presized_tables(enabled)
+
+    def set_record_shapes(self, shapes: List[Tuple[str, ...]]) -> None:
+        """Propagate record shapes to internal ExprGenerator"""
+        self._expr_gen.set_record_shapes(shapes)
+
+    def get_record_shape_decls(self) -> List[str]:
+        """Get module-scope declarations of the record shapes in use"""
+        return self._expr_gen.record_shape_decls()
+
+    def enable_concat_builder(self, enabled: bool = True) -> None:
+        """Propagate the `..` chain builder to internal ExprGenerator"""
+        self._expr_gen.enable_concat_builder(enabled)
+
+    def enable_string_equality(self, enabled: bool = True) -> None:
+        """Propagate content equality of STRING operands to internal ExprGenerator"""
+        self._expr_gen.enable_string_equality(enabled)
+
+    def enable_inline_caches(self, enabled: bool = True) -> None:
+        """Propagate per-site inline caches to internal ExprGenerator"""
+        self._expr_gen.enable_inline_caches(enabled)
+
+    def get_inline_cache_decls(self) -> List[str]:
+        """Get module-scope declarations of the inline cache cells in use"""
+        return self._expr_gen.inline_cache_decls()
+
+    def enable_compiled_patterns(self, enabled: bool = True) -> None:
+        """Propagate precompiled literal patterns to internal ExprGenerator
+
+        Also lowers `for ... in s:gmatch(p)` to an l2c::GMatch loop.
+        """
+        self._compiled_patterns = enabled
+        self._expr_gen.enable_compiled_patterns(enabled)
+
+    def enable_compiled_formats(self, enabled: bool = True) -> None:
+        """Propagate transpile-time split literal formats to internal ExprGenerator"""
+        self._expr_gen.enable_compiled_formats(enabled)
+
+    def enable_const_tables(self, enabled: bool = True) -> None:
+        """Propagate constant module tables to internal ExprGenerator"""
+        self._expr_gen.enable_const_tables(enabled)
+
+    def enable_guarded_ops(self, enabled: bool = True) -> None:
+        """Propagate guarded fast paths for hot arithmetic to internal ExprGenerator"""
+        self._expr_gen.enable_guarded_ops(enabled)
+
+    def enable_buffered_io(self, enabled: bool = True) -> None:
+        """Lower `for line in io.lines(...)` to an l2c::LinesIter loop"""
+        self._buffered_io = enabled
+
+    def enable_table_iterators(self, enabled: bool = True) -> None:
+        """Lower pairs/ipairs for-in loops to stateful l2c::PairsIter / l2c::IpairsIter loops"""
+        self._table_iterators = enabled
+
+    def enable_value_packs(self, enabled: bool = True) -> None:
+        """Return multiple values as l2c::ReturnPack<N> and take `...` as a C++ parameter pack"""
+        self._value_packs = enabled
+        self._expr_gen.enable_value_packs(enabled)
+
+    def enable_profiling(self, enabled: bool = True) -> None:
+        """Instrument named functions to write a type profile (lua_profile.hpp)"""
+        self._profiling = enabled
+
+    def enable_speculation(self, enabled: bool = True) -> None:
+        """Specialize functions on the parameter types a profile observed"""
+        self._speculation = enabled
+
+    def enable_concrete_signatures(self, enabled: bool = True) -> None:
+        """Emit local functions with settled call sites as non-template functions"""
+        self._concrete_signatures = enabled
+        self._expr_gen.enable_concrete_signatures(enabled)
+
+    def enable_unboxed_locals(self, enabled: bool = True) -> None:
+        """Propagate unboxed number and bool locals to internal ExprGenerator"""
+        self._expr_gen.enable_unboxed_locals(enabled)
+
+    def enable_integer_ops(self, enabled: bool = True) -> None:
+        """Propagate int64_t integer operators to internal ExprGenerator"""
+        self._expr_gen.enable_integer_ops(enabled)
+
+    def set_number_state(self, names: Set[str]) -> None:
+        """Propagate the NUMBER module state to internal ExprGenerator"""
+        self._expr_gen.set_number_state(names)
+
+    def enable_scalar_replacement(self, enabled: bool = True) -> None:
+        """Keep the fields of non-escaping tables in locals (EscapeAnalyzer)"""
+        self._scalar_replacement = enabled
+        self._expr_gen.enable_scalar_replacement(enabled)
+
+    def enable_precise_captures(self, enabled: bool = True) -> None:
+        """Capture exactly what closures use, boxing shared locals (ClosureAnalyzer)"""
+        self._precise_captures = enabled
+        self._expr_gen.enable_precise_captures(enabled)
+
+    def enable_shared_loads(self, enabled: bool = True) -> None:
+        """Load repeated and loop-invariant x.k reads once (LoadAnalyzer)"""
+        self._shared_loads = enabled
+        self._expr_gen.enable_shared_loads(enabled)
+
+    def enable_tail_calls(self, enabled: bool = True) -> None:
+        """Compile self tail calls to a jump (TailCallAnalyzer)"""
+        self._tail_calls = enabled
+
+    def enable_coroutines(self, enabled: bool = True) -> None:
+        """Lower yielding functions to C++20 coroutines (CoroutineAnalyzer)"""
+        self._coroutines = enabled
+        self._expr_gen.enable_coroutines(enabled)
+
+    def _profile_prologue(self, node: Any) -> str:
+        """The statements that record a call of this function, '' when not profiling
+
+        Also makes the body's single-value returns record their type.
+        """
+        name = function_profile_name(node)
+        if not self._profiling or name is None:
+            return ""
+        self._profile_site = True
+        module = getattr(self._expr_gen, "_module_prefix", None) or "module"
+        args = [a.id for a in node.args if isinstance(a, astnodes.Name)]
+        return (f'static l2c::profile::Site& _l2c_prof = l2c::profile::site('
+                f'"{module}", "{name}", {function_line(node)}, {len(args)});\n'
+                f'    _l2c_prof.enter({", ".join(args)});')
+
+    def _speculated_definition(self, node: Any, template_str: str, return_type: str,
+                               name: str, params: List[str], body: str) -> Optional[str]:
+        """A definition that enters the function with speculated arguments unboxed
+
+        The body becomes _l2c_generic_<name>; <name> itself checks that every
+        speculated argument holding a TValue is a number and calls the
+        double instantiation, or else the generic one. Returns None unless
+        the function is annotated 'speculated_params'.
+        """
+        speculated = ASTAnnotationStore.get_annotation(node, 'speculated_params')
+        if not self._speculation or not speculated or not template_str:
+            return None
+        generic = f"_l2c_generic_{name}"
+        param_types = {p.split()[-1]: p.split()[0] for p in params}
+        speculated = [p for p in speculated if p in param_types]
+        if not speculated:
+            return None
+        names = list(param_types)
+        params_str = ", ".join(params)
+        args = ", ".join(names)
+        if return_type == "auto":
+            entry = f"auto {name}({params_str}) -> decltype({generic}({args}))"
+        else:
+            entry = f"{return_type} {name}({params_str})"
+        boxed = " || ".join(f"l2c::is_boxed_v<{param_types[p]}>" for p in speculated)
+        guard = " && ".join(f"l2c::holds_number({p})" for p in speculated)
+        fast_args = ", ".join(f"l2c::unbox_number({p})" if p in speculated else p for p in names)
+        return "\n".join([
+            f"{template_str}{return_type} {generic}({params_str});",
+            f"{template_str}{entry};",
+            "",
+            f"{template_str}{return_type} {generic}({params_str}) {body}",
+            "",
+            f"// Profiled: {', '.join(speculated)} only held numbers",
+            f"{template_str}{entry} {{",
+            f"    if constexpr ({boxed}) {{",
+            f"        if (LIKELY({guard})) {{",
+            f"            return static_cast<decltype({generic}({args}))>({generic}({fast_args}));",
+            "        }",
+            "    }",
+            f"    return {generic}({args});",
+            "}",
+        ])
+
+    @staticmethod
+    def _walk_function_body(node: Any):
+        """Yield the nodes under node, without entering nested function definitions"""
+        for attr_name in dir(node):
+            if attr_name.startswith('_'):
+                continue
+            attr = getattr(node, attr_name, None)
+            for item in (attr if isinstance(attr, (list, tuple)) else [attr]):
+                if isinstance(item, astnodes.Node):
+                    yield item
+                    if not isinstance(item, (astnodes.Function, astnodes.LocalFunction,
+                                             astnodes.AnonymousFunction)):
+                        yield from StmtGenerator._walk_function_body(item)
+
+    def return_arity(self, block: Any) -> int:
+        """Largest number of values a return statement of this function body lists"""
+        return max((len(n.values or []) for n in self._walk_function_body(block)
+                    if isinstance(n, astnodes.Return)), default=0)
+
+    def function_results(self, block: Any) -> int:
+        """How many values this function body returns, counting a last `...` or call's values
+
+        N >= 2 for an l2c::ReturnPack<N>, 0 for an l2c::Values (a count
+        only known at run time), 1 for a single value.
+        """
+        arity = 1
+        for node in self._walk_function_body(block):
+            if not isinstance(node, astnodes.Return) or not node.values:
+                continue
+            last = node.values[-1]
+            results = 0 if isinstance(last, astnodes.Varargs) else self._expr_gen.call_results(last)
+            if results == 0:
+                return 0
+            arity = max(arity, len(node.values) - 1 + (results or 1))
+        return arity
+
+    def set_function_results(self, functions: Dict[str, Any]) -> None:
+        """Settle the results of the top-level named functions, C++ name -> definition
+
+        A function returning another's call returns its values, so this
+        iterates until no function's count changes.
+        """
+        results: Dict[str, int] = {}
+        varargs = {name: len(fn.args) - 1 for name, fn in functions.items()
+                   if fn.args and isinstance(fn.args[-1], astnodes.Varargs)}
+        self._expr_gen.set_function_results(results, varargs)
+        if not self._value_packs:
+            return
+        for _ in range(len(functions) + 1):
+            changed = False
+            for name, fn in functions.items():
+                count = self.function_results(fn.body)
+                if count != 1 and results.get(name) != count:
+                    results[name] = count
+                    changed = True
+            if not changed:
+                break
+
+    def pack_return_type(self, block: Any) -> Optional[str]:
+        """l2c::ReturnPack<N> for a function body returning N >= 2 values, l2c::Values
+        for one returning `...` or a call's values of unknown count, else None"""
+        if not self._value_packs:
+            return None
+        arity = self.function_results(block)
+        if arity == 0:
+            return "l2c::Values"
+        return f"l2c::ReturnPack<{arity}>" if arity >= 2 else None
+
+    def begin_value_packs(self, args: List[Any], block: Any) -> Tuple[Tuple[int, bool, bool, bool], str]:
+        """Enter a function body: track its return arity and whether `...` is in scope
+
+        Returns the state for end_value_packs and the declaration the body
+        starts with ("" when no use of `...` needs an l2c::Values copy).
+        The body starts outside any profile site and coroutine frame.
+        """
+        saved = (self._return_arity, self._expr_gen.enter_varargs(False), self._profile_site,
+                 self._coroutine_frame)
+        self._profile_site = False
+        self._coroutine_frame = False
+        if not self._value_packs:
+            self._return_arity = 1
+            return saved, ""
+        self._return_arity = self.function_results(block)
+        has_varargs = any(isinstance(a, astnodes.Varargs) for a in args)
+        self._expr_gen.enter_varargs(has_varargs)
+        if has_varargs and self._prepare_varargs(block):
+            return saved, "l2c::Values _l2c_varargs = l2c::Values::of(_l2c_va...);"
+        return saved, ""
+
+    def end_value_packs(self, saved: Tuple[int, bool, bool, bool]) -> None:
+        self._return_arity = saved[0]
+        self._expr_gen.enter_varargs(saved[1])
+        self._profile_site = saved[2]
+        self._coroutine_frame = saved[3]
+
+    def is_coroutine(self, node: Any) -> bool:
+        """Is this function definition lowered to a C++ coroutine?"""
+        return self._coroutines and ASTAnnotationStore.get_annotation(node, 'coroutine_arity') is not None
+
+    def coroutine_body(self, node: Any) -> str:
+        """The body of a function lowered to a coroutine returning l2c::CoTask
+
+        Its returns hand an l2c::Values to the awaiting frame or resumer:
+        they are co_returns, and one returning nothing ends a body that
+        can fall off its end.
+        """
+        saved, _ = self.begin_value_packs(node.args, node.body)
+        self._return_arity = 1
+        self._coroutine_frame = True
+        body = self._generate_block(node.body, indent="    ")
+        statements = self._normalize_block_body(node.body)
+        if not statements or not isinstance(statements[-1], astnodes.Return):
+            body = body.rstrip()[:-1] + "    co_return l2c::Values{};\n}"
+        self.end_value_packs(saved)
+        return body
+
+    def _coroutine_definition(self, node: Any, name: str) -> str:
+        """`l2c::CoTask name(TValue a, ...)` for a named function that yields"""
+        local_names = {arg.id for arg in node.args}
+        for stmt in self._normalize_block_body(node.body):
+            if isinstance(stmt, astnodes.LocalAssign):
+                local_names.update(t.id for t in stmt.targets if isinstance(t, astnodes.Name))
+        self._expr_gen.enter_function(local_names)
+        self.enter_function()
+        body = self.coroutine_body(node)
+        self.exit_function()
+        self._expr_gen.exit_function()
+        params = ", ".join(f"TValue {arg.id}" for arg in node.args)
+        return f"l2c::CoTask {name}({params}) {body}"
+
+    def implicit_pack_return(self, block: Any) -> str:
+        """The all-nil return a multi-value function body that can fall off its end needs"""
+        if self._return_arity == 1:
+            return ""
+        body = self._normalize_block_body(block)
+        if body and isinstance(body[-1], astnodes.Return):
+            return ""
+        return f"return {self._pack_values([], self._return_arity)};"
+
+    def _prepare_varargs(self, block: Any) -> bool:
+        """Mark each `...` passed as the last call argument for pack expansion
+
+        Returns whether any other use of `...` needs the l2c::Values copy.
+        """
+        expanded = set()
+        needs_values = False
+        for node in self._walk_function_body(block):
+            if isinstance(node, (astnodes.Call, astnodes.Invoke)) and node.args \
+                    and isinstance(node.args[-1], astnodes.Varargs):
+                select = self._expr_gen._select_varargs(node)
+                if select is None:
+                    ASTAnnotationStore.set_annotation(node.args[-1], 'vararg_expand', True)
+                if select is None or select.startswith("NUMBER("):
+                    expanded.add(id(node.args[-1]))
+            elif isinstance(node, astnodes.Return) and node.values \
+                    and isinstance(node.values[-1], astnodes.Varargs):
+                # return a, ... -> l2c::Values::of(a, _l2c_va...)
+                ASTAnnotationStore.set_annotation(node.values[-1], 'vararg_expand', True)
+                expanded.add(id(node.values[-1]))
+            elif isinstance(node, astnodes.Varargs) and id(node) not in expanded:
+                needs_values = True
+        return needs_values
+
+    def _pack_values(self, values: List[Any], arity: int) -> str:
+        """Generate values, nil-padded, as an l2c::ReturnPack<arity> expression
+
+        Arity 0 makes an l2c::Values of them. A last `...` or multi-value
+        call gives all its values.
+        """
+        if arity == 0:
+            if values and isinstance(values[-1], astnodes.Varargs):
+                # Marked for pack expansion by _prepare_varargs
+                return f"l2c::Values::of({', '.join(self._expr_gen.generate(v) for v in values)})"
+            if values and self._expr_gen.call_results(values[-1]) is not None:
+                codes = [self._expr_gen.generate(v) for v in values[:-1]]
+                codes.append(self._expr_gen.generate_pack_source(values[-1]))
+                return f"l2c::Values::expand({', '.join(codes)})"
+            return f"l2c::Values::of({', '.join(self._expr_gen.generate(v) for v in values)})"
+        if len(values) == 1 and isinstance(values[0], (astnodes.Call, astnodes.Invoke, astnodes.Varargs)):
+            return f"l2c::take<{arity}>({self._expr_gen.generate_pack_source(values[0])})"
+        if len(values) > 1 and self._expr_gen.call_results(values[-1]) is not None:
+            codes = [self._expr_gen.generate(v) for v in values[:-1]]
+            codes.append(self._expr_gen.generate_pack_source(values[-1]))
+            return f"l2c::take<{arity}>(l2c::Values::expand({', '.join(codes)}))"
+        codes = [self._expr_gen.generate(v) for v in values]
+        codes += ["NIL"] * (arity - len(codes))
+        return f"multi_return({', '.join(codes)})"
+
+    def get_pattern_decls(self) -> List[str]:
+        """Get module-scope declarations of the compiled literal patterns"""
+        return self._expr_gen.pattern_decls()
+
+    def get_format_decls(self) -> List[str]:
+        """Get module-scope declarations of the split literal formats"""
+        return self._expr_gen.format_decls()
+
+    def get_const_table_decls(self) -> List[str]:
+        """Get module-scope declarations of the constant tables"""
+        return self._expr_gen.const_table_decls()
+
+    def enable_typed_closures(self, enabled: bool = True) -> None:
+        """Register table functions with their own arity instead of (TValue, TValue)"""
+        self._typed_closures = enabled
+
+    def enable_integer_loops(self, enabled: bool = True) -> None:
+        """Lower numeric for-loops with integral start and step to int64_t counters"""
+        self._integer_loops = enabled
+
+    def enable_parallel_loops(self, enabled: bool = True) -> None:
+        """Run the integer loops ParallelAnalyzer marked on l2c::parallel_for"""
+        self._parallel_loops = enabled
+
+    def enable_vector_loops(self, enabled: bool = True) -> None:
+        """Run the integer loops VectorAnalyzer marked as kernels over number arrays"""
+        self._vector_loops = enabled
+
+    def enable_array_loops(self, enabled: bool = True) -> None:
+        """Index array parts directly in the integer loops ArrayLoopAnalyzer marked"""
+        self._array_loops = enabled
+
     def enter_function(self):
         self._in_function = True
 
@@ -102,11 +565,13 @@ class StmtGenerator(ASTVisitor):
         lib_name = value.value.id
         if lib_name not in lib_map:
             return None
+        registry = self._library_registry or LibraryFunctionRegistry()
         return AliasInfo(
             lua_name=target.id,
             cpp_lib=lib_map[lib_name],
             cpp_method=value.idx.id,
-            cpp_qualified=f"{lib_map[lib_name]}::{value.idx.id}"
+            cpp_qualified=registry.cpp_binding(lib_name, value.idx.id),
+            library=lib_name
         )
 
     def get_library_aliases(self):
@@ -123,7 +588,13 @@ class StmtGenerator(ASTVisitor):
         Returns:
             str: Generated C++ code as a string
         """
-        return self.visit(node)
+        loads = ASTAnnotationStore.get_annotation(node, 'hoisted_loads') if self._shared_loads else None
+        if not loads:
+            return self.visit(node)
+        lines = [f"TValue {var} = {self._expr_gen.generate(read)};" for var, read in loads]
+        self._expr_gen.declare_loads([var for var, _ in loads])
+        lines.append(self.visit(node))
+        return "\n".join(lines)
 
     def visit_LocalAssign(self, node: astnodes.LocalAssign) -> str:
         """Generate C++ local variable declaration
@@ -142,8 +613,41 @@ class StmtGenerator(ASTVisitor):
         Returns:
             str: C++ local variable declaration(s)
         """
+        # A table that never escapes (EscapeAnalyzer): one local per field
+        fields = ASTAnnotationStore.get_annotation(node, 'scalar_replaced')
+        if fields is not None and self._scalar_replacement:
+            return "\n".join(
+                f"TValue {var} = {f'l2c::as_value({self._expr_gen.generate(value)})' if value is not None else 'NIL'};"
+                for var, value in fields)
+
         # Multi-return unpacking: local a, b, c, d = func()
         # MUST check this FIRST before the for loop
+        if self._value_packs and len(node.targets) >= 2 and len(node.values) == 1 \
+                and isinstance(node.values[0], (astnodes.Call, astnodes.Invoke, astnodes.Varargs)):
+            # auto [a, b, c] = l2c::take<3>(f()); a repeated name binds its last value
+            names = []
+            for i, target in enumerate(node.targets):
+                if any(t.id == target.id for t in node.targets[i + 1:]):
+                    names.append(f"_l2c_drop_{self._drop_counter}")
+                    self._drop_counter += 1
+                else:
+                    names.append(target.id)
+            source = self._expr_gen.generate_pack_source(node.values[0])
+            for target in node.targets:
+                self._expr_gen.declare_unboxed(target.id, None)
+            module_state = getattr(self._expr_gen, '_module_state', set())
+            if not self._in_function and any(t.id in module_state for t in node.targets):
+                # Module state variables are assigned, the others declared
+                pack = f"_l2c_pack_{self._drop_counter}"
+                self._drop_counter += 1
+                lines = [f"auto {pack} = l2c::take<{len(names)}>({source});"]
+                for i, (name, target) in enumerate(zip(names, node.targets)):
+                    if target.id in module_state and not name.startswith("_l2c_drop_"):
+                        lines.append(f"{self._expr_gen._module_prefix}_{target.id} = {pack}[{i + 1}];")
+                    elif not name.startswith("_l2c_drop_"):
+                        lines.append(f"auto {name} = {pack}[{i + 1}];")
+                return "\n".join(lines)
+            return f"auto [{', '.join(names)}] = l2c::take<{len(names)}>({source});"
         if len(node.targets) >= 2 and len(node.values) == 1:
             # Check if value is a function call (can return multiple values)
             if isinstance(node.values[0], (astnodes.Call, astnodes.Invoke)):
@@ -153,6 +657,8 @@ class StmtGenerator(ASTVisitor):
                 lines.append(f"auto {vars_list[0]} = _mr_{vars_list[0]};")
                 for i, var in enumerate(vars_list[1:], start=2):
                     lines.append(f"auto {var} = _mr_{vars_list[0]}[{i}];")
+                for var in vars_list:
+                    self._expr_gen.declare_unboxed(var, None)
                 return "\n".join(lines)
 
         # LocalAssign has .targets (list of Name nodes) and .values (list of expressions)
@@ -173,6 +679,10 @@ class StmtGenerator(ASTVisitor):
                         self._library_aliases[alias_info.lua_name] = alias_info
                         # Skip this target - alias will be emitted in namespace at file scope
                         continue
+            if self._precise_captures and ASTAnnotationStore.get_annotation(node, 'upvalue_box'):
+                lines.append(self._upvalue_declaration(name_node, init_expr))
+                self._expr_gen.declare_unboxed(var_name, None)
+                continue
 
             # Try to get type information from the name node
             var_type = None
@@ -196,8 +706,15 @@ class StmtGenerator(ASTVisitor):
                      expr_code.startswith('io[') or  # e.g., io["write"]
                      expr_code.startswith('table[') or  # e.g., table["concat"]
                      expr_code.startswith('os[') or  # e.g., os["time"]
-                     '::' in expr_code)  # e.g., math_lib::floor
+                     # e.g., math_lib::floor, but not a cached field read
+                     # like l2c::getcached(t, ic, key)
+                     ('::' in expr_code and '(' not in expr_code))
                 )
+                # A constant (math.huge) is a value to copy, not a function
+                if is_library_ref and isinstance(init_expr.value, astnodes.Name) \
+                        and isinstance(init_expr.idx, astnodes.Name):
+                    registry = self._library_registry or LibraryFunctionRegistry()
+                    is_library_ref = not registry.is_constant(init_expr.value.id, init_expr.idx.id)
 
                 # At the start, determine if this is a module-level assignment to module state
                 is_module_state_var = (
@@ -231,14 +748,28 @@ class StmtGenerator(ASTVisitor):
                     lines.append(f"{var_type} {var_name} = {expr_code};")
                 else:
                     lines.append(f"{var_type} {var_name} = {expr_code};")
+                if not is_module_state_var:
+                    self._expr_gen.declare_unboxed(var_name, None if is_library_ref else init_expr, var_type)
             else:
                 lines.append(f"TABLE {var_name};")
+                self._expr_gen.declare_unboxed(var_name, None)
 
         # If only one variable, return single line; otherwise return all lines
         if len(lines) == 1:
             return lines[0]
         return "\n".join(lines)
 
+    def _upvalue_declaration(self, name_node: astnodes.Name, init_expr: Any) -> str:
+        """`local x = e` for a local closures share and assign: an l2c::Upvalue cell"""
+        value = self._expr_gen.generate(init_expr) if init_expr is not None else "TABLE()"
+        type_info = ASTAnnotationStore.get_type(name_node)
+        var_type = type_info.cpp_type() if type_info is not None else "auto"
+        if init_expr is None:
+            var_type = "TABLE"
+        if var_type == "auto":
+            return f"auto {name_node.id} = l2c::make_upvalue({value});"
+        return f"l2c::Upvalue<{var_type}> {name_node.id}{{{value}}};"
+
     def visit_Assign(self, node: astnodes.Assign) -> str:
         """Generate C++ assignment statement
 
@@ -252,23 +783,29 @@ class StmtGenerator(ASTVisitor):
         Returns:
             str: C++ assignment statement(s)
         """
+        if self._parallel_lane:
+            lane_code = self._lane_assign(node)
+            if lane_code is not None:
+                return lane_code
         lines = []
 
         # For multi-assignment (swap patterns), save all RHS to temps first
         if len(node.targets) > 1:
             # Multi-return unpacking: a, b, c, d = func()
             # Check if single value is a function call
-            if len(node.values) == 1 and isinstance(node.values[0], (astnodes.Call, astnodes.Invoke)):
+            if self._value_packs and len(node.values) == 1 \
+                    and isinstance(node.values[0], (astnodes.Call, astnodes.Invoke, astnodes.Varargs)):
+                source = self._expr_gen.generate_pack_source(node.values[0])
+                lines.append(f"auto _l2c_tmp_0 = l2c::take<{len(node.targets)}>({source});")
+                for i, target_node in enumerate(node.targets):
+                    lines.append(self._store(target_node, f"_l2c_tmp_0[{i+1}]"))
+            elif len(node.values) == 1 and isinstance(node.values[0], (astnodes.Call, astnodes.Invoke)):
                 value_code = self._expr_gen.generate(node.values[0])
                 tmp_name = "_l2c_tmp_0"
                 lines.append(f"auto {tmp_name} = {value_code};")
                 # Assign with indexing: [1], [2], [3], ...
                 for i, target_node in enumerate(node.targets):
-                    target_code = self._expr_gen.generate(target_node)
-                    if i == 0:
-                        lines.append(f"{target_code} = {tmp_name}[1];")
-                    else:
-                        lines.append(f"{target_code} = {tmp_name}[{i+1}];")
+                    lines.append(self._store(target_node, f"{tmp_name}[{i+1}]"))
             else:
                 # Original swap pattern logic
                 temps = []
@@ -280,11 +817,7 @@ class StmtGenerator(ASTVisitor):
 
                 # Now assign temps to targets
                 for i, target_node in enumerate(node.targets):
-                    target_code = self._expr_gen.generate(target_node)
-                    if i < len(temps):
-                        lines.append(f"{target_code} = {temps[i]};")
-                    else:
-                        lines.append(f"{target_code} = TABLE();")
+                    lines.append(self._store(target_node, temps[i] if i < len(temps) else "TABLE()"))
         else:
             # Single assignment - original behavior
             for i, target_node in enumerate(node.targets):
@@ -292,19 +825,28 @@ class StmtGenerator(ASTVisitor):
                 if i < len(node.values):
                     init_expr = node.values[i]
 
-                target_code = self._expr_gen.generate(target_node)
-
                 if init_expr is not None:
+                    target_code = self._expr_gen.generate(target_node)
                     value_code = self._expr_gen.generate(init_expr)
-                    if target_code != value_code:
+                    field_store = self._expr_gen.generate_field_store(target_node, value_code)
+                    if field_store is not None:
+                        lines.append(f"{field_store};")
+                    elif target_code != value_code:
                         lines.append(f"{target_code} = {value_code};")
                 else:
-                    lines.append(f"{target_code} = TABLE();")
+                    lines.append(self._store(target_node, "TABLE()"))
 
         if len(lines) == 1:
             return lines[0]
         return "\n".join(lines)
 
+    def _store(self, target_node: Any, value_code: str) -> str:
+        """Generate `<target> = <value>;`, through l2c::setfield for record fields"""
+        field_store = self._expr_gen.generate_field_store(target_node, value_code)
+        if field_store is not None:
+            return f"{field_store};"
+        return f"{self._expr_gen.generate(target_node)} = {value_code};"
+
     def visit_Return(self, node: astnodes.Return) -> str:
         """Generate C++ return statement
 
@@ -317,6 +859,20 @@ class StmtGenerator(ASTVisitor):
         Returns:
             str: C++ return statement
         """
+        if self._coroutine_frame:
+            if not node.values:
+                return "co_return l2c::Values{};"
+            if len(node.values) == 1:
+                return f"co_return {self._expr_gen.generate_pack_source(node.values[0])};"
+            codes = [self._expr_gen.generate(v) for v in node.values]
+            return f"co_return l2c::Values::of({', '.join(codes)});"
+        if self._tail_call is not None and ASTAnnotationStore.get_annotation(node, 'self_tail_call'):
+            return self._self_tail_call(node.values[0])
+        # Every return of a multi-value function yields the same l2c::ReturnPack<N>,
+        # or an l2c::Values
+        if self._return_arity != 1:
+            return f"return {self._pack_values(node.values or [], self._return_arity)};"
+
         # Return has .values (list of expressions, can be empty)
         if not node.values:
             # For non-void functions, bare return should return NIL
@@ -327,6 +883,8 @@ class StmtGenerator(ASTVisitor):
         if len(node.values) == 1:
             # Single return value
             expr_code = self._expr_gen.generate(node.values[0])
+            if self._profile_site:
+                return f"return _l2c_prof.ret({expr_code});"
             return f"return {expr_code};"
         elif len(node.values) == 2:
             # Multi-return: wrap in multi_return()
@@ -342,6 +900,38 @@ class StmtGenerator(ASTVisitor):
                 result = f"multi_return({code}, {result})"
             return f"return {result};"
 
+    def _self_tail_call(self, call: astnodes.Call) -> str:
+        """`return f(args)` in f: rebind the parameters, then jump to the top
+
+        The arguments are all evaluated before any parameter changes. A
+        template instantiation only rebinds arguments of its parameter
+        types (l2c::rebinds_v), and otherwise makes the call.
+        """
+        name, params, templated = self._tail_call
+        lines = ["{"]
+        temps = []
+        for i, arg in enumerate(call.args):
+            code = self._expr_gen.generate(arg)
+            if self._expr_gen._concrete_signatures and ASTAnnotationStore.get_annotation(arg, 'box_arg'):
+                code = f"l2c::as_value({code})"
+            temps.append(f"_l2c_arg_{i}")
+            lines.append(f"    auto _l2c_arg_{i} = {code};")
+        rebind = [f"{param} = std::move({temp});" for param, temp in zip(params, temps)]
+        if templated:
+            same = " && ".join(f"l2c::rebinds_v<decltype({param}), decltype({temp})>"
+                               for param, temp in zip(params, temps))
+            lines.append(f"    if constexpr ({same}) {{")
+            lines.extend(f"        {line}" for line in rebind)
+            lines.append("        goto _l2c_tail_call;")
+            lines.append("    } else {")
+            lines.append(f"        return {name}({', '.join(temps)});")
+            lines.append("    }")
+        else:
+            lines.extend(f"    {line}" for line in rebind)
+            lines.append("    goto _l2c_tail_call;")
+        lines.append("}")
+        return "\n".join(lines)
+
     def _normalize_block_body(self, block):
         """Normalize Block.body to a list for iteration.
         
@@ -361,14 +951,18 @@ class StmtGenerator(ASTVisitor):
             str: C++ code block as string with braces
         """
         statements = []
+        saved = self._expr_gen.save_unboxed()
         for stmt in self._normalize_block_body(block):
             # Generate each statement using double-dispatch
-            stmt_code = self.visit(stmt)
+            stmt_code = self.generate(stmt)
             statements.append(f"{indent}{stmt_code}")
+        self._expr_gen.restore_unboxed(saved)
 
         return "{\n" + "\n".join(statements) + "\n}"
 
-    def _infer_return_type(self, block: astnodes.Block) -> str:
+    def _infer_return_type(self, block: astnodes.Block, values: Optional[Set[str]] = None) -> str:
+        if values is None:
+            values = self._value_locals(block)
         has_return = False
         for stmt in self._normalize_block_body(block):
             if isinstance(stmt, astnodes.Return):
@@ -376,45 +970,44 @@ class StmtGenerator(ASTVisitor):
                 if not stmt.values:
                     return "void"
                 for value in stmt.values:
-                    expr_code = self._expr_gen.generate(value)
-                    if "NEW_TABLE" in expr_code or "Table" in expr_code:
+                    if self._needs_value(value) or (isinstance(value, astnodes.Name) and value.id in values):
                         return "TABLE"
             elif isinstance(stmt, astnodes.If):
-                body_result = self._infer_return_type(stmt.body)
+                body_result = self._infer_return_type(stmt.body, values)
                 if body_result == "TABLE":
                     return "TABLE"
                 if body_result != "void":
                     has_return = True
                 if stmt.orelse and hasattr(stmt.orelse, 'body'):
-                    else_result = self._infer_return_type(stmt.orelse)
+                    else_result = self._infer_return_type(stmt.orelse, values)
                     if else_result == "TABLE":
                         return "TABLE"
                     if else_result != "void":
                         has_return = True
             elif isinstance(stmt, astnodes.Fornum):
                 # Recursively check for returns inside for loops
-                result = self._infer_return_type(stmt.body)
+                result = self._infer_return_type(stmt.body, values)
                 if result == "TABLE":
                     return "TABLE"
                 if result != "void":
                     has_return = True
             elif isinstance(stmt, astnodes.While):
                 # Recursively check for returns inside while loops
-                result = self._infer_return_type(stmt.body)
+                result = self._infer_return_type(stmt.body, values)
                 if result == "TABLE":
                     return "TABLE"
                 if result != "void":
                     has_return = True
             elif isinstance(stmt, astnodes.Repeat):
                 # Recursively check for returns inside repeat loops
-                result = self._infer_return_type(stmt.body)
+                result = self._infer_return_type(stmt.body, values)
                 if result == "TABLE":
                     return "TABLE"
                 if result != "void":
                     has_return = True
             elif isinstance(stmt, astnodes.Forin):
                 # Recursively check for returns inside for-in loops
-                result = self._infer_return_type(stmt.body)
+                result = self._infer_return_type(stmt.body, values)
                 if result == "TABLE":
                     return "TABLE"
                 if result != "void":
@@ -448,6 +1041,10 @@ class StmtGenerator(ASTVisitor):
 
     def visit_Fornum(self, node: astnodes.Fornum) -> str:
         var_name = node.target.id
+        if self._integer_loops:
+            integer_loop = self._generate_integer_fornum(node)
+            if integer_loop is not None:
+                return integer_loop
         start_code = self._expr_gen.generate(node.start)
         stop_code = self._expr_gen.generate(node.stop)
         
@@ -460,7 +1057,10 @@ class StmtGenerator(ASTVisitor):
         
         # Add loop variable to function locals so body uses local, not module state
         self._expr_gen._function_locals.add(var_name)
+        saved = self._expr_gen.save_unboxed((var_name,))
+        self._expr_gen.declare_number(var_name)
         loop_body = self._generate_block(node.body)
+        self._expr_gen.restore_unboxed(saved)
         self._expr_gen._function_locals.discard(var_name)
         
         # Extract bounds as doubles at loop entry (Lua semantics)
@@ -473,7 +1073,264 @@ class StmtGenerator(ASTVisitor):
         cmp_op = ">=" if is_descending else "<="
         
         start_var = f"_l2c_start_{self._fornum_counter}"
-        return f"double {start_var} = detail::to_tvalue({start_code}).asNumber();\ndouble {limit_var} = detail::to_tvalue({stop_code}).asNumber();\nfor (double {var_name} = {start_var}; {var_name} {cmp_op} {limit_var}; {var_name} += {step_code}) {loop_body}"
+        # Bounds proven to be numbers are already doubles
+        start_code = self._expr_gen.number_expr(node.start) or f"detail::to_tvalue({start_code}).asNumber()"
+        stop_code = self._expr_gen.number_expr(node.stop) or f"detail::to_tvalue({stop_code}).asNumber()"
+        return f"double {start_var} = {start_code};\ndouble {limit_var} = {stop_code};\nfor (double {var_name} = {start_var}; {var_name} {cmp_op} {limit_var}; {var_name} += {step_code}) {loop_body}"
+
+    def _generate_integer_fornum(self, node: astnodes.Fornum) -> Optional[str]:
+        """Generate an integer loop (Lua 5.4) when start and step are integral
+
+        The counter is an int64_t; table keys built from it stay integers and
+        every other read sees a double. Returns None when the step is not an
+        integer literal, the start may be a float, or the body rebinds the
+        loop variable.
+        """
+        var_name = node.target.id
+        if node.step is None:
+            step = 1
+        elif isinstance(node.step, astnodes.Number) and isinstance(node.step.n, int):
+            step = node.step.n
+        elif (isinstance(node.step, astnodes.UMinusOp) and isinstance(node.step.operand, astnodes.Number)
+                and isinstance(node.step.operand.n, int)):
+            step = -node.step.operand.n
+        else:
+            return None
+        if step == 0 or abs(step) >= 2**31:
+            return None
+        start_code = self._expr_gen.integer_expr(node.start)
+        if start_code is None or self._binds_name(node.body, var_name):
+            return None
+        stop_code = self._expr_gen.number_expr(node.stop) or f"detail::to_tvalue({self._expr_gen.generate(node.stop)})"
+
+        parallel = ASTAnnotationStore.get_annotation(node, 'parallel_loop') if self._parallel_loops else None
+        vector = ASTAnnotationStore.get_annotation(node, 'vector_loop') if self._vector_loops else None
+        array = ASTAnnotationStore.get_annotation(node, 'array_loop') if self._array_loops else None
+        self._expr_gen._function_locals.add(var_name)
+        self._expr_gen._integer_locals.add(var_name)
+        saved = self._expr_gen.save_unboxed((var_name,))
+        loop_body = self._generate_block(node.body)
+        lane_body = None
+        if parallel is not None and step == 1 and not self._parallel_lane:
+            self._parallel_lane = True
+            lane_body = self._generate_block(node.body)
+            self._parallel_lane = False
+        array_body = None
+        if array is not None and lane_body is None and not self._parallel_lane:
+            self._array_loops_count += 1
+            spans = {(var_name, name): f"_l2c_{name}_array_{self._array_loops_count}" for name in array}
+            self._expr_gen._array_spans.update(spans)
+            array_body = self._generate_block(node.body)
+            for key in spans:
+                del self._expr_gen._array_spans[key]
+        self._expr_gen.restore_unboxed(saved)
+        self._expr_gen._integer_locals.discard(var_name)
+        self._expr_gen._function_locals.discard(var_name)
+
+        self._fornum_counter += 1
+        start_var = f"_l2c_start_{self._fornum_counter}"
+        limit_var = f"_l2c_limit_{self._fornum_counter}"
+        cmp_op = ">=" if step < 0 else "<="
+        loop = (f"int64_t {start_var} = {start_code};\n"
+                f"int64_t {limit_var} = l2c::for_limit({stop_code}, {step});\n")
+        parallel_for = self._parallel_for(parallel, start_var, limit_var, var_name, lane_body) \
+            if lane_body is not None else None
+        kernel = self._vector_kernel(vector, node, start_var, limit_var, var_name) \
+            if vector is not None and step == 1 else None
+        if kernel is not None:
+            loop += kernel[0]
+        if parallel_for is not None:
+            # The serial loop runs unless parallel_for did the iterations
+            loop += f"if (!{parallel_for})\n"
+        if kernel is not None:
+            loop += f"{kernel[1]} else\n"
+        header = f"for (int64_t {var_name} = {start_var}; {var_name} {cmp_op} {limit_var}; {var_name} += {step}) "
+        if array_body is not None:
+            # The loop visits start..limit, or limit..start counting down
+            low, high = (start_var, limit_var) if step > 0 else (limit_var, start_var)
+            tables = []
+            for (_, name), var in spans.items():
+                span = array[name]
+                table = self._expr_gen.generate(span.table)
+                loop += (f"LuaTable* {var} = l2c::array_span({table}, {low}, {high}, "
+                         f"{span.first}, {span.last});\n")
+                tables.append(var)
+            loop += f"if ({' && '.join(tables)}) {{\n{header}{array_body}\n}} else\n"
+        return loop + header + loop_body
+
+    def _parallel_for(self, info: Any, start_var: str, limit_var: str, var_name: str,
+                      body: str) -> Optional[str]:
+        """l2c::parallel_for running body over the loop's range (lua_parallel.hpp)
+
+        Iterations run on other threads too, where module state is another
+        thread's copy, so the lambda captures this thread's values of the
+        module state it reads. None when an accumulator isn't a variable, or
+        a local of the body was generated as module state.
+        """
+        def var(name: str) -> str:
+            return self._expr_gen.generate(astnodes.Name(name))
+
+        accumulators = [var(name) for name in info.reductions]
+        if not all(acc.isidentifier() for acc in accumulators):
+            return None
+        if any(self._expr_gen.module_state_var(name) is not None for name in info.locals):
+            return None
+        captures = ["&"]
+        for name in info.outer:
+            module_var = self._expr_gen.module_state_var(name)
+            if module_var is not None:
+                captures.append(f"{module_var} = {module_var}")
+        written = ", ".join(f"l2c::as_value({var(name)})" for name in info.written)
+        read = ", ".join(f"l2c::as_value({var(name)})" for name in info.read)
+        args = [start_var, limit_var, f"{{{written}}}", f"{{{read}}}",
+                f"[{', '.join(captures)}](int64_t {var_name}, auto& _l2c_lane) {body}"] + accumulators
+        return f"l2c::parallel_for({', '.join(args)})"
+
+    def _vector_kernel(self, info: Any, node: astnodes.Fornum, start_var: str, limit_var: str,
+                       var_name: str) -> Optional[Tuple[str, str]]:
+        """The loop over number arrays' doubles (lua_vector.hpp), and its setup
+
+        The setup looks up each table's doubles; the kernel runs when all
+        were found and every scalar holds a number, reading the scalars and
+        accumulators into doubles first. None when an accumulator isn't a
+        double variable.
+        """
+        n = self._fornum_counter
+        names = {var_name: f"static_cast<double>({var_name})"}
+        setup, guards, entry, exit_ = [], [], [], []
+        for name in info.tables:
+            pointer = f"_l2c_{name}_{n}"
+            first, last = info.offsets[name]
+            table = self._expr_gen.generate(astnodes.Name(name))
+            setup.append(f"l2c::number_slot* {pointer} = "
+                         f"l2c::number_span({table}, {start_var}, {limit_var}, {first}, {last});\n")
+            guards.append(pointer)
+            names[name] = pointer
+        for name in info.reductions:
+            acc = self._expr_gen.number_expr(astnodes.Name(name))
+            if acc is None or not acc.isidentifier():
+                return None
+            names[name] = f"_l2c_{name}_{n}"
+            entry.append(f"double {names[name]} = {acc};")
+            exit_.append(f"{acc} = {names[name]};")
+        for name in info.scalars:
+            value = self._expr_gen.number_expr(astnodes.Name(name))
+            if value is None:
+                value = self._expr_gen.generate(astnodes.Name(name))
+                guards.append(f"l2c::holds_number({value})")
+                value = f"l2c::unbox_number({value})"
+            names[name] = f"_l2c_{name}_{n}"
+            entry.append(f"const double {names[name]} = {value};")
+        names.update((name, name) for name in info.locals)
+
+        body = []
+        for stmt in node.body.body if isinstance(node.body, astnodes.Block) else node.body:
+            if isinstance(stmt, astnodes.LocalAssign):
+                value = self._kernel_expr(stmt.values[0], names, var_name)
+                body.append(f"double {stmt.targets[0].id} = {value};")
+            elif isinstance(stmt, astnodes.Assign):
+                target, value = stmt.targets[0], stmt.values[0]
+                if isinstance(target, astnodes.Index):
+                    body.append(f"{self._kernel_expr(target, names, var_name)} = "
+                                f"{self._kernel_expr(value, names, var_name)};")
+                elif target.id in info.reductions:
+                    acc = names[target.id]
+                    body.append(f"{acc} = ({acc} + {self._kernel_expr(value.right, names, var_name)});")
+                else:
+                    body.append(f"{target.id} = {self._kernel_expr(value, names, var_name)};")
+        # Iterations can't see each other's stores when every access is at i + k.
+        # Not with accumulators: clang then also lets itself reorder their sums.
+        pragma = "L2C_INDEPENDENT_ITERATIONS\n" if info.independent and not info.reductions else ""
+        loop = (f"{pragma}for (int64_t {var_name} = {start_var}; {var_name} <= {limit_var}; {var_name} += 1) "
+                "{\n" + "".join(f"    {line}\n" for line in body) + "}")
+        kernel = "\n".join(entry + [loop] + exit_)
+        return "".join(setup), f"if ({' && '.join(guards)}) {{\n{kernel}\n}}"
+
+    def _kernel_expr(self, node: Any, names: Dict[str, str], var_name: str) -> str:
+        """A double expression of a vector kernel; names maps Lua names to C++"""
+        if isinstance(node, astnodes.Number):
+            return self._expr_gen.generate(node)
+        if isinstance(node, astnodes.Name):
+            return names[node.id]
+        if isinstance(node, astnodes.Index):
+            k = index_offset(node.idx, var_name) - 1
+            index = var_name if k == 0 else f"{var_name} {'+' if k > 0 else '-'} {abs(k)}"
+            return f"{names[node.value.id]}[{index}]"
+        if isinstance(node, astnodes.UMinusOp):
+            return f"-({self._kernel_expr(node.operand, names, var_name)})"
+        if isinstance(node, astnodes.Call):
+            function = VECTOR_MATH[ASTAnnotationStore.get_annotation(node, 'vector_math')]
+            return f"{function}({self._kernel_expr(node.args[0], names, var_name)})"
+        ops = {astnodes.AddOp: "({} + {})", astnodes.SubOp: "({} - {})", astnodes.MultOp: "({} * {})",
+               astnodes.FloatDivOp: "({} / {})", astnodes.ModOp: "l2c::mod({}, {})",
+               astnodes.ExpoOp: "std::pow({}, {})"}
+        return ops[type(node)].format(self._kernel_expr(node.left, names, var_name),
+                                      self._kernel_expr(node.right, names, var_name))
+
+    def _lane_assign(self, node: astnodes.Assign) -> Optional[str]:
+        """A parallel iteration's stores and accumulator updates go through its lane"""
+        reduction = ASTAnnotationStore.get_annotation(node, 'parallel_reduction')
+        if reduction is not None:
+            return f"_l2c_lane.add({reduction}, {self._expr_gen.generate(node.values[0].right)});"
+        if ASTAnnotationStore.get_annotation(node, 'parallel_store'):
+            target = node.targets[0]
+            table = self._expr_gen.generate(target.value)
+            value = self._expr_gen.generate(node.values[0])
+            return f"_l2c_lane.store(l2c::as_value({table}), {target.idx.id}, l2c::as_value({value}));"
+        return None
+
+    @staticmethod
+    def _needs_value(node: Any) -> bool:
+        """A table constructor, or an integer a double can't hold (is_wide_integer)"""
+        return isinstance(node, astnodes.Table) or is_wide_integer(node)
+
+    @staticmethod
+    def _value_locals(node: Any, names: Optional[Set[str]] = None) -> Set[str]:
+        """The names a block assigns a value no double can hold (_needs_value)"""
+        names = set() if names is None else names
+        if isinstance(node, list):
+            for child in node:
+                StmtGenerator._value_locals(child, names)
+            return names
+        functions = (astnodes.Function, astnodes.LocalFunction, astnodes.Method)
+        if not isinstance(node, astnodes.Node) or isinstance(node, functions):
+            return names
+        if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+            for target, value in zip(node.targets, node.values):
+                if isinstance(target, astnodes.Name) and StmtGenerator._needs_value(value):
+                    names.add(target.id)
+        for attr in ('body', 'orelse'):
+            child = getattr(node, attr, None)
+            if child is not None:
+                StmtGenerator._value_locals(child, names)
+        return names
+
+    @staticmethod
+    def _binds_name(node: Any, name: str) -> bool:
+        """Check if a block assigns to or declares `name` anywhere inside it"""
+        if isinstance(node, list):
+            return any(StmtGenerator._binds_name(child, name) for child in node)
+        if not isinstance(node, astnodes.Node):
+            return False
+        if isinstance(node, (astnodes.Assign, astnodes.LocalAssign)):
+            if any(isinstance(t, astnodes.Name) and t.id == name for t in node.targets):
+                return True
+        if isinstance(node, (astnodes.Function, astnodes.LocalFunction, astnodes.AnonymousFunction)):
+            if any(isinstance(a, astnodes.Name) and a.id == name for a in node.args):
+                return True
+        if isinstance(node, astnodes.LocalFunction) and node.name.id == name:
+            return True
+        if isinstance(node, astnodes.Fornum) and node.target.id == name:
+            return True
+        if isinstance(node, astnodes.Forin) and any(t.id == name for t in node.targets):
+            return True
+        for attr in dir(node):
+            if attr.startswith('_'):
+                continue
+            value = getattr(node, attr, None)
+            if isinstance(value, (astnodes.Node, list)) and StmtGenerator._binds_name(value, name):
+                return True
+        return False
 
     def visit_Function(self, node: astnodes.Function) -> str:
         # Handle both Name and Index (e.g., function Complex.conj() style)
@@ -489,6 +1346,8 @@ class StmtGenerator(ASTVisitor):
         else:
             func_name = "anonymous"
         mangled_name = "_l2c_main" if func_name == "main" else func_name
+        if isinstance(node.name, astnodes.Name) and self.is_coroutine(node):
+            return self._coroutine_definition(node, mangled_name)
         return_type = "auto"
         type_info = ASTAnnotationStore.get_type(node)
         if type_info is not None:
@@ -511,24 +1370,30 @@ class StmtGenerator(ASTVisitor):
                     return True
             return False
         
-        if has_multi_return(node.body):
+        pack_type = self.pack_return_type(node.body)
+        if pack_type:
+            return_type = pack_type
+        elif has_multi_return(node.body):
             return_type = "auto"
         
         template_params = []
         params = []
         param_idx = 1
         for arg in node.args:
-            # Skip Varargs (...), can't generate C++ params for it
+            # Varargs (...) become a trailing parameter pack, or are dropped
             if isinstance(arg, astnodes.Varargs):
                 continue
             template_params.append(f"T{param_idx}")
             params.append(f"T{param_idx} {arg.id}")
             param_idx += 1
+        template_decls = [f"typename {tp}" for tp in template_params]
+        if self._value_packs and any(isinstance(arg, astnodes.Varargs) for arg in node.args):
+            template_decls.append("typename... VA")
+            params.append("VA&&... _l2c_va")
         
         template_str = ""
-        if template_params:
-            template_params_str = ", ".join(f"typename {tp}" for tp in template_params)
-            template_str = f"template<{template_params_str}>\n"
+        if template_decls:
+            template_str = f"template<{', '.join(template_decls)}>\n"
         
         params_str = ", ".join(params)
         # Collect function parameters for proper scoping
@@ -541,16 +1406,11 @@ class StmtGenerator(ASTVisitor):
         # Track the current function's return type for bare return handling
         inferred_return_type = self._infer_return_type(node.body)
         self._current_function_return_type = inferred_return_type
+        saved_packs, prologue = self.begin_value_packs(node.args, node.body)
+        prologue = "\n    ".join(p for p in (prologue, self._profile_prologue(node)) if p)
         body = self._generate_block(node.body, indent="    ")
-        # Add implicit return NIL for non-void functions that don't end with return
-        if inferred_return_type not in ("void", "", "auto"):
-            body_statements = self._normalize_block_body(node.body)
-            last_stmt = body_statements[-1] if body_statements else None
-            if not isinstance(last_stmt, astnodes.Return):
-                body = body.rstrip()
-                if body.endswith("}"):
-                    body = body[:-1]
-                body = body + "\n    return NIL;\n}"
+        body = self._finish_function_body(body, node.body, inferred_return_type, prologue)
+        self.end_value_packs(saved_packs)
         self._current_function_return_type = ""
         self.exit_function()
         
@@ -570,23 +1430,64 @@ class StmtGenerator(ASTVisitor):
                 # Count parameters (excluding Varargs)
                 param_count = sum(1 for arg in node.args if not isinstance(arg, astnodes.Varargs))
                 
-                # Runtime expects exactly 2 args (TValue, TValue) -> TValue
-                # Pad with unused args if function has fewer parameters
-                lambda_params = "TValue arg0, TValue arg1"
+                method_key = self._expr_gen.interned_key(method_name) or f'STRING("{method_name}")'
+                # A library member has no table behind it, only its slot
+                store = self._expr_gen.library_slot(table_name, method_name) or f"{table_prefixed}[{method_key}]"
+
+                if self._typed_closures:
+                    # Closure adapts the call's argument count to this arity
+                    lambda_params = ", ".join(f"TValue arg{i}" for i in range(param_count))
+                    call_args = ", ".join(f"arg{i}" for i in range(param_count))
+                    registration = f'''
+// Register {method_name} in {table_prefixed}
+{store} = l2c::make_function([]({lambda_params}) {{
+    return {mangled_name}({call_args});
+}});'''
+                else:
+                    # Runtime expects exactly 2 args (TValue, TValue) -> TValue
+                    # Pad with unused args if function has fewer parameters
+                    lambda_params = "TValue arg0, TValue arg1"
 
-                # Generate function call arguments - only pass what function needs
-                call_args = ", ".join([f"arg{i}" for i in range(min(param_count, 2))])
-                
-                # Create registration that wraps the template function
-                registration = f'''
+                    # Generate function call arguments - only pass what function needs
+                    call_args = ", ".join([f"arg{i}" for i in range(min(param_count, 2))])
+
+                    # Create registration that wraps the template function
+                    registration = f'''
 // Register {method_name} in {table_prefixed}
-{table_prefixed}[STRING("{method_name}")] = l2c::make_function([]({lambda_params}) -> TValue {{
+{store} = l2c::make_function([]({lambda_params}) -> TValue {{
     return {mangled_name}({call_args});
 }});'''
         if registration:
             self._table_method_registrations.append(registration)
+            # Later calls may now name the C++ function directly
+            self._expr_gen.mark_function_defined(table_name, method_name)
+        speculated = self._speculated_definition(node, template_str, return_type, mangled_name, params, body)
+        if speculated:
+            return speculated
         return f"{template_str}{return_type} {mangled_name}({params_str}) {body}"
 
+    def _finish_function_body(self, body: str, block: Any, return_type: str, prologue: str) -> str:
+        """Add the vararg prologue and the implicit return a function body needs
+
+        Non-void functions that don't end with return get `return NIL;`,
+        multi-value ones their all-nil l2c::ReturnPack.
+        """
+        if prologue:
+            body = "{\n    " + prologue + body[1:]
+        tail = self.implicit_pack_return(block)
+        if not tail and return_type not in ("void", "", "auto", "l2c::Values") \
+                and not return_type.startswith("l2c::ReturnPack"):
+            body_statements = self._normalize_block_body(block)
+            last_stmt = body_statements[-1] if body_statements else None
+            if not isinstance(last_stmt, astnodes.Return):
+                tail = "return NIL;"
+        if tail:
+            body = body.rstrip()
+            if body.endswith("}"):
+                body = body[:-1]
+            body = body + f"\n    {tail}\n}}"
+        return body
+
     def _generate_variadic_overload(self, func_name: str, template_params: list[str], 
                                       params: list[str], return_type: str) -> str:
         """Generate a variadic overload that accepts extra arguments and forwards to the original function.
@@ -674,8 +1575,13 @@ class StmtGenerator(ASTVisitor):
         # Get function name
         func_name = node.name.id
         mangled_name = "_l2c_main" if func_name == "main" else func_name
+        if self.is_coroutine(node):
+            return self._coroutine_definition(node, mangled_name)
+        # Every call passes exactly these types (TypeResolver)
+        concrete_params = ASTAnnotationStore.get_annotation(node, 'concrete_params') \
+            if self._concrete_signatures else None
 
-        if self._expr_gen:
+        if self._expr_gen and not concrete_params:
             self._expr_gen.record_template_function(mangled_name)
 
         # Get return type from type annotation
@@ -687,18 +1593,23 @@ class StmtGenerator(ASTVisitor):
         # Build parameter list with template parameters for C++17 compatibility
         params = []
         template_params = []
-        for arg in node.args:
+        for i, arg in enumerate(node.args):
             # Skip Varargs (...), can't generate C++ params for it
             if isinstance(arg, astnodes.Varargs):
                 continue
+            if concrete_params:
+                params.append(f"{concrete_params[i]} {arg.id}")
+                continue
             template_params.append(f"{arg.id}_t")
             params.append(f"{arg.id}_t {arg.id}")
             arg_type_info = ASTAnnotationStore.get_type(arg)
             if arg_type_info is not None:
                 param_type = arg_type_info.cpp_type()
+        has_varargs = self._value_packs and any(isinstance(arg, astnodes.Varargs) for arg in node.args)
 
-        params_str = ", ".join(params)
-        template_params_str = ", ".join([f"typename {p}" for p in template_params])
+        params_str = ", ".join(params + (["VA&&... _l2c_va"] if has_varargs else []))
+        template_params_str = ", ".join([f"typename {p}" for p in template_params]
+                                        + (["typename... VA"] if has_varargs else []))
 
         
         # Collect local variable names for proper scoping
@@ -749,33 +1660,43 @@ class StmtGenerator(ASTVisitor):
         # Infer return type from function body
         # For recursive functions, C++ cannot deduce auto return type
         # Use explicit TABLE type instead
-        inferred_return_type = "TABLE" if is_recursive(node.body, func_name) else ("auto" if has_multi_return(node.body) else self._infer_return_type(node.body))
+        # A multi-value function names its l2c::ReturnPack, so it may recurse
+        inferred_return_type = (self.pack_return_type(node.body)
+                                or ("TABLE" if is_recursive(node.body, func_name)
+                                    else ("auto" if has_multi_return(node.body) else self._infer_return_type(node.body))))
 
         # Pass local names to expr_generator for proper name mangling
         self._expr_gen.enter_function(local_names)
+        for arg, param_type in zip(node.args, concrete_params or []):
+            if param_type == "double":
+                self._expr_gen.declare_number(arg.id)
         # Generate function body
         self.enter_function()
         # Track the current function's return type for bare return handling
         self._current_function_return_type = inferred_return_type
+        saved_packs, prologue = self.begin_value_packs(node.args, node.body)
+        prologue = "\n    ".join(p for p in (prologue, self._profile_prologue(node)) if p)
+        saved_tail_call = self._tail_call
+        tail_calls = self._tail_calls and ASTAnnotationStore.get_annotation(node, 'self_tail_calls')
+        self._tail_call = (mangled_name, [a.id for a in node.args], bool(template_params)) if tail_calls else None
         body = self._generate_block(node.body, indent="    ")
-        # Add implicit return NIL for non-void functions that don't end with return
-        if inferred_return_type not in ("void", "", "auto"):
-            body_statements = self._normalize_block_body(node.body)
-            last_stmt = body_statements[-1] if body_statements else None
-            if not isinstance(last_stmt, astnodes.Return):
-                body = body.rstrip()
-                if body.endswith("}"):
-                    body = body[:-1]
-                body = body + "\n    return NIL;\n}"
+        self._tail_call = saved_tail_call
+        if tail_calls:
+            # Self tail calls jump here with the parameters rebound
+            body = "{\n    _l2c_tail_call:;" + body[1:]
+        body = self._finish_function_body(body, node.body, inferred_return_type, prologue)
+        self.end_value_packs(saved_packs)
         self._current_function_return_type = ""
         self.exit_function()
         self._expr_gen.exit_function()
 
         # Generate main function
-        if template_params:
-            main_func = f"template<{template_params_str}>\n{inferred_return_type} {mangled_name}({params_str}) {body}"
+        if template_params or has_varargs:
+            main_func = (self._speculated_definition(node, f"template<{template_params_str}>\n",
+                                                     inferred_return_type, mangled_name, params, body)
+                         or f"template<{template_params_str}>\n{inferred_return_type} {mangled_name}({params_str}) {body}")
         else:
-            main_func = f"{inferred_return_type} {mangled_name}() {body}"
+            main_func = f"{inferred_return_type} {mangled_name}({params_str}) {body}"
 
         # Generate variadic overload for ALL template functions
         # This is needed because template functions can be wrapped in lambdas
@@ -788,6 +1709,9 @@ class StmtGenerator(ASTVisitor):
                 params=params,
                 return_type=inferred_return_type
             )
+            if has_varargs:
+                # The primary already accepts extra arguments
+                return f"{main_func}\n\n{fewer}"
             variadic = self._generate_variadic_overload(
                 func_name=mangled_name,
                 template_params=template_param_decls,
@@ -824,11 +1748,26 @@ class StmtGenerator(ASTVisitor):
         return f"do {body} while (!l2c::is_truthy({cond}));"
 
     def visit_Forin(self, node: astnodes.Forin) -> str:
+        # The loop variables shadow unboxed locals
+        saved = self._expr_gen.save_unboxed(tuple(t.id for t in node.targets))
+        try:
+            return self._generate_forin(node)
+        finally:
+            self._expr_gen.restore_unboxed(saved)
+
+    def _generate_forin(self, node: astnodes.Forin) -> str:
         """Generate C++ for-in loop from Lua for-in statement
         
         Handles pairs() and ipairs() iterators:
         - for k, v in pairs(t) do ... end
         - for i, v in ipairs(t) do ... end
+        and, with compiled patterns, gmatch:
+        - for a, b in s:gmatch(p) do ... end
+        and, with buffered io, io.lines:
+        - for line in io.lines([filename [, "L"]]) do ... end
+        and, with coroutines, coroutine.wrap and other function values:
+        - for a, b in coroutine.wrap(f) do ... end
+        - for v in gen(n) do ... end
         
         Args:
             node: Forin AST node with .targets (list of Name nodes),
@@ -860,6 +1799,9 @@ class StmtGenerator(ASTVisitor):
                 # Get table expression from args
                 if iter_call.args and len(iter_call.args) > 0:
                     table_expr = self._expr_gen.generate(iter_call.args[0])
+
+        gmatch_args = self._gmatch_args(iter_call)
+        lines_args = self._lines_args(iter_call)
         
         # Get target variable names
         targets = [t.id for t in node.targets]
@@ -878,7 +1820,23 @@ class StmtGenerator(ASTVisitor):
         self._forin_counter += 1
         counter = self._forin_counter
         
-        if is_pairs:
+        if (is_pairs or is_ipairs) and self._table_iterators:
+            # One iterator object per loop: the table is resolved once and
+            # each step resumes from a cursor instead of re-finding the key
+            iter_var = f"_l2c_forin_iter_{counter}"
+            iter_type = "l2c::PairsIter" if is_pairs else "l2c::IpairsIter"
+            first = f"{iter_var}.key" if is_pairs else f"TValue::Integer({iter_var}.index)"
+            var_assigns = []
+            if len(targets) >= 1 and targets[0] != '_':
+                var_assigns.append(f"auto {targets[0]} = {first};")
+            if len(targets) >= 2 and targets[1] != '_':
+                var_assigns.append(f"auto {targets[1]} = {iter_var}.val;")
+            if var_assigns:
+                assigns_str = "\n    " + "\n    ".join(var_assigns)
+                loop_body = loop_body.replace("{\n", "{" + assigns_str + "\n", 1)
+            return f"for ({iter_type} {iter_var}({table_expr}); {iter_var}.next(); ) {loop_body}"
+
+        elif is_pairs:
             # pairs(t) - iterate all key-value pairs
             key_var = f"_l2c_forin_key_{counter}"
             val_var = f"_l2c_forin_val_{counter}"
@@ -928,10 +1886,110 @@ while ({table_expr}.toTable()->next({key_var}, {val_var})) {loop_body}"""
 {body_content}
 }}"""
         
+        elif gmatch_args is not None:
+            # s:gmatch(p) - one l2c::GMatch per loop, captures bound per match
+            iter_var = f"_l2c_forin_gmatch_{counter}"
+            var_assigns = [
+                f"auto {target} = {iter_var}.capture({i});"
+                for i, target in enumerate(targets) if target != '_'
+            ]
+            if var_assigns:
+                assigns_str = "\n    " + "\n    ".join(var_assigns)
+                loop_body = loop_body.replace("{\n", "{" + assigns_str + "\n", 1)
+            subject, pattern = gmatch_args
+            return f"for (l2c::GMatch {iter_var}({subject}, {pattern}); {iter_var}.next(); ) {loop_body}"
+
+        elif lines_args is not None:
+            # io.lines() - lines are views into the input buffer, copied
+            # into a Lua string only when the body binds them
+            iter_var = f"_l2c_forin_lines_{counter}"
+            if targets and targets[0] != '_':
+                assigns_str = f"\n    auto {targets[0]} = {iter_var}.line();"
+                loop_body = loop_body.replace("{\n", "{" + assigns_str + "\n", 1)
+            decl = f"{iter_var}({', '.join(lines_args)})" if lines_args else iter_var
+            return f"for (l2c::LinesIter {decl}; {iter_var}.next(); ) {loop_body}"
+
         else:
+            wrap_arg = self._wrap_iter_arg(node)
+            if wrap_arg is not None:
+                # coroutine.wrap(f) - each step resumes the thread directly,
+                # the loop variables bound to the values it yields
+                iter_var = f"_l2c_forin_wrap_{counter}"
+                var_assigns = [
+                    f"auto {target} = {iter_var}.value({i + 1});"
+                    for i, target in enumerate(targets) if target != '_'
+                ]
+                if var_assigns:
+                    assigns_str = "\n    " + "\n    ".join(var_assigns)
+                    loop_body = loop_body.replace("{\n", "{" + assigns_str + "\n", 1)
+                return f"for (l2c::WrapIter {iter_var}({wrap_arg}); {iter_var}.next(); ) {loop_body}"
+
             # Fallback for unknown iterators
             return f"/* for-in: unsupported iterator */"
 
+    def _gmatch_args(self, iter_call: Any) -> Optional[Tuple[str, str]]:
+        """(subject, pattern) C++ expressions of an `s:gmatch(p)` / `string.gmatch(s, p)` iterator"""
+        if not self._compiled_patterns:
+            return None
+        if isinstance(iter_call, astnodes.Invoke):
+            if not (isinstance(iter_call.func, astnodes.Name) and iter_call.func.id == 'gmatch'
+                    and len(iter_call.args) == 1):
+                return None
+            subject_node, pattern_node = iter_call.source, iter_call.args[0]
+        elif isinstance(iter_call, astnodes.Call):
+            func = iter_call.func
+            if not (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+                    and func.value.id == 'string' and isinstance(func.idx, astnodes.Name)
+                    and func.idx.id == 'gmatch' and len(iter_call.args) == 2):
+                return None
+            subject_node, pattern_node = iter_call.args
+        else:
+            return None
+        pattern = self._expr_gen.compiled_pattern(pattern_node) or self._expr_gen.generate(pattern_node)
+        return self._expr_gen.generate(subject_node), pattern
+
+    def _wrap_iter_arg(self, node: astnodes.Forin) -> Optional[str]:
+        """The l2c::WrapIter constructor argument of a function-value iterator
+
+        `coroutine.wrap(f)` passes f itself, so the loop makes and owns the
+        thread; any other single iterator expression is taken as a function
+        value, which WrapIter resumes directly when coroutine.wrap made it.
+        """
+        if not self._coroutines or len(node.iter) != 1:
+            return None
+        iter_call = node.iter[0]
+        if (isinstance(iter_call, astnodes.Call) and isinstance(iter_call.func, astnodes.Index)
+                and isinstance(iter_call.func.value, astnodes.Name) and iter_call.func.value.id == 'coroutine'
+                and isinstance(iter_call.func.idx, astnodes.Name) and iter_call.func.idx.id == 'wrap'
+                and len(iter_call.args) == 1):
+            arg = iter_call.args[0]
+            return self._expr_gen.coroutine_starter(arg) or self._expr_gen.generate(arg)
+        if isinstance(iter_call, (astnodes.Call, astnodes.Invoke, astnodes.Name, astnodes.Index)):
+            return f"l2c::as_value({self._expr_gen.generate(iter_call)})"
+        return None
+
+    def _lines_args(self, iter_call: Any) -> Optional[List[str]]:
+        """l2c::LinesIter constructor arguments of an `io.lines([filename [, fmt]])` iterator
+
+        Only the line formats are lowered: fmt must be a literal "l" or "L".
+        """
+        if not self._buffered_io or not isinstance(iter_call, astnodes.Call):
+            return None
+        func = iter_call.func
+        if not (isinstance(func, astnodes.Index) and isinstance(func.value, astnodes.Name)
+                and func.value.id == 'io' and isinstance(func.idx, astnodes.Name)
+                and func.idx.id == 'lines' and len(iter_call.args) <= 2):
+            return None
+        args = [self._expr_gen.generate(arg) for arg in iter_call.args[:1]]
+        if len(iter_call.args) == 2:
+            fmt = iter_call.args[1]
+            if not isinstance(fmt, astnodes.String):
+                return None
+            text = fmt.s.decode() if isinstance(fmt.s, bytes) else fmt.s
+            if text.lstrip('*') not in ('l', 'L'):
+                return None
+            args.append(f'"{text.lstrip("*")}"')
+        return args
 
     def visit_Break(self, node: astnodes.Break) -> str:
         return "break;"
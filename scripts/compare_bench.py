@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""
+Compare two sets of benchmark JSON results (bench_harness.hpp format).
+Reports the p50 change per benchmark and flags regressions.
+"""
+
+import json
+import sys
+from pathlib import Path
+from typing import Dict, List
+
+
+def load_results(path: Path) -> Dict[str, dict]:
+    """Load one JSON file, or every *.json in a directory, keyed by suite/name."""
+    files: List[Path] = sorted(path.glob("*.json")) if path.is_dir() else [path]
+    results = {}
+    for f in files:
+        data = json.loads(f.read_text())
+        for bench in data["benchmarks"]:
+            results[f"{data['suite']}/{bench['name']}"] = bench
+    return results
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(f"Usage: {sys.argv[0]} <baseline> <candidate> [--threshold=5]")
+        print("  baseline/candidate: a JSON file or a directory of them")
+        sys.exit(1)
+
+    baseline = load_results(Path(sys.argv[1]))
+    candidate = load_results(Path(sys.argv[2]))
+    threshold = 5.0
+
+    for arg in sys.argv[3:]:
+        if arg.startswith('--threshold='):
+            threshold = float(arg.split('=')[1])
+
+    regressions = 0
+    print(f"{'benchmark':40} {'base p50':>12} {'new p50':>12} {'change':>9}")
+    for name in sorted(set(baseline) | set(candidate)):
+        if name not in baseline or name not in candidate:
+            print(f"{name:40} {'only in ' + ('baseline' if name in baseline else 'candidate'):>35}")
+            continue
+        old, new = baseline[name]["p50_ns"], candidate[name]["p50_ns"]
+        change = (new - old) / old * 100 if old else 0.0
+        mark = ""
+        if change > threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        elif change < -threshold:
+            mark = "  faster"
+        print(f"{name:40} {old:12.0f} {new:12.0f} {change:+8.1f}%{mark}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) slower by more than {threshold}%")
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+End-to-end shootout: transpiled C++ against Lua 5.4 and LuaJIT.
+
+Every program in tests/cpp/lua/ with a benchmark entry below is transpiled
+with the lua_table runtime, built at each optimization level, and run for a
+sweep of N values next to the interpreters found on PATH. Outputs are
+checked against the reference interpreter with scripts/compare_output.py.
+Reports wall time (best of --reps), peak RSS and speedup over the reference.
+
+Usage: scripts/shootout.py [--programs n-body,fasta] [--levels O2,O3,LTO]
+                           [--reps 3] [--quick] [--json results.json]
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent
+LUA_DIR = PROJECT_ROOT / "tests/cpp/lua"
+RUNTIME_DIR = PROJECT_ROOT / "tests/cpp/runtime"
+MAIN_TEMPLATE = PROJECT_ROOT / "tests/cpp/templates/test_main.cpp.in"
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from compare_output import compare_files  # noqa: E402
+
+# program -> (N sweep, quick N); k-nucleotide and regex-dna read fasta output on stdin
+PROGRAMS: Dict[str, Tuple[List[str], str]] = {
+    "n-body": (["100000", "500000", "1000000"], "1000"),
+    "fannkuch-redux": (["8", "9", "10"], "7"),
+    "binary-trees": (["12", "14", "16"], "10"),
+    "spectral-norm": (["100", "500", "1000"], "100"),
+    "fasta": (["25000", "250000", "1000000"], "1000"),
+    "k-nucleotide": (["25000", "250000"], "1000"),
+    "regex-dna": (["25000", "250000"], "1000"),
+    "mandel": (["256", "512", "1024"], "64"),
+    "heapsort": (["100000", "1000000"], "1000"),
+    "sieve": (["100", "1000"], "10"),
+    "queen": (["8", "10"], "6"),
+    "ack": (["9", "10"], "6"),
+    "fixpoint-fact": (["100", "1000"], "10"),
+    "scimark": (["1", "2"], "1"),
+}
+STDIN_FROM_FASTA = {"k-nucleotide", "regex-dna"}
+
+LEVELS = {
+    "O2": ["-O2"],
+    "O3": ["-O3"],
+    "LTO": ["-O3", "-flto", "-march=native"],
+}
+
+
+def transpile(program: str, gen_dir: Path) -> Path:
+    """Transpile one program; returns the generated .cpp"""
+    cmd = [sys.executable, "-m", "lua2cpp.cli.main", str(LUA_DIR / f"{program}.lua"),
+           "--lib", "--runtime=lua_table", "--output-dir", str(gen_dir)]
+    result = subprocess.run(cmd, cwd=PROJECT_ROOT, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"transpiling {program} failed:\n{result.stderr}")
+    return gen_dir / f"{program}.cpp"
+
+
+def build(program: str, gen_cpp: Path, level: str, build_dir: Path, cxx: str) -> Path:
+    """Build the test main for one program at one optimization level"""
+    stem = program.replace('-', '_')
+    main_cpp = build_dir / f"{stem}_main.cpp"
+    text = MAIN_TEMPLATE.read_text()
+    for key, value in (("MODULE_NAME", stem), ("MODULE_FILE", gen_cpp.stem),
+                       ("MODULE_INIT_FUNC", f"{stem}_module_init")):
+        text = text.replace(f"@{key}@", value)
+    main_cpp.write_text(text)
+    exe = build_dir / f"{stem}_{level}"
+    cmd = [cxx, "-std=c++20", *LEVELS[level], "-I", str(RUNTIME_DIR), "-I", str(gen_cpp.parent),
+           str(main_cpp), "-o", str(exe), "-lm"]
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"building {program} at {level} failed:\n{result.stderr[:4000]}")
+    return exe
+
+
+def run_once(cmd: List[str], stdin_path: Optional[Path], out_path: Path) -> Tuple[float, int, int]:
+    """Run cmd; returns (wall seconds, peak RSS in KiB, exit code)"""
+    stdin = open(stdin_path, "rb") if stdin_path else subprocess.DEVNULL
+    try:
+        with open(out_path, "wb") as out:
+            start = time.perf_counter()
+            proc = subprocess.Popen(cmd, stdin=stdin, stdout=out, stderr=subprocess.DEVNULL)
+            _, status, usage = os.wait4(proc.pid, 0)
+            wall = time.perf_counter() - start
+            proc.returncode = os.waitstatus_to_exitcode(status)
+    finally:
+        if stdin_path:
+            stdin.close()
+    return wall, usage.ru_maxrss, proc.returncode
+
+
+def measure(cmd: List[str], stdin_path: Optional[Path], out_path: Path, reps: int) -> dict:
+    best_wall, peak_rss, code = float("inf"), 0, 0
+    for _ in range(reps):
+        wall, rss, code = run_once(cmd, stdin_path, out_path)
+        if code != 0:
+            break
+        best_wall, peak_rss = min(best_wall, wall), max(peak_rss, rss)
+    return {"wall_s": best_wall if code == 0 else None, "rss_kib": peak_rss, "exit": code}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--programs", help="comma-separated subset of: " + ", ".join(PROGRAMS))
+    parser.add_argument("--levels", default="O2,O3,LTO", help="comma-separated subset of: " + ", ".join(LEVELS))
+    parser.add_argument("--reps", type=int, default=3, help="runs per measurement; the best is kept")
+    parser.add_argument("--quick", action="store_true", help="one small N per program (smoke test)")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    parser.add_argument("--json", help="also write the results to this file")
+    parser.add_argument("--keep", help="build in this directory and keep it")
+    args = parser.parse_args()
+
+    programs = args.programs.split(",") if args.programs else list(PROGRAMS)
+    levels = args.levels.split(",")
+    for name in programs:
+        if name not in PROGRAMS:
+            parser.error(f"unknown program {name}")
+    for level in levels:
+        if level not in LEVELS:
+            parser.error(f"unknown level {level}")
+
+    interpreters = [(name, path) for name in ("lua5.4", "luajit") if (path := shutil.which(name))]
+    if not interpreters and shutil.which("lua"):
+        interpreters = [("lua", shutil.which("lua"))]
+    if not interpreters:
+        print("warning: no Lua interpreter on PATH; outputs are not checked", file=sys.stderr)
+    reference = interpreters[0][0] if interpreters else None
+
+    work = Path(args.keep) if args.keep else Path(tempfile.mkdtemp(prefix="l2c_shootout_"))
+    gen_dir, build_dir, out_dir = work / "generated", work / "build", work / "out"
+    for d in (gen_dir, build_dir, out_dir):
+        d.mkdir(parents=True, exist_ok=True)
+
+    rows = []
+    try:
+        for program in programs:
+            sweep, quick_n = PROGRAMS[program]
+            try:
+                gen_cpp = transpile(program, gen_dir)
+                exes = {f"l2c-{level}": build(program, gen_cpp, level, build_dir, args.cxx) for level in levels}
+            except RuntimeError as e:
+                print(f"{program}: {e}", file=sys.stderr)
+                rows.append({"program": program, "n": None, "impl": "l2c", "error": "build failed"})
+                continue
+            for n in ([quick_n] if args.quick else sweep):
+                stdin_path = None
+                if program in STDIN_FROM_FASTA:
+                    if not reference:
+                        continue
+                    stdin_path = out_dir / f"fasta_{n}.txt"
+                    if not stdin_path.exists():
+                        run_once([dict(interpreters)[reference], str(LUA_DIR / "fasta.lua"), n], None, stdin_path)
+                    cmd_args = []
+                else:
+                    cmd_args = [n]
+                impls = [(name, [path, str(LUA_DIR / f"{program}.lua"), *cmd_args]) for name, path in interpreters]
+                impls += [(name, [str(exe), *cmd_args]) for name, exe in exes.items()]
+                ref_out, ref_wall = None, None
+                for impl, cmd in impls:
+                    out_path = out_dir / f"{program}_{n}_{impl}.txt"
+                    row = {"program": program, "n": n, "impl": impl, **measure(cmd, stdin_path, out_path, args.reps)}
+                    row["output_ok"] = row["exit"] == 0
+                    if impl == reference:
+                        ref_out, ref_wall = out_path, row["wall_s"]
+                    elif ref_out is not None and row["output_ok"]:
+                        row["output_ok"] = compare_files(str(ref_out), str(out_path), 1e-6)
+                    row["speedup"] = ref_wall / row["wall_s"] if ref_wall and row["wall_s"] else None
+                    rows.append(row)
+                    print_row(row, reference)
+    finally:
+        if not args.keep:
+            shutil.rmtree(work, ignore_errors=True)
+
+    if args.json:
+        Path(args.json).write_text(json.dumps({"reference": reference, "levels": levels, "results": rows}, indent=2))
+    failures = [r for r in rows if r.get("error") or not r.get("output_ok", False)]
+    if failures:
+        print(f"{len(failures)} run(s) failed or produced different output", file=sys.stderr)
+        sys.exit(1)
+
+
+_header_printed = False
+
+
+def print_row(row: dict, reference: Optional[str]) -> None:
+    global _header_printed
+    if not _header_printed:
+        print(f"| program | N | impl | wall (s) | peak RSS (MB) | speedup vs {reference or '-'} | output |")
+        print("|---|---|---|---|---|---|---|")
+        _header_printed = True
+    wall = f"{row['wall_s']:.3f}" if row["wall_s"] is not None else f"exit {row['exit']}"
+    speedup = f"{row['speedup']:.2f}x" if row.get("speedup") else "-"
+    ok = "ok" if row.get("output_ok") else "DIFF"
+    print(f"| {row['program']} | {row['n']} | {row['impl']} | {wall} | {row['rss_kib'] / 1024:.1f} | {speedup} | {ok} |",
+          flush=True)
+
+
+if __name__ == '__main__':
+    main()
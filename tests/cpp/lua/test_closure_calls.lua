@@ -0,0 +1,51 @@
+-- Functions stored in tables get their arguments, whatever their arity,
+-- and however many arguments the call passes
+
+local t = {}
+t.first = function(a, b) return a end
+t.second = function(a, b) return b end
+t.sum = function(a, b, c, d, e) return a + b + c + d + e end
+t.count = function(...) return select("#", ...) end
+t.last = function(...) local v = {...}; return v[#v] end
+
+local function fixed()
+    assert(t.first("x", "y") == "x")
+    assert(t.second(10, 20) == 20)
+    assert(t.second(10) == nil)
+    assert(t.first(1, 2, 3) == 1)
+    assert(t.sum(1, 2, 3, 4, 5) == 15)
+end
+
+local function varargs()
+    assert(t.count() == 0)
+    assert(t.count(1, 2) == 2)
+    assert(t.count(1, 2, 3) == 3)
+    assert(t.count(1, 2, 3, 4, 5) == 5)
+    assert(t.last(1, 2, 3, 4, 5) == 5)
+end
+
+-- Two-argument metamethods reading fields of both operands
+local V = {}
+V.__add = function(a, b) return setmetatable({x = a.x + b.x}, V) end
+V.__sub = function(a, b) return a.x - b.x end
+
+local function metamethods()
+    local p = setmetatable({x = 1}, V) + setmetatable({x = 2}, V)
+    assert(p.x == 3)
+    assert(p - setmetatable({x = 1}, V) == 2)
+end
+
+local function wrapped()
+    local w = coroutine.wrap(function(a, b)
+        local c = coroutine.yield(a + b)
+        return c * 2
+    end)
+    assert(w(3, 4) == 7)
+    assert(w(5) == 10)
+end
+
+fixed()
+varargs()
+metamethods()
+wrapped()
+print("closure calls ok")
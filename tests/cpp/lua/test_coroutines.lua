@@ -0,0 +1,41 @@
+-- Producer/consumer pipeline over coroutines
+
+local function producer(n)
+  for i = 1, n do
+    coroutine.yield(i)
+  end
+  return "done"
+end
+
+local function filter(source, m)
+  for v in source do
+    if v % m ~= 0 then
+      coroutine.yield(v)
+    end
+  end
+end
+
+local function consume()
+  local source = coroutine.wrap(function() producer(30) end)
+  local odd = coroutine.wrap(function() filter(source, 2) end)
+  local sum = 0
+  for v in coroutine.wrap(function() filter(odd, 3) end) do
+    sum = sum + v
+  end
+  return sum
+end
+
+local function handshake()
+  local co = coroutine.create(function(a, b)
+    local c, d = coroutine.yield(a + b)
+    return c * d
+  end)
+  local ok1, first = coroutine.resume(co, 1, 2)
+  local ok2, second = coroutine.resume(co, 3, 4)
+  local ok3 = coroutine.resume(co)
+  print(ok1, first, ok2, second, ok3, coroutine.status(co))
+  return 0
+end
+
+print(consume())
+handshake()
@@ -0,0 +1,41 @@
+-- Lua 5.4 integer operators: //, % and the bitwise operators on loop
+-- counters (int64_t in the generated code) and on other numbers
+
+local function bits(n)
+  local c = 0
+  while n ~= 0 do
+    c = c + (n & 1)
+    n = n >> 1
+  end
+  return c
+end
+
+local total, mixed = 0, 0
+for i = 1, 1000 do
+  total = total + (i // 3) + (i % 7) + ((i << 2) ~ i)
+  mixed = mixed + (i | 5) - (i & 12)
+end
+print(total, mixed, bits(255), bits(1023))
+
+-- Floor division and modulo round toward minus infinity
+local neg = {}
+for i = -4, 4 do neg[#neg + 1] = (i // 3) .. ":" .. (i % 3) end
+print(table.concat(neg, " "))
+print(7 // 2, -7 // 2, 7.5 // 2, -7 % 3, 7 % -3)
+
+-- Shifts of 64 bits or more give 0; negative shifts go the other way
+for i = 62, 65 do io.write(1 << i, " ") end
+print()
+for i = -1, 1 do io.write(256 >> i, " ") end
+print()
+
+-- A string hash keeps 32 bits
+local h = 0
+local s = "integer arithmetic"
+for i = 1, #s do h = (h * 31 + s:byte(i)) & 0xffffffff end
+print(h, ~0, ~h & 0xff)
+
+-- Integer keys built from loop counters
+local t = {}
+for i = 1, 20 do t[i // 2 + 1] = i end
+print(#t, t[1], t[11])
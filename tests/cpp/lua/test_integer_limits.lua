@@ -0,0 +1,32 @@
+-- math.maxinteger and math.mininteger are 64-bit integers: they print in
+-- full, wrap around, and stay exact in integer arithmetic
+
+local function limits()
+    assert(tostring(math.maxinteger) == "9223372036854775807")
+    assert(tostring(math.mininteger) == "-9223372036854775808")
+    assert(type(math.mininteger) == "number")
+    assert(math.maxinteger > 2^62)
+    assert(math.mininteger < 0)
+end
+
+local function arithmetic()
+    assert(math.maxinteger - 1 == 9223372036854775806)
+    assert(math.maxinteger + 1 == math.mininteger)
+    assert(-math.mininteger == math.mininteger)
+    assert(math.maxinteger // 2 == 4611686018427387903)
+    assert(math.mininteger // 2 == -4611686018427387904)
+    assert(math.maxinteger & 0xff == 255)
+end
+
+local function values()
+    local big = math.maxinteger
+    local t = {[big] = "max"}
+    assert(t[math.maxinteger] == "max")
+    assert(t[9223372036854775807] == "max")
+    assert(big == math.maxinteger)
+end
+
+limits()
+arithmetic()
+values()
+print(math.maxinteger, math.mininteger)
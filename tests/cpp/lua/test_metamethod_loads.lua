@@ -0,0 +1,61 @@
+-- Field reads are not shared across accesses whose metamethods may
+-- change the field: __newindex and __index here store to p.f. Tables
+-- passed in may have metatables of their own
+
+local function stores()
+    local p = {f = 2}
+    local mt = setmetatable({}, {__newindex = function(t, k, v) p.f = v end})
+    local res = p.f
+    mt.z = 99
+    local now = p.f
+    assert(res == 2)
+    assert(now == 99)
+    return res, now
+end
+
+local function reads()
+    local p = {f = 2}
+    local lazy = setmetatable({}, {__index = function(t, k) p.f = p.f + 1; return 7 end})
+    local before = p.f
+    local seven = lazy.anything
+    local after = p.f
+    assert(seven == 7)
+    assert(after == before + 1)
+    return before, after
+end
+
+local function loop(n)
+    local p = {f = 0}
+    local mt = setmetatable({}, {__newindex = function(t, k, v) p.f = v end})
+    local seen = 0
+    for i = 1, n do
+        mt.z = i
+        seen = seen + p.f
+    end
+    return seen
+end
+
+-- p and mt arrive as parameters; both have metatables
+local function passed(p, mt)
+    local first = p.f + p.f
+    mt.z = 10
+    local after = p.f
+    return first, after
+end
+
+local function counted()
+    local reads = 0
+    local p = setmetatable({}, {__index = function(t, k) reads = reads + 1; return reads end})
+    local mt = setmetatable({}, {__newindex = function(t, k, v) p.f = v end})
+    local first, after = passed(p, mt)
+    assert(first == 3)
+    assert(reads == 2)
+    assert(after == 10)
+    return first, after
+end
+
+print(stores())
+print(reads())
+print(counted())
+assert(loop(4) == 10)
+print(loop(4))
@@ -0,0 +1,61 @@
+-- Loops that --parallel runs on all cores, and ones it must leave serial
+
+local function weight(i, j)
+  local d = i - j
+  return 1 / (1 + d * d)
+end
+
+local function smooth(src, dst, n)
+  for i = 1, n do
+    local acc = 0
+    for j = 1, n do
+      acc = acc + src[j] * weight(i, j)
+    end
+    dst[i] = acc
+  end
+end
+
+local n = 300
+local src, dst = {}, {}
+for i = 1, n do src[i] = i % 7 end
+
+-- First call grows dst: its stores wait until the join
+smooth(src, dst, n)
+-- Second call overwrites numbers in place
+smooth(src, dst, n)
+local first, last = dst[1], dst[n]
+print(string.format("%.6f %.6f", first, last))
+
+-- Accumulators, one local and one module-level
+local total = 0
+local function sum_weights(m)
+  local s = 0
+  for i = 1, m do
+    s = s + weight(i, 1)
+    total = total + src[i]
+  end
+  return s
+end
+print(string.format("%.6f %d", sum_weights(n), total))
+
+-- Aliased tables run serially: each iteration sees the previous store
+local shift = {}
+for i = 1, 10 do shift[i] = i end
+local function propagate(a, b, m)
+  for i = 2, m do
+    a[i] = b[i - 1] + weight(i, i)
+  end
+end
+propagate(shift, shift, 10)
+print(shift[10])
+
+-- A metatable on a read table runs serially too
+local inherited = setmetatable({}, {__index = src})
+local out = {}
+local function copy(m)
+  for i = 1, m do
+    out[i] = inherited[i] * weight(i, i)
+  end
+end
+copy(20)
+print(out[20])
@@ -0,0 +1,42 @@
+-- Functions returning a table constructor, or a local holding one,
+-- return the table itself
+
+local function pt(x, y) return {x = x, y = y} end
+local function zeros(n)
+    local t = {}
+    for i = 1, n do t[i] = 0 end
+    return t
+end
+local function empty() return {} end
+
+-- binary-trees: make and check a tree of records
+local function make(depth)
+    if depth == 0 then return {left = false, right = false} end
+    depth = depth - 1
+    return {left = make(depth), right = make(depth)}
+end
+
+local function check(tree)
+    if tree.left then return 1 + check(tree.left) + check(tree.right) end
+    return 1
+end
+
+local function records()
+    local p = pt(1, 2)
+    assert(p.x + p.y == 3)
+    local q = pt("a", "b")
+    assert(q.x .. q.y == "ab")
+    assert(check(make(4)) == 31)
+end
+
+local function arrays()
+    assert(#zeros(5) == 5)
+    assert(zeros(3)[2] == 0)
+    local e = empty()
+    e[1] = 4
+    assert(#e == 1)
+end
+
+records()
+arrays()
+print("returned tables ok")
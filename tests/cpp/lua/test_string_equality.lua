@@ -0,0 +1,35 @@
+-- == and ~= on strings compare contents: results of .., sub and format
+-- are not interned, so equal strings may live at different addresses
+
+local a = "x" .. 1
+local b = "x" .. 1
+print(a == b, a ~= b, ("x" .. 1) == ("x" .. 1), a == "x1", "x1" ~= a)
+assert(a == b)
+assert(not (a ~= b))
+assert(("x" .. 1) == ("x" .. 1))
+assert(a == "x1")
+assert(a ~= "x2")
+
+local s = "hello world"
+local w = s:sub(1, 5)
+local h = "hel" .. "lo"
+print(w == h, w == "hello", string.format("%s", w) == h)
+assert(w == h)
+assert(string.format("%d-%d", 1, 2) == "1" .. "-" .. "2")
+
+-- Through tables and function arguments
+local t = {name = "n" .. 7}
+local function same(x, y) return x == y end
+print(t.name == "n7", t.name == "n" .. 7)
+assert(t.name == "n" .. 7)
+assert(same(t.name, "n7"))
+assert(not same(a, "y1"))
+
+-- Counting equal strings built in a loop
+local hits = 0
+for i = 1, 100 do
+  local k = "k" .. (i % 10)
+  if k == "k3" then hits = hits + 1 end
+end
+print(hits)
+assert(hits == 10)
@@ -0,0 +1,64 @@
+-- find, match and gsub return all their results: positions and captures,
+-- every capture, the replaced string and the match count
+
+local function positions(s)
+    local i, j = s:find("wor")
+    assert(i == 7)
+    assert(j == 9)
+    local k, l, c = string.find(s, "(o)r")
+    assert(k == 8)
+    assert(l == 9)
+    assert(c == "o")
+    local p, q = s:find("o w", 1, true)
+    assert(p == 5)
+    assert(q == 7)
+    local none, rest = s:find("zz")
+    assert(none == nil)
+    assert(rest == nil)
+    -- One value where one is wanted
+    assert(s:find("o") + 1 == 6)
+    local first = s:find("l")
+    assert(first == 3)
+end
+
+local function captures(s)
+    local a, b = s:match("(%a+) (%a+)")
+    assert(a == "hello")
+    assert(b == "world")
+    local x, y, z = string.match(s, "(h)(e)(l)")
+    assert(x == "h")
+    assert(y == "e")
+    assert(z == "l")
+    local whole, extra = s:match("wor")
+    assert(whole == "wor")
+    assert(extra == nil)
+    local m, n = s:match("(%d+)")
+    assert(m == nil)
+    assert(n == nil)
+    assert(s:match("(%a+) (%a+)") == "hello")
+end
+
+local function replacements(s)
+    local r, n = s:gsub("o", "0")
+    assert(r == "hell0 w0rld")
+    assert(n == 2)
+    local u, m = string.gsub(s, "l", "L", 2)
+    assert(u == "heLLo world")
+    assert(m == 2)
+    local same, none = s:gsub("z", "Z")
+    assert(same == s)
+    assert(none == 0)
+    local f, k = s:gsub("%a+", function(w) return w:upper() end)
+    assert(f == "HELLO WORLD")
+    assert(k == 2)
+    -- One value where one is wanted
+    local only = s:gsub("l", "")
+    assert(only == "heo word")
+    assert((s:gsub("d", "!")) .. "?" == "hello worl!?")
+end
+
+local s = "hello world"
+positions(s)
+captures(s)
+replacements(s)
+print("string results ok")
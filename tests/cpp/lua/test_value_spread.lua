@@ -0,0 +1,69 @@
+-- `...` and multi-value calls give all their values as the last return
+-- value and the last call argument, and only their first elsewhere
+
+local function va(...) return ... end
+local function two() return 1, 2 end
+local function cnt(...) return select("#", ...) end
+local function pass(x, ...) return x, ... end
+local function add(a, b, c)
+    local sum = a + b
+    if c ~= nil then sum = sum + c end
+    return sum
+end
+local function wrap() return two() end
+local function more() return 0, two() end
+
+local function returns()
+    local a, b = va(7, 8)
+    assert(a == 7)
+    assert(b == 8)
+    local p, q, r, s = pass(1, 2, 3)
+    assert(p == 1)
+    assert(q == 2)
+    assert(r == 3)
+    assert(s == nil)
+    local w1, w2 = wrap()
+    assert(w1 == 1)
+    assert(w2 == 2)
+    local m1, m2, m3 = more()
+    assert(m1 == 0)
+    assert(m2 == 1)
+    assert(m3 == 2)
+    local none = va()
+    assert(none == nil)
+end
+
+local function arguments()
+    assert(cnt(two()) == 2)
+    assert(cnt(1, two()) == 3)
+    assert(cnt(two(), 5) == 2)
+    assert(cnt(va(1, 2, 3)) == 3)
+    assert(cnt(va()) == 0)
+    assert(add(two()) == 3)
+    assert(add(10, two()) == 13)
+    assert(add(two(), 10) == 11)
+    assert(cnt(("a b"):find("b")) == 2)
+end
+
+local function single()
+    -- One value where one is wanted
+    assert(two() + 1 == 2)
+    assert(va(5, 6) * 2 == 10)
+    local t = {two()}
+    assert(#t == 2)
+    local u = {two(), 9}
+    assert(#u == 2)
+    assert((two()) == 1)
+end
+
+returns()
+arguments()
+single()
+
+-- Destructuring at module scope, read from a function
+local x, y = two()
+local function sum() return x + y end
+assert(sum() == 3)
+print(two())
+print(va(4, 5, 6))
+print(x, y, cnt(two()))
@@ -0,0 +1,75 @@
+-- Loops over number arrays that run as vector kernels, and the cases
+-- where they fall back to the generated loop
+
+local sqrt = math.sqrt
+
+local function dot(x, y, n)
+  local s = 0
+  for i = 1, n do s = s + x[i] * y[i] end
+  return s
+end
+
+local function axpy(y, a, x, n)
+  for i = 1, n do y[i] = a * x[i] + y[i] end
+end
+
+local function gaps(d, x, n)
+  for i = 2, n do
+    local t = x[i] - x[i - 1]
+    d[i] = sqrt(t * t) + math.abs(-t) % 3 - t ^ 2
+  end
+end
+
+local n = 1000
+local u, v, d = {}, {}, {}
+for i = 1, n do
+  u[i] = i * 0.5
+  v[i] = 1 / i
+  d[i] = 0
+end
+
+axpy(v, 2, u, n)
+print(string.format("%.6f", dot(u, v, n)))
+gaps(d, v, n)
+local second, last = d[2], d[n]
+print(string.format("%.6f %.6f", second, last))
+
+-- x and y the same table, read behind the store
+local function prefix(t, n)
+  for i = 2, n do t[i] = t[i - 1] + t[i] end
+end
+local p = {}
+for i = 1, 10 do p[i] = i end
+prefix(p, 10)
+print(p[10], dot(p, p, 10))
+
+-- A table filled with floats one element at a time; after a string
+-- sneaks in, the generated loop runs (and errors on it)
+local w = {}
+for i = 1, 8 do w[#w + 1] = i / 2 end
+print(dot(w, w, 8))
+w[4] = "x"
+local ok1, err1 = pcall(dot, w, w, 8)
+print(ok1)
+w[4] = 2
+print(dot(w, w, 8))
+
+-- Ranges past the array's end read nil through __index
+local short = setmetatable({1, 2, 3}, {__index = function(t, k) return 10 end})
+print(dot(short, short, 5))
+
+-- Scalars from module state
+local scale = 3
+for i = 1, n do d[i] = scale * u[i] - v[i] end
+print(d[1], d[n])
+
+-- Accumulating into module state
+local total = 0
+for i = 1, n do total = total + u[i] end
+print(total)
+
+-- Empty ranges and a NaN
+print(dot(u, v, 0), dot(u, v, -5))
+local q = {0 / 0, 1}
+axpy(q, 1, q, 2)
+print(q[1] ~= q[1], q[2])
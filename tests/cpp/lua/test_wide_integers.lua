@@ -0,0 +1,40 @@
+-- Integers past 2^53 keep all 64 bits: bitwise results, wide literals
+-- and arithmetic on them are never rounded through a double
+
+local function shifted(n, by)
+    local h = n << by
+    return h
+end
+
+local function literals()
+    assert(tostring(9007199254740993) == "9007199254740993")
+    assert(9007199254740993 - 1 == 9007199254740992)
+    assert(tostring(-9007199254740993) == "-9007199254740993")
+end
+
+local function bitwise()
+    assert(tostring(1 << 62) == "4611686018427387904")
+    assert((1 << 62) + 1 == 4611686018427387905)
+    assert(tostring((1 << 62) + 1) == "4611686018427387905")
+    assert(tostring(1 << 63) == "-9223372036854775808")
+    assert((1 << 62) * 4 == 0)
+    assert(~0 == -1)
+    local x = 1 << 62
+    assert(tostring(x | 1) == "4611686018427387905")
+    assert(tostring(shifted(3, 40)) == "3298534883328")
+    assert(tostring(shifted(1, 60) ~ 1) == "1152921504606846977")
+end
+
+local function keys()
+    local t = {}
+    t[1 << 40] = "big"
+    assert(t[1099511627776] == "big")
+    t[(1 << 62) + 1] = "wide"
+    assert(t[4611686018427387905] == "wide")
+    assert(t[4611686018427387904] == nil)
+end
+
+literals()
+bitwise()
+keys()
+print(1 << 62, (1 << 62) + 1, 9007199254740993)
@@ -0,0 +1,9 @@
+/**
+ * l2c_runtime.cpp - The lua_table runtime library
+ *
+ * Compiles the out-of-line runtime functions (l2c_runtime_impl.hpp) once.
+ * Link it into builds whose generated modules define L2C_RUNTIME_LIB.
+ */
+
+#define L2C_RUNTIME_IMPL
+#include "l2c_runtime_lua_table.hpp"
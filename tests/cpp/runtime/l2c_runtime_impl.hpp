@@ -0,0 +1,682 @@
+#pragma once
+
+/**
+ * l2c_runtime_impl.hpp - Out-of-line runtime library functions
+ *
+ * Definitions of the L2C_RUNTIME_API functions declared in
+ * l2c_runtime_lua_table.hpp. Header-only builds get them inline through
+ * that header; with L2C_RUNTIME_LIB they are compiled once, in
+ * l2c_runtime.cpp. Include l2c_runtime_lua_table.hpp, not this file.
+ */
+
+#include "l2c_runtime_lua_table.hpp"
+
+namespace l2c {
+
+L2C_RUNTIME_API void print_single(const TValue& value) {
+    OutputStream& out = OutputStream::standard_output();
+    uint64_t tag = value.bits & TValue::TAG_MASK;
+    char buf[64];
+
+    if ((value.bits & TValue::NANBOX_BASE) != TValue::NANBOX_BASE) {
+        // It's a double (not NaN-boxed special)
+        out.number(value.toNumber());
+    } else {
+        switch (tag) {
+            case TValue::TAG_NIL:
+                out.write("nil", 3);
+                break;
+            case TValue::TAG_FALSE:
+                out.write("false", 5);
+                break;
+            case TValue::TAG_TRUE:
+                out.write("true", 4);
+                break;
+            case TValue::TAG_STRING:
+            case TValue::TAG_ISTRING:
+            case TValue::TAG_LSTRING:
+                out.write(static_cast<const char*>(value.toPtr()), str_len(value));
+                break;
+            case TValue::TAG_INT:
+            case TValue::TAG_BIGINT:
+                out.integer(value.toInt64());
+                break;
+            case TValue::TAG_TABLE:
+                out.write(buf, (size_t)std::snprintf(buf, sizeof(buf), "table: %p", (void*)value.toTable()));
+                break;
+            case TValue::TAG_LIGHTUD:
+                out.write(buf, (size_t)std::snprintf(buf, sizeof(buf), "userdata: %p", value.toPtr()));
+                break;
+            case TValue::TAG_FUNCTION:
+                out.write(buf, (size_t)std::snprintf(buf, sizeof(buf), "function: %p", value.toPtr()));
+                break;
+            case TValue::TAG_THREAD:
+                out.write(buf, (size_t)std::snprintf(buf, sizeof(buf), "thread: %p", value.toPtr()));
+                break;
+            default:
+                out.write("unknown", 7);
+                break;
+        }
+    }
+}
+
+L2C_RUNTIME_API TValue tonumber(const TValue& value) {
+    // If it's already a number, return as-is
+    if (value.isNumber()) {
+        return value;
+    }
+    // If it's an integer, convert to double (boxed integers stay exact)
+    if (value.isInteger()) {
+        return TValue::Number(static_cast<double>(value.toInteger()));
+    }
+    if (value.isBoxedInteger()) {
+        return value;
+    }
+    // If it's a string, try to parse as number (lua_number.hpp)
+    if (value.isString()) {
+        double d;
+        if (str_to_number(static_cast<const char*>(value.toPtr()), str_len(value), d)) {
+            return TValue::Number(d);
+        }
+    }
+    return NIL;
+}
+
+L2C_RUNTIME_API TValue number_string(double d) {
+    char buf[MAX_NUMBER_CHARS];
+    if (d >= 0 && d < SMALL_INT_STRINGS && d == static_cast<int>(d) && !std::signbit(d)) {
+        // Interned once per value and State: equal keys compare by pointer
+        static thread_local const char* cache[SMALL_INT_STRINGS];
+        const char*& s = cache[static_cast<int>(d)];
+        if (!s) s = StringPool::instance().intern(buf, integer_to_chars(buf, static_cast<int>(d)))->data;
+        return TValue::Interned(s);
+    }
+    return new_string(buf, number_to_chars(buf, d));
+}
+
+L2C_RUNTIME_API TValue tostring(const TValue& value) {
+    uint64_t tag = value.bits & TValue::TAG_MASK;
+    
+    char buf[64];
+    if ((value.bits & TValue::NANBOX_BASE) != TValue::NANBOX_BASE) {
+        // It's a double
+        return number_string(value.toNumber());
+    }
+    
+    if (value.isString()) {
+        return value;  // Already a string
+    }
+    
+    if (value.isInteger()) {
+        return number_string(static_cast<double>(value.toInteger()));
+    }
+
+    if (value.isBoxedInteger()) {
+        return new_string(buf, integer_to_chars(buf, value.toInt64()));
+    }
+    
+    switch (tag) {
+        case TValue::TAG_NIL:
+            return TValue::String("nil");
+        case TValue::TAG_FALSE:
+            return TValue::String("false");
+        case TValue::TAG_TRUE:
+            return TValue::String("true");
+        case TValue::TAG_TABLE: {
+            int n = std::snprintf(buf, sizeof(buf), "table: %p", (void*)value.toTable());
+            return new_string(buf, (size_t)n);
+        }
+        case TValue::TAG_THREAD: {
+            int n = std::snprintf(buf, sizeof(buf), "thread: %p", value.toPtr());
+            return new_string(buf, (size_t)n);
+        }
+        default:
+            return TValue::String("unknown");
+    }
+}
+
+L2C_RUNTIME_API bool is_int_format(const char* fmt) {
+    const char* p = fmt;
+    if (*p != '%') return false;
+    p++;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') p++;
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') { p++; while (*p >= '0' && *p <= '9') p++; }
+    if (*p == 'l' || *p == 'h' || *p == 'L') p++;
+    return (*p == 'd' || *p == 'i' || *p == 'x' || *p == 'X' || *p == 'o' || *p == 'u');
+}
+
+L2C_RUNTIME_API size_t find_spec_end(const char* fmt) {
+    size_t i = 0;
+    if (fmt[i] != '%') return 0;
+    i++; // skip '%'
+    
+    // Skip flags: -, +, space, #, 0
+    while (fmt[i] == '-' || fmt[i] == '+' || fmt[i] == ' ' || fmt[i] == '#' || fmt[i] == '0') {
+        i++;
+    }
+    
+    // Skip width (digits or *)
+    while (fmt[i] >= '0' && fmt[i] <= '9') {
+        i++;
+    }
+    
+    // Skip precision (.digits)
+    if (fmt[i] == '.') {
+        i++;
+        while (fmt[i] >= '0' && fmt[i] <= '9') {
+            i++;
+        }
+    }
+    
+    // Skip length modifier (l, ll, h, etc.)
+    if (fmt[i] == 'l' || fmt[i] == 'h' || fmt[i] == 'L' || fmt[i] == 'z' || fmt[i] == 'j') {
+        i++;
+        if (fmt[i] == 'l') i++; // 'll'
+    }
+    
+    // The conversion specifier letter
+    if (fmt[i] != '\0') {
+        i++;
+    }
+    
+    return i;
+}
+
+// Append arg formatted with one printf conversion spec, any length
+template<typename T>
+void append_printf(std::string& out, const char* spec, T arg) {
+    char buf[256];
+    int n = std::snprintf(buf, sizeof(buf), spec, arg);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(buf)) {
+        out.append(buf, (size_t)n);
+        return;
+    }
+    size_t old = out.size();
+    out.resize(old + (size_t)n + 1);
+    std::snprintf(&out[old], (size_t)n + 1, spec, arg);
+    out.resize(old + (size_t)n);
+}
+
+L2C_RUNTIME_API void append_format(std::string& out, const char* fmt, size_t len, const TValue& value) {
+    char spec[32];
+    if (len + 2 >= sizeof(spec)) len = sizeof(spec) - 3;
+    char conv = fmt[len - 1];
+    switch (conv) {
+        case 'd': case 'i': case 'x': case 'X': case 'o': case 'u': {
+            // Pass a long long: strip any length modifier, then add "ll"
+            size_t n = len - 1;
+            while (n > 1 && (fmt[n - 1] == 'l' || fmt[n - 1] == 'h' || fmt[n - 1] == 'L' ||
+                             fmt[n - 1] == 'z' || fmt[n - 1] == 'j')) n--;
+            std::memcpy(spec, fmt, n);
+            spec[n] = 'l'; spec[n + 1] = 'l'; spec[n + 2] = conv; spec[n + 3] = '\0';
+            long long i = value.isInt64() ? value.toInt64() : static_cast<long long>(value.asNumber());
+            append_printf(out, spec, i);
+            return;
+        }
+        case 'c':
+            out.push_back(static_cast<char>(static_cast<int>(value.asNumber())));
+            return;
+        case 's': case 'q': {
+            TValue text = value.isString() ? value : tostring(value);
+            const char* str = static_cast<const char*>(text.toPtr());
+            if (len == 2) {
+                out.append(str, str_len(text));
+                return;
+            }
+            std::memcpy(spec, fmt, len);
+            spec[len - 1] = 's';
+            spec[len] = '\0';
+            append_printf(out, spec, str);
+            return;
+        }
+        case 'f': case 'F': case 'g': case 'G': case 'e': case 'E': case 'a': case 'A':
+            std::memcpy(spec, fmt, len);
+            spec[len] = '\0';
+            append_printf(out, spec, value.asNumber());
+            return;
+        default:
+            out.append(fmt, len);
+            return;
+    }
+}
+
+L2C_RUNTIME_API void format_into(std::string& out, const char* fmt, const TValue* values, size_t n) {
+    size_t next = 0;
+    const char* p = fmt;
+    while (*p) {
+        const char* pct = std::strchr(p, '%');
+        if (!pct) {
+            out.append(p);
+            break;
+        }
+        out.append(p, (size_t)(pct - p));
+        if (pct[1] == '%') {
+            out.push_back('%');
+            p = pct + 2;
+            continue;
+        }
+        size_t spec_len = find_spec_end(pct);
+        if (next < n) append_format(out, pct, spec_len, values[next++]);
+        p = pct + spec_len;
+    }
+}
+
+L2C_RUNTIME_API TValue string_format_single(const char* fmt, const TValue& value) {
+    std::string out;
+    format_into(out, fmt, &value, 1);
+    return new_string(out.data(), out.size());
+}
+
+L2C_RUNTIME_API void FormatPiece::number(const FormatSegment& seg, double d) {
+    if (seg.fast && seg.kind == FormatSegment::INTEGER) {
+        integer(seg, static_cast<long long>(d));
+        return;
+    }
+    if (seg.fast && seg.kind == FormatSegment::FLOAT) {
+        std::chars_format style = seg.conv == 'f' || seg.conv == 'F' ? std::chars_format::fixed
+                                : seg.conv == 'e' || seg.conv == 'E' ? std::chars_format::scientific
+                                : std::chars_format::general;
+        // Like printf, a missing precision is 6 (to_chars would print the shortest form)
+        std::to_chars_result r = std::to_chars(num, num + sizeof(num), d, style,
+                                               seg.precision < 0 ? 6 : seg.precision);
+        if (r.ec == std::errc()) {
+            len = static_cast<size_t>(r.ptr - num);
+            if (seg.conv == 'F' || seg.conv == 'E' || seg.conv == 'G') {
+                for (size_t i = 0; i < len; i++) num[i] = static_cast<char>(std::toupper(num[i]));
+            }
+            return;
+        }
+    }
+    fallback(seg, TValue::Number(d));
+}
+
+L2C_RUNTIME_API void FormatPiece::integer(const FormatSegment& seg, int64_t i) {
+    if (seg.fast && seg.kind == FormatSegment::FLOAT) {
+        number(seg, static_cast<double>(i));
+        return;
+    }
+    if (!seg.fast || seg.kind != FormatSegment::INTEGER) {
+        fallback(seg, TValue::Int64(i));
+        return;
+    }
+    // printf's %u, %x and %o print the two's complement bits
+    unsigned long long u = static_cast<unsigned long long>(i);
+    std::to_chars_result r = seg.conv == 'd' || seg.conv == 'i' ? std::to_chars(num, num + sizeof(num), i)
+                           : seg.conv == 'u' ? std::to_chars(num, num + sizeof(num), u)
+                           : std::to_chars(num, num + sizeof(num), u, seg.conv == 'o' ? 8 : 16);
+    len = static_cast<size_t>(r.ptr - num);
+    if (seg.conv == 'X') {
+        for (size_t k = 0; k < len; k++) num[k] = static_cast<char>(std::toupper(num[k]));
+    }
+}
+
+L2C_RUNTIME_API void FormatPiece::fallback(const FormatSegment& seg, const TValue& v) {
+    append_format(wide, seg.spec.data(), seg.spec.size(), v);
+    s = wide.data();
+    len = wide.size();
+}
+
+NOINLINE L2C_RUNTIME_API const char* format_pieces(const FormatSegment* segs, size_t n,
+                                                   const FormatPiece* pieces, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) len += segs[i].text.size();
+    for (size_t i = 0; i < count; i++) len += pieces[i].len;
+    LuaString* str = alloc_string(len);
+    char* p = str->data;
+    for (size_t i = 0; i < n; i++) {
+        std::memcpy(p, segs[i].text.data(), segs[i].text.size());
+        p += segs[i].text.size();
+        if (i < count) {
+            std::memcpy(p, pieces[i].s, pieces[i].len);
+            p += pieces[i].len;
+        }
+    }
+    return str->data;
+}
+
+L2C_RUNTIME_API Values string_find(const char* s, size_t len, const Pattern& p, NUMBER init) {
+    size_t offset;
+    PatternMatch m;
+    if (!pattern_init(init, len, offset) || !p.find(s, len, offset, m)) return Values::of(NIL);
+    Values result = Values::of(TValue::Integer(static_cast<int32_t>(m.start - s) + 1),
+                               TValue::Integer(static_cast<int32_t>(m.end - s)));
+    for (int i = 0; i < p.captures(); i++) result.push(pattern_capture(m, i));
+    return result;
+}
+
+L2C_RUNTIME_API Values string_find_plain(const char* s, size_t len, std::string_view p, NUMBER init) {
+    size_t offset;
+    if (!pattern_init(init, len, offset)) return Values::of(NIL);
+    size_t pos = std::string_view(s, len).find(p, offset);
+    if (pos == std::string_view::npos) return Values::of(NIL);
+    return Values::of(TValue::Integer(static_cast<int32_t>(pos) + 1),
+                      TValue::Integer(static_cast<int32_t>(pos + p.size())));
+}
+
+L2C_RUNTIME_API Values string_find(const char* s, const char* pattern, NUMBER init) {
+    std::optional<Pattern> scratch;
+    return string_find(s, std::strlen(s), lookup_pattern(pattern, std::strlen(pattern), scratch), init);
+}
+
+L2C_RUNTIME_API Values string_match(const char* s, size_t len, const Pattern& p, NUMBER init) {
+    size_t offset;
+    PatternMatch m;
+    if (!pattern_init(init, len, offset) || !p.find(s, len, offset, m)) return Values::of(NIL);
+    Values result;
+    for (int i = 0; i < m.resultCount(); i++) result.push(pattern_capture(m, i));
+    return result;
+}
+
+L2C_RUNTIME_API void append_replacement(std::string& out, const PatternMatch& m, std::string_view repl) {
+    size_t i = 0;
+    while (i < repl.size()) {
+        const char* pct = static_cast<const char*>(std::memchr(repl.data() + i, '%', repl.size() - i));
+        if (!pct) {
+            out.append(repl.data() + i, repl.size() - i);
+            return;
+        }
+        size_t at = static_cast<size_t>(pct - repl.data());
+        out.append(repl.data() + i, at - i);
+        if (at + 1 >= repl.size()) pattern_error("invalid use of '%%' in replacement string");
+        char d = repl[at + 1];
+        if (d == '%') {
+            out.push_back('%');
+        } else if (d >= '0' && d <= '9') {
+            int l = d == '0' ? 0 : d - '1';
+            if (d == '0' || (m.level == 0 && l == 0)) {
+                out.append(m.start, static_cast<size_t>(m.end - m.start));
+            } else if (l >= m.level) {
+                pattern_error("invalid capture index %%%d in replacement string", l + 1);
+            } else if (m.isPosition(l)) {
+                out += std::to_string(m.position(l));
+            } else {
+                std::string_view cap = m.text(l);
+                out.append(cap.data(), cap.size());
+            }
+        } else {
+            pattern_error("invalid use of '%%' in replacement string");
+        }
+        i = at + 2;
+    }
+}
+
+L2C_RUNTIME_API void append_replacement_value(std::string& out, const PatternMatch& m, const TValue& value) {
+    if (value.isFalsy()) {
+        out.append(m.start, static_cast<size_t>(m.end - m.start));
+        return;
+    }
+    TValue holder;
+    std::string_view text;
+    if (!string_bytes(value, holder, text)) pattern_error("invalid replacement value");
+    out.append(text.data(), text.size());
+}
+
+L2C_RUNTIME_API MultiReturn2 string_gsub(const TValue& s, const Pattern& p, const TValue& repl, NUMBER max_n) {
+    if (repl.isTable()) {
+        return string_gsub(s, p, [&repl](std::string& out, const PatternMatch& m) {
+            append_replacement_value(out, m, gettable(repl.toTable(), pattern_capture(m, 0)));
+        }, max_n);
+    }
+    if (repl.isFunction()) {
+        return string_gsub(s, p, [&repl](std::string& out, const PatternMatch& m) {
+            TValue args[PatternMatch::MAX_CAPTURES];
+            int n = m.resultCount();
+            for (int i = 0; i < n; i++) args[i] = pattern_capture(m, i);
+            append_replacement_value(out, m, repl.callv(args, static_cast<uint32_t>(n)));
+        }, max_n);
+    }
+    TValue holder;
+    std::string_view text;
+    if (!string_bytes(repl, holder, text)) {
+        pattern_error("bad argument #3 to 'gsub' (string/function/table expected)");
+    }
+    if (!std::memchr(text.data(), '%', text.size())) {
+        return string_gsub(s, p, [text](std::string& out, const PatternMatch&) {
+            out.append(text.data(), text.size());
+        }, max_n);
+    }
+    return string_gsub(s, p, [text](std::string& out, const PatternMatch& m) {
+        append_replacement(out, m, text);
+    }, max_n);
+}
+
+L2C_RUNTIME_API TValue substring(const char* s, size_t len, NUMBER i, NUMBER j) {
+    long long n = static_cast<long long>(len);
+    long long start = static_cast<long long>(i);
+    long long end = static_cast<long long>(j);
+    if (start < 0) start = std::max(n + start + 1, 1LL);
+    else if (start == 0) start = 1;
+    if (end < 0) end = n + end + 1;
+    else if (end > n) end = n;
+    if (start > end) return EMPTY_STRING;
+    return new_string(s + start - 1, static_cast<size_t>(end - start + 1));
+}
+
+NOINLINE L2C_RUNTIME_API const char* concat_pieces(const ConcatPiece* pieces, size_t n) {
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) len += pieces[i].len;
+    LuaString* str = alloc_string(len);
+    char* p = str->data;
+    for (size_t i = 0; i < n; i++) {
+        std::memcpy(p, pieces[i].s, pieces[i].len);
+        p += pieces[i].len;
+    }
+    return str->data;
+}
+
+L2C_RUNTIME_API void table_insert(const TValue& t, const TValue& value) {
+    if (!t.isTable()) return;
+    LuaTable* tbl = t.toTable();
+    uint32_t len = tbl->length();
+    tbl->insertAt(len + 1, len, value);
+}
+
+L2C_RUNTIME_API void table_insert(const TValue& t, NUMBER pos, const TValue& value) {
+    if (!t.isTable()) return;
+    LuaTable* tbl = t.toTable();
+    uint32_t len = tbl->length();
+    long long idx = static_cast<long long>(pos);
+    if (idx < 1) idx = 1;
+    if (idx > static_cast<long long>(len) + 1) idx = static_cast<long long>(len) + 1;
+    tbl->insertAt(static_cast<uint32_t>(idx), len, value);
+}
+
+L2C_RUNTIME_API void table_sort(const TValue& t) {
+    if (!t.isTable()) return;
+    LuaTable* tbl = t.toTable();
+    uint32_t len = tbl->length();
+    if (len <= 1) return;
+    if (len <= tbl->arraySize) {
+        bool floats = true, ints = true, strings = true;
+        for (uint32_t i = 0; i < len && (floats || ints || strings); i++) {
+            const TValue& v = tbl->array[i];
+            floats &= v.isNumber();
+            ints &= v.isInteger();
+            strings &= v.isString();
+        }
+        if (floats) {
+            sort_detail::sort_sequence(tbl, len, [](const TValue& a, const TValue& b) {
+                return a.toNumber() < b.toNumber();
+            });
+            return;
+        }
+        if (ints) {
+            sort_detail::sort_sequence(tbl, len, [](const TValue& a, const TValue& b) {
+                return a.toInteger() < b.toInteger();
+            });
+            return;
+        }
+        if (strings) {
+            sort_detail::sort_sequence(tbl, len, [](const TValue& a, const TValue& b) {
+                return sort_detail::string_view_of(a) < sort_detail::string_view_of(b);
+            });
+            return;
+        }
+    }
+    sort_detail::sort_sequence(tbl, len, [](const TValue& a, const TValue& b) {
+        return less_than(a, b);
+    });
+}
+
+L2C_RUNTIME_API TValue table_concat(const TValue& t, const TValue& sep, NUMBER first, NUMBER last) {
+    if (!t.isTable()) return EMPTY_STRING;
+    LuaTable* tbl = t.toTable();
+    int len = static_cast<int>(tbl->length());
+    int start = static_cast<int>(first);
+    int end = (last < 0) ? len : std::min(static_cast<int>(last), len);
+    const ConcatPiece separator(sep.isString() ? sep : EMPTY_STRING);
+
+    // Measure, then copy into one string (numbers are formatted twice)
+    size_t total = 0;
+    bool first_elem = true;
+    tbl->forRange(start, end, [&](const TValue& val) {
+        if (!val.isString() && !val.isNumber() && !val.isInt64()) return;
+        if (!first_elem) total += separator.len;
+        first_elem = false;
+        total += ConcatPiece(val).len;
+    });
+    LuaString* str = alloc_string(total);
+    char* p = str->data;
+    first_elem = true;
+    tbl->forRange(start, end, [&](const TValue& val) {
+        if (!val.isString() && !val.isNumber() && !val.isInt64()) return;
+        if (!first_elem) { std::memcpy(p, separator.s, separator.len); p += separator.len; }
+        first_elem = false;
+        const ConcatPiece piece(val);
+        std::memcpy(p, piece.s, piece.len);
+        p += piece.len;
+    });
+    return TValue::LString(str->data);
+}
+
+L2C_RUNTIME_API TValue table_remove(const TValue& t) {
+    if (!t.isTable()) return NIL;
+    LuaTable* tbl = t.toTable();
+    uint32_t len = tbl->length();
+    if (len == 0) return NIL;
+    return tbl->removeAt(len, len);
+}
+
+L2C_RUNTIME_API TValue table_remove(const TValue& t, NUMBER pos) {
+    if (!t.isTable()) return NIL;
+    LuaTable* tbl = t.toTable();
+    uint32_t len = tbl->length();
+    long long idx = static_cast<long long>(pos);
+    if (idx == static_cast<long long>(len) + 1 || (len == 0 && idx == 0)) {
+        // Lua allows removing the (nil or stray) element just past the border
+        TValue removed = tbl->get(static_cast<int32_t>(idx));
+        if (idx != 0) tbl->set(static_cast<int32_t>(idx), NIL);
+        return removed;
+    }
+    if (idx < 1 || idx > static_cast<long long>(len)) return NIL;
+    return tbl->removeAt(static_cast<uint32_t>(idx), len);
+}
+
+L2C_RUNTIME_API TValue table_move(const TValue& a1, NUMBER f, NUMBER e, NUMBER t, const TValue& a2) {
+    if (!a1.isTable() || !a2.isTable()) return a2;
+    long long first = static_cast<long long>(f);
+    long long last = static_cast<long long>(e);
+    long long to = static_cast<long long>(t);
+    if (last < first) return a2;
+    if (first < 1 || to < 1 || last - first >= INT32_MAX - to) {
+        // Outside the 1-based int32 keys the array part can hold
+        LuaTable* src = a1.toTable();
+        LuaTable* dst = a2.toTable();
+        bool backward = src == dst && to > first && to <= last;
+        for (long long i = 0; i <= last - first; i++) {
+            long long k = backward ? last - first - i : i;
+            dst->set(static_cast<int32_t>(to + k), src->get(static_cast<int32_t>(first + k)));
+        }
+        return a2;
+    }
+    a2.toTable()->moveRange(a1.toTable(), static_cast<uint32_t>(first), static_cast<uint32_t>(last),
+                            static_cast<uint32_t>(to));
+    return a2;
+}
+
+L2C_RUNTIME_API Values table_unpack(const TValue& t, NUMBER first, NUMBER last) {
+    Values result;
+    if (!t.isTable()) return result;
+    LuaTable* tbl = t.toTable();
+    int len = static_cast<int>(tbl->length());
+    int start = static_cast<int>(first);
+    int end = (last < 0) ? len : static_cast<int>(last);
+    if (end > len) end = len;
+    if (start > end) return result;
+    std::span<const TValue> part = tbl->span(start, end);
+    result.append(part.data(), static_cast<uint32_t>(part.size()));
+    for (int i = start + static_cast<int>(part.size()); i <= end; i++) {
+        result.push(tbl->get(i));
+    }
+    return result;
+}
+
+L2C_RUNTIME_API TValue io_read(const char* format) {
+    InputStream& in = InputStream::standard_input();
+    if (*format == '*') format++;
+    std::string_view view;
+    switch (*format) {
+    case 'a':
+        return in.all();
+    case 'l':
+    case 'L':
+        if (!in.line(view, *format == 'L')) return NIL;
+        return new_string(view.data(), view.size());
+    case 'n': {
+        char buf[201];  // LUAL_MAXNUMERAL + 1
+        double d;
+        if (!in.numeral(buf, sizeof(buf)) || !str_to_number(buf, std::strlen(buf), d)) return NIL;
+        return TValue::Number(d);
+    }
+    default:
+        OutputStream::standard_output().flush();
+        fprintf(stderr, "bad argument #1 to 'read' (invalid format)\n");
+        std::abort();
+    }
+}
+
+L2C_RUNTIME_API TValue io_read(NUMBER count) {
+    std::string_view view;
+    size_t n = count > 0 ? static_cast<size_t>(count) : 0;
+    if (!InputStream::standard_input().bytes(n, view)) return NIL;
+    return new_string(view.data(), view.size());
+}
+
+L2C_RUNTIME_API TValue io_read(const TValue& format) {
+    if (format.isNumber()) return io_read(format.asNumber());
+    if (format.isNil()) return io_read("l");
+    return io_read(static_cast<const char*>(format.toPtr()));
+}
+
+L2C_RUNTIME_API double collectgarbage(const char* option, double arg) {
+    LuaGC& gc = LuaGC::instance();
+    if (!option || strcmp(option, "collect") == 0) {
+        gc.fullCollect();
+        return 0.0;
+    }
+    if (strcmp(option, "count") == 0) {
+        return static_cast<double>(gc.bytes()) / 1024.0;  // KB, like Lua
+    }
+    if (strcmp(option, "step") == 0) {
+        // arg > 0: keep stepping until about arg KB have been processed
+        bool finished = gc.step();
+        for (double done = 64.0; !finished && done < arg; done += 64.0)
+            finished = gc.step();
+        return finished ? 1.0 : 0.0;
+    }
+    if (strcmp(option, "stop") == 0)       { gc.stop(); return 0.0; }
+    if (strcmp(option, "restart") == 0)    { gc.restart(); return 0.0; }
+    if (strcmp(option, "isrunning") == 0)  { return gc.isRunning() ? 1.0 : 0.0; }
+    if (strcmp(option, "setpause") == 0)   { return gc.setPause(static_cast<int>(arg)); }
+    if (strcmp(option, "setstepmul") == 0) { return gc.setStepMul(static_cast<int>(arg)); }
+#ifdef L2C_STATS
+    // Runtime counters (-DL2C_STATS builds only)
+    if (strcmp(option, "stats") == 0)      { dump_stats(); return 0.0; }
+    if (strcmp(option, "resetstats") == 0) { reset_stats(); return 0.0; }
+#endif
+    return 0.0;  // "incremental"/"generational": always incremental
+}
+
+} // namespace l2c
@@ -6,14 +6,31 @@
  * This runtime uses the high-performance NaN-boxed TValue and Swiss Table
  * implementation from lua_table.hpp instead of the heavyweight TABLE struct.
  * API is compatible with transpiler output.
+ *
+ * The hot core (TValue, LuaTable, the GC, concat, the generic library
+ * templates) is header-only. The heavier non-template library functions
+ * are only declared here, as L2C_RUNTIME_API, and defined in
+ * l2c_runtime_impl.hpp: by default that is included below and they stay
+ * inline, so a generated module still builds as one TU. Large modules
+ * define L2C_RUNTIME_LIB and link l2c_runtime.cpp instead, compiling
+ * those functions once rather than in every TU.
  */
 
 #include "lua_table.hpp"
+#include "lua_pattern.hpp"
+#include "lua_profile.hpp"
+#include "lua_io.hpp"
+#include "lua_coroutine.hpp"
+#include "lua_parallel.hpp"
+#include "lua_vector.hpp"
+#include "lua_snapshot.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <limits>
 #include <cstring>
 #include <cstdio>
 #include <functional>
@@ -25,6 +42,12 @@
 #undef assert
 #endif
 
+#if defined(L2C_RUNTIME_LIB) || defined(L2C_RUNTIME_IMPL)
+#  define L2C_RUNTIME_API
+#else
+#  define L2C_RUNTIME_API inline
+#endif
+
 // ============================================================
 // Type aliases for transpiler compatibility
 // ============================================================
@@ -36,7 +59,8 @@ using BOOLEAN = bool;
 // ============================================================
 // Macros for table initialization
 // ============================================================
-#define NEW_TABLE TValue::Table(LuaTable::create(8, 4))
+#define NEW_TABLE TValue::Table(LuaTable::create(LuaTable::SMALL_ARRAY, LuaTable::SMALL_HASH))
+#define NEW_NUMBER_TABLE TValue::Table(LuaTable::create(LuaTable::SMALL_ARRAY, 0, ARRAY_NUMBER))
 #define NIL TValue::Nil()
 
 // ============================================================
@@ -69,60 +93,47 @@ inline bool is_truthy(const char* s) { return s != nullptr && s[0] != '\0'; }
 inline bool is_truthy(const TableSlotProxy& p) { return is_truthy(static_cast<TValue>(p)); }
 
 // ---------- Print helpers ----------
-inline void print_single(const TValue& value) {
-    uint64_t tag = value.bits & TValue::TAG_MASK;
-    
-    if ((value.bits & TValue::NANBOX_BASE) != TValue::NANBOX_BASE) {
-        // It's a double (not NaN-boxed special)
-        std::cout << value.toNumber();
-    } else {
-        switch (tag) {
-            case TValue::TAG_NIL:
-                std::cout << "nil";
-                break;
-            case TValue::TAG_FALSE:
-                std::cout << "false";
-                break;
-            case TValue::TAG_TRUE:
-                std::cout << "true";
-                break;
-            case TValue::TAG_STRING:
-                std::cout << static_cast<const char*>(value.toPtr());
-                break;
-            case TValue::TAG_INT:
-                std::cout << value.toInteger();
-                break;
-            case TValue::TAG_TABLE:
-                std::cout << "table: " << value.toTable();
-                break;
-            case TValue::TAG_LIGHTUD:
-                std::cout << "userdata: " << value.toPtr();
-                break;
-            case TValue::TAG_FUNCTION:
-                std::cout << "function: " << value.toPtr();
-                break;
-            default:
-                std::cout << "unknown";
-                break;
-        }
-    }
-}
+// Output goes to the buffered OutputStream of lua_io.hpp
+L2C_RUNTIME_API void print_single(const TValue& value);
 
 inline void io_write_single(const TValue& value) {
-    print_single(value);
+    if (value.isString()) {
+        // Binary safe: the length comes from the string, not a NUL
+        OutputStream::standard_output().write(static_cast<const char*>(value.toPtr()), str_len(value));
+    } else {
+        print_single(value);
+    }
 }
 
 // ---------- Variadic print with tab separators ----------
 template<typename... Args>
 void print(Args&&... args) {
+    OutputStream& out = OutputStream::standard_output();
     bool first = true;
     auto print_with_sep = [&](auto&& a) {
-        if (!first) std::cout << '\t';
-        first = false;
-        print_single(a);
+        if constexpr (std::is_same_v<std::decay_t<decltype(a)>, Spread>) {
+            for (uint32_t i = 1; i <= a.values.size(); i++) {
+                if (!first) out.put('\t');
+                first = false;
+                print_single(a.values[i]);
+            }
+        } else {
+            if (!first) out.put('\t');
+            first = false;
+            if constexpr (std::is_same_v<std::decay_t<decltype(a)>, bool>) {
+                // A bool would otherwise convert to a number TValue
+                out.write(a ? "true" : "false", a ? 4 : 5);
+            } else {
+                print_single(a);
+            }
+        }
     };
     (print_with_sep(std::forward<Args>(args)), ...);
-    std::cout << std::endl;
+    out.put('\n');
+}
+
+inline void io_write_single(const Spread& spread) {
+    for (uint32_t i = 1; i <= spread.values.size(); i++) io_write_single(spread.values[i]);
 }
 
 template<typename... Args>
@@ -131,74 +142,32 @@ void io_write(Args&&... args) {
     (io_write_single(std::forward<Args>(args)), ...);
 }
 
-// ---------- Type conversion ----------
-inline TValue tonumber(const TValue& value) {
-    // If it's already a number, return as-is
-    if (value.isNumber()) {
-        return value;
-    }
-    // If it's an integer, convert to double
-    if (value.isInteger()) {
-        return TValue::Number(static_cast<double>(value.toInteger()));
-    }
-    // If it's a string, try to parse as number
-    if (value.isString()) {
-        const char* s = static_cast<const char*>(value.toPtr());
-        char* end;
-        double d = std::strtod(s, &end);
-        if (end != s && *end == '\0') {
-            return TValue::Number(d);
-        }
-    }
-    return NIL;
+// io.flush(): write out buffered output
+inline bool io_flush() {
+    return OutputStream::standard_output().flush();
 }
 
-inline TValue tostring(const TValue& value) {
-    uint64_t tag = value.bits & TValue::TAG_MASK;
-    
-    if ((value.bits & TValue::NANBOX_BASE) != TValue::NANBOX_BASE) {
-        // It's a double
-        static char buf[64];
-        std::snprintf(buf, sizeof(buf), "%g", value.toNumber());
-        return TValue::String(buf);
-    }
-    
-    if (value.isString()) {
-        return value;  // Already a string
-    }
-    
-    if (value.isInteger()) {
-        static char buf[32];
-        std::snprintf(buf, sizeof(buf), "%d", value.toInteger());
-        return TValue::String(buf);
-    }
-    
-    switch (tag) {
-        case TValue::TAG_NIL:
-            return TValue::String("nil");
-        case TValue::TAG_FALSE:
-            return TValue::String("false");
-        case TValue::TAG_TRUE:
-            return TValue::String("true");
-        case TValue::TAG_TABLE: {
-            static char buf[64];
-            std::snprintf(buf, sizeof(buf), "table: %p", value.toTable());
-            return TValue::String(buf);
-        }
-        default:
-            return TValue::String("unknown");
-    }
-}
+// ---------- Type conversion ----------
+L2C_RUNTIME_API TValue tonumber(const TValue& value);
+
+L2C_RUNTIME_API TValue tostring(const TValue& value);
+
+// Integral numbers below this have one interned string each
+constexpr int SMALL_INT_STRINGS = 1024;
+
+// d as tostring() formats it ("%.14g")
+L2C_RUNTIME_API TValue number_string(double d);
 
 // ---------- Length ----------
 inline NUMBER get_length(const TValue& t) {
     if (t.isTable()) {
+        if (UNLIKELY(t.toTable()->metatable != nullptr)) {
+            if (const TValue* mm = get_tm(t, TM_LEN))
+                return mm->call(t, TValue::Nil()).asNumber();
+        }
         return static_cast<NUMBER>(t.toTable()->length());
     }
-    if (t.isString()) {
-        const char* s = static_cast<const char*>(t.toPtr());
-        return static_cast<NUMBER>(std::strlen(s));
-    }
+    if (t.isString()) return static_cast<NUMBER>(str_len(t));
     return 0;
 }
 
@@ -206,6 +175,24 @@ inline NUMBER get_length(const char* s) {
     return static_cast<NUMBER>(std::strlen(s));
 }
 
+// ---------- Numeric for ----------
+// Limit of an integer loop (integral start and step, Lua 5.4 forlimit):
+// float limits are floored (step > 0) or ceiled (step < 0). The result is
+// clamped to +-2^62 so `i += step` cannot overflow for any literal step.
+inline int64_t for_limit(double f, int64_t step) {
+    constexpr int64_t MAX_LIMIT = int64_t(1) << 62;
+    if (f != f) return step > 0 ? -MAX_LIMIT : MAX_LIMIT;  // NaN: no iterations
+    f = step > 0 ? std::floor(f) : std::ceil(f);
+    if (f >= (double)MAX_LIMIT) return MAX_LIMIT;
+    if (f <= -(double)MAX_LIMIT) return -MAX_LIMIT;
+    return (int64_t)f;
+}
+
+inline int64_t for_limit(const TValue& limit, int64_t step) {
+    if (limit.isInteger()) return limit.toInteger();
+    return for_limit(limit.asNumber(), step);
+}
+
 // ---------- Math functions ----------
 inline NUMBER math_sqrt(const TValue& value) {
     if (value.isNumber()) return std::sqrt(value.toNumber());
@@ -217,15 +204,53 @@ inline NUMBER math_sqrt(NUMBER x) { return std::sqrt(x); }
 inline NUMBER math_floor(NUMBER x) { return std::floor(x); }
 inline NUMBER math_ceil(NUMBER x) { return std::ceil(x); }
 inline NUMBER math_abs(NUMBER x) { return std::fabs(x); }
+inline NUMBER math_sin(NUMBER x) { return std::sin(x); }
+inline NUMBER math_cos(NUMBER x) { return std::cos(x); }
+inline NUMBER math_tan(NUMBER x) { return std::tan(x); }
+inline NUMBER math_asin(NUMBER x) { return std::asin(x); }
+inline NUMBER math_acos(NUMBER x) { return std::acos(x); }
+inline NUMBER math_atan(NUMBER y, NUMBER x = 1.0) { return std::atan2(y, x); }
+inline NUMBER math_exp(NUMBER x) { return std::exp(x); }
+inline NUMBER math_pow(NUMBER x, NUMBER y) { return std::pow(x, y); }
+inline NUMBER math_fmod(NUMBER a, NUMBER b) { return std::fmod(a, b); }
+inline NUMBER math_deg(NUMBER x) { return x * (180.0 / 3.14159265358979323846); }
+inline NUMBER math_rad(NUMBER x) { return x * (3.14159265358979323846 / 180.0); }
 
-inline NUMBER math_random(NUMBER min = 0.0, NUMBER max = 1.0) {
-    static bool seeded = false;
-    if (!seeded) {
-        std::srand(static_cast<unsigned>(std::time(nullptr)));
-        seeded = true;
+inline NUMBER math_log(NUMBER x) { return std::log(x); }
+inline NUMBER math_log(NUMBER x, NUMBER base) {
+    if (base == 2.0) return std::log2(x);
+    if (base == 10.0) return std::log10(x);
+    return std::log(x) / std::log(base);
+}
+
+// The math library's constants, as values of the runtime's number types.
+// The integer limits are boxed integers (see TValue::Int64) whose box is
+// static storage, which the collector leaves alone as it does a literal
+// string's.
+constexpr NUMBER math_pi = 3.14159265358979323846;
+constexpr NUMBER math_huge = std::numeric_limits<NUMBER>::infinity();
+inline constexpr int64_t math_integer_limits[2] = {INT64_MAX, INT64_MIN};
+inline const TValue math_maxinteger{
+    TValue::TAG_BIGINT | (reinterpret_cast<uint64_t>(&math_integer_limits[0]) & TValue::POINTER_MASK)};
+inline const TValue math_mininteger{
+    TValue::TAG_BIGINT | (reinterpret_cast<uint64_t>(&math_integer_limits[1]) & TValue::POINTER_MASK)};
+
+// Uniform in [0, 1): xorshift64* over the State's generator, which is
+// seeded from the clock and the State on first use
+inline NUMBER random_unit() {
+    uint64_t& x = l2c::State::current().random;
+    if (UNLIKELY(x == 0)) {
+        x = (static_cast<uint64_t>(std::time(nullptr)) * 0x9e3779b97f4a7c15ULL)
+            ^ reinterpret_cast<uintptr_t>(&x) ^ 1;
     }
-    NUMBER scale = static_cast<NUMBER>(std::rand()) / RAND_MAX;
-    return min + scale * (max - min);
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return static_cast<NUMBER>((x * 0x2545f4914f6cdd1dULL) >> 11) * 0x1.0p-53;
+}
+
+inline NUMBER math_random(NUMBER min = 0.0, NUMBER max = 1.0) {
+    return min + random_unit() * (max - min);
 }
 
 // ---------- Lua modulo (with correct sign) ----------
@@ -236,303 +261,645 @@ inline NUMBER mod(NUMBER a, NUMBER b) {
     return r;
 }
 
-// ---------- String functions ----------
-inline bool is_int_format(const char* fmt) {
-    const char* p = fmt;
-    if (*p != '%') return false;
-    p++;
-    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') p++;
-    while (*p >= '0' && *p <= '9') p++;
-    if (*p == '.') { p++; while (*p >= '0' && *p <= '9') p++; }
-    if (*p == 'l' || *p == 'h' || *p == 'L') p++;
-    return (*p == 'd' || *p == 'i' || *p == 'x' || *p == 'X' || *p == 'o' || *p == 'u');
-}
-
-inline TValue string_format_single(const char* fmt, const TValue& value) {
-    static char buf[1024];
-    if (value.isNumber()) {
-        double num = value.toNumber();
-        if (is_int_format(fmt)) {
-            std::snprintf(buf, sizeof(buf), fmt, static_cast<long long>(num));
-        } else {
-            std::snprintf(buf, sizeof(buf), fmt, num);
-        }
-    } else if (value.isInteger()) {
-        std::snprintf(buf, sizeof(buf), fmt, value.toInteger());
-    } else if (value.isString()) {
-        std::snprintf(buf, sizeof(buf), fmt, static_cast<const char*>(value.toPtr()));
-    } else {
-        std::snprintf(buf, sizeof(buf), fmt, "?");
+// ---------- Integer arithmetic (Lua 5.4) ----------
+// Proven integers are int64_t in generated code and use the int_*
+// functions and C++ operators directly. floor_div's NUMBER overload
+// follows the runtime's numbers-are-doubles convention; its TValue one
+// keeps integer operands integers (boxed past 32 bits, see
+// TValue::Int64). The bitwise operators always give an integer, so they
+// take either and return a TValue: a double holds an int64_t exactly
+// only up to 2^53.
+[[noreturn]] NOINLINE inline void arith_error(const char* msg) {
+    OutputStream::standard_output().flush();
+    std::fprintf(stderr, "error: %s\n", msg);
+    std::abort();
+}
+
+// Floor division and modulo; b == -1 is special-cased as INT64_MIN / -1
+// overflows in C++ (Lua wraps it)
+inline int64_t int_idiv(int64_t a, int64_t b) {
+    if (UNLIKELY((uint64_t)b + 1 <= 1)) {
+        if (b == 0) arith_error("attempt to perform 'n//0'");
+        return int_sub(0, a);
     }
-    return TValue::String(buf);
+    int64_t q = a / b;
+    if ((a % b != 0) && ((a ^ b) < 0)) q -= 1;
+    return q;
 }
 
-inline TValue string_format(const char* fmt) {
-    return TValue::String(fmt);
+inline int64_t int_mod(int64_t a, int64_t b) {
+    if (UNLIKELY((uint64_t)b + 1 <= 1)) {
+        if (b == 0) arith_error("attempt to perform 'n%%0'");
+        return 0;
+    }
+    int64_t r = a % b;
+    if (r != 0 && (r ^ b) < 0) r += b;
+    return r;
+}
+
+// Logical shifts; shifting by 64 or more (either way) gives 0
+inline int64_t shift_left(int64_t x, int64_t n) {
+    if (n <= -64 || n >= 64) return 0;
+    if (n >= 0) return (int64_t)((uint64_t)x << n);
+    return (int64_t)((uint64_t)x >> -n);
 }
 
+inline int64_t shift_right(int64_t x, int64_t n) {
+    return shift_left(x, int_sub(0, n));
+}
+
+// The integer operand of a bitwise operation: floats and numeric
+// strings must have an exact integer value
+inline int64_t to_int64(double d) {
+    int64_t i;
+    if (LIKELY(float_to_integer(d, i))) return i;
+    arith_error("number has no integer representation");
+}
+
+inline int64_t to_int64(const TValue& v) {
+    if (LIKELY(v.isInt64())) return v.toInt64();
+    if (v.isNumber()) return to_int64(v.toNumber());
+    double d;
+    if (v.isString() && str_to_number(static_cast<const char*>(v.toPtr()), str_len(v), d)) return to_int64(d);
+    arith_error("attempt to perform bitwise operation on a non-number value");
+}
+
+inline NUMBER floor_div(NUMBER a, NUMBER b) { return std::floor(a / b); }
+
+template<typename A, typename B>
+inline constexpr bool boxed_operands_v = !(std::is_arithmetic_v<A> && std::is_arithmetic_v<B>);
+
+template<typename A, typename B, typename = std::enable_if_t<boxed_operands_v<A, B>>>
+TValue floor_div(const A& a, const B& b) {
+    TValue x = as_value(a), y = as_value(b);
+    if (x.isInt64() && y.isInt64()) return TValue::Int64(int_idiv(x.toInt64(), y.toInt64()));
+    int64_t i, j;
+    if (UNLIKELY(x.isBoxedInteger() || y.isBoxedInteger()) && wide_operands(x, y, i, j))
+        return TValue::Int64(int_idiv(i, j));
+    return TValue::Number(std::floor(x.asNumber() / y.asNumber()));
+}
+
+template<typename A, typename B>
+TValue band(const A& a, const B& b) { return TValue::Int64(to_int64(as_value(a)) & to_int64(as_value(b))); }
+template<typename A, typename B>
+TValue bor(const A& a, const B& b)  { return TValue::Int64(to_int64(as_value(a)) | to_int64(as_value(b))); }
+template<typename A, typename B>
+TValue bxor(const A& a, const B& b) { return TValue::Int64(to_int64(as_value(a)) ^ to_int64(as_value(b))); }
+template<typename A, typename B>
+TValue shl(const A& a, const B& b) {
+    return TValue::Int64(shift_left(to_int64(as_value(a)), to_int64(as_value(b))));
+}
+template<typename A, typename B>
+TValue shr(const A& a, const B& b) {
+    return TValue::Int64(shift_right(to_int64(as_value(a)), to_int64(as_value(b))));
+}
+template<typename A>
+TValue bnot(const A& a) { return TValue::Int64(~to_int64(as_value(a))); }
+
+// ---------- String functions ----------
+L2C_RUNTIME_API bool is_int_format(const char* fmt);
+
 // Find the end of a format specifier (e.g., "%d", "%.2f", "%5s")
 // Returns the position right after the specifier letter
-inline size_t find_spec_end(const char* fmt) {
-    size_t i = 0;
-    if (fmt[i] != '%') return 0;
-    i++; // skip '%'
-    
-    // Skip flags: -, +, space, #, 0
-    while (fmt[i] == '-' || fmt[i] == '+' || fmt[i] == ' ' || fmt[i] == '#' || fmt[i] == '0') {
-        i++;
-    }
-    
-    // Skip width (digits or *)
-    while (fmt[i] >= '0' && fmt[i] <= '9') {
-        i++;
-    }
-    
-    // Skip precision (.digits)
-    if (fmt[i] == '.') {
-        i++;
-        while (fmt[i] >= '0' && fmt[i] <= '9') {
-            i++;
+L2C_RUNTIME_API size_t find_spec_end(const char* fmt);
+
+// Append value formatted with the spec of length len starting at fmt
+// (Lua string.format semantics for one conversion)
+L2C_RUNTIME_API void append_format(std::string& out, const char* fmt, size_t len, const TValue& value);
+
+// Format values[0..n) into out following fmt
+L2C_RUNTIME_API void format_into(std::string& out, const char* fmt, const TValue* values, size_t n);
+
+L2C_RUNTIME_API TValue string_format_single(const char* fmt, const TValue& value);
+
+inline TValue string_format(const char* fmt) {
+    return TValue::String(fmt);
+}
+
+template<typename T, typename... Args>
+TValue string_format(const char* fmt, T&& first, Args&&... args) {
+    const TValue values[] = {
+        detail::to_tvalue(std::forward<T>(first)), detail::to_tvalue(std::forward<Args>(args))...
+    };
+    std::string out;
+    format_into(out, fmt, values, 1 + sizeof...(Args));
+    return new_string(out.data(), out.size());
+}
+
+// ---------- Compiled format strings ----------
+// A string.format whose format is a literal is split by the transpiler
+// into segments, each the text before one conversion and the conversion,
+// declared once at module scope:
+//   static constexpr l2c::FormatSegment _l2c_fmt_0[] = {{"n=", "%d"}, {" (", "%.2f"}, {")"}};
+// l2c::format(_l2c_fmt_0, args...) formats every argument by its C++
+// type into a FormatPiece (std::to_chars for conversions without flags
+// or width, append_format's snprintf otherwise) and copies text and
+// pieces once into a new collector-owned string. Returns const char*
+// like string_lib::format. Formats built at run time keep format_into.
+struct FormatSegment {
+    enum Kind : uint8_t { OTHER, INTEGER, FLOAT, STRING };
+
+    std::string_view text;   // literal text before the conversion ("%%" already as "%")
+    std::string_view spec;   // "%5.2f"; empty for the text after the last conversion
+    char conv = 0;
+    Kind kind = OTHER;
+    bool fast = false;       // no flags, width or length modifier (and no precision for integers)
+    int  precision = -1;
+
+    constexpr FormatSegment(std::string_view t, std::string_view s = {}) : text(t), spec(s) {
+        if (s.size() < 2) return;
+        conv = s.back();
+        switch (conv) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': kind = INTEGER; break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': kind = FLOAT; break;
+            case 's': kind = STRING; break;
+            default: return;
+        }
+        size_t i = 1;
+        if (s[i] == '.') {
+            precision = 0;
+            for (i++; s[i] >= '0' && s[i] <= '9'; i++) precision = precision * 10 + (s[i] - '0');
         }
+        fast = i == s.size() - 1 && (kind != INTEGER || precision < 0);
     }
-    
-    // Skip length modifier (l, ll, h, etc.)
-    if (fmt[i] == 'l' || fmt[i] == 'h' || fmt[i] == 'L' || fmt[i] == 'z' || fmt[i] == 'j') {
-        i++;
-        if (fmt[i] == 'l') i++; // 'll'
+};
+
+// Longest conversion formatted into FormatPiece::num; longer ones (%.99f)
+// take the snprintf path
+constexpr size_t MAX_FORMAT_CHARS = 64;
+
+struct FormatPiece {
+    const char* s = num;
+    size_t      len = 0;
+    char        num[MAX_FORMAT_CHARS];
+    std::string wide;   // append_format output for the other conversions
+
+    FormatPiece(const FormatSegment& seg, double d) { number(seg, d); }
+    FormatPiece(const FormatSegment& seg, int64_t i) { integer(seg, i); }
+    FormatPiece(const FormatSegment& seg, int32_t i) { integer(seg, i); }
+    FormatPiece(const FormatSegment& seg, const char* str) {
+        if (seg.fast && seg.kind == FormatSegment::STRING) string(seg, str, std::strlen(str));
+        else fallback(seg, TValue::String(str));
     }
-    
-    // The conversion specifier letter
-    if (fmt[i] != '\0') {
-        i++;
+    FormatPiece(const FormatSegment& seg, const TValue& v) {
+        if (v.isNumber()) number(seg, v.toNumber());
+        else if (v.isInt64()) integer(seg, v.toInt64());
+        else if (v.isString() && seg.fast && seg.kind == FormatSegment::STRING)
+            string(seg, static_cast<const char*>(v.toPtr()), str_len(v));
+        else fallback(seg, v);
     }
-    
-    return i;
+    template<typename T>
+    FormatPiece(const FormatSegment& seg, const T& v) : FormatPiece(seg, detail::to_tvalue(v)) {}
+
+    // s may point into num
+    FormatPiece(const FormatPiece&) = delete;
+    FormatPiece& operator=(const FormatPiece&) = delete;
+
+private:
+    void number(const FormatSegment& seg, double d);
+    void integer(const FormatSegment& seg, int64_t i);
+    void string(const FormatSegment& seg, const char* str, size_t n) {
+        s = str;
+        len = seg.precision >= 0 && static_cast<size_t>(seg.precision) < n ? static_cast<size_t>(seg.precision) : n;
+    }
+    void fallback(const FormatSegment& seg, const TValue& v);
+};
+
+// The text of segs[0..n) with pieces[i] after the text of segs[i]
+const char* format_pieces(const FormatSegment* segs, size_t n, const FormatPiece* pieces, size_t count);
+
+template<size_t N, size_t... I, typename... Args>
+ALWAYS_INLINE const char* format_segments(const FormatSegment (&segs)[N], std::index_sequence<I...>,
+                                          const Args&... args) {
+    static_assert(sizeof...(Args) <= N, "more arguments than conversions");
+    const FormatPiece pieces[] = { FormatPiece(segs[I], args)... };
+    return format_pieces(segs, N, pieces, sizeof...(Args));
 }
 
-template<typename T, typename... Args>
-TValue string_format(const char* fmt, T&& first, Args&&... args) {
-    static char result_buf[4096];
-    
-    size_t i = 0;
-    while (fmt[i] != '\0') {
-        if (fmt[i] == '%') {
-            if (fmt[i + 1] == '%') {
-                i += 2;
-                continue;
-            }
-            size_t spec_end = find_spec_end(fmt + i);
-            
-            char spec[32];
-            size_t spec_len = spec_end;
-            if (spec_len >= sizeof(spec)) spec_len = sizeof(spec) - 1;
-            std::memcpy(spec, fmt + i, spec_len);
-            spec[spec_len] = '\0';
-            
-            TValue formatted = string_format_single(spec, detail::to_tvalue(first));
-            const char* formatted_str = static_cast<const char*>(formatted.toPtr());
-            
-            std::snprintf(result_buf, sizeof(result_buf), "%.*s%s",
-                (int)i, fmt, formatted_str);
-            size_t prefix_len = std::strlen(result_buf);
-            
-            if constexpr (sizeof...(args) > 0) {
-                TValue rest = string_format(fmt + i + spec_end, std::forward<Args>(args)...);
-                std::snprintf(result_buf + prefix_len, sizeof(result_buf) - prefix_len, "%s",
-                    static_cast<const char*>(rest.toPtr()));
-            } else {
-                std::strncpy(result_buf + prefix_len, fmt + i + spec_end, sizeof(result_buf) - prefix_len - 1);
-                result_buf[sizeof(result_buf) - 1] = '\0';
-            }
-            
-            return TValue::String(result_buf);
+template<size_t N, typename T, typename... Args>
+ALWAYS_INLINE const char* format(const FormatSegment (&segs)[N], const T& first, const Args&... args) {
+    return format_segments(segs, std::index_sequence_for<T, Args...>(), first, args...);
+}
+
+// ---------- Patterns ----------
+
+// Capture i (0-based) of a successful match as a Lua value
+inline TValue pattern_capture(const PatternMatch& m, int i) {
+    if (m.isPosition(i)) return TValue::Integer(static_cast<int32_t>(m.position(i)));
+    std::string_view text = m.text(i);
+    return new_string(text.data(), text.size());
+}
+
+// Bytes of a string (or number) argument; false for other values
+inline bool string_bytes(const TValue& v, TValue& holder, std::string_view& out) {
+    if (v.isString()) holder = v;
+    else if (v.isNumber() || v.isInt64()) holder = tostring(v);
+    else return false;
+    out = {static_cast<const char*>(holder.toPtr()), str_len(holder)};
+    return true;
+}
+
+// Lua's 1-based, possibly negative init as a byte offset; false past the end
+inline bool pattern_init(NUMBER init, size_t len, size_t& offset) {
+    long long i = static_cast<long long>(init);
+    long long n = static_cast<long long>(len);
+    if (i > 0) i -= 1;
+    else if (i == 0 || -i > n) i = 0;
+    else i = n + i;
+    if (i > n) return false;
+    offset = static_cast<size_t>(i);
+    return true;
+}
+
+// s:find(p, init) -> start, end, captures... or nil
+L2C_RUNTIME_API Values string_find(const char* s, size_t len, const Pattern& p, NUMBER init = 1);
+
+// s:find(p, init, true): plain substring search
+L2C_RUNTIME_API Values string_find_plain(const char* s, size_t len, std::string_view p, NUMBER init = 1);
+
+L2C_RUNTIME_API Values string_find(const char* s, const char* pattern, NUMBER init = 1);
+
+// s:match(p, init) -> the captures (the whole match if none) or nil
+L2C_RUNTIME_API Values string_match(const char* s, size_t len, const Pattern& p, NUMBER init = 1);
+
+// s:gmatch(p) iterator. Generated for-in loops drive it directly:
+//   for (l2c::GMatch it(s, p); it.next(); ) { auto w = it.capture(0); ... }
+class GMatch {
+public:
+    GMatch(const TValue& s, const Pattern& p) : pattern_(&p) { bind(s); }
+    GMatch(const TValue& s, const TValue& p) {
+        TValue holder;
+        std::string_view text;
+        if (!string_bytes(p, holder, text)) text = {};
+        pattern_ = &lookup_pattern(text.data(), text.size(), own_);
+        bind(s);
+    }
+    GMatch(const GMatch&) = delete;
+    GMatch& operator=(const GMatch&) = delete;
+
+    bool next() {
+        if (!str_ || offset_ > len_ || !pattern_->find(str_, len_, offset_, m_, lastmatch_)) {
+            str_ = nullptr;
+            return false;
         }
-        i++;
+        offset_ = static_cast<size_t>(m_.end - str_);
+        lastmatch_ = m_.end;
+        return true;
     }
-    
-    return TValue::String(fmt);
-}
 
-inline TValue string_find(const char* s, const char* pattern, NUMBER init = 1) {
-    int len = static_cast<int>(std::strlen(s));
-    int start = static_cast<int>(init) - 1;
-    if (start < 0) start = 0;
-    if (start > len) start = len;
-    
-    const char* pos = std::strstr(s + start, pattern);
-    if (pos != nullptr) {
-        LuaTable* result = LuaTable::create(2, 0);
-        result->set(1, TValue::Integer(static_cast<int>(pos - s) + 1));
-        result->set(2, TValue::Integer(static_cast<int>(pos - s) + std::strlen(pattern)));
-        return TValue::Table(result);
+    // Capture i (0-based) of the current match; nil past the last one
+    TValue capture(int i) const { return i < m_.resultCount() ? pattern_capture(m_, i) : NIL; }
+
+    // Lua call protocol: the next match's first capture, or nil when done
+    TValue operator()() { return next() ? capture(0) : NIL; }
+
+private:
+    TValue subject_;  // keeps the subject reachable while iterating
+    const char* str_ = nullptr;
+    size_t len_ = 0;
+    size_t offset_ = 0;
+    const char* lastmatch_ = nullptr;
+    const Pattern* pattern_ = nullptr;
+    std::optional<Pattern> own_;
+    PatternMatch m_;
+
+    void bind(const TValue& s) {
+        std::string_view text;
+        if (!string_bytes(s, subject_, text)) return;
+        str_ = text.data();
+        len_ = text.size();
     }
-    return NIL;
+};
+
+// Appends the replacement string for match m: %0-%9 name captures, %% is '%'
+L2C_RUNTIME_API void append_replacement(std::string& out, const PatternMatch& m, std::string_view repl);
+
+// Appends a table/function replacement result; false and nil keep the match
+L2C_RUNTIME_API void append_replacement_value(std::string& out, const PatternMatch& m, const TValue& value);
+
+// s:gsub(p, repl, max_n) -> new string (s itself when nothing matched), match count.
+// `replace(out, m)` appends the replacement of one match.
+template<typename Replace>
+MultiReturn2 string_gsub(const TValue& s, const Pattern& p, Replace&& replace, NUMBER max_n = INFINITY) {
+    TValue subject;
+    std::string_view text;
+    if (!string_bytes(s, subject, text)) return MultiReturn2(s, TValue::Integer(0));
+    const char* str = text.data();
+    const size_t len = text.size();
+    const char* src = str;
+    const char* lastmatch = nullptr;
+    std::string out;
+    size_t n = 0;
+    PatternMatch m;
+    while (static_cast<NUMBER>(n) < max_n
+           && p.find(str, len, static_cast<size_t>(src - str), m, lastmatch)) {
+        out.append(src, static_cast<size_t>(m.start - src));
+        replace(out, m);
+        n++;
+        src = lastmatch = m.end;
+        if (p.anchored()) break;
+    }
+    if (n == 0) return MultiReturn2(subject, TValue::Integer(0));
+    out.append(src, static_cast<size_t>(str + len - src));
+    return MultiReturn2(new_string(out.data(), out.size()), TValue::Integer(static_cast<int32_t>(n)));
 }
 
+// Replacement given as a Lua value: string (with %n), table, or function
+L2C_RUNTIME_API MultiReturn2 string_gsub(const TValue& s, const Pattern& p, const TValue& repl, NUMBER max_n = INFINITY);
+
 inline NUMBER string_len(const char* s) {
     return static_cast<NUMBER>(std::strlen(s));
 }
 
+// s:sub(i, j) of a string of byte length len, as a collector-owned string
+L2C_RUNTIME_API TValue substring(const char* s, size_t len, NUMBER i, NUMBER j = -1);
+
 inline const char* string_sub(const char* s, NUMBER i, NUMBER j = -1) {
-    int len = static_cast<int>(std::strlen(s));
-    int start = (i < 0) ? len + static_cast<int>(i) : static_cast<int>(i) - 1;
-    int end = (j < 0) ? len + static_cast<int>(j) : static_cast<int>(j) - 1;
-    if (start < 0) start = 0;
-    if (end >= len) end = len - 1;
-    if (start > end || len == 0) return "";
-    
-    static char buf[4096];
-    int sublen = end - start + 1;
-    std::memcpy(buf, s + start, sublen);
-    buf[sublen] = '\0';
-    return buf;
+    return static_cast<const char*>(substring(s, std::strlen(s), i, j).toPtr());
 }
 
-// ---------- Table functions ----------
-inline void table_insert(TValue& t, const TValue& value) {
-    if (!t.isTable()) return;
-    LuaTable* tbl = t.toTable();
-    int len = static_cast<int>(tbl->length());
-    tbl->set(len + 1, value);
-}
+// ---------- String builder for `..` chains ----------
+// a .. b .. c becomes l2c::concat(a, b, c): every operand is measured
+// (numbers are formatted into the piece itself) and the bytes are copied
+// once into a new collector-owned string. Returns const char* like the
+// other string results.
+struct ConcatPiece {
+    const char* s;
+    size_t      len;
+    char        num[MAX_NUMBER_CHARS];
 
-inline void table_insert(TValue& t, NUMBER pos, const TValue& value) {
-    if (!t.isTable()) return;
-    LuaTable* tbl = t.toTable();
-    int idx = static_cast<int>(pos);
-    int len = static_cast<int>(tbl->length());
-    if (idx < 1) idx = 1;
-    if (idx > len + 1) idx = len + 1;
-    
-    // Shift elements up
-    for (int i = len; i >= idx; --i) {
-        tbl->set(i + 1, tbl->get(i));
+    ConcatPiece(const char* str) : s(str), len(std::strlen(str)) {}
+    ConcatPiece(double d) : s(num), len(number_to_chars(num, d)) {}
+    ConcatPiece(int32_t i) : s(num), len(integer_to_chars(num, i)) {}
+    ConcatPiece(int64_t i) : s(num), len(integer_to_chars(num, i)) {}
+    ConcatPiece(const TValue& v) : s(num) {
+        if (v.isString()) {
+            s = static_cast<const char*>(v.toPtr());
+            len = str_len(v);
+        } else if (v.isNumber()) {
+            len = number_to_chars(num, v.toNumber());
+        } else if (v.isInt64()) {
+            len = integer_to_chars(num, v.toInt64());
+        } else {
+            s = static_cast<const char*>(tostring(v).toPtr());
+            len = std::strlen(s);
+        }
     }
-    tbl->set(idx, value);
+    ConcatPiece(const TableSlotProxy& p) : ConcatPiece(static_cast<TValue>(p)) {}
+
+    // s may point into num
+    ConcatPiece(const ConcatPiece&) = delete;
+    ConcatPiece& operator=(const ConcatPiece&) = delete;
+};
+
+// Declared without `inline`: GCC rejects noinline on an inline declaration,
+// and the (NOINLINE) definition supplies it in header-only builds
+const char* concat_pieces(const ConcatPiece* pieces, size_t n);
+
+template<typename... Parts>
+ALWAYS_INLINE const char* concat(const Parts&... parts) {
+    const ConcatPiece pieces[] = { ConcatPiece(parts)... };
+    return concat_pieces(pieces, sizeof...(Parts));
 }
 
-inline void table_sort(TValue& t, std::function<bool(const TValue&, const TValue&)> comparator = nullptr) {
-    if (!t.isTable()) return;
-    LuaTable* tbl = t.toTable();
-    int len = static_cast<int>(tbl->length());
-    if (len <= 1) return;
-    
-    auto default_less = [](const TValue& a, const TValue& b) -> bool {
-        if (a.isNumber() && b.isNumber()) return a.toNumber() < b.toNumber();
-        if (a.isInteger() && b.isInteger()) return a.toInteger() < b.toInteger();
-        if (a.isString() && b.isString()) {
-            return std::strcmp(static_cast<const char*>(a.toPtr()), 
-                              static_cast<const char*>(b.toPtr())) < 0;
+// a == b where both are STRING values (const char*), such as two string
+// locals or a .. result and a literal: compared by content, since a
+// collector-owned string is not interned and an equal one may sit at
+// another address. Any other pair of operands compares as usual.
+ALWAYS_INLINE bool str_equals(const char* a, const char* b) {
+    return a == b || (a && b && std::strcmp(a, b) == 0);
+}
+
+template<typename A, typename B>
+ALWAYS_INLINE bool str_equals(const A& a, const B& b) { return a == b; }
+
+// ---------- Table functions ----------
+// Shifts go through LuaTable::insertAt/removeAt/moveRange: one memmove
+// when the range is in the array part
+L2C_RUNTIME_API void table_insert(const TValue& t, const TValue& value);
+
+L2C_RUNTIME_API void table_insert(const TValue& t, NUMBER pos, const TValue& value);
+
+// ---------- table.sort ----------
+// Pattern-defeating quicksort over a TValue range: median-of-3 (ninther for
+// large ranges) pivots, insertion sort for short ranges, a bounded
+// insertion-sort attempt when a partition needed no swaps (sorted input),
+// and heapsort after too many unbalanced partitions. All scans are bounds
+// checked, so an inconsistent comparator leaves an unspecified order
+// rather than running off the range.
+namespace sort_detail {
+    constexpr ptrdiff_t INSERTION_THRESHOLD = 24;
+    constexpr ptrdiff_t NINTHER_THRESHOLD = 128;
+    constexpr size_t PARTIAL_INSERTION_LIMIT = 8;
+
+    template<typename Less>
+    inline void insertion_sort(TValue* begin, TValue* end, Less& less) {
+        if (begin == end) return;
+        for (TValue* i = begin + 1; i < end; ++i) {
+            TValue tmp = *i;
+            TValue* j = i;
+            while (j > begin && less(tmp, j[-1])) {
+                *j = j[-1];
+                --j;
+            }
+            *j = tmp;
         }
-        return a.bits < b.bits;
-    };
-    
-    auto comp = comparator ? comparator : default_less;
-    
-    // Insertion sort
-    for (int i = 2; i <= len; ++i) {
-        TValue key = tbl->get(i);
-        int j = i - 1;
-        while (j >= 1 && comp(key, tbl->get(j))) {
-            tbl->set(j + 1, tbl->get(j));
-            --j;
+    }
+
+    // Insertion sort that gives up after PARTIAL_INSERTION_LIMIT moves
+    template<typename Less>
+    inline bool partial_insertion_sort(TValue* begin, TValue* end, Less& less) {
+        if (begin == end) return true;
+        size_t moves = 0;
+        for (TValue* i = begin + 1; i < end; ++i) {
+            if (!less(*i, i[-1])) continue;
+            TValue tmp = *i;
+            TValue* j = i;
+            do {
+                *j = j[-1];
+                --j;
+            } while (j > begin && less(tmp, j[-1]));
+            *j = tmp;
+            moves += static_cast<size_t>(i - j);
+            if (moves > PARTIAL_INSERTION_LIMIT) return false;
         }
-        tbl->set(j + 1, key);
+        return true;
     }
-}
 
-// table.concat(t, sep, i, j) - concatenate table elements
-// table.concat(t, sep, i, j) - concatenate table elements
-inline TValue table_concat(const TValue& t, const TValue& sep, NUMBER first = 1, NUMBER last = -1) {
-    if (!t.isTable()) return TValue::String("");
-    LuaTable* tbl = t.toTable();
-    int len = static_cast<int>(tbl->length());
-    int start = static_cast<int>(first);
-    int end = (last < 0) ? len : static_cast<int>(last);
-    const char* sep_str = sep.isString() ? static_cast<const char*>(sep.toPtr()) : "";
-    
-    static char buf[16384];
-    buf[0] = '\0';
-    int pos = 0;
-    bool first_elem = true;
-    for (int i = start; i <= end && i <= len && pos < (int)sizeof(buf) - 100; i++) {
-        TValue val = tbl->get(i);
-        if (!val.isNil()) {
-            if (!first_elem && sep_str && sep_str[0] && pos < (int)sizeof(buf) - 1) {
-                int n = strlen(sep_str);
-                if (pos + n < (int)sizeof(buf)) { memcpy(buf + pos, sep_str, n); pos += n; }
+    template<typename Less>
+    ALWAYS_INLINE void sort2(TValue* a, TValue* b, Less& less) {
+        if (less(*b, *a)) std::swap(*a, *b);
+    }
+
+    // Orders *a <= *b <= *c
+    template<typename Less>
+    ALWAYS_INLINE void sort3(TValue* a, TValue* b, TValue* c, Less& less) {
+        sort2(a, b, less);
+        sort2(b, c, less);
+        sort2(a, b, less);
+    }
+
+    // Partitions around the pivot at *begin; returns its final position and
+    // whether no element had to move
+    template<typename Less>
+    inline TValue* partition(TValue* begin, TValue* end, Less& less, bool& no_swaps) {
+        const TValue pivot = *begin;
+        TValue* i = begin;
+        TValue* j = end;
+        no_swaps = true;
+        for (;;) {
+            do ++i; while (i < end && less(*i, pivot));
+            do --j; while (j > begin && less(pivot, *j));
+            if (i >= j) break;
+            std::swap(*i, *j);
+            no_swaps = false;
+        }
+        std::swap(*begin, *j);
+        return j;
+    }
+
+    template<typename Less>
+    void pdqsort_loop(TValue* begin, TValue* end, Less& less, int bad_allowed) {
+        for (;;) {
+            ptrdiff_t size = end - begin;
+            if (size < INSERTION_THRESHOLD) {
+                insertion_sort(begin, end, less);
+                return;
+            }
+
+            ptrdiff_t s2 = size / 2;
+            if (size > NINTHER_THRESHOLD) {
+                sort3(begin, begin + s2, end - 1, less);
+                sort3(begin + 1, begin + (s2 - 1), end - 2, less);
+                sort3(begin + 2, begin + (s2 + 1), end - 3, less);
+                sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), less);
+                std::swap(*begin, begin[s2]);
+            } else {
+                sort3(begin + s2, begin, end - 1, less);
+            }
+
+            bool no_swaps;
+            TValue* pivot = partition(begin, end, less, no_swaps);
+            ptrdiff_t l = pivot - begin;
+            ptrdiff_t r = end - (pivot + 1);
+
+            if (l < size / 8 || r < size / 8) {
+                if (--bad_allowed == 0) {
+                    std::make_heap(begin, end, less);
+                    std::sort_heap(begin, end, less);
+                    return;
+                }
+                // Break up the pattern that caused the bad pivot
+                if (l >= INSERTION_THRESHOLD) {
+                    std::swap(begin[0], begin[l / 4]);
+                    std::swap(pivot[-1], pivot[-l / 4]);
+                }
+                if (r >= INSERTION_THRESHOLD) {
+                    std::swap(pivot[1], pivot[1 + r / 4]);
+                    std::swap(end[-1], end[-r / 4]);
+                }
+            } else if (no_swaps && partial_insertion_sort(begin, pivot, less)
+                       && partial_insertion_sort(pivot + 1, end, less)) {
+                return;
             }
-            first_elem = false;
-            if (val.isString()) {
-                const char* s = static_cast<const char*>(val.toPtr());
-                int n = strlen(s);
-                if (pos + n < (int)sizeof(buf)) { memcpy(buf + pos, s, n); pos += n; }
-            } else if (val.isNumber()) {
-                std::string s = std::to_string(val.toNumber());
-                if (pos + (int)s.size() < (int)sizeof(buf)) { memcpy(buf + pos, s.c_str(), s.size()); pos += s.size(); }
-            } else if (val.isInteger()) {
-                std::string s = std::to_string(val.toInteger());
-                if (pos + (int)s.size() < (int)sizeof(buf)) { memcpy(buf + pos, s.c_str(), s.size()); pos += s.size(); }
+
+            // Recurse into the smaller side, loop on the larger
+            if (l < r) {
+                pdqsort_loop(begin, pivot, less, bad_allowed);
+                begin = pivot + 1;
+            } else {
+                pdqsort_loop(pivot + 1, end, less, bad_allowed);
+                end = pivot;
             }
         }
     }
-    buf[pos] = '\0';
-    return TValue::String(buf);
+
+    template<typename Less>
+    inline void pdqsort(TValue* begin, TValue* end, Less less) {
+        size_t n = static_cast<size_t>(end - begin);
+        if (n < 2) return;
+        int log2n = 0;
+        while (n >>= 1) log2n++;
+        pdqsort_loop(begin, end, less, log2n);
+    }
+
+    // A comparator's result as a Lua truth value (bool, TValue, MultiReturn2, ...)
+    template<typename Comp>
+    ALWAYS_INLINE bool call_less(Comp& comp, const TValue& a, const TValue& b) {
+        using Result = std::decay_t<decltype(comp(a, b))>;
+        if constexpr (std::is_same_v<Result, bool>) return comp(a, b);
+        else return is_truthy(TValue(comp(a, b)));
+    }
+
+    ALWAYS_INLINE std::string_view string_view_of(const TValue& v) {
+        return {static_cast<const char*>(v.toPtr()), str_len(v)};
+    }
+
+    // Sorts tbl[1..len] in place when it lies in the array part; otherwise
+    // sorts a copy and stores it back
+    template<typename Less>
+    inline void sort_sequence(LuaTable* tbl, uint32_t len, Less less) {
+        if (len <= tbl->arraySize) {
+            pdqsort(tbl->array, tbl->array + len, less);
+            return;
+        }
+        std::vector<TValue> values(len);
+        for (uint32_t i = 0; i < len; i++) values[i] = tbl->get(static_cast<int32_t>(i + 1));
+        pdqsort(values.data(), values.data() + len, less);
+        for (uint32_t i = 0; i < len; i++) tbl->set(static_cast<int32_t>(i + 1), values[i]);
+    }
+} // namespace sort_detail
+
+// table.sort(t): default order, with fast paths for all-number and
+// all-string sequences in the array part
+L2C_RUNTIME_API void table_sort(const TValue& t);
+
+// table.sort(t, comp): comp is inlined (the transpiler emits comparators as
+// bool(const TValue&, const TValue&) lambdas) or called as a Lua function
+template<typename Comp>
+inline void table_sort(const TValue& t, Comp&& comp) {
+    if constexpr (std::is_same_v<std::decay_t<Comp>, std::nullptr_t>) {
+        table_sort(t);
+    } else {
+        if (!t.isTable()) return;
+        LuaTable* tbl = t.toTable();
+        uint32_t len = tbl->length();
+        if (len <= 1) return;
+        sort_detail::sort_sequence(tbl, len, [&comp](const TValue& a, const TValue& b) {
+            return sort_detail::call_less(comp, a, b);
+        });
+    }
 }
 
+// table.concat(t, sep, i, j) - concatenate table elements
+L2C_RUNTIME_API TValue table_concat(const TValue& t, const TValue& sep, NUMBER first = 1, NUMBER last = -1);
+
 // Overload for const char* separator
 inline TValue table_concat(const TValue& t, const char* sep = "", NUMBER first = 1, NUMBER last = -1) {
     return table_concat(t, TValue::String(sep ? sep : ""), first, last);
 }
-inline TValue table_remove(TValue& t, NUMBER pos = 1) {
-    if (!t.isTable()) return NIL;
-    LuaTable* tbl = t.toTable();
-    int idx = static_cast<int>(pos);
-    int len = static_cast<int>(tbl->length());
-    if (idx < 1 || idx > len) return NIL;
-    TValue removed = tbl->get(idx);
-    for (int i = idx; i < len; i++) {
-        tbl->set(i, tbl->get(i + 1));
-    }
-    tbl->set(len, NIL);
-    return removed;
-}
+// table.remove(t): pops t[#t]
+L2C_RUNTIME_API TValue table_remove(const TValue& t);
 
-inline std::vector<TValue> table_unpack(TValue& t, NUMBER first = 1, NUMBER last = -1) {
-    std::vector<TValue> result;
-    if (!t.isTable()) return result;
-    LuaTable* tbl = t.toTable();
-    int len = static_cast<int>(tbl->length());
-    int start = static_cast<int>(first);
-    int end = (last < 0) ? len : static_cast<int>(last);
-    for (int i = start; i <= end && i <= len; i++) {
-        result.push_back(tbl->get(i));
-    }
-    return result;
+L2C_RUNTIME_API TValue table_remove(const TValue& t, NUMBER pos);
+
+// table.move(a1, f, e, t, a2): a2[t..t+e-f] = a1[f..e]; returns a2
+L2C_RUNTIME_API TValue table_move(const TValue& a1, NUMBER f, NUMBER e, NUMBER t, const TValue& a2);
+
+inline TValue table_move(const TValue& a1, NUMBER f, NUMBER e, NUMBER t) {
+    return table_move(a1, f, e, t, a1);
 }
 
+// table.unpack(t [, i [, j]]): up to Values::INLINE results without a heap allocation
+L2C_RUNTIME_API Values table_unpack(const TValue& t, NUMBER first = 1, NUMBER last = -1);
+
 // ---------- I/O functions ----------
-inline TValue io_read(const char* format = "*a") {
-    static char buf[1048576];  // 1MB buffer
-    if (std::strcmp(format, "*a") == 0) {
-        std::string all;
-        char line[4096];
-        while (std::fgets(line, sizeof(line), stdin)) {
-            all += line;
-        }
-        std::strncpy(buf, all.c_str(), sizeof(buf) - 1);
-        buf[sizeof(buf) - 1] = '\0';
-    } else if (std::strcmp(format, "*l") == 0) {
-        if (!std::fgets(buf, sizeof(buf), stdin)) {
-            return NIL;
-        }
-        size_t len = std::strlen(buf);
-        if (len > 0 && buf[len - 1] == '\n') buf[len - 1] = '\0';
-    } else {
-        buf[0] = '\0';
-    }
-    return TValue::String(buf);
-}
+// io.read([format]): "l" (default), "L", "n", "a" (a leading '*' is accepted);
+// reads go through the buffered InputStream of lua_io.hpp
+L2C_RUNTIME_API TValue io_read(const char* format = "l");
+// io.read(count): up to count bytes; "" for 0 unless at end of input
+L2C_RUNTIME_API TValue io_read(NUMBER count);
+L2C_RUNTIME_API TValue io_read(const TValue& format);
 
 // ---------- OS functions ----------
 inline NUMBER os_clock() {
@@ -552,6 +919,47 @@ inline std::pair<TValue, TValue> next(TValue& t, const TValue& key = NIL) {
     return {NIL, NIL};
 }
 
+// pairs(t) iterator. Generated for-in loops hoist the table once and keep
+// a slot cursor, so each step is O(1) instead of re-finding the last key:
+//   for (l2c::PairsIter it(t); it.next(); ) { auto k = it.key; auto v = it.val; ... }
+class PairsIter {
+public:
+    explicit PairsIter(const TValue& t) : table_(t), tbl_(t.isTable() ? t.toTable() : nullptr) {}
+
+    ALWAYS_INLINE bool next() { return tbl_ && tbl_->nextAt(pos_, key, val); }
+
+    TValue key;
+    TValue val;
+
+private:
+    TValue table_;  // keeps the table reachable while iterating
+    LuaTable* tbl_;
+    uint32_t pos_ = 0;
+};
+
+// ipairs(t) iterator: reads the array part directly, falling back to a
+// (metamethod-aware) lookup past it; stops at the first nil.
+//   for (l2c::IpairsIter it(t); it.next(); ) { auto i = TValue::Integer(it.index); ... }
+class IpairsIter {
+public:
+    explicit IpairsIter(const TValue& t) : table_(t), tbl_(t.isTable() ? t.toTable() : nullptr) {}
+
+    ALWAYS_INLINE bool next() {
+        if (!tbl_) return false;
+        index++;
+        if (LIKELY((uint32_t)index <= tbl_->arraySize)) val = tbl_->array[index - 1];
+        else val = gettable(tbl_, TValue::Integer(index));
+        return !val.isNil();
+    }
+
+    int32_t index = 0;
+    TValue val;
+
+private:
+    TValue table_;
+    LuaTable* tbl_;
+};
+
 // ---------- Type function ----------
 inline const char* type(const TValue& t) {
     uint64_t tag = t.bits & TValue::TAG_MASK;
@@ -564,10 +972,14 @@ inline const char* type(const TValue& t) {
         case TValue::TAG_NIL:     return "nil";
         case TValue::TAG_FALSE:   
         case TValue::TAG_TRUE:    return "boolean";
-        case TValue::TAG_STRING:  return "string";
-        case TValue::TAG_INT:     return "number";
+        case TValue::TAG_STRING:
+        case TValue::TAG_ISTRING:
+        case TValue::TAG_LSTRING: return "string";
+        case TValue::TAG_INT:
+        case TValue::TAG_BIGINT:  return "number";
         case TValue::TAG_TABLE:   return "table";
         case TValue::TAG_FUNCTION: return "function";
+        case TValue::TAG_THREAD:  return "thread";
         case TValue::TAG_LIGHTUD: return "userdata";
         default: return "userdata";
     }
@@ -581,6 +993,7 @@ inline const char* type(bool) { return "boolean"; }
 // ---------- Assert ----------
 inline void assert(bool cond) {
     if (!cond) {
+        OutputStream::standard_output().flush();
         std::cerr << "assertion failed" << std::endl;
         std::abort();
     }
@@ -598,16 +1011,8 @@ std::pair<bool, TValue> pcall(Func func, Args... args) {
 }
 
 // ---------- Garbage collection ----------
-inline void collectgarbage() { }
-inline double collectgarbage(const char* option) {
-    // Stub implementation - return 0 for "count"
-    if (option && strcmp(option, "count") == 0) {
-        return 0.0;  // Stub: no actual memory counting
-    }
-    return 0.0;
-}
-
-
+// collectgarbage(opt [, arg]) backed by LuaGC (see lua_table.hpp)
+L2C_RUNTIME_API double collectgarbage(const char* option = "collect", double arg = 0);
 
 // ---------- Debug functions ----------
 inline TValue debug_getinfo(NUMBER, const char*) {
@@ -617,10 +1022,17 @@ inline TValue debug_getinfo(NUMBER, const char*) {
 // ---------- Math min/max ----------
 inline NUMBER math_min(NUMBER a, NUMBER b) { return std::fmin(a, b); }
 inline NUMBER math_max(NUMBER a, NUMBER b) { return std::fmax(a, b); }
+inline NUMBER math_min(NUMBER a) { return a; }
+inline NUMBER math_max(NUMBER a) { return a; }
+template<typename... Rest>
+inline NUMBER math_min(NUMBER a, NUMBER b, NUMBER c, Rest... rest) { return math_min(math_min(a, b), c, rest...); }
+template<typename... Rest>
+inline NUMBER math_max(NUMBER a, NUMBER b, NUMBER c, Rest... rest) { return math_max(math_max(a, b), c, rest...); }
 
     // ---------- Metatable support ----------
 inline TValue setmetatable(TValue t, const TValue& mt) {
         if (t.isTable() && mt.isTable()) {
+            t.toTable()->gcBarrier();
             t.toTable()->metatable = mt.toTable();
         }
         return t;
@@ -655,6 +1067,8 @@ namespace io {
     void write(Args&&... args) {
         l2c::io_write(std::forward<Args>(args)...);
     }
+
+    inline bool flush() { return l2c::io_flush(); }
 }
 
 // ============================================================
@@ -674,13 +1088,7 @@ namespace math_lib {
     inline NUMBER fmod(NUMBER x, NUMBER y) { return std::fmod(x, y); }
     
     inline NUMBER random(NUMBER min = 0.0, NUMBER max = 1.0) {
-        static bool seeded = false;
-        if (!seeded) {
-            std::srand(static_cast<unsigned>(std::time(nullptr)));
-            seeded = true;
-        }
-        NUMBER scale = static_cast<NUMBER>(std::rand()) / RAND_MAX;
-        return min + scale * (max - min);
+        return min + l2c::random_unit() * (max - min);
     }
     
     inline NUMBER min(NUMBER a, NUMBER b) { return std::fmin(a, b); }
@@ -711,11 +1119,10 @@ namespace string_lib {
         return 0;
     }
     
+    // Single-byte strings are interned: no allocation per call
     inline const char* char_(NUMBER c) {
-        static char buf[2];
-        buf[0] = static_cast<char>(c);
-        buf[1] = '\0';
-        return buf;
+        char ch = static_cast<char>(c);
+        return StringPool::instance().intern(&ch, 1)->data;
     }
     
     inline NUMBER len(const char* s) {
@@ -723,9 +1130,7 @@ namespace string_lib {
     }
 
     inline NUMBER len(const TValue& s) {
-        if (s.isString()) {
-            return static_cast<NUMBER>(std::strlen(static_cast<const char*>(s.toPtr())));
-        }
+        if (s.isString()) return static_cast<NUMBER>(l2c::str_len(s));
         return l2c::get_length(s);
     }
     
@@ -735,98 +1140,90 @@ namespace string_lib {
     
     inline TValue sub(const TValue& s, NUMBER i, NUMBER j = -1) {
         if (!s.isString()) return s;
-        const char* str = static_cast<const char*>(s.toPtr());
-        return TValue::String(l2c::string_sub(str, i, j));
+        return l2c::substring(static_cast<const char*>(s.toPtr()), l2c::str_len(s), i, j);
     }
     
     inline TValue upper(const TValue& s) {
         if (!s.isString()) return s;
         const char* str = static_cast<const char*>(s.toPtr());
-        static char buf[4096];
-        size_t len = std::strlen(str);
-        for (size_t i = 0; i < len && i < sizeof(buf) - 1; i++) {
-            buf[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(str[i])));
+        size_t len = l2c::str_len(s);
+        LuaString* out = l2c::alloc_string(len);
+        for (size_t i = 0; i < len; i++) {
+            out->data[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(str[i])));
         }
-        buf[len] = '\0';
-        return TValue::String(buf);
+        return TValue::LString(out->data);
     }
 
-    inline TValue gsub(const TValue& s, const TValue& pattern, const TValue& replacement) {
-        if (!s.isString()) return s;
-        const char* str = static_cast<const char*>(s.toPtr());
-        const char* pat = pattern.isString() ? static_cast<const char*>(pattern.toPtr()) : "";
-        const char* repl = replacement.isString() ? static_cast<const char*>(replacement.toPtr()) : "";
-        
-        static char buf[16384];
-        size_t pat_len = std::strlen(pat);
-        if (pat_len == 0) {
-            std::strncpy(buf, str, sizeof(buf) - 1);
-            buf[sizeof(buf) - 1] = '\0';
-            return TValue::String(buf);
-        }
-        
-        std::string result;
-        const char* pos = str;
-        while (*pos) {
-            const char* found = std::strstr(pos, pat);
-            if (!found) {
-                result += pos;
-                break;
-            }
-            result += std::string(pos, found - pos);
-            result += repl;
-            pos = found + pat_len;
+    // Patterns: string-literal patterns arrive precompiled as l2c::Pattern;
+    // other pattern values are compiled through l2c::lookup_pattern
+    inline const l2c::Pattern& pattern_of(const TValue& p, std::optional<l2c::Pattern>& scratch) {
+        TValue holder;
+        std::string_view text;
+        if (!l2c::string_bytes(p, holder, text)) text = {};
+        return l2c::lookup_pattern(text.data(), text.size(), scratch);
+    }
+
+    inline l2c::Values find(const TValue& s, const l2c::Pattern& pattern, NUMBER init = 1) {
+        if (!s.isString()) return l2c::Values::of(NIL);
+        return l2c::string_find(static_cast<const char*>(s.toPtr()), l2c::str_len(s), pattern, init);
+    }
+
+    inline l2c::Values find(const TValue& s, const TValue& pattern, NUMBER init = 1, bool plain = false) {
+        if (!s.isString()) return l2c::Values::of(NIL);
+        if (plain) {
+            TValue holder;
+            std::string_view text;
+            if (!l2c::string_bytes(pattern, holder, text)) text = {};
+            return l2c::string_find_plain(static_cast<const char*>(s.toPtr()), l2c::str_len(s), text, init);
         }
-        std::strncpy(buf, result.c_str(), sizeof(buf) - 1);
-        buf[sizeof(buf) - 1] = '\0';
-        return TValue::String(buf);
+        std::optional<l2c::Pattern> scratch;
+        return find(s, pattern_of(pattern, scratch), init);
+    }
+
+    inline l2c::Values match(const TValue& s, const l2c::Pattern& pattern, NUMBER init = 1) {
+        if (!s.isString()) return l2c::Values::of(NIL);
+        return l2c::string_match(static_cast<const char*>(s.toPtr()), l2c::str_len(s), pattern, init);
+    }
+
+    inline l2c::Values match(const TValue& s, const TValue& pattern, NUMBER init = 1) {
+        std::optional<l2c::Pattern> scratch;
+        return match(s, pattern_of(pattern, scratch), init);
+    }
+
+    inline l2c::GMatch gmatch(const TValue& s, const l2c::Pattern& pattern) { return l2c::GMatch(s, pattern); }
+    inline l2c::GMatch gmatch(const TValue& s, const TValue& pattern) { return l2c::GMatch(s, pattern); }
+
+    inline MultiReturn2 gsub(const TValue& s, const l2c::Pattern& pattern, const TValue& replacement,
+                       NUMBER max_n = INFINITY) {
+        return l2c::string_gsub(s, pattern, replacement, max_n);
+    }
+
+    inline MultiReturn2 gsub(const TValue& s, const TValue& pattern, const TValue& replacement,
+                       NUMBER max_n = INFINITY) {
+        std::optional<l2c::Pattern> scratch;
+        return l2c::string_gsub(s, pattern_of(pattern, scratch), replacement, max_n);
     }
-    // gsub with callback function
+
+    // gsub with a C++ callback (transpiled Lua function literal): called with
+    // the first capture; a nil/false (or void) result keeps the match
     template<typename Callback, typename = typename std::enable_if<
-        std::is_invocable_v<Callback, TValue>, int>::type>
-    TValue gsub(const TValue& s, const TValue& pattern, Callback callback) {
-        if (!s.isString()) return s;
-        const char* str = static_cast<const char*>(s.toPtr());
-        const char* pat = pattern.isString() ? static_cast<const char*>(pattern.toPtr()) : "";
-        
-        // Simple implementation: find all matches and call callback
-        // For regex-dna, the pattern is "([^|]+)|?" which matches segments separated by |
-        // We don't need full regex - just find | separated segments
-        static char buf[16384];
-        buf[0] = '\0';
-        int pos = 0;
-        
-        std::string result;
-        const char* p = str;
-        while (*p) {
-            // Find next | or end
-            const char* next = strchr(p, '|');
-            if (!next) {
-                // Last segment
-                std::string segment(p);
-                TValue seg_val = TValue::String(segment.c_str());
-                callback(seg_val);  // Call callback (ignores return for counting)
-                break;
+        std::is_invocable_v<Callback, TValue> && !std::is_convertible_v<Callback, TValue>, int>::type>
+    MultiReturn2 gsub(const TValue& s, const l2c::Pattern& pattern, Callback callback, NUMBER max_n = INFINITY) {
+        return l2c::string_gsub(s, pattern, [&callback](std::string& out, const l2c::PatternMatch& m) {
+            if constexpr (std::is_void_v<std::invoke_result_t<Callback, TValue>>) {
+                callback(l2c::pattern_capture(m, 0));
+                out.append(m.start, static_cast<size_t>(m.end - m.start));
             } else {
-                std::string segment(p, next - p);
-                TValue seg_val = TValue::String(segment.c_str());
-                callback(seg_val);  // Call callback
-                p = next + 1;
-                if (*p == '\0') break;
+                l2c::append_replacement_value(out, m, l2c::as_value(callback(l2c::pattern_capture(m, 0))));
             }
-        }
-        
-        // For counting purposes, return the original string unchanged
-        std::strncpy(buf, str, sizeof(buf) - 1);
-        buf[sizeof(buf) - 1] = '\0';
-        return TValue::String(buf);
+        }, max_n);
     }
 
-    inline TValue find(const TValue& s, const TValue& pattern, NUMBER init = 1) {
-        if (!s.isString()) return NIL;
-        const char* str = static_cast<const char*>(s.toPtr());
-        const char* pat = pattern.isString() ? static_cast<const char*>(pattern.toPtr()) : "";
-        return l2c::string_find(str, pat, init);
+    template<typename Callback, typename = typename std::enable_if<
+        std::is_invocable_v<Callback, TValue> && !std::is_convertible_v<Callback, TValue>, int>::type>
+    MultiReturn2 gsub(const TValue& s, const TValue& pattern, Callback callback, NUMBER max_n = INFINITY) {
+        std::optional<l2c::Pattern> scratch;
+        return gsub(s, pattern_of(pattern, scratch), std::move(callback), max_n);
     }
 }
 
@@ -835,19 +1232,12 @@ namespace string_lib {
 // ============================================================
 namespace table_lib {
     inline const char* concat(const char* a, const char* b) {
-        static char buf[8192];
-        int la = static_cast<int>(std::strlen(a));
-        int lb = static_cast<int>(std::strlen(b));
-        std::memcpy(buf, a, la);
-        std::memcpy(buf + la, b, lb + 1);
-        return buf;
+        return l2c::concat(a, b);
     }
     
     // For convenience, also provide overloads for TValue strings
     inline const char* concat(const TValue& a, const TValue& b) {
-        const char* sa = a.isString() ? static_cast<const char*>(a.toPtr()) : "";
-        const char* sb = b.isString() ? static_cast<const char*>(b.toPtr()) : "";
-        return concat(sa, sb);
+        return l2c::concat(a, b);
     }
 }
 
@@ -859,3 +1249,8 @@ namespace table_lib {
 namespace detail {
     inline TValue to_tvalue(const TableSlotProxy& p) { return static_cast<TValue>(p); }
 }
+
+// Out-of-line definitions, unless they come from the l2c_runtime library
+#if !defined(L2C_RUNTIME_LIB) || defined(L2C_RUNTIME_IMPL)
+#include "l2c_runtime_impl.hpp"
+#endif
@@ -0,0 +1,514 @@
+#pragma once
+
+/**
+ * lua_coroutine.hpp - Lua coroutines on C++20 stackless coroutines
+ *
+ * The transpiler lowers each Lua function that can yield into a C++
+ * coroutine returning l2c::CoTask (CoroutineAnalyzer):
+ *   coroutine.yield(a)   ->  (co_await l2c::coroutine_yield(a))
+ *   g(x), g yielding     ->  (co_await g(x))
+ * Frames are allocated from the TableAllocator pools, so a coroutine
+ * costs one pooled block per active call and a resume/yield pair is a
+ * pair of indirect jumps, with no stack of its own to switch to.
+ *
+ * A Thread (TAG_THREAD) is a collector-tracked Closure. Resuming it runs
+ * its innermost suspended frame (leaf); values cross resume and yield in
+ * `transfer`. Every frame is linked into the thread that allocated it,
+ * and the thread's trace entry scans them conservatively, like the stack.
+ *
+ * Only statically visible yields are lowered. A lowered function reached
+ * through a TValue call runs to completion (l2c::co::run), so a yield
+ * inside it fails with "attempt to yield across a C-call boundary", as a
+ * yield across a C function does in Lua. Yielding calls and yields give
+ * their first value, unless a multiple assignment or return takes them
+ * all: (co_await l2c::co::all(...)).
+ *
+ * Generated for-in loops over coroutine.wrap(f) resume the thread directly:
+ *   for (l2c::WrapIter it(f); it.next(); ) { auto v = it.value(1); ... }
+ */
+
+#include "lua_table.hpp"
+#include "lua_io.hpp"
+#include <coroutine>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <utility>
+#include <vector>
+
+struct Thread;
+
+namespace l2c {
+
+namespace co {
+    // Header in front of each coroutine frame: links it into its thread
+    struct FrameLink {
+        FrameLink* prev;
+        FrameLink* next;
+        size_t     size;    // bytes of the whole block, header included
+        size_t     unused;  // keeps the frame 16-byte aligned
+    };
+    static_assert(sizeof(FrameLink) % 16 == 0, "frames must stay 16-byte aligned");
+
+    [[noreturn]] NOINLINE inline void fatal(const char* message) {
+        OutputStream::standard_output().flush();
+        std::fprintf(stderr, "%s\n", message);
+        std::abort();
+    }
+
+    // A return statement's values, as coroutine.resume hands them out
+    template<typename T>
+    Values values_of(T&& r) {
+        return Values::expand(std::forward<T>(r));
+    }
+
+    inline Thread* running();
+} // namespace co
+
+// Result of a function lowered to a C++ coroutine. It owns the callee's
+// frame: co_await runs the callee on the current thread and gives its
+// first return value.
+class CoTask {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    // Back to the awaiting frame, or to whoever resumed the thread
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(Handle h) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type {
+        Values result;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;  // the awaiting frame; none for a thread's body
+
+        CoTask get_return_object() noexcept { return CoTask(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        template<typename T>
+        void return_value(T&& r) { result = co::values_of(std::forward<T>(r)); }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        // Frames come from the TableAllocator pools (defined after Thread)
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size) noexcept;
+    };
+
+    CoTask() = default;
+    explicit CoTask(Handle h) : h_(h) {}
+    CoTask(CoTask&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    CoTask& operator=(CoTask&& o) noexcept {
+        if (this != &o) {
+            reset();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+    ~CoTask() { reset(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        h_.promise().continuation = caller;
+        return h_;
+    }
+    TValue await_resume() const { return values()[1]; }
+
+    // Every value the callee returned (co::all)
+    const Values& values() const {
+        promise_type& p = h_.promise();
+        if (p.error) std::rethrow_exception(p.error);
+        return p.result;
+    }
+
+    Handle handle() const { return h_; }
+    Handle release() { return std::exchange(h_, {}); }
+
+private:
+    void reset() {
+        if (h_) h_.destroy();
+        h_ = {};
+    }
+
+    Handle h_;
+};
+
+inline std::coroutine_handle<> CoTask::FinalAwaiter::await_suspend(Handle h) noexcept {
+    std::coroutine_handle<> next = h.promise().continuation;
+    return next ? next : std::noop_coroutine();
+}
+
+} // namespace l2c
+
+// ============================================================
+// Thread — coroutine object behind TAG_THREAD values
+// ============================================================
+struct Thread final : Closure {
+    enum class Status : uint8_t { Suspended, Running, Normal, Dead };
+
+    TValue                   body;       // the function, until the body returns
+    l2c::CoTask::Handle      root;       // the body's frame, once started
+    std::coroutine_handle<>  leaf;       // innermost frame, suspended in a yield
+    l2c::co::FrameLink       frames;     // ring of the frames this thread allocated
+    l2c::Values              transfer;   // resume arguments, then yielded values
+    Thread*                  resumer = nullptr;
+    std::exception_ptr       error;      // what the body failed with
+    uint32_t                 nny = 0;    // frames run to completion by co::run: no yield
+    Status                   status;
+    bool                     isMain;
+
+    Thread(const TValue& fn, bool main)
+        : body(fn), status(main ? Status::Running : Status::Suspended), isMain(main) {
+        ops   = &OPS;
+        size  = sizeof(Thread);
+        arity = 0;
+        frames.prev = frames.next = &frames;
+    }
+
+    ~Thread() {
+        if (root) root.destroy();
+    }
+
+    bool yieldable() const { return !isMain && nny == 0; }
+
+    static void destroy(Closure* c) { static_cast<Thread*>(c)->~Thread(); }
+
+    // Locals of suspended frames live outside the payload
+    static void trace(const Closure* c, LuaGC& gc) {
+        const Thread* t = static_cast<const Thread*>(c);
+        for (const l2c::co::FrameLink* f = t->frames.next; f != &t->frames; f = f->next)
+            gc.scanRange(f + 1, reinterpret_cast<const char*>(f) + f->size);
+    }
+
+    // Threads are not callable: TValue::call only dispatches TAG_FUNCTION
+    static constexpr Ops OPS = {
+        nullptr, nullptr, nullptr, nullptr, nullptr, &destroy, &trace, nullptr,
+    };
+};
+
+template<typename F>
+l2c::CoTask ClosureImpl<F>::start(Closure* c, const l2c::Values& args) {
+    F& f = static_cast<ClosureImpl*>(c)->fn;
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+        return f(args[(int64_t)I + 1]...);
+    }(std::make_index_sequence<FIXED>{});
+}
+
+namespace l2c {
+
+namespace co {
+    inline Thread* new_thread(const TValue& fn, bool main) {
+        LuaGC& gc = LuaGC::instance();
+        gc.checkStep();
+        void* mem = TableAllocator::instance().allocate(sizeof(Thread));
+        Thread* t = new (mem) Thread(fn, main);
+        gc.trackClosure(t);
+        return t;
+    }
+
+    // The running thread and the main one, both kept as collector roots
+    struct State {
+        Thread* running;
+        TValue  main;
+        TValue  current;
+        GCRoots<TValue> roots{&main, &current};
+
+        State() : running(new_thread(TValue::Nil(), true)) {
+            main = current = TValue::Coroutine(running);
+        }
+
+        void switchTo(Thread* t) {
+            running = t;
+            current = TValue::Coroutine(t);
+        }
+    };
+
+    // One per l2c::State, like the threads it tracks
+    inline State& state() {
+        static thread_local State s;
+        return s;
+    }
+
+    inline Thread* running() { return state().running; }
+
+    inline TValue error_value(const std::exception_ptr& e) {
+        try {
+            std::rethrow_exception(e);
+        } catch (const TValue& v) {
+            return v;
+        } catch (const std::exception& x) {
+            return new_string(x.what(), std::strlen(x.what()));
+        } catch (...) {
+            return TValue::String("error in coroutine");
+        }
+    }
+
+    // Body of a thread whose function is not lowered: one plain call
+    inline CoTask call_body(TValue fn, Values args) {
+        TValue small[Values::INLINE];
+        std::vector<TValue> large;
+        TValue* argv = small;
+        if (args.size() > Values::INLINE) {
+            large.resize(args.size());
+            argv = large.data();
+        }
+        for (uint32_t i = 0; i < args.size(); i++) argv[i] = args[(int64_t)i + 1];
+        co_return fn.callv(argv, args.size());
+    }
+
+    // Why t can't be resumed, or nullptr
+    inline const char* resume_error(const Thread* t) {
+        if (t->status == Thread::Status::Suspended) return nullptr;
+        return t->status == Thread::Status::Dead ? "cannot resume dead coroutine"
+                                                 : "cannot resume non-suspended coroutine";
+    }
+
+    // Run the suspended t, its arguments in t->transfer, until it yields
+    // or its body returns. The values yielded or returned are left in
+    // t->transfer; false if the body failed (t->error).
+    inline bool step(Thread* t) {
+        State& s = state();
+        Thread* prev = s.running;
+        prev->status = Thread::Status::Normal;
+        t->resumer = prev;
+        t->status = Thread::Status::Running;
+        s.switchTo(t);
+        if (UNLIKELY(!t->root)) {
+            Closure* f = t->body.toFunction();
+            t->root = (f->ops->start ? f->ops->start(f, t->transfer) : call_body(t->body, t->transfer)).release();
+            t->leaf = t->root;
+        }
+        t->leaf.resume();
+        s.switchTo(prev);
+        prev->status = Thread::Status::Running;
+        t->resumer = nullptr;
+
+        if (LIKELY(!t->root.done())) {
+            t->status = Thread::Status::Suspended;
+            return true;
+        }
+        CoTask::promise_type& p = t->root.promise();
+        t->error = p.error;
+        if (!p.error) t->transfer = p.result;
+        t->root.destroy();
+        t->root = {};
+        t->body = TValue::Nil();
+        t->status = Thread::Status::Dead;
+        return !t->error;
+    }
+
+    // Fill t->transfer in place: a Values temporary costs a copy
+    template<typename... A>
+    inline void set_transfer(Thread* t, A&&... values) {
+        t->transfer.clear();
+        (t->transfer.push(as_value(std::forward<A>(values))), ...);
+    }
+
+    // coroutine.resume, the arguments in t->transfer: true and the
+    // values t yields or returns, or false and the error
+    inline Values resume(Thread* t) {
+        if (!step(t)) return Values::of(false, error_value(t->error));
+        Values out = Values::of(true);
+        for (uint32_t i = 1; i <= t->transfer.size(); i++) out.push(t->transfer[i]);
+        return out;
+    }
+
+    // step() for coroutine.wrap: the values, in t->transfer until t
+    // runs again; an error is raised again in the caller
+    inline const Values& resume_or_raise(Thread* t) {
+        if (const char* e = resume_error(t)) fatal(e);
+        if (UNLIKELY(!step(t))) std::rethrow_exception(t->error);
+        return t->transfer;
+    }
+
+    // A lowered function called from code that isn't: run its frames to
+    // completion on this C++ stack. Nothing here can suspend, so a yield
+    // inside is an error.
+    inline TValue run(CoTask&& task) {
+        Thread* t = running();
+        t->nny++;
+        task.handle().resume();
+        t->nny--;
+        return task.await_resume();
+    }
+
+    class YieldAwaiter {
+    public:
+        explicit YieldAwaiter(Thread* t) : t_(t) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const noexcept { t_->leaf = h; }
+        TValue await_resume() const noexcept { return t_->transfer[1]; }
+
+        // Every value the thread was resumed with (co::all)
+        const Values& values() const noexcept { return t_->transfer; }
+
+    private:
+        Thread* t_;
+    };
+
+    // `co_await all(x)`: every value of a yield or a yielding call, for
+    // l2c::take, instead of the first
+    template<typename A>
+    struct All {
+        A awaitable;
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) {
+            if constexpr (std::is_void_v<decltype(awaitable.await_suspend(h))>) {
+                awaitable.await_suspend(h);
+                return std::noop_coroutine();
+            } else {
+                return awaitable.await_suspend(h);
+            }
+        }
+        Values await_resume() const { return awaitable.values(); }
+    };
+
+    template<typename A>
+    All<std::decay_t<A>> all(A&& awaitable) { return {std::forward<A>(awaitable)}; }
+
+    [[noreturn]] NOINLINE inline void yield_error(const Thread* t) {
+        fatal(t->isMain ? "attempt to yield from outside a coroutine"
+                        : "attempt to yield across a C-call boundary");
+    }
+
+    // coroutine.yield in a function the transpiler could not lower
+    template<typename... A>
+    [[noreturn]] void yield_unlowered(A&&...) {
+        yield_error(running());
+    }
+} // namespace co
+
+inline void* CoTask::promise_type::operator new(size_t size) {
+    LuaGC& gc = LuaGC::instance();
+    gc.checkStep();
+    size_t bytes = sizeof(co::FrameLink) + size;
+    auto* link = static_cast<co::FrameLink*>(TableAllocator::instance().allocate(bytes));
+    co::FrameLink& ring = co::running()->frames;
+    link->size = bytes;
+    link->prev = &ring;
+    link->next = ring.next;
+    ring.next->prev = link;
+    ring.next = link;
+    gc.accountAlloc(bytes);
+    return link + 1;
+}
+
+inline void CoTask::promise_type::operator delete(void* p, size_t) noexcept {
+    auto* link = static_cast<co::FrameLink*>(p) - 1;
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    LuaGC::instance().accountFree(link->size);
+    TableAllocator::instance().deallocate(link, link->size);
+}
+
+// ---------- coroutine library ----------
+// fn is a function value or a C++ callable (a lowered function's lambda)
+template<typename F>
+inline TValue coroutine_create(F&& fn) {
+    TValue f = as_value(std::forward<F>(fn));
+    if (!f.isFunction()) co::fatal("bad argument #1 to 'create' (function expected)");
+    return TValue::Coroutine(co::new_thread(f, false));
+}
+
+template<typename... A>
+inline Values coroutine_resume(const TValue& co, A&&... args) {
+    if (!co.isThread()) co::fatal("bad argument #1 to 'resume' (coroutine expected)");
+    Thread* t = co.toThread();
+    if (const char* e = co::resume_error(t)) return Values::of(false, e);
+    co::set_transfer(t, std::forward<A>(args)...);
+    return co::resume(t);
+}
+
+// co_await it: suspends the running thread until it is resumed again
+template<typename... A>
+inline co::YieldAwaiter coroutine_yield(A&&... values) {
+    Thread* t = co::running();
+    if (UNLIKELY(!t->yieldable())) co::yield_error(t);
+    co::set_transfer(t, std::forward<A>(values)...);
+    return co::YieldAwaiter(t);
+}
+
+inline TValue coroutine_status(const TValue& co) {
+    if (!co.isThread()) co::fatal("bad argument #1 to 'status' (coroutine expected)");
+    switch (co.toThread()->status) {
+        case Thread::Status::Suspended: return TValue::String("suspended");
+        case Thread::Status::Running:   return TValue::String("running");
+        case Thread::Status::Normal:    return TValue::String("normal");
+        default:                        return TValue::String("dead");
+    }
+}
+
+// The running coroutine and whether it is the main one
+inline Values coroutine_running() {
+    Thread* t = co::running();
+    return Values::of(TValue::Coroutine(t), t->isMain);
+}
+
+inline bool coroutine_isyieldable() {
+    return co::running()->yieldable();
+}
+
+namespace co {
+    // The function coroutine.wrap returns: resumes its thread
+    struct Wrapped {
+        TValue thread;
+
+        TValue operator()(ArgSpan args) const {
+            Thread* t = thread.toThread();
+            t->transfer.clear();
+            for (uint32_t i = 0; i < args.n; i++) t->transfer.push(args.argv[i]);
+            return resume_or_raise(t)[1];
+        }
+    };
+
+    // fn's thread if coroutine.wrap made it, else nullptr
+    inline Thread* wrapped_thread(const TValue& fn) {
+        if (!fn.isFunction() || fn.toFunction()->ops != &ClosureImpl<Wrapped>::OPS) return nullptr;
+        return static_cast<ClosureImpl<Wrapped>*>(fn.toFunction())->fn.thread.toThread();
+    }
+} // namespace co
+
+template<typename F>
+inline TValue coroutine_wrap(F&& fn) {
+    return TValue::NewFunction(co::Wrapped{coroutine_create(std::forward<F>(fn))});
+}
+
+// for-in over coroutine.wrap(f): each step resumes the thread with
+// (nil, control) like the generic for calls its iterator, and keeps
+// every value it yields. Over any other function value the step is
+// that call, which gives one value.
+class WrapIter {
+public:
+    template<typename F>
+        requires (!std::is_same_v<std::decay_t<F>, TValue>)
+    explicit WrapIter(F&& fn) : fn_(coroutine_create(std::forward<F>(fn))), thread_(fn_.toThread()) {}
+
+    explicit WrapIter(const TValue& fn) : fn_(fn), thread_(co::wrapped_thread(fn)) {}
+
+    bool next() {
+        if (thread_) {
+            co::set_transfer(thread_, TValue::Nil(), control_);
+            values_ = &co::resume_or_raise(thread_);
+            control_ = (*values_)[1];
+        } else {
+            control_ = fn_(TValue::Nil(), control_);
+        }
+        return !control_.isNil();
+    }
+
+    // Loop variable i (1-based)
+    TValue value(int64_t i) const { return i == 1 ? control_ : thread_ ? (*values_)[i] : TValue::Nil(); }
+
+private:
+    TValue fn_;        // the thread, or the function called each step
+    Thread* thread_;
+    const Values* values_ = nullptr;  // what the thread yielded, in its transfer
+    TValue control_;
+};
+
+} // namespace l2c
@@ -0,0 +1,343 @@
+#pragma once
+
+/**
+ * lua_io.hpp - Buffered input and output for io.read, io.lines, io.write, print
+ *
+ * An InputStream reads a file descriptor in 256 KiB blocks with read(2).
+ * A regular file is mmap'ed whole instead, so lines are found with memchr
+ * in place and each byte is copied once, when it becomes a Lua string.
+ * Views returned by line()/bytes() stay valid until the next read.
+ *
+ * Lua strings carry a header in front of their bytes (LuaString), so
+ * io.read("a") still copies the input once; from a mapped file that is
+ * a single memcpy into the string's allocation.
+ *
+ * Generated for-in loops over io.lines() drive a LinesIter directly:
+ *   for (l2c::LinesIter it; it.next(); ) { auto line = it.line(); ... }
+ *
+ * print and io.write append to an OutputStream over standard output, which
+ * writes its 256 KiB buffer when full, on io.flush() and at exit (and
+ * before the runtime aborts). Numbers are formatted by lua_number.hpp.
+ * Each thread buffers its own output; standard input is the one stream
+ * States share.
+ */
+
+#include "lua_table.hpp"
+#include "lua_number.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define L2C_POSIX_IO 1
+#endif
+
+namespace l2c {
+
+class OutputStream {
+public:
+    static constexpr size_t CAPACITY = size_t(1) << 18;
+
+    explicit OutputStream(int fd) : fd_(fd), data_(static_cast<char*>(std::malloc(CAPACITY))) {}
+
+    ~OutputStream() {
+        flush();
+        std::free(data_);
+    }
+
+    OutputStream(const OutputStream&) = delete;
+    OutputStream& operator=(const OutputStream&) = delete;
+
+    // Standard output: one buffer per thread, as each runs its own
+    // State, written out when the thread ends (the main thread's at exit)
+    static OutputStream& standard_output() {
+        static thread_local OutputStream out(1);
+        return out;
+    }
+
+    ALWAYS_INLINE void put(char c) {
+        if (len_ == CAPACITY) flush();
+        data_[len_++] = c;
+    }
+
+    // n bytes of s, which may contain NULs
+    ALWAYS_INLINE void write(const char* s, size_t n) {
+        if (n <= CAPACITY - len_) {
+            std::memcpy(data_ + len_, s, n);
+            len_ += n;
+        } else {
+            write_large(s, n);
+        }
+    }
+
+    void number(double d) {
+        if (CAPACITY - len_ < MAX_NUMBER_CHARS) flush();
+        len_ += number_to_chars(data_ + len_, d);
+    }
+
+    void integer(long long i) {
+        if (CAPACITY - len_ < MAX_NUMBER_CHARS) flush();
+        len_ += integer_to_chars(data_ + len_, i);
+    }
+
+    // Write out the buffer; false on a write error (the bytes are dropped)
+    bool flush() {
+        const char* p = data_;
+        size_t left = len_;
+        len_ = 0;
+        return write_fd(p, left);
+    }
+
+private:
+    NOINLINE void write_large(const char* s, size_t n) {
+        flush();
+        if (n < CAPACITY) {
+            std::memcpy(data_, s, n);
+            len_ = n;
+        } else {
+            write_fd(s, n);
+        }
+    }
+
+    bool write_fd(const char* p, size_t n) {
+#ifdef L2C_POSIX_IO
+        while (n > 0) {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += w;
+            n -= (size_t)w;
+        }
+        return true;
+#else
+        FILE* f = fd_ == 2 ? stderr : stdout;
+        return std::fwrite(p, 1, n, f) == n && std::fflush(f) == 0;
+#endif
+    }
+
+    int fd_;
+    char* data_;
+    size_t len_ = 0;
+};
+
+class InputStream {
+public:
+    static constexpr size_t BLOCK = size_t(1) << 18;
+
+    // owned: close fd when the stream is destroyed
+    explicit InputStream(int fd, bool owned = false) : fd_(fd), owned_(owned) {
+#ifdef L2C_POSIX_IO
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            off_t offset = lseek(fd, 0, SEEK_CUR);
+            void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<char*>(map);
+                cap_ = end_ = (size_t)st.st_size;
+                pos_ = offset > 0 ? std::min((size_t)offset, end_) : 0;
+                mapped_ = true;
+                eof_ = true;
+            }
+        }
+#endif
+    }
+
+    ~InputStream() {
+#ifdef L2C_POSIX_IO
+        if (mapped_) munmap(data_, cap_);
+        if (owned_) close(fd_);
+#endif
+        if (!mapped_) std::free(data_);
+    }
+
+    InputStream(const InputStream&) = delete;
+    InputStream& operator=(const InputStream&) = delete;
+
+    // The process's standard input, created on first use
+    static InputStream& standard_input() {
+        static InputStream* in = new InputStream(0);
+        return *in;
+    }
+
+    // The file at path, or nullptr if it can't be opened
+    static InputStream* open(const char* path) {
+#ifdef L2C_POSIX_IO
+        int fd = ::open(path, O_RDONLY);
+        return fd < 0 ? nullptr : new InputStream(fd, true);
+#else
+        (void)path;
+        return nullptr;
+#endif
+    }
+
+    // Next line, without its '\n' unless keep_newline; false at end of input
+    bool line(std::string_view& out, bool keep_newline = false) {
+        size_t scanned = 0;
+        for (;;) {
+            const char* start = data_ + pos_;
+            size_t left = end_ - pos_ - scanned;
+            const void* nl = left ? std::memchr(start + scanned, '\n', left) : nullptr;
+            if (nl) {
+                size_t len = static_cast<const char*>(nl) - start;
+                out = std::string_view(start, len + (keep_newline ? 1 : 0));
+                pos_ += len + 1;
+                return true;
+            }
+            scanned = end_ - pos_;
+            if (!fill()) break;
+        }
+        if (pos_ == end_) return false;
+        out = std::string_view(data_ + pos_, end_ - pos_);
+        pos_ = end_;
+        return true;
+    }
+
+    // Up to n bytes; false at end of input (for n == 0: true unless at end)
+    bool bytes(size_t n, std::string_view& out) {
+        while (end_ - pos_ < n && fill()) {}
+        if (pos_ == end_ && !fill()) return false;
+        size_t len = n < end_ - pos_ ? n : end_ - pos_;
+        out = std::string_view(data_ + pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+    // The rest of the input as a string ("" at end of input)
+    TValue all() {
+        while (fill()) {}
+        TValue s = new_string(data_ + pos_, end_ - pos_);
+        pos_ = end_;
+        return s;
+    }
+
+    // The numeral io.read("n") would read, NUL-terminated in buf; false
+    // if none starts here. Leading whitespace is skipped.
+    bool numeral(char* buf, size_t size) {
+        for (;;) {
+            while (pos_ < end_ && std::isspace((unsigned char)data_[pos_])) pos_++;
+            if (pos_ < end_ || !fill()) break;
+        }
+        size_t n = 0;
+        bool hex = false;
+        while (n + 1 < size && (pos_ < end_ || fill())) {
+            char c = data_[pos_];
+            bool sign_ok = n == 0 || (buf[n - 1] == (hex ? 'p' : 'e')) || (buf[n - 1] == (hex ? 'P' : 'E'));
+            if ((c == '+' || c == '-') ? sign_ok
+                : (std::isdigit((unsigned char)c) || c == '.' || (hex && std::isxdigit((unsigned char)c))
+                   || (!hex && (c == 'e' || c == 'E')) || (hex && (c == 'p' || c == 'P'))
+                   || ((c == 'x' || c == 'X') && n > 0 && buf[n - 1] == '0' && !hex))) {
+                if (c == 'x' || c == 'X') hex = true;
+                buf[n++] = c;
+                pos_++;
+            } else {
+                break;
+            }
+        }
+        buf[n] = '\0';
+        return n > 0;
+    }
+
+private:
+    // Read another block after the unread bytes; false at end of input.
+    // Moves the unread bytes to the front, invalidating earlier views.
+    bool fill() {
+        if (eof_) return false;
+        if (pos_ > 0) {
+            std::memmove(data_, data_ + pos_, end_ - pos_);
+            end_ -= pos_;
+            pos_ = 0;
+        }
+        if (cap_ - end_ < BLOCK) {
+            size_t cap = cap_ ? cap_ * 2 : BLOCK;
+            while (cap - end_ < BLOCK) cap *= 2;
+            char* data = static_cast<char*>(std::realloc(data_, cap));
+            if (!data) { eof_ = true; return false; }
+            data_ = data;
+            cap_ = cap;
+        }
+        for (;;) {
+#ifdef L2C_POSIX_IO
+            ssize_t n = ::read(fd_, data_ + end_, cap_ - end_);
+            if (n < 0 && errno == EINTR) continue;
+#else
+            long n = fd_ == 0 ? (long)std::fread(data_ + end_, 1, cap_ - end_, stdin) : 0;
+#endif
+            if (n <= 0) {
+                eof_ = true;
+                return false;
+            }
+            end_ += (size_t)n;
+            return true;
+        }
+    }
+
+    int fd_;
+    bool owned_;
+    char* data_ = nullptr;  // read buffer, or the mapped file
+    size_t pos_ = 0;        // first unread byte
+    size_t end_ = 0;        // end of the bytes read
+    size_t cap_ = 0;        // buffer capacity, or mapped size
+    bool mapped_ = false;
+    bool eof_ = false;
+};
+
+// for-in over io.lines([filename [, "l" | "L"]])
+class LinesIter {
+public:
+    LinesIter() : in_(&InputStream::standard_input()) {}
+
+    explicit LinesIter(const char* path, const char* format = "l") : keep_(is_keep(format)) {
+        if (!path) {
+            in_ = &InputStream::standard_input();
+            return;
+        }
+        in_ = InputStream::open(path);
+        owned_ = true;
+        if (!in_) {
+            int err = errno;
+            OutputStream::standard_output().flush();
+            std::fprintf(stderr, "%s: %s\n", path, std::strerror(err));
+            std::abort();
+        }
+    }
+
+    explicit LinesIter(const TValue& path, const char* format = "l")
+        : LinesIter(path.isString() ? static_cast<const char*>(path.toPtr()) : nullptr, format) {}
+
+    ~LinesIter() {
+        if (owned_) delete in_;
+    }
+
+    LinesIter(const LinesIter&) = delete;
+    LinesIter& operator=(const LinesIter&) = delete;
+
+    ALWAYS_INLINE bool next() { return in_->line(view_, keep_); }
+
+    // The current line as a Lua string
+    TValue line() const { return new_string(view_.data(), view_.size()); }
+    std::string_view view() const { return view_; }
+
+private:
+    static bool is_keep(const char* format) {
+        if (format && *format == '*') format++;
+        return format && *format == 'L';
+    }
+
+    InputStream* in_ = nullptr;
+    bool owned_ = false;
+    bool keep_ = false;
+    std::string_view view_;
+};
+
+} // namespace l2c
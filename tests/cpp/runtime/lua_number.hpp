@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * lua_number.hpp - Number <-> string conversion with Lua 5.4 rules
+ *
+ * Numbers are written with std::to_chars as "%.14g" prints them and read
+ * with std::from_chars, so neither depends on the C locale nor allocates.
+ *
+ * str_to_number() accepts what Lua's lua_stringtonumber does:
+ *  - leading and trailing whitespace
+ *  - an optional sign
+ *  - decimal integers (read exactly; out-of-range ones are read as floats)
+ *  - hexadecimal integers ("0xff"), which wrap around modulo 2^64
+ *  - decimal and hexadecimal floats ("1e5", ".5", "0x1.8p3")
+ * and rejects "inf" and "nan". The runtime's numbers are doubles, so an
+ * integer result is returned as its double value.
+ *
+ * float_to_integer() is Lua's exact float -> integer conversion, used by
+ * the bitwise operators and to match floats with boxed integers.
+ */
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+namespace l2c {
+
+// Longest number_to_chars() result, with room for a NUL (LUAI_MAXNUMBER2STR)
+constexpr size_t MAX_NUMBER_CHARS = 32;
+
+// d as Lua's "%.14g" prints it; returns the length written (not NUL-terminated)
+inline size_t number_to_chars(char* buf, double d) {
+    return static_cast<size_t>(
+        std::to_chars(buf, buf + MAX_NUMBER_CHARS, d, std::chars_format::general, 14).ptr - buf);
+}
+
+inline size_t integer_to_chars(char* buf, long long i) {
+    return static_cast<size_t>(std::to_chars(buf, buf + MAX_NUMBER_CHARS, i).ptr - buf);
+}
+
+// The integer equal to d, in out; false if d is not integral or out of
+// the 64-bit range
+inline bool float_to_integer(double d, int64_t& out) {
+    if (!(d >= -0x1p63 && d < 0x1p63)) return false;  // also rejects NaN
+    int64_t i = static_cast<int64_t>(d);
+    if (static_cast<double>(i) != d) return false;
+    out = i;
+    return true;
+}
+
+namespace numeral {
+    inline bool is_lua_space(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    inline int hex_digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+} // namespace numeral
+
+// The number s[0, len) converts to, in out; false if it isn't a numeral
+inline bool str_to_number(const char* s, size_t len, double& out) {
+    const char* p = s;
+    const char* end = s + len;
+    while (p < end && numeral::is_lua_space(*p)) p++;
+    while (end > p && numeral::is_lua_space(end[-1])) end--;
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    if (p == end) return false;
+    if (*p == '-' || *p == '+') return false;  // one sign only
+
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        if (*p == '-' || *p == '+') return false;
+        // All hex digits: an integer, wrapping like Lua's l_str2int
+        uint64_t u = 0;
+        const char* q = p;
+        for (int d; q < end && (d = numeral::hex_digit(*q)) >= 0; q++) u = u * 16 + (uint64_t)d;
+        if (q == end) {
+            int64_t i = static_cast<int64_t>(neg ? 0 - u : u);
+            out = static_cast<double>(i);
+            return true;
+        }
+        double d;
+        auto r = std::from_chars(p, end, d, std::chars_format::hex);
+        if (r.ec != std::errc() || r.ptr != end) return false;
+        out = neg ? -d : d;
+        return true;
+    }
+
+    long long i;
+    auto ri = std::from_chars(p, end, i);
+    if (ri.ec == std::errc() && ri.ptr == end) {
+        out = static_cast<double>(neg ? -i : i);
+        return true;
+    }
+    for (const char* q = p; q < end; q++) {
+        if (*q == 'n' || *q == 'N') return false;  // reject "inf" and "nan"
+    }
+    double d;
+    auto rd = std::from_chars(p, end, d, std::chars_format::general);
+    if (rd.ptr != end) return false;
+    if (rd.ec == std::errc::result_out_of_range) {
+        // from_chars leaves d unset: overflow reads as HUGE_VAL (like
+        // strtod), underflow as 0
+        const char* e = static_cast<const char*>(std::memchr(p, 'e', end - p));
+        if (!e) e = static_cast<const char*>(std::memchr(p, 'E', end - p));
+        d = e && e[1] == '-' ? 0.0 : HUGE_VAL;
+    } else if (rd.ec != std::errc()) {
+        return false;
+    }
+    out = neg ? -d : d;
+    return true;
+}
+
+} // namespace l2c
@@ -0,0 +1,292 @@
+#pragma once
+// ============================================================
+// Parallel numeric for-loops (lua_table runtime)
+//
+// `lua2cpp --parallel` runs the for-loops ParallelAnalyzer finds
+// independent through l2c::parallel_for. The iteration range is cut into
+// chunks, which the calling thread and a pool of worker threads claim
+// from a shared counter until none are left.
+//
+// Iterations must not touch the State of the thread they run on, so the
+// loops chosen allocate nothing and call only pure functions. They store
+// only to t[i] of tables that no iteration reads:
+// - a number overwriting a number in the array part is stored at once;
+// - any other store waits until the join, and is then done in iteration
+//   order.
+// An accumulator (s = s + e) gets one partial sum per chunk. The partial
+// sums are added in chunk order, so the result doesn't depend on the
+// number of threads, but it may differ in the last bits from a serial sum.
+//
+// Anything unexpected abandons the attempt: a metamethod, an error or a
+// non-number addend. The stores already done are undone and parallel_for
+// returns false, so the caller runs the loop serially with full Lua
+// semantics. L2C_THREADS caps the thread count (1: always serial).
+// ============================================================
+
+#include "lua_table.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace l2c {
+namespace par {
+    // Chunks per loop: enough to balance uneven iterations over many
+    // threads, independent of the thread count so that sums are too
+    constexpr uint64_t CHUNKS = 256;
+
+    // Fewer iterations than this run serially: waking the workers and
+    // joining them costs more than such a short loop gains
+    constexpr uint64_t MIN_ITERATIONS = 1024;
+
+    // Workers sleep between loops; the caller works on the loop too
+    class Pool {
+    public:
+        static Pool& instance() {
+            static Pool pool;
+            return pool;
+        }
+
+        unsigned threads() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+        // Held by the one thread running a loop; others run theirs serially
+        std::mutex busy;
+
+        // job(k) on each thread k, 0 being the caller; returns when all are done
+        template <class Job>
+        void run(Job& job) {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                task = [](void* j, unsigned k) { (*static_cast<Job*>(j))(k); };
+                ctx = &job;
+                pending = static_cast<unsigned>(workers.size());
+                generation++;
+            }
+            wake.notify_all();
+            job(0);
+            std::unique_lock<std::mutex> lock(m);
+            done.wait(lock, [this] { return pending == 0; });
+        }
+
+    private:
+        Pool() {
+            unsigned n = std::thread::hardware_concurrency();
+            if (const char* env = std::getenv("L2C_THREADS"))
+                n = static_cast<unsigned>(std::strtoul(env, nullptr, 10));
+            for (unsigned k = 1; k < n; k++) workers.emplace_back([this, k] { work(k); });
+        }
+
+        ~Pool() {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& w : workers) w.join();
+        }
+
+        void work(unsigned k) {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(m);
+            for (;;) {
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                lock.unlock();
+                task(ctx, k);
+                lock.lock();
+                if (--pending == 0) done.notify_one();
+            }
+        }
+
+        std::mutex m;
+        std::condition_variable wake, done;
+        void (*task)(void*, unsigned) = nullptr;
+        void* ctx = nullptr;
+        uint64_t generation = 0;
+        unsigned pending = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+
+    // A store left for after the join
+    struct Store {
+        int64_t   iter;
+        LuaTable* table;
+        TValue    value;
+    };
+
+    // The number a store overwrote
+    struct Undo {
+        TValue* slot;
+        TValue  old;
+    };
+
+    template <class T>
+    bool is_number(const T& v) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            return true;
+        } else {
+            TValue x = v;
+            return x.isNumber() || x.isInteger();
+        }
+    }
+
+    // acc = acc + sum, after the loop
+    template <class T>
+    void accumulate(T& acc, double sum) {
+        if constexpr (std::is_arithmetic_v<T>) acc = static_cast<T>(acc + sum);
+        else acc = TValue::Number(TValue(acc).asNumber() + sum);
+    }
+
+    // Every table written is distinct and unread, and none has a metatable
+    inline bool independent(std::initializer_list<TValue> written,
+                            std::initializer_list<TValue> read) {
+        for (const TValue* w = written.begin(); w != written.end(); w++) {
+            if (!w->isTable() || w->toTable()->metatable) return false;
+            for (const TValue* o = written.begin(); o != w; o++)
+                if (*o == *w) return false;
+            for (const TValue& r : read)
+                if (r == *w) return false;
+        }
+        for (const TValue& r : read)
+            if (r.isTable() && r.toTable()->metatable) return false;
+        return true;
+    }
+
+    // What one thread's iterations see: partial sums and pending stores
+    template <size_t R>
+    class Lane {
+    public:
+        // sum[k] += v, the addend of accumulator k
+        template <class V>
+        ALWAYS_INLINE void add(size_t k, const V& v) {
+            if constexpr (std::is_arithmetic_v<V>) {
+                sum[k] += static_cast<double>(v);
+            } else {
+                TValue x = v;
+                if (UNLIKELY(!x.isNumber() && !x.isInteger())) throw ParallelAbort{};
+                sum[k] += x.asNumber();
+            }
+        }
+
+        // t[i] = v
+        ALWAYS_INLINE void store(const TValue& t, int64_t i, const TValue& v) {
+            if (UNLIKELY(!t.isTable())) throw ParallelAbort{};
+            LuaTable* table = t.toTable();
+            uint64_t slot = static_cast<uint64_t>(i) - 1;
+            // Once an iteration defers a store, its later stores follow it
+            if (LIKELY(iter != deferredIter && v.isNumber() && slot < table->arraySize
+                       && table->array[slot].isNumber())) {
+                undo.push_back({&table->array[slot], table->array[slot]});
+                table->array[slot] = v;
+                return;
+            }
+            deferred.push_back({iter, table, v});
+            deferredIter = iter;
+        }
+
+        std::array<double, R> sum{};
+        int64_t iter = 0;
+        int64_t deferredIter = INT64_MIN;
+        std::vector<Store> deferred;
+        std::vector<Undo> undo;
+    };
+
+    template <size_t R, class Body>
+    struct Job {
+        Job(Body& body, int64_t lo, uint64_t n, unsigned threads)
+            : body(body), lo(lo), n(n), chunk((n + CHUNKS - 1) / CHUNKS),
+              chunks((n + chunk - 1) / chunk), lanes(threads), partials(chunks) {}
+
+        void operator()(unsigned k) {
+            Lane<R>& lane = lanes[k];
+            in_parallel_loop = true;
+            try {
+                for (;;) {
+                    if (failed.load(std::memory_order_relaxed)) break;
+                    uint64_t c = next.fetch_add(1, std::memory_order_relaxed);
+                    if (c >= chunks) break;
+                    lane.sum = {};
+                    for (uint64_t j = c * chunk, end = std::min(n, j + chunk); j < end; j++) {
+                        lane.iter = lo + static_cast<int64_t>(j);
+                        body(lane.iter, lane);
+                    }
+                    partials[c] = lane.sum;
+                }
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+            in_parallel_loop = false;
+        }
+
+        // Put back what the stores done so far overwrote
+        void rollback() {
+            for (Lane<R>& lane : lanes)
+                for (size_t u = lane.undo.size(); u-- > 0; )
+                    *lane.undo[u].slot = lane.undo[u].old;
+        }
+
+        // The stores left for after the join, in iteration order
+        void storeDeferred() {
+            std::vector<Store> all;
+            for (Lane<R>& lane : lanes)
+                all.insert(all.end(), lane.deferred.begin(), lane.deferred.end());
+            std::stable_sort(all.begin(), all.end(),
+                             [](const Store& a, const Store& b) { return a.iter < b.iter; });
+            for (const Store& s : all) s.table->rawset(integer_key(s.iter), s.value);
+        }
+
+        double total(size_t k) const {
+            double sum = 0;
+            for (const std::array<double, R>& p : partials) sum += p[k];
+            return sum;
+        }
+
+        Body& body;
+        int64_t lo;
+        uint64_t n, chunk, chunks;
+        std::atomic<uint64_t> next{0};
+        std::atomic<bool> failed{false};
+        std::vector<Lane<R>> lanes;
+        std::vector<std::array<double, R>> partials;
+    };
+} // namespace par
+
+// for i = lo, hi do body end on all threads: body(i, lane) runs every
+// iteration, storing through lane.store and adding to accumulator k, one
+// of acc, through lane.add(k, e). False, having done nothing, when the
+// loop has to run serially instead, as it does below par::MIN_ITERATIONS.
+template <class Body, class... Acc>
+bool parallel_for(int64_t lo, int64_t hi, std::initializer_list<TValue> written,
+                  std::initializer_list<TValue> read, Body&& body, Acc&... acc) {
+    constexpr size_t R = sizeof...(Acc);
+    if (hi <= lo || in_parallel_loop) return false;
+    if (!(par::is_number(acc) && ...) || !par::independent(written, read)) return false;
+    uint64_t n = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo) + 1;
+    if (n < par::MIN_ITERATIONS || n > (uint64_t(1) << 62)) return false;
+    par::Pool& pool = par::Pool::instance();
+    if (pool.threads() < 2) return false;
+    std::unique_lock<std::mutex> busy(pool.busy, std::try_to_lock);
+    if (!busy) return false;
+
+    par::Job<R, std::remove_reference_t<Body>> job(body, lo, n, pool.threads());
+    pool.run(job);
+    if (job.failed.load()) {
+        job.rollback();
+        return false;
+    }
+    job.storeDeferred();
+    size_t k = 0;
+    (par::accumulate(acc, job.total(k++)), ...);
+    (void)k;
+    return true;
+}
+} // namespace l2c
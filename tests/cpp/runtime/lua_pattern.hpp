@@ -0,0 +1,546 @@
+#pragma once
+
+/**
+ * lua_pattern.hpp - Compiled Lua 5.4 patterns
+ *
+ * A pattern is parsed once into a flat item list: every single-character
+ * class (`%a`, `[^%c]`, `.`) becomes a literal byte or a 256-bit set, so
+ * matching never re-parses the pattern text. Matching follows lstrlib's
+ * backtracking semantics (greedy `*` `+` `?`, lazy `-`, captures, `%b`,
+ * `%f`, back references, anchors).
+ *
+ * Unanchored searches skip ahead to the next possible match start: a
+ * literal prefix is located with memchr + memcmp, a leading set by a
+ * byte scan, and an all-literal pattern needs no matcher at all.
+ *
+ * The transpiler declares string-literal patterns as module-level
+ * `static const l2c::Pattern`; dynamic patterns go through
+ * l2c::lookup_pattern's compile cache.
+ */
+
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace l2c {
+
+[[noreturn]] inline void pattern_error(const char* msg, int arg = 0) {
+    std::fprintf(stderr, "error: ");
+    std::fprintf(stderr, msg, arg);
+    std::fprintf(stderr, "\n");
+    std::abort();
+}
+
+// 256-bit byte set
+struct CharSet {
+    std::array<uint64_t, 4> bits{};
+
+    bool test(unsigned char c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+    void add(unsigned char c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    void addRange(unsigned char lo, unsigned char hi) {
+        for (unsigned c = lo; c <= hi; c++) add(static_cast<unsigned char>(c));
+    }
+    void add(const CharSet& other) {
+        for (size_t i = 0; i < bits.size(); i++) bits[i] |= other.bits[i];
+    }
+    void invert() {
+        for (auto& w : bits) w = ~w;
+    }
+
+    // %a, %d, ... (upper case: complement); false if `cl` is not a class letter
+    static bool classOf(char cl, CharSet& out) {
+        int (*pred)(int) = nullptr;
+        switch (std::tolower(static_cast<unsigned char>(cl))) {
+            case 'a': pred = isalpha; break;
+            case 'c': pred = iscntrl; break;
+            case 'd': pred = isdigit; break;
+            case 'g': pred = isgraph; break;
+            case 'l': pred = islower; break;
+            case 'p': pred = ispunct; break;
+            case 's': pred = isspace; break;
+            case 'u': pred = isupper; break;
+            case 'w': pred = isalnum; break;
+            case 'x': pred = isxdigit; break;
+            default: return false;
+        }
+        out = CharSet{};
+        for (int c = 0; c < 256; c++) {
+            if (pred(c)) out.add(static_cast<unsigned char>(c));
+        }
+        if (std::isupper(static_cast<unsigned char>(cl))) out.invert();
+        return true;
+    }
+};
+
+// Captures and bounds of one match attempt
+struct PatternMatch {
+    static constexpr int MAX_CAPTURES = 32;
+    static constexpr ptrdiff_t CAP_UNFINISHED = -1;
+    static constexpr ptrdiff_t CAP_POSITION = -2;
+
+    struct Capture {
+        const char* init;
+        ptrdiff_t len;
+    };
+
+    const char* src_init = nullptr;
+    const char* src_end = nullptr;
+    const char* start = nullptr;    // whole match [start, end)
+    const char* end = nullptr;
+    int level = 0;                  // number of captures
+    int depth = 0;
+    Capture capture[MAX_CAPTURES];
+
+    // Captures to return: the whole match when the pattern has none
+    int resultCount() const { return level == 0 ? 1 : level; }
+    bool isPosition(int i) const { return level != 0 && capture[i].len == CAP_POSITION; }
+    // 1-based position of a position capture
+    size_t position(int i) const { return static_cast<size_t>(capture[i].init - src_init) + 1; }
+    std::string_view text(int i) const {
+        if (level == 0) return {start, static_cast<size_t>(end - start)};
+        return {capture[i].init, static_cast<size_t>(capture[i].len)};
+    }
+};
+
+class Pattern {
+public:
+    Pattern(const char* p, size_t len) { compile(p, len); }
+
+    // String literals, embedded zeros included
+    template<size_t N>
+    explicit Pattern(const char (&p)[N]) : Pattern(p, N - 1) {}
+
+    Pattern(const Pattern&) = delete;
+    Pattern& operator=(const Pattern&) = delete;
+    Pattern(Pattern&&) = default;
+
+    bool anchored() const { return anchored_; }
+    int captures() const { return ncaptures_; }
+
+    // Matches starting exactly at s; fills m and returns true on success
+    bool matchAt(const char* src, size_t len, const char* s, PatternMatch& m) const {
+        reset(m, src, len);
+        const char* e = literal_ ? matchLiteral(m, s) : doMatch(m, s, 0);
+        if (!e) return false;
+        m.start = s;
+        m.end = e;
+        return true;
+    }
+
+    // First match at or after byte offset init, or false. lastmatch (the end
+    // of the previous match, for gmatch/gsub) rejects an empty match there.
+    bool find(const char* src, size_t len, size_t init, PatternMatch& m,
+              const char* lastmatch = nullptr) const {
+        const char* end = src + len;
+        const char* s = src + init;
+        if (anchored_) return matchAt(src, len, s, m) && m.end != lastmatch;
+        while (s <= end) {
+            s = nextCandidate(s, end);
+            if (!s) return false;
+            if (matchAt(src, len, s, m) && m.end != lastmatch) return true;
+            s++;
+        }
+        return false;
+    }
+
+    // Next position >= s where a match can begin, or nullptr
+    const char* nextCandidate(const char* s, const char* end) const {
+        if (!prefix_.empty()) {
+            const size_t plen = prefix_.size();
+            const char first = prefix_[0];
+            while (static_cast<size_t>(end - s) >= plen) {
+                const char* p = static_cast<const char*>(std::memchr(s, first, static_cast<size_t>(end - s) - plen + 1));
+                if (!p) return nullptr;
+                if (std::memcmp(p + 1, prefix_.data() + 1, plen - 1) == 0) return p;
+                s = p + 1;
+            }
+            return nullptr;
+        }
+        if (first_ >= 0) {
+            const CharSet& set = sets_[first_];
+            while (s < end && !set.test(static_cast<unsigned char>(*s))) s++;
+            return s < end ? s : nullptr;
+        }
+        return s;
+    }
+
+private:
+    enum class Op : uint8_t {
+        Char,             // literal byte a
+        Any,              // .
+        Set,              // sets_[set]
+        OpenCapture,
+        PositionCapture,  // ()
+        CloseCapture,
+        Balance,          // %bab
+        Frontier,         // %f[set]
+        BackRef,          // %1-%9 -> capture a
+        EndAnchor,        // trailing $
+    };
+
+    struct Item {
+        Op op;
+        char quant;       // 0, '?', '*', '+', '-'
+        unsigned char a;
+        unsigned char b;
+        int32_t set;
+    };
+
+    static constexpr int MAX_DEPTH = 200;
+
+    std::vector<Item> items_;
+    std::vector<CharSet> sets_;
+    std::string prefix_;          // bytes every match starts with
+    int32_t first_ = -1;          // set every match starts with, if no prefix
+    int ncaptures_ = 0;
+    bool anchored_ = false;
+    bool literal_ = false;        // pattern is exactly prefix_
+
+    // ---------- Compilation ----------
+
+    int32_t addSet(const CharSet& set) {
+        sets_.push_back(set);
+        return static_cast<int32_t>(sets_.size() - 1);
+    }
+
+    // Parses [set] starting at p[i] == '['; returns the index past ']'
+    size_t parseSet(const char* p, size_t len, size_t i, CharSet& set) {
+        size_t j = i + 1;
+        bool negate = false;
+        if (j < len && p[j] == '^') {
+            negate = true;
+            j++;
+        }
+        // The first byte is literal, even ']'
+        size_t close = j;
+        do {
+            if (close >= len) pattern_error("malformed pattern (missing ']')");
+            if (p[close++] == '%' && close < len) close++;
+        } while (close >= len || p[close] != ']');
+        set = CharSet{};
+        while (j < close) {
+            unsigned char c = static_cast<unsigned char>(p[j]);
+            if (c == '%' && j + 1 < close) {
+                CharSet cls;
+                if (CharSet::classOf(p[j + 1], cls)) set.add(cls);
+                else set.add(static_cast<unsigned char>(p[j + 1]));
+                j += 2;
+            } else if (j + 2 < close && p[j + 1] == '-') {
+                set.addRange(c, static_cast<unsigned char>(p[j + 2]));
+                j += 3;
+            } else {
+                set.add(c);
+                j++;
+            }
+        }
+        if (negate) set.invert();
+        return close + 1;
+    }
+
+    void compile(const char* p, size_t len) {
+        size_t i = 0;
+        if (len > 0 && p[0] == '^') {
+            anchored_ = true;
+            i = 1;
+        }
+        int open[PatternMatch::MAX_CAPTURES];
+        int nopen = 0;
+        bool closed[PatternMatch::MAX_CAPTURES] = {};
+        while (i < len) {
+            char c = p[i];
+            if (c == '(') {
+                if (ncaptures_ >= PatternMatch::MAX_CAPTURES) pattern_error("too many captures");
+                bool position = i + 1 < len && p[i + 1] == ')';
+                if (position) {
+                    closed[ncaptures_] = true;
+                    items_.push_back({Op::PositionCapture, 0, 0, 0, -1});
+                    i += 2;
+                } else {
+                    open[nopen++] = ncaptures_;
+                    items_.push_back({Op::OpenCapture, 0, 0, 0, -1});
+                    i += 1;
+                }
+                ncaptures_++;
+                continue;
+            }
+            if (c == ')') {
+                if (nopen == 0) pattern_error("invalid pattern capture");
+                closed[open[--nopen]] = true;
+                items_.push_back({Op::CloseCapture, 0, 0, 0, -1});
+                i += 1;
+                continue;
+            }
+            if (c == '$' && i + 1 == len) {
+                items_.push_back({Op::EndAnchor, 0, 0, 0, -1});
+                i += 1;
+                continue;
+            }
+            if (c == '%') {
+                if (i + 1 >= len) pattern_error("malformed pattern (ends with '%%')");
+                char d = p[i + 1];
+                if (d == 'b') {
+                    if (i + 3 >= len) pattern_error("malformed pattern (missing arguments to '%%b')");
+                    items_.push_back({Op::Balance, 0, static_cast<unsigned char>(p[i + 2]),
+                                      static_cast<unsigned char>(p[i + 3]), -1});
+                    i += 4;
+                    continue;
+                }
+                if (d == 'f') {
+                    if (i + 2 >= len || p[i + 2] != '[') pattern_error("missing '[' after '%%f' in pattern");
+                    CharSet set;
+                    i = parseSet(p, len, i + 2, set);
+                    items_.push_back({Op::Frontier, 0, 0, 0, addSet(set)});
+                    continue;
+                }
+                if (d >= '0' && d <= '9') {
+                    int l = d - '1';
+                    if (l < 0 || l >= ncaptures_ || !closed[l]) pattern_error("invalid capture index %%%d", l + 1);
+                    items_.push_back({Op::BackRef, 0, static_cast<unsigned char>(l), 0, -1});
+                    i += 2;
+                    continue;
+                }
+            }
+
+            // Single-character class, optionally quantified
+            Item item{Op::Char, 0, 0, 0, -1};
+            if (c == '.') {
+                item.op = Op::Any;
+                i += 1;
+            } else if (c == '%') {
+                CharSet cls;
+                if (CharSet::classOf(p[i + 1], cls)) {
+                    item.op = Op::Set;
+                    item.set = addSet(cls);
+                } else {
+                    item.a = static_cast<unsigned char>(p[i + 1]);
+                }
+                i += 2;
+            } else if (c == '[') {
+                CharSet set;
+                i = parseSet(p, len, i, set);
+                item.op = Op::Set;
+                item.set = addSet(set);
+            } else {
+                item.a = static_cast<unsigned char>(c);
+                i += 1;
+            }
+            if (i < len && (p[i] == '?' || p[i] == '*' || p[i] == '+' || p[i] == '-')) {
+                item.quant = p[i];
+                i += 1;
+            }
+            items_.push_back(item);
+        }
+        if (nopen != 0) pattern_error("unfinished capture");
+        analyze();
+    }
+
+    // Derive the scan filters from the leading items
+    void analyze() {
+        size_t k = 0;
+        auto skipCaptures = [&] {
+            while (k < items_.size() && (items_[k].op == Op::OpenCapture || items_[k].op == Op::CloseCapture
+                                         || items_[k].op == Op::PositionCapture)) {
+                k++;
+            }
+        };
+        skipCaptures();
+        while (k < items_.size() && items_[k].op == Op::Char
+               && (items_[k].quant == 0 || items_[k].quant == '+')) {
+            prefix_.push_back(static_cast<char>(items_[k].a));
+            if (items_[k].quant == '+') break;
+            k++;
+            skipCaptures();
+        }
+        if (prefix_.empty() && k < items_.size() && items_[k].op == Op::Set
+            && (items_[k].quant == 0 || items_[k].quant == '+')) {
+            first_ = items_[k].set;
+        }
+        literal_ = ncaptures_ == 0 && !prefix_.empty() && prefix_.size() == items_.size()
+                   && items_.back().quant == 0;
+    }
+
+    // ---------- Matching ----------
+
+    static void reset(PatternMatch& m, const char* src, size_t len) {
+        m.src_init = src;
+        m.src_end = src + len;
+        m.level = 0;
+        m.depth = 0;
+    }
+
+    const char* matchLiteral(PatternMatch& m, const char* s) const {
+        size_t plen = prefix_.size();
+        if (static_cast<size_t>(m.src_end - s) < plen || std::memcmp(s, prefix_.data(), plen) != 0) return nullptr;
+        return s + plen;
+    }
+
+    bool single(const PatternMatch& m, const char* s, const Item& it) const {
+        if (s >= m.src_end) return false;
+        unsigned char c = static_cast<unsigned char>(*s);
+        switch (it.op) {
+            case Op::Char: return c == it.a;
+            case Op::Any: return true;
+            default: return sets_[it.set].test(c);
+        }
+    }
+
+    const char* maxExpand(PatternMatch& m, const char* s, size_t pc) const {
+        const Item& it = items_[pc];
+        ptrdiff_t n = 0;
+        while (single(m, s + n, it)) n++;
+        while (n >= 0) {
+            const char* r = doMatch(m, s + n, pc + 1);
+            if (r) return r;
+            n--;
+        }
+        return nullptr;
+    }
+
+    const char* minExpand(PatternMatch& m, const char* s, size_t pc) const {
+        const Item& it = items_[pc];
+        for (;;) {
+            const char* r = doMatch(m, s, pc + 1);
+            if (r) return r;
+            if (!single(m, s, it)) return nullptr;
+            s++;
+        }
+    }
+
+    const char* startCapture(PatternMatch& m, const char* s, size_t pc, ptrdiff_t what) const {
+        m.capture[m.level].init = s;
+        m.capture[m.level].len = what;
+        m.level++;
+        const char* r = doMatch(m, s, pc + 1);
+        if (!r) m.level--;
+        return r;
+    }
+
+    const char* endCapture(PatternMatch& m, const char* s, size_t pc) const {
+        int l = m.level - 1;
+        while (l >= 0 && m.capture[l].len != PatternMatch::CAP_UNFINISHED) l--;
+        m.capture[l].len = s - m.capture[l].init;
+        const char* r = doMatch(m, s, pc + 1);
+        if (!r) m.capture[l].len = PatternMatch::CAP_UNFINISHED;
+        return r;
+    }
+
+    const char* doMatch(PatternMatch& m, const char* s, size_t pc) const {
+        if (++m.depth > MAX_DEPTH) pattern_error("pattern too complex");
+        const char* r = nullptr;
+        for (;;) {
+            if (pc == items_.size()) {
+                r = s;
+                break;
+            }
+            const Item& it = items_[pc];
+            switch (it.op) {
+                case Op::OpenCapture:
+                    r = startCapture(m, s, pc, PatternMatch::CAP_UNFINISHED);
+                    goto done;
+                case Op::PositionCapture:
+                    r = startCapture(m, s, pc, PatternMatch::CAP_POSITION);
+                    goto done;
+                case Op::CloseCapture:
+                    r = endCapture(m, s, pc);
+                    goto done;
+                case Op::EndAnchor:
+                    r = s == m.src_end ? s : nullptr;
+                    goto done;
+                case Op::Balance: {
+                    if (s >= m.src_end || static_cast<unsigned char>(*s) != it.a) goto done;
+                    int cont = 1;
+                    const char* q = s + 1;
+                    for (; q < m.src_end; q++) {
+                        unsigned char c = static_cast<unsigned char>(*q);
+                        if (c == it.b) {
+                            if (--cont == 0) break;
+                        } else if (c == it.a) {
+                            cont++;
+                        }
+                    }
+                    if (q >= m.src_end) goto done;
+                    s = q + 1;
+                    pc++;
+                    continue;
+                }
+                case Op::Frontier: {
+                    const CharSet& set = sets_[it.set];
+                    unsigned char prev = s == m.src_init ? 0 : static_cast<unsigned char>(s[-1]);
+                    unsigned char cur = s < m.src_end ? static_cast<unsigned char>(*s) : 0;
+                    if (set.test(prev) || !set.test(cur)) goto done;
+                    pc++;
+                    continue;
+                }
+                case Op::BackRef: {
+                    const PatternMatch::Capture& cap = m.capture[it.a];
+                    size_t n = static_cast<size_t>(cap.len);
+                    if (cap.len < 0 || static_cast<size_t>(m.src_end - s) < n
+                        || std::memcmp(cap.init, s, n) != 0) {
+                        goto done;
+                    }
+                    s += n;
+                    pc++;
+                    continue;
+                }
+                default:
+                    break;
+            }
+            // Single-character class
+            switch (it.quant) {
+                case '?':
+                    if (single(m, s, it)) {
+                        r = doMatch(m, s + 1, pc + 1);
+                        if (r) goto done;
+                    }
+                    pc++;
+                    continue;
+                case '+':
+                    r = single(m, s, it) ? maxExpand(m, s + 1, pc) : nullptr;
+                    goto done;
+                case '*':
+                    r = maxExpand(m, s, pc);
+                    goto done;
+                case '-':
+                    r = minExpand(m, s, pc);
+                    goto done;
+                default:
+                    if (!single(m, s, it)) goto done;
+                    s++;
+                    pc++;
+                    continue;
+            }
+        }
+    done:
+        m.depth--;
+        return r;
+    }
+};
+
+// Compiled form of a runtime pattern string. Patterns are compiled once per
+// thread and kept (up to a bound); past it, the pattern is compiled into
+// `scratch`.
+inline const Pattern& lookup_pattern(const char* p, size_t len, std::optional<Pattern>& scratch) {
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+    static constexpr size_t MAX_CACHED = 256;
+    static thread_local std::unordered_map<std::string, Pattern, Hash, std::equal_to<>> cache;
+    std::string_view key(p, len);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    if (cache.size() < MAX_CACHED) return cache.emplace(std::string(key), Pattern(p, len)).first->second;
+    return scratch.emplace(p, len);
+}
+
+} // namespace l2c
@@ -0,0 +1,277 @@
+#pragma once
+
+/**
+ * lua_profile.hpp - Type feedback for profile-guided transpilation
+ *
+ * `lua2cpp --instrument` starts every named function with
+ *
+ *     static l2c::profile::Site& _l2c_prof = l2c::profile::site("mod", "f", 12, 2);
+ *     _l2c_prof.enter(a, b);
+ *
+ * and wraps its single-value returns in _l2c_prof.ret(...). A site counts
+ * calls and ORs the Lua type of every argument and returned value into a
+ * mask. At exit the sites are written as JSON to $L2C_PROFILE_OUT
+ * (default l2c.profile.json), the file `lua2cpp --profile` reads back.
+ *
+ * The guards at the end are what profile-guided code uses: a function
+ * whose hot parameters were only ever numbers re-enters itself with
+ * those arguments unboxed when every one of them holds a number, and
+ * runs its generic instantiation otherwise.
+ *
+ * The guarded operations after them need no profile: loop arithmetic
+ * the transpiler can't prove numeric (HotPathAnalyzer) calls
+ * l2c::guarded_add(a, b) and friends, which do the double operation
+ * inline when both operands hold floats and call the generic TValue
+ * operator out of line otherwise; l2c::guarded_get(t, k) reads an
+ * array slot of a table without a metatable the same way.
+ */
+
+#include "lua_table.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace l2c {
+namespace profile {
+
+    enum TypeBit : uint32_t {
+        NIL_BIT      = 1u << 0,
+        BOOLEAN_BIT  = 1u << 1,
+        NUMBER_BIT   = 1u << 2,
+        STRING_BIT   = 1u << 3,
+        TABLE_BIT    = 1u << 4,
+        FUNCTION_BIT = 1u << 5,
+        OTHER_BIT    = 1u << 6,
+    };
+    inline constexpr const char* TYPE_NAMES[] = {
+        "nil", "boolean", "number", "string", "table", "function", "other",
+    };
+    constexpr uint32_t TYPE_COUNT = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+
+    // Arguments past this many are counted but not typed
+    constexpr uint32_t MAX_PARAMS = 16;
+
+    inline uint32_t value_bit(TValue v) {
+        if (v.isNil()) return NIL_BIT;
+        if (v.isNumber() || v.isInt64()) return NUMBER_BIT;
+        if (v.bits == TValue::TAG_TRUE || v.bits == TValue::TAG_FALSE) return BOOLEAN_BIT;
+        if (v.isString()) return STRING_BIT;
+        if (v.isTable()) return TABLE_BIT;
+        if (v.isFunction()) return FUNCTION_BIT;
+        return OTHER_BIT;
+    }
+
+    // The Lua type a C++ argument or return value stands for; never boxes
+    // a callable just to look at it
+    template<typename T>
+    ALWAYS_INLINE uint32_t type_bit(const T& v) {
+        using D = std::decay_t<T>;
+        if constexpr (std::is_same_v<D, bool>) return BOOLEAN_BIT;
+        else if constexpr (std::is_arithmetic_v<D>) return NUMBER_BIT;
+        else if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) return STRING_BIT;
+        else if constexpr (std::is_same_v<D, LuaTable*>) return TABLE_BIT;
+        else if constexpr (std::is_same_v<D, TValue>) return value_bit(v);
+        else if constexpr (std::is_same_v<D, TableSlotProxy>) return value_bit(static_cast<TValue>(v));
+        else if constexpr (is_lua_callable<D>()) return FUNCTION_BIT;
+        else return OTHER_BIT;
+    }
+
+    struct Site {
+        const char* module;
+        const char* name;
+        int line;
+        uint32_t nparams;
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint32_t> params[MAX_PARAMS] = {};
+        std::atomic<uint32_t> returns{0};
+        Site* next = nullptr;
+
+        Site(const char* m, const char* n, int l, uint32_t np)
+            : module(m), name(n), line(l), nparams(np < MAX_PARAMS ? np : MAX_PARAMS) {}
+
+        template<typename... A>
+        ALWAYS_INLINE void enter(const A&... args) {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            uint32_t i = 0;
+            ((i < MAX_PARAMS ? observe(params[i], type_bit(args)) : void(), ++i), ...);
+        }
+
+        // Record a returned value and pass it through
+        template<typename T>
+        ALWAYS_INLINE T&& ret(T&& v) {
+            observe(returns, type_bit(v));
+            return std::forward<T>(v);
+        }
+
+    private:
+        // Skip the read-modify-write once the type has been seen
+        static ALWAYS_INLINE void observe(std::atomic<uint32_t>& mask, uint32_t bit) {
+            if (!(mask.load(std::memory_order_relaxed) & bit)) mask.fetch_or(bit, std::memory_order_relaxed);
+        }
+    };
+
+    // Sites live until exit; a template function's instantiations share one
+    struct Registry {
+        std::mutex mu;
+        Site* head = nullptr;
+    };
+
+    inline Registry& registry() {
+        static Registry* r = new Registry;
+        return *r;
+    }
+
+    inline void write_mask(FILE* out, uint32_t mask) {
+        std::fputc('[', out);
+        const char* sep = "";
+        for (uint32_t t = 0; t < TYPE_COUNT; t++) {
+            if (mask & (1u << t)) {
+                std::fprintf(out, "%s\"%s\"", sep, TYPE_NAMES[t]);
+                sep = ", ";
+            }
+        }
+        std::fputc(']', out);
+    }
+
+    // Write every site that was called; returns false if path can't be opened
+    inline bool write(const char* path) {
+        FILE* out = std::fopen(path, "w");
+        if (!out) return false;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        std::fprintf(out, "{\"version\": 1, \"functions\": [");
+        const char* sep = "";
+        for (const Site* s = r.head; s; s = s->next) {
+            uint64_t calls = s->calls.load(std::memory_order_relaxed);
+            if (calls == 0) continue;
+            std::fprintf(out, "%s\n  {\"module\": \"%s\", \"name\": \"%s\", \"line\": %d, \"calls\": %llu, \"params\": [",
+                         sep, s->module, s->name, s->line, (unsigned long long)calls);
+            for (uint32_t i = 0; i < s->nparams; i++) {
+                if (i) std::fprintf(out, ", ");
+                write_mask(out, s->params[i].load(std::memory_order_relaxed));
+            }
+            std::fprintf(out, "], \"returns\": ");
+            write_mask(out, s->returns.load(std::memory_order_relaxed));
+            std::fputc('}', out);
+            sep = ",";
+        }
+        std::fprintf(out, "\n]}\n");
+        std::fclose(out);
+        return true;
+    }
+
+    inline void write_at_exit() {
+        const char* path = std::getenv("L2C_PROFILE_OUT");
+        if (!path || !*path) path = "l2c.profile.json";
+        if (!write(path)) std::fprintf(stderr, "l2c: cannot write profile %s\n", path);
+    }
+
+    // The site for one function definition, created on its first call
+    inline Site& site(const char* module, const char* name, int line, uint32_t nparams) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        for (Site* s = r.head; s; s = s->next) {
+            if (s->line == line && !std::strcmp(s->name, name) && !std::strcmp(s->module, module)) return *s;
+        }
+        if (!r.head) std::atexit(write_at_exit);
+        Site* s = new Site(module, name, line, nparams);
+        s->next = r.head;
+        r.head = s;
+        return *s;
+    }
+
+} // namespace profile
+
+    // ============================================================
+    // Guards for profile-guided specialization
+    // ============================================================
+
+    // A parameter type worth guarding: one that may hold a number at run
+    // time without being one statically
+    template<typename T>
+    inline constexpr bool is_boxed_v = std::is_same_v<std::decay_t<T>, TValue>
+                                       || std::is_same_v<std::decay_t<T>, TableSlotProxy>;
+
+    template<typename T>
+    ALWAYS_INLINE bool holds_number(const T& v) {
+        using D = std::decay_t<T>;
+        if constexpr (std::is_same_v<D, bool>) return false;
+        else if constexpr (std::is_arithmetic_v<D>) return true;
+        else if constexpr (is_boxed_v<D>) {
+            TValue t = as_value(v);
+            return t.isNumber() || t.isInt64();
+        } else return false;
+    }
+
+    // Only valid once holds_number(v) is true
+    template<typename T>
+    ALWAYS_INLINE double unbox_number(const T& v) {
+        if constexpr (std::is_arithmetic_v<std::decay_t<T>>) {
+            return static_cast<double>(v);
+        } else {
+            TValue t = as_value(v);
+            return t.isNumber() ? t.toNumber() : (double)t.toInt64();
+        }
+    }
+
+    // ============================================================
+    // Guarded fast paths for hot operations
+    // ============================================================
+
+    // The generic operators, out of line so the hot path stays small
+    NOINLINE inline TValue guarded_arith_slow(TValue a, TValue b, TMS op) {
+        switch (op) {
+            case TM_ADD: return a + b;
+            case TM_SUB: return a - b;
+            case TM_MUL: return a * b;
+            default:     return a / b;
+        }
+    }
+
+    NOINLINE inline TValue guarded_get_slow(TValue t, TValue key) {
+        return t.isTable() ? gettable(t.toTable(), key) : TValue::Nil();
+    }
+
+    // a op b as the generic TValue operator would compute it. Only two
+    // boxed operands are guarded: a double one already takes the
+    // operators' double overloads, so the call is the plain expression.
+#define L2C_GUARDED_ARITH(NAME, OP, TM)                                                  \
+    template<typename A, typename B>                                                     \
+    ALWAYS_INLINE auto NAME(const A& a, const B& b) {                                    \
+        if constexpr (is_boxed_v<A> && is_boxed_v<B>) {                                 \
+            TValue x = as_value(a), y = as_value(b);                                     \
+            if (LIKELY(x.isNumber() && y.isNumber())) return TValue::Number(x.toNumber() OP y.toNumber()); \
+            return guarded_arith_slow(x, y, TM);                                         \
+        } else {                                                                         \
+            return a OP b;                                                               \
+        }                                                                                \
+    }
+    L2C_GUARDED_ARITH(guarded_add, +, TM_ADD)
+    L2C_GUARDED_ARITH(guarded_sub, -, TM_SUB)
+    L2C_GUARDED_ARITH(guarded_mul, *, TM_MUL)
+    L2C_GUARDED_ARITH(guarded_div, /, TM_DIV)
+#undef L2C_GUARDED_ARITH
+
+    // t[k] read: the array slot itself for an in-range integer key of a
+    // table without a metatable (so no __index can apply), else the
+    // generic lookup
+    template<typename T, typename K>
+    ALWAYS_INLINE TValue guarded_get(const T& t, const K& k) {
+        TValue v = as_value(t);
+        TValue key;
+        if constexpr (std::is_integral_v<K>) key = integer_key(k);
+        else if constexpr (std::is_floating_point_v<K>) key = ((double)(int32_t)k == k) ? TValue::Integer((int32_t)k) : TValue::Number(k);
+        else key = as_value(k);
+        if (LIKELY(v.isTable() && key.isInteger())) {
+            LuaTable* h = v.toTable();
+            uint32_t i = (uint32_t)(key.toInteger() - 1);
+            if (LIKELY(i < h->arraySize && !h->metatable)) return h->array[i];
+        }
+        return guarded_get_slow(v, key);
+    }
+
+} // namespace l2c
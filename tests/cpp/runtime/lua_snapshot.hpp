@@ -0,0 +1,383 @@
+#pragma once
+
+/**
+ * lua_snapshot.hpp - Table graphs saved to a file and mapped back in
+ *
+ * save_snapshot writes a table and everything reachable from it (nested
+ * and shared tables, cycles, strings, boxed integers) in the layout the
+ * runtime uses in memory: each array part as its TValues, each hash part
+ * as a HashPart's ctrl groups, key hashes and slots, built when saving.
+ * load_snapshot maps the file and points the tables at those parts, so
+ * loading costs one table header per table and one pass rewriting the
+ * pointer-tagged values; no key is hashed or inserted.
+ *
+ * In the file a table value holds the table's index, and a string or
+ * boxed integer value the offset of its data. Strings are stored once
+ * each, as LuaStrings with their hash, so they compare and hash by
+ * content like any other string. Parts start on a cache line.
+ *
+ * The mapping is private and writable: a page is copied by the kernel
+ * when a script stores to it, and the pages nothing stores to (after
+ * loading, those holding no pointers) stay shared with the page cache.
+ * A part that grows moves to the table pool like any other. The
+ * MAPPED_* table flags mark the parts still in the mapping, which is
+ * never unmapped. Without mmap the file is read into memory instead.
+ *
+ * Not saved: metatables, and functions, threads and userdata, which
+ * make save_snapshot fail. A hash part is rebuilt on loading when the
+ * writer's group width differs or it has table keys (which hash by
+ * address).
+ */
+
+#include "lua_table.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define L2C_SNAPSHOT_MMAP 1
+#endif
+
+namespace l2c {
+namespace snapshot {
+    constexpr char     MAGIC[8]   = {'L', '2', 'C', 'S', 'N', 'A', 'P', 0};
+    constexpr uint32_t VERSION    = 1;
+    constexpr uint32_t ORDER_MARK = 0x01020304;  // reads differently on the other byte order
+    constexpr size_t   PART_ALIGN = 64;
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t groupWidth;  // HashGroup::WIDTH of the writer
+        uint32_t tableCount;  // table 0 is the root
+        uint64_t size;        // of the whole file
+    };
+
+    struct TableRecord {
+        uint64_t array;       // offset of arraySize TValues, 0 = no array part
+        uint64_t hash;        // offset of the hash part's ctrl groups, hashes and slots, 0 = none
+        uint32_t arraySize;
+        uint32_t arrayCount;
+        uint32_t capacity;
+        uint32_t count;
+        uint8_t  arrayKind;
+        uint8_t  rehash;      // keys hashed by address: rebuild the part
+        uint8_t  pad[6];
+    };
+
+    // Bytes of a hash part laid out for group width w
+    constexpr size_t hashBytes(uint32_t cap, uint32_t w) {
+        return (cap < w ? 1 : cap / w) * w + cap * (sizeof(uint32_t) + sizeof(HashSlot));
+    }
+
+    inline size_t alignUp(size_t n, size_t a) { return (n + a - 1) & ~(a - 1); }
+
+    class Writer {
+    public:
+        bool save(LuaTable* root, const char* path) {
+            note(TValue::Table(root));
+            for (size_t i = 0; i < tables.size(); i++)
+                if (!collect(i)) return false;
+
+            // Header, records, strings, then each table's parts
+            stringBase = alignUp(sizeof(Header) + records.size() * sizeof(TableRecord), 8);
+            size_t size = stringBase + strings.size();
+            for (TableRecord& r : records) {
+                if (r.arraySize) {
+                    r.array = alignUp(size, PART_ALIGN);
+                    size = r.array + r.arraySize * sizeof(TValue);
+                }
+                if (r.capacity) {
+                    r.hash = alignUp(size, PART_ALIGN);
+                    size = r.hash + HashPart::bytesFor(r.capacity);
+                }
+            }
+            std::vector<char> out(size);
+            for (size_t i = 0; i < tables.size(); i++) writeParts(i, out.data());
+
+            Header h{};
+            std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+            h.version    = VERSION;
+            h.byteOrder  = ORDER_MARK;
+            h.groupWidth = HashGroup::WIDTH;
+            h.tableCount = (uint32_t)tables.size();
+            h.size       = size;
+            std::memcpy(out.data(), &h, sizeof(h));
+            std::memcpy(out.data() + sizeof(h), records.data(), records.size() * sizeof(TableRecord));
+            std::memcpy(out.data() + stringBase, strings.data(), strings.size());
+
+            FILE* f = std::fopen(path, "wb");
+            if (!f) return false;
+            bool ok = std::fwrite(out.data(), 1, size, f) == size;
+            return std::fclose(f) == 0 && ok;
+        }
+
+    private:
+        std::vector<LuaTable*>   tables;
+        std::vector<TableRecord> records;  // parallel to tables
+        std::vector<char>        strings;  // the LuaStrings and boxed integers, file order
+        size_t                   stringBase = 0;
+        // Table -> index, string or boxed integer -> data offset in
+        // strings. Keyed as tables are, so each string content is stored
+        // once; not a collected table, and only ever holds these keys.
+        LuaTable                 refs;
+
+        // A LuaString block for len bytes at s; the data offset in strings
+        size_t block(const void* s, uint32_t len, uint32_t hash) {
+            size_t at = strings.size();
+            strings.resize(alignUp(at + LuaString::allocSize(len), 8));
+            LuaString header;
+            header.hash = hash;
+            header.len  = len;
+            std::memcpy(&strings[at], &header, offsetof(LuaString, data));
+            std::memcpy(&strings[at + offsetof(LuaString, data)], s, len);
+            return at + offsetof(LuaString, data);
+        }
+
+        // Record what v refers to; false for values a snapshot can't hold
+        bool note(TValue v) {
+            if (v.isTable() || v.isString() || v.isBoxedInteger()) {
+                if (!refs.rawget(v).isNil()) return true;
+                size_t ref;
+                if (v.isTable()) {
+                    ref = tables.size();
+                    tables.push_back(v.toTable());
+                    records.push_back(TableRecord{});
+                } else if (v.isString()) {
+                    ref = block(v.toPtr(), (uint32_t)str_len(v), hashTValue(v));
+                } else {
+                    ref = block(v.toPtr(), sizeof(int64_t), 0);
+                }
+                refs.rawset(v, TValue::Number((double)ref));
+                return true;
+            }
+            return v.isNumber() || v.isInteger() || v.isNil() ||
+                   v.bits == TValue::TAG_TRUE || v.bits == TValue::TAG_FALSE;
+        }
+
+        // Note what table i refers to and size its parts: the array part
+        // up to its last value, the other entries in a hash part of their own
+        bool collect(size_t i) {
+            const LuaTable* t = tables[i];
+            for (uint32_t k = 0; k < t->arraySize; k++)
+                if (!note(t->array[k])) return false;
+            uint32_t count = 0;
+            bool tableKeys = false;
+            TValue key, val;
+            for (uint32_t pos = t->arraySize; t->nextAt(pos, key, val); count++) {
+                if (!note(key) || !note(val)) return false;
+                tableKeys |= key.isTable();
+            }
+            // note() may have added records
+            TableRecord& r = records[i];
+            r.arraySize = t->arraySize;
+            while (r.arraySize && t->array[r.arraySize - 1].isNil()) r.arraySize--;
+            r.arrayCount = t->arrayCount;
+            r.arrayKind  = t->arrayKind;
+            r.rehash     = tableKeys;
+            r.count      = count;
+            if (count) r.capacity = HashPart::capacityFor(count);
+            return true;
+        }
+
+        uint64_t encode(TValue v) const {
+            if (v.isTable()) return TValue::TAG_TABLE | (uint64_t)refs.rawget(v).toNumber();
+            if (v.isString())
+                return TValue::TAG_LSTRING | (stringBase + (uint64_t)refs.rawget(v).toNumber());
+            if (v.isBoxedInteger())
+                return TValue::TAG_BIGINT | (stringBase + (uint64_t)refs.rawget(v).toNumber());
+            return v.bits;
+        }
+
+        void writeParts(size_t i, char* out) {
+            const LuaTable* t = tables[i];
+            const TableRecord& r = records[i];
+            uint64_t* array = reinterpret_cast<uint64_t*>(out + r.array);
+            for (uint32_t k = 0; k < r.arraySize; k++) array[k] = encode(t->array[k]);
+            if (!r.capacity) return;
+
+            // Build the part as the runtime would, then copy it out
+            HashPart part;
+            part.init(r.capacity);
+            TValue key, val;
+            for (uint32_t pos = t->arraySize; t->nextAt(pos, key, val);)
+                *part.insertNew(key, hashTValue(key)) = val;
+            std::memcpy(out + r.hash, part.groups, part.ctrlBytes());
+            uint64_t* slots = reinterpret_cast<uint64_t*>(out + r.hash + part.ctrlBytes());
+            for (uint32_t k = 0; k < r.capacity; k++) {
+                bool live = part.ctrlAt(k) >= 0;
+                slots[2 * k]     = live ? encode(part.slots[k].key) : TValue::TAG_NIL;
+                slots[2 * k + 1] = live ? encode(part.slots[k].val) : TValue::TAG_NIL;
+            }
+            part.destroy();
+        }
+    };
+
+    // The file's bytes, mapped or read; kept until exit
+    inline char* map(const char* path, size_t& size) {
+#if defined(L2C_SNAPSHOT_MMAP)
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            size = (size_t)st.st_size;
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (p != MAP_FAILED) return static_cast<char*>(p);
+#endif
+        FILE* f = std::fopen(path, "rb");
+        if (!f) return nullptr;
+        char* data = nullptr;
+        if (std::fseek(f, 0, SEEK_END) == 0) {
+            long n = std::ftell(f);
+            if (n > 0 && std::fseek(f, 0, SEEK_SET) == 0) {
+                size = (size_t)n;
+                data = static_cast<char*>(::operator new(size, std::align_val_t(PART_ALIGN)));
+                if (std::fread(data, 1, size, f) != size) {
+                    ::operator delete(data, std::align_val_t(PART_ALIGN));
+                    data = nullptr;
+                }
+            }
+        }
+        std::fclose(f);
+        return data;
+    }
+
+    inline void unmap(char* data, size_t size) {
+#if defined(L2C_SNAPSHOT_MMAP)
+        if (munmap(data, size) == 0) return;
+#endif
+        ::operator delete(data, std::align_val_t(PART_ALIGN));
+    }
+
+    inline bool validRecord(const TableRecord& r, uint32_t width, uint64_t size) {
+        if (r.array && (r.array % PART_ALIGN || r.arrayCount > r.arraySize ||
+                        r.array + (uint64_t)r.arraySize * sizeof(TValue) > size))
+            return false;
+        if (!r.hash) return true;
+        return r.hash % PART_ALIGN == 0 && r.capacity >= HashPart::MIN_CAPACITY &&
+               (r.capacity & (r.capacity - 1)) == 0 && r.count <= r.capacity &&
+               r.hash + hashBytes(r.capacity, width) <= size;
+    }
+
+    // Point a pointer-tagged value from the file at its table or data;
+    // other values are left alone, so their pages aren't written
+    ALWAYS_INLINE bool relocate(TValue& v, char* base, uint64_t lo, uint64_t size,
+                                LuaTable* const* tables, uint32_t n) {
+        if (v.isTable()) {
+            uint64_t i = v.bits & TValue::POINTER_MASK;
+            if (i >= n) return false;
+            v = TValue::Table(tables[i]);
+        } else if (v.isString() || v.isBoxedInteger()) {
+            uint64_t at = v.bits & TValue::POINTER_MASK;
+            if (!v.isSizedString() && !v.isBoxedInteger()) return false;
+            if (at < lo || at >= size) return false;
+            v = TValue((v.bits & TValue::TAG_MASK) | (reinterpret_cast<uint64_t>(base + at) & TValue::POINTER_MASK));
+        }
+        return true;
+    }
+} // namespace snapshot
+
+    // Write root and the tables, strings and numbers it reaches to path;
+    // false if it reaches a function, thread or userdata, or on I/O errors
+    inline bool save_snapshot(const TValue& root, const char* path) {
+        if (!root.isTable()) return false;
+        return snapshot::Writer().save(root.toTable(), path);
+    }
+
+    // The root table of a snapshot file, or nil if it can't be read
+    inline TValue load_snapshot(const char* path) {
+        using namespace snapshot;
+        size_t size = 0;
+        char* base = map(path, size);
+        if (!base) return TValue::Nil();
+        Header h;
+        if (size < sizeof(Header)) { unmap(base, size); return TValue::Nil(); }
+        std::memcpy(&h, base, sizeof(h));
+        uint64_t tablesEnd = sizeof(Header) + (uint64_t)h.tableCount * sizeof(TableRecord);
+        if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+            h.byteOrder != ORDER_MARK || h.size != size || h.tableCount == 0 ||
+            h.groupWidth < HashPart::MIN_CAPACITY || (h.groupWidth & (h.groupWidth - 1)) ||
+            tablesEnd > size) {
+            unmap(base, size);
+            return TValue::Nil();
+        }
+        const TableRecord* records = reinterpret_cast<const TableRecord*>(base + sizeof(Header));
+        for (uint32_t i = 0; i < h.tableCount; i++) {
+            if (!validRecord(records[i], h.groupWidth, size)) { unmap(base, size); return TValue::Nil(); }
+        }
+
+        // No collection while the new tables are reachable only from here
+        LuaGC& gc = LuaGC::instance();
+        bool collecting = gc.isRunning();
+        if (collecting) gc.stop();
+        std::vector<LuaTable*> tables(h.tableCount);
+        for (LuaTable*& t : tables) t = LuaTable::create();
+
+        bool ok = true;
+        for (uint32_t i = 0; i < h.tableCount && ok; i++) {
+            const TableRecord& r = records[i];
+            if (r.array && r.arrayKind != ARRAY_NUMBER) {
+                TValue* a = reinterpret_cast<TValue*>(base + r.array);
+                for (uint32_t k = 0; k < r.arraySize && ok; k++)
+                    ok = relocate(a[k], base, tablesEnd, size, tables.data(), h.tableCount);
+            }
+            if (r.hash) {
+                char* ctrl = base + r.hash;
+                HashSlot* slots = reinterpret_cast<HashSlot*>(ctrl + hashBytes(r.capacity, h.groupWidth)
+                                                              - r.capacity * sizeof(HashSlot));
+                for (uint32_t k = 0; k < r.capacity && ok; k++) {
+                    if (static_cast<int8_t>(ctrl[k]) < 0) continue;
+                    ok = relocate(slots[k].key, base, tablesEnd, size, tables.data(), h.tableCount) &&
+                         relocate(slots[k].val, base, tablesEnd, size, tables.data(), h.tableCount);
+                }
+            }
+        }
+        if (!ok) {
+            // The tables are still empty: the collector takes them
+            if (collecting) gc.restart();
+            unmap(base, size);
+            return TValue::Nil();
+        }
+
+        for (uint32_t i = 0; i < h.tableCount; i++) {
+            const TableRecord& r = records[i];
+            LuaTable* t = tables[i];
+            t->arrayKind = r.arrayKind == ARRAY_NUMBER ? ARRAY_NUMBER : ARRAY_GENERIC;
+            if (r.array) {
+                t->array      = reinterpret_cast<TValue*>(base + r.array);
+                t->arraySize  = r.arraySize;
+                t->arrayCount = r.arrayCount;
+                t->flags     |= LuaTable::MAPPED_ARRAY;
+            }
+            if (!r.hash) continue;
+            char* ctrl = base + r.hash;
+            if (h.groupWidth == HashGroup::WIDTH && !r.rehash) {
+                t->hash.adopt(r.capacity, r.count, ctrl);
+                t->flags |= LuaTable::MAPPED_HASH;
+                continue;
+            }
+            // Laid out for other groups, or keyed by address: insert the entries
+            uint32_t groups = r.capacity < h.groupWidth ? 1 : r.capacity / h.groupWidth;
+            const uint32_t* hashes = reinterpret_cast<const uint32_t*>(ctrl + groups * h.groupWidth);
+            const HashSlot* slots  = reinterpret_cast<const HashSlot*>(hashes + r.capacity);
+            t->hash.init(r.capacity);
+            for (uint32_t k = 0; k < r.capacity; k++) {
+                if (static_cast<int8_t>(ctrl[k]) < 0) continue;
+                uint32_t hash = r.rehash ? hashTValue(slots[k].key) : hashes[k];
+                *t->hash.insertNew(slots[k].key, hash) = slots[k].val;
+            }
+        }
+        if (collecting) gc.restart();
+        return TValue::Table(tables[0]);
+    }
+} // namespace l2c
@@ -13,8 +13,11 @@
  *  - Branchless fast paths for integer-in-array case
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include <cassert>
 #include <cmath>
 #include <new>
@@ -22,13 +25,31 @@
 #include <string>
 #include <functional>
 #include <optional>
+#include <span>
+#include <vector>
+#include <csetjmp>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "lua_number.hpp"
 
 // ============================================================
 // Platform / SIMD helpers
 // ============================================================
-#if defined(__SSE2__)
+// Swiss table probing: SSE2 on x86-64, NEON on aarch64, a scalar loop
+// elsewhere. -DL2C_WIDE_GROUPS with AVX2 doubles the groups to 32 slots,
+// which shortens probe sequences in big tables.
+#if defined(L2C_WIDE_GROUPS) && defined(__AVX2__)
+#  include <immintrin.h>
+#  define LUATABLE_SIMD 1
+#  define LUATABLE_AVX2 1
+#elif defined(__SSE2__)
 #  include <immintrin.h>
 #  define LUATABLE_SIMD 1
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define LUATABLE_NEON 1
 #endif
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -43,6 +64,121 @@
 #  define NOINLINE
 #endif
 
+// ============================================================
+// Runtime statistics — build with -DL2C_STATS
+//
+// Per-thread event counters on the table, string and call hot paths.
+// Without L2C_STATS every L2C_STAT* macro expands to nothing. The
+// summed report, with the allocator's per-size-class counts, is printed
+// to stderr at exit (l2c::dump_stats) and on collectgarbage("stats");
+// collectgarbage("resetstats") clears the counters.
+// ============================================================
+#ifdef L2C_STATS
+#  include <atomic>
+#  include <mutex>
+
+namespace l2c {
+    enum StatId : uint32_t {
+        STAT_ARRAY_GET, STAT_HASH_GET, STAT_SHAPE_GET,
+        STAT_ARRAY_SET, STAT_HASH_SET,
+        STAT_HASH_LOOKUP,                      // hash part probes, see probeGroups
+        STAT_TABLE_CREATE, STAT_ARRAY_RESIZE, STAT_HASH_RESIZE,
+        STAT_INT_REHASH, STAT_KEYS_MIGRATED,   // integer keys moved hash -> array
+        STAT_MM_LOOKUP, STAT_MM_HIT,
+        STAT_STRING_HASH, STAT_STRING_HASH_BYTES,
+        STAT_CLOSURE_CALL, STAT_META_CALL,
+        STAT_COUNT
+    };
+
+    inline constexpr const char* STAT_NAMES[STAT_COUNT] = {
+        "array gets", "hash gets", "shape field gets",
+        "array sets", "hash sets",
+        "hash lookups",
+        "tables created", "array resizes", "hash resizes",
+        "integer rehashes", "keys migrated",
+        "metamethod lookups", "metamethod hits",
+        "string hashes", "string bytes hashed",
+        "closure calls", "__call calls",
+    };
+
+    // Groups probed per hash lookup: 1..PROBE_BUCKETS-1, then PROBE_BUCKETS+
+    inline constexpr uint32_t PROBE_BUCKETS = 8;
+
+    // One block per thread, written only by its thread; blocks are never
+    // freed, so counts from finished threads stay in the totals
+    struct RuntimeStats {
+        std::atomic<uint64_t> counts[STAT_COUNT] = {};
+        std::atomic<uint64_t> probeGroups[PROBE_BUCKETS] = {};
+    };
+
+    struct StatsSnapshot {
+        uint64_t counts[STAT_COUNT];
+        uint64_t probeGroups[PROBE_BUCKETS];
+    };
+
+    inline void dump_stats(FILE* out = stderr);  // defined after TableAllocator
+
+    struct StatsRegistry {
+        std::mutex lock;
+        std::vector<RuntimeStats*> threads;
+
+        static StatsRegistry& instance() {
+            static StatsRegistry r;
+            return r;
+        }
+    };
+
+    NOINLINE inline RuntimeStats* register_thread_stats() {
+        StatsRegistry& reg = StatsRegistry::instance();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        if (reg.threads.empty()) std::atexit([] { dump_stats(); });
+        reg.threads.push_back(new RuntimeStats());
+        return reg.threads.back();
+    }
+
+    ALWAYS_INLINE RuntimeStats& thread_stats() {
+        thread_local RuntimeStats* s = register_thread_stats();
+        return *s;
+    }
+
+    // Single writer: a relaxed load/store pair instead of a locked add
+    ALWAYS_INLINE void stat_bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline StatsSnapshot stats_snapshot() {
+        StatsSnapshot snap = {};
+        StatsRegistry& reg = StatsRegistry::instance();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (const RuntimeStats* t : reg.threads) {
+            for (uint32_t i = 0; i < STAT_COUNT; i++) snap.counts[i] += t->counts[i].load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < PROBE_BUCKETS; i++) snap.probeGroups[i] += t->probeGroups[i].load(std::memory_order_relaxed);
+        }
+        return snap;
+    }
+
+    inline void reset_stats() {
+        StatsRegistry& reg = StatsRegistry::instance();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (RuntimeStats* t : reg.threads) {
+            for (auto& c : t->counts) c.store(0, std::memory_order_relaxed);
+            for (auto& c : t->probeGroups) c.store(0, std::memory_order_relaxed);
+        }
+    }
+} // namespace l2c
+
+#  define L2C_STAT_ADD(id, n)   l2c::stat_bump(l2c::thread_stats().counts[l2c::STAT_##id], (n))
+#  define L2C_STAT(id)          L2C_STAT_ADD(id, 1)
+#  define L2C_STAT_PROBE(groups) l2c::stat_bump(l2c::thread_stats().probeGroups[ \
+        (groups) < l2c::PROBE_BUCKETS ? (groups) - 1 : l2c::PROBE_BUCKETS - 1], 1)
+#  define L2C_STATS_ONLY(...)   __VA_ARGS__
+#else
+#  define L2C_STAT_ADD(id, n)   ((void)0)
+#  define L2C_STAT(id)          ((void)0)
+#  define L2C_STAT_PROBE(groups) ((void)0)
+#  define L2C_STATS_ONLY(...)
+#endif
+
 // ============================================================
 // Forward declarations
 // ============================================================
@@ -52,6 +188,51 @@ struct Closure;
 struct Userdata;
 struct Thread;
 struct TableSlotProxy;  // Forward declaration for operator[] return type
+class TValue;
+class LuaGC;
+
+namespace l2c {
+    struct State;
+
+    // Coroutine support (lua_coroutine.hpp)
+    class Values;
+    class CoTask;
+    namespace co { inline TValue run(CoTask&& task); }
+
+    // Largest fixed arity accepted by Closure (more arguments are dropped)
+    constexpr size_t MAX_FIXED_ARITY = 8;
+
+    template<typename F, size_t N>
+    constexpr bool invocable_with_n() {
+        return []<size_t... I>(std::index_sequence<I...>) {
+            return std::is_invocable_v<F&, decltype((void)I, std::declval<TValue>())...>;
+        }(std::make_index_sequence<N>{});
+    }
+
+    // All the arguments of a call, for callables taking any number of them
+    struct ArgSpan {
+        const TValue* argv;
+        uint32_t n;
+    };
+
+    template<typename F>
+    constexpr bool fixed_arity_callable() {
+        return []<size_t... N>(std::index_sequence<N...>) {
+            return (invocable_with_n<F, N>() || ...);
+        }(std::make_index_sequence<MAX_FIXED_ARITY + 1>{});
+    }
+
+    // Callables storable as Lua functions: taking 0..MAX_FIXED_ARITY TValue
+    // arguments, or else one ArgSpan. Generic lambdas always match the first
+    // form, so they are never instantiated with an ArgSpan
+    template<typename F>
+    constexpr bool is_lua_callable() {
+        if constexpr (fixed_arity_callable<F>()) return true;
+        else return std::is_invocable_v<F&, ArgSpan>;
+    }
+
+    template<typename T> TValue as_value(T&& v);
+} // namespace l2c
 
 // ============================================================
 // TValue — NaN-boxed tagged value (8 bytes)
@@ -68,21 +249,27 @@ public:
     static constexpr uint64_t TAG_TRUE      = 0xfffa000000000000ULL;
     static constexpr uint64_t TAG_LIGHTUD   = 0xfffb000000000000ULL;
     static constexpr uint64_t TAG_STRING    = 0xfffc000000000000ULL;
-    static constexpr uint64_t TAG_UPVAL     = 0xfffd000000000000ULL;
+    static constexpr uint64_t TAG_ISTRING   = 0xfffc800000000000ULL;  // interned string
+    static constexpr uint64_t TAG_LSTRING   = 0xfffd800000000000ULL;  // collector-owned LuaString
     static constexpr uint64_t TAG_THREAD    = 0xfffe000000000000ULL;
     static constexpr uint64_t TAG_PROTO     = 0xffff000000000000ULL;
     static constexpr uint64_t TAG_FUNCTION  = 0xfff8800000000000ULL;
     static constexpr uint64_t TAG_TABLE     = 0xfff9800000000000ULL;
     static constexpr uint64_t TAG_USERDATA  = 0xfffa800000000000ULL;
     static constexpr uint64_t TAG_INT       = 0xfffb800000000000ULL;
+    static constexpr uint64_t TAG_BIGINT    = 0xfffe800000000000ULL;  // collector-owned int64_t
     static constexpr uint64_t POINTER_MASK  = 0x00007fffffffffffULL;
     static constexpr uint64_t TAG_MASK      = 0xffff800000000000ULL;
+    // Plain, interned and collector-owned strings share the upper 15 bits;
+    // interned and collector-owned ones carry a length header
+    static constexpr uint64_t STRING_MASK   = 0xfffe000000000000ULL;
+    static constexpr uint64_t SIZED_MASK    = 0xfffe800000000000ULL;
 
-    // Function type for callable TValue support
-    using FuncType = std::function<TValue(TValue, TValue)>;
+    // Function object behind TAG_FUNCTION values
+    using FuncType = Closure;
 
-    TValue() : bits(TAG_NIL) {}
-    explicit TValue(uint64_t raw) : bits(raw) {}
+    constexpr TValue() : bits(TAG_NIL) {}
+    constexpr explicit TValue(uint64_t raw) : bits(raw) {}
     TValue(double d) { std::memcpy(&bits, &d, 8); }
     TValue(int32_t i) : bits(TAG_INT | (uint32_t)i) {}
     TValue(const char* s) { *this = String(s); }  // For compatibility with TABLE(argv[i])
@@ -91,10 +278,21 @@ public:
     static TValue Boolean(bool b)     { return TValue(b ? TAG_TRUE : TAG_FALSE); }
     static TValue Integer(int32_t i)  { return TValue(TAG_INT | (uint32_t)i); }
     static TValue Number(double d)    { TValue v; std::memcpy(&v.bits, &d, 8); return v; }
+    // Lua 5.4 integer: inline (TAG_INT) when it fits 32 bits, boxed in a
+    // collector-owned block otherwise (defined after LuaGC)
+    static TValue Int64(int64_t i);
 
     static TValue String(const void* p) {
         return TValue(TAG_STRING | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
     }
+    // p must be the data pointer of an InternedString (see l2c::intern)
+    static TValue Interned(const void* p) {
+        return TValue(TAG_ISTRING | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
+    }
+    // p must be the data pointer of a LuaString (see l2c::new_string)
+    static TValue LString(const void* p) {
+        return TValue(TAG_LSTRING | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
+    }
     static TValue Table(LuaTable* p) {
         return TValue(TAG_TABLE | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
     }
@@ -104,43 +302,71 @@ public:
     static TValue Function(FuncType* p) {
         return TValue(TAG_FUNCTION | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
     }
+    static TValue Coroutine(::Thread* p) {
+        return TValue(TAG_THREAD | (reinterpret_cast<uint64_t>(p) & POINTER_MASK));
+    }
+    // Allocate a closure owned by the garbage collector (defined after LuaGC)
+    template<typename F>
+    static TValue NewFunction(F&& f);
 
     ALWAYS_INLINE bool isNil()     const { return bits == TAG_NIL; }
     ALWAYS_INLINE bool isInteger() const { return (bits & TAG_MASK) == TAG_INT; }
+    ALWAYS_INLINE bool isBoxedInteger() const { return (bits & TAG_MASK) == TAG_BIGINT; }
+    // Either representation of an integer (see Int64)
+    ALWAYS_INLINE bool isInt64()   const { return isInteger() || isBoxedInteger(); }
     ALWAYS_INLINE bool isNumber()  const { return (bits & NANBOX_BASE) != NANBOX_BASE; }
-    ALWAYS_INLINE bool isString()  const { return (bits & TAG_MASK) == TAG_STRING; }
+    ALWAYS_INLINE bool isString()  const { return (bits & STRING_MASK) == TAG_STRING; }
+    ALWAYS_INLINE bool isInterned() const { return (bits & TAG_MASK) == TAG_ISTRING; }
+    ALWAYS_INLINE bool isLString() const { return (bits & TAG_MASK) == TAG_LSTRING; }
+    // Interned or collector-owned: the length is stored in front of the data
+    ALWAYS_INLINE bool isSizedString() const { return (bits & SIZED_MASK) == TAG_ISTRING; }
     ALWAYS_INLINE bool isTable()   const { return (bits & TAG_MASK) == TAG_TABLE; }
     ALWAYS_INLINE bool isFunction() const { return (bits & TAG_MASK) == TAG_FUNCTION; }
+    ALWAYS_INLINE bool isThread()  const { return (bits & TAG_MASK) == TAG_THREAD; }
     ALWAYS_INLINE bool isFalsy()   const { return bits == TAG_NIL || bits == TAG_FALSE; }
 
     ALWAYS_INLINE int32_t    toInteger() const { return (int32_t)(bits & 0xffffffff); }
+    ALWAYS_INLINE int64_t    toInt64()   const {
+        if (LIKELY(isInteger())) return toInteger();
+        int64_t i; std::memcpy(&i, toPtr(), 8); return i;
+    }
     ALWAYS_INLINE double     toNumber()  const { double d; std::memcpy(&d, &bits, 8); return d; }
     ALWAYS_INLINE const void* toPtr()   const { return reinterpret_cast<const void*>(bits & POINTER_MASK); }
     ALWAYS_INLINE LuaTable*  toTable()  const { return reinterpret_cast<LuaTable*>(bits & POINTER_MASK); }
     ALWAYS_INLINE FuncType* toFunction() const { 
         return reinterpret_cast<FuncType*>(bits & POINTER_MASK); 
     }
+    ALWAYS_INLINE ::Thread* toThread() const { return reinterpret_cast<::Thread*>(bits & POINTER_MASK); }
+
+    // Calls with 0-3 arguments use the closure's per-arity entry points
+    // (defined after Closure); non-functions dispatch to __call
+    ALWAYS_INLINE TValue call() const;
+    ALWAYS_INLINE TValue call(TValue a) const;
+    ALWAYS_INLINE TValue call(TValue a, TValue b) const;
+    ALWAYS_INLINE TValue call(TValue a, TValue b, TValue c) const;
+    ALWAYS_INLINE TValue callv(const TValue* args, uint32_t n) const;
+    TValue callMeta(const TValue* args, uint32_t n) const;  // defined after LuaTable
 
-    TValue call(TValue a, TValue b) const {
-        if (isFunction()) {
-            FuncType* f = toFunction();
-            if (f && *f) return (*f)(a, b);
+    template<typename... Args>
+    TValue operator()(Args&&... args) const {
+        if constexpr (sizeof...(Args) <= 3) {
+            return call(l2c::as_value(std::forward<Args>(args))...);
+        } else {
+            const TValue argv[] = { l2c::as_value(std::forward<Args>(args))... };
+            return callv(argv, sizeof...(Args));
         }
-        return Nil();
     }
     
     // Numeric value extraction (for arithmetic)
     ALWAYS_INLINE double asNumber() const {
         if (isNumber()) return toNumber();
         if (isInteger()) return (double)toInteger();
+        if (isBoxedInteger()) return (double)toInt64();
         if (isString()) {
             // Convert string to number (Lua semantics)
             const char* s = static_cast<const char*>(toPtr());
-            char* end;
-            double d = std::strtod(s, &end);
-            if (end != s && *end == '\0') {
-                return d;
-            }
+            double d;
+            if (l2c::str_to_number(s, std::strlen(s), d)) return d;
         }
         return 0.0;
     }
@@ -154,13 +380,21 @@ public:
         if (bits == o.bits) return true;
         // String content comparison
         if (isString() && o.isString()) {
+            // Interned strings are unique per content: distinct pointers differ
+            if (isInterned() && o.isInterned()) return false;
             const char* a = static_cast<const char*>(toPtr());
             const char* b = static_cast<const char*>(o.toPtr());
+            if (isSizedString() && o.isSizedString()) return sizedEquals(a, b);
             return std::strcmp(a, b) == 0;
         }
+        // Boxed integers compare by value, also with floats (integral ones
+        // outside the 32-bit range are never normalized to TAG_INT)
+        if (UNLIKELY(isBoxedInteger() || o.isBoxedInteger())) return intEquals(o);
         return false;
     }
-    ALWAYS_INLINE bool operator!=(TValue o) const { return bits != o.bits; }
+    static bool sizedEquals(const char* a, const char* b);  // defined after LuaString
+    bool intEquals(TValue o) const;  // defined after hashTValue
+    ALWAYS_INLINE bool operator!=(TValue o) const { return !(*this == o); }
     
     // Comparison with double (resolves ambiguity with implicit conversion)
     ALWAYS_INLINE bool operator>=(double o) const { return asNumber() >= o; }
@@ -183,12 +417,13 @@ public:
 
     // Accept callable types (function pointers, lambdas) and wrap as TValue::Function
     template<typename F, typename = std::enable_if_t<
-        std::is_invocable_v<F> && 
         !std::is_same_v<std::decay_t<F>, TValue> &&
-        !std::is_convertible_v<F, double>
+        !std::is_same_v<std::decay_t<F>, TableSlotProxy> &&
+        !std::is_convertible_v<F, double> &&
+        l2c::is_lua_callable<std::decay_t<F>>()
     >>
     TValue& operator=(F&& f) {
-        *this = Function(new FuncType(std::forward<F>(f)));
+        *this = NewFunction(std::forward<F>(f));
         return *this;
     }
 
@@ -207,6 +442,8 @@ public:
     // Table access operators (defined after LuaTable)
     TableSlotProxy operator[](int32_t index);
     TValue         operator[](int32_t index) const;
+    TableSlotProxy operator[](int64_t index);              // Integer for-loop indices
+    TValue         operator[](int64_t index) const;
     TableSlotProxy operator[](double index);
     TValue         operator[](double index) const;
     TableSlotProxy operator[](const char* key);
@@ -215,10 +452,174 @@ public:
     TValue         operator[](const std::string& key) const;
     TableSlotProxy operator[](const TableSlotProxy& key);  // For table[proxy]
     TValue         operator[](const TableSlotProxy& key) const;
+    TableSlotProxy operator[](TValue key);                 // For table[interned key]
+    TValue         operator[](TValue key) const;
 };
 
 static_assert(sizeof(TValue) == 8, "TValue must be 8 bytes");
 
+// ============================================================
+// Closure — function object behind TAG_FUNCTION values
+//
+// A 16-byte header (entry points + allocation size) followed by the
+// callable itself, so captured upvalues live inline in the same block.
+// Calls with 0-3 arguments go through per-arity entry points without
+// packing; longer calls use callN. As in Lua, missing parameters are
+// nil and extra arguments are dropped.
+//
+// Coroutine threads (lua_coroutine.hpp) share this header: trace marks
+// what lives outside the payload, and start begins the body of a
+// function lowered to a C++ coroutine. Both are null for plain closures.
+// ============================================================
+struct Closure {
+    struct Ops {
+        TValue (*call0)(Closure*);
+        TValue (*call1)(Closure*, TValue);
+        TValue (*call2)(Closure*, TValue, TValue);
+        TValue (*call3)(Closure*, TValue, TValue, TValue);
+        TValue (*callN)(Closure*, const TValue*, uint32_t);
+        void   (*destroy)(Closure*);
+        void   (*trace)(const Closure*, LuaGC&);
+        l2c::CoTask (*start)(Closure*, const l2c::Values&);
+    };
+
+    static constexpr uint32_t VARIADIC = ~0u;
+
+    const Ops* ops;
+    uint32_t   size;   // bytes in this allocation (header + callable)
+    uint32_t   arity;  // fixed parameter count, or VARIADIC
+
+    // Inline upvalue storage, scanned by the collector
+    const char* payloadBegin() const { return reinterpret_cast<const char*>(this) + sizeof(Closure); }
+    const char* payloadEnd()   const { return reinterpret_cast<const char*>(this) + size; }
+};
+
+template<typename F>
+struct ClosureImpl final : Closure {
+    F fn;
+
+    static constexpr bool VECTOR = !l2c::fixed_arity_callable<F>();
+
+    // A C++ parameter pack (a Lua vararg function): called with each count
+    static constexpr bool PACK = !VECTOR && l2c::invocable_with_n<F, 0>() &&
+                                 l2c::invocable_with_n<F, l2c::MAX_FIXED_ARITY>();
+
+    static constexpr uint32_t fixedArity() {
+        return []<size_t... N>(std::index_sequence<N...>) {
+            uint32_t k = 0;
+            ((l2c::invocable_with_n<F, N>() ? (k = (uint32_t)N, true) : false) || ...);
+            return k;
+        }(std::make_index_sequence<l2c::MAX_FIXED_ARITY + 1>{});
+    }
+    static constexpr uint32_t FIXED = VECTOR ? 0 : fixedArity();
+
+    // Lowered to a C++ coroutine: calling it returns an l2c::CoTask
+    static constexpr bool COROUTINE = [] {
+        if constexpr (VECTOR) return false;
+        else return []<size_t... I>(std::index_sequence<I...>) {
+            return std::is_same_v<std::invoke_result_t<F&, decltype((void)I, std::declval<TValue>())...>,
+                                  l2c::CoTask>;
+        }(std::make_index_sequence<FIXED>{});
+    }();
+
+    template<typename Fn>
+    explicit ClosureImpl(Fn&& f) : fn(std::forward<Fn>(f)) {
+        ops   = &OPS;
+        size  = sizeof(ClosureImpl);
+        arity = VECTOR || PACK ? VARIADIC : FIXED;
+    }
+
+    template<typename... A>
+    ALWAYS_INLINE static TValue invoke(F& f, A&&... a) {
+        using R = std::invoke_result_t<F&, A...>;
+        if constexpr (std::is_void_v<R>) {
+            f(std::forward<A>(a)...);
+            return TValue::Nil();
+        } else if constexpr (std::is_same_v<R, l2c::CoTask>) {
+            return l2c::co::run(f(std::forward<A>(a)...));  // called like a plain function
+        } else {
+            return l2c::as_value(f(std::forward<A>(a)...));
+        }
+    }
+
+    // f with its first K arguments, padded with nils
+    template<size_t K>
+    static TValue callFirst(F& f, const TValue* argv, uint32_t n) {
+        return [&]<size_t... I>(std::index_sequence<I...>) {
+            return invoke(f, (I < n ? argv[I] : TValue::Nil())...);
+        }(std::make_index_sequence<K>{});
+    }
+
+    static TValue callFixed(F& f, const TValue* argv, uint32_t n) {
+        if constexpr (PACK) {
+            const uint32_t k = n < l2c::MAX_FIXED_ARITY ? n : (uint32_t)l2c::MAX_FIXED_ARITY;
+            return [&]<size_t... K>(std::index_sequence<K...>) {
+                TValue r;
+                (void)((K == k && (r = callFirst<K>(f, argv, n), true)) || ...);
+                return r;
+            }(std::make_index_sequence<l2c::MAX_FIXED_ARITY + 1>{});
+        } else {
+            return callFirst<FIXED>(f, argv, n);
+        }
+    }
+
+    template<typename... A>
+    static TValue callExact(Closure* c, A... a) {
+        F& f = static_cast<ClosureImpl*>(c)->fn;
+        if constexpr (!VECTOR && l2c::invocable_with_n<F, sizeof...(A)>()) {
+            return invoke(f, a...);
+        } else {
+            const TValue argv[sizeof...(A) + 1] = { a... };
+            if constexpr (VECTOR) return invoke(f, l2c::ArgSpan{argv, (uint32_t)sizeof...(A)});
+            else return callFixed(f, argv, sizeof...(A));
+        }
+    }
+
+    static TValue callN(Closure* c, const TValue* argv, uint32_t n) {
+        F& f = static_cast<ClosureImpl*>(c)->fn;
+        if constexpr (VECTOR) return invoke(f, l2c::ArgSpan{argv, n});
+        else return callFixed(f, argv, n);
+    }
+
+    static void destroy(Closure* c) { static_cast<ClosureImpl*>(c)->~ClosureImpl(); }
+
+    // The body of a coroutine thread, suspended before its first statement
+    static l2c::CoTask start(Closure* c, const l2c::Values& args);
+
+    static constexpr auto startEntry() {
+        if constexpr (COROUTINE) return &start;
+        else return static_cast<l2c::CoTask (*)(Closure*, const l2c::Values&)>(nullptr);
+    }
+
+    static constexpr Ops OPS = {
+        &callExact<>, &callExact<TValue>, &callExact<TValue, TValue>,
+        &callExact<TValue, TValue, TValue>, &callN, &destroy, nullptr, startEntry(),
+    };
+};
+
+ALWAYS_INLINE TValue TValue::call() const {
+    if (LIKELY(isFunction())) { L2C_STAT(CLOSURE_CALL); Closure* f = toFunction(); return f->ops->call0(f); }
+    return callMeta(nullptr, 0);
+}
+ALWAYS_INLINE TValue TValue::call(TValue a) const {
+    if (LIKELY(isFunction())) { L2C_STAT(CLOSURE_CALL); Closure* f = toFunction(); return f->ops->call1(f, a); }
+    return callMeta(&a, 1);
+}
+ALWAYS_INLINE TValue TValue::call(TValue a, TValue b) const {
+    if (LIKELY(isFunction())) { L2C_STAT(CLOSURE_CALL); Closure* f = toFunction(); return f->ops->call2(f, a, b); }
+    const TValue argv[] = { a, b };
+    return callMeta(argv, 2);
+}
+ALWAYS_INLINE TValue TValue::call(TValue a, TValue b, TValue c) const {
+    if (LIKELY(isFunction())) { L2C_STAT(CLOSURE_CALL); Closure* f = toFunction(); return f->ops->call3(f, a, b, c); }
+    const TValue argv[] = { a, b, c };
+    return callMeta(argv, 3);
+}
+ALWAYS_INLINE TValue TValue::callv(const TValue* args, uint32_t n) const {
+    if (LIKELY(isFunction())) { L2C_STAT(CLOSURE_CALL); Closure* f = toFunction(); return f->ops->callN(f, args, n); }
+    return callMeta(args, n);
+}
+
 // ============================================================
 // wyhash — fast, high-quality 64-bit hash
 // Public domain, see https://github.com/wangyi-fudan/wyhash
@@ -276,9 +677,193 @@ namespace wyhash_impl {
 
 // Hash string content (for non-interned strings)
 ALWAYS_INLINE uint32_t hashString(const char* s, size_t len) {
+    L2C_STAT(STRING_HASH);
+    L2C_STAT_ADD(STRING_HASH_BYTES, len);
     return (uint32_t)wyhash_impl::wyhash(s, len);
 }
 
+// ============================================================
+// InternedString — header stored in front of the characters
+// TValue points at data, so interned strings remain plain
+// NUL-terminated C strings for the rest of the runtime.
+// ============================================================
+struct InternedString {
+    uint32_t hash;     // hashString(data, len), computed once
+    uint32_t len;
+    char     data[1];  // len + 1 bytes allocated
+
+    static ALWAYS_INLINE const InternedString* fromData(const void* p) {
+        return reinterpret_cast<const InternedString*>(
+            static_cast<const char*>(p) - offsetof(InternedString, data));
+    }
+};
+
+// ============================================================
+// LuaString — collector-owned string (TAG_LSTRING)
+// Same layout as InternedString, so the length of any sized string
+// is read from the same place. The hash is computed on first use:
+// most strings built at run time are never table keys.
+// ============================================================
+struct LuaString {
+    uint32_t hash;     // hashString(data, len), or 0 until first needed
+    uint32_t len;
+    char     data[1];  // len + 1 bytes allocated
+
+    static ALWAYS_INLINE LuaString* fromData(const void* p) {
+        return reinterpret_cast<LuaString*>(
+            const_cast<char*>(static_cast<const char*>(p)) - offsetof(LuaString, data));
+    }
+
+    static ALWAYS_INLINE size_t allocSize(size_t len) {
+        return offsetof(LuaString, data) + len + 1;
+    }
+    size_t allocSize() const { return allocSize(len); }
+
+    static ALWAYS_INLINE uint32_t hashOf(const void* p) {
+        LuaString* s = fromData(p);
+        if (UNLIKELY(s->hash == 0)) s->hash = hashString(s->data, s->len);
+        return s->hash;
+    }
+};
+static_assert(offsetof(LuaString, len) == offsetof(InternedString, len) &&
+              offsetof(LuaString, data) == offsetof(InternedString, data),
+              "sized strings share one header layout");
+
+inline bool TValue::sizedEquals(const char* a, const char* b) {
+    const LuaString* sa = LuaString::fromData(a);
+    const LuaString* sb = LuaString::fromData(b);
+    return sa->len == sb->len && std::memcmp(a, b, sa->len) == 0;
+}
+
+// ============================================================
+// StringPool — intern table (open addressing, linear probe)
+// Each State interns into its own pool. The constants pool holds the
+// keys generated code interns during static initialization; it is only
+// read once scripts run, and every State pool looks there first, so an
+// interned string is still unique per content within a State.
+// Interned strings live as long as their pool.
+// ============================================================
+class StringPool {
+public:
+    // The running State's pool (defined after State)
+    static StringPool& instance();
+
+    static StringPool& constants() {
+        static StringPool pool(nullptr);
+        return pool;
+    }
+
+    const InternedString* intern(const char* s, size_t len) {
+        uint32_t h = hashString(s, len);
+        if (base) {
+            if (const InternedString* e = base->find(s, len, h)) return e;
+        }
+        if (UNLIKELY((count + 1) * 4 > capacity * 3)) grow();
+        uint32_t mask = capacity - 1;
+        for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+            InternedString* e = entries[i];
+            if (!e) {
+                e = allocate(s, len, h);
+                entries[i] = e;
+                count++;
+                return e;
+            }
+            if (e->hash == h && e->len == len && std::memcmp(e->data, s, len) == 0)
+                return e;
+        }
+    }
+
+    uint32_t size() const { return count; }
+
+private:
+    friend struct l2c::State;
+
+    InternedString**  entries;
+    uint32_t          capacity;
+    uint32_t          count;
+    const StringPool* base;  // looked up first; never written through
+
+    explicit StringPool(const StringPool* b) : capacity(256), count(0), base(b) {
+        entries = new InternedString*[capacity]();
+    }
+
+    ~StringPool() {
+        for (uint32_t i = 0; i < capacity; i++)
+            if (entries[i]) ::operator delete(entries[i]);
+        delete[] entries;
+    }
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    const InternedString* find(const char* s, size_t len, uint32_t h) const {
+        uint32_t mask = capacity - 1;
+        for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+            const InternedString* e = entries[i];
+            if (!e) return nullptr;
+            if (e->hash == h && e->len == len && std::memcmp(e->data, s, len) == 0)
+                return e;
+        }
+    }
+
+    static InternedString* allocate(const char* s, size_t len, uint32_t h) {
+        void* mem = ::operator new(offsetof(InternedString, data) + len + 1);
+        InternedString* e = static_cast<InternedString*>(mem);
+        e->hash = h;
+        e->len  = (uint32_t)len;
+        std::memcpy(e->data, s, len);
+        e->data[len] = '\0';
+        return e;
+    }
+
+    NOINLINE void grow() {
+        uint32_t newCap = capacity * 2;
+        InternedString** newEntries = new InternedString*[newCap]();
+        for (uint32_t i = 0; i < capacity; i++) {
+            InternedString* e = entries[i];
+            if (!e) continue;
+            uint32_t j = e->hash & (newCap - 1);
+            while (newEntries[j]) j = (j + 1) & (newCap - 1);
+            newEntries[j] = e;
+        }
+        delete[] entries;
+        entries  = newEntries;
+        capacity = newCap;
+    }
+};
+
+namespace l2c {
+    // Intern s as a constant and return it as a TValue key: O(1) hash,
+    // pointer equality. Generated code interns literal table keys once,
+    // during static initialization, before any thread runs a script;
+    // strings made at run time intern into their State's pool instead.
+    inline TValue intern(const char* s) {
+        return TValue::Interned(StringPool::constants().intern(s, std::strlen(s))->data);
+    }
+
+    inline const TValue EMPTY_STRING = intern("");
+} // namespace l2c
+
+// ============================================================
+// Metamethod events — each has a presence-cache bit in LuaTable::flags
+// ============================================================
+enum TMS : uint32_t {
+    TM_INDEX, TM_NEWINDEX, TM_EQ, TM_LT, TM_LE, TM_LEN, TM_CALL,
+    TM_ADD, TM_SUB, TM_MUL, TM_DIV,
+    TM_N
+};
+
+namespace l2c {
+    // Interned with the constants, before any State runs
+    inline const TValue TM_NAMES[TM_N] = {
+        intern("__index"), intern("__newindex"), intern("__eq"),
+        intern("__lt"), intern("__le"), intern("__len"), intern("__call"),
+        intern("__add"), intern("__sub"), intern("__mul"), intern("__div"),
+    };
+
+    inline TValue tm_name(TMS e) { return TM_NAMES[e]; }
+} // namespace l2c
+
 // ============================================================
 // Key hashing for TValue keys
 // ============================================================
@@ -291,66 +876,176 @@ ALWAYS_INLINE uint32_t hashTValue(TValue key) {
         k = (k >> 16) ^ k;
         return k;
     }
+    if (key.isInterned()) {
+        // Precomputed at intern time; equals hashString() of the content
+        return InternedString::fromData(key.toPtr())->hash;
+    }
+    if (key.isLString()) {
+        // Computed on first use; equals hashString() of the content
+        return LuaString::hashOf(key.toPtr());
+    }
     if (key.isString()) {
         // Hash string content (not pointer) for correct metamethod lookup
         const char* s = static_cast<const char*>(key.toPtr());
         return hashString(s, std::strlen(s));
     }
-    // For all other types (doubles, pointers): hash the raw bits
-    return (uint32_t)wyhash_impl::wymix(key.bits, 0x9e3779b97f4a7c15ULL);
+    // Boxed integers hash their value, and so do the floats equal to one
+    int64_t i;
+    if (UNLIKELY(key.isBoxedInteger())) i = key.toInt64();
+    else if (!key.isNumber() || !l2c::float_to_integer(key.toNumber(), i))
+        // For all other types (doubles, pointers): hash the raw bits
+        return (uint32_t)wyhash_impl::wymix(key.bits, 0x9e3779b97f4a7c15ULL);
+    return (uint32_t)wyhash_impl::wymix((uint64_t)i, 0x9e3779b97f4a7c15ULL);
+}
+
+inline bool TValue::intEquals(TValue o) const {
+    if (isBoxedInteger() && o.isBoxedInteger()) return toInt64() == o.toInt64();
+    TValue box = isBoxedInteger() ? *this : o;
+    TValue other = isBoxedInteger() ? o : *this;
+    int64_t i;
+    return other.isNumber() && l2c::float_to_integer(other.toNumber(), i) && i == box.toInt64();
 }
 
 // ============================================================
 // Swiss Table control byte constants
 // ============================================================
-static constexpr int8_t CTRL_EMPTY   = -128;  // 0x80
-static constexpr int8_t CTRL_DELETED = -2;    // 0xFE
+static constexpr int8_t CTRL_EMPTY    = -128;  // 0x80
+static constexpr int8_t CTRL_DELETED  = -2;    // 0xFE
+static constexpr int8_t CTRL_SENTINEL = -1;    // 0xFF: past the end of a part smaller than a group
 // h2 (lower 7 bits of hash) stored as non-negative value [0, 127]
 
 // ============================================================
-// HashGroup — 16-slot SIMD group (one cache line of ctrl bytes)
+// HashGroup — WIDTH ctrl bytes probed at once (16, or 32 with AVX2)
+//
+// The match functions return a Mask with one bit set per matching slot;
+// slotOf gives the lowest one's slot and `m &= m - 1` clears it. SSE2
+// and AVX2 use movemask's bit i for slot i. NEON has no movemask: the
+// compare is narrowed with vshrn to 4 bits per slot in a uint64_t, of
+// which bit 4i + 3 is kept (MASK_SHIFT 2).
 // ============================================================
-struct alignas(16) HashGroup {
-    int8_t ctrl[16];
+struct HashGroup {
+#if defined(LUATABLE_AVX2)
+    static constexpr uint32_t WIDTH = 32;
+    static constexpr const char* BACKEND = "avx2";
+#elif defined(LUATABLE_SIMD)
+    static constexpr uint32_t WIDTH = 16;
+    static constexpr const char* BACKEND = "sse2";
+#elif defined(LUATABLE_NEON)
+    static constexpr uint32_t WIDTH = 16;
+    static constexpr const char* BACKEND = "neon";
+#else
+    static constexpr uint32_t WIDTH = 16;
+    static constexpr const char* BACKEND = "scalar";
+#endif
+
+#if defined(LUATABLE_NEON)
+    using Mask = uint64_t;
+    static constexpr uint32_t MASK_SHIFT = 2;
+#else
+    using Mask = uint32_t;
+    static constexpr uint32_t MASK_SHIFT = 0;
+#endif
+
+    alignas(WIDTH) int8_t ctrl[WIDTH];
 
-    void init() { std::memset(ctrl, CTRL_EMPTY, 16); }
+    // The first n slots EMPTY, any others SENTINEL (never matched or filled)
+    void init(uint32_t n = WIDTH) {
+        std::memset(ctrl, CTRL_EMPTY, n);
+        std::memset(ctrl + n, CTRL_SENTINEL, WIDTH - n);
+    }
+
+    // Slot of the lowest bit of a non-zero mask
+    static ALWAYS_INLINE uint32_t slotOf(Mask m) {
+        if constexpr (sizeof(Mask) == 8) return (uint32_t)__builtin_ctzll(m) >> MASK_SHIFT;
+        else return (uint32_t)__builtin_ctz(m) >> MASK_SHIFT;
+    }
+    // Bits of the slots from slot i on (i < WIDTH)
+    static ALWAYS_INLINE Mask fromSlot(uint32_t i) {
+        return ~Mask(0) << (i << MASK_SHIFT);
+    }
 
-#ifdef LUATABLE_SIMD
+#if defined(LUATABLE_AVX2)
+    ALWAYS_INLINE __m256i load() const { return _mm256_load_si256((const __m256i*)ctrl); }
+    // Returns bitmask of slots matching h2
+    ALWAYS_INLINE Mask matchH2(int8_t h2) const {
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(load(), _mm256_set1_epi8(h2)));
+    }
+    // Returns bitmask of empty slots
+    ALWAYS_INLINE Mask matchEmpty() const {
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(load(), _mm256_set1_epi8(CTRL_EMPTY)));
+    }
+    // Returns bitmask of empty-or-deleted slots: below SENTINEL
+    ALWAYS_INLINE Mask matchAvailable() const {
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(CTRL_SENTINEL), load()));
+    }
+    // Returns bitmask of occupied slots: the h2 values have the high bit clear
+    ALWAYS_INLINE Mask matchLive() const {
+        return ~(uint32_t)_mm256_movemask_epi8(load());
+    }
+#elif defined(LUATABLE_SIMD)
     // Returns bitmask of slots matching h2
-    ALWAYS_INLINE uint32_t matchH2(int8_t h2) const {
+    ALWAYS_INLINE Mask matchH2(int8_t h2) const {
         __m128i c = _mm_load_si128((__m128i*)ctrl);
         __m128i t = _mm_set1_epi8(h2);
         return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, t));
     }
     // Returns bitmask of empty slots
-    ALWAYS_INLINE uint32_t matchEmpty() const {
+    ALWAYS_INLINE Mask matchEmpty() const {
         __m128i c = _mm_load_si128((__m128i*)ctrl);
         __m128i e = _mm_set1_epi8(CTRL_EMPTY);
         return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, e));
     }
-    // Returns bitmask of empty-or-deleted slots
-    ALWAYS_INLINE uint32_t matchAvailable() const {
-        __m128i c  = _mm_load_si128((__m128i*)ctrl);
-        // Both EMPTY(0x80) and DELETED(0xFE) have high bit set
-        return (uint32_t)_mm_movemask_epi8(c);
+    // Returns bitmask of empty-or-deleted slots: below SENTINEL
+    ALWAYS_INLINE Mask matchAvailable() const {
+        __m128i c = _mm_load_si128((__m128i*)ctrl);
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), c));
+    }
+    // Returns bitmask of occupied slots: the h2 values have the high bit clear
+    ALWAYS_INLINE Mask matchLive() const {
+        __m128i c = _mm_load_si128((__m128i*)ctrl);
+        return ~(uint32_t)_mm_movemask_epi8(c) & 0xffffu;
+    }
+#elif defined(LUATABLE_NEON)
+    // The 0xff lanes of a compare, as the high bit of each slot's nibble
+    static ALWAYS_INLINE Mask toMask(uint8x16_t lanes) {
+        uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(lanes), 4);
+        return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+    }
+    ALWAYS_INLINE Mask matchH2(int8_t h2) const {
+        return toMask(vceqq_s8(vld1q_s8(ctrl), vdupq_n_s8(h2)));
+    }
+    ALWAYS_INLINE Mask matchEmpty() const {
+        return toMask(vceqq_s8(vld1q_s8(ctrl), vdupq_n_s8(CTRL_EMPTY)));
+    }
+    ALWAYS_INLINE Mask matchAvailable() const {
+        return toMask(vcltq_s8(vld1q_s8(ctrl), vdupq_n_s8(CTRL_SENTINEL)));
+    }
+    ALWAYS_INLINE Mask matchLive() const {
+        return toMask(vcgeq_s8(vld1q_s8(ctrl), vdupq_n_s8(0)));
     }
 #else
-    ALWAYS_INLINE uint32_t matchH2(int8_t h2) const {
+    ALWAYS_INLINE Mask matchH2(int8_t h2) const {
         uint32_t mask = 0;
-        for (int i = 0; i < 16; i++)
+        for (uint32_t i = 0; i < WIDTH; i++)
             if (ctrl[i] == h2) mask |= (1u << i);
         return mask;
     }
-    ALWAYS_INLINE uint32_t matchEmpty() const {
+    ALWAYS_INLINE Mask matchEmpty() const {
         uint32_t mask = 0;
-        for (int i = 0; i < 16; i++)
+        for (uint32_t i = 0; i < WIDTH; i++)
             if (ctrl[i] == CTRL_EMPTY) mask |= (1u << i);
         return mask;
     }
-    ALWAYS_INLINE uint32_t matchAvailable() const {
+    ALWAYS_INLINE Mask matchAvailable() const {
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < WIDTH; i++)
+            if (ctrl[i] < CTRL_SENTINEL) mask |= (1u << i);
+        return mask;
+    }
+    ALWAYS_INLINE Mask matchLive() const {
         uint32_t mask = 0;
-        for (int i = 0; i < 16; i++)
-            if ((uint8_t)ctrl[i] >= 0x80) mask |= (1u << i);
+        for (uint32_t i = 0; i < WIDTH; i++)
+            if (ctrl[i] >= 0) mask |= (1u << i);
         return mask;
     }
 #endif
@@ -366,111 +1061,474 @@ struct HashSlot {
 };
 
 // ============================================================
-// HashPart — Swiss Table open-addressed hash
+// TableAllocator — size-class pool for table headers and buffers
 //
-// Layout: groups of 16 ctrl bytes (one cache line), followed
-// by the corresponding 16 HashSlots in a parallel array.
-// capacity is always a multiple of 16 (power of 2 >=16).
+// Power-of-two size classes from 16 B to 64 KB, each with an intrusive
+// free list refilled from 64 KB slabs. Slabs are 64-byte aligned, so a
+// block is aligned to min(64, block size): table headers get their
+// cache line and hash ctrl groups their SSE alignment. Blocks released
+// on resize or table destruction are recycled within their class;
+// larger requests go straight to aligned operator new. Slabs are only
+// returned to the system at exit.
 // ============================================================
-struct HashPart {
-    HashGroup* groups;   // ctrl bytes, numGroups groups
-    HashSlot*  slots;    // parallel slot array, numGroups*16 slots
-    uint32_t   capacity; // total slots (numGroups * 16)
-    uint32_t   count;    // live entries
-    uint32_t   numGroups;
+class TableAllocator {
+public:
+    static constexpr uint32_t MIN_SHIFT   = 4;   // 16 B
+    static constexpr uint32_t MAX_SHIFT   = 16;  // 64 KB
+    static constexpr uint32_t NUM_CLASSES = MAX_SHIFT - MIN_SHIFT + 1;
+    static constexpr size_t   SLAB_BYTES  = size_t(1) << MAX_SHIFT;
 
-    // Derived: high bits of hash select group (h1), low 7 bits = h2
-    ALWAYS_INLINE uint32_t h1(uint32_t hash) const {
-        return (hash >> 7) % numGroups;
-    }
-    ALWAYS_INLINE int8_t h2(uint32_t hash) const {
-        return (int8_t)(hash & 0x7f);
+    struct ClassStats {
+        uint64_t allocs;   // blocks handed out
+        uint64_t reused;   // ...of which came from the free list
+        uint64_t frees;    // blocks returned
+        size_t   slabs;    // slabs carved for this class
+    };
+
+    struct Stats {
+        size_t     slabBytes;    // memory reserved in slabs
+        size_t     liveBytes;    // bytes in blocks currently handed out
+        uint64_t   largeAllocs;  // requests above the largest class
+        uint64_t   largeFrees;
+        ClassStats classes[NUM_CLASSES];
+    };
+
+    // The running State's pools (defined after State)
+    static TableAllocator& instance();
+
+    static ALWAYS_INLINE uint32_t sizeClass(size_t bytes) {
+        if (bytes <= (size_t(1) << MIN_SHIFT)) return 0;
+        return (uint32_t)(64 - __builtin_clzll((unsigned long long)(bytes - 1))) - MIN_SHIFT;
     }
+    static ALWAYS_INLINE size_t classSize(uint32_t c) { return size_t(1) << (c + MIN_SHIFT); }
 
-    void init(uint32_t cap) {
-        assert((cap & (cap - 1)) == 0 && cap >= 16);
-        capacity  = cap;
-        numGroups = cap / 16;
-        count     = 0;
-        // Allocate ctrl groups (cache-line aligned) + slots
-        groups = (HashGroup*)::operator new(numGroups * sizeof(HashGroup) + 16,
-                                            std::align_val_t{64});
-        slots  = (HashSlot*)::operator new(cap * sizeof(HashSlot));
-        for (uint32_t i = 0; i < numGroups; i++) groups[i].init();
+    // bytes must be passed again to deallocate (sized free, no headers)
+    ALWAYS_INLINE void* allocate(size_t bytes) {
+        if (UNLIKELY(bytes > SLAB_BYTES)) return allocateLarge(bytes);
+        uint32_t c = sizeClass(bytes);
+        FreeBlock* b = freeLists[c];
+        if (LIKELY(b)) {
+            freeLists[c] = b->next;
+            st.classes[c].reused++;
+        } else {
+            b = refill(c);
+        }
+        st.classes[c].allocs++;
+        st.liveBytes += classSize(c);
+        return b;
     }
 
-    void destroy() {
-        ::operator delete(groups, std::align_val_t{64});
-        ::operator delete(slots);
-        groups = nullptr; slots = nullptr;
-        capacity = count = numGroups = 0;
+    ALWAYS_INLINE void deallocate(void* p, size_t bytes) {
+        if (UNLIKELY(bytes > SLAB_BYTES)) { deallocateLarge(p); return; }
+        uint32_t c = sizeClass(bytes);
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = freeLists[c];
+        freeLists[c] = b;
+        st.classes[c].frees++;
+        st.liveBytes -= classSize(c);
     }
 
-    // Returns pointer to value for key, or nullptr if not found
-    ALWAYS_INLINE TValue* find(TValue key) const {
-        if (UNLIKELY(capacity == 0)) return nullptr;
-        uint32_t hash = hashTValue(key);
-        uint32_t g    = h1(hash);
-        int8_t   h    = h2(hash);
-        uint32_t gMask = numGroups - 1;
+    const Stats& stats() const { return st; }
 
-        for (;;) {
-            uint32_t matches = groups[g].matchH2(h);
-            while (matches) {
-                uint32_t i = (uint32_t)__builtin_ctz(matches);
-                uint32_t idx = g * 16 + i;
-                if (LIKELY(slots[idx].key == key))
-                    return &slots[idx].val;
-                matches &= matches - 1;
-            }
-            if (LIKELY(groups[g].matchEmpty()))
-                return nullptr; // probe sequence terminated
-            g = (g + 1) & gMask;
-        }
-    }
+private:
+    friend struct l2c::State;
 
-    // Insert or update key. Returns pointer to value slot.
-    // Caller must check load factor before calling.
-    NOINLINE TValue* upsert(TValue key) {
-        uint32_t hash  = hashTValue(key);
-        uint32_t g     = h1(hash);
-        int8_t   h     = h2(hash);
-        uint32_t gMask = numGroups - 1;
-        uint32_t firstAvailG = ~0u;
-        uint32_t firstAvailI = ~0u;
+    struct FreeBlock { FreeBlock* next; };
 
-        for (;;) {
-            uint32_t matches = groups[g].matchH2(h);
-            while (matches) {
-                uint32_t i   = (uint32_t)__builtin_ctz(matches);
-                uint32_t idx = g * 16 + i;
-                if (LIKELY(slots[idx].key == key))
-                    return &slots[idx].val; // update existing
-                matches &= matches - 1;
-            }
-            // Track first available (empty or deleted) slot
-            if (firstAvailG == ~0u) {
-                uint32_t avail = groups[g].matchAvailable();
-                if (avail) {
-                    firstAvailG = g;
-                    firstAvailI = (uint32_t)__builtin_ctz(avail);
-                }
-            }
-            if (groups[g].matchEmpty()) break; // end of probe chain
-            g = (g + 1) & gMask;
-        }
+    FreeBlock*         freeLists[NUM_CLASSES] = {};
+    std::vector<void*> slabs;
+    Stats              st = {};
 
-        // Insert into first available slot
-        assert(firstAvailG != ~0u);
-        uint32_t idx = firstAvailG * 16 + firstAvailI;
-        groups[firstAvailG].ctrl[firstAvailI] = h;
-        slots[idx].key = key;
-        slots[idx].val = TValue::Nil();
-        count++;
-        return &slots[idx].val;
+    TableAllocator() = default;
+    ~TableAllocator() {
+        for (void* slab : slabs) ::operator delete(slab, std::align_val_t{64});
     }
+    TableAllocator(const TableAllocator&) = delete;
+    TableAllocator& operator=(const TableAllocator&) = delete;
 
-    // Remove key. Returns true if found.
+    // Carve a fresh slab into blocks of class c; returns the first block
+    NOINLINE FreeBlock* refill(uint32_t c) {
+        size_t size = classSize(c);
+        char*  slab = static_cast<char*>(::operator new(SLAB_BYTES, std::align_val_t{64}));
+        slabs.push_back(slab);
+        st.slabBytes += SLAB_BYTES;
+        st.classes[c].slabs++;
+        FreeBlock* head = nullptr;
+        for (size_t off = SLAB_BYTES; off > size; off -= size) {
+            FreeBlock* b = reinterpret_cast<FreeBlock*>(slab + off - size);
+            b->next = head;
+            head = b;
+        }
+        freeLists[c] = head;
+        return reinterpret_cast<FreeBlock*>(slab);
+    }
+
+    NOINLINE void* allocateLarge(size_t bytes) {
+        st.largeAllocs++;
+        return ::operator new(bytes, std::align_val_t{64});
+    }
+
+    NOINLINE void deallocateLarge(void* p) {
+        st.largeFrees++;
+        ::operator delete(p, std::align_val_t{64});
+    }
+};
+
+// ============================================================
+// LuaGC — incremental mark & sweep collector
+//
+// Every LuaTable (LuaTable::create) and closure (TValue::NewFunction)
+// is tracked. Roots are registered slots (module state, G) plus a
+// conservative scan of the C++ stack and registers, because transpiled
+// code keeps values in ordinary C++ locals. Marking is incremental with
+// a backward write barrier on black tables; roots and the stack are
+// rescanned in the atomic phase before sweeping.
+//
+// Closure upvalues live inline in the closure block and are scanned
+// conservatively like the stack. Only the stack of the thread that owns
+// stackBase is scanned. Coroutine threads are closures whose trace entry
+// scans their heap frames; as those change while the thread runs, marked
+// threads are traced again in the atomic phase.
+// ============================================================
+enum : uint32_t { GC_WHITE = 0, GC_GRAY = 1, GC_BLACK = 2 };
+
+class LuaGC {
+public:
+    enum class Phase : uint8_t { Pause, Propagate, Sweep };
+
+    // The running State's collector (defined after State)
+    static LuaGC& instance();
+
+    // Bytes owned by tables (headers, array and hash parts), closures and strings
+    ALWAYS_INLINE void accountAlloc(size_t n) { totalBytes += n; }
+    ALWAYS_INLINE void accountFree(size_t n)  { totalBytes -= n; }
+
+    // Called before each allocation: performs a step when in debt
+    ALWAYS_INLINE void checkStep() {
+        if (UNLIKELY(totalBytes >= threshold)) step();
+    }
+
+    void trackTable(LuaTable* t);
+    void trackClosure(Closure* c);
+    void trackString(LuaString* s);
+    NOINLINE inline void barrier(LuaTable* t);
+
+    void addRoot(TValue* slot) { roots.push_back(slot); }
+    void removeRoot(TValue* slot);
+    // STRING (const char*) variables outside the stack
+    void addRoot(const char** slot) { stringRoots.push_back(slot); }
+    void removeRoot(const char** slot);
+    void setStackBase(const void* base);
+
+    bool step();          // one incremental step; true if a cycle finished
+    void fullCollect();
+    void stop();
+    void restart();
+    bool isRunning() const { return running; }
+
+    // Same meaning as Lua's setpause / setstepmul (percent); return old value
+    int setPause(int p)   { int old = pause;   pause = p;   return old; }
+    int setStepMul(int m) { int old = stepMul; stepMul = m; return old; }
+
+    // Mark what the words in [lo, hi) may reference (closure traces)
+    void scanRange(const void* lo, const void* hi);
+
+    size_t   bytes()        const { return totalBytes; }
+    size_t   tableCount()   const { return tables.size(); }
+    size_t   closureCount() const { return closures.size(); }
+    size_t   stringCount()  const { return strings.size(); }
+    uint64_t cycles()       const { return cycleCount; }
+    Phase    phase()        const { return currentPhase; }
+
+private:
+    static constexpr size_t STEP_BYTES    = 64 * 1024;    // allocation between steps
+    static constexpr size_t MIN_THRESHOLD = 1024 * 1024;  // never collect below 1 MB
+
+    std::vector<LuaTable*>         tables;
+    std::vector<Closure*>          closures;
+    std::vector<uint8_t>           closureMarks;   // parallel to closures[0..markedClosures)
+    size_t                         markedClosures = 0;
+    std::vector<const Closure*>    grayClosures;
+    std::vector<LuaString*>        strings;
+    std::vector<uint8_t>           stringMarks;    // parallel to strings[0..markedStrings)
+    size_t                         markedStrings = 0;
+    std::vector<LuaTable*>         gray;
+    std::vector<TValue*>           roots;
+    std::vector<const char**>      stringRoots;
+
+    size_t    totalBytes = 0;
+    size_t    threshold  = MIN_THRESHOLD;
+    size_t    sweepPos = 0, sweepKeep = 0, sweepEnd = 0;
+    uintptr_t stackBase  = 0;
+    uint64_t  cycleCount = 0;
+    int       pause = 200, stepMul = 200;
+    Phase     currentPhase = Phase::Pause;
+    bool      running = true;
+
+    friend struct l2c::State;
+
+    LuaGC();
+    LuaGC(const LuaGC&) = delete;
+    LuaGC& operator=(const LuaGC&) = delete;
+
+    void   startCycle();
+    void   markRoots();
+    ALWAYS_INLINE void markTable(LuaTable* t);
+    ALWAYS_INLINE void markValue(TValue v);
+    void   markClosure(const void* p);
+    void   markString(const void* p);
+    size_t propagate(size_t budget);
+    void   atomic();
+    bool   sweep(size_t budget);
+    void   sweepClosures();
+    void   sweepStrings();
+    void   finishCycle();
+    void   finishCurrentCycle();
+    void   releaseAll();
+    NOINLINE inline void scanStack();
+    NOINLINE inline void scanStackFrom();
+    void   traceClosure(const Closure* c);
+    void   markConservative(uintptr_t word);
+};
+
+namespace l2c {
+    // ============================================================
+    // State — everything one running script owns
+    //
+    // The pools its tables, closures and strings come from, its intern
+    // table and its collector. Every thread runs its own State, created
+    // on its first use of the runtime and released when the thread ends
+    // (the main thread's is left to the system at exit, as before).
+    // Generated module state, inline caches and the coroutine, io and
+    // pattern caches are thread_local too, so a process can run
+    // independent instances of a module on as many threads. Values must
+    // not cross threads; the constant keys interned during static
+    // initialization (l2c::intern) are shared read-only.
+    // ============================================================
+    struct State {
+        TableAllocator allocator;
+        StringPool     strings{&StringPool::constants()};
+        LuaGC          gc;
+        uint64_t       random = 0;  // math.random generator, seeded on first use
+        bool           mainThread;
+
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        // The calling thread's State
+        static ALWAYS_INLINE State& current();
+
+    private:
+        State();
+        ~State();
+
+        static State& start();
+    };
+
+    inline thread_local State* current_state = nullptr;
+
+    ALWAYS_INLINE State& State::current() {
+        State* s = current_state;
+        return LIKELY(s != nullptr) ? *s : start();
+    }
+
+    NOINLINE inline State& State::start() {
+        static thread_local State state;
+        current_state = &state;
+        return state;
+    }
+} // namespace l2c
+
+ALWAYS_INLINE StringPool& StringPool::instance() { return l2c::State::current().strings; }
+ALWAYS_INLINE TableAllocator& TableAllocator::instance() { return l2c::State::current().allocator; }
+ALWAYS_INLINE LuaGC& LuaGC::instance() { return l2c::State::current().gc; }
+
+// ============================================================
+// HashPart — Swiss Table open-addressed hash
+//
+// Layout: groups of HashGroup::WIDTH ctrl bytes, followed in the same
+// block by each slot's full 32-bit hash, and the corresponding
+// HashSlots in a parallel array. capacity is a power of 2, at least
+// MIN_CAPACITY: a part smaller than a group has one, whose slots past
+// capacity are SENTINEL. A rebuild reinserts keys by their stored hash,
+// without touching the strings they point to.
+// ============================================================
+struct HashPart {
+    static constexpr uint32_t WIDTH = HashGroup::WIDTH;
+    static constexpr uint32_t MIN_CAPACITY = 4;
+
+    HashGroup* groups;   // ctrl bytes, numGroups groups, then capacity hashes
+    HashSlot*  slots;    // parallel slot array, capacity slots
+    uint32_t   capacity; // total slots (numGroups * WIDTH, or fewer in one group)
+    uint32_t   count;    // occupied slots (a stored nil keeps its key)
+    uint32_t   numGroups;
+    uint32_t   tombstones; // CTRL_DELETED slots; they lengthen probes until a rebuild
+
+    // Derived: high bits of hash select group (h1), low 7 bits = h2
+    ALWAYS_INLINE uint32_t h1(uint32_t hash) const {
+        return (hash >> 7) % numGroups;
+    }
+    ALWAYS_INLINE int8_t h2(uint32_t hash) const {
+        return (int8_t)(hash & 0x7f);
+    }
+
+    ALWAYS_INLINE int8_t ctrlAt(uint32_t idx) const { return groups[idx / WIDTH].ctrl[idx % WIDTH]; }
+    // hashTValue of each occupied slot's key
+    ALWAYS_INLINE uint32_t* hashes() const { return reinterpret_cast<uint32_t*>(groups + numGroups); }
+    size_t ctrlBytes() const { return ctrlBytesFor(capacity); }
+
+    static constexpr uint32_t groupsFor(uint32_t cap) { return cap < WIDTH ? 1 : cap / WIDTH; }
+    static constexpr size_t ctrlBytesFor(uint32_t cap) {
+        return groupsFor(cap) * sizeof(HashGroup) + cap * sizeof(uint32_t);
+    }
+    // One block for both: ctrl groups and hashes, then the slots
+    static constexpr size_t bytesFor(uint32_t cap) { return ctrlBytesFor(cap) + cap * sizeof(HashSlot); }
+    // Smallest capacity holding n entries under the load factor (needsRehash)
+    static constexpr uint32_t capacityFor(uint32_t n) {
+        uint32_t cap = MIN_CAPACITY;
+        while (n > cap * 7 / 8) cap <<= 1;
+        return cap;
+    }
+
+    void init(uint32_t cap) {
+        // Allocate ctrl groups + slots from the table pool
+        TableAllocator& pool = TableAllocator::instance();
+        setup(cap, pool.allocate(ctrlBytesFor(cap)), pool.allocate(cap * sizeof(HashSlot)));
+        LuaGC::instance().accountAlloc(bytes());
+    }
+
+    // A part in bytesFor(cap) bytes at mem, which the caller owns and
+    // frees instead of destroy()
+    void initIn(uint32_t cap, void* mem) {
+        setup(cap, mem, static_cast<char*>(mem) + ctrlBytesFor(cap));
+    }
+
+    // A part already laid out in bytesFor(cap) bytes at mem, holding n
+    // entries and no tombstones (a mapped snapshot's; see lua_snapshot.hpp)
+    void adopt(uint32_t cap, uint32_t n, void* mem) {
+        capacity  = cap;
+        numGroups = groupsFor(cap);
+        count     = n;
+        tombstones = 0;
+        groups = static_cast<HashGroup*>(mem);
+        slots  = reinterpret_cast<HashSlot*>(static_cast<char*>(mem) + ctrlBytesFor(cap));
+    }
+
+    void setup(uint32_t cap, void* ctrl, void* slotMem) {
+        assert((cap & (cap - 1)) == 0 && cap >= MIN_CAPACITY);
+        capacity  = cap;
+        numGroups = groupsFor(cap);
+        count     = 0;
+        tombstones = 0;
+        groups = static_cast<HashGroup*>(ctrl);
+        slots  = static_cast<HashSlot*>(slotMem);
+        if (cap < WIDTH) groups[0].init(cap);
+        else for (uint32_t i = 0; i < numGroups; i++) groups[i].init();
+    }
+
+    void destroy() {
+        LuaGC::instance().accountFree(bytes());
+        TableAllocator& pool = TableAllocator::instance();
+        pool.deallocate(groups, ctrlBytes());
+        pool.deallocate(slots, capacity * sizeof(HashSlot));
+        groups = nullptr; slots = nullptr;
+        capacity = count = numGroups = tombstones = 0;
+    }
+
+    // Returns the slot index holding key, or -1 if not found
+    ALWAYS_INLINE int32_t findIndex(TValue key) const {
+        if (UNLIKELY(capacity == 0)) return -1;
+        uint32_t hash = hashTValue(key);
+        uint32_t g    = h1(hash);
+        int8_t   h    = h2(hash);
+        uint32_t gMask = numGroups - 1;
+        L2C_STAT(HASH_LOOKUP);
+        L2C_STATS_ONLY(uint32_t probed = 1;)
+
+        for (;;) {
+            HashGroup::Mask matches = groups[g].matchH2(h);
+            while (matches) {
+                uint32_t idx = g * WIDTH + HashGroup::slotOf(matches);
+                if (LIKELY(slots[idx].key == key)) {
+                    L2C_STAT_PROBE(probed);
+                    return (int32_t)idx;
+                }
+                matches &= matches - 1;
+            }
+            if (LIKELY(groups[g].matchEmpty())) {
+                L2C_STAT_PROBE(probed);
+                return -1; // probe sequence terminated
+            }
+            g = (g + 1) & gMask;
+            L2C_STATS_ONLY(probed++;)
+        }
+    }
+
+    // Returns pointer to value for key, or nullptr if not found
+    ALWAYS_INLINE TValue* find(TValue key) const {
+        int32_t idx = findIndex(key);
+        return idx < 0 ? nullptr : &slots[idx].val;
+    }
+
+    // True if slot idx holds a live entry for key (bitwise key compare,
+    // so interned strings compare by pointer)
+    ALWAYS_INLINE bool liveAt(uint32_t idx, TValue key) const {
+        return ctrlAt(idx) >= 0 && slots[idx].key.bits == key.bits;
+    }
+
+    // Insert or update key. Returns pointer to value slot.
+    // Caller must check load factor before calling.
+    TValue* upsert(TValue key) { return upsert(key, hashTValue(key)); }
+
+    NOINLINE TValue* upsert(TValue key, uint32_t hash) {
+        uint32_t g     = h1(hash);
+        int8_t   h     = h2(hash);
+        uint32_t gMask = numGroups - 1;
+        uint32_t firstAvail = ~0u;
+
+        for (;;) {
+            HashGroup::Mask matches = groups[g].matchH2(h);
+            while (matches) {
+                uint32_t idx = g * WIDTH + HashGroup::slotOf(matches);
+                if (LIKELY(slots[idx].key == key))
+                    return &slots[idx].val; // update existing
+                matches &= matches - 1;
+            }
+            // Track first available (empty or deleted) slot
+            if (firstAvail == ~0u) {
+                HashGroup::Mask avail = groups[g].matchAvailable();
+                if (avail) firstAvail = g * WIDTH + HashGroup::slotOf(avail);
+            }
+            if (groups[g].matchEmpty()) break; // end of probe chain
+            g = (g + 1) & gMask;
+        }
+
+        // Insert into first available slot
+        assert(firstAvail != ~0u);
+        tombstones -= ctrlAt(firstAvail) == CTRL_DELETED;
+        return fill(firstAvail, key, hash);
+    }
+
+    // Insert a key known to be absent, into a part without tombstones
+    // (a rebuild's new part)
+    TValue* insertNew(TValue key, uint32_t hash) {
+        uint32_t g     = h1(hash);
+        uint32_t gMask = numGroups - 1;
+        HashGroup::Mask avail;
+        while (!(avail = groups[g].matchAvailable())) g = (g + 1) & gMask;
+        return fill(g * WIDTH + HashGroup::slotOf(avail), key, hash);
+    }
+
+    ALWAYS_INLINE TValue* fill(uint32_t idx, TValue key, uint32_t hash) {
+        groups[idx / WIDTH].ctrl[idx % WIDTH] = h2(hash);
+        hashes()[idx] = hash;
+        slots[idx].key = key;
+        slots[idx].val = TValue::Nil();
+        count++;
+        return &slots[idx].val;
+    }
+
+    // Remove key. Returns true if found.
     bool remove(TValue key) {
         if (UNLIKELY(capacity == 0)) return false;
         uint32_t hash  = hashTValue(key);
@@ -479,16 +1537,11 @@ struct HashPart {
         uint32_t gMask = numGroups - 1;
 
         for (;;) {
-            uint32_t matches = groups[g].matchH2(h);
+            HashGroup::Mask matches = groups[g].matchH2(h);
             while (matches) {
-                uint32_t i   = (uint32_t)__builtin_ctz(matches);
-                uint32_t idx = g * 16 + i;
+                uint32_t idx = g * WIDTH + HashGroup::slotOf(matches);
                 if (slots[idx].key == key) {
-                    // Use DELETED only if next group has entries
-                    // (optimization: use EMPTY if no chain follows)
-                    groups[g].ctrl[i] = CTRL_DELETED;
-                    slots[idx].val = TValue::Nil();
-                    count--;
+                    eraseAt(idx);
                     return true;
                 }
                 matches &= matches - 1;
@@ -498,12 +1551,85 @@ struct HashPart {
         }
     }
 
-    // Load factor threshold: 87.5% = 14/16 per group
+    // Free the occupied slot idx. A group that still has an EMPTY slot
+    // has never been full, so no probe sequence continues past it and
+    // the slot can go straight back to EMPTY; otherwise it must stay a
+    // DELETED tombstone to keep later chains reachable.
+    void eraseAt(uint32_t idx) {
+        HashGroup& grp = groups[idx / WIDTH];
+        if (grp.matchEmpty()) {
+            grp.ctrl[idx % WIDTH] = CTRL_EMPTY;
+        } else {
+            grp.ctrl[idx % WIDTH] = CTRL_DELETED;
+            tombstones++;
+        }
+        slots[idx].val = TValue::Nil();
+        count--;
+    }
+
+    // Heap footprint of ctrl groups, hashes and slots
+    size_t bytes() const {
+        return ctrlBytes() + capacity * sizeof(HashSlot);
+    }
+
+    // Load factor threshold: 87.5% of the slots. Tombstones count
+    // as load, so delete/insert churn ends in a compacting rebuild
+    // instead of ever-longer probe chains.
     bool needsRehash() const {
-        return capacity == 0 || count >= (capacity * 7 / 8);
+        return capacity == 0 || count + tombstones >= (capacity * 7 / 8);
     }
 };
 
+// Array part representation. ARRAY_NUMBER arrays hold floats in slots
+// [0, arrayCount) and nil above: the collector skips them and #t is
+// arrayCount. Float and nil bits are plain TValues, so the first store
+// that breaks the invariant switches to ARRAY_GENERIC without copying.
+enum ArrayKind : uint8_t { ARRAY_GENERIC = 0, ARRAY_NUMBER = 1 };
+
+namespace l2c {
+    // Record shape: the fixed key set of a constructor like {re = x, im = y}.
+    // The transpiler declares one per record constructor; tables created
+    // with it keep those fields inline after the header, in key order, so
+    // generated accesses are a shape-id compare and a fixed-offset load.
+    // Other keys live in the array and hash parts as usual, and generic
+    // lookups and next() see the fields, so shaped tables stay ordinary
+    // tables for pairs, rawget or dynamic keys.
+    struct Shape {
+        static constexpr uint32_t MAX_FIELDS = 16;
+
+        uint16_t id;
+        uint32_t count;
+        TValue   keys[MAX_FIELDS];  // interned strings
+
+        Shape(std::initializer_list<TValue> k) : id(0), count((uint32_t)k.size()) {
+            assert(k.size() <= MAX_FIELDS);
+            std::copy(k.begin(), k.end(), keys);
+            std::vector<const Shape*>& all = registry();
+            assert(all.size() < 0xffff);
+            id = (uint16_t)all.size();
+            all.push_back(this);
+        }
+        Shape(const Shape&) = delete;
+        Shape& operator=(const Shape&) = delete;
+
+        // Slot of key, or -1
+        int indexOf(TValue key) const {
+            if (!key.isString()) return -1;
+            for (uint32_t i = 0; i < count; i++)
+                if (keys[i] == key) return (int)i;
+            return -1;
+        }
+
+        static const Shape* byId(uint16_t id) { return registry()[id]; }
+
+    private:
+        static std::vector<const Shape*>& registry() {
+            static std::vector<const Shape*> all{ nullptr };  // id 0 = no shape
+            return all;
+        }
+    };
+} // namespace l2c
+
 // ============================================================
 // LuaTable — the main table structure
 // ============================================================
@@ -515,21 +1641,119 @@ struct alignas(64) LuaTable {
     HashPart hash;        // Swiss Table hash part
     // ---- Cache line 1+ (cold fields) ----
     LuaTable* metatable;
-    uint32_t  flags;      // metamethod cache flags
-    uint32_t  gcMark;
+    uint32_t  flags;      // metamethod cache: bit e set = no TMS e here; INLINE_* bits
+    uint8_t   gcMark;
+    uint8_t   arrayKind;  // ArrayKind
+    uint16_t  shapeId;    // l2c::Shape of the inline fields, 0 = none
+    // Shaped tables: shape->count TValue fields follow the header.
+    // Small tables: their inline hash part, then inline array part.
 
     LuaTable() : array(nullptr), arraySize(0), arrayCount(0),
-                 metatable(nullptr), flags(0), gcMark(0) {
+                 metatable(nullptr), flags(0), gcMark(0), arrayKind(ARRAY_GENERIC),
+                 shapeId(0) {
         hash.groups   = nullptr;
         hash.slots    = nullptr;
         hash.capacity = 0;
         hash.count    = 0;
         hash.numGroups = 0;
+        hash.tombstones = 0;
     }
 
     ~LuaTable() {
-        if (array)         ::operator delete(array);
-        if (hash.capacity) hash.destroy();
+        freeArray();
+        freeHash();
+    }
+
+    // Backward write barrier: a black table that gains a reference must be
+    // revisited before the cycle's atomic phase
+    ALWAYS_INLINE void gcBarrier() {
+        if (UNLIKELY(gcMark == GC_BLACK)) LuaGC::instance().barrier(this);
+    }
+
+    // ================================================================
+    // Inline record fields (see l2c::Shape)
+    // ================================================================
+    ALWAYS_INLINE TValue*       fields()       { return reinterpret_cast<TValue*>(this + 1); }
+    ALWAYS_INLINE const TValue* fields() const { return reinterpret_cast<const TValue*>(this + 1); }
+    uint32_t fieldCount() const { return shapeId ? l2c::Shape::byId(shapeId)->count : 0; }
+    size_t   allocSize()  const {
+        return sizeof(LuaTable) + fieldCount() * sizeof(TValue)
+             + (flags & INLINE_HASH ? SMALL_HASH_BYTES : 0)
+             + (flags & INLINE_ARRAY ? SMALL_ARRAY * sizeof(TValue) : 0);
+    }
+
+    // ================================================================
+    // Small tables: create() places an array part of up to SMALL_ARRAY
+    // slots and a hash part of up to SMALL_HASH slots in the table's own
+    // allocation, after the header, so an empty or small table is one
+    // allocation. A part that outgrows its space moves out as usual and
+    // the space stays unused until the table is freed; the INLINE_*
+    // flag bits, which survive invalidateTMcache, record that it is there.
+    // The MAPPED_* bits mark parts the table doesn't own, which are never
+    // freed: a mapped snapshot's (lua_snapshot.hpp) or a constant table's
+    // static ones (l2c::ConstTable). They are cleared when the part moves out.
+    // ================================================================
+    static constexpr uint32_t SMALL_ARRAY = 4;
+    static constexpr uint32_t SMALL_HASH  = HashPart::MIN_CAPACITY;
+    static constexpr size_t   SMALL_HASH_BYTES = HashPart::bytesFor(SMALL_HASH);
+    static constexpr uint32_t MAPPED_ARRAY = 1u << 28;
+    static constexpr uint32_t MAPPED_HASH  = 1u << 29;
+    static constexpr uint32_t INLINE_ARRAY = 1u << 30;
+    static constexpr uint32_t INLINE_HASH  = 1u << 31;
+    static constexpr uint32_t PART_FLAGS   = MAPPED_ARRAY | MAPPED_HASH | INLINE_ARRAY | INLINE_HASH;
+    static_assert(TM_N <= 28, "metamethod cache bits overlap the part flag bits");
+
+    char*   inlineSpace()  { return reinterpret_cast<char*>(this + 1); }
+    TValue* inlineArray()  { return reinterpret_cast<TValue*>(inlineSpace() + (flags & INLINE_HASH ? SMALL_HASH_BYTES : 0)); }
+
+    // Release the array part, unless it is the inline or a mapped one
+    void freeArray() {
+        if (UNLIKELY(flags & MAPPED_ARRAY)) { flags &= ~MAPPED_ARRAY; return; }
+        if (!array || ((flags & INLINE_ARRAY) && array == inlineArray())) return;
+        LuaGC::instance().accountFree(arraySize * sizeof(TValue));
+        TableAllocator::instance().deallocate(array, arraySize * sizeof(TValue));
+    }
+
+    // Release the hash part, unless it is the inline or a mapped one
+    void freeHash() {
+        if (UNLIKELY(flags & MAPPED_HASH)) { flags &= ~MAPPED_HASH; return; }
+        if (hash.capacity && !((flags & INLINE_HASH) && reinterpret_cast<char*>(hash.groups) == inlineSpace()))
+            hash.destroy();
+    }
+
+    NOINLINE const TValue* shapeFind(TValue key) const {
+        int i = l2c::Shape::byId(shapeId)->indexOf(key);
+        return i < 0 ? nullptr : &fields()[i];
+    }
+    TValue* shapeFind(TValue key) {
+        return const_cast<TValue*>(static_cast<const LuaTable*>(this)->shapeFind(key));
+    }
+
+    // ================================================================
+    // Metamethod lookup with negative caching (Lua's fasttm): once an
+    // event is found absent its flags bit short-circuits later lookups
+    // until a "__" key is stored into this table
+    // ================================================================
+    ALWAYS_INLINE const TValue* fasttm(TMS e) {
+        if (LIKELY(flags & (1u << e))) return nullptr;
+        return gettm(e);
+    }
+
+    NOINLINE const TValue* gettm(TMS e) {
+        const TValue* mm = shapeId ? shapeFind(l2c::tm_name(e)) : nullptr;
+        if (!mm) mm = hash.find(l2c::tm_name(e));
+        if (!mm || mm->isNil()) {
+            flags |= 1u << e;
+            return nullptr;
+        }
+        return mm;
+    }
+
+    ALWAYS_INLINE void invalidateTMcache(TValue key) {
+        if (key.isString()) {
+            const char* s = static_cast<const char*>(key.toPtr());
+            if (s[0] == '_' && s[1] == '_') flags &= PART_FLAGS;
+        }
     }
 
     // ================================================================
@@ -540,8 +1764,10 @@ struct alignas(64) LuaTable {
         // Fast path 1: integer key in array range
         if (LIKELY(key.isInteger())) {
             uint32_t i = (uint32_t)(key.toInteger() - 1); // 0-indexed
-            if (LIKELY(i < arraySize))
+            if (LIKELY(i < arraySize)) {
+                L2C_STAT(ARRAY_GET);
                 return array[i];
+            }
             // Fall through to hash
         }
         // Fast path 2: double that is a representable integer
@@ -550,12 +1776,18 @@ struct alignas(64) LuaTable {
             uint32_t i = (uint32_t)(int32_t)d;
             if (LIKELY((double)(int32_t)i == d)) {
                 uint32_t ai = i - 1;
-                if (LIKELY(ai < arraySize))
+                if (LIKELY(ai < arraySize)) {
+                    L2C_STAT(ARRAY_GET);
                     return array[ai];
+                }
                 key = TValue::Integer((int32_t)i); // normalize
             }
         }
+        if (UNLIKELY(shapeId)) {
+            if (const TValue* f = shapeFind(key)) { L2C_STAT(SHAPE_GET); return *f; }
+        }
         // Hash lookup
+        L2C_STAT(HASH_GET);
         TValue* v = hash.find(key);
         return v ? *v : TValue::Nil();
     }
@@ -579,6 +1811,9 @@ struct alignas(64) LuaTable {
             if ((double)i == d)
                 key = TValue::Integer(i);
         }
+        if (UNLIKELY(shapeId)) {
+            if (auto* f = shapeFind(key)) return f->isNil() ? nullptr : f;
+        }
         // Hash lookup
         return hash.find(key);
     }
@@ -598,6 +1833,9 @@ struct alignas(64) LuaTable {
             if ((double)i == d)
                 key = TValue::Integer(i);
         }
+        if (UNLIKELY(shapeId)) {
+            if (auto* f = shapeFind(key)) return f->isNil() ? nullptr : f;
+        }
         // Hash lookup
         return hash.find(key);
     }
@@ -607,22 +1845,24 @@ struct alignas(64) LuaTable {
     // ================================================================
     ALWAYS_INLINE void rawset(TValue key, TValue val) {
         assert(!key.isNil()); // Lua: table index is nil → error
+        gcBarrier();
 
         // Fast path: integer key in existing array
         if (LIKELY(key.isInteger())) {
             uint32_t i = (uint32_t)(key.toInteger() - 1);
             if (LIKELY(i < arraySize)) {
-                bool wasNil = array[i].isNil();
-                array[i] = val;
-                if (wasNil && !val.isNil()) arrayCount++;
-                else if (!wasNil && val.isNil()) arrayCount--;
+                arrayset(i, val);
                 return;
             }
             // Integer key just beyond array — maybe grow array
             if ((int32_t)key.toInteger() == (int32_t)(arraySize + 1) && !val.isNil()) {
+                if (arrayKind == ARRAY_NUMBER && !(val.isNumber() && arrayCount == arraySize))
+                    arrayKind = ARRAY_GENERIC;
                 growArray(arraySize + 1);
+                L2C_STAT(ARRAY_SET);
+                // growArray may have pulled the key itself out of the hash
+                arrayCount += array[i].isNil();
                 array[i] = val;
-                arrayCount++;
                 return;
             }
         }
@@ -634,15 +1874,47 @@ struct alignas(64) LuaTable {
                 key = TValue::Integer(i);
         }
 
+        if (UNLIKELY(shapeId)) {
+            if (TValue* f = shapeFind(key)) { invalidateTMcache(key); *f = val; return; }
+        }
         // Hash part write
         hashSet(key, val);
     }
 
+    // ================================================================
+    // arrayset — write array slot i (key i + 1, i < arraySize), keeping
+    // arrayCount and arrayKind right; rawset's fast path, and what loops
+    // whose range l2c::array_span checked store through
+    // ================================================================
+    ALWAYS_INLINE void arrayset(uint32_t i, TValue val) {
+        gcBarrier();  // a no-op after rawset's own
+        L2C_STAT(ARRAY_SET);
+        if (arrayKind == ARRAY_NUMBER) {
+            if (LIKELY(val.isNumber() && i <= arrayCount)) {
+                array[i] = val;
+                arrayCount += (i == arrayCount);
+                return;
+            }
+            if (val.isNil() && i + 1 >= arrayCount) {
+                // Popping the last element keeps the prefix dense
+                if (i + 1 == arrayCount) { array[i] = val; arrayCount--; }
+                return;
+            }
+            arrayKind = ARRAY_GENERIC;
+        }
+        bool wasNil = array[i].isNil();
+        array[i] = val;
+        if (wasNil && !val.isNil()) arrayCount++;
+        else if (!wasNil && val.isNil()) arrayCount--;
+    }
+
     // ================================================================
     // rawsetref — return reference to value slot for assignment
     // Used by operator[] to enable table[key] = value syntax
     // ================================================================
     ALWAYS_INLINE TValue& rawsetref(TValue key) {
+        gcBarrier();  // caller writes through the returned reference
+        arrayKind = ARRAY_GENERIC;  // ...and may store anything
         // Fast path: integer key in existing array
         if (LIKELY(key.isInteger())) {
             uint32_t i = (uint32_t)(key.toInteger() - 1);
@@ -652,7 +1924,7 @@ struct alignas(64) LuaTable {
             // Integer key just beyond array — grow array
             if ((int32_t)key.toInteger() == (int32_t)(arraySize + 1)) {
                 growArray(arraySize + 1);
-                arrayCount++;
+                arrayCount += array[i].isNil();
                 return array[i];
             }
         }
@@ -664,56 +1936,127 @@ struct alignas(64) LuaTable {
                 key = TValue::Integer(i);
         }
 
+        if (UNLIKELY(shapeId)) {
+            if (TValue* f = shapeFind(key)) { invalidateTMcache(key); return *f; }
+        }
         // Hash part write - return reference to slot
-        if (UNLIKELY(hash.needsRehash())) {
-            uint32_t newCap = (hash.capacity == 0) ? 16 : hash.capacity * 2;
-            rebuildHash(newCap);
+        invalidateTMcache(key);
+        if (UNLIKELY(hash.needsRehash()) && !hash.find(key)) {
+            rehash(key);
+            if (key.isInteger() && (uint32_t)(key.toInteger() - 1) < arraySize) return rawsetref(key);
         }
         TValue* slot = hash.upsert(key);
         return *slot;
     }
 
     // ================================================================
-    // Length operator (#t) — binary search for sequence boundary
+    // Length operator (#t). arrayCount is kept exact on every store and
+    // is the border whenever the array part has no holes, so — like Lua
+    // 5.4's alimit hint — it is probed first: #t after an append, insert
+    // or pop costs two loads. Only tables with holes binary-search, and
+    // integer keys spilled to the hash use an unbound (doubling) search.
     // ================================================================
     uint32_t length() const {
-        // Fast path: array is fully packed
-        if (arrayCount == arraySize && arraySize > 0 && array[arraySize-1].isNil())
-            ; // fall through
-        if (arraySize > 0) {
-            // Find last non-nil in array using binary search
-            if (!array[arraySize-1].isNil()) {
-                // Check hash for keys beyond arraySize
-                uint32_t j = arraySize + 1;
-                while (true) {
-                    TValue* v = hash.find(TValue::Integer((int32_t)j));
-                    if (!v || v->isNil()) return j - 1;
-                    j++;
-                }
+        // Number arrays are dense up to arrayCount, which is a border
+        // unless the array part is full (the sequence may go on in hash)
+        if (arrayKind == ARRAY_NUMBER && arrayCount < arraySize) return arrayCount;
+        if (arraySize > 0 && array[arraySize - 1].isNil()) {
+            // The border is inside the array part
+            uint32_t b = arrayCount < arraySize ? arrayCount : arraySize - 1;
+            if (b == 0 || !array[b - 1].isNil()) {
+                if (array[b].isNil()) return b;
+                return arrayBorder(b + 1, arraySize - 1);
             }
-            // Binary search within array
-            uint32_t lo = 0, hi = arraySize;
-            while (lo < hi) {
-                uint32_t mid = (lo + hi) / 2;
-                if (array[mid].isNil()) hi = mid;
-                else                    lo = mid + 1;
+            return arrayBorder(0, b - 1);
+        }
+        // Array part empty or full: the sequence may continue in the hash
+        return hashBorder(arraySize);
+    }
+
+private:
+    // Border in [i, j] given (i == 0 || array[i-1] != nil) and array[j] == nil
+    uint32_t arrayBorder(uint32_t i, uint32_t j) const {
+        while (i < j) {
+            uint32_t m = i + (j - i) / 2;
+            if (array[m].isNil()) j = m;
+            else                  i = m + 1;
+        }
+        return i;
+    }
+
+    // Border at or above j, given j == 0 or t[j] != nil: doubles until an
+    // absent key, then binary-searches (Lua's hash_search)
+    NOINLINE uint32_t hashBorder(uint32_t j) const {
+        auto present = [this](uint32_t k) {
+            const TValue* v = hash.find(TValue::Integer((int32_t)k));
+            return v && !v->isNil();
+        };
+        if (!present(j + 1)) return j;
+        uint32_t i = j + 1;  // t[i] != nil
+        j = i * 2;
+        while (present(j)) {
+            i = j;
+            if (j > 0x3fffffffu) {
+                // Overflow guard: fall back to a linear walk
+                while (present(i + 1)) i++;
+                return i;
             }
-            return lo; // lo is the length (1-indexed count)
+            j *= 2;
         }
-        // Pure hash table: linear probe for integer keys
-        uint32_t j = 1;
-        while (true) {
-            TValue* v = hash.find(TValue::Integer((int32_t)j));
-            if (!v || v->isNil()) return j - 1;
-            j++;
+        while (j - i > 1) {
+            uint32_t m = i + (j - i) / 2;
+            if (present(m)) i = m;
+            else            j = m;
         }
+        return i;
     }
 
+public:
     // ================================================================
     // next() — table iteration (like lua_next)
     // key = nil → returns first key; key = last → returns nil, nil
     // ================================================================
     bool next(TValue& key, TValue& val) const {
+        // Inline record fields come first
+        if (UNLIKELY(shapeId) && (key.isNil() || key.isString())) {
+            const l2c::Shape* shape = l2c::Shape::byId(shapeId);
+            int at = key.isNil() ? -1 : shape->indexOf(key);
+            if (key.isNil() || at >= 0) {
+                for (uint32_t i = (uint32_t)(at + 1); i < shape->count; i++) {
+                    if (!fields()[i].isNil()) {
+                        key = shape->keys[i];
+                        val = fields()[i];
+                        return true;
+                    }
+                }
+                key = TValue::Nil();
+                return nextAfterFields(key, val);
+            }
+        }
+        return nextAfterFields(key, val);
+    }
+
+    // ================================================================
+    // nextAt() — stateful traversal for generated pairs() loops: pos is
+    // an opaque cursor (start at 0) over the array part, inline fields,
+    // then hash slots, so a step never re-locates the previous key.
+    // Same rules as next(): values may be changed or cleared while
+    // iterating, but no new keys added.
+    // ================================================================
+    ALWAYS_INLINE bool nextAt(uint32_t& pos, TValue& key, TValue& val) const {
+        while (pos < arraySize) {
+            const TValue& v = array[pos++];
+            if (LIKELY(!v.isNil())) {
+                key = TValue::Integer((int32_t)pos);
+                val = v;
+                return true;
+            }
+        }
+        return nextAfterArray(pos, key, val);
+    }
+
+private:
+    bool nextAfterFields(TValue& key, TValue& val) const {
         if (key.isNil()) {
             // Start: find first non-nil array entry
             for (uint32_t i = 0; i < arraySize; i++) {
@@ -724,7 +2067,7 @@ struct alignas(64) LuaTable {
                 }
             }
             // Then hash part
-            return nextInHash(~0u, key, val);
+            { uint32_t pos = 0; return nextSlot(pos, key, val); }
         }
         // Advance from current key
         if (key.isInteger()) {
@@ -738,34 +2081,48 @@ struct alignas(64) LuaTable {
                         return true;
                     }
                 }
-                return nextInHash(~0u, key, val);
+                { uint32_t pos = 0; return nextSlot(pos, key, val); }
             }
         }
-        // Find current position in hash and advance
-        if (hash.capacity == 0) return false;
-        uint32_t startGroup = findHashPos(key);
-        return nextInHash(startGroup, key, val);
+        // Find current slot in hash and advance past it
+        int32_t at = hash.findIndex(key);
+        if (at < 0) return false;
+        uint32_t pos = (uint32_t)at + 1;
+        return nextSlot(pos, key, val);
     }
 
-private:
     // ----------------------------------------------------------------
-    // growArray — resize array part to newSize (rounded up to pow2)
+    // growArray — resize array part to newSize (rounded up to pow2), or
+    // further when the hash part holds the keys to fill a larger one more
+    // than half, as after a backwards fill
     // ----------------------------------------------------------------
     NOINLINE void growArray(uint32_t needed) {
+        L2C_STAT(ARRAY_RESIZE);
         uint32_t newSize = 16;
         while (newSize < needed) newSize <<= 1;
+        if (hash.count) {
+            uint32_t live;
+            uint32_t optimal = optimalArraySize(TValue::Integer((int32_t)needed), live);
+            if (optimal > newSize) {
+                // Most of the hash part moves over: rebuild it smaller
+                resizeArray(optimal, live);
+                return;
+            }
+        }
 
-        TValue* newArr = (TValue*)::operator new(newSize * sizeof(TValue));
+        TableAllocator& pool = TableAllocator::instance();
+        TValue* newArr = (TValue*)pool.allocate(newSize * sizeof(TValue));
         for (uint32_t i = 0; i < newSize; i++) newArr[i] = TValue::Nil();
+        LuaGC::instance().accountAlloc(newSize * sizeof(TValue));
 
-        if (array) {
-            std::memcpy(newArr, array, arraySize * sizeof(TValue));
-            ::operator delete(array);
-        }
+        if (array) std::memcpy(newArr, array, arraySize * sizeof(TValue));
+        freeArray();
         array     = newArr;
         arraySize = newSize;
 
-        // Pull matching integer keys out of hash into array
+        // Pull matching integer keys out of hash into array; they may
+        // be of any type and leave holes
+        if (hash.count) arrayKind = ARRAY_GENERIC;
         rehashIntegerKeys();
     }
 
@@ -774,10 +2131,11 @@ private:
     // ----------------------------------------------------------------
     void rehashIntegerKeys() {
         if (hash.capacity == 0) return;
+        L2C_STAT(INT_REHASH);
         for (uint32_t g = 0; g < hash.numGroups; g++) {
-            for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t i = 0; i < HashPart::WIDTH; i++) {
                 if (hash.groups[g].ctrl[i] >= 0) { // live slot
-                    uint32_t idx = g * 16 + i;
+                    uint32_t idx = g * HashPart::WIDTH + i;
                     TValue k = hash.slots[idx].key;
                     if (k.isInteger()) {
                         int32_t ik = k.toInteger();
@@ -785,172 +2143,1236 @@ private:
                         if (ai < arraySize) {
                             array[ai] = hash.slots[idx].val;
                             if (!hash.slots[idx].val.isNil()) arrayCount++;
-                            hash.groups[g].ctrl[i] = CTRL_DELETED;
-                            hash.slots[idx].val    = TValue::Nil();
-                            hash.count--;
+                            hash.eraseAt(idx);
+                            L2C_STAT(KEYS_MIGRATED);
                         }
                     }
                 }
             }
         }
-    }
+    }
+
+    // ----------------------------------------------------------------
+    // hashSet — write to hash part, growing if necessary
+    // ----------------------------------------------------------------
+    NOINLINE void hashSet(TValue key, TValue val) {
+        L2C_STAT(HASH_SET);
+        invalidateTMcache(key);
+        if (val.isNil()) {
+            // Storing nil never inserts. A present key keeps its slot as
+            // a dead key so next() can still resume from it; the next
+            // rebuild drops it.
+            if (TValue* v = hash.find(key)) *v = val;
+            return;
+        }
+        if (UNLIKELY(hash.needsRehash()) && !hash.find(key)) {
+            rehash(key);
+            // The array part may have grown to take the key
+            if (key.isInteger() && (uint32_t)(key.toInteger() - 1) < arraySize) {
+                rawset(key, val);
+                return;
+            }
+        }
+        TValue* slot = hash.upsert(key);
+        *slot = val;
+    }
+
+    // ----------------------------------------------------------------
+    // rehash — resize both parts for their live entries plus key, which
+    // is about to be inserted (Lua's rehash/computesizes). The array part
+    // becomes the largest power of two n such that more than n/2 of the
+    // keys 1..n are present, and integer keys move between the parts to
+    // match: a table filled backwards or out of order ends up in its
+    // array, and an array emptied by removals gives its memory back.
+    // The hash part is sized from non-nil entries rather than by
+    // doubling, so a part full of dead keys and tombstones is compacted
+    // in place or shrunk. Leaves at least 1/8 headroom below the rehash
+    // threshold, so churn rebuilds amortize to O(1) per insert.
+    // ----------------------------------------------------------------
+    NOINLINE void rehash(TValue key) {
+        uint32_t live;
+        uint32_t newArray = optimalArraySize(key, live);
+        if (newArray != arraySize) {
+            resizeArray(newArray, live);
+            return;
+        }
+        uint32_t newCap = HashPart::MIN_CAPACITY;
+        while (live > newCap / 4 * 3) newCap *= 2;
+        rebuildHash(newCap);
+    }
+
+    // ----------------------------------------------------------------
+    // optimalArraySize — the array part computesizes picks for the keys
+    // of both parts plus key, one above arraySize that is about to be
+    // inserted. live is set to the hash part's non-nil entries plus one.
+    // ----------------------------------------------------------------
+    uint32_t optimalArraySize(TValue key, uint32_t& live) const {
+        // nums[b]: integer keys k with 2^(b-1) < k <= 2^b. Those in the
+        // hash are all above arraySize, like key.
+        uint32_t nums[32] = {};
+        uint32_t ints = 0;
+        auto countInt = [&](TValue k) {
+            if (k.isInteger() && k.toInteger() > 0) {
+                uint32_t n = (uint32_t)k.toInteger();
+                nums[n == 1 ? 0 : 32 - __builtin_clz(n - 1)]++;
+                ints++;
+            }
+        };
+        live = 1;
+        countInt(key);
+        for (uint32_t idx = 0; idx < hash.capacity; idx++) {
+            if (hash.ctrlAt(idx) >= 0 && !hash.slots[idx].val.isNil()) {
+                live++;
+                countInt(hash.slots[idx].key);
+            }
+        }
+
+        // An array part more than half full stays at least as large, so
+        // only a sparse one has to be counted key by key
+        bool dense = 2 * arrayCount > arraySize;
+        if (ints == 0 && dense) return arraySize;
+        uint32_t newArray = dense ? arraySize : 0;
+        uint32_t below = 0, b = 0;  // keys <= 2^(b-1)
+        if (dense) {
+            below = arrayCount;
+            while ((1ull << b) < arraySize) b++;
+        } else {
+            for (uint32_t i = 0; i < arraySize; i++) {
+                if (!array[i].isNil()) nums[i == 0 ? 0 : 32 - __builtin_clz(i)]++;
+            }
+        }
+        uint32_t total = arrayCount + ints;
+        for (; b < 32 && total > (1ull << b) / 2; b++) {
+            below += nums[b];
+            if (below > (1ull << b) / 2) newArray = 1u << b;
+        }
+        // The smallest array part growArray makes
+        return newArray > 0 && newArray < 16 ? 16 : newArray;
+    }
+
+    // ----------------------------------------------------------------
+    // resizeArray — give the array part newSize slots, rebuilding the
+    // hash part around it: keys above newSize move out of the array,
+    // keys in range move in. At most `live` entries end up in the hash.
+    // ----------------------------------------------------------------
+    NOINLINE void resizeArray(uint32_t newSize, uint32_t live) {
+        L2C_STAT(ARRAY_RESIZE);
+        TableAllocator& pool = TableAllocator::instance();
+        LuaGC& gc = LuaGC::instance();
+        for (uint32_t i = newSize; i < arraySize; i++) live += !array[i].isNil();
+        for (uint32_t idx = 0; idx < hash.capacity; idx++) {
+            if (hash.ctrlAt(idx) >= 0 && !hash.slots[idx].val.isNil()) {
+                TValue k = hash.slots[idx].key;
+                live -= k.isInteger() && (uint32_t)(k.toInteger() - 1) < newSize;
+            }
+        }
+        uint32_t newCap = HashPart::MIN_CAPACITY;
+        while (live > newCap / 4 * 3) newCap *= 2;
+        HashPart newHash;
+        newHash.init(newCap);
+
+        TValue* newArr = nullptr;
+        if (newSize > 0) {
+            newArr = (TValue*)pool.allocate(newSize * sizeof(TValue));
+            for (uint32_t i = 0; i < newSize; i++) newArr[i] = TValue::Nil();
+            gc.accountAlloc(newSize * sizeof(TValue));
+        }
+        uint32_t kept = std::min(newSize, arraySize);
+        if (kept) std::memcpy(newArr, array, kept * sizeof(TValue));
+        for (uint32_t i = newSize; i < arraySize; i++) {
+            if (!array[i].isNil()) {
+                TValue k = TValue::Integer((int32_t)(i + 1));
+                *newHash.insertNew(k, hashTValue(k)) = array[i];
+                arrayCount--;
+                L2C_STAT(KEYS_MIGRATED);
+            }
+        }
+        for (uint32_t idx = 0; idx < hash.capacity; idx++) {
+            if (hash.ctrlAt(idx) < 0 || hash.slots[idx].val.isNil()) continue;
+            TValue k = hash.slots[idx].key;
+            uint32_t ai = k.isInteger() ? (uint32_t)(k.toInteger() - 1) : newSize;
+            if (ai < newSize) {
+                // Pulled-in keys may be of any type and leave holes
+                newArr[ai] = hash.slots[idx].val;
+                arrayCount++;
+                arrayKind = ARRAY_GENERIC;
+                L2C_STAT(KEYS_MIGRATED);
+            } else {
+                *newHash.insertNew(k, hash.hashes()[idx]) = hash.slots[idx].val;
+            }
+        }
+        freeArray();
+        freeHash();
+        array     = newArr;
+        arraySize = newSize;
+        hash      = newHash;
+    }
+
+    // ----------------------------------------------------------------
+    // rebuildHash — rehash the live entries into a part of newCap slots
+    // ----------------------------------------------------------------
+    NOINLINE void rebuildHash(uint32_t newCap) {
+        L2C_STAT(HASH_RESIZE);
+        HashPart newHash;
+        newHash.init(newCap);
+
+        if (hash.capacity > 0) {
+            const uint32_t* hashes = hash.hashes();
+            for (uint32_t idx = 0; idx < hash.capacity; idx++) {
+                if (hash.ctrlAt(idx) >= 0 && !hash.slots[idx].val.isNil())
+                    *newHash.insertNew(hash.slots[idx].key, hashes[idx]) = hash.slots[idx].val;
+            }
+            freeHash();
+        }
+        hash = newHash;
+    }
+
+    // ----------------------------------------------------------------
+    // Iteration helpers
+    // ----------------------------------------------------------------
+    // First live hash slot >= pos with a non-nil value; pos is left one
+    // past it. Whole groups of empty/deleted slots are skipped by ctrl mask.
+    bool nextSlot(uint32_t& pos, TValue& key, TValue& val) const {
+        uint32_t cap = hash.capacity;
+        while (pos < cap) {
+            uint32_t g = pos / HashPart::WIDTH;
+            HashGroup::Mask live = hash.groups[g].matchLive() & HashGroup::fromSlot(pos % HashPart::WIDTH);
+            while (live) {
+                uint32_t idx = g * HashPart::WIDTH + HashGroup::slotOf(live);
+                if (LIKELY(!hash.slots[idx].val.isNil())) {
+                    key = hash.slots[idx].key;
+                    val = hash.slots[idx].val;
+                    pos = idx + 1;
+                    return true;
+                }
+                live &= live - 1;
+            }
+            pos = (g + 1) * HashPart::WIDTH;
+        }
+        return false;
+    }
+
+    NOINLINE bool nextAfterArray(uint32_t& pos, TValue& key, TValue& val) const {
+        uint32_t i = pos - arraySize;
+        if (UNLIKELY(shapeId)) {
+            const l2c::Shape* shape = l2c::Shape::byId(shapeId);
+            while (i < shape->count) {
+                const TValue& v = fields()[i++];
+                if (!v.isNil()) {
+                    key = shape->keys[i - 1];
+                    val = v;
+                    pos = arraySize + i;
+                    return true;
+                }
+            }
+            i -= shape->count;
+        }
+        uint32_t slot = i;
+        bool found = nextSlot(slot, key, val);
+        pos = arraySize + fieldCount() + slot;
+        return found;
+    }
+
+public:
+    // ================================================================
+    // Convenience wrappers
+    // ================================================================
+    // Bulk store of constructor values into slots 1..n of a fresh array part
+    ALWAYS_INLINE void initArray(const TValue* v, uint32_t n) {
+        assert(n <= arraySize);
+        gcBarrier();
+        std::memcpy(array, v, n * sizeof(TValue));
+        for (uint32_t i = 0; i < n; i++) arrayCount += !v[i].isNil();
+        if (arrayKind == ARRAY_NUMBER) {
+            for (uint32_t i = 0; i < n; i++) {
+                if (!v[i].isNumber()) { arrayKind = ARRAY_GENERIC; break; }
+            }
+        }
+    }
+
+    // ================================================================
+    // Bulk sequence operations (table.insert / table.remove / table.move).
+    // Ranges inside the array part are shifted with one memmove; others
+    // fall back to element-wise rawget/rawset. Indices are 1-based and
+    // len is the caller's border (#t).
+    // ================================================================
+
+    // t[pos..len] moves up one slot and t[pos] = val; pos in [1, len+1]
+    void insertAt(uint32_t pos, uint32_t len, TValue val) {
+        if (len < arraySize || (len == arraySize && !val.isNil())) {
+            if (len == arraySize) growArray(len + 1);
+            gcBarrier();
+            TValue* p = array + (pos - 1);
+            std::memmove(p + 1, p, (size_t)(len + 1 - pos) * sizeof(TValue));
+            *p = val;
+            // t[len+1] was nil (border): the only new element is val
+            arrayCount += !val.isNil();
+            if (arrayKind == ARRAY_NUMBER && (!val.isNumber() || len + 1 != arrayCount))
+                arrayKind = ARRAY_GENERIC;
+            return;
+        }
+        for (uint32_t i = len; i >= pos; i--) rawset(TValue::Integer((int32_t)i + 1), rawget(TValue::Integer((int32_t)i)));
+        rawset(TValue::Integer((int32_t)pos), val);
+    }
+
+    // Removes and returns t[pos], moving t[pos+1..len] down; pos in [1, len]
+    TValue removeAt(uint32_t pos, uint32_t len) {
+        if (len <= arraySize) {
+            TValue* p = array + (pos - 1);
+            TValue removed = *p;
+            std::memmove(p, p + 1, (size_t)(len - pos) * sizeof(TValue));
+            arrayCount -= !removed.isNil();
+            array[len - 1] = TValue::Nil();
+            if (arrayKind == ARRAY_NUMBER && len != arrayCount + 1) arrayKind = ARRAY_GENERIC;
+            return removed;
+        }
+        TValue removed = rawget(TValue::Integer((int32_t)pos));
+        for (uint32_t i = pos; i < len; i++) rawset(TValue::Integer((int32_t)i), rawget(TValue::Integer((int32_t)i + 1)));
+        rawset(TValue::Integer((int32_t)len), TValue::Nil());
+        return removed;
+    }
+
+    // this[t..t+(e-f)] = src[f..e]; overlapping ranges of one table are safe
+    void moveRange(LuaTable* src, uint32_t f, uint32_t e, uint32_t t) {
+        if (e < f) return;
+        uint32_t n = e - f + 1;
+        uint32_t last = t + n - 1;
+        bool srcInArray = f >= 1 && e <= src->arraySize;
+        if (srcInArray && t >= 1 && t - 1 <= arraySize) {
+            if (last > arraySize) growArray(last);  // may pull hash keys of src == this
+            gcBarrier();
+            storeSpan(t - 1, src->array + (f - 1), n);
+            return;
+        }
+        if (t > e || t <= f || src != this) {
+            for (uint32_t i = 0; i < n; i++)
+                rawset(TValue::Integer((int32_t)(t + i)), src->rawget(TValue::Integer((int32_t)(f + i))));
+        } else {
+            for (uint32_t i = n; i-- > 0; )
+                rawset(TValue::Integer((int32_t)(t + i)), src->rawget(TValue::Integer((int32_t)(f + i))));
+        }
+    }
+
+    // t[len+1..len+n] = v[0..n-1]
+    void appendSpan(uint32_t len, const TValue* v, uint32_t n) {
+        if (n == 0) return;
+        if (len <= arraySize) {
+            if (len + n > arraySize) growArray(len + n);
+            gcBarrier();
+            storeSpan(len, v, n);
+            return;
+        }
+        for (uint32_t i = 0; i < n; i++) rawset(TValue::Integer((int32_t)(len + 1 + i)), v[i]);
+    }
+
+    // ================================================================
+    // Bulk API, also for C++ embedders: reserve grows the array part
+    // once ahead of a run of stores, appendRange adds n values after
+    // the border with one copy, and span views a range where the array
+    // part holds it. Any store to the table may invalidate a span.
+    // ================================================================
+
+    // Room for t[1..n] in the array part
+    void reserve(uint32_t n) {
+        if (n > arraySize) growArray(n);
+    }
+
+    // t[#t+1..#t+n] = v[0..n-1]
+    void appendRange(const TValue* v, uint32_t n) { appendSpan(length(), v, n); }
+
+    // t[first..last] as far as the array part holds it: the values up to
+    // the first one stored elsewhere, possibly none
+    std::span<const TValue> span(int64_t first, int64_t last) const {
+        if (first < 1 || last < first || first > (int64_t)arraySize) return {};
+        int64_t end = std::min<int64_t>(last, arraySize);
+        return {array + (first - 1), (size_t)(end - first + 1)};
+    }
+
+    // f(t[i]) for i = first..last: the span, then by key for the rest
+    template<typename F>
+    void forRange(int64_t first, int64_t last, F&& f) const {
+        std::span<const TValue> part = span(first, last);
+        for (const TValue& v : part) f(v);
+        for (int64_t i = first + (int64_t)part.size(); i <= last; i++)
+            f(rawget(TValue::Integer((int32_t)i)));
+    }
+
+    TValue get(int32_t i) const { return rawget(TValue::Integer(i)); }
+    void   set(int32_t i, TValue v) { rawset(TValue::Integer(i), v); }
+
+private:
+    // array[at..at+n) = v[0..n) (memmove: v may alias the array), keeping
+    // arrayCount and the ARRAY_NUMBER invariant
+    void storeSpan(uint32_t at, const TValue* v, uint32_t n) {
+        uint32_t dense = arrayCount;
+        TValue* dst = array + at;
+        for (uint32_t i = 0; i < n; i++) arrayCount -= !dst[i].isNil();
+        std::memmove(dst, v, (size_t)n * sizeof(TValue));
+        bool numbers = true;
+        for (uint32_t i = 0; i < n; i++) {
+            arrayCount += !dst[i].isNil();
+            numbers &= dst[i].isNumber();
+        }
+        // Floats written at or before the end of the dense prefix keep it dense
+        if (arrayKind == ARRAY_NUMBER && !(numbers && at <= dense)) arrayKind = ARRAY_GENERIC;
+    }
+
+public:
+    TValue get(const char* s) const { return rawget(TValue::String(s)); }
+    void   set(const char* s, TValue v) { rawset(TValue::String(s), v); }
+
+    uint32_t hashCount()  const { return hash.count; }
+    uint32_t hashCap()    const { return hash.capacity; }
+    uint32_t arrSize()    const { return arraySize; }
+    bool     isNumberArray() const { return arrayKind == ARRAY_NUMBER; }
+
+    // Preallocate (like lua_createtable); small tables get their parts inline
+    // Tables are owned by LuaGC; the collector may step before allocating
+    // kind = ARRAY_NUMBER for tables the transpiler expects to hold only floats
+    static LuaTable* create(uint32_t nArr = 0, uint32_t nHash = 0,
+                            ArrayKind kind = ARRAY_GENERIC) {
+        L2C_STAT(TABLE_CREATE);
+        LuaGC& gc = LuaGC::instance();
+        gc.checkStep();
+        TableAllocator& pool = TableAllocator::instance();
+        if (nArr <= SMALL_ARRAY && nHash <= SMALL_HASH && (nArr | nHash)) {
+            // Both parts inline: one allocation
+            uint32_t inl = (nArr ? INLINE_ARRAY : 0) | (nHash ? INLINE_HASH : 0);
+            size_t bytes = sizeof(LuaTable) + (nHash ? SMALL_HASH_BYTES : 0) + (nArr ? SMALL_ARRAY * sizeof(TValue) : 0);
+            LuaTable* t = new (pool.allocate(bytes)) LuaTable();
+            t->arrayKind = kind;
+            t->flags = inl;
+            gc.accountAlloc(bytes);
+            if (nHash) t->hash.initIn(SMALL_HASH, t->inlineSpace());
+            if (nArr) {
+                t->array     = t->inlineArray();
+                t->arraySize = SMALL_ARRAY;
+                for (uint32_t i = 0; i < SMALL_ARRAY; i++) t->array[i] = TValue::Nil();
+            }
+            gc.trackTable(t);
+            return t;
+        }
+        LuaTable* t = new (pool.allocate(sizeof(LuaTable))) LuaTable();
+        t->arrayKind = kind;
+        gc.accountAlloc(sizeof(LuaTable));
+        if (nArr > 0) {
+            // Exact size: constructors know their element count, and
+            // growArray rounds up to a power of two on the first append
+            t->array     = (TValue*)pool.allocate(nArr * sizeof(TValue));
+            t->arraySize = nArr;
+            for (uint32_t i = 0; i < nArr; i++) t->array[i] = TValue::Nil();
+            gc.accountAlloc(nArr * sizeof(TValue));
+        }
+        if (nHash > 0) {
+            uint32_t cap = HashPart::MIN_CAPACITY;
+            while (cap < nHash) cap <<= 1;
+            t->hash.init(cap);
+        }
+        gc.trackTable(t);
+        return t;
+    }
+
+    // Record table with shape's fields inline (all nil), no array or hash part
+    static LuaTable* createShaped(const l2c::Shape& shape) {
+        L2C_STAT(TABLE_CREATE);
+        LuaGC& gc = LuaGC::instance();
+        gc.checkStep();
+        size_t bytes = sizeof(LuaTable) + shape.count * sizeof(TValue);
+        LuaTable* t = new (TableAllocator::instance().allocate(bytes)) LuaTable();
+        t->shapeId = shape.id;
+        for (uint32_t i = 0; i < shape.count; i++) new (&t->fields()[i]) TValue();
+        gc.accountAlloc(bytes);
+        gc.trackTable(t);
+        return t;
+    }
+
+    // Bulk store of constructor values into all fields of a fresh record
+    ALWAYS_INLINE void initFields(const TValue* v, uint32_t n) {
+        assert(n == fieldCount());
+        gcBarrier();
+        std::memcpy(fields(), v, n * sizeof(TValue));
+    }
+
+    // Counterpart of create(): runs the destructor and recycles the header
+    static void destroy(LuaTable* t) {
+        size_t bytes = t->allocSize();
+        t->~LuaTable();
+        TableAllocator::instance().deallocate(t, bytes);
+    }
+};
+// ============================================================
+// LuaGC implementation (needs the complete LuaTable)
+// ============================================================
+#if defined(__GLIBC__)
+#  include <pthread.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+extern "C" void* __libc_stack_end;  // top of the main thread's stack
+#endif
+
+namespace l2c {
+    // Is the caller the process's initial thread?
+    inline bool on_main_thread() {
+#if defined(__GLIBC__)
+        return ::getpid() == static_cast<pid_t>(::syscall(SYS_gettid));
+#else
+        return true;
+#endif
+    }
+} // namespace l2c
+
+inline LuaGC::LuaGC() {
+#if defined(__GLIBC__)
+    if (l2c::on_main_thread()) {
+        stackBase = reinterpret_cast<uintptr_t>(__libc_stack_end);
+    } else {
+        // Other threads scan up to the top of the stack pthreads gave them
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void*  lo;
+            size_t size;
+            if (pthread_attr_getstack(&attr, &lo, &size) == 0)
+                stackBase = reinterpret_cast<uintptr_t>(lo) + size;
+            pthread_attr_destroy(&attr);
+        }
+    }
+#endif
+    // Without a known stack base live locals cannot be found: only
+    // explicit collectgarbage() calls would be unsafe, so stay stopped
+    if (!stackBase) stop();
+}
+
+// Free every object: the State is going away with its thread
+inline void LuaGC::releaseAll() {
+    TableAllocator& pool = TableAllocator::instance();
+    for (Closure* c : closures) {
+        uint32_t size = c->size;
+        c->ops->destroy(c);
+        pool.deallocate(c, size);
+    }
+    for (LuaTable* t : tables) LuaTable::destroy(t);
+    for (LuaString* s : strings) pool.deallocate(s, s->allocSize());
+    closures.clear();
+    tables.clear();
+    strings.clear();
+    gray.clear();
+    grayClosures.clear();
+    markedClosures = markedStrings = 0;
+    totalBytes = 0;
+    currentPhase = Phase::Pause;
+}
+
+inline l2c::State::State() : mainThread(on_main_thread()) {}
+
+inline l2c::State::~State() {
+    // The system reclaims the main thread's memory faster, at exit
+    if (!mainThread) gc.releaseAll();
+}
+
+inline void LuaGC::setStackBase(const void* base) {
+    bool wasUnknown = stackBase == 0;
+    stackBase = reinterpret_cast<uintptr_t>(base);
+    if (wasUnknown) restart();
+}
+
+inline void LuaGC::trackTable(LuaTable* t) {
+    // Allocate black while marking so the new table survives this cycle;
+    // the write barrier regrays it when it gains references
+    t->gcMark = (currentPhase == Phase::Propagate) ? GC_BLACK : GC_WHITE;
+    tables.push_back(t);
+}
+
+inline void LuaGC::trackClosure(Closure* f) {
+    // Closures past markedClosures are treated as live by the current cycle
+    accountAlloc(f->size);
+    closures.push_back(f);
+}
+
+void LuaGC::barrier(LuaTable* t) {
+    t->gcMark = GC_GRAY;  // gray survives a pending sweep as well
+    if (currentPhase == Phase::Propagate) gray.push_back(t);
+}
+
+inline void LuaGC::trackString(LuaString* s) {
+    // Strings past markedStrings are treated as live by the current cycle
+    accountAlloc(s->allocSize());
+    strings.push_back(s);
+}
+
+inline void LuaGC::removeRoot(TValue* slot) {
+    auto it = std::find(roots.begin(), roots.end(), slot);
+    if (it != roots.end()) roots.erase(it);
+}
+
+inline void LuaGC::removeRoot(const char** slot) {
+    auto it = std::find(stringRoots.begin(), stringRoots.end(), slot);
+    if (it != stringRoots.end()) stringRoots.erase(it);
+}
+
+inline void LuaGC::stop() {
+    running = false;
+    threshold = SIZE_MAX;
+}
+
+inline void LuaGC::restart() {
+    if (!stackBase) return;
+    running = true;
+    threshold = totalBytes + STEP_BYTES;
+}
+
+ALWAYS_INLINE void LuaGC::markTable(LuaTable* t) {
+    if (t->gcMark == GC_WHITE) {
+        t->gcMark = GC_GRAY;
+        gray.push_back(t);
+    }
+}
+
+// Plain TAG_STRING values may point at a LuaString too (STRING results
+// converted back to TValue), so they are looked up as well
+ALWAYS_INLINE void LuaGC::markValue(TValue v) {
+    if (v.isTable()) markTable(v.toTable());
+    else if (v.isFunction() || v.isThread()) markClosure(v.toPtr());
+    else if ((v.isString() && !v.isInterned()) || v.isBoxedInteger()) markString(v.toPtr());
+}
+
+inline void LuaGC::markClosure(const void* p) {
+    auto end = closures.begin() + markedClosures;
+    auto it  = std::lower_bound(closures.begin(), end, p,
+        [](const Closure* a, const void* b) { return (const void*)a < b; });
+    if (it != end && (const void*)*it == p) {
+        uint8_t& mark = closureMarks[it - closures.begin()];
+        if (!mark) {
+            mark = 1;
+            grayClosures.push_back(*it);
+        }
+    }
+}
+
+// p is a LuaString's data pointer or any address inside it
+inline void LuaGC::markString(const void* p) {
+    auto end = strings.begin() + markedStrings;
+    auto it  = std::upper_bound(strings.begin(), end, p,
+        [](const void* a, const LuaString* b) { return a < (const void*)b; });
+    if (it == strings.begin()) return;
+    --it;
+    if ((uintptr_t)p - (uintptr_t)*it < (*it)->allocSize())
+        stringMarks[it - strings.begin()] = 1;
+}
+
+inline void LuaGC::markRoots() {
+    for (TValue* r : roots) markValue(*r);
+    for (const char** r : stringRoots) if (*r) markString(*r);
+}
+
+inline void LuaGC::startCycle() {
+    gray.clear();
+    grayClosures.clear();
+    std::sort(closures.begin(), closures.end());
+    markedClosures = closures.size();
+    closureMarks.assign(markedClosures, 0);
+    std::sort(strings.begin(), strings.end());
+    markedStrings = strings.size();
+    stringMarks.assign(markedStrings, 0);
+    currentPhase = Phase::Propagate;
+    markRoots();
+}
+
+// Blacken gray tables and scan marked closures until budget (in visited
+// slots) is spent
+inline size_t LuaGC::propagate(size_t budget) {
+    size_t work = 0;
+    while ((!gray.empty() || !grayClosures.empty()) && work < budget) {
+        if (!grayClosures.empty()) {
+            const Closure* c = grayClosures.back();
+            grayClosures.pop_back();
+            traceClosure(c);
+            work += 1 + (c->size - sizeof(Closure)) / sizeof(TValue);
+            continue;
+        }
+        LuaTable* t = gray.back();
+        gray.pop_back();
+        if (t->gcMark != GC_GRAY) continue;  // pushed twice
+        t->gcMark = GC_BLACK;
+        if (t->metatable) markTable(t->metatable);
+        if (t->arrayKind != ARRAY_NUMBER) {
+            for (uint32_t i = 0; i < t->arraySize; i++) markValue(t->array[i]);
+        }
+        for (uint32_t i = 0, n = t->fieldCount(); i < n; i++) markValue(t->fields()[i]);
+        const HashPart& h = t->hash;
+        for (uint32_t g = 0; g < h.numGroups; g++) {
+            for (uint32_t i = 0; i < HashPart::WIDTH; i++) {
+                if (h.groups[g].ctrl[i] >= 0) {
+                    const HashSlot& slot = h.slots[g * HashPart::WIDTH + i];
+                    markValue(slot.key);
+                    markValue(slot.val);
+                }
+            }
+        }
+        work += 1 + t->arraySize + h.capacity;
+    }
+    return work;
+}
+
+// Atomic phase: rescan roots and the stack, then finish marking
+inline void LuaGC::atomic() {
+    std::sort(tables.begin(), tables.end());  // for conservative lookups
+    markRoots();
+    scanStack();
+    // Closures created during this cycle are kept; trace what they capture
+    for (size_t i = markedClosures; i < closures.size(); i++)
+        traceClosure(closures[i]);
+    // Threads may have run since they were traced
+    for (size_t i = 0; i < markedClosures; i++) {
+        if (closureMarks[i] && closures[i]->ops->trace) closures[i]->ops->trace(closures[i], *this);
+    }
+    propagate(SIZE_MAX);
+    sweepClosures();
+    sweepStrings();
+    currentPhase = Phase::Sweep;
+    sweepPos = sweepKeep = 0;
+    sweepEnd = tables.size();
+}
+
+inline void LuaGC::sweepClosures() {
+    size_t keep = 0;
+    for (size_t i = 0; i < closures.size(); i++) {
+        if (i < markedClosures && !closureMarks[i]) {
+            Closure* c = closures[i];
+            uint32_t size = c->size;
+            accountFree(size);
+            c->ops->destroy(c);
+            TableAllocator::instance().deallocate(c, size);
+        } else {
+            closures[keep++] = closures[i];
+        }
+    }
+    closures.resize(keep);
+    markedClosures = 0;
+    closureMarks.clear();
+}
+
+inline void LuaGC::sweepStrings() {
+    size_t keep = 0;
+    for (size_t i = 0; i < strings.size(); i++) {
+        if (i < markedStrings && !stringMarks[i]) {
+            LuaString* s = strings[i];
+            size_t size = s->allocSize();
+            accountFree(size);
+            TableAllocator::instance().deallocate(s, size);
+        } else {
+            strings[keep++] = strings[i];
+        }
+    }
+    strings.resize(keep);
+    markedStrings = 0;
+    stringMarks.clear();
+}
+
+// Free white tables, reset survivors to white; tables created during
+// the sweep live past sweepEnd and are left alone
+inline bool LuaGC::sweep(size_t budget) {
+    size_t work = 0;
+    for (; sweepPos < sweepEnd && work < budget; sweepPos++, work += 16) {
+        LuaTable* t = tables[sweepPos];
+        if (t->gcMark == GC_WHITE) {
+            accountFree(t->allocSize());
+            LuaTable::destroy(t);
+        } else {
+            t->gcMark = GC_WHITE;
+            tables[sweepKeep++] = t;
+        }
+    }
+    if (sweepPos < sweepEnd) return false;
+    tables.erase(tables.begin() + sweepKeep, tables.begin() + sweepEnd);
+    finishCycle();
+    return true;
+}
+
+inline void LuaGC::finishCycle() {
+    currentPhase = Phase::Pause;
+    cycleCount++;
+    if (running)
+        threshold = std::max(totalBytes / 100 * (size_t)pause, MIN_THRESHOLD);
+}
+
+inline bool LuaGC::step() {
+    size_t budget = STEP_BYTES / sizeof(TValue) * (size_t)stepMul / 100;
+    bool finished = false;
+    if (currentPhase == Phase::Pause) startCycle();
+    if (currentPhase == Phase::Propagate) {
+        propagate(budget);
+        if (gray.empty() && grayClosures.empty()) atomic();
+    } else {
+        finished = sweep(budget);
+    }
+    if (running && currentPhase != Phase::Pause)
+        threshold = totalBytes + STEP_BYTES;
+    return finished;
+}
+
+inline void LuaGC::finishCurrentCycle() {
+    while (currentPhase != Phase::Pause) {
+        if (currentPhase == Phase::Propagate) {
+            propagate(SIZE_MAX);
+            atomic();
+        } else {
+            sweep(SIZE_MAX);
+        }
+    }
+}
+
+inline void LuaGC::fullCollect() {
+    if (!stackBase) return;
+    // Garbage may be floating in an unfinished cycle: complete it, then
+    // run one full cycle from scratch
+    finishCurrentCycle();
+    startCycle();
+    finishCurrentCycle();
+}
+
+// ------------------------------------------------------------
+// Conservative stack scan
+// ------------------------------------------------------------
+void LuaGC::scanStack() {
+    if (!stackBase) return;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unwind_init();  // spill callee-saved registers into this frame
+#endif
+    std::jmp_buf regs;
+    setjmp(regs);
+    scanRange(&regs, reinterpret_cast<const char*>(&regs) + sizeof(regs));
+    scanStackFrom();
+}
+
+inline void LuaGC::traceClosure(const Closure* c) {
+    scanRange(c->payloadBegin(), c->payloadEnd());
+    if (c->ops->trace) c->ops->trace(c, *this);
+}
+
+// Separate frame so everything spilled by scanStack lies above 'marker'
+void LuaGC::scanStackFrom() {
+    volatile uintptr_t marker = 0;
+    scanRange(const_cast<uintptr_t*>(&marker), reinterpret_cast<const void*>(stackBase));
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((no_sanitize_address))
+#endif
+inline void LuaGC::scanRange(const void* lo, const void* hi) {
+    uintptr_t p   = (reinterpret_cast<uintptr_t>(lo) + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(hi);
+    for (; p + sizeof(uintptr_t) <= end; p += sizeof(uintptr_t))
+        markConservative(*reinterpret_cast<const uintptr_t*>(p));
+}
+
+// A word keeps an object alive if it is a tagged TValue or a raw
+// (possibly interior) pointer to it, e.g. TableSlotProxy::tbl or a
+// STRING local
+inline void LuaGC::markConservative(uintptr_t word) {
+    uint64_t tag = word & TValue::TAG_MASK;
+    uintptr_t p = (tag == TValue::TAG_TABLE || tag == TValue::TAG_FUNCTION || tag == TValue::TAG_THREAD
+                   || tag == TValue::TAG_BIGINT || TValue(word).isString())
+                ? (word & TValue::POINTER_MASK) : word;
+    auto it = std::upper_bound(tables.begin(), tables.end(), (LuaTable*)p,
+        [](const LuaTable* a, const LuaTable* b) { return (uintptr_t)a < (uintptr_t)b; });
+    if (it != tables.begin()) {
+        LuaTable* t = *(it - 1);
+        if (p - (uintptr_t)t < t->allocSize()) markTable(t);
+    }
+    markClosure(reinterpret_cast<const void*>(p));
+    markString(reinterpret_cast<const void*>(p));
+}
+
+template<typename F>
+inline TValue TValue::NewFunction(F&& f) {
+    using Impl = ClosureImpl<std::decay_t<F>>;
+    static_assert(alignof(Impl) <= 16, "closure state must fit pool alignment");
+    LuaGC& gc = LuaGC::instance();
+    gc.checkStep();
+    void* mem = TableAllocator::instance().allocate(sizeof(Impl));
+    Impl* p = new (mem) Impl(std::forward<F>(f));
+    gc.trackClosure(p);
+    return Function(p);
+}
+
+namespace l2c {
+    // Registers slots living outside the stack (module state, G)
+    // as collector roots for the lifetime of this object; Slot is TValue
+    // or STRING (const char*)
+    template<typename Slot>
+    struct GCRoots {
+        std::vector<Slot*> slots;
+
+        GCRoots(std::initializer_list<Slot*> list) : slots(list) {
+            for (Slot* s : slots) LuaGC::instance().addRoot(s);
+        }
+        ~GCRoots() {
+            for (Slot* s : slots) LuaGC::instance().removeRoot(s);
+        }
+        GCRoots(const GCRoots&) = delete;
+        GCRoots& operator=(const GCRoots&) = delete;
+    };
 
-    // ----------------------------------------------------------------
-    // hashSet — write to hash part, growing if necessary
-    // ----------------------------------------------------------------
-    NOINLINE void hashSet(TValue key, TValue val) {
-        if (UNLIKELY(hash.needsRehash())) {
-            uint32_t newCap = (hash.capacity == 0) ? 16 : hash.capacity * 2;
-            rebuildHash(newCap);
+    // A local that closures capture and someone assigns after the capture
+    // (ClosureAnalyzer): the value lives in a cell shared by the declaring
+    // function and every closure holding a copy of the handle. The cell is
+    // a closure object, so it comes from the table pool and the collector
+    // traces the value through it like any other upvalue
+    template<typename T>
+    class Upvalue {
+        struct Cell {
+            T value;
+            TValue operator()() const { return TValue::Nil(); }
+        };
+        TValue cell;
+
+    public:
+        explicit Upvalue(T v) : cell(TValue::NewFunction(Cell{std::move(v)})) {}
+
+        T& operator*() const {
+            return static_cast<ClosureImpl<Cell>*>(cell.toFunction())->fn.value;
         }
-        TValue* slot = hash.upsert(key);
-        *slot = val;
-        if (val.isNil()) hash.count--; // upsert incremented, but we're deleting
+    };
+
+    template<typename T>
+    Upvalue<std::decay_t<T>> make_upvalue(T&& v) {
+        return Upvalue<std::decay_t<T>>(std::forward<T>(v));
     }
 
-    // ----------------------------------------------------------------
-    // rebuildHash — grow & rehash the hash part
-    // ----------------------------------------------------------------
-    NOINLINE void rebuildHash(uint32_t newCap) {
-        HashPart newHash;
-        newHash.init(newCap);
+    // Whether a self tail call passing an A for a parameter of type P can
+    // rebind the parameter and jump, instead of calling another
+    // instantiation of the function template: a TValue takes any value
+    template<typename P, typename A>
+    inline constexpr bool rebinds_v = std::is_same_v<std::decay_t<A>, P>
+                                      || (std::is_same_v<P, TValue> && std::is_convertible_v<A, TValue>);
 
-        if (hash.capacity > 0) {
-            for (uint32_t g = 0; g < hash.numGroups; g++) {
-                for (uint32_t i = 0; i < 16; i++) {
-                    if (hash.groups[g].ctrl[i] >= 0) {
-                        uint32_t idx = g * 16 + i;
-                        TValue* slot = newHash.upsert(hash.slots[idx].key);
-                        *slot = hash.slots[idx].val;
-                    }
-                }
-            }
-            hash.destroy();
-        }
-        hash = newHash;
+    // The table t when its array part holds every key lo + first .. hi +
+    // last and it has no metatable; nullptr otherwise, or when lo > hi.
+    // A loop over lo..hi that stores only to those keys, and calls
+    // nothing, then reads t->array[i - 1] and stores through arrayset
+    // directly: no slot can move, and no metamethod would have run.
+    template <class T>
+    LuaTable* array_span(const T& t, int64_t lo, int64_t hi, int32_t first, int32_t last) {
+        TValue v = as_value(t);
+        if (!v.isTable() || lo > hi || lo < int64_t(1) - first) return nullptr;
+        LuaTable* table = v.toTable();
+        if (table->metatable || hi > static_cast<int64_t>(table->arraySize) - last) return nullptr;
+        return table;
     }
 
-    // ----------------------------------------------------------------
-    // Iteration helpers
-    // ----------------------------------------------------------------
-    bool nextInHash(uint32_t afterGroup, TValue& key, TValue& val) const {
-        if (hash.capacity == 0) return false;
-        uint32_t startG = (afterGroup == ~0u) ? 0 : afterGroup;
-        for (uint32_t g = startG; g < hash.numGroups; g++) {
-            uint32_t startI = (g == startG && afterGroup != ~0u) ? 1 : 0; // skip current
-            for (uint32_t i = startI; i < 16; i++) {
-                if (hash.groups[g].ctrl[i] >= 0) {
-                    uint32_t idx = g * 16 + i;
-                    if (!hash.slots[idx].val.isNil()) {
-                        key = hash.slots[idx].key;
-                        val = hash.slots[idx].val;
-                        return true;
-                    }
-                }
+    // Pool statistics for table headers, array parts and hash parts
+    inline const TableAllocator::Stats& allocator_stats() {
+        return TableAllocator::instance().stats();
+    }
+
+#ifdef L2C_STATS
+    inline void dump_stats(FILE* out) {
+        StatsSnapshot snap = stats_snapshot();
+        const uint64_t* c = snap.counts;
+        std::fprintf(out, "---- l2c runtime statistics ----\n");
+        for (uint32_t i = 0; i < STAT_COUNT; i++)
+            std::fprintf(out, "%-24s %14llu\n", STAT_NAMES[i], (unsigned long long)c[i]);
+        uint64_t gets = c[STAT_ARRAY_GET] + c[STAT_HASH_GET] + c[STAT_SHAPE_GET];
+        if (gets)
+            std::fprintf(out, "%-24s %13.1f%%\n", "array hit ratio", 100.0 * (double)c[STAT_ARRAY_GET] / (double)gets);
+        if (c[STAT_HASH_LOOKUP]) {
+            uint64_t groups = 0;
+            for (uint32_t i = 0; i < PROBE_BUCKETS; i++) groups += snap.probeGroups[i] * (i + 1);
+            std::fprintf(out, "%-24s %10s x%u\n", "hash groups", HashGroup::BACKEND, HashGroup::WIDTH);
+            std::fprintf(out, "%-24s %14.2f\n", "groups per hash lookup", (double)groups / (double)c[STAT_HASH_LOOKUP]);
+            for (uint32_t i = 0; i < PROBE_BUCKETS; i++) {
+                if (!snap.probeGroups[i]) continue;
+                std::fprintf(out, "  %u%-20s %14llu\n", i + 1, i + 1 == PROBE_BUCKETS ? "+ groups" : " groups",
+                             (unsigned long long)snap.probeGroups[i]);
             }
         }
-        return false;
+        const TableAllocator::Stats& pool = allocator_stats();
+        std::fprintf(out, "%-12s %14s %14s %14s\n", "alloc class", "allocs", "reused", "frees");
+        for (uint32_t i = 0; i < TableAllocator::NUM_CLASSES; i++) {
+            const TableAllocator::ClassStats& cs = pool.classes[i];
+            if (!cs.allocs) continue;
+            std::fprintf(out, "%10zu B %14llu %14llu %14llu\n", TableAllocator::classSize(i),
+                         (unsigned long long)cs.allocs, (unsigned long long)cs.reused, (unsigned long long)cs.frees);
+        }
+        std::fprintf(out, "%-12s %14llu %14s %14llu\n", "large", (unsigned long long)pool.largeAllocs, "",
+                     (unsigned long long)pool.largeFrees);
     }
+#endif
 
-    uint32_t findHashPos(TValue key) const {
-        if (hash.capacity == 0) return 0;
-        uint32_t h    = hashTValue(key);
-        uint32_t g    = hash.h1(h);
-        int8_t   h2v  = hash.h2(h);
-        uint32_t gMask = hash.numGroups - 1;
+    // New collector-owned string of len bytes, NUL-terminated; the caller
+    // fills data before the next allocation
+    inline LuaString* alloc_string(size_t len) {
+        LuaGC& gc = LuaGC::instance();
+        gc.checkStep();
+        LuaString* str = static_cast<LuaString*>(TableAllocator::instance().allocate(LuaString::allocSize(len)));
+        str->hash = 0;
+        str->len  = (uint32_t)len;
+        str->data[len] = '\0';
+        gc.trackString(str);
+        return str;
+    }
 
-        for (;;) {
-            uint32_t matches = hash.groups[g].matchH2(h2v);
-            while (matches) {
-                uint32_t i   = (uint32_t)__builtin_ctz(matches);
-                uint32_t idx = g * 16 + i;
-                if (hash.slots[idx].key == key) return g;
-                matches &= matches - 1;
-            }
-            if (hash.groups[g].matchEmpty()) return g;
-            g = (g + 1) & gMask;
-        }
+    inline TValue new_string(const char* s, size_t len) {
+        LuaString* str = alloc_string(len);
+        std::memcpy(str->data, s, len);
+        return TValue::LString(str->data);
     }
 
-public:
-    // ================================================================
-    // Convenience wrappers
-    // ================================================================
-    TValue get(int32_t i) const { return rawget(TValue::Integer(i)); }
-    void   set(int32_t i, TValue v) { rawset(TValue::Integer(i), v); }
-    TValue get(const char* s) const { return rawget(TValue::String(s)); }
-    void   set(const char* s, TValue v) { rawset(TValue::String(s), v); }
+    // Byte length of a string value: O(1) for interned and collector-owned
+    // strings
+    ALWAYS_INLINE size_t str_len(const TValue& v) {
+        if (LIKELY(v.isSizedString())) return LuaString::fromData(v.toPtr())->len;
+        return std::strlen(static_cast<const char*>(v.toPtr()));
+    }
 
-    uint32_t hashCount()  const { return hash.count; }
-    uint32_t hashCap()    const { return hash.capacity; }
-    uint32_t arrSize()    const { return arraySize; }
+    // For hosts without glibc (or other threads): pass an address near
+    // the top of the stack, e.g. &argc in main()
+    inline void gc_set_stack_base(const void* base) {
+        LuaGC::instance().setStackBase(base);
+    }
+} // namespace l2c
 
-    // Preallocate (like lua_createtable)
-    static LuaTable* create(uint32_t nArr = 0, uint32_t nHash = 0) {
-        LuaTable* t = new LuaTable();
-        if (nArr > 0) {
-            uint32_t cap = 16;
-            while (cap < nArr) cap <<= 1;
-            t->array     = (TValue*)::operator new(cap * sizeof(TValue));
-            t->arraySize = cap;
-            for (uint32_t i = 0; i < cap; i++) t->array[i] = TValue::Nil();
-        }
-        if (nHash > 0) {
-            uint32_t cap = 16;
-            while (cap < nHash) cap <<= 1;
-            t->hash.init(cap);
-        }
-        return t;
+namespace l2c {
+    // Set while this thread runs iterations of an l2c::parallel_for
+    // (lua_parallel.hpp), which must not run Lua code of their own
+    inline thread_local bool in_parallel_loop = false;
+
+    // Thrown to abandon a parallel_for, which then runs serially
+    struct ParallelAbort {};
+
+    // Metamethods may do anything: a parallel iteration gives up instead
+    ALWAYS_INLINE void serial_only() {
+        if (UNLIKELY(in_parallel_loop)) throw ParallelAbort{};
     }
-};
-inline std::optional<TValue> get_metamethod(TValue a, TValue b, const char* name) {
+
+    // An integer outside the 32-bit range, in a block the collector
+    // tracks with the strings (so it is marked and freed like one)
+    NOINLINE inline TValue box_integer(int64_t i) {
+        serial_only();  // the block would belong to this thread's State
+        LuaString* box = alloc_string(sizeof(int64_t));
+        std::memcpy(box->data, &i, sizeof(int64_t));
+        return TValue(TValue::TAG_BIGINT | (reinterpret_cast<uint64_t>(box->data) & TValue::POINTER_MASK));
+    }
+
+    // Integer arithmetic wraps around modulo 2^64, as in Lua 5.4
+    ALWAYS_INLINE int64_t int_add(int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); }
+    ALWAYS_INLINE int64_t int_sub(int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); }
+    ALWAYS_INLINE int64_t int_mul(int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); }
+} // namespace l2c
+
+ALWAYS_INLINE TValue TValue::Int64(int64_t i) {
+    if (LIKELY(i == (int32_t)i)) return Integer((int32_t)i);
+    return l2c::box_integer(i);
+}
+
+inline std::optional<TValue> get_metamethod(TValue a, TValue b, TValue key) {
+    L2C_STAT(MM_LOOKUP);
     // Try a's metatable first (Lua 5.4 precedence)
     if (a.isTable()) {
         if (LuaTable* mt = a.toTable()->metatable) {
-            TValue key = TValue::String(name);
+            l2c::serial_only();
             TValue mm = mt->rawget(key);  // rawget, not __index
-            if (!mm.isNil()) return mm;
+            if (!mm.isNil()) { L2C_STAT(MM_HIT); return mm; }
         }
     }
     // Try b's metatable
     if (b.isTable()) {
         if (LuaTable* mt = b.toTable()->metatable) {
-            TValue key = TValue::String(name);
+            l2c::serial_only();
             TValue mm = mt->rawget(key);  // rawget, not __index
-            if (!mm.isNil()) return mm;
+            if (!mm.isNil()) { L2C_STAT(MM_HIT); return mm; }
         }
     }
     // No metamethod found
     return std::nullopt;
 }
 
+inline std::optional<TValue> get_metamethod(TValue a, TValue b, const char* name) {
+    return get_metamethod(a, b, TValue::String(name));
+}
+
+// Cached lookup for TMS events: a metatable known to lack the event costs
+// a flags test instead of a string hash probe
+ALWAYS_INLINE const TValue* get_tm(TValue v, TMS e) {
+    if (!v.isTable()) return nullptr;
+    LuaTable* mt = v.toTable()->metatable;
+    if (!mt) return nullptr;
+    l2c::serial_only();
+    return mt->fasttm(e);
+}
+
+ALWAYS_INLINE std::optional<TValue> get_metamethod(TValue a, TValue b, TMS e) {
+    L2C_STAT(MM_LOOKUP);
+    if (const TValue* mm = get_tm(a, e)) { L2C_STAT(MM_HIT); return *mm; }
+    if (const TValue* mm = get_tm(b, e)) { L2C_STAT(MM_HIT); return *mm; }
+    return std::nullopt;
+}
+
+// __call receives the callee followed by the call's arguments
+inline TValue TValue::callMeta(const TValue* args, uint32_t n) const {
+    L2C_STAT(META_CALL);
+    const TValue* h = get_tm(*this, TM_CALL);
+    if (!h || !h->isFunction()) return Nil();
+    TValue handler = *h;
+    if (n < l2c::MAX_FIXED_ARITY) {
+        TValue argv[l2c::MAX_FIXED_ARITY];
+        argv[0] = *this;
+        std::copy(args, args + n, argv + 1);
+        return handler.callv(argv, n + 1);
+    }
+    std::vector<TValue> argv(args, args + n);
+    argv.insert(argv.begin(), *this);
+    return handler.callv(argv.data(), (uint32_t)argv.size());
+}
+
+// ============================================================
+// Table access honoring __index / __newindex
+// ============================================================
+namespace l2c {
+    constexpr int MAXTAGLOOP = 2000;  // bound on __index/__newindex chains
+
+    // Key for an int64_t index (integer for-loop variable); values outside
+    // the 32-bit integer range become float keys
+    ALWAYS_INLINE TValue integer_key(int64_t i) {
+        if (LIKELY(i == (int32_t)i)) return TValue::Integer((int32_t)i);
+        return TValue::Number((double)i);
+    }
+
+    NOINLINE inline TValue gettable_slow(LuaTable* t, TValue key) {
+        serial_only();
+        for (int loop = 0; loop < MAXTAGLOOP; loop++) {
+            const TValue* h = t->metatable ? t->metatable->fasttm(TM_INDEX) : nullptr;
+            if (!h) return TValue::Nil();
+            if (h->isFunction()) return h->call(TValue::Table(t), key);
+            if (!h->isTable()) return TValue::Nil();
+            t = h->toTable();
+            TValue v = t->rawget(key);
+            if (!v.isNil()) return v;
+        }
+        return TValue::Nil();
+    }
+
+    // t[key]: plain rawget unless the slot is empty and t has a metatable
+    ALWAYS_INLINE TValue gettable(LuaTable* t, TValue key) {
+        TValue v = t->rawget(key);
+        if (LIKELY(!v.isNil() || !t->metatable)) return v;
+        return gettable_slow(t, key);
+    }
+
+    NOINLINE inline void settable_slow(LuaTable* t, TValue key, TValue val) {
+        serial_only();
+        for (int loop = 0; loop < MAXTAGLOOP; loop++) {
+            const TValue* cur = t->rawfind(key);
+            if (cur && !cur->isNil()) break;
+            const TValue* h = t->metatable ? t->metatable->fasttm(TM_NEWINDEX) : nullptr;
+            if (!h) break;
+            if (h->isFunction()) {
+                h->call(TValue::Table(t), key, val);
+                return;
+            }
+            if (!h->isTable()) break;
+            t = h->toTable();
+        }
+        t->rawset(key, val);
+    }
+
+    ALWAYS_INLINE void settable(LuaTable* t, TValue key, TValue val) {
+        if (LIKELY(!t->metatable)) { t->rawset(key, val); return; }
+        settable_slow(t, key, val);
+    }
+
+    // Lua equality/ordering with __eq/__lt/__le. TValue::operator== stays
+    // raw because the hash part uses it for key comparison.
+    inline bool equals(TValue a, TValue b) {
+        if (a == b) return true;
+        if (a.isInt64() && b.isInt64()) return a.toInt64() == b.toInt64();
+        if ((a.isNumber() || a.isInt64()) && (b.isNumber() || b.isInt64()))
+            return a.asNumber() == b.asNumber();
+        if (!a.isTable() || !b.isTable()) return false;
+        auto mm = get_metamethod(a, b, TM_EQ);
+        return mm && !mm->call(a, b).isFalsy();
+    }
+
+    inline bool less_than(TValue a, TValue b) {
+        if (a.isString() && b.isString())
+            return std::strcmp(static_cast<const char*>(a.toPtr()),
+                               static_cast<const char*>(b.toPtr())) < 0;
+        if (a.isTable() || b.isTable()) {
+            auto mm = get_metamethod(a, b, TM_LT);
+            return mm && !mm->call(a, b).isFalsy();
+        }
+        if (a.isInt64() && b.isInt64()) return a.toInt64() < b.toInt64();
+        return a.asNumber() < b.asNumber();
+    }
+
+    inline bool less_equal(TValue a, TValue b) {
+        if (a.isString() && b.isString())
+            return std::strcmp(static_cast<const char*>(a.toPtr()),
+                               static_cast<const char*>(b.toPtr())) <= 0;
+        if (a.isTable() || b.isTable()) {
+            auto mm = get_metamethod(a, b, TM_LE);
+            return mm && !mm->call(a, b).isFalsy();
+        }
+        if (a.isInt64() && b.isInt64()) return a.toInt64() <= b.toInt64();
+        return a.asNumber() <= b.asNumber();
+    }
+} // namespace l2c
+
+namespace l2c {
+    // The operands of an operation on a boxed integer, if both are
+    // integers. A float with an integral value counts as one: generated
+    // code holds integer literals as NUMBERs, and math.maxinteger - 1
+    // must not round through a double.
+    NOINLINE inline bool wide_operands(TValue a, TValue b, int64_t& x, int64_t& y) {
+        auto integer = [](TValue v, int64_t& i) {
+            if (v.isInt64()) { i = v.toInt64(); return true; }
+            return v.isNumber() && float_to_integer(v.toNumber(), i);
+        };
+        return integer(a, x) && integer(b, y);
+    }
+} // namespace l2c
+
 // ============================================================
 // TValue arithmetic operator definitions (after get_metamethod)
+// Integer operands give an integer (Lua 5.4 subtypes); two inline ones
+// can't overflow int64_t. Everything else computes in double.
 // ============================================================
 ALWAYS_INLINE TValue TValue::operator*(const TValue& o) const {
+    if (isInteger() && o.isInteger()) return Int64((int64_t)toInteger() * o.toInteger());
+    int64_t x, y;
+    if (UNLIKELY(isBoxedInteger() || o.isBoxedInteger()) && l2c::wide_operands(*this, o, x, y))
+        return Int64(l2c::int_mul(x, y));
     if (isTable() || o.isTable()) {
-        auto mm = get_metamethod(*this, o, "__mul");
+        auto mm = get_metamethod(*this, o, TM_MUL);
         if (mm) return mm->call(*this, o);
     }
     return Number(asNumber() * o.asNumber());
 }
 ALWAYS_INLINE TValue TValue::operator+(const TValue& o) const {
+    if (isInteger() && o.isInteger()) return Int64((int64_t)toInteger() + o.toInteger());
+    int64_t x, y;
+    if (UNLIKELY(isBoxedInteger() || o.isBoxedInteger()) && l2c::wide_operands(*this, o, x, y))
+        return Int64(l2c::int_add(x, y));
     if (isTable() || o.isTable()) {
-        auto mm = get_metamethod(*this, o, "__add");
+        auto mm = get_metamethod(*this, o, TM_ADD);
         if (mm) return mm->call(*this, o);
     }
     return Number(asNumber() + o.asNumber());
 }
 ALWAYS_INLINE TValue TValue::operator-(const TValue& o) const {
+    if (isInteger() && o.isInteger()) return Int64((int64_t)toInteger() - o.toInteger());
+    int64_t x, y;
+    if (UNLIKELY(isBoxedInteger() || o.isBoxedInteger()) && l2c::wide_operands(*this, o, x, y))
+        return Int64(l2c::int_sub(x, y));
     if (isTable() || o.isTable()) {
-        auto mm = get_metamethod(*this, o, "__sub");
+        auto mm = get_metamethod(*this, o, TM_SUB);
         if (mm) return mm->call(*this, o);
     }
     return Number(asNumber() - o.asNumber());
 }
 ALWAYS_INLINE TValue TValue::operator/(const TValue& o) const {
     if (isTable() || o.isTable()) {
-        auto mm = get_metamethod(*this, o, "__div");
+        auto mm = get_metamethod(*this, o, TM_DIV);
         if (mm) return mm->call(*this, o);
     }
     return Number(asNumber() / o.asNumber());
@@ -967,8 +3389,7 @@ struct TableSlotProxy {
     // Implicit read: pure lookup, no side effects
     operator TValue() const {
         if (!tbl) return TValue::Nil();
-        TValue* p = tbl->rawfind(key);
-        return p ? *p : TValue::Nil();
+        return l2c::gettable(tbl, key);
     }
     
     // Implicit conversion to double for return statements
@@ -977,7 +3398,7 @@ struct TableSlotProxy {
     // Write: creates slot on demand
     TableSlotProxy& operator=(TValue val) {
         assert(tbl && "Cannot assign to nil table");
-        tbl->rawset(key, val);
+        l2c::settable(tbl, key, val);
         return *this;
     }
     
@@ -989,36 +3410,19 @@ struct TableSlotProxy {
     TableSlotProxy& operator=(const TableSlotProxy& other) {
         assert(tbl && "Cannot assign to nil table");
         TValue val = static_cast<TValue>(other);  // Convert rhs to TValue
-        tbl->rawset(key, val);  // Write through to lhs's slot
+        l2c::settable(tbl, key, val);  // Write through to lhs's slot
         return *this;
     }
 
     // Accept callable types and wrap as TValue::Function
-    // Handles both:
-    //   - Functions matching FuncType signature (TValue(TValue, TValue))
-    //   - Simple 0-arg functions (e.g., double()) - wrapped for __index metamethod
     template<typename F, typename = std::enable_if_t<
-        std::is_invocable_v<F> && 
         !std::is_same_v<std::decay_t<F>, TValue> &&
         !std::is_same_v<std::decay_t<F>, TableSlotProxy> &&
-        !std::is_convertible_v<F, double>
+        !std::is_convertible_v<F, double> &&
+        l2c::is_lua_callable<std::decay_t<F>>()
     >>
     TableSlotProxy& operator=(F&& f) {
-        if constexpr (std::is_invocable_r_v<TValue, F, TValue, TValue>) {
-            // Direct match for FuncType signature
-            return *this = TValue::Function(new TValue::FuncType(std::forward<F>(f)));
-        } else {
-            // Wrap simple functions (0-arg, etc.) for __index metamethod
-            auto wrapper = [f = std::forward<F>(f)](TValue, TValue) -> TValue {
-                if constexpr (std::is_same_v<std::invoke_result_t<F>, void>) {
-                    f();
-                    return TValue::Nil();
-                } else {
-                    return TValue::Number(static_cast<double>(f()));
-                }
-            };
-            return *this = TValue::Function(new TValue::FuncType(std::move(wrapper)));
-        }
+        return *this = TValue::NewFunction(std::forward<F>(f));
     }
 
     // Support chained table access: proxy[k] where proxy is a table slot
@@ -1029,6 +3433,9 @@ struct TableSlotProxy {
     TableSlotProxy operator[](int32_t k) const {
         return (*this)[TValue::Integer(k)];
     }
+    TableSlotProxy operator[](int64_t k) const {
+        return (*this)[l2c::integer_key(k)];
+    }
     TableSlotProxy operator[](double k) const {
         int32_t i = (int32_t)k;
         if ((double)i == k) return (*this)[TValue::Integer(i)];
@@ -1043,6 +3450,10 @@ struct TableSlotProxy {
     TValue operator-(const TableSlotProxy& o) const { return static_cast<TValue>(*this) - static_cast<TValue>(o); }
     TValue operator*(const TableSlotProxy& o) const { return static_cast<TValue>(*this) * static_cast<TValue>(o); }
     TValue operator/(const TableSlotProxy& o) const { return static_cast<TValue>(*this) / static_cast<TValue>(o); }
+    TValue operator+(const TValue& o) const { return static_cast<TValue>(*this) + o; }
+    TValue operator-(const TValue& o) const { return static_cast<TValue>(*this) - o; }
+    TValue operator*(const TValue& o) const { return static_cast<TValue>(*this) * o; }
+    TValue operator/(const TValue& o) const { return static_cast<TValue>(*this) / o; }
     double operator+(double o) const { return static_cast<TValue>(*this).asNumber() + o; }
     double operator-(double o) const { return static_cast<TValue>(*this).asNumber() - o; }
     double operator*(double o) const { return static_cast<TValue>(*this).asNumber() * o; }
@@ -1073,6 +3484,9 @@ struct TableSlotProxy {
     bool operator>=(TableSlotProxy o) const { return static_cast<TValue>(*this).asNumber() >= static_cast<TValue>(o).asNumber(); }
     bool operator==(TableSlotProxy o) const { return static_cast<TValue>(*this).asNumber() == static_cast<TValue>(o).asNumber(); }
     bool operator!=(TableSlotProxy o) const { return static_cast<TValue>(*this).asNumber() != static_cast<TValue>(o).asNumber(); }
+    // Comparison with a TValue (e.g. a concretely typed parameter): raw equality
+    bool operator==(const TValue& o) const { return static_cast<TValue>(*this) == o; }
+    bool operator!=(const TValue& o) const { return !(static_cast<TValue>(*this) == o); }
     
     // Unary operators
     double operator-() const { return -static_cast<TValue>(*this).asNumber(); }
@@ -1094,46 +3508,41 @@ struct TableSlotProxy {
     // Callable support - enables table["func"](args)
     template<typename... Args>
     TValue operator()(Args&&... args) const {
-        TValue func = static_cast<TValue>(*this);
-        if (func.isFunction()) {
-            // Support 0, 1, or 2 arguments
-            if constexpr (sizeof...(args) == 0) {
-                return func.call(TValue::Nil(), TValue::Nil());
-            } else if constexpr (sizeof...(args) == 1) {
-                // Get the single argument and convert to TValue
-                auto arg1 = std::get<0>(std::forward_as_tuple(args...));
-                return func.call(toTValue(arg1), TValue::Nil());
-            } else if constexpr (sizeof...(args) == 2) {
-                auto args_tuple = std::forward_as_tuple(args...);
-                return func.call(toTValue(std::get<0>(args_tuple)), toTValue(std::get<1>(args_tuple)));
-            }
-        }
-        return TValue::Nil();
+        return static_cast<TValue>(*this)(std::forward<Args>(args)...);
     }
-    
-private:
-    // Helper to convert various types to TValue for operator()
+};
+
+namespace l2c {
+    // Convert a C++ value (argument or return value) to a TValue
     template<typename T>
-    static TValue toTValue(T&& val) {
-        if constexpr (std::is_same_v<std::decay_t<T>, TValue>) {
+    TValue as_value(T&& val) {
+        using D = std::decay_t<T>;
+        if constexpr (std::is_same_v<D, TValue>) {
             return val;
-        } else if constexpr (std::is_same_v<std::decay_t<T>, TableSlotProxy>) {
+        } else if constexpr (std::is_same_v<D, TableSlotProxy>) {
             return static_cast<TValue>(val);
-        } else if constexpr (std::is_same_v<std::decay_t<T>, double>) {
-            return TValue::Number(val);
-        } else if constexpr (std::is_integral_v<std::decay_t<T>>) {
-            return TValue::Integer(static_cast<int32_t>(val));
-        } else if constexpr (std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>) {
+        } else if constexpr (std::is_same_v<D, bool>) {
+            return TValue::Boolean(val);
+        } else if constexpr (std::is_floating_point_v<D>) {
+            return TValue::Number(static_cast<double>(val));
+        } else if constexpr (std::is_integral_v<D>) {
+            return TValue::Int64(static_cast<int64_t>(val));
+        } else if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
             return TValue::String(val);
-        } else if constexpr (std::is_same_v<std::decay_t<T>, LuaTable*>) {
+        } else if constexpr (std::is_same_v<D, LuaTable*>) {
             return TValue::Table(val);
+        } else if constexpr (is_lua_callable<D>()) {
+            return TValue::NewFunction(std::forward<T>(val));
+        } else if constexpr (requires { val.first; }) {
+            return as_value(val.first);  // multi-return: first value
+        } else if constexpr (std::is_convertible_v<T, TValue>) {
+            return static_cast<TValue>(std::forward<T>(val));
         } else {
             return TValue::Nil();
         }
     }
-    
-public:
-};
+} // namespace l2c
+
 
 // ============================================================
 // TValue operator[] — table access for transpiler compatibility
@@ -1145,7 +3554,16 @@ inline TableSlotProxy TValue::operator[](int32_t index) {
 
 inline TValue TValue::operator[](int32_t index) const {
     if (!isTable()) return Nil();
-    return toTable()->rawget(Integer(index));
+    return l2c::gettable(toTable(), Integer(index));
+}
+
+inline TableSlotProxy TValue::operator[](int64_t index) {
+    return TableSlotProxy{ isTable() ? toTable() : nullptr, l2c::integer_key(index) };
+}
+
+inline TValue TValue::operator[](int64_t index) const {
+    if (!isTable()) return Nil();
+    return l2c::gettable(toTable(), l2c::integer_key(index));
 }
 
 inline TableSlotProxy TValue::operator[](double index) {
@@ -1157,8 +3575,8 @@ inline TableSlotProxy TValue::operator[](double index) {
 inline TValue TValue::operator[](double index) const {
     if (!isTable()) return Nil();
     int32_t i = (int32_t)index;
-    if ((double)i == index) return toTable()->rawget(Integer(i));
-    return toTable()->rawget(Number(index));
+    if ((double)i == index) return l2c::gettable(toTable(), Integer(i));
+    return l2c::gettable(toTable(), Number(index));
 }
 
 inline TableSlotProxy TValue::operator[](const char* key) {
@@ -1167,7 +3585,7 @@ inline TableSlotProxy TValue::operator[](const char* key) {
 
 inline TValue TValue::operator[](const char* key) const {
     if (!isTable()) return Nil();
-    return toTable()->rawget(String(key));
+    return l2c::gettable(toTable(), String(key));
 }
 
 inline TableSlotProxy TValue::operator[](const std::string& key) {
@@ -1196,7 +3614,23 @@ inline TableSlotProxy TValue::operator[](const TableSlotProxy& key) {
 inline TValue TValue::operator[](const TableSlotProxy& key) const {
     if (!isTable()) return Nil();
     TValue k = static_cast<TValue>(key);
-    return toTable()->rawget(k);
+    return l2c::gettable(toTable(), k);
+}
+
+// TValue keys (e.g. interned literals); integral doubles are normalized
+// up front so the array part is hit on both read and write
+inline TableSlotProxy TValue::operator[](TValue key) {
+    if (key.isNumber()) {
+        double d = key.toNumber();
+        int32_t i = (int32_t)d;
+        if ((double)i == d) key = Integer(i);
+    }
+    return TableSlotProxy{ isTable() ? toTable() : nullptr, key };
+}
+
+inline TValue TValue::operator[](TValue key) const {
+    if (!isTable()) return Nil();
+    return l2c::gettable(toTable(), key);
 }
 
 // Assignment from TableSlotProxy (defined after TableSlotProxy is complete)
@@ -1238,13 +3672,244 @@ inline double operator+(double a, const TableSlotProxy& b) { return a + static_c
 inline double operator-(double a, const TableSlotProxy& b) { return a - static_cast<TValue>(b).asNumber(); }
 inline double operator/(double a, const TableSlotProxy& b) { return a / static_cast<TValue>(b).asNumber(); }
 
+// And for TValue * TableSlotProxy (TableSlotProxy * TValue is a member)
+inline TValue operator*(const TValue& a, const TableSlotProxy& b) { return a * static_cast<TValue>(b); }
+inline TValue operator+(const TValue& a, const TableSlotProxy& b) { return a + static_cast<TValue>(b); }
+inline TValue operator-(const TValue& a, const TableSlotProxy& b) { return a - static_cast<TValue>(b); }
+inline TValue operator/(const TValue& a, const TableSlotProxy& b) { return a / static_cast<TValue>(b); }
+
 // ============================================================
 // Helper to create callable TValue from lambda
 // ============================================================
 namespace l2c {
     template<typename F>
     TValue make_function(F&& f) {
-        return TValue::Function(new TValue::FuncType(std::forward<F>(f)));
+        return TValue::NewFunction(std::forward<F>(f));
+    }
+
+    // Table constructor {a, b, k = v}: positional values first, then key/value
+    // pairs. Generated as TableCtor<2, 1>{a, b, k, v}.table — brace
+    // initialization evaluates the fields left to right without a lambda.
+    // Parts are sized exactly and the array part is filled in one store.
+    // Kind = ARRAY_NUMBER for constructors of tables proven number-only.
+    template<uint32_t NArr, uint32_t NHash, ArrayKind Kind = ARRAY_GENERIC>
+    struct TableCtor {
+        TValue table;
+
+        template<typename... Items>
+        ALWAYS_INLINE TableCtor(Items&&... items) {
+            static_assert(sizeof...(Items) == NArr + 2 * NHash, "expected NArr values and NHash key/value pairs");
+            const TValue v[] = { as_value(std::forward<Items>(items))... };
+            LuaTable* t = LuaTable::create(NArr, NHash, Kind);
+            if constexpr (NArr > 0) t->initArray(v, NArr);
+            for (uint32_t i = NArr; i < NArr + 2 * NHash; i += 2) t->rawset(v[i], v[i + 1]);
+            table = TValue::Table(t);
+        }
+    };
+
+    // Constructor of constants for a module table the script only ever
+    // reads (ConstTableAnalyzer), at namespace scope:
+    //     static const l2c::ConstTable<2, 1> _l2c_const_0{a, b, k, v};
+    // Static initialization lays the parts out once per process, as
+    // TableCtor would, in storage every State shares; table() gives a
+    // State a header pointing at them, as MAPPED_* parts.
+    template<uint32_t NArr, uint32_t NHash>
+    class ConstTable {
+    public:
+        template<typename... Items>
+        ConstTable(Items&&... items) {
+            static_assert(sizeof...(Items) == NArr + 2 * NHash, "expected NArr values and NHash key/value pairs");
+            const TValue v[] = { as_value(std::forward<Items>(items))... };
+            kind = ARRAY_NUMBER;
+            for (uint32_t i = 0; i < NArr; i++) {
+                array[i] = v[i];
+                if (!v[i].isNumber()) kind = ARRAY_GENERIC;
+            }
+            if constexpr (NHash > 0) {
+                hash.initIn(CAPACITY, hashMem);
+                for (uint32_t i = NArr; i < NArr + 2 * NHash; i += 2) *hash.upsert(v[i]) = v[i + 1];
+            }
+        }
+
+        TValue table() const {
+            LuaTable* t = LuaTable::create();
+            t->arrayKind = kind;
+            if constexpr (NArr > 0) {
+                t->array      = const_cast<TValue*>(array);
+                t->arraySize  = NArr;
+                t->arrayCount = NArr;
+                t->flags     |= LuaTable::MAPPED_ARRAY;
+            }
+            if constexpr (NHash > 0) {
+                t->hash   = hash;
+                t->flags |= LuaTable::MAPPED_HASH;
+            }
+            return TValue::Table(t);
+        }
+
+    private:
+        static constexpr uint32_t CAPACITY = HashPart::capacityFor(NHash);
+
+        alignas(64) char hashMem[NHash > 0 ? HashPart::bytesFor(CAPACITY) : 1];
+        TValue    array[NArr > 0 ? NArr : 1];
+        HashPart  hash;
+        ArrayKind kind;
+    };
+
+    // Record constructor {k1 = a, k2 = b}: RecordCtor<2>{shape, a, b}.table
+    // with the values in the shape's key order
+    template<uint32_t N>
+    struct RecordCtor {
+        TValue table;
+
+        template<typename... Items>
+        ALWAYS_INLINE RecordCtor(const Shape& shape, Items&&... items) {
+            static_assert(sizeof...(Items) == N, "expected one value per shape field");
+            const TValue v[] = { as_value(std::forward<Items>(items))... };
+            LuaTable* t = LuaTable::createShaped(shape);
+            t->initFields(v, N);
+            table = TValue::Table(t);
+        }
+    };
+
+    // o.k where k is field i of shape: a fixed-offset load when o has that
+    // shape, the generic lookup otherwise. A nil field still consults
+    // __index like any absent key.
+    ALWAYS_INLINE TValue getfield(const TValue& o, const Shape& shape, uint32_t i, TValue key) {
+        if (UNLIKELY(!o.isTable())) return o[key];
+        LuaTable* t = o.toTable();
+        if (LIKELY(t->shapeId == shape.id)) {
+            TValue v = t->fields()[i];
+            if (LIKELY(!v.isNil() || !t->metatable)) return v;
+            return gettable_slow(t, key);
+        }
+        return gettable(t, key);
+    }
+
+    // o.k = val counterpart of getfield
+    template<typename V>
+    ALWAYS_INLINE void setfield(const TValue& o, const Shape& shape, uint32_t i, TValue key, V&& val) {
+        assert(o.isTable() && "Cannot assign to nil table");
+        if (UNLIKELY(!o.isTable())) return;
+        LuaTable* t = o.toTable();
+        TValue v = as_value(std::forward<V>(val));
+        if (LIKELY(t->shapeId == shape.id) && (!t->fields()[i].isNil() || !t->metatable)) {
+            t->gcBarrier();
+            t->fields()[i] = v;
+            return;
+        }
+        settable(t, key, v);
+    }
+
+    // ============================================================
+    // InlineCache — per-site cache for constant-key field access
+    //
+    // Remembers the hash slot where the site last found its key, with
+    // the hash capacity it belongs to. Tables built the same way place a
+    // key in the same slot, so a monomorphic site — and usually one that
+    // sees many tables of one kind — tests the capacity, ctrl byte and
+    // key bits instead of hashing and probing. Keys are interned, never
+    // metamethod names, and never array or shape-field keys.
+    //
+    // Sites are thread_local, like the rest of a State.
+    //
+    // Build with -DL2C_IC_STATS to count hits and misses per site; the
+    // main thread's counts are printed to stderr at exit
+    // (l2c::dump_inline_caches).
+    // ============================================================
+    struct InlineCache {
+        static constexpr uint32_t NONE = ~0u;  // no hash part has this capacity
+
+        uint32_t capacity = NONE;
+        uint32_t index = 0;
+#ifdef L2C_IC_STATS
+        const char* site;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        InlineCache* next;
+
+        explicit InlineCache(const char* site);
+#else
+        constexpr explicit InlineCache(const char*) {}
+#endif
+    };
+
+#ifdef L2C_IC_STATS
+    inline thread_local InlineCache* inline_caches = nullptr;
+
+    inline void dump_inline_caches(FILE* out = stderr) {
+        std::fprintf(out, "%-40s %12s %12s %7s\n", "inline cache", "hits", "misses", "hit%");
+        for (const InlineCache* ic = inline_caches; ic; ic = ic->next) {
+            uint64_t total = ic->hits + ic->misses;
+            if (total == 0) continue;
+            std::fprintf(out, "%-40s %12llu %12llu %6.1f%%\n", ic->site,
+                         (unsigned long long)ic->hits, (unsigned long long)ic->misses,
+                         100.0 * (double)ic->hits / (double)total);
+        }
+    }
+
+    inline InlineCache::InlineCache(const char* s) : site(s), next(inline_caches) {
+        if (!inline_caches && on_main_thread()) std::atexit([] { dump_inline_caches(); });
+        inline_caches = this;
+    }
+
+    #define L2C_IC_COUNT(ic, field) ((ic).field++)
+#else
+    #define L2C_IC_COUNT(ic, field) ((void)0)
+#endif
+
+    // Records the slot of key in t's hash part, if it is there
+    ALWAYS_INLINE void fill_inline_cache(const LuaTable* t, InlineCache& ic, TValue key) {
+        int32_t idx = t->hash.findIndex(key);
+        if (idx >= 0) { ic.capacity = t->hash.capacity; ic.index = (uint32_t)idx; }
+    }
+
+    NOINLINE inline TValue getcached_miss(LuaTable* t, InlineCache& ic, TValue key) {
+        L2C_IC_COUNT(ic, misses);
+        fill_inline_cache(t, ic, key);
+        return gettable(t, key);
+    }
+
+    // o.k through the site's inline cache. A nil slot still consults
+    // __index like any absent key.
+    ALWAYS_INLINE TValue getcached(const TValue& o, InlineCache& ic, TValue key) {
+        if (UNLIKELY(!o.isTable())) return o[key];
+        LuaTable* t = o.toTable();
+        const HashPart& h = t->hash;
+        if (LIKELY(h.capacity == ic.capacity && h.liveAt(ic.index, key))) {
+            TValue v = h.slots[ic.index].val;
+            if (LIKELY(!v.isNil() || !t->metatable)) {
+                L2C_IC_COUNT(ic, hits);
+                return v;
+            }
+        }
+        return getcached_miss(t, ic, key);
+    }
+
+    NOINLINE inline void setcached_miss(LuaTable* t, InlineCache& ic, TValue key, TValue val) {
+        L2C_IC_COUNT(ic, misses);
+        settable(t, key, val);
+        fill_inline_cache(t, ic, key);
+    }
+
+    // o.k = val counterpart of getcached. Only overwrites of a present
+    // value take the fast path: new keys, deletions and __newindex go
+    // through settable.
+    template<typename V>
+    ALWAYS_INLINE void setcached(const TValue& o, InlineCache& ic, TValue key, V&& val) {
+        assert(o.isTable() && "Cannot assign to nil table");
+        if (UNLIKELY(!o.isTable())) return;
+        LuaTable* t = o.toTable();
+        TValue v = as_value(std::forward<V>(val));
+        HashPart& h = t->hash;
+        if (LIKELY(h.capacity == ic.capacity && h.liveAt(ic.index, key))
+            && !v.isNil() && !h.slots[ic.index].val.isNil()) {
+            L2C_IC_COUNT(ic, hits);
+            t->gcBarrier();
+            h.slots[ic.index].val = v;
+            return;
+        }
+        setcached_miss(t, ic, key, v);
     }
 } // namespace l2c
 
@@ -1268,6 +3933,10 @@ struct MultiReturn2 {
         int i = k.isInteger() ? k.toInteger() : (int)k.asNumber();
         return i == 1 ? first : (i == 2 ? second : TValue::Nil());
     }
+
+    // Tuple protocol: auto [a, b] = l2c::take<2>(f());
+    template<size_t I> TValue& get() { static_assert(I < 2); return I == 0 ? first : second; }
+    template<size_t I> const TValue& get() const { static_assert(I < 2); return I == 0 ? first : second; }
 };
 
 // Helper to create multi-return
@@ -1298,3 +3967,198 @@ inline TValue operator+(const MultiReturn2& a, const TValue& b) { return a.first
 inline TValue operator-(const MultiReturn2& a, const TValue& b) { return a.first - b; }
 inline TValue operator*(const MultiReturn2& a, const TValue& b) { return a.first * b; }
 inline TValue operator/(const MultiReturn2& a, const TValue& b) { return a.first / b; }
+
+// Multi-return support for functions returning 3+ values: one flat,
+// fixed-size pack (return a, b, c → multi_return(a, b, c)) instead of
+// nested MultiReturn2 pairs, which kept only the first two values
+template<size_t N>
+struct MultiReturn {
+    TValue values[N];
+
+    // Implicit conversion to TValue (returns first)
+    operator TValue() const { return values[0]; }
+
+    // Index access for unpacking (1-based)
+    TValue operator[](int i) const { return i >= 1 && i <= (int)N ? values[i - 1] : TValue::Nil(); }
+
+    template<size_t I> TValue& get() { return values[I]; }
+    template<size_t I> const TValue& get() const { return values[I]; }
+};
+
+template<typename A, typename B, typename C, typename... Rest>
+inline MultiReturn<3 + sizeof...(Rest)> multi_return(A&& a, B&& b, C&& c, Rest&&... rest) {
+    return {{ l2c::as_value(std::forward<A>(a)), l2c::as_value(std::forward<B>(b)),
+              l2c::as_value(std::forward<C>(c)), l2c::as_value(std::forward<Rest>(rest))... }};
+}
+
+template<> struct std::tuple_size<MultiReturn2> : std::integral_constant<size_t, 2> {};
+template<size_t I> struct std::tuple_element<I, MultiReturn2> { using type = TValue; };
+template<size_t N> struct std::tuple_size<MultiReturn<N>> : std::integral_constant<size_t, N> {};
+template<size_t I, size_t N> struct std::tuple_element<I, MultiReturn<N>> { using type = TValue; };
+
+namespace l2c {
+    // A run of values whose count is only known at run time: varargs
+    // (...) and table.unpack results. The first INLINE values live in
+    // the object itself, so the common short lists never allocate; the
+    // rest spill into a table, which also keeps them visible to the GC.
+    class Values {
+    public:
+        static constexpr uint32_t INLINE = 8;
+
+        Values() = default;
+
+        template<typename... A>
+        static Values of(A&&... a) {
+            Values v;
+            (v.push(as_value(std::forward<A>(a))), ...);
+            return v;
+        }
+
+        // a, b, f(): the leading values, then every value of the last one, a
+        // call result (a single value, either multi-return pack or Values)
+        template<typename... A>
+        static Values expand(A&&... a) {
+            Values v;
+            size_t i = 0;
+            ((++i < sizeof...(A) ? v.push(as_value(std::forward<A>(a))) : v.pushAll(a)), ...);
+            return v;
+        }
+
+        uint32_t size() const { return n_; }
+
+        // Empty it for reuse, leaving no stale value for the collector to see
+        void clear() {
+            for (uint32_t i = 0; i < n_ && i < INLINE; i++) inline_[i] = TValue::Nil();
+            n_ = 0;
+            spill_ = TValue::Nil();
+        }
+
+        // Value i (1-based); nil past the end
+        TValue operator[](int64_t i) const {
+            if (i < 1 || i > (int64_t)n_) return TValue::Nil();
+            if (i <= (int64_t)INLINE) return inline_[i - 1];
+            return spill_.toTable()->rawget(TValue::Integer((int32_t)(i - INLINE)));
+        }
+
+        // Implicit conversion to TValue (returns first)
+        operator TValue() const { return (*this)[1]; }
+
+        void push(const TValue& v) {
+            if (LIKELY(n_ < INLINE)) {
+                inline_[n_] = v;
+            } else {
+                spill(v);
+            }
+            n_++;
+        }
+
+        // Appends v[0..n): the inline slots take what fits, the spill table the rest
+        void append(const TValue* v, uint32_t n) {
+            uint32_t k = n_ < INLINE ? std::min(n, INLINE - n_) : 0;
+            std::memcpy(inline_ + n_, v, (size_t)k * sizeof(TValue));
+            n_ += k;
+            if (k < n) spillRange(v + k, n - k);
+        }
+
+        // select(i, ...): the values from i on; a negative i counts from the end
+        Values select(int64_t i) const {
+            if (i < 0) i += (int64_t)n_ + 1;
+            Values out;
+            for (int64_t k = i < 1 ? 1 : i; k <= (int64_t)n_; k++) out.push((*this)[k]);
+            return out;
+        }
+
+        // {...}
+        TValue table() const {
+            LuaTable* t = LuaTable::create(n_, 0);
+            t->appendSpan(0, inline_, std::min(n_, INLINE));
+            if (n_ > INLINE) t->moveRange(spill_.toTable(), 1, n_ - INLINE, INLINE + 1);
+            return TValue::Table(t);
+        }
+
+    private:
+        template<typename T>
+        void pushAll(const T& r) {
+            if constexpr (std::is_same_v<T, Values>) {
+                for (uint32_t k = 1; k <= r.size(); k++) push(r[k]);
+            } else if constexpr (std::is_same_v<T, MultiReturn2>) {
+                push(r.first);
+                push(r.second);
+            } else if constexpr (requires { r.values; std::tuple_size<T>::value; }) {
+                for (const TValue& x : r.values) push(x);
+            } else {
+                push(as_value(r));
+            }
+        }
+
+        NOINLINE void spillRange(const TValue* v, uint32_t n) {
+            uint32_t spilled = n_ - INLINE;
+            if (!spill_.isTable()) spill_ = TValue::Table(LuaTable::create(n, 0));
+            spill_.toTable()->appendSpan(spilled, v, n);
+            n_ += n;
+        }
+
+        NOINLINE void spill(const TValue& v) {
+            if (!spill_.isTable()) spill_ = TValue::Table(LuaTable::create(0, 0));
+            spill_.toTable()->rawset(TValue::Integer((int32_t)(n_ - INLINE + 1)), v);
+        }
+
+        uint32_t n_ = 0;
+        TValue inline_[INLINE];
+        TValue spill_;
+    };
+
+    // The last argument of a variadic library call, print(x, table.unpack(t)):
+    // the callee takes each of its values
+    struct Spread {
+        Values values;
+    };
+
+    template<size_t N>
+    using ReturnPack = std::conditional_t<N == 2, MultiReturn2, MultiReturn<N>>;
+
+    // The first N values of a call result, nil-padded: auto [a, b, c] = l2c::take<3>(f());
+    // Accepts a single value, either multi-return pack or Values.
+    template<size_t N, typename T>
+    inline ReturnPack<N> take(T&& r) {
+        static_assert(N >= 2);
+        using D = std::decay_t<T>;
+        TValue v[N];
+        if constexpr (std::is_same_v<D, MultiReturn2>) {
+            v[0] = r.first;
+            v[1] = r.second;
+        } else if constexpr (requires { r.values; std::tuple_size<D>::value; }) {
+            for (size_t i = 0; i < N && i < std::tuple_size<D>::value; i++) v[i] = r.values[i];
+        } else if constexpr (std::is_same_v<D, Values>) {
+            for (size_t i = 0; i < N; i++) v[i] = r[(int64_t)i + 1];
+        } else {
+            v[0] = as_value(std::forward<T>(r));
+        }
+        if constexpr (N == 2) {
+            return MultiReturn2(v[0], v[1]);
+        } else {
+            MultiReturn<N> m;
+            for (size_t i = 0; i < N; i++) m.values[i] = v[i];
+            return m;
+        }
+    }
+
+    // f(a, table.unpack(t)) where f has N more parameters: fn (calling f)
+    // gets the fixed arguments, then the first N values, nil-padded
+    template<size_t N, typename F, typename... A>
+    inline decltype(auto) spread(F&& fn, const Values& pack, A&&... fixed) {
+        return [&]<size_t... I>(std::index_sequence<I...>) -> decltype(auto) {
+            return fn(std::forward<A>(fixed)..., pack[(int64_t)I + 1]...);
+        }(std::make_index_sequence<N>());
+    }
+
+    // f(a, g()) where f takes `...`: fn (calling f) gets the fixed arguments,
+    // then every value of the pack, at most Values::INLINE of them
+    template<size_t N = 0, typename F, typename... A>
+    inline decltype(auto) spread_all(F&& fn, const Values& pack, A&&... fixed) {
+        if constexpr (N < Values::INLINE) {
+            if (pack.size() > N) return spread_all<N + 1>(fn, pack, fixed...);
+        }
+        return spread<N>(fn, pack, fixed...);
+    }
+} // namespace l2c
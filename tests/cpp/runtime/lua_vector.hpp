@@ -0,0 +1,64 @@
+#pragma once
+// ============================================================
+// Vector kernels over number arrays (lua_table runtime)
+//
+// For the loops VectorAnalyzer marks, such as
+//     for i = 1, n do y[i] = a * x[i] + y[i] end
+//     for i = 1, n do s = s + x[i] * y[i] end
+// the transpiler asks number_span for each table's array part once,
+// before the loop, and indexes the doubles directly inside it: no proxy,
+// bounds check or tag test per element, so the compiler is free to
+// vectorize the loop. When a table isn't a number array covering the
+// range the loop runs as generated without this (the slow path).
+//
+// The doubles are the TValues' own bits (floats are stored unboxed), read
+// and written through a may_alias type. The loop only overwrites floats
+// with floats inside the dense prefix of an ARRAY_NUMBER array, so the
+// array isn't reallocated, arrayCount is unchanged and no metamethod
+// (only ever consulted for absent keys) could have run.
+// ============================================================
+
+#include "lua_table.hpp"
+#include <cstdint>
+
+// Lets the compiler vectorize a kernel whose body only ever touches t[i +
+// k] for one k: iterations can't depend on each other even where two of
+// its tables are the same and the pointers alias
+#if defined(__clang__)
+#  define L2C_INDEPENDENT_ITERATIONS _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#  define L2C_INDEPENDENT_ITERATIONS _Pragma("GCC ivdep")
+#else
+#  define L2C_INDEPENDENT_ITERATIONS
+#endif
+
+namespace l2c {
+#if defined(__GNUC__) || defined(__clang__)
+    typedef double __attribute__((__may_alias__)) number_slot;
+#else
+    typedef double number_slot;
+#endif
+
+    // The array elements of t as doubles, element k at [k - 1], when t[lo +
+    // first] .. t[hi + last] are all floats in its array part; nullptr
+    // otherwise. A generic array whose elements all turn out to be floats
+    // is switched to ARRAY_NUMBER on the way, so the check is constant time
+    // next loop. It is only scanned for a range covering half of it or
+    // more, which keeps the scan's cost within the loop's own.
+    template <class T>
+    number_slot* number_span(const T& t, int64_t lo, int64_t hi, int32_t first, int32_t last) {
+        TValue v = as_value(t);
+        if (!v.isTable() || lo < int64_t(1) - first) return nullptr;
+        LuaTable* table = v.toTable();
+        if (hi > static_cast<int64_t>(table->arrayCount) - last) return nullptr;
+        if (table->arrayKind != ARRAY_NUMBER) {
+            // Other threads may be reading the table inside a parallel loop
+            if (in_parallel_loop || 2 * (hi - lo + 1) < static_cast<int64_t>(table->arrayCount))
+                return nullptr;
+            for (uint32_t k = 0; k < table->arrayCount; k++)
+                if (!table->array[k].isNumber()) return nullptr;
+            table->arrayKind = ARRAY_NUMBER;
+        }
+        return reinterpret_cast<number_slot*>(table->array);
+    }
+} // namespace l2c
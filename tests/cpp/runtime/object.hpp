@@ -1,16 +1,38 @@
 #pragma once
 
+#include <cstdint>
+#include <utility>
+
 class Object {
 public:
-    TABLE fields;  // Dynamic field storage
+    // Fields the class doesn't declare as members, in a table made on the
+    // first store (nil until then)
+    TABLE fields;
+
+    // Classes the class generator emits are numbered in preorder of the
+    // class tree, so a class and its subclasses own the ids
+    // type_first..type_last; each constructor stores its class's id
+    uint32_t type_id = 0;
+    static constexpr uint32_t type_first = 0;
+    static constexpr uint32_t type_last = UINT32_MAX;
 
     Object() = default;
     virtual ~Object() = default;
 
     virtual void init() {}
 
+    TValue field(const TValue& key) const {
+        return fields.isTable() ? TValue(fields[key]) : TValue();
+    }
+
+    void set_field(const TValue& key, const TValue& value) {
+        if (!fields.isTable()) fields = NEW_TABLE;
+        fields[key] = value;
+    }
+
+    // An integer range check instead of dynamic_cast
     template<typename T>
     bool is() const {
-        return dynamic_cast<const T*>(this) != nullptr;
+        return type_id - T::type_first <= T::type_last - T::type_first;
     }
 };
@@ -0,0 +1,31 @@
+// Minimal checks for the runtime unit tests
+//
+// Each test in unit/ is a main() that runs CHECKs against the runtime
+// headers and returns check::done(), which is non-zero if any failed.
+// A failing CHECK prints its location and keeps going.
+
+#pragma once
+
+#include <cstdio>
+
+namespace check {
+
+inline int failures = 0;
+
+inline void fail(const char* file, int line, const char* what) {
+    std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", file, line, what);
+    failures++;
+}
+
+inline int done() {
+    if (failures) std::fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
+
+} // namespace check
+
+#define CHECK(cond) \
+    do { if (!(cond)) ::check::fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { if (!((a) == (b))) ::check::fail(__FILE__, __LINE__, #a " == " #b); } while (0)
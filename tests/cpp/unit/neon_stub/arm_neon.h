@@ -0,0 +1,19 @@
+// Scalar stand-ins for the NEON intrinsics HashGroup uses, so that x86
+// builds can run the NEON mask code (test_hash_group_neon)
+#pragma once
+#include <cstdint>
+#include <cstring>
+struct uint8x16_t { uint8_t v[16]; };
+struct int8x16_t { int8_t v[16]; };
+struct uint16x8_t { uint16_t v[8]; };
+struct uint8x8_t { uint8_t v[8]; };
+struct uint64x1_t { uint64_t v[1]; };
+inline int8x16_t vld1q_s8(const int8_t* p) { int8x16_t r; std::memcpy(r.v, p, 16); return r; }
+inline int8x16_t vdupq_n_s8(int8_t x) { int8x16_t r; for (auto& e : r.v) e = x; return r; }
+inline uint8x16_t vceqq_s8(int8x16_t a, int8x16_t b) { uint8x16_t r; for (int i = 0; i < 16; i++) r.v[i] = a.v[i] == b.v[i] ? 0xff : 0; return r; }
+inline uint8x16_t vcltq_s8(int8x16_t a, int8x16_t b) { uint8x16_t r; for (int i = 0; i < 16; i++) r.v[i] = a.v[i] < b.v[i] ? 0xff : 0; return r; }
+inline uint8x16_t vcgeq_s8(int8x16_t a, int8x16_t b) { uint8x16_t r; for (int i = 0; i < 16; i++) r.v[i] = a.v[i] >= b.v[i] ? 0xff : 0; return r; }
+inline uint16x8_t vreinterpretq_u16_u8(uint8x16_t a) { uint16x8_t r; std::memcpy(r.v, a.v, 16); return r; }
+inline uint8x8_t vshrn_n_u16(uint16x8_t a, int n) { uint8x8_t r; for (int i = 0; i < 8; i++) r.v[i] = (uint8_t)(a.v[i] >> n); return r; }
+inline uint64x1_t vreinterpret_u64_u8(uint8x8_t a) { uint64x1_t r; std::memcpy(r.v, a.v, 8); return r; }
+inline uint64_t vget_lane_u64(uint64x1_t a, int) { return a.v[0]; }
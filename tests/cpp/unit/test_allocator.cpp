@@ -0,0 +1,56 @@
+// TableAllocator: size classes, free-list reuse and the large-block path
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+int main() {
+    using A = TableAllocator;
+
+    // Requests round up to a power-of-two class, 16 B to 64 KB
+    CHECK_EQ(A::sizeClass(1), 0u);
+    CHECK_EQ(A::sizeClass(16), 0u);
+    CHECK_EQ(A::sizeClass(17), 1u);
+    CHECK_EQ(A::sizeClass(4096), 8u);
+    CHECK_EQ(A::sizeClass(A::SLAB_BYTES), A::NUM_CLASSES - 1);
+    CHECK_EQ(A::classSize(A::sizeClass(100)), 128u);
+
+    A& pool = A::instance();
+    const A::ClassStats before = pool.stats().classes[A::sizeClass(48)];
+    const size_t live = pool.stats().liveBytes;
+
+    // A freed block is the next one handed out for its class
+    void* a = pool.allocate(48);
+    void* b = pool.allocate(40);
+    CHECK(a != b);
+    CHECK_EQ(pool.stats().liveBytes, live + 128);
+    pool.deallocate(a, 48);
+    void* c = pool.allocate(33);
+    CHECK_EQ(c, a);
+    pool.deallocate(b, 40);
+    pool.deallocate(c, 33);
+
+    const A::ClassStats& after = pool.stats().classes[A::sizeClass(48)];
+    CHECK_EQ(after.allocs - before.allocs, 3u);
+    CHECK_EQ(after.frees - before.frees, 3u);
+    CHECK(after.reused - before.reused >= 1);
+    CHECK(after.slabs >= 1);
+    CHECK_EQ(pool.stats().liveBytes, live);
+
+    // Larger than a slab: straight to operator new, counted apart
+    uint64_t large = pool.stats().largeAllocs;
+    void* big = pool.allocate(A::SLAB_BYTES + 1);
+    CHECK_EQ(pool.stats().largeAllocs, large + 1);
+    pool.deallocate(big, A::SLAB_BYTES + 1);
+    CHECK_EQ(pool.stats().largeFrees, pool.stats().largeAllocs);
+
+    // Growing an array part returns each old buffer to its class
+    uint64_t frees = 0;
+    for (const auto& cs : pool.stats().classes) frees -= cs.frees;
+    LuaTable* t = LuaTable::create();
+    for (int32_t i = 1; i <= 1000; i++) t->rawset(TValue::Integer(i), TValue::Integer(i));
+    for (const auto& cs : pool.stats().classes) frees += cs.frees;
+    CHECK(frees >= 6);
+    CHECK_EQ(t->rawget(TValue::Integer(1000)).toInteger(), 1000);
+
+    return check::done();
+}
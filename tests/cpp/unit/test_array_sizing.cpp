@@ -0,0 +1,57 @@
+// Array part sizing on rehash (Lua's computesizes): backward fills end
+// in the array part, sparse keys stay in the hash, and a mostly empty
+// array part shrinks without losing keys
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+static TValue I(int32_t i) { return TValue::Integer(i); }
+
+int main() {
+    // t[n] down to t[1]
+    for (int32_t n : {10, 100, 1000, 4000}) {
+        LuaTable* t = LuaTable::create();
+        for (int32_t i = n; i >= 1; i--) t->rawset(I(i), I(i * 2));
+        CHECK(t->arraySize >= (uint32_t)n);
+        CHECK(t->arraySize < (uint32_t)n * 2);
+        CHECK_EQ(t->hash.count, 0u);
+        CHECK_EQ(t->length(), (uint32_t)n);
+        for (int32_t i = 1; i <= n; i++) CHECK_EQ(t->rawget(I(i)).toInteger(), i * 2);
+    }
+    // Past a power of two the last rehash may come before the top keys
+    // fill half of the next range: as in Lua those stay hashed, but no
+    // key the array part covers is left in the hash
+    LuaTable* b = LuaTable::create();
+    for (int32_t i = 5000; i >= 1; i--) b->rawset(I(i), I(i));
+    CHECK_EQ(b->arraySize, 4096u);
+    CHECK_EQ(b->arrayCount, 4096u);
+    CHECK_EQ(b->hash.count, 5000u - 4096u);
+    CHECK_EQ(b->length(), 5000u);
+
+    // Powers of two are less than half of any range: all stay hashed
+    LuaTable* s = LuaTable::create();
+    for (int32_t k = 2; k <= (1 << 20); k <<= 1) s->rawset(I(k), I(k));
+    CHECK(s->arraySize <= 4);
+    for (int32_t k = 2; k <= (1 << 20); k <<= 1) CHECK_EQ(s->rawget(I(k)).toInteger(), k);
+
+    // A half-filled range is not enough either, just over half is
+    LuaTable* h = LuaTable::create();
+    for (int32_t i = 1; i <= 64; i += 2) h->rawset(I(i + 64), I(i));
+    CHECK(h->arraySize < 64);
+    for (int32_t i = 1; i <= 70; i++) h->rawset(I(i), I(i));
+    CHECK(h->arraySize >= 128);
+    CHECK(h->rawget(I(127)).toInteger() == 63);
+
+    // Emptied array part: a rehash gives it back and keeps the survivors
+    LuaTable* e = LuaTable::create();
+    for (int32_t i = 1; i <= 256; i++) e->rawset(I(i), I(i));
+    for (int32_t i = 9; i <= 256; i++) if (i != 200) e->rawset(I(i), TValue::Nil());
+    for (int32_t i = 0; i < 64; i++) e->rawset(TValue::Number(i + 0.5), I(i));
+    CHECK(e->arraySize < 256);
+    for (int32_t i = 1; i <= 8; i++) CHECK_EQ(e->rawget(I(i)).toInteger(), i);
+    CHECK_EQ(e->rawget(I(200)).toInteger(), 200);
+    CHECK(e->rawget(I(100)).isNil());
+    for (int32_t i = 0; i < 64; i++) CHECK_EQ(e->rawget(TValue::Number(i + 0.5)).toInteger(), i);
+
+    return check::done();
+}
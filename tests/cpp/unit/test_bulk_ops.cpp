@@ -0,0 +1,91 @@
+// Bulk sequence operations: table.insert/remove/move through insertAt,
+// removeAt, moveRange and appendSpan, checked against a std::vector
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+#include <vector>
+
+using namespace l2c;
+
+static TValue make_seq(int32_t n, uint32_t arraySize) {
+    LuaTable* t = LuaTable::create(arraySize, 0);
+    for (int32_t i = 1; i <= n; i++) t->rawset(TValue::Integer(i), TValue::Integer(i));
+    return TValue::Table(t);
+}
+
+static bool same(const TValue& t, const std::vector<int32_t>& want) {
+    LuaTable* tbl = t.toTable();
+    if (tbl->length() != want.size()) return false;
+    for (size_t i = 0; i < want.size(); i++) {
+        TValue v = tbl->rawget(TValue::Integer((int32_t)i + 1));
+        if (!v.isInteger() || v.toInteger() != want[i]) return false;
+    }
+    return tbl->rawget(TValue::Integer((int32_t)want.size() + 1)).isNil();
+}
+
+int main() {
+    // insert at the front, middle and end (the last one grows the array)
+    TValue t = make_seq(8, 8);
+    std::vector<int32_t> v = {1, 2, 3, 4, 5, 6, 7, 8};
+    table_insert(t, 1, TValue::Integer(100)); v.insert(v.begin(), 100);
+    table_insert(t, 5, TValue::Integer(200)); v.insert(v.begin() + 4, 200);
+    table_insert(t, TValue::Integer(300));    v.push_back(300);
+    CHECK(same(t, v));
+    CHECK_EQ(t.toTable()->arrayCount, (uint32_t)v.size());
+
+    // remove from the middle, the front, and without a position (pops)
+    CHECK_EQ(table_remove(t, 3).toInteger(), v[2]); v.erase(v.begin() + 2);
+    CHECK_EQ(table_remove(t, 1).toInteger(), 100);  v.erase(v.begin());
+    CHECK_EQ(table_remove(t).toInteger(), 300);     v.pop_back();
+    CHECK(same(t, v));
+    CHECK_EQ(t.toTable()->arrayCount, (uint32_t)v.size());
+    // #t+1 is accepted and returns nil
+    CHECK(table_remove(t, (NUMBER)v.size() + 1).isNil());
+    CHECK(same(t, v));
+    // Removing from an empty table
+    TValue e = make_seq(0, 0);
+    CHECK(table_remove(e).isNil());
+    CHECK(table_remove(e, 0).isNil());
+
+    // table.move within one table, both overlap directions
+    TValue m = make_seq(10, 16);
+    table_move(m, 1, 6, 3);        // forward overlap: 1 2 1 2 3 4 5 6 9 10
+    CHECK(same(m, {1, 2, 1, 2, 3, 4, 5, 6, 9, 10}));
+    table_move(m, 3, 10, 1);       // backward overlap
+    CHECK(same(m, {1, 2, 3, 4, 5, 6, 9, 10, 9, 10}));
+
+    // ... to another table, past its array part
+    TValue d = make_seq(2, 2);
+    CHECK_EQ(table_move(m, 5, 8, 3, d).toTable(), d.toTable());
+    CHECK(same(d, {1, 2, 5, 6, 9, 10}));
+
+    // ... and in a table whose sequence is in the hash part
+    LuaTable* h = LuaTable::create(0, 16);
+    for (int32_t i = 6; i >= 1; i--) h->rawset(TValue::Integer(i), TValue::Integer(i));
+    TValue ht = TValue::Table(h);
+    table_move(ht, 1, 4, 2);
+    CHECK(same(ht, {1, 1, 2, 3, 4, 6}));
+    table_insert(ht, 2, TValue::Integer(7));
+    CHECK(same(ht, {1, 7, 1, 2, 3, 4, 6}));
+    CHECK_EQ(table_remove(ht, 1).toInteger(), 1);
+    CHECK(same(ht, {7, 1, 2, 3, 4, 6}));
+
+    // appendSpan from the border, growing the array part once
+    TValue a = make_seq(3, 4);
+    const TValue extra[] = {TValue::Integer(4), TValue::Integer(5), TValue::Integer(6)};
+    a.toTable()->appendSpan(3, extra, 3);
+    CHECK(same(a, {1, 2, 3, 4, 5, 6}));
+    CHECK_EQ(a.toTable()->arrayCount, 6u);
+
+    // A number array stays one only while every element is a float
+    LuaTable* n = LuaTable::create(4, 0, ARRAY_NUMBER);
+    for (int32_t i = 1; i <= 4; i++) n->rawset(TValue::Integer(i), TValue::Number(i * 0.5));
+    CHECK(n->isNumberArray());
+    table_insert(TValue::Table(n), 2, TValue::Number(9.0));
+    CHECK(n->isNumberArray());
+    table_insert(TValue::Table(n), 1, TValue::String("x"));
+    CHECK(!n->isNumberArray());
+
+    return check::done();
+}
@@ -0,0 +1,110 @@
+// HashGroup masks against a byte-by-byte reference, on whichever backend
+// the build selects (the CMake variants force scalar, AVX2 and NEON):
+// matchH2, matchEmpty, matchAvailable and matchLive over random ctrl
+// bytes, the SENTINEL tail init(n) leaves in a group, and slotOf /
+// fromSlot walking a mask
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+#include <cstring>
+#include <vector>
+
+#define STRINGIFY2(x) #x
+#define STRINGIFY(x) STRINGIFY2(x)
+
+using Mask = HashGroup::Mask;
+static constexpr uint32_t W = HashGroup::WIDTH;
+
+// The bit a backend sets for a matching slot (NEON: the top of its nibble)
+static Mask slotBit(uint32_t i) {
+    return Mask(1) << ((i << HashGroup::MASK_SHIFT) + (HashGroup::MASK_SHIFT ? 3 : 0));
+}
+
+template<typename Pred>
+static Mask reference(const HashGroup& g, Pred pred) {
+    Mask m = 0;
+    for (uint32_t i = 0; i < W; i++)
+        if (pred(g.ctrl[i])) m |= slotBit(i);
+    return m;
+}
+
+// The slots of a mask, lowest first, as probing walks them
+static std::vector<uint32_t> slots(Mask m) {
+    std::vector<uint32_t> out;
+    for (; m; m &= m - 1) out.push_back(HashGroup::slotOf(m));
+    return out;
+}
+
+static void check_group(const HashGroup& g) {
+    CHECK_EQ(g.matchEmpty(), reference(g, [](int8_t c) { return c == CTRL_EMPTY; }));
+    CHECK_EQ(g.matchAvailable(), reference(g, [](int8_t c) { return c == CTRL_EMPTY || c == CTRL_DELETED; }));
+    CHECK_EQ(g.matchLive(), reference(g, [](int8_t c) { return c >= 0; }));
+    for (int8_t h : {0, 1, 0x2a, 0x7f}) {
+        Mask m = g.matchH2(h);
+        CHECK_EQ(m, reference(g, [h](int8_t c) { return c == h; }));
+        std::vector<uint32_t> want;
+        for (uint32_t i = 0; i < W; i++) if (g.ctrl[i] == h) want.push_back(i);
+        CHECK(slots(m) == want);
+        // fromSlot drops the slots below i
+        for (uint32_t i = 0; i < W; i += 5) {
+            std::vector<uint32_t> above;
+            for (uint32_t s : want) if (s >= i) above.push_back(s);
+            CHECK(slots(m & HashGroup::fromSlot(i)) == above);
+        }
+    }
+}
+
+int main() {
+#ifdef L2C_EXPECT_BACKEND
+    CHECK(std::strcmp(HashGroup::BACKEND, STRINGIFY(L2C_EXPECT_BACKEND)) == 0);
+#endif
+#if defined(LUATABLE_AVX2) && defined(__GNUC__)
+    if (!__builtin_cpu_supports("avx2")) return 77;  // ctest SKIP_RETURN_CODE
+#endif
+
+    // init(n): n EMPTY slots, then a SENTINEL tail no mask reports
+    for (uint32_t n = 1; n <= W; n++) {
+        HashGroup g;
+        g.init(n);
+        for (uint32_t i = 0; i < W; i++) CHECK_EQ(g.ctrl[i], i < n ? CTRL_EMPTY : CTRL_SENTINEL);
+        check_group(g);
+        CHECK(slots(g.matchEmpty()).size() == n);
+        CHECK_EQ(g.matchLive(), Mask(0));
+        // Fill and delete slots below n; the tail stays unmatched
+        g.ctrl[0] = 0x2a;
+        g.ctrl[n - 1] = n > 1 ? CTRL_DELETED : 0x2a;
+        check_group(g);
+        CHECK(slots(g.matchAvailable()).size() == n - 1);
+        CHECK(slots(g.matchLive()) == std::vector<uint32_t>{0});
+    }
+
+    // Random groups of EMPTY, DELETED, SENTINEL and h2 bytes
+    uint32_t seed = 7;
+    auto rnd = [&seed] { seed = seed * 1664525u + 1013904223u; return seed >> 24; };
+    for (int round = 0; round < 2000; round++) {
+        HashGroup g;
+        for (uint32_t i = 0; i < W; i++) {
+            uint32_t r = rnd();
+            g.ctrl[i] = r < 64 ? CTRL_EMPTY : r < 96 ? CTRL_DELETED : r < 112 ? CTRL_SENTINEL
+                      : (int8_t)(r & 1 ? 0x2a : r & 0x7f);
+        }
+        check_group(g);
+    }
+
+    // A part smaller than a group: its one group has a SENTINEL tail
+    HashPart hp{};
+    hp.init(HashPart::MIN_CAPACITY);
+    CHECK_EQ(hp.numGroups, 1u);
+    for (uint32_t i = HashPart::MIN_CAPACITY; i < W; i++) CHECK_EQ(hp.ctrlAt(i), CTRL_SENTINEL);
+    for (int32_t k = 1; k <= 3; k++) *hp.upsert(TValue::String(k == 1 ? "a" : k == 2 ? "b" : "c")) = TValue::Integer(k);
+    CHECK_EQ(hp.find(TValue::String("b"))->toInteger(), 2);
+    CHECK(hp.find(TValue::String("d")) == nullptr);
+    CHECK(hp.remove(TValue::String("a")));
+    CHECK(hp.find(TValue::String("a")) == nullptr);
+    CHECK_EQ(hp.find(TValue::String("c"))->toInteger(), 3);
+    check_group(hp.groups[0]);
+    hp.destroy();
+
+    return check::done();
+}
@@ -0,0 +1,74 @@
+// Small tables' inline parts: create() places up to SMALL_ARRAY array
+// slots and a SMALL_HASH hash part in the table's own allocation; parts
+// that outgrow it move out and the INLINE_* flags stay
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+static uint64_t total_allocs() {
+    uint64_t n = 0;
+    for (const auto& cs : TableAllocator::instance().stats().classes) n += cs.allocs;
+    return n;
+}
+
+// Unreachable garbage for the collector: inline parts must not be freed
+// on their own (ASan reports it if they are)
+NOINLINE static void make_garbage() {
+    for (int i = 0; i < 2000; i++) {
+        LuaTable* t = LuaTable::create(i % 5, i % 3 ? 4 : 0);
+        for (int32_t k = 1; k <= i % 9; k++) t->rawset(TValue::Integer(k), TValue::Integer(k));
+        if (i % 2) t->rawset(TValue::Number(i + 0.5), TValue::Integer(i));
+    }
+}
+
+int main() {
+    // Both parts inline: one allocation
+    uint64_t before = total_allocs();
+    LuaTable* t = LuaTable::create(LuaTable::SMALL_ARRAY, LuaTable::SMALL_HASH);
+    CHECK_EQ(total_allocs() - before, 1u);
+    CHECK(t->flags & LuaTable::INLINE_ARRAY);
+    CHECK(t->flags & LuaTable::INLINE_HASH);
+    CHECK(t->array == t->inlineArray());
+    CHECK(reinterpret_cast<char*>(t->hash.groups) == t->inlineSpace());
+    CHECK_EQ(t->arraySize, LuaTable::SMALL_ARRAY);
+    CHECK_EQ(t->hash.capacity, LuaTable::SMALL_HASH);
+
+    for (int32_t i = 1; i <= 4; i++) t->rawset(TValue::Integer(i), TValue::Integer(i));
+    const char* names[] = {"x", "y", "z"};
+    for (int32_t i = 0; i < 3; i++) t->rawset(TValue::String(names[i]), TValue::Integer(10 + i));
+    CHECK(t->array == t->inlineArray());
+    CHECK(reinterpret_cast<char*>(t->hash.groups) == t->inlineSpace());
+
+    // Outgrowing both: the parts move out, the flags keep the space known
+    for (int32_t i = 5; i <= 40; i++) t->rawset(TValue::Integer(i), TValue::Integer(i));
+    for (int32_t i = 0; i < 20; i++) t->rawset(TValue::Number(i + 0.5), TValue::Integer(i));
+    CHECK(t->array != t->inlineArray());
+    CHECK(reinterpret_cast<char*>(t->hash.groups) != t->inlineSpace());
+    CHECK(t->flags & LuaTable::INLINE_ARRAY);
+    CHECK(t->flags & LuaTable::INLINE_HASH);
+    for (int32_t i = 1; i <= 40; i++) CHECK_EQ(t->rawget(TValue::Integer(i)).toInteger(), i);
+    for (int32_t i = 0; i < 3; i++) CHECK_EQ(t->rawget(TValue::String(names[i])).toInteger(), 10 + i);
+    for (int32_t i = 0; i < 20; i++) CHECK_EQ(t->rawget(TValue::Number(i + 0.5)).toInteger(), i);
+
+    // A "__" key clears the metamethod cache but not the part flags
+    t->rawset(TValue::String("__index"), TValue::Nil());
+    CHECK(t->flags & LuaTable::INLINE_HASH);
+
+    // Only the part asked for is inline; {} has none
+    LuaTable* a = LuaTable::create(3, 0);
+    CHECK(a->flags & LuaTable::INLINE_ARRAY);
+    CHECK(!(a->flags & LuaTable::INLINE_HASH));
+    CHECK_EQ(a->hash.capacity, 0u);
+    LuaTable* h = LuaTable::create(0, 2);
+    CHECK(!(h->flags & LuaTable::INLINE_ARRAY));
+    CHECK(h->flags & LuaTable::INLINE_HASH);
+    LuaTable* e = LuaTable::create();
+    CHECK(!(e->flags & (LuaTable::INLINE_ARRAY | LuaTable::INLINE_HASH)));
+    LuaTable* big = LuaTable::create(LuaTable::SMALL_ARRAY + 1, 0);
+    CHECK(!(big->flags & LuaTable::INLINE_ARRAY));
+
+    make_garbage();
+    LuaGC::instance().fullCollect();
+
+    return check::done();
+}
@@ -0,0 +1,65 @@
+// #t: the arrayCount hint, borders around holes, and sequences that go
+// on in the hash part
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+static bool present(const LuaTable* t, uint32_t k) {
+    return !t->rawget(TValue::Integer((int32_t)k)).isNil();
+}
+
+// Lua's definition: t[n] ~= nil (or n == 0) and t[n+1] == nil
+static bool is_border(const LuaTable* t, uint32_t n) {
+    return (n == 0 || present(t, n)) && !present(t, n + 1);
+}
+
+int main() {
+    // Appends and pops: the border is arrayCount
+    LuaTable* t = LuaTable::create();
+    for (int32_t i = 1; i <= 100; i++) {
+        t->rawset(TValue::Integer(i), TValue::Integer(i));
+        CHECK_EQ(t->length(), (uint32_t)i);
+    }
+    for (int32_t i = 100; i >= 1; i--) {
+        t->rawset(TValue::Integer(i), TValue::Nil());
+        CHECK_EQ(t->length(), (uint32_t)i - 1);
+    }
+
+    // Every hole pattern in a 12-slot array gives a border
+    for (uint32_t holes = 0; holes < (1u << 12); holes += 7) {
+        LuaTable* h = LuaTable::create(12, 0);
+        for (uint32_t i = 0; i < 12; i++)
+            if (!(holes >> i & 1)) h->rawset(TValue::Integer((int32_t)i + 1), TValue::Integer(1));
+        CHECK(is_border(h, h->length()));
+    }
+
+    // A hole below the hint: the border is searched below it
+    LuaTable* b = LuaTable::create(8, 0);
+    for (int32_t i = 1; i <= 6; i++) b->rawset(TValue::Integer(i), TValue::Integer(i));
+    b->rawset(TValue::Integer(3), TValue::Nil());
+    CHECK(is_border(b, b->length()));
+
+    // Integer keys only in the hash part (as a rehash may leave them)
+    LuaTable* s = LuaTable::create(0, 256);
+    for (int32_t i = 1; i <= 200; i++) *s->hash.upsert(TValue::Integer(i)) = TValue::Integer(i);
+    CHECK_EQ(s->arraySize, 0u);
+    CHECK_EQ(s->length(), 200u);
+    s->rawset(TValue::Integer(150), TValue::Nil());
+    CHECK(is_border(s, s->length()));
+
+    // A full array part continued in the hash part
+    LuaTable* f = LuaTable::create(4, 8);
+    for (int32_t i = 1; i <= 4; i++) f->rawset(TValue::Integer(i), TValue::Integer(i));
+    f->rawset(TValue::Integer(6), TValue::Integer(6));
+    f->rawset(TValue::Integer(5), TValue::Integer(5));
+    CHECK(is_border(f, f->length()));
+    CHECK(f->length() >= 4);
+
+    // Number arrays stay dense, so arrayCount is the answer
+    LuaTable* n = LuaTable::create(16, 0, ARRAY_NUMBER);
+    for (int32_t i = 1; i <= 10; i++) n->rawset(TValue::Integer(i), TValue::Number(i));
+    CHECK(n->isNumberArray());
+    CHECK_EQ(n->length(), 10u);
+
+    return check::done();
+}
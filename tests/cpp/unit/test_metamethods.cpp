@@ -0,0 +1,49 @@
+// Absent-metamethod cache: fasttm's flags bits and their invalidation
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+int main() {
+    LuaTable* mt = LuaTable::create(0, 4);
+    const uint32_t SUB = 1u << TM_SUB, INDEX = 1u << TM_INDEX;
+
+    // A miss sets the event's bit; the next lookup stops there
+    CHECK(mt->fasttm(TM_SUB) == nullptr);
+    CHECK(mt->flags & SUB);
+    CHECK(mt->fasttm(TM_SUB) == nullptr);
+
+    // Other keys don't touch the cache
+    mt->rawset(TValue::String("sub"), TValue::Integer(1));
+    mt->rawset(TValue::String("_x"), TValue::Integer(1));
+    CHECK(mt->flags & SUB);
+
+    // Storing a "__" key clears it, and the new metamethod is found
+    mt->rawset(TValue::String("__sub"), TValue::Integer(7));
+    CHECK(!(mt->flags & SUB));
+    const TValue* mm = mt->fasttm(TM_SUB);
+    CHECK(mm != nullptr && mm->toInteger() == 7);
+
+    // Setting it to nil makes it absent again
+    mt->rawset(TValue::String("__sub"), TValue::Nil());
+    CHECK(mt->fasttm(TM_SUB) == nullptr);
+    CHECK(mt->flags & SUB);
+
+    // Invalidation keeps the part flags (the inline hash part)
+    CHECK(mt->flags & LuaTable::INLINE_HASH);
+    mt->rawset(TValue::String("__len"), TValue::Integer(1));
+    CHECK(mt->flags & LuaTable::INLINE_HASH);
+
+    // __index added after a cached miss takes effect on the next index
+    LuaTable* base = LuaTable::create(0, 1);
+    base->rawset(TValue::String("k"), TValue::Integer(42));
+    LuaTable* t = LuaTable::create();
+    t->metatable = mt;
+    TValue tv = TValue::Table(t);
+    const TValue& ctv = tv;
+    CHECK(ctv[TValue::String("k")].isNil());
+    CHECK(mt->flags & INDEX);
+    mt->rawset(TValue::String("__index"), TValue::Table(base));
+    CHECK_EQ(TValue(ctv[TValue::String("k")]).toInteger(), 42);
+
+    return check::done();
+}
@@ -0,0 +1,152 @@
+// Snapshots: save a table graph, map it back in and read it; values that
+// point into the file are fixed up to the mapping; truncated or corrupt
+// files load as nil
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace l2c;
+
+static TValue S(const char* s) { return TValue::String(s); }
+static TValue I(int32_t i) { return TValue::Integer(i); }
+
+static std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+}
+
+static void write_file(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream(path, std::ios::binary).write(bytes.data(), (std::streamsize)bytes.size());
+}
+
+static bool str_is(TValue v, const char* s) {
+    return v.isString() && std::strcmp(static_cast<const char*>(v.toPtr()), s) == 0;
+}
+
+int main() {
+    const std::string dir = std::filesystem::temp_directory_path().string();
+    const std::string path = dir + "/l2c_test_snapshot.bin";
+    const std::string bad  = dir + "/l2c_test_snapshot_bad.bin";
+
+    // A graph with an array part, a number array, a shared table, a
+    // cycle, strings, a boxed integer and a table key
+    LuaTable* root = LuaTable::create();
+    for (int32_t i = 1; i <= 10; i++) root->rawset(I(i), I(i * i));
+    LuaTable* shared = LuaTable::create();
+    shared->rawset(S("x"), TValue::Number(1.5));
+    LuaTable* floats = LuaTable::create(4, 0, ARRAY_NUMBER);
+    for (int32_t i = 1; i <= 4; i++) floats->rawset(I(i), TValue::Number(i * 0.25));
+    LuaTable* keyed = LuaTable::create();
+    keyed->rawset(TValue::Table(shared), S("by table"));
+    root->rawset(S("name"), new_string("snap", 4));
+    root->rawset(S("a"), TValue::Table(shared));
+    root->rawset(S("b"), TValue::Table(shared));
+    root->rawset(S("self"), TValue::Table(root));
+    root->rawset(S("floats"), TValue::Table(floats));
+    root->rawset(S("keyed"), TValue::Table(keyed));
+    root->rawset(S("big"), TValue::Int64(int64_t(1) << 40));
+    root->rawset(S("flag"), TValue::Boolean(true));
+    root->rawset(TValue::Number(2.5), S("float key"));
+
+    CHECK(save_snapshot(TValue::Table(root), path.c_str()));
+    TValue loaded = load_snapshot(path.c_str());
+    CHECK(loaded.isTable());
+    if (!loaded.isTable()) return check::done();
+
+    // Same contents, in fresh tables
+    LuaTable* t = loaded.toTable();
+    CHECK(t != root);
+    CHECK_EQ(t->length(), 10u);
+    for (int32_t i = 1; i <= 10; i++) CHECK_EQ(t->rawget(I(i)).toInteger(), i * i);
+    CHECK(str_is(t->rawget(S("name")), "snap"));
+    CHECK(str_is(t->rawget(TValue::Number(2.5)), "float key"));
+    CHECK(t->rawget(S("flag")) == TValue::Boolean(true));
+    CHECK(t->rawget(S("big")).isInt64());
+    CHECK_EQ(t->rawget(S("big")).toInt64(), int64_t(1) << 40);
+
+    // Table values were indices in the file: fixed up to the new tables,
+    // keeping sharing and the cycle
+    TValue a = t->rawget(S("a")), b = t->rawget(S("b"));
+    CHECK(a.isTable() && a.toTable() != shared);
+    CHECK(a.isTable() && b.isTable() && a.toTable() == b.toTable());
+    CHECK(t->rawget(S("self")).isTable() && t->rawget(S("self")).toTable() == t);
+    CHECK_EQ(a.toTable()->rawget(S("x")).toNumber(), 1.5);
+
+    // Strings were offsets in the file: they now point into the mapping
+    // and hash like any string with their content
+    TValue name = t->rawget(S("name"));
+    CHECK(name.toPtr() != root->rawget(S("name")).toPtr());
+    CHECK(t->flags & LuaTable::MAPPED_ARRAY);
+    CHECK(t->flags & LuaTable::MAPPED_HASH);
+    // (the array part is in the mapping too, both within the file's size)
+    const std::ptrdiff_t apart = static_cast<const char*>(name.toPtr()) - reinterpret_cast<const char*>(t->array);
+    const auto size = (std::ptrdiff_t)std::filesystem::file_size(path);
+    CHECK(apart > -size && apart < size);
+
+    // The number array keeps its kind; the table key was rehashed
+    LuaTable* f = t->rawget(S("floats")).toTable();
+    CHECK(f->isNumberArray());
+    CHECK_EQ(f->rawget(I(3)).toNumber(), 0.75);
+    LuaTable* k = t->rawget(S("keyed")).toTable();
+    CHECK(str_is(k->rawget(a), "by table"));
+
+    // Stores to mapped parts work; a part that grows moves out
+    t->rawset(I(1), I(-1));
+    t->rawset(S("name"), S("changed"));
+    CHECK_EQ(t->rawget(I(1)).toInteger(), -1);
+    for (int32_t i = 11; i <= 100; i++) t->rawset(I(i), I(i));
+    CHECK(!(t->flags & LuaTable::MAPPED_ARRAY));
+    CHECK_EQ(t->length(), 100u);
+    CHECK_EQ(t->rawget(I(10)).toInteger(), 100);
+    for (int32_t i = 0; i < 40; i++) t->rawset(TValue::Number(i + 0.5), I(i));
+    CHECK(!(t->flags & LuaTable::MAPPED_HASH));
+    CHECK(str_is(t->rawget(S("name")), "changed"));
+    CHECK(t->rawget(S("self")).toTable() == t);
+
+    // Truncated files
+    const std::vector<char> good = read_file(path);
+    CHECK(good.size() > sizeof(snapshot::Header));
+    for (size_t n : {size_t(0), size_t(7), sizeof(snapshot::Header) - 1, sizeof(snapshot::Header),
+                     good.size() / 2, good.size() - 1}) {
+        write_file(bad, std::vector<char>(good.begin(), good.begin() + (std::ptrdiff_t)n));
+        CHECK(load_snapshot(bad.c_str()).isNil());
+    }
+
+    // Bad magic, version and byte order
+    for (size_t at : {size_t(0), offsetof(snapshot::Header, version), offsetof(snapshot::Header, byteOrder)}) {
+        std::vector<char> corrupt = good;
+        corrupt[at] ^= 0x5a;
+        write_file(bad, corrupt);
+        CHECK(load_snapshot(bad.c_str()).isNil());
+    }
+
+    // A table value whose index is past the last table
+    {
+        std::vector<char> corrupt = good;
+        snapshot::Header h;
+        std::memcpy(&h, corrupt.data(), sizeof(h));
+        snapshot::TableRecord r;
+        std::memcpy(&r, corrupt.data() + sizeof(h), sizeof(r));
+        uint64_t v = TValue::TAG_TABLE | (h.tableCount + 5);
+        std::memcpy(corrupt.data() + r.array, &v, sizeof(v));
+        write_file(bad, corrupt);
+        CHECK(load_snapshot(bad.c_str()).isNil());
+    }
+
+    // A file that isn't there, and graphs a snapshot can't hold
+    CHECK(load_snapshot((dir + "/l2c_test_snapshot_missing.bin").c_str()).isNil());
+    CHECK(!save_snapshot(I(1), bad.c_str()));
+    LuaTable* withFn = LuaTable::create();
+    withFn->rawset(S("f"), TValue::NewFunction([](TValue x) { return x; }));
+    CHECK(!save_snapshot(TValue::Table(withFn), bad.c_str()));
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(bad);
+    return check::done();
+}
@@ -0,0 +1,57 @@
+// L2C_STATS counters (built with -DL2C_STATS): the table paths bump
+// their counters, other threads' counts are summed, reset clears them
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+#include <cstring>
+#include <thread>
+
+#ifndef L2C_STATS
+#  error "test_stats needs -DL2C_STATS"
+#endif
+
+using namespace l2c;
+
+static void table_work() {
+    LuaTable* t = LuaTable::create();
+    for (int32_t i = 1; i <= 64; i++) t->rawset(TValue::Integer(i), TValue::Integer(i));
+    t->rawset(TValue::String("name"), TValue::Integer(1));
+    for (int32_t i = 1; i <= 64; i++) (void)t->rawget(TValue::Integer(i));
+    (void)t->rawget(TValue::String("name"));
+    (void)t->rawget(TValue::String("missing"));
+}
+
+int main() {
+    reset_stats();
+    table_work();
+    StatsSnapshot s = stats_snapshot();
+    CHECK_EQ(s.counts[STAT_TABLE_CREATE], 1u);
+    CHECK(s.counts[STAT_ARRAY_SET] >= 64);
+    CHECK(s.counts[STAT_ARRAY_GET] >= 64);
+    CHECK(s.counts[STAT_HASH_SET] >= 1);
+    CHECK(s.counts[STAT_HASH_GET] >= 2);
+    CHECK(s.counts[STAT_ARRAY_RESIZE] >= 1);
+    uint64_t probes = 0;
+    for (uint64_t p : s.probeGroups) probes += p;
+    CHECK_EQ(probes, s.counts[STAT_HASH_LOOKUP]);
+
+    // A finished thread's counts stay in the totals
+    std::thread([] { table_work(); }).join();
+    s = stats_snapshot();
+    CHECK_EQ(s.counts[STAT_TABLE_CREATE], 2u);
+
+    // The report names every counter
+    char buf[8192] = {};
+    FILE* out = fmemopen(buf, sizeof(buf) - 1, "w");
+    dump_stats(out);
+    std::fclose(out);
+    for (const char* name : STAT_NAMES) CHECK(std::strstr(buf, name) != nullptr);
+    CHECK(std::strstr(buf, "array hit ratio") != nullptr);
+
+    reset_stats();
+    s = stats_snapshot();
+    for (uint64_t c : s.counts) CHECK_EQ(c, 0u);
+
+    return check::done();
+}
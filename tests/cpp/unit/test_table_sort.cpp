@@ -0,0 +1,90 @@
+// table.sort: pdqsort over the array part on the usual bad inputs, with
+// the number and string fast paths, a comparator and a hash-part sequence
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace l2c;
+
+static TValue make_table(const std::vector<int32_t>& keys, bool floats) {
+    LuaTable* t = LuaTable::create((uint32_t)keys.size(), 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        TValue v = floats ? TValue::Number(keys[i] + 0.5) : TValue::Integer(keys[i]);
+        t->rawset(TValue::Integer((int32_t)i + 1), v);
+    }
+    return TValue::Table(t);
+}
+
+// Sorted by less and a permutation of keys
+template<typename Less>
+static bool sorted_permutation(const TValue& t, std::vector<int32_t> keys, Less less) {
+    std::vector<double> got;
+    for (size_t i = 1; i <= keys.size(); i++) got.push_back(t.toTable()->rawget(TValue::Integer((int32_t)i)).asNumber());
+    for (size_t i = 1; i < got.size(); i++)
+        if (less(got[i], got[i - 1])) return false;
+    std::vector<double> want(keys.begin(), keys.end());
+    std::sort(want.begin(), want.end());
+    std::vector<double> have = got;
+    for (double& d : have) d = (double)(int64_t)std::floor(d);
+    std::sort(have.begin(), have.end());
+    return have == want;
+}
+
+int main() {
+    uint32_t seed = 12345;
+    auto rnd = [&seed](uint32_t n) { seed = seed * 1103515245u + 12345u; return (int32_t)((seed >> 8) % n); };
+
+    for (uint32_t n : {2u, 3u, 17u, 100u, 1000u, 5000u}) {
+        std::vector<std::vector<int32_t>> patterns(6);
+        for (uint32_t i = 0; i < n; i++) {
+            patterns[0].push_back(rnd(n));                          // random
+            patterns[1].push_back((int32_t)i);                      // sorted
+            patterns[2].push_back((int32_t)(n - i));                // reversed
+            patterns[3].push_back(7);                               // all equal
+            patterns[4].push_back((int32_t)(i % 16));               // sawtooth
+            patterns[5].push_back((int32_t)std::min(i, n - i));     // organ pipe
+        }
+        for (const auto& keys : patterns) {
+            for (bool floats : {false, true}) {
+                TValue t = make_table(keys, floats);
+                table_sort(t);
+                CHECK(sorted_permutation(t, keys, [](double a, double b) { return a < b; }));
+            }
+            // Descending, through an inlined comparator
+            TValue t = make_table(keys, false);
+            table_sort(t, [](const TValue& a, const TValue& b) { return a.toInteger() > b.toInteger(); });
+            CHECK(sorted_permutation(t, keys, [](double a, double b) { return a > b; }));
+        }
+    }
+
+    // Strings, and mixed integers and floats (the generic order)
+    LuaTable* s = LuaTable::create(4, 0);
+    const char* words[] = {"pear", "apple", "fig", "banana"};
+    for (int32_t i = 0; i < 4; i++) s->rawset(TValue::Integer(i + 1), TValue::String(words[i]));
+    table_sort(TValue::Table(s));
+    CHECK(std::strcmp((const char*)s->rawget(TValue::Integer(1)).toPtr(), "apple") == 0);
+    CHECK(std::strcmp((const char*)s->rawget(TValue::Integer(4)).toPtr(), "pear") == 0);
+
+    LuaTable* m = LuaTable::create(4, 0);
+    m->rawset(TValue::Integer(1), TValue::Number(2.5));
+    m->rawset(TValue::Integer(2), TValue::Integer(1));
+    m->rawset(TValue::Integer(3), TValue::Integer(3));
+    m->rawset(TValue::Integer(4), TValue::Number(-1.0));
+    table_sort(TValue::Table(m));
+    CHECK_EQ(m->rawget(TValue::Integer(1)).asNumber(), -1.0);
+    CHECK_EQ(m->rawget(TValue::Integer(2)).asNumber(), 1.0);
+    CHECK_EQ(m->rawget(TValue::Integer(4)).asNumber(), 3.0);
+
+    // A sequence in the hash part is sorted through a copy
+    LuaTable* h = LuaTable::create(0, 8);
+    for (int32_t i = 5; i >= 1; i--) h->rawset(TValue::Integer(i), TValue::Integer(10 - i));
+    table_sort(TValue::Table(h));
+    for (int32_t i = 1; i <= 5; i++) CHECK_EQ(h->rawget(TValue::Integer(i)).toInteger(), 4 + i);
+
+    return check::done();
+}
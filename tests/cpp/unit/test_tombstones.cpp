@@ -0,0 +1,66 @@
+// Hash tombstones: eraseAt's EMPTY/DELETED choice, the tombstone count,
+// and rehashes that compact a part clogged by delete/insert churn
+
+#include "l2c_runtime_lua_table.hpp"
+#include "check.hpp"
+
+static uint32_t count_deleted(const HashPart& hp) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < hp.capacity; i++) n += hp.ctrlAt(i) == CTRL_DELETED;
+    return n;
+}
+
+static TValue key(int32_t i) { return TValue::Number(i + 0.25); }
+
+int main() {
+    // Fill a part to just under its load factor, then remove every other key
+    HashPart hp{};
+    hp.init(128);
+    const int32_t n = 128 * 7 / 8 - 1;
+    for (int32_t i = 0; i < n; i++) *hp.upsert(key(i)) = TValue::Integer(i);
+    CHECK_EQ(hp.count, (uint32_t)n);
+    CHECK(!hp.needsRehash());
+    for (int32_t i = 0; i < n; i += 2) CHECK(hp.remove(key(i)));
+    CHECK(!hp.remove(key(0)));
+    CHECK_EQ(hp.count, (uint32_t)(n / 2));
+    CHECK_EQ(hp.tombstones, count_deleted(hp));
+    // Survivors stay reachable past the tombstones
+    for (int32_t i = 1; i < n; i += 2) {
+        TValue* v = hp.find(key(i));
+        CHECK(v != nullptr && v->toInteger() == i);
+    }
+    // Reinserting reuses tombstones first
+    uint32_t before = hp.tombstones;
+    for (int32_t i = 0; i < n; i += 2) *hp.upsert(key(i)) = TValue::Integer(i);
+    CHECK(hp.tombstones <= before);
+    CHECK_EQ(hp.tombstones, count_deleted(hp));
+    CHECK_EQ(hp.count, (uint32_t)n);
+    hp.destroy();
+
+    // A group with an empty slot frees straight back to EMPTY
+    HashPart small{};
+    small.init(HashPart::MIN_CAPACITY);
+    *small.upsert(key(1)) = TValue::Integer(1);
+    CHECK(small.remove(key(1)));
+    CHECK_EQ(small.tombstones, 0u);
+    CHECK_EQ(small.count, 0u);
+    small.destroy();
+
+    // Churn through a table: a sliding window of 8 live keys
+    LuaTable* t = LuaTable::create(0, 8);
+    for (int32_t i = 0; i < 100000; i++) {
+        t->rawset(key(i), TValue::Integer(i));
+        if (i >= 8) t->rawset(key(i - 8), TValue::Nil());
+    }
+    CHECK(t->hash.capacity <= 64);
+    for (int32_t i = 100000 - 8; i < 100000; i++) CHECK_EQ(t->rawget(key(i)).toInteger(), i);
+    CHECK(t->rawget(key(5)).isNil());
+
+    // Storing nil under an absent key inserts nothing
+    uint32_t count = t->hash.count;
+    t->rawset(key(-7), TValue::Nil());
+    t->rawset(TValue::String("absent"), TValue::Nil());
+    CHECK_EQ(t->hash.count, count);
+
+    return check::done();
+}
@@ -0,0 +1,93 @@
+"""Tests for the content-addressed transpile cache"""
+
+import os
+from pathlib import Path
+
+import pytest
+
+try:
+    from luaparser import ast  # noqa: F401
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.cli.cache import (CacheEntry, TranspileCache, cache_options, signature_digest,
+                               write_if_changed)
+from lua2cpp.cli.main import main
+from lua2cpp.core.call_convention import CallConventionRegistry
+
+
+M = Path("m.lua")
+
+
+def _options(**overrides):
+    options = cache_options("lua_table", False, None, CallConventionRegistry(), False)
+    options.update(overrides)
+    return options
+
+
+class TestCacheKey:
+    """Test what a cache key depends on"""
+
+    def test_same_inputs_same_key(self):
+        assert TranspileCache.key(b"print(1)", M, _options(), {}) == \
+            TranspileCache.key(b"print(1)", M, _options(), {})
+
+    def test_source_changes_key(self):
+        assert TranspileCache.key(b"print(1)", M, _options(), {}) != \
+            TranspileCache.key(b"print(2)", M, _options(), {})
+
+    def test_options_change_key(self):
+        assert TranspileCache.key(b"x", M, _options(), {}) != \
+            TranspileCache.key(b"x", M, _options(runtime="table"), {})
+
+    def test_conventions_change_key(self):
+        registry = CallConventionRegistry()
+        registry.load_from_cli(["love=flat"])
+        flat = cache_options("lua_table", False, None, registry, False)
+        assert TranspileCache.key(b"x", M, _options(), {}) != TranspileCache.key(b"x", M, flat, {})
+
+    def test_dependency_signature_changes_key(self):
+        before = TranspileCache.key(b"x", M, _options(), {"a": signature_digest("void a_module_init();")})
+        after = TranspileCache.key(b"x", M, _options(), {"a": signature_digest("void a_module_init(TABLE arg);")})
+        assert before != after
+
+    def test_path_changes_key(self):
+        assert TranspileCache.key(b"x", Path("a.lua"), _options(), {}) != \
+            TranspileCache.key(b"x", Path("b.lua"), _options(), {})
+
+    def test_signature_ignores_comments(self):
+        assert signature_digest("// v1\nvoid f();") == signature_digest("// v2\nvoid f();")
+
+
+class TestCacheStore:
+    """Test storing entries and writing outputs"""
+
+    def test_round_trip(self, tmp_path):
+        cache = TranspileCache(tmp_path)
+        entry = CacheEntry(cpp="int x;", hpp="", init_func="m_module_init", library_calls=[["io", "write", 3]])
+        cache.store("ab" * 32, entry)
+        assert cache.load("ab" * 32) == entry
+
+    def test_missing_entry(self, tmp_path):
+        assert TranspileCache(tmp_path).load("cd" * 32) is None
+
+    def test_unchanged_output_is_not_rewritten(self, tmp_path):
+        path = tmp_path / "m.cpp"
+        assert write_if_changed(path, "int x;")
+        os.utime(path, (1, 1))
+        assert not write_if_changed(path, "int x;")
+        assert path.stat().st_mtime == 1
+        assert write_if_changed(path, "int y;")
+
+    def test_identical_modules_do_not_collide(self, tmp_path, monkeypatch):
+        for name in ("alpha", "beta"):
+            (tmp_path / f"{name}.lua").write_text('print("hi")')
+        out = tmp_path / "out"
+        for name in ("alpha", "beta"):
+            monkeypatch.setattr("sys.argv", ["lua2cpp", str(tmp_path / f"{name}.lua"), "--lib",
+                                             "--runtime=lua_table", "--output-dir", str(out),
+                                             "--cache-dir", str(tmp_path / "cache")])
+            main()
+        assert "beta_module_init" in (out / "beta.cpp").read_text()
+        assert "alpha" not in (out / "beta.cpp").read_text()
+        assert "beta_module_init" in (out / "beta.hpp").read_text()
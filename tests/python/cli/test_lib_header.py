@@ -0,0 +1,49 @@
+"""Tests for the --lib module header
+
+With the lua_table runtime the header is what a separately compiled main
+includes (L2C_SPLIT_MODULE), so it must declare only the module init.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast  # noqa: F401
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.cli.main import generate_lib_header
+
+
+CPP = """#include "../runtime/l2c_runtime_lua_table.hpp"
+
+template<typename x_t>
+auto square(x_t x) {
+    return x * x;
+}
+
+void demo_module_init(TABLE arg) {
+    l2c::print(square(NUMBER(2)));
+}
+"""
+
+
+class TestLuaTableLibHeader:
+    """Test the header generated for the lua_table runtime"""
+
+    def test_includes_lua_table_runtime(self):
+        hpp = generate_lib_header(CPP, "demo", runtime="lua_table")
+        assert '#include "../runtime/l2c_runtime_lua_table.hpp"' in hpp
+        assert "globals.hpp" not in hpp
+
+    def test_declares_only_module_init(self):
+        hpp = generate_lib_header(CPP, "demo", runtime="lua_table")
+        assert "void demo_module_init(TABLE arg);" in hpp
+        assert "square" not in hpp
+
+    def test_declares_g_when_used(self):
+        hpp = generate_lib_header(CPP, "demo", has_g_table=True, runtime="lua_table")
+        assert "extern TABLE G;" in hpp
+
+    def test_disabled_for_table_runtime(self):
+        hpp = generate_lib_header(CPP, "demo")
+        assert '#include "../runtime/globals.hpp"' in hpp
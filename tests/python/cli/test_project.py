@@ -0,0 +1,102 @@
+"""Tests for project mode (lua2cpp DIR / --project MANIFEST)"""
+
+import pytest
+
+try:
+    from luaparser import ast  # noqa: F401
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.cli.project import (PROJECT_HEADER, build_graph, dependency_order, discover_modules,
+                                 scan_dependencies, transpile_project)
+
+
+def _project(tmp_path, files):
+    root = tmp_path / "src"
+    for name, source in files.items():
+        path = root / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(source)
+    return root
+
+
+class TestDependencyGraph:
+    """Test module discovery and dependency scanning"""
+
+    def test_directory_modules_are_named_by_path(self, tmp_path):
+        root = _project(tmp_path, {"engine/event.lua": "", "game.lua": ""})
+        assert set(discover_modules(root)) == {"engine/event", "game"}
+
+    def test_manifest_lists_modules(self, tmp_path):
+        root = _project(tmp_path, {"a.lua": "", "b.lua": ""})
+        manifest = root / "project.txt"
+        manifest.write_text("# modules\na.lua\n\n")
+        assert set(discover_modules(manifest)) == {"a"}
+
+    def test_manifest_reports_missing_module(self, tmp_path):
+        manifest = tmp_path / "project.txt"
+        manifest.write_text("missing.lua\n")
+        with pytest.raises(FileNotFoundError):
+            discover_modules(manifest)
+
+    def test_require_edges(self):
+        source = 'local E = require("engine.event")\nlocal G = require "game"\nlocal x = require("ext")'
+        assert scan_dependencies(source, "card", {"engine/event", "game", "card"}) == {"engine/event", "game"}
+
+    def test_export_symbol_edges(self):
+        assert scan_dependencies("local c = Card()", "game", {"card", "game"}) == {"card"}
+
+    def test_dependencies_come_first(self, tmp_path):
+        root = _project(tmp_path, {"a.lua": 'require("b")', "b.lua": 'require("c")', "c.lua": ""})
+        assert dependency_order(build_graph(discover_modules(root))) == ["c", "b", "a"]
+
+
+class TestProjectTranspile:
+    """Test transpiling a whole project"""
+
+    FILES = {
+        "engine/util.lua": "local function twice(x)\n  return x * 2\nend\nprint(twice(2))",
+        "main.lua": 'local u = require("engine.util")\nprint(1)',
+    }
+
+    def test_writes_module_tree_and_project_header(self, tmp_path):
+        root = _project(tmp_path, self.FILES)
+        out = tmp_path / "out"
+        assert transpile_project(root, out, jobs=1, runtime="lua_table") == 0
+        assert (out / "engine/util.cpp").exists()
+        assert (out / "main.hpp").exists()
+        header = (out / PROJECT_HEADER).read_text()
+        assert header.index('"engine/util.hpp"') < header.index('"main.hpp"')
+
+    def test_parallel_matches_serial(self, tmp_path):
+        root = _project(tmp_path, self.FILES)
+        assert transpile_project(root, tmp_path / "serial", jobs=1, runtime="lua_table") == 0
+        assert transpile_project(root, tmp_path / "parallel", jobs=2, runtime="lua_table") == 0
+        for name in ("engine/util.cpp", "main.cpp", PROJECT_HEADER):
+            assert (tmp_path / "serial" / name).read_text() == (tmp_path / "parallel" / name).read_text()
+
+    def test_dependents_of_a_failed_module_are_skipped(self, tmp_path, capsys):
+        root = _project(tmp_path, {"bad.lua": "local = 1", "user.lua": 'require("bad")', "ok.lua": "print(1)"})
+        out = tmp_path / "out"
+        assert transpile_project(root, out, jobs=1, runtime="lua_table") == 1
+        assert "skipped: bad failed" in capsys.readouterr().err
+        assert (out / "ok.cpp").exists()
+        assert not (out / "user.cpp").exists()
+
+    def test_rerun_reuses_cache(self, tmp_path, monkeypatch):
+        from lua2cpp.cli import main
+        from lua2cpp.cli.cache import TranspileCache, cache_options
+        from lua2cpp.core.call_convention import CallConventionRegistry
+
+        root = _project(tmp_path, self.FILES)
+        out = tmp_path / "out"
+        cache = TranspileCache(tmp_path / "cache")
+        options = cache_options("lua_table", False, None, CallConventionRegistry(), False)
+        assert transpile_project(root, out, jobs=1, runtime="lua_table", cache=cache, cache_options=options) == 0
+        mtime = (out / "main.cpp").stat().st_mtime_ns
+
+        def fail(*args, **kwargs):
+            raise AssertionError("cache miss")
+        monkeypatch.setattr(main, "transpile_file", fail)
+        assert transpile_project(root, out, jobs=1, runtime="lua_table", cache=cache, cache_options=options) == 0
+        assert (out / "main.cpp").stat().st_mtime_ns == mtime
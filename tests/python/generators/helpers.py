@@ -0,0 +1,10 @@
+"""Shared helpers for the generator tests"""
+
+from luaparser import ast
+
+from lua2cpp.generators.cpp_emitter import CppEmitter
+
+
+def generate(lua_code, runtime="lua_table", **options):
+    """Transpile lua_code to one C++ file; options go to CppEmitter"""
+    return CppEmitter(runtime=runtime, **options).generate_file(ast.parse(lua_code))
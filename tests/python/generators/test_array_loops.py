@@ -0,0 +1,70 @@
+"""Tests for array loops (lua_table runtime)
+
+ArrayLoopAnalyzer marks the numeric for-loops that only store to t[i + k]
+and call nothing; the loop gets a copy indexing the tables' array parts
+directly, which runs when l2c::array_span (lua_table.hpp) finds each
+part covering the loop's range.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.array_loop_analyzer import ArrayLoopAnalyzer
+from .helpers import generate as _generate
+
+
+def _count(lua_code):
+    return ArrayLoopAnalyzer().analyze(ast.parse(lua_code))
+
+
+PREFIX = """local t = {"a", "b", "c"}
+for i = 2, #t do t[i] = t[i - 1] .. t[i] end
+print(t[3])
+"""
+
+
+class TestAnalysis:
+    """Test the loops ArrayLoopAnalyzer accepts"""
+
+    def test_slot_stores(self):
+        assert _count(PREFIX) == 1
+
+    def test_call_in_body(self):
+        assert _count("local t = {}\nfor i = 1, 3 do t[i] = tostring(i) end") == 0
+
+    def test_store_to_other_key(self):
+        assert _count("local t, u = {}, {}\nfor i = 1, 3 do t[i] = 1 u.n = i end") == 0
+        assert _count("local t = {}\nfor i = 1, 3 do t[2 * i] = 1 end") == 0
+
+    def test_global_table(self):
+        assert _count("for i = 1, 3 do t[i] = 1 end") == 0
+
+    def test_rebound_table(self):
+        assert _count("local t = {}\nfor i = 1, 3 do local t = {} t[i] = 1 end") == 0
+
+
+class TestGeneration:
+    """Test the guarded copy of the loop"""
+
+    def test_guard_and_direct_slots(self):
+        cpp = _generate(PREFIX)
+        assert "LuaTable* _l2c_t_array_1 = l2c::array_span(module_t, _l2c_start_1, _l2c_limit_1, -1, 0);" in cpp
+        assert ("_l2c_t_array_1->arrayset(i - 1, l2c::as_value(l2c::concat("
+                "_l2c_t_array_1->array[i - 2], _l2c_t_array_1->array[i - 1])));") in cpp
+
+    def test_generic_loop_kept(self):
+        cpp = _generate(PREFIX)
+        assert "if (_l2c_t_array_1) {\nfor (int64_t i = " in cpp
+        assert "} else\nfor (int64_t i = _l2c_start_1;" in cpp
+        assert "module_t[i] = l2c::concat(module_t[(i - 1)], module_t[i]);" in cpp
+
+    def test_counting_down(self):
+        cpp = _generate("local t = {1, 2, 3}\nfor i = 3, 1, -1 do t[i] = t[i] + 1 end")
+        assert "l2c::array_span(module_t, _l2c_limit_1, _l2c_start_1, 0, 0)" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        assert "array_span" not in _generate(PREFIX, runtime="table")
@@ -0,0 +1,41 @@
+"""Tests for io.lines loop lowering (lua_table runtime)
+
+for-in loops over io.lines() drive an l2c::LinesIter that finds lines in
+a block-read (or mmap'ed) input buffer.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestLinesLoop:
+    """Test LinesIter io.lines loops"""
+
+    def test_stdin_lines(self):
+        cpp = _generate("for line in io.lines() do print(line) end")
+        assert "for (l2c::LinesIter _l2c_forin_lines_1; _l2c_forin_lines_1.next(); )" in cpp
+        assert "auto line = _l2c_forin_lines_1.line();" in cpp
+        assert "unsupported iterator" not in cpp
+
+    def test_file_lines_with_format(self):
+        cpp = _generate('for line in io.lines("in.txt", "*L") do print(line) end')
+        assert "l2c::LinesIter _l2c_forin_lines_1(" in cpp
+        assert '"L")' in cpp
+
+    def test_unbound_line_is_not_copied(self):
+        cpp = _generate("local n = 0\nfor _ in io.lines() do n = n + 1 end")
+        assert ".line()" not in cpp
+
+    def test_non_line_format_is_not_lowered(self):
+        cpp = _generate('for n in io.lines("in.txt", "n") do print(n) end')
+        assert "LinesIter" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("for line in io.lines() do print(line) end", runtime="table")
+        assert "LinesIter" not in cpp
@@ -0,0 +1,93 @@
+"""Tests for method dispatch in generated classes
+
+ClassGenerator numbers the classes in preorder of the class tree, so
+Object::is<T>() is a type id range check (object.hpp), and binds
+self:method() to the method that runs for self's class: subclasses
+overriding it are tested for by type id, without a table lookup or RTTI.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.generators.class_generator import ClassDetector, ClassGenerator
+from lua2cpp.generators.stmt_generator import StmtGenerator
+
+
+CLASSES = """Entity = Object:extend()
+function Entity:init(x) print(x) end
+function Entity:move(dx) print(dx) end
+function Entity:update(dt) self:move(dt) end
+Enemy = Entity:extend()
+function Enemy:move(dx) print(-dx) end
+Boss = Enemy:extend()
+function Boss:roar() if self:is(Enemy) then self:update(1) end end
+Item = Object:extend()
+"""
+
+
+def _classes(lua_code=CLASSES):
+    return ClassDetector().detect(ast.parse(lua_code))
+
+
+def _generate(lua_code=CLASSES):
+    return ClassGenerator(StmtGenerator()).generate_class_header(_classes(lua_code), "demo")
+
+
+class TestTypeIds:
+    """Test the type ids assigned to the class tree"""
+
+    def test_preorder_ranges(self):
+        classes = _classes()
+        ranges = {name: (c.type_first, c.type_last) for name, c in classes.items()}
+        assert ranges == {"Entity": (1, 3), "Enemy": (2, 3), "Boss": (3, 3), "Item": (4, 4)}
+
+    def test_declared(self):
+        cpp = _generate()
+        assert "static constexpr uint32_t type_first = 2;\n    static constexpr uint32_t type_last = 3;" in cpp
+
+    def test_constructors_store_the_id(self):
+        cpp = _generate()
+        assert "inline Entity::Entity(auto x) {\n    type_id = type_first;" in cpp
+        assert "Enemy(Args&&... args) : Entity(std::forward<Args>(args)...) { type_id = type_first; }" in cpp
+
+
+class TestDispatch:
+    """Test self:method() in method bodies"""
+
+    def test_leaf_classes_final(self):
+        cpp = _generate()
+        assert "class Boss final : public Enemy {" in cpp
+        assert "class Item final : public Object {" in cpp
+        assert "class Enemy : public Entity {" in cpp
+
+    def test_override_tested_by_type_id(self):
+        cpp = _generate()
+        assert ("(this->is<Enemy>() ? static_cast<Enemy*>(this)->Enemy::move(dt) : this->Entity::move(dt));"
+                in cpp)
+
+    def test_inherited_method_bound(self):
+        assert "this->Entity::update(NUMBER(1));" in _generate()
+
+    def test_is(self):
+        assert "l2c::is_truthy(this->is<Enemy>())" in _generate()
+
+    def test_dispatch_cases(self):
+        classes = _classes()
+        generator = ClassGenerator()
+        generator.set_classes(classes)
+        assert generator.method_dispatch(classes["Entity"])["move"] == [("Enemy", "Enemy"), ("", "Entity")]
+        assert generator.method_dispatch(classes["Boss"])["move"] == [("", "Enemy")]
+
+    def test_method_only_in_subclass(self):
+        classes = _classes()
+        generator = ClassGenerator()
+        generator.set_classes(classes)
+        assert "roar" not in generator.method_dispatch(classes["Entity"])
+
+    def test_bodies_follow_declarations(self):
+        cpp = _generate()
+        assert cpp.index("class Boss final") < cpp.index("inline void Entity::update(auto dt) {")
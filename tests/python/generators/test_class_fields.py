@@ -0,0 +1,79 @@
+"""Tests for declared fields in generated classes
+
+The fields a class's methods store on self become data members, typed by
+TypeResolver where the values allow; other fields stay in
+Object::fields, a table made on the first store (object.hpp).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.generators.class_generator import ClassDetector, ClassGenerator
+from lua2cpp.generators.stmt_generator import StmtGenerator
+
+
+CLASSES = """Entity = Object:extend()
+function Entity:init(x)
+  self.x = x
+  self.speed = 2
+  self.alive = true
+end
+function Entity:move(dx) self.x = self.x + dx * self.speed end
+function Entity:show() print(self.tag) end
+Enemy = Entity:extend()
+function Enemy:hit() self.hp = 3 self.speed = 1 end
+"""
+
+
+def _classes(lua_code=CLASSES):
+    return ClassDetector().detect(ast.parse(lua_code))
+
+
+def _generate(lua_code=CLASSES):
+    return ClassGenerator(StmtGenerator()).generate_class_header(_classes(lua_code), "demo")
+
+
+class TestFieldDetection:
+    """Test the fields ClassDetector collects"""
+
+    def test_stored_fields(self):
+        entity = _classes()["Entity"]
+        assert list(entity.field_values) == ["x", "speed", "alive"]
+        assert entity.init_fields == {"x", "speed", "alive"}
+        assert "tag" in entity.field_reads
+
+    def test_nested_function_with_own_self(self):
+        lua = "A = Object:extend()\nfunction A:f() local g = function(self) self.y = 1 end end"
+        assert _classes(lua)["A"].field_values == {}
+
+
+class TestFieldLayout:
+    """Test the data members declared"""
+
+    def test_typed_members(self):
+        cpp = _generate()
+        assert "    TABLE x{};\n    NUMBER speed{};\n    BOOLEAN alive{};" in cpp
+
+    def test_subclass_store_uses_parent_member(self):
+        cpp = _generate()
+        assert cpp.count("speed{};") == 1
+        assert "this->speed = NUMBER(1);" in cpp
+
+    def test_field_typed_only_when_init_stores_it(self):
+        assert "TABLE hp{};" in _generate()
+
+    def test_member_access(self):
+        assert "this->x = (this->x + (dx * this->speed));" in _generate()
+
+    def test_undeclared_field(self):
+        assert 'l2c::print(this->field(STRING("tag")));' in _generate()
+
+    def test_field_named_like_a_method(self):
+        lua = "A = Object:extend()\nfunction A:init() self.run = 1 end\nfunction A:run() end"
+        cpp = _generate(lua)
+        assert "run{};" not in cpp
+        assert 'this->set_field(STRING("run"), NUMBER(1));' in cpp
@@ -0,0 +1,98 @@
+"""Tests for closure capture lists (lua_table runtime)
+
+ClosureAnalyzer resolves the locals each anonymous function uses: the
+lambda copies the ones nobody assigns, shares assigned ones through an
+l2c::Upvalue cell (lua_table.hpp), and captures nothing else.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast, astnodes
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.closure_analyzer import ClosureAnalyzer
+from lua2cpp.core.types import ASTAnnotationStore
+from .helpers import generate as _generate
+
+
+def _captures(lua_code, module_state=()):
+    """Capture lists of the chunk's anonymous functions, in source order"""
+    chunk = ast.parse(lua_code)
+    ClosureAnalyzer(set(module_state)).analyze(chunk)
+    found = []
+    stack = [chunk]
+    while stack:
+        node = stack.pop()
+        if isinstance(node, list):
+            stack.extend(reversed(node))
+        elif isinstance(node, astnodes.Node):
+            captures = ASTAnnotationStore.get_annotation(node, 'captures')
+            if captures is not None:
+                found.append(captures)
+            stack.extend(reversed([v for k, v in vars(node).items() if not k.startswith('_')]))
+    return found
+
+
+COUNTER = """local fns = {}
+local function counter()
+  local n = 0
+  local step = 2
+  fns.count = function() n = n + step return n end
+end
+"""
+
+
+class TestAnalysis:
+    """Test the capture lists ClosureAnalyzer computes"""
+
+    def test_value_and_box(self):
+        assert _captures(COUNTER, {"fns"}) == [[("n", "box"), ("step", "value")]]
+
+    def test_own_locals_and_parameters_not_captured(self):
+        lua = "local function f(a) return function(b) local c = b return a + c end end"
+        assert _captures(lua) == [[("a", "value")]]
+
+    def test_module_state_and_local_functions(self):
+        lua = "local t = {}\nlocal function g() end\nlocal function f() return function() g() return t end end"
+        assert _captures(lua, {"t"}) == [[]]
+
+    def test_shadowed_local(self):
+        lua = "local function f()\nlocal x = 1\ndo local x = 2 x = 3 end\nreturn function() return x end\nend"
+        assert _captures(lua) == [[("x", "value")]]
+
+    def test_through_nested_functions(self):
+        lua = "local function f()\nlocal x = 1\nreturn function() return function() x = 2 end end\nend"
+        assert _captures(lua) == [[("x", "box")], [("x", "box")]]
+
+    def test_assigned_parameter_by_reference(self):
+        lua = "local function f(x) return function() x = x + 1 end end"
+        assert _captures(lua) == [[("x", "ref")]]
+
+
+class TestCaptureLists:
+    """Test the emitted lambdas"""
+
+    def test_boxed_local(self):
+        cpp = _generate(COUNTER)
+        assert "auto n = l2c::make_upvalue(NUMBER(0));" in cpp
+        assert "[n, step]() -> auto {" in cpp
+        assert "(*n) = ((*n) + step);" in cpp
+
+    def test_loop_local_copied(self):
+        lua = "local fs = {}\nlocal function f()\nfor i = 1, 3 do local k = i fs[i] = function() return k end end\nend"
+        assert "[k]() -> auto {" in _generate(lua)
+
+    def test_store_into_copied_table(self):
+        lua = "local function f()\nlocal t = {}\nlocal add = function(v) t[1] = v end\nadd(1)\nend\nf()"
+        assert "[t](const auto& v) mutable -> auto {" in _generate(lua)
+
+    def test_table_constructor_by_reference(self):
+        cpp = _generate("local function f(a, ...) local t = {a, ...} return t end\nprint(f(1, 2))")
+        assert "auto t = [&]() {\n    TABLE t = NEW_TABLE;" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(COUNTER, runtime="table")
+        assert "make_upvalue" not in cpp
+        assert "[&]() -> auto {" in cpp
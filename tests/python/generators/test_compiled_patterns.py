@@ -0,0 +1,81 @@
+"""Tests for precompiled Lua patterns (lua_table runtime)
+
+String-literal patterns passed to find/match/gmatch/gsub are compiled once
+into module-level l2c::Pattern objects; gmatch for-in loops drive an
+l2c::GMatch iterator.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestCompiledPatterns:
+    """Test literal pattern declarations and gmatch loops"""
+
+    def test_method_pattern_is_precompiled(self):
+        cpp = _generate('local s = "a b"\nlocal t = s:gsub("%s+", "")')
+        assert 'static const l2c::Pattern _l2c_pat_0{"%s+"};' in cpp
+        assert 'string_lib::gsub(module_s, _l2c_pat_0, "")' in cpp
+
+    def test_library_pattern_is_precompiled(self):
+        cpp = _generate('local s = "k=v"\nlocal k = string.match(s, "(%w+)=")')
+        assert "string_lib::match(module_s, _l2c_pat_0)" in cpp
+
+    def test_same_pattern_shares_declaration(self):
+        cpp = _generate('local s = "ab"\nlocal a = s:find("b")\nlocal b = s:match("b")')
+        assert cpp.count("static const l2c::Pattern ") == 1
+
+    def test_pattern_is_escaped(self):
+        cpp = _generate('local s = "x"\nlocal t = s:gsub("\\n", " ")')
+        assert 'l2c::Pattern _l2c_pat_0{"\\n"};' in cpp
+
+    def test_dynamic_pattern_is_passed_through(self):
+        cpp = _generate('local s, p = "ab", "b"\nlocal a = s:find(p)')
+        assert "string_lib::find(module_s, module_p)" in cpp
+        assert "l2c::Pattern" not in cpp
+
+    def test_plain_find_keeps_string(self):
+        cpp = _generate('local s = "a.b"\nlocal a = s:find(".", 1, true)')
+        assert "l2c::Pattern" not in cpp
+
+    def test_gmatch_loop(self):
+        cpp = _generate('local s = "a b"\nfor w in s:gmatch("%a+") do print(w) end')
+        assert "for (l2c::GMatch _l2c_forin_gmatch_1(module_s, _l2c_pat_0); _l2c_forin_gmatch_1.next(); )" in cpp
+        assert "auto w = _l2c_forin_gmatch_1.capture(0);" in cpp
+
+    def test_gmatch_loop_binds_each_capture(self):
+        cpp = _generate('local s = "a=1"\nfor k, v in string.gmatch(s, "(%w+)=(%w+)") do print(k, v) end')
+        assert "auto k = _l2c_forin_gmatch_1.capture(0);" in cpp
+        assert "auto v = _l2c_forin_gmatch_1.capture(1);" in cpp
+
+    def test_patterns_declared_before_functions(self):
+        cpp = _generate('local function f(s) return s:match("^%d+") end')
+        assert cpp.index("l2c::Pattern _l2c_pat_0") < cpp.index("f(")
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate('local s = "a b"\nlocal t = s:gsub("%s+", "")', runtime="table")
+        assert "l2c::Pattern" not in cpp
+
+
+class TestResults:
+    """Test that find, match and gsub keep their extra results for destructuring"""
+
+    def test_destructuring_takes_all_results(self):
+        cpp = _generate('local function f(s)\n  local i, j = s:find("o")\n  local r, n = string.gsub(s, "o", "0")\n  print(i, j, r, n)\nend\nf("foo")')
+        assert "auto [i, j] = l2c::take<2>(string_lib::find(s, _l2c_pat_0));" in cpp
+        assert 'auto [r, n] = l2c::take<2>(string_lib::gsub(s, _l2c_pat_0, "0"));' in cpp
+
+    def test_single_value_context_keeps_first(self):
+        cpp = _generate('local function f(s)\n  local k = s:find("o") + 1\n  return s:match("(o)(o)"), k\nend\nprint(f("foo"))')
+        assert "l2c::as_value(string_lib::find(s, _l2c_pat_0))" in cpp
+        assert "l2c::as_value(string_lib::match(s, _l2c_pat_1))" in cpp
+
+    def test_table_runtime_unchanged(self):
+        cpp = _generate('local s = "foo"\nprint(s:find("o") + 1)', runtime="table")
+        assert "l2c::as_value(string_lib::find" not in cpp
@@ -0,0 +1,40 @@
+"""Tests for `..` chain lowering (lua_table runtime)
+
+A concatenation chain becomes one variadic l2c::concat call that sizes and
+copies the result once, instead of nested two-operand table_lib::concat calls.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestConcatBuilder:
+    """Test flattened concatenation calls"""
+
+    def test_two_operands(self):
+        cpp = _generate('local a = "x"\nlocal s = a .. "y"')
+        assert 'l2c::concat(module_a, "y")' in cpp
+
+    def test_chain_is_flattened(self):
+        cpp = _generate('local a, b = "x", "y"\nlocal s = a .. "-" .. b .. "\\n"')
+        assert 'l2c::concat(module_a, "-", module_b, "\\n")' in cpp
+        assert "table_lib::concat" not in cpp
+
+    def test_numbers_are_passed_through(self):
+        cpp = _generate('local s = "n=" .. 42')
+        assert 'l2c::concat("n=", NUMBER(42))' in cpp
+
+    def test_nested_call_argument_is_separate_chain(self):
+        cpp = _generate('local s = "a" .. tostring("b" .. "c")')
+        assert 'l2c::concat("b", "c")' in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate('local s = "a" .. "b" .. "c"', runtime="table")
+        assert "table_lib::concat" in cpp
+        assert "l2c::concat" not in cpp
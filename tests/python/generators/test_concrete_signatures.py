@@ -0,0 +1,81 @@
+"""Tests for concrete function signatures (lua_table runtime)
+
+A top-level local function that is only ever called, with exactly its
+parameters, gets a non-template signature: `double` for parameters every
+call passes a number, `TValue` for the rest, with those arguments boxed
+at the call site. Everything else stays a template.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.generators.cpp_emitter import CppEmitter
+from .helpers import generate as _generate
+
+
+FIB = """local function fib(n)
+  if n < 2 then return n end
+  return fib(n - 1) + fib(n - 2)
+end
+print(fib(30))"""
+
+
+class TestConcreteSignatures:
+    """Test non-template signatures settled from call sites"""
+
+    def test_numeric_parameter_is_double(self):
+        cpp = _generate(FIB)
+        assert "fib(double n)" in cpp
+        assert "n_t" not in cpp
+
+    def test_concrete_function_has_no_overloads(self):
+        assert _generate(FIB).count("fib(double n)") == 1
+
+    def test_numbers_flow_through_callers(self):
+        lua = """local function sq(x)
+  return x * x
+end
+local function sum(n)
+  local s = 0
+  for i = 1, n do s = s + sq(i) end
+  return s
+end
+print(sum(10))"""
+        cpp = _generate(lua)
+        assert "sq(double x)" in cpp
+        assert "sum(double n)" in cpp
+
+    def test_other_arguments_are_boxed(self):
+        lua = "local function first(t, i)\n  return t[i]\nend\nprint(first({1, 2}, 1))"
+        cpp = _generate(lua)
+        assert "first(TValue t, double i)" in cpp
+        assert "first(l2c::as_value(" in cpp
+
+    def test_mixed_arguments_stay_boxed(self):
+        lua = "local function id(x)\n  return x\nend\nprint(id(1), id('a'))"
+        assert "id(TValue x)" in _generate(lua)
+
+    def test_function_value_stays_template(self):
+        lua = "local function f(x)\n  return x\nend\nlocal g = f\nprint(f(1), g(2))"
+        assert "typename x_t" in _generate(lua)
+
+    def test_wrong_arity_stays_template(self):
+        lua = "local function f(a, b)\n  return a\nend\nprint(f(1))"
+        assert "typename a_t" in _generate(lua)
+
+    def test_reassigned_parameter_is_boxed(self):
+        lua = "local function f(a)\n  a = a .. ''\n  return a\nend\nprint(f(1))"
+        assert "f(TValue a)" in _generate(lua)
+
+    def test_registry_records_signature(self):
+        emitter = CppEmitter(runtime="lua_table")
+        emitter.generate_file(ast.parse(FIB))
+        assert emitter.function_registry.get_concrete_signature("fib") == ["double"]
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(FIB, runtime="table")
+        assert "fib(double n)" not in cpp
@@ -0,0 +1,92 @@
+"""Tests for constant tables (lua_table runtime)
+
+ConstTableAnalyzer marks the module-level tables built from constants
+that the script only ever reads; their contents are laid out once per
+process as a module-scope l2c::ConstTable (lua_table.hpp), and module
+init gives the State a table pointing at them.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.const_table_analyzer import ConstTableAnalyzer
+from .helpers import generate as _generate
+
+
+def _count(lua_code):
+    return ConstTableAnalyzer().analyze(ast.parse(lua_code))
+
+
+TABLE = 'local t = {"a", "b", n = 2, ["end"] = true}\n'
+
+
+class TestAnalysis:
+    """Test the tables ConstTableAnalyzer accepts"""
+
+    def test_reads(self):
+        assert _count(TABLE + "print(t[1], t.n, t['end'], #t)") == 1
+        assert _count(TABLE + "local function f(i) return t[i] end") == 1
+
+    def test_iteration_and_reading_library(self):
+        assert _count(TABLE + "for i, v in ipairs(t) do print(v) end") == 1
+        assert _count(TABLE + "for k, v in pairs(t) do print(k) end") == 1
+        assert _count(TABLE + "print(table.concat(t, ','))") == 1
+
+    def test_rebound_library(self):
+        assert _count(TABLE + "local table = {concat = print}\nprint(table.concat(t))") == 0
+
+    def test_store(self):
+        assert _count(TABLE + "t[3] = 'c'") == 0
+        assert _count(TABLE + "local function f() t.n = 3 end") == 0
+        assert _count(TABLE + "function t.f() end") == 0
+
+    def test_escape(self):
+        assert _count(TABLE + "print(t)") == 0
+        assert _count(TABLE + "table.insert(t, 'c')") == 0
+        assert _count(TABLE + "t:f()") == 0
+        assert _count(TABLE + "local u = t") == 0
+        assert _count(TABLE + "local function f() return t end") == 0
+
+    def test_rebinding(self):
+        assert _count(TABLE + "t = {}") == 0
+        assert _count(TABLE + "local function f(t) return t[1] end") == 0
+
+    def test_non_constant_fields(self):
+        assert _count("local x = 1\nlocal t = {x}\nprint(t[1])") == 0
+        assert _count("local t = {{1}}\nprint(t[1])") == 0
+        assert _count("local t = {[1] = 'a'}\nprint(t[1])") == 0
+        assert _count("local t = {}\nprint(t[1])") == 0
+
+    def test_record_keeps_shape(self):
+        code = "local p = {x = 1, y = 2}\nprint(p.x)"
+        cpp = _generate(code)
+        assert "l2c::RecordCtor<2>" in cpp
+        assert "ConstTable" not in cpp
+
+
+class TestGeneration:
+    """Test the module-scope data and the table made from it"""
+
+    def test_declaration_and_init(self):
+        cpp = _generate(TABLE + "print(t[1], t.n)")
+        assert "// Constant tables" in cpp
+        assert ('static const l2c::ConstTable<2, 2> _l2c_const_0{"a", "b", '
+                '_l2c_key_n, NUMBER(2), _l2c_key_end, true};') in cpp
+        assert "module_t = _l2c_const_0.table();" in cpp
+
+    def test_declared_after_keys(self):
+        cpp = _generate(TABLE + "print(t.n)")
+        assert cpp.index("l2c::intern(\"n\")") < cpp.index("_l2c_const_0{")
+
+    def test_mutated_table_built_per_state(self):
+        cpp = _generate(TABLE + "t[3] = 'c'")
+        assert "ConstTable" not in cpp
+        assert "l2c::TableCtor<2, 2>" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(TABLE + "print(t[1])", runtime="table")
+        assert "ConstTable" not in cpp
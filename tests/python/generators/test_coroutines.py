@@ -0,0 +1,119 @@
+"""Tests for coroutines lowered to C++20 coroutines (lua_table runtime)
+
+CoroutineAnalyzer finds the functions that can yield; the generators make
+them return l2c::CoTask and turn each yield, and each call of a yielding
+function, into a co_await (lua_coroutine.hpp).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.coroutine_analyzer import CoroutineAnalyzer
+from .helpers import generate as _generate
+
+
+def _yielding(lua_code):
+    return CoroutineAnalyzer().analyze(ast.parse(lua_code))
+
+
+PRODUCER = """local function producer(n)
+  for i = 1, n do
+    coroutine.yield(i)
+  end
+  return "done"
+end
+local co = coroutine.create(producer)
+print(coroutine.resume(co, 3))"""
+
+NESTED = """local function leaf(x)
+  coroutine.yield(x)
+end
+local function walk(x)
+  leaf(x)
+  leaf(x + 1)
+end
+print(walk(1))"""
+
+
+class TestCoroutineAnalysis:
+    """Test which functions are found to yield"""
+
+    def test_direct_yield(self):
+        assert _yielding(PRODUCER) == {"producer": 1}
+
+    def test_calling_yielding_function_yields(self):
+        assert _yielding(NESTED) == {"leaf": 1, "walk": 1}
+
+    def test_global_function(self):
+        assert _yielding("function gen(a, b)\n  coroutine.yield(a)\nend") == {"gen": 2}
+
+    def test_yield_in_nested_function_does_not_count(self):
+        lua = "local function f()\n  return function() coroutine.yield(1) end\nend"
+        assert _yielding(lua) == {}
+
+    def test_varargs_function_is_not_lowered(self):
+        assert _yielding("local function f(...)\n  coroutine.yield(...)\nend") == {}
+
+    def test_rebound_name_is_not_lowered(self):
+        lua = "local function f()\n  coroutine.yield(1)\nend\nf = nil"
+        assert _yielding(lua) == {}
+
+
+class TestCoroutineGeneration:
+    """Test the code generated for yielding functions and their calls"""
+
+    def test_yielding_function_returns_cotask(self):
+        cpp = _generate(PRODUCER)
+        assert "l2c::CoTask producer(TValue n) {" in cpp
+        assert "l2c::CoTask producer(TValue);" in cpp
+
+    def test_yield_is_awaited(self):
+        assert "(co_await l2c::coroutine_yield(" in _generate(PRODUCER)
+
+    def test_returns_become_co_returns(self):
+        cpp = _generate(PRODUCER)
+        assert 'co_return "done";' in cpp
+
+    def test_fall_off_end_returns_nothing(self):
+        assert "co_return l2c::Values{};" in _generate(NESTED)
+
+    def test_yielding_call_is_awaited(self):
+        cpp = _generate(NESTED)
+        assert "(co_await leaf(l2c::as_value(x)));" in cpp
+
+    def test_call_outside_coroutine_runs_to_completion(self):
+        assert "l2c::co::run(walk(l2c::as_value(NUMBER(1))))" in _generate(NESTED)
+
+    def test_passed_function_starts_coroutine(self):
+        cpp = _generate(PRODUCER)
+        assert "l2c::coroutine_create([](TValue a1) { return producer(a1); })" in cpp
+
+    def test_anonymous_function_captures_by_value(self):
+        lua = "local g = coroutine.wrap(function(a)\n  coroutine.yield(a)\nend)\nprint(g(1))"
+        assert "[=](TValue a) mutable -> l2c::CoTask {" in _generate(lua)
+
+    def test_multiple_assignment_takes_all_values(self):
+        lua = "local g = coroutine.wrap(function()\n  local a, b = coroutine.yield()\n  print(a, b)\nend)"
+        assert "l2c::take<2>((co_await l2c::co::all(l2c::coroutine_yield())))" in _generate(lua)
+
+    def test_unlowered_yield(self):
+        assert "l2c::co::yield_unlowered(NUMBER(1))" in _generate("coroutine.yield(1)")
+
+    def test_wrap_for_in_resumes_thread(self):
+        lua = "local t = 0\nfor v in coroutine.wrap(function() coroutine.yield(1) end) do t = t + v end\nprint(t)"
+        cpp = _generate(lua)
+        assert "for (l2c::WrapIter _l2c_forin_wrap_1([=]() mutable -> l2c::CoTask {" in cpp
+        assert "auto v = _l2c_forin_wrap_1.value(1);" in cpp
+
+    def test_function_value_for_in(self):
+        lua = "local function gen()\n  return coroutine.wrap(function() coroutine.yield(1) end)\nend\nfor v in gen() do print(v) end"
+        assert "for (l2c::WrapIter _l2c_forin_wrap_1(l2c::as_value(gen())); " in _generate(lua)
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(PRODUCER, runtime="table")
+        assert "l2c::CoTask" not in cpp
+        assert "co_await" not in cpp
@@ -0,0 +1,75 @@
+"""Tests for direct calls to statically known table functions
+
+`T.m(args)` calls the emitted C++ function T_m when T.m is defined once
+with `function T.m(...)` and never reassigned. On the lua_table runtime,
+table registrations wrap the function in a closure of its own arity.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestDirectCalls:
+    """Test static binding of T.m(...) calls"""
+
+    def test_call_after_definition_is_direct(self):
+        cpp = _generate(
+            "local V = {}\n"
+            "function V.sq(x) return x * x end\n"
+            "function V.quad(x) return V.sq(V.sq(x)) end\n"
+        )
+        assert "V_sq(V_sq(x))" in cpp
+
+    def test_module_body_call_is_direct(self):
+        cpp = _generate("local V = {}\nfunction V.sq(x) return x * x end\nlocal y = V.sq(3)")
+        assert "V_sq(NUMBER(3))" in cpp
+
+    def test_reassigned_function_is_not_direct(self):
+        cpp = _generate(
+            "local V = {}\n"
+            "function V.sq(x) return x * x end\n"
+            "V.sq = function(x) return x end\n"
+            "local y = V.sq(3)"
+        )
+        assert "V_sq(3" not in cpp
+
+    def test_computed_key_store_blocks_table(self):
+        cpp = _generate(
+            "local V = {}\n"
+            "function V.sq(x) return x * x end\n"
+            "local k = 'sq'\n"
+            "V[k] = nil\n"
+            "local y = V.sq(3)"
+        )
+        assert "V_sq(3" not in cpp
+
+    def test_arity_mismatch_is_not_direct(self):
+        cpp = _generate("local V = {}\nfunction V.add(a, b) return a + b end\nlocal y = V.add(1)")
+        assert "V_add(1)" not in cpp
+
+    def test_call_before_definition_is_not_direct(self):
+        cpp = _generate(
+            "local V = {}\n"
+            "function V.quad(x) return V.sq(V.sq(x)) end\n"
+            "function V.sq(x) return x * x end\n"
+        )
+        assert "V_sq(V_sq(x))" not in cpp
+
+
+class TestTypedClosureRegistration:
+    """Test closure registration arity"""
+
+    def test_registration_uses_function_arity(self):
+        cpp = _generate("local V = {}\nfunction V.add3(a, b, c) return a + b + c end")
+        assert "make_function([](TValue arg0, TValue arg1, TValue arg2) {" in cpp
+        assert "return V_add3(arg0, arg1, arg2);" in cpp
+
+    def test_table_runtime_keeps_two_argument_wrapper(self):
+        cpp = _generate("local V = {}\nfunction V.sq(x) return x * x end", runtime="table")
+        assert "make_function([](TValue arg0, TValue arg1) -> TValue {" in cpp
@@ -0,0 +1,70 @@
+"""Tests for compiled format strings (lua_table runtime)
+
+A string.format (or :format) whose format is a string literal is split
+at transpile time into segments, the text before each conversion and the
+conversion, declared once as a module-scope l2c::FormatSegment array;
+the call becomes l2c::format (l2c_runtime_lua_table.hpp). Formats only
+known at run time keep string_lib::format.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+from lua2cpp.generators.expr_generator import ExprGenerator
+
+
+class TestSegments:
+    """Test how a format splits into segments"""
+
+    def test_text_and_specs(self):
+        assert ExprGenerator._format_segments("n=%d (%5.2f)") == [("n=", "%d"), (" (", "%5.2f"), (")", "")]
+        assert ExprGenerator._format_segments("%s%-8s") == [("", "%s"), ("", "%-8s")]
+
+    def test_percent_literal(self):
+        assert ExprGenerator._format_segments("%d%%") == [("", "%d"), ("%", "")]
+
+    def test_length_modifier_kept(self):
+        assert ExprGenerator._format_segments("%lld") == [("", "%lld")]
+
+    def test_unsupported(self):
+        assert ExprGenerator._format_segments("%d %y") is None
+        assert ExprGenerator._format_segments("50%") is None
+        assert ExprGenerator._format_segments("a\0%d") is None
+
+
+class TestGeneration:
+    """Test the module-scope segments and the calls using them"""
+
+    def test_library_call(self):
+        cpp = _generate('local n = 3\nprint(string.format("n=%d (%.2f)", n, n / 7))')
+        assert "// Compiled format strings" in cpp
+        assert ('static constexpr l2c::FormatSegment _l2c_fmt_0[] = '
+                '{{"n=", "%d"}, {" (", "%.2f"}, {")"}};') in cpp
+        assert "l2c::format(_l2c_fmt_0, module_n, (module_n / NUMBER(7)))" in cpp
+
+    def test_method_on_literal(self):
+        cpp = _generate('print(("%5.1f%%"):format(3))')
+        assert "l2c::format(_l2c_fmt_0, NUMBER(3))" in cpp
+
+    def test_shared_per_format(self):
+        cpp = _generate('print(string.format("%d\\n", 1), string.format("%d\\n", 2))')
+        assert cpp.count("static constexpr l2c::FormatSegment") == 1
+        assert '{{"", "%d"}, {"\\n"}}' in cpp
+
+    def test_dynamic_format_keeps_runtime(self):
+        cpp = _generate('local f = "%d"\nprint(string.format(f, 1), f:format(2))')
+        assert "FormatSegment" not in cpp
+        assert "string_lib::format(module_f, NUMBER(1))" in cpp
+
+    def test_argument_count(self):
+        cpp = _generate('print(string.format("100%%"), string.format("%d", 1, 2))')
+        assert "FormatSegment" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate('print(string.format("%d", 1))', runtime="table")
+        assert "FormatSegment" not in cpp
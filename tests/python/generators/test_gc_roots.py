@@ -0,0 +1,34 @@
+"""Tests for GC root registration of module state (lua_table runtime)
+
+Module state lives in file-scope globals that the collector's stack
+scan cannot see, so the emitter registers them via l2c::GCRoots.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestGCRoots:
+    """Test GC root emission"""
+
+    def test_table_module_state_is_rooted(self):
+        cpp = _generate("local t = {}\nt[1] = 2")
+        assert "l2c::GCRoots _l2c_module_gc_roots{&module_t}" in cpp
+
+    def test_string_module_state_is_rooted(self):
+        cpp = _generate('local s = "a"\nprint(s)')
+        assert "l2c::GCRoots _l2c_module_gc_string_roots{&module_s}" in cpp
+
+    def test_g_table_is_rooted(self):
+        cpp = _generate("G.x = 1")
+        assert "&G" in cpp
+
+    def test_no_roots_for_table_runtime(self):
+        cpp = _generate("local t = {}", runtime="table")
+        assert "GCRoots" not in cpp
@@ -0,0 +1,49 @@
+"""Tests for G.k slot caches (lua_table runtime)
+
+Every access to G with a constant key goes through one l2c::InlineCache
+per global, shared by all the sites that name it, instead of hashing the
+key on each access (lua_table.hpp).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestGlobalSlots:
+    """Test constant-key G accesses"""
+
+    def test_read(self):
+        cpp = _generate("local function f() return G.speed end\nprint(f())")
+        assert 'static thread_local l2c::InlineCache _l2c_global_0{"G.speed"};' in cpp
+        assert "return l2c::getcached(G, _l2c_global_0, _l2c_key_speed);" in cpp
+
+    def test_store(self):
+        cpp = _generate("G.speed = 3")
+        assert "l2c::setcached(G, _l2c_global_0, _l2c_key_speed, NUMBER(3));" in cpp
+
+    def test_one_cache_per_global(self):
+        cpp = _generate('G.n = 1\nG.n = G["n"] + 1\nprint(G.n, G.m)')
+        assert cpp.count("l2c::InlineCache _l2c_global_") == 2
+        assert "l2c::setcached(G, _l2c_global_0, _l2c_key_n, (l2c::getcached(G, _l2c_global_0, _l2c_key_n)" in cpp
+        assert "l2c::getcached(G, _l2c_global_1, _l2c_key_m)" in cpp
+
+    def test_nested_field(self):
+        cpp = _generate("print(G.C.HAND_LEVELS)")
+        assert "l2c::getcached(l2c::getcached(G, _l2c_global_0, _l2c_key_C), _l2c_ic_1, _l2c_key_HAND_LEVELS)" in cpp
+
+    def test_computed_key(self):
+        cpp = _generate("local k = 'x'\nprint(G[k])")
+        assert "G[module_k]" in cpp
+        assert "_l2c_global_" not in cpp
+
+    def test_metamethod_name(self):
+        assert "_l2c_global_" not in _generate("print(G.__index)")
+
+    def test_disabled_for_table_runtime(self):
+        assert 'G["speed"]' in _generate("print(G.speed)", runtime="table")
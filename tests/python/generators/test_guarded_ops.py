@@ -0,0 +1,82 @@
+"""Tests for guarded fast paths (lua_table runtime)
+
+HotPathAnalyzer marks the arithmetic of loop bodies; an operation whose
+operands aren't proven numbers becomes l2c::guarded_add (sub, mul, div),
+and its operands indexing by a computed key l2c::guarded_get
+(lua_profile.hpp), which run inline for floats and plain tables and
+call the generic TValue operator otherwise.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.hot_path_analyzer import HotPathAnalyzer
+from .helpers import generate as _generate
+
+
+def _count(lua_code):
+    return HotPathAnalyzer().analyze(ast.parse(lua_code))
+
+
+# The call keeps the loop from being an array loop
+LOOP = """local function scale(p, q, n)
+  local s = p[1]
+  for i = 1, n do
+    s = s * q[i] / p[i]
+    print(s)
+  end
+  return s
+end
+print(scale({1}, {2}, 1))
+"""
+
+
+class TestAnalysis:
+    """Test the operations HotPathAnalyzer marks"""
+
+    def test_loop_bodies(self):
+        assert _count("local a, b = 1, 2\nfor i = 1, 3 do a = a + b end") == 1
+        assert _count("local a = 1\nfor k, v in pairs({}) do a = a * v end") == 1
+        assert _count("local a = 1\nwhile a - 1 < 3 do a = a + 1 end") == 2
+        assert _count("local a = 1\nrepeat a = a / 2 until a - 1 < 0") == 2
+
+    def test_outside_loops(self):
+        assert _count("local a, b = 1, 2\nprint(a + b)") == 0
+        assert _count("local a = 1\nfor i = a + 1, a * 3 do end") == 0
+
+    def test_closure_in_loop_is_own_function(self):
+        assert _count("for i = 1, 3 do local f = function(x) return x + 1 end end") == 0
+        assert _count("for i = 1, 3 do local function f(x) for j = 1, 2 do x = x * 2 end end end") == 1
+
+
+class TestGeneration:
+    """Test the guarded calls and where they stay plain"""
+
+    def test_boxed_operands_are_guarded(self):
+        cpp = _generate(LOOP)
+        assert "s = l2c::guarded_div(l2c::guarded_mul(s, l2c::guarded_get(q, i)), l2c::guarded_get(p, i));" in cpp
+
+    def test_not_in_loop_stays_plain(self):
+        cpp = _generate("local function f(a, b) return a + b[2] end\nprint(f(1, {2, 3}))")
+        assert "guarded" not in cpp
+        assert "(a + b[NUMBER(2)])" in cpp
+
+    def test_number_operand_stays_plain(self):
+        cpp = _generate("local function f(t, n)\n  local s = 0\n"
+                        "  for i = 1, n do s = s + t[i] print(s) end\n  return s\nend\nprint(f({1}, 1))")
+        assert "(s + l2c::guarded_get(t, i))" in cpp
+        assert "guarded_add" not in cpp
+
+    def test_constant_keys_keep_field_access(self):
+        cpp = _generate("local function f(b, n)\n"
+                        "  for i = 1, n do b.x = b.x + b.v print(b.x) end\nend\nf({x = 1, v = 2}, 2)")
+        assert "guarded_get" not in cpp
+        assert "l2c::guarded_add(l2c::getfield(b, " in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(LOOP, runtime="table")
+        assert "guarded" not in cpp
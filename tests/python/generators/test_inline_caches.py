@@ -0,0 +1,57 @@
+"""Tests for per-site inline caches (lua_table runtime)
+
+Constant-key accesses that are not bound to a record shape go through a
+module-level l2c::InlineCache cell per site: l2c::getcached / l2c::setcached.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestInlineCaches:
+    """Test inline cache cell emission and cached field access"""
+
+    def test_field_read_uses_cache(self):
+        cpp = _generate("local t = {}\nt.re = 1\nlocal x = t.re")
+        assert "l2c::getcached(module_t, _l2c_ic_1, _l2c_key_re)" in cpp
+
+    def test_field_store_uses_cache(self):
+        cpp = _generate("local t = {}\nt.re = 1")
+        assert "l2c::setcached(module_t, _l2c_ic_0, _l2c_key_re, NUMBER(1));" in cpp
+
+    def test_one_cell_per_site(self):
+        cpp = _generate("local t = {}\nt.re = 1\nlocal a = t.re\nprint(a)\nlocal b = t.re")
+        assert cpp.count("static thread_local l2c::InlineCache ") == 3
+
+    def test_cell_names_site(self):
+        cpp = _generate("local t = {}\nlocal x = t.re")
+        assert 'static thread_local l2c::InlineCache _l2c_ic_0{"' in cpp
+        assert ' re"};' in cpp
+
+    def test_cells_declared_after_keys(self):
+        cpp = _generate("local t = {}\nlocal function f() return t.x end")
+        assert cpp.index('l2c::intern("x")') < cpp.index("l2c::InlineCache _l2c_ic_0")
+        assert cpp.index("l2c::InlineCache _l2c_ic_0") < cpp.index("f()")
+
+    def test_string_bracket_key_uses_cache(self):
+        cpp = _generate('local t = {}\nlocal x = t["hello world"]')
+        assert "l2c::getcached(module_t, _l2c_ic_0, _l2c_key_hello_world)" in cpp
+
+    def test_metamethod_key_is_not_cached(self):
+        cpp = _generate("local mt = {}\nlocal f = mt.__index")
+        assert "getcached" not in cpp
+
+    def test_record_field_keeps_shape_access(self):
+        cpp = _generate("local c = {re = 1, im = 2}\nlocal x = c.re")
+        assert "l2c::getfield(module_c, _l2c_shape_0, 0, _l2c_key_re)" in cpp
+        assert "InlineCache" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local t = {}\nlocal x = t.re", runtime="table")
+        assert "InlineCache" not in cpp
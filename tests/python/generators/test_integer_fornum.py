@@ -0,0 +1,51 @@
+"""Tests for integer numeric for-loops (lua_table runtime)
+
+A loop whose start and step are integral runs an int64_t counter (Lua 5.4
+integer loop); table keys built from the counter stay integers.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestIntegerFornum:
+    """Test int64_t loop lowering"""
+
+    def test_integer_bounds_use_int64_counter(self):
+        cpp = _generate("local t = {}\nfor i = 1, 10 do t[i] = i end")
+        assert "for (int64_t i = " in cpp
+        assert "l2c::for_limit(NUMBER(10), 1)" in cpp
+
+    def test_table_key_uses_counter(self):
+        cpp = _generate("local t = {}\nfor i = 1, 10 do t[i + 1] = i end")
+        assert "[(i + 1)]" in cpp
+        assert "static_cast<double>(i)" in cpp
+
+    def test_length_start_with_negative_step(self):
+        cpp = _generate("local t = {1, 2, 3}\nfor i = #t, 1, -1 do t[i] = 0 end")
+        assert "static_cast<int64_t>(l2c::get_length(" in cpp
+        assert "i >= _l2c_limit_" in cpp
+        assert "i += -1" in cpp
+
+    def test_nested_start_from_outer_counter(self):
+        cpp = _generate("local n = 5\nfor i = 1, n do for j = i + 1, n do print(j) end end")
+        assert "for (int64_t j = " in cpp
+        assert "= (i + 1);" in cpp
+
+    def test_float_start_keeps_double_loop(self):
+        cpp = _generate("for x = 0.5, 10 do print(x) end")
+        assert "for (double x = " in cpp
+
+    def test_assigned_loop_variable_keeps_double_loop(self):
+        cpp = _generate("for i = 1, 10 do i = i * 2 print(i) end")
+        assert "for (double i = " in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("for i = 1, 10 do print(i) end", runtime="table")
+        assert "int64_t" not in cpp
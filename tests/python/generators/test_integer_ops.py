@@ -0,0 +1,101 @@
+"""Tests for Lua 5.4 integer operators (lua_table runtime)
+
+`//`, `%` and the bitwise operators compute in int64_t when both
+operands are proven integers (literals, integer loop counters and
+operations on them); other operands go through the runtime's NUMBER and
+TValue overloads (l2c_runtime_lua_table.hpp). Integers a double may not
+hold exactly, from bitwise operators and literals past 2^53, stay
+TValues (TValue::Int64).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+def _loop(body):
+    return f"local t, s = {{}}, 0\nfor i = 1, 10 do {body} end"
+
+
+class TestIntegerOperands:
+    """Test operators on proven integers"""
+
+    def test_floor_division_and_modulo(self):
+        cpp = _generate(_loop("s = s + i // 3 + i % 7"))
+        assert "static_cast<double>(l2c::int_idiv(i, 3))" in cpp
+        assert "static_cast<double>(l2c::int_mod(i, 7))" in cpp
+
+    def test_bitwise(self):
+        cpp = _generate(_loop("s = s + ((i & 3) | (i ~ 5))"))
+        assert "TValue::Int64(((i & 3) | (i ^ 5)))" in cpp
+
+    def test_shifts_and_not(self):
+        cpp = _generate(_loop("s = s + (i << 2) + (~i >> 1)"))
+        assert "TValue::Int64(l2c::shift_left(i, 2))" in cpp
+        assert "TValue::Int64(l2c::shift_right((~i), 1))" in cpp
+
+    def test_arithmetic_on_counter(self):
+        cpp = _generate(_loop("s = s + i * i"))
+        assert "static_cast<double>((i * i))" in cpp
+
+    def test_integer_key(self):
+        cpp = _generate(_loop("t[i // 2 + 1] = i"))
+        assert "module_t[(l2c::int_idiv(i, 2) + 1)]" in cpp
+
+    def test_literals(self):
+        cpp = _generate("print(7 // 2, 6 & 3)")
+        assert "static_cast<double>(l2c::int_idiv(7, 2))" in cpp
+        assert "TValue::Int64((6 & 3))" in cpp
+
+    def test_wide_literals(self):
+        cpp = _generate("print(9007199254740993, 2^53 + 1, 4294967296 // 3)")
+        assert "TValue::Int64(INT64_C(9007199254740993))" in cpp
+        assert "static_cast<double>(l2c::int_idiv(INT64_C(4294967296), 3))" in cpp
+
+    def test_wide_arithmetic_wraps(self):
+        cpp = _generate("print((1 << 62) + 1, -(1 << 62), (1 << 62) * 4)")
+        assert "TValue::Int64(l2c::int_add(l2c::shift_left(1, 62), 1))" in cpp
+        assert "TValue::Int64(l2c::int_sub(0, l2c::shift_left(1, 62)))" in cpp
+        assert "TValue::Int64(l2c::int_mul(l2c::shift_left(1, 62), 4))" in cpp
+
+    def test_integer_limits(self):
+        cpp = _generate("print(math.maxinteger - 1, math.mininteger // 2)")
+        assert "TValue::Int64(l2c::int_sub(INT64_MAX, 1))" in cpp
+        assert "TValue::Int64(l2c::int_idiv(INT64_MIN, 2))" in cpp
+
+    def test_wide_result_is_returned_as_value(self):
+        cpp = _generate("local function f(n)\n  local h = n << 40\n  return h\nend\nprint(f(3))")
+        assert "TABLE f(" in cpp
+
+    def test_literal_arithmetic_stays_double(self):
+        assert "(NUMBER(2) * NUMBER(3))" in _generate("print(2 * 3)")
+
+    def test_float_operand(self):
+        cpp = _generate(_loop("s = s + i // 2.5"))
+        assert "l2c::floor_div(static_cast<double>(i), NUMBER(2.5))" in cpp
+
+
+class TestOtherOperands:
+    """Test operators on numbers and unknown values"""
+
+    def test_numbers(self):
+        cpp = _generate("local h = 5\nh = (h * 31 + 7) & 0xffffffff\nlocal x = ~h >> 3")
+        assert "module_h = l2c::band(((module_h * NUMBER(31)) + NUMBER(7)), NUMBER(4294967295));" in cpp
+        assert "l2c::shr(l2c::bnot(module_h), NUMBER(3))" in cpp
+
+    def test_bitwise_result_is_value(self):
+        cpp = _generate("local h = 5\nh = h & 3")
+        assert "thread_local TABLE module_h;" in cpp
+
+    def test_unknown_values(self):
+        cpp = _generate("local function f(a, b) return a // b, a ~ b end\nprint(f(print, 1))")
+        assert "l2c::floor_div(a, b)" in cpp
+        assert "l2c::bxor(a, b)" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        assert "l2c::int_idiv" not in _generate("print(7 // 2)", runtime="table")
@@ -0,0 +1,47 @@
+"""Tests for literal table key interning (lua_table runtime)
+
+Literal field names and string keys are emitted as module-level
+`static const TValue _l2c_key_* = l2c::intern("...")` declarations so
+table accesses hash in O(1) and compare keys by pointer.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestKeyInterning:
+    """Test interned key emission"""
+
+    def test_dot_access_uses_interned_key(self):
+        cpp = _generate("local t = {}\nt.re = 1\nlocal x = t.re")
+        assert 'static const TValue _l2c_key_re = l2c::intern("re");' in cpp
+        assert ', _l2c_key_re)' in cpp
+        assert '["re"]' not in cpp
+
+    def test_key_declared_once(self):
+        cpp = _generate("local t = {re = 1, im = 2}\nlocal a = t.re + t.im + t.re")
+        assert cpp.count('l2c::intern("re")') == 1
+        assert cpp.count('l2c::intern("im")') == 1
+
+    def test_string_bracket_key_is_interned(self):
+        cpp = _generate('local t = {}\nt["hello world"] = 1')
+        assert 'l2c::intern("hello world")' in cpp
+        assert ', _l2c_key_hello_world, ' in cpp
+
+    def test_variable_bracket_key_not_interned(self):
+        cpp = _generate("local t = {}\nlocal k = 1\nt[k] = 2")
+        assert 'l2c::intern("k")' not in cpp
+
+    def test_keys_declared_before_functions(self):
+        cpp = _generate("local t = {}\nlocal function f() return t.x end")
+        assert cpp.index('l2c::intern("x")') < cpp.index('f()')
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local t = {}\nt.re = 1", runtime="table")
+        assert 'l2c::intern' not in cpp
@@ -0,0 +1,74 @@
+"""Tests for compile-time library binding (lua_table runtime)
+
+Calls to library functions, through `math.floor(x)` or an alias
+`local floor = math.floor`, compile to the runtime function the registry
+binds them to (LibraryFunctionRegistry.cpp_binding). Only the members a
+module stores to go through a module-state variable.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestAliases:
+    """Test calls through library aliases"""
+
+    def test_direct_call(self):
+        cpp = _generate("local floor, max = math.floor, math.max\nprint(floor(2.5), max(1, 2, 3))")
+        assert "l2c::print(l2c::math_floor(NUMBER(2.5)), l2c::math_max(NUMBER(1), NUMBER(2), NUMBER(3)));" in cpp
+
+    def test_string_and_table(self):
+        cpp = _generate("local fmt, insert = string.format, table.insert\nlocal t = {}\ninsert(t, fmt('%d', 1))")
+        assert 'l2c::table_insert(module_t, l2c::format(_l2c_fmt_0, NUMBER(1)));' in cpp
+
+    def test_constant(self):
+        cpp = _generate("local huge = math.huge\nprint(huge, math.pi)")
+        assert "static constexpr auto huge = l2c::math_huge;" in cpp
+        assert "l2c::math_pi" in cpp
+
+    def test_integer_constant(self):
+        cpp = _generate("local big = math.maxinteger\nprint(big, math.mininteger)")
+        assert "static const auto big = l2c::math_maxinteger;" in cpp
+        assert "l2c::print(l2c_aliases::big, l2c::math_mininteger);" in cpp
+
+    def test_constant_in_function(self):
+        cpp = _generate("local function f()\n  local h = math.huge\n  return h\nend\nprint(f())")
+        assert "auto h = l2c::math_huge;" in cpp
+
+    def test_shadowed_by_parameter(self):
+        cpp = _generate("local floor = math.floor\nlocal function f(floor) return floor(1) end\nprint(f(print))")
+        assert "return floor(NUMBER(1));" in cpp
+
+
+class TestStoredMembers:
+    """Test library members the module stores to"""
+
+    def test_assigned_member(self):
+        cpp = _generate("math.floor = function(x) return 1 end\nprint(math.floor(2.5))")
+        assert "thread_local TABLE _l2c_module_math_floor;" in cpp
+        assert "_l2c_module_math_floor(NUMBER(2.5))" in cpp
+        assert "&_l2c_module_math_floor" in cpp
+
+    def test_bracket_key(self):
+        cpp = _generate('string["shout"] = function(s) return s end\nprint(string.shout("a"))')
+        assert '_l2c_module_string_shout("a")' in cpp
+
+    def test_defined_function_called_directly(self):
+        cpp = _generate('function string.trim(s) return s end\nprint(string.trim(" a "))')
+        assert "_l2c_module_string_trim = l2c::make_function(" in cpp
+        assert 'l2c::print(string_trim(" a "));' in cpp
+
+    def test_other_members_bound(self):
+        assert "l2c::math_abs(NUMBER(1))" in _generate("math.floor = print\nprint(math.abs(1))")
+
+    def test_rebound_library(self):
+        assert "_l2c_module_math_" not in _generate("local math = {}\nmath.floor = print")
+
+    def test_disabled_for_table_runtime(self):
+        assert "_l2c_module_math_floor" not in _generate("math.floor = print", runtime="table")
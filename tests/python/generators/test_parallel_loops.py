@@ -0,0 +1,161 @@
+"""Tests for parallel numeric for-loops (lua_table runtime, --parallel)
+
+ParallelAnalyzer marks the loops whose iterations are independent; the
+statement generator runs them through l2c::parallel_for, keeping the
+serial loop for when the runtime finds it can't (lua_parallel.hpp).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast, astnodes
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.parallel_analyzer import ParallelAnalyzer
+from lua2cpp.core.types import ASTAnnotationStore
+from .helpers import generate
+
+
+def _generate(lua_code, runtime="lua_table", parallel=True):
+    return generate(lua_code, runtime, parallel=parallel)
+
+
+def _marked(lua_code):
+    chunk = ast.parse(lua_code)
+    ParallelAnalyzer().analyze(chunk)
+    loops = []
+
+    def walk(node):
+        if isinstance(node, list):
+            for child in node:
+                walk(child)
+            return
+        if not hasattr(node, '__dict__'):
+            return
+        info = ASTAnnotationStore.get_annotation(node, 'parallel_loop')
+        if info is not None:
+            loops.append(info)
+        for value in vars(node).values():
+            if isinstance(value, (list, astnodes.Node)):
+                walk(value)
+
+    walk(chunk)
+    return loops
+
+
+MATVEC = """local function A(i, j)
+  local ij = i + j - 1
+  return 1.0 / (ij * (ij - 1) * 0.5 + i)
+end
+local function Av(x, y, N)
+  for i = 1, N do
+    local a = 0
+    for j = 1, N do a = a + x[j] * A(i, j) end
+    y[i] = a
+  end
+end"""
+
+REDUCTION = """local function f(x) return x * x end
+local function total(n)
+  local s = 0
+  for i = 1, n do s = s + f(i) end
+  return s
+end"""
+
+
+class TestParallelAnalysis:
+    """Test which loops are found independent"""
+
+    def test_matrix_vector_product(self):
+        loops = _marked(MATVEC)
+        assert len(loops) == 1
+        assert loops[0].written == ["y"]
+        assert loops[0].read == ["x"]
+        assert loops[0].reductions == []
+
+    def test_inner_loop_of_serial_loop(self):
+        lua = MATVEC + "\nlocal t = {}\nfor k = 1, 3 do\n  print(k)\n  for i = 1, 10 do t[i] = A(i, k) end\nend"
+        assert [loop.written for loop in _marked(lua)] == [["y"]]
+
+    def test_inner_loop_of_while_loop(self):
+        lua = MATVEC + "\nlocal t = {}\nwhile #t < 3 do\n  for i = 1, 10 do t[i] = A(i, 1) end\nend"
+        assert [loop.written for loop in _marked(lua)] == [["y"]]
+
+    def test_loop_in_function_defined_in_loop(self):
+        lua = MATVEC + "\nfor k = 1, 3 do\n  print(k)\n  local g = function(y) for i = 1, 10 do y[i] = A(i, 1) end end\nend"
+        assert len(_marked(lua)) == 2
+
+    def test_accumulator(self):
+        loops = _marked(REDUCTION)
+        assert [loop.reductions for loop in loops] == [["s"]]
+
+    def test_accumulator_read_elsewhere_is_not_reduced(self):
+        lua = "local function f(x) return x end\nlocal s = 0\nfor i = 1, 10 do s = s + f(i); local t = s end"
+        assert _marked(lua) == []
+
+    def test_loop_without_work_stays_serial(self):
+        assert _marked("local t = {}\nfor i = 1, 10 do t[i] = i end") == []
+
+    def test_read_of_written_table(self):
+        lua = "local function f(x) return x end\nlocal t = {}\nfor i = 2, 10 do t[i] = t[i - 1] + f(i) end"
+        assert _marked(lua) == []
+
+    def test_store_off_the_loop_index(self):
+        lua = "local function f(x) return x end\nlocal t = {}\nfor i = 1, 10 do t[i + 1] = f(i) end"
+        assert _marked(lua) == []
+
+    def test_impure_call(self):
+        lua = "local function f(x) print(x) return x end\nlocal t = {}\nfor i = 1, 10 do t[i] = f(i) end"
+        assert _marked(lua) == []
+
+    def test_function_reading_module_state_is_impure(self):
+        lua = "local k = 2\nlocal function f(x) return x * k end\nlocal t = {}\nfor i = 1, 10 do t[i] = f(i) end"
+        assert _marked(lua) == []
+
+    def test_math_alias_is_pure(self):
+        lua = "local sqrt = math.sqrt\nlocal t = {}\nfor i = 1, 10 do for j = 1, i do t[i] = sqrt(j) end end"
+        assert len(_marked(lua)) == 1
+
+    def test_step_other_than_one(self):
+        lua = "local function f(x) return x end\nlocal t = {}\nfor i = 1, 10, 2 do t[i] = f(i) end"
+        assert _marked(lua) == []
+
+    def test_concatenation_allocates(self):
+        lua = "local function f(x) return x end\nlocal t = {}\nfor i = 1, 10 do t[i] = f(i) .. 'x' end"
+        assert _marked(lua) == []
+
+    def test_break_out_of_loop(self):
+        lua = "local function f(x) return x end\nlocal t = {}\nfor i = 1, 10 do t[i] = f(i); break end"
+        assert _marked(lua) == []
+
+
+class TestParallelGeneration:
+    """Test the l2c::parallel_for emitted for marked loops"""
+
+    def test_parallel_for_with_serial_fallback(self):
+        cpp = _generate(MATVEC)
+        assert ("if (!l2c::parallel_for(_l2c_start_3, _l2c_limit_3, {l2c::as_value(y)}, {l2c::as_value(x)}, "
+                "[&](int64_t i, auto& _l2c_lane) {") in cpp
+        assert "for (int64_t i = _l2c_start_3; i <= _l2c_limit_3; i += 1) {" in cpp
+
+    def test_store_goes_through_lane(self):
+        cpp = _generate(MATVEC)
+        assert "_l2c_lane.store(l2c::as_value(y), i, l2c::as_value(a));" in cpp
+        assert "y[i] = a;" in cpp
+
+    def test_accumulator_goes_through_lane(self):
+        cpp = _generate(REDUCTION)
+        assert "_l2c_lane.add(0, f(static_cast<double>(i)));" in cpp
+        assert "}, s))" in cpp
+
+    def test_module_state_captured_by_value(self):
+        lua = "local function f(x) return x end\nlocal src, dst = {}, {}\nfor i = 1, 10 do dst[i] = src[i] * f(i) end"
+        cpp = _generate(lua)
+        assert "[&, module_src = module_src](int64_t i, auto& _l2c_lane) {" in cpp
+
+    def test_off_without_flag(self):
+        assert "l2c::parallel_for" not in _generate(MATVEC, parallel=False)
+
+    def test_disabled_for_table_runtime(self):
+        assert "l2c::parallel_for" not in _generate(MATVEC, runtime="table")
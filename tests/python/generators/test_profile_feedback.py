@@ -0,0 +1,112 @@
+"""Tests for profile-guided transpilation (lua_table runtime)
+
+--instrument makes named functions record call counts and argument and
+return types in an l2c::profile::Site. A loaded TypeProfile specializes
+hot functions whose parameters were only numbers: the body becomes
+_l2c_generic_<name> and <name> guards on the arguments before unboxing.
+"""
+
+import json
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.type_profile import FunctionProfile, TypeProfile, HOT_CALL_THRESHOLD
+from lua2cpp.generators.cpp_emitter import CppEmitter
+from .helpers import generate
+
+
+def _generate(lua_code, runtime="lua_table", instrument=False, profile=None):
+    return generate(lua_code, runtime, instrument=instrument, profile=profile)
+
+
+def _profile(name, params, calls=HOT_CALL_THRESHOLD):
+    profile = TypeProfile()
+    profile.add("module", FunctionProfile(name=name, line=0, calls=calls,
+                                          params=[set(p) for p in params]))
+    return profile
+
+
+# Arguments not provably numbers, so add keeps a template signature
+ADD = "local function add(a, b)\n  return a + b\nend\nprint(add(tonumber(arg[1]), tonumber(arg[2])))"
+
+
+class TestInstrumentation:
+    """Test the profile sites --instrument emits"""
+
+    def test_function_entry_records_arguments(self):
+        cpp = _generate(ADD, instrument=True)
+        assert 'l2c::profile::site("module", "add", ' in cpp
+        assert "_l2c_prof.enter(a, b);" in cpp
+
+    def test_single_value_return_is_recorded(self):
+        cpp = _generate(ADD, instrument=True)
+        assert "return _l2c_prof.ret(" in cpp
+
+    def test_table_function_uses_cpp_name(self):
+        cpp = _generate("local T = {}\nfunction T.f(x)\n  return x\nend\nprint(T.f(1))", instrument=True)
+        assert '"T_f"' in cpp
+
+    def test_closure_returns_are_not_recorded(self):
+        cpp = _generate("local function f(x)\n  local g = function() return x end\n  return g\nend\nprint(f(1))",
+                        instrument=True)
+        assert "return x;" in cpp
+
+    def test_off_by_default(self):
+        assert "l2c::profile" not in _generate(ADD)
+
+
+class TestProfileFeedback:
+    """Test specialization on observed parameter types"""
+
+    def test_hot_number_params_are_guarded(self):
+        cpp = _generate(ADD, profile=_profile("add", [["number"], ["number"]]))
+        assert "_l2c_generic_add(a_t a, b_t b)" in cpp
+        assert "l2c::holds_number(a) && l2c::holds_number(b)" in cpp
+        assert "_l2c_generic_add(l2c::unbox_number(a), l2c::unbox_number(b))" in cpp
+        assert "return _l2c_generic_add(a, b);" in cpp
+
+    def test_only_monomorphic_params_are_unboxed(self):
+        cpp = _generate(ADD, profile=_profile("add", [["number"], ["number", "string"]]))
+        assert "_l2c_generic_add(l2c::unbox_number(a), b)" in cpp
+
+    def test_cold_function_is_not_specialized(self):
+        cpp = _generate(ADD, profile=_profile("add", [["number"], ["number"]], calls=10))
+        assert "_l2c_generic_add" not in cpp
+
+    def test_assigned_param_is_not_specialized(self):
+        lua = "local function f(a)\n  a = tostring(a)\n  return a\nend\nprint(f(1))"
+        assert "_l2c_generic_f" not in _generate(lua, profile=_profile("f", [["number"]]))
+
+    def test_registry_records_observed_types(self):
+        emitter = CppEmitter(runtime="lua_table", profile=_profile("add", [["number"], ["table"]]))
+        emitter.generate_file(ast.parse(ADD))
+        signature = emitter.function_registry.get_signature("add")
+        assert signature.call_count == HOT_CALL_THRESHOLD
+        assert signature.observed_as(0, "number")
+        assert signature.observed_as(1, "table")
+
+    def test_load_round_trip(self, tmp_path):
+        path = tmp_path / "l2c.profile.json"
+        path.write_text(json.dumps({"version": 1, "functions": [
+            {"module": "m", "name": "f", "line": 3, "calls": 5, "params": [["number"]], "returns": []},
+            {"module": "m", "name": "f", "line": 3, "calls": 7, "params": [["string"]], "returns": ["nil"]},
+        ]}))
+        entry = TypeProfile.load(path).lookup("m", "f", 3)
+        assert entry.calls == 12
+        assert entry.params == [{"number", "string"}]
+
+    def test_rejects_unknown_version(self, tmp_path):
+        path = tmp_path / "bad.json"
+        path.write_text('{"version": 99}')
+        with pytest.raises(ValueError):
+            TypeProfile.load(path)
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(ADD, runtime="table", instrument=True, profile=_profile("add", [["number"], ["number"]]))
+        assert "l2c::profile" not in cpp
+        assert "_l2c_generic_add" not in cpp
@@ -0,0 +1,63 @@
+"""Tests for record shapes (lua_table runtime)
+
+Constructors with a fixed set of identifier keys become shaped tables with
+inline fields; `x.k` accesses bound to a shape use l2c::getfield/setfield.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestRecordShapes:
+    """Test shape declaration and field access lowering"""
+
+    def test_constructor_uses_record_ctor(self):
+        cpp = _generate("local c = {re = 1, im = 2}\nlocal x = c.re")
+        assert "static const l2c::Shape _l2c_shape_0{_l2c_key_re, _l2c_key_im};" in cpp
+        assert "l2c::RecordCtor<2>{_l2c_shape_0, NUMBER(1), NUMBER(2)}.table" in cpp
+
+    def test_field_read_uses_slot(self):
+        cpp = _generate("local c = {re = 1, im = 2}\nlocal x = c.im")
+        assert "l2c::getfield(module_c, _l2c_shape_0, 1, _l2c_key_im)" in cpp
+
+    def test_field_store_uses_setfield(self):
+        cpp = _generate("local c = {re = 1, im = 2}\nc.re = 5")
+        assert "l2c::setfield(module_c, _l2c_shape_0, 0, _l2c_key_re, NUMBER(5));" in cpp
+
+    def test_shape_declared_after_keys(self):
+        cpp = _generate("local c = {re = 1, im = 2}")
+        assert cpp.index('l2c::intern("im")') < cpp.index("l2c::Shape _l2c_shape_0")
+
+    def test_new_field_drops_shape(self):
+        cpp = _generate("local p = {x = 1}\np.y = 2\nlocal a = p.x")
+        assert "RecordCtor" not in cpp
+        assert "getfield" not in cpp
+
+    def test_ambiguous_field_is_generic(self):
+        cpp = _generate("local a = {x = 1, y = 2}\nlocal b = {y = 3, x = 4}\nlocal function f(p) return p.x end")
+        assert "return l2c::getfield" not in cpp
+
+    def test_positional_constructor_is_not_record(self):
+        cpp = _generate("local t = {1, x = 2}")
+        assert "RecordCtor" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local c = {re = 1, im = 2}\nlocal x = c.re", runtime="table")
+        assert "l2c::Shape" not in cpp
+        assert "getfield" not in cpp
+
+    def test_function_returning_record_returns_table(self):
+        cpp = _generate("local function pt(x, y) return {x = x, y = y} end\nlocal p = pt(1, 2)")
+        assert "RecordCtor" in cpp
+        assert "TABLE pt(" in cpp
+        assert "double pt(" not in cpp
+
+    def test_function_returning_local_table_returns_table(self):
+        cpp = _generate("local function mk(n) local t = {} for i = 1, n do t[i] = i end return t end")
+        assert "TABLE mk(" in cpp
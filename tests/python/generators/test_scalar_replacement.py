@@ -0,0 +1,80 @@
+"""Tests for scalar replacement of non-escaping tables (lua_table runtime)
+
+EscapeAnalyzer finds `local t = {k = v}` tables in a function whose only
+uses are `t.k` reads and stores; the generators then keep each field in a
+TValue local and never allocate the LuaTable.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.escape_analyzer import EscapeAnalyzer
+from .helpers import generate as _generate
+
+
+def _replaced(lua_code):
+    return EscapeAnalyzer().analyze(ast.parse(lua_code))
+
+
+POINT = """local function len2(x, y)
+  local p = {x = x, y = y}
+  p.x = p.x * 2
+  return p.x * p.x + p.y * p.y
+end
+print(len2(1, 2))"""
+
+
+class TestEscapeAnalysis:
+    """Test which tables are found not to escape"""
+
+    def test_field_only_table_is_replaced(self):
+        assert _replaced(POINT) == 1
+
+    def test_returned_table_escapes(self):
+        assert _replaced("local function f(x)\n  local t = {x = x}\n  return t\nend") == 0
+
+    def test_passed_table_escapes(self):
+        assert _replaced("local function f(x)\n  local t = {x = x}\n  print(t)\nend") == 0
+
+    def test_metatable_escapes(self):
+        assert _replaced("local function f(x)\n  local t = {x = x}\n  setmetatable(t, {})\n  return t.x\nend") == 0
+
+    def test_computed_index_escapes(self):
+        assert _replaced("local function f(k)\n  local t = {x = 1}\n  return t[k]\nend") == 0
+
+    def test_method_call_escapes(self):
+        assert _replaced("local function f()\n  local t = {x = 1}\n  return t:get()\nend") == 0
+
+    def test_captured_table_escapes(self):
+        lua = "local function f()\n  local t = {x = 1}\n  return function() return t.x end\nend"
+        assert _replaced(lua) == 0
+
+    def test_positional_fields_are_not_replaced(self):
+        assert _replaced("local function f()\n  local t = {1, 2}\n  return t.n\nend") == 0
+
+    def test_module_level_tables_are_not_replaced(self):
+        assert _replaced("local t = {x = 1}\nprint(t.x)") == 0
+
+
+class TestScalarReplacement:
+    """Test the code generated for replaced tables"""
+
+    def test_fields_become_locals(self):
+        cpp = _generate(POINT)
+        assert "TValue p_x = l2c::as_value(x);" in cpp
+        assert "TValue p_y = l2c::as_value(y);" in cpp
+        assert "TableCtor" not in cpp and "RecordCtor" not in cpp
+
+    def test_field_store_assigns_local(self):
+        assert "p_x = l2c::as_value(" in _generate(POINT)
+
+    def test_unset_field_starts_nil(self):
+        lua = "local function f()\n  local t = {}\n  t.n = 1\n  return t.n\nend\nprint(f())"
+        assert "TValue t_n = NIL;" in _generate(lua)
+
+    def test_disabled_for_table_runtime(self):
+        assert "TValue p_x" not in _generate(POINT, runtime="table")
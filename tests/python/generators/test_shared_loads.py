@@ -0,0 +1,100 @@
+"""Tests for shared field loads (lua_table runtime)
+
+LoadAnalyzer finds the reads of one constant key of one local table that
+no store or call in between can change: the generator loads each of them
+once into a local, ahead of its statement or, for loop-invariant reads,
+ahead of the loop.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+POINT = """local p = {x = 3, y = 4}
+print(p.x * p.x + p.y * p.y)
+"""
+
+SCALE = """local cfg = {scale = 2}
+local function run(n)
+  local s = 0
+  for i = 1, n do s = s + i * cfg.scale end
+  return s
+end
+print(run(10))
+"""
+
+
+class TestStatementLoads:
+    """Test the reads shared within a basic block"""
+
+    def test_repeated_reads_loaded_once(self):
+        cpp = _generate(POINT)
+        assert "TValue _l2c_load_0 = l2c::getfield(module_p, _l2c_shape_0, 0, _l2c_key_x);" in cpp
+        assert "(_l2c_load_0 * _l2c_load_0)" in cpp
+        assert cpp.count("l2c::getfield(module_p,") == 2
+
+    def test_shared_across_statements(self):
+        cpp = _generate("local p = {x = 1}\nlocal a = p.x + 1\nlocal b = p.x * 2\nprint(a + b)")
+        assert "module_b = (_l2c_load_0 * NUMBER(2));" in cpp
+
+    def test_store_to_key_reloads(self):
+        cpp = _generate("local p = {x = 1}\nlocal a = p.x + p.x\np.x = 2\nprint(a + p.x)")
+        assert "module_a = (_l2c_load_0 + _l2c_load_0);" in cpp
+        assert "l2c::print((module_a + l2c::getfield(module_p, _l2c_shape_0, 0, _l2c_key_x)));" in cpp
+
+    def test_call_between_reloads(self):
+        cpp = _generate("local p = {x = 1}\nlocal a = p.x + p.x\nprint(a)\nprint(a + p.x)")
+        assert "module_a = (_l2c_load_0 + _l2c_load_0);" in cpp
+        assert "l2c::print((module_a + l2c::getfield(module_p, _l2c_shape_0, 0, _l2c_key_x)));" in cpp
+
+    def test_read_after_call_not_shared(self):
+        cpp = _generate("local p = {x = 1}\nprint(p.x + g() + p.x)")
+        assert "_l2c_load_" not in cpp
+
+    def test_parameter_not_shared(self):
+        # p and mt may come with metatables set by another module: p.f may
+        # run __index, and mt's __newindex may store to p.f for mt.z
+        lua = "local function f(p, mt)\nlocal res = p.f + p.f\nmt.z = 99\nreturn res + p.f\nend\nreturn f"
+        assert "_l2c_load_" not in _generate(lua)
+
+    def test_table_given_a_metatable_not_shared(self):
+        assert "_l2c_load_" not in _generate("local p = setmetatable({x = 1}, {})\nprint(p.x + p.x)")
+        assert "_l2c_load_" not in _generate("local p = {x = 1}\nsetmetatable(p, {})\nprint(p.x + p.x)")
+
+    def test_escaping_table_not_shared(self):
+        # f may set p's metatable
+        assert "_l2c_load_" not in _generate("local p = {x = 1}\nf(p)\nprint(p.x + p.x)")
+        assert "_l2c_load_" not in _generate("local p = {x = 1}\nlocal q = p\nprint(p.x + p.x)")
+
+    def test_table_stored_elsewhere_not_shared(self):
+        # a metamethod may run the store in the middle of g
+        lua = "local t = {n = 1}\nlocal function bump() t.n = t.n + 1 end\nlocal function g() return t.n + t.n end"
+        assert "_l2c_load_" not in _generate(lua)
+
+
+class TestLoopInvariantLoads:
+    """Test the reads hoisted out of loops"""
+
+    def test_hoisted_out_of_call_free_loop(self):
+        cpp = _generate(SCALE)
+        assert ("TValue _l2c_load_0 = l2c::getfield(module_cfg, _l2c_shape_0, 0, _l2c_key_scale);\n"
+                "int64_t _l2c_start_1 = 1;") in cpp
+        assert "s = (s + (static_cast<double>(i) * _l2c_load_0));" in cpp
+
+    def test_loop_with_call_not_hoisted(self):
+        cpp = _generate(SCALE.replace("s = s + i * cfg.scale", "s = s + i * cfg.scale print(s)"))
+        assert "_l2c_load_" not in cpp
+
+    def test_stored_key_not_hoisted(self):
+        cpp = _generate("local t = {v = 1}\nlocal k = 'v'\nwhile t.v < 100 do t[k] = t.v * 2 end\nprint(t.v)")
+        assert "_l2c_load_" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        assert "_l2c_load_" not in _generate(SCALE, runtime="table")
+        assert "_l2c_load_" not in _generate(POINT, runtime="table")
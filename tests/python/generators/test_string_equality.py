@@ -0,0 +1,42 @@
+"""Tests for content equality of strings (lua_table runtime)
+
+Strings from .., sub, format and the like are collector-owned, not
+interned, so two STRING (const char*) values holding equal strings may
+have different addresses. == and ~= with a string operand go through
+l2c::str_equals, which compares two const char* by content.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestStringEquality:
+    """Test which comparisons compare contents"""
+
+    def test_string_locals(self):
+        cpp = _generate('local a = "x" .. 1\nlocal b = "x" .. 1\nprint(a == b, a ~= b)')
+        assert "l2c::str_equals(module_a, module_b)" in cpp
+        assert "(!l2c::str_equals(module_a, module_b))" in cpp
+        assert "(module_a == module_b)" not in cpp
+
+    def test_concat_results(self):
+        cpp = _generate('print(("x" .. 1) == ("x" .. 1))')
+        assert 'l2c::str_equals(l2c::concat("x", NUMBER(1)), l2c::concat("x", NUMBER(1)))' in cpp
+
+    def test_literal_against_call(self):
+        cpp = _generate('local n = 2\nprint(string.format("%d", n) == "2")')
+        assert 'l2c::str_equals(l2c::format(_l2c_fmt_0, module_n), "2")' in cpp
+
+    def test_numbers_unchanged(self):
+        cpp = _generate('local n = 1\nprint(n == 2, n ~= 3)')
+        assert "str_equals" not in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate('local a = "x" .. 1\nprint(a == "x1")', runtime="table")
+        assert "str_equals" not in cpp
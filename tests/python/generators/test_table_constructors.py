@@ -0,0 +1,67 @@
+"""Tests for presized table constructors (lua_table runtime)
+
+Constructors are emitted as `l2c::TableCtor<nArr, nHash>{...}.table`,
+sized from the AST instead of a capturing lambda over NEW_TABLE.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestPresizedTables:
+    """Test TableCtor emission"""
+
+    def test_array_constructor_counts(self):
+        cpp = _generate("local function f() return {'a', 'b', 'c'} end")
+        assert "l2c::TableCtor<3, 0>{" in cpp
+        assert "[=]()" not in cpp
+
+    def test_keyed_constructor_uses_interned_keys(self):
+        # Bracket keys keep this out of record shapes (see test_record_shapes.py)
+        cpp = _generate("local function complex(x, y) return {re = x, [\"im\"] = y} end")
+        assert "l2c::TableCtor<0, 2>{_l2c_key_re, x, _l2c_key_im, y}.table" in cpp
+
+    def test_mixed_constructor_puts_array_values_first(self):
+        cpp = _generate("local function f() return {10, x = 1, 20} end")
+        assert "l2c::TableCtor<2, 1>{NUMBER(10), NUMBER(20), " in cpp
+        assert "_l2c_key_x, NUMBER(1)}.table" in cpp
+
+    def test_bracket_variable_key_is_expression(self):
+        cpp = _generate("local k = 'a'\nlocal t = {[k] = 1}")
+        assert 'STRING("k")' not in cpp
+
+    def test_empty_constructor_stays_new_table(self):
+        cpp = _generate("local t = {}")
+        assert "NEW_TABLE" in cpp
+        assert "TableCtor" not in cpp
+
+    def test_table_runtime_keeps_lambda(self):
+        cpp = _generate("local t = {1, 2}", runtime="table")
+        assert "TableCtor" not in cpp
+        assert "[=]()" in cpp
+
+
+class TestNumberArrayHint:
+    """Test ARRAY_NUMBER construction of number-only tables"""
+
+    def test_filled_by_numbers_uses_number_table(self):
+        cpp = _generate("local v = {}\nfor i = 1, 10 do v[i] = i * 0.5 end")
+        assert "NEW_NUMBER_TABLE" in cpp
+
+    def test_number_constructor_has_number_kind(self):
+        cpp = _generate("local v = {1, 2, 3}\nv[4] = 4\nlocal s = 0\nfor i = 1, 4 do s = s + v[i] end")
+        assert "l2c::TableCtor<3, 0, ARRAY_NUMBER>{" in cpp
+
+    def test_string_store_keeps_generic_table(self):
+        cpp = _generate("local v = {}\nv[1] = 1\nv[2] = 'x'")
+        assert "NEW_NUMBER_TABLE" not in cpp
+
+    def test_field_store_keeps_generic_table(self):
+        cpp = _generate("local v = {}\nv[1] = 1\nv.n = 1")
+        assert "NEW_NUMBER_TABLE" not in cpp
@@ -0,0 +1,47 @@
+"""Tests for pairs/ipairs loop lowering (lua_table runtime)
+
+pairs and ipairs for-in loops drive an l2c::PairsIter / l2c::IpairsIter
+that resolves the table once and resumes from a cursor on each step.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestTableIterators:
+    """Test iterator-object pairs/ipairs loops"""
+
+    def test_pairs_loop(self):
+        cpp = _generate("local t = {}\nfor k, v in pairs(t) do print(k, v) end")
+        assert "for (l2c::PairsIter _l2c_forin_iter_1(module_t); _l2c_forin_iter_1.next(); )" in cpp
+        assert "auto k = _l2c_forin_iter_1.key;" in cpp
+        assert "auto v = _l2c_forin_iter_1.val;" in cpp
+        assert "->next(" not in cpp
+
+    def test_ipairs_loop(self):
+        cpp = _generate("local t = {}\nfor i, v in ipairs(t) do print(i, v) end")
+        assert "for (l2c::IpairsIter _l2c_forin_iter_1(module_t); _l2c_forin_iter_1.next(); )" in cpp
+        assert "auto i = TValue::Integer(_l2c_forin_iter_1.index);" in cpp
+        assert "auto v = _l2c_forin_iter_1.val;" in cpp
+        assert "rawget" not in cpp
+
+    def test_underscore_target_is_not_bound(self):
+        cpp = _generate("local t = {}\nfor _, v in ipairs(t) do print(v) end")
+        assert "auto _ =" not in cpp
+        assert "auto v = _l2c_forin_iter_1.val;" in cpp
+
+    def test_nested_loops_use_distinct_iterators(self):
+        cpp = _generate("local t = {}\nfor _, r in ipairs(t) do for k in pairs(r) do print(k) end end")
+        assert cpp.count("l2c::PairsIter ") == 1
+        assert cpp.count("l2c::IpairsIter ") == 1
+        assert "_l2c_forin_iter_1" in cpp and "_l2c_forin_iter_2" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local t = {}\nfor k, v in pairs(t) do print(k, v) end", runtime="table")
+        assert "PairsIter" not in cpp
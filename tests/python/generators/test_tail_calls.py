@@ -0,0 +1,74 @@
+"""Tests for self tail calls (lua_table runtime)
+
+TailCallAnalyzer marks `return f(...)` in local function f; the call
+compiles to rebinding f's parameters and jumping back to the top of the
+body, so tail recursion runs in constant stack.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.tail_call_analyzer import TailCallAnalyzer
+from .helpers import generate as _generate
+
+
+def _count(lua_code):
+    return TailCallAnalyzer().analyze(ast.parse(lua_code))
+
+
+SUM = """local function sum(n, acc)
+  if n == 0 then return acc end
+  return sum(n - 1, acc + n)
+end
+print(sum(10, 0))
+"""
+
+
+class TestAnalysis:
+    """Test the calls TailCallAnalyzer accepts"""
+
+    def test_self_tail_call(self):
+        assert _count(SUM) == 1
+
+    def test_not_in_tail_position(self):
+        assert _count("local function f(n) if n > 0 then return 1 + f(n - 1) end return 0 end") == 0
+
+    def test_argument_count_must_match(self):
+        assert _count("local function f(a, b) return f(a) end") == 0
+
+    def test_nested_function(self):
+        assert _count("local function f(n) local g = function() return n end return f(n - 1) end") == 0
+
+    def test_rebound_name(self):
+        assert _count("local function f(n) return f(n) end\nf = print") == 0
+        assert _count("local function f(n) local f = print return f(n) end") == 0
+
+
+class TestGeneration:
+    """Test the emitted jump"""
+
+    def test_rebinds_and_jumps(self):
+        cpp = _generate(SUM)
+        assert "double sum(double n, double acc) {\n    _l2c_tail_call:;" in cpp
+        assert ("auto _l2c_arg_0 = (n - NUMBER(1));\n    auto _l2c_arg_1 = (acc + n);\n"
+                "    n = std::move(_l2c_arg_0);\n    acc = std::move(_l2c_arg_1);\n"
+                "    goto _l2c_tail_call;") in cpp
+
+    def test_template_checks_types(self):
+        cpp = _generate("local function f(v, n) if n == 0 then return v end return f(v, n - 1) end\n"
+                        "print(f(1), f('a', 2))")
+        assert "if constexpr (l2c::rebinds_v<decltype(v), decltype(_l2c_arg_0)>" in cpp
+        assert "return f(_l2c_arg_0, _l2c_arg_1);" in cpp
+
+    def test_inner_call_stays_recursive(self):
+        cpp = _generate("local function ack(m, n)\nif m == 0 then return n + 1 end\n"
+                        "return ack(m - 1, ack(m, n - 1))\nend\nprint(ack(2, 3))")
+        assert cpp.count("goto _l2c_tail_call;") == 1
+        assert "auto _l2c_arg_1 = l2c::as_value(ack(m, l2c::as_value((n - NUMBER(1)))));" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        assert "_l2c_tail_call" not in _generate(SUM, runtime="table")
@@ -0,0 +1,43 @@
+"""Tests for per-thread module state (lua_table runtime)
+
+Each thread runs its own l2c::State, so module state is emitted
+thread_local; module init roots this thread's copy and creates its
+tables, letting independent instances of a module run on many threads.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+def _module_init(cpp):
+    return cpp[cpp.index("void module_module_init("):]
+
+
+class TestThreadState:
+    """Test thread_local module state emission"""
+
+    def test_module_state_is_thread_local(self):
+        cpp = _generate("local t = {}\nlocal n = 1\nprint(t, n)")
+        assert "thread_local TABLE module_t;" in cpp
+        assert "thread_local NUMBER module_n;" in cpp
+
+    def test_module_tables_created_by_init(self):
+        cpp = _generate("local t = {}\nt[1] = 2")
+        assert "module_t = NEW_TABLE;" in _module_init(cpp)
+        assert "TABLE module_t = NEW_TABLE;" not in cpp
+
+    def test_roots_registered_per_thread(self):
+        init = _module_init(_generate("local t = {}\nt[1] = 2"))
+        roots = init.index("static thread_local const l2c::GCRoots _l2c_module_gc_roots{&module_t};")
+        assert roots < init.index("module_t = NEW_TABLE;")
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local t = {}\nt[1] = 2", runtime="table")
+        assert "thread_local" not in cpp
+        assert "TABLE module_t = NEW_TABLE;" in cpp
@@ -0,0 +1,69 @@
+"""Tests for unboxed number and boolean values (lua_table runtime)
+
+Locals declared from proven numbers or booleans, numeric loop variables
+and NUMBER module state are C++ doubles and bools. The generators keep
+them that way: `and`/`or` of booleans become `&&`/`||`, a number on the
+left of `or` is the result, and loop bounds skip the TValue round trip.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+LEVEL = """local function level(limit)
+  local l = 0
+  repeat
+    l = l + 1
+  until l > limit or l > 255
+  return l
+end
+print(level(10))"""
+
+
+class TestUnboxedLocals:
+    """Test that proven values skip boxing"""
+
+    def test_boolean_or_is_logical(self):
+        assert "((l > limit) || (l > NUMBER(255)))" in _generate(LEVEL)
+
+    def test_boolean_and_is_logical(self):
+        lua = "local function f(a, b)\n  return a < b and b < 10\nend\nprint(f(1, 2))"
+        assert "((a < b) && (b < NUMBER(10)))" in _generate(lua)
+
+    def test_number_or_default_is_the_number(self):
+        lua = "local function f()\n  local n = 5\n  local m = n or 10\n  return m\nend\nprint(f())"
+        assert " m = n;" in _generate(lua)
+
+    def test_not_number_is_false(self):
+        lua = "local function f()\n  local n = 5\n  return not n\nend\nprint(f())"
+        assert "return false;" in _generate(lua)
+
+    def test_numeric_loop_bounds_are_not_boxed(self):
+        lua = "local function f()\n  local n = 10\n  local s = 0\n  for i = 1, n * 2 do s = s + i end\n  return s\nend\nprint(f())"
+        assert "l2c::for_limit((n * NUMBER(2)), 1)" in _generate(lua)
+
+    def test_number_module_state_bounds(self):
+        lua = "local N = 100\nlocal s = 0\nfor i = 1.5, N do s = s + i end\nprint(s)"
+        assert "= module_N;" in _generate(lua)
+
+    def test_unknown_values_keep_lua_semantics(self):
+        lua = "local function f(t)\n  local v = t[1] or 0\n  return v\nend\nprint(f({}))"
+        assert "? (" in _generate(lua)
+
+    def test_closure_parameter_shadows_number(self):
+        lua = """local function f()
+  local x = 1
+  local g = function(x) return x or 2 end
+  return g(nil)
+end
+print(f())"""
+        assert "return x;" not in _generate(lua)
+
+    def test_disabled_for_table_runtime(self):
+        assert "||" not in _generate(LEVEL, runtime="table")
@@ -0,0 +1,68 @@
+"""Tests for spreading table.unpack (lua_table runtime)
+
+A last table.unpack(...) argument passes all its values: print and
+io.write take it as an l2c::Spread, functions of known arity through
+l2c::spread, and {table.unpack(t)} copies it with l2c::Values::table.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+SUM = """local function f(a, b, c) return a + b + c end
+local t = {1, 2, 3}
+print(f(table.unpack(t)))
+"""
+
+
+class TestLibrarySpread:
+    """Test print and io.write taking every value"""
+
+    def test_print(self):
+        cpp = _generate("local t = {1, 2}\nprint('n', table.unpack(t))")
+        assert 'l2c::print("n", l2c::Spread{l2c::table_unpack(module_t)});' in cpp
+
+    def test_io_write(self):
+        cpp = _generate("local t = {'a', 'b'}\nio.write(table.unpack(t, 2))")
+        assert "l2c::io_write(l2c::Spread{l2c::table_unpack(module_t, NUMBER(2))});" in cpp
+
+    def test_not_last_argument(self):
+        cpp = _generate("local t = {1, 2}\nprint(table.unpack(t), 3)")
+        assert "l2c::Spread" not in cpp
+
+
+class TestFunctionSpread:
+    """Test calls to functions of known arity"""
+
+    def test_spread_over_parameters(self):
+        cpp = _generate(SUM)
+        assert ("l2c::spread<3>([&](auto&&... _l2c_a) -> decltype(auto) { return f(_l2c_a...); }, "
+                "l2c::table_unpack(module_t))") in cpp
+
+    def test_fixed_arguments_first(self):
+        cpp = _generate(SUM.replace("f(table.unpack(t))", "f(10, table.unpack(t))"))
+        assert "l2c::spread<2>(" in cpp
+        assert "l2c::table_unpack(module_t), NUMBER(10))" in cpp
+
+    def test_single_remaining_parameter(self):
+        cpp = _generate(SUM.replace("f(table.unpack(t))", "f(1, 2, table.unpack(t))"))
+        assert "l2c::spread<" not in cpp
+
+    def test_vararg_function_not_spread(self):
+        cpp = _generate("local function g(...) return select('#', ...) end\nprint(g(table.unpack({1, 2})))")
+        assert "l2c::spread<" not in cpp
+
+    def test_table_constructor_copies_all(self):
+        cpp = _generate("local t = {1, 2}\nlocal u = {table.unpack(t)}\nprint(#u)")
+        assert "module_u = l2c::table_unpack(module_t).table();" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate(SUM, runtime="table")
+        assert "l2c::spread<" not in cpp
+        assert "l2c::Spread" not in _generate("print(table.unpack({1, 2}))", runtime="table")
@@ -0,0 +1,104 @@
+"""Tests for fixed-arity multiple returns and varargs (lua_table runtime)
+
+Functions returning 2+ values return an l2c::ReturnPack<N>, every return
+padded to N; destructuring binds through l2c::take<N>. A vararg function
+takes `...` as a C++ parameter pack and copies it to l2c::Values only for
+indexed uses. Returning `...` or a call of unknown count returns an
+l2c::Values, and a last multi-value argument spreads over the callee.
+"""
+
+import pytest
+
+try:
+    from luaparser import ast
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from .helpers import generate as _generate
+
+
+class TestValuePacks:
+    """Test ReturnPack returns and parameter-pack varargs"""
+
+    def test_three_value_return(self):
+        cpp = _generate("local function f(a) return a, 2, 3 end\nprint(f(1))")
+        assert "l2c::ReturnPack<3> f(" in cpp
+        assert "return multi_return(a, NUMBER(2), NUMBER(3));" in cpp
+
+    def test_returns_padded_to_arity(self):
+        cpp = _generate("local function f(a)\n  if a then return a end\n  return a, a\nend\nprint(f(1))")
+        assert "return multi_return(a, NIL);" in cpp
+        assert "return multi_return(a, a);" in cpp
+
+    def test_bare_return_and_fallthrough_are_nil_packs(self):
+        cpp = _generate("local function f(a)\n  if a then return end\n  if a then return a, a end\nend\nprint(f(1))")
+        assert cpp.count("return multi_return(NIL, NIL);") == 2
+
+    def test_destructuring_uses_take(self):
+        cpp = _generate("local function f() return 1, 2, 3 end\nlocal function g()\n  local a, b, c = f()\n  print(a, b, c)\nend\ng()")
+        assert "auto [a, b, c] = l2c::take<3>(f());" in cpp
+        assert "_mr_a" not in cpp
+
+    def test_repeated_name_binds_last_value(self):
+        cpp = _generate("local function f() return 1, 2, 3 end\nlocal function g()\n  local _, _, c = f()\n  print(c)\nend\ng()")
+        assert "auto [_l2c_drop_0, _, c] = l2c::take<3>(f());" in cpp
+
+    def test_vararg_forwarding(self):
+        cpp = _generate("local function f(...)\n  print(...)\nend\nf(1, 2)")
+        assert "VA&&... _l2c_va" in cpp
+        assert "print(_l2c_va...)" in cpp
+        assert "l2c::Values" not in cpp
+
+    def test_select_count(self):
+        cpp = _generate("local function f(...)\n  return select('#', ...)\nend\nprint(f(1, 2))")
+        assert "NUMBER(sizeof...(_l2c_va))" in cpp
+
+    def test_indexed_vararg_use_copies_values(self):
+        cpp = _generate("local function f(...)\n  local a, b = ...\n  local t = {...}\n  return a, b, t\nend\nprint(f(1, 2))")
+        assert "l2c::Values _l2c_varargs = l2c::Values::of(_l2c_va...);" in cpp
+        assert "auto [a, b] = l2c::take<2>(_l2c_varargs);" in cpp
+        assert "_l2c_varargs.table()" in cpp
+
+    def test_returned_varargs_are_values(self):
+        cpp = _generate("local function f(x, ...) return x, ... end\nprint(f(1, 2))")
+        assert "l2c::Values f(x_t x, VA&&... _l2c_va)" in cpp
+        assert "return l2c::Values::of(x, _l2c_va...);" in cpp
+
+    def test_returned_call_keeps_its_values(self):
+        cpp = _generate("local function two() return 1, 2 end\n"
+                        "local function f() return two() end\n"
+                        "local function g() return 0, two() end\nprint(f(), g())")
+        assert "l2c::ReturnPack<2> f()" in cpp
+        assert "return l2c::take<2>(two());" in cpp
+        assert "l2c::ReturnPack<3> g()" in cpp
+        assert "return l2c::take<3>(l2c::Values::expand(NUMBER(0), two()));" in cpp
+
+    def test_last_argument_spreads(self):
+        cpp = _generate("local function two() return 1, 2 end\n"
+                        "local function cnt(...) return select('#', ...) end\n"
+                        "local function add(a, b) return a + b end\nprint(cnt(two()), add(two()), two())")
+        assert "l2c::spread<2>([&](auto&&... _l2c_a) -> decltype(auto) { return cnt(_l2c_a...); }, l2c::Values::expand(two()))" in cpp
+        assert "l2c::spread<2>([&](auto&&... _l2c_a) -> decltype(auto) { return add(_l2c_a...); }, l2c::Values::expand(two()))" in cpp
+        assert "l2c::Spread{l2c::Values::expand(two())}" in cpp
+
+    def test_run_time_count_spreads_all(self):
+        cpp = _generate("local function va(...) return ... end\n"
+                        "local function cnt(...) return select('#', ...) end\nprint(cnt(va(1, 2)))")
+        assert "l2c::spread_all([&](auto&&... _l2c_a) -> decltype(auto) { return cnt(_l2c_a...); }, va(NUMBER(1), NUMBER(2)))" in cpp
+
+    def test_single_value_context_takes_first(self):
+        cpp = _generate("local function two() return 1, 2 end\nlocal function f() return two() + 1, {two(), 3} end\nprint(f())")
+        assert "(l2c::as_value(two()) + NUMBER(1))" in cpp
+        assert "l2c::Values::expand(two()).table()" not in cpp
+
+    def test_module_scope_destructuring_assigns_state(self):
+        cpp = _generate("local function two() return 1, 2 end\nlocal x, y = two()\nlocal function f() return x + y end\nprint(f())")
+        assert "auto _l2c_pack_0 = l2c::take<2>(two());" in cpp
+        assert "module_x = _l2c_pack_0[1];" in cpp
+        assert "module_y = _l2c_pack_0[2];" in cpp
+        assert "(module_x + module_y)" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        cpp = _generate("local function f(...) return 1, 2, 3 end\nprint(f())", runtime="table")
+        assert "ReturnPack" not in cpp
+        assert "_l2c_va" not in cpp
@@ -0,0 +1,149 @@
+"""Tests for vector kernels over number arrays (lua_table runtime)
+
+VectorAnalyzer marks the loops that only compute with floats from
+tables; the statement generator looks up the tables' doubles once with
+l2c::number_span and indexes them directly, keeping the generated loop
+for when a table isn't a number array (lua_vector.hpp).
+"""
+
+import pytest
+
+try:
+    from luaparser import ast, astnodes
+except ImportError:
+    pytest.skip("luaparser is required. Install with: pip install luaparser", allow_module_level=True)
+
+from lua2cpp.analyzers.vector_analyzer import VectorAnalyzer
+from lua2cpp.core.types import ASTAnnotationStore
+from .helpers import generate as _generate
+
+
+def _marked(lua_code):
+    chunk = ast.parse(lua_code)
+    VectorAnalyzer().analyze(chunk)
+    loops = []
+
+    def walk(node):
+        if isinstance(node, list):
+            for child in node:
+                walk(child)
+            return
+        if not hasattr(node, '__dict__'):
+            return
+        info = ASTAnnotationStore.get_annotation(node, 'vector_loop')
+        if info is not None:
+            loops.append(info)
+        for value in vars(node).values():
+            if isinstance(value, (list, astnodes.Node)):
+                walk(value)
+
+    walk(chunk)
+    return loops
+
+
+DOT = """local function dot(x, y, n)
+  local s = 0
+  for i = 1, n do s = s + x[i] * y[i] end
+  return s
+end"""
+
+AXPY = """local function axpy(y, a, x, n)
+  for i = 1, n do y[i] = a * x[i] + y[i] end
+end"""
+
+
+class TestVectorAnalysis:
+    """Test which loops are found to be kernels"""
+
+    def test_reduction(self):
+        loops = _marked(DOT)
+        assert len(loops) == 1
+        assert loops[0].tables == ["x", "y"]
+        assert loops[0].reductions == ["s"]
+        assert loops[0].written == []
+
+    def test_store_with_scalar(self):
+        loops = _marked(AXPY)
+        assert [(loop.written, loop.scalars) for loop in loops] == [(["y"], ["a"])]
+        assert loops[0].independent
+
+    def test_offsets(self):
+        loops = _marked("local t, d = {}, {}\nfor i = 2, 9 do d[i] = t[i] - t[i - 1] end")
+        assert loops[0].offsets == {"t": (-1, 0), "d": (0, 0)}
+        assert not loops[0].independent
+
+    def test_body_locals_and_math(self):
+        lua = "local sqrt = math.sqrt\nlocal t = {}\nfor i = 1, 9 do local a = t[i]; t[i] = sqrt(a) + math.abs(a) end"
+        assert [loop.locals for loop in _marked(lua)] == [["a"]]
+
+    def test_other_calls(self):
+        assert _marked("local t = {}\nfor i = 1, 9 do t[i] = tostring(i) end") == []
+        assert _marked("local t = {}\nfor i = 1, 9 do t[i] = math.floor(t[i]) end") == []
+
+    def test_rebound_math(self):
+        lua = "local math = {sqrt = print}\nlocal t = {}\nfor i = 1, 9 do t[i] = math.sqrt(t[i]) end"
+        assert _marked(lua) == []
+
+    def test_index_off_the_loop_variable(self):
+        assert _marked("local t, k = {}, 1\nfor i = 1, 9 do t[k] = t[i] end") == []
+        assert _marked("local t = {}\nfor i = 1, 9 do t[2 * i] = t[i] end") == []
+
+    def test_accumulator_read_elsewhere(self):
+        assert _marked("local t, s = {}, 0\nfor i = 1, 9 do s = s + t[i]; t[i] = s end") == []
+
+    def test_table_used_as_scalar(self):
+        assert _marked("local t = {}\nfor i = 1, 9 do t[i] = t end") == []
+
+    def test_control_flow(self):
+        assert _marked("local t = {}\nfor i = 1, 9 do if t[i] then t[i] = 1 end end") == []
+        assert _marked("local t = {}\nfor i = 1, 9 do for j = 1, 2 do t[j] = 1 end end") != []
+
+    def test_no_table(self):
+        assert _marked("local s = 0\nfor i = 1, 9 do s = s + i end") == []
+
+    def test_step_other_than_one(self):
+        assert _marked("local t = {}\nfor i = 1, 9, 2 do t[i] = 0 end") == []
+
+
+class TestVectorGeneration:
+    """Test the kernel emitted for marked loops"""
+
+    def test_spans_looked_up_before_the_loop(self):
+        cpp = _generate(DOT)
+        assert "l2c::number_slot* _l2c_x_1 = l2c::number_span(x, _l2c_start_1, _l2c_limit_1, 0, 0);" in cpp
+        assert "if (_l2c_x_1 && _l2c_y_1) {" in cpp
+
+    def test_accumulator_kept_in_a_double(self):
+        cpp = _generate(DOT)
+        assert "double _l2c_s_1 = s;" in cpp
+        assert "_l2c_s_1 = (_l2c_s_1 + (_l2c_x_1[i - 1] * _l2c_y_1[i - 1]));" in cpp
+        assert "s = _l2c_s_1;" in cpp
+        assert "L2C_INDEPENDENT_ITERATIONS" not in cpp
+
+    def test_generated_loop_kept(self):
+        cpp = _generate(DOT)
+        assert "} else\nfor (int64_t i = _l2c_start_1; i <= _l2c_limit_1; i += 1) {" in cpp
+
+    def test_store(self):
+        cpp = _generate(AXPY + "\naxpy({}, 2, {}, 3)")
+        assert "_l2c_y_1[i - 1] = ((_l2c_a_1 * _l2c_x_1[i - 1]) + _l2c_y_1[i - 1]);" in cpp
+        assert "L2C_INDEPENDENT_ITERATIONS\nfor (int64_t i" in cpp
+
+    def test_scalar_checked_when_not_a_number(self):
+        lua = "local t = {}\nlocal function fill(a) for i = 1, 9 do t[i] = a end end\nfill(print)"
+        cpp = _generate(lua)
+        assert "if (_l2c_t_1 && l2c::holds_number(a)) {" in cpp
+        assert "const double _l2c_a_1 = l2c::unbox_number(a);" in cpp
+
+    def test_offsets(self):
+        cpp = _generate("local t, d = {}, {}\nfor i = 2, 9 do local g = t[i] - t[i - 1]; d[i] = g end")
+        assert "l2c::number_span(module_t, _l2c_start_1, _l2c_limit_1, -1, 0);" in cpp
+        assert "double g = (_l2c_t_1[i - 1] - _l2c_t_1[i - 2]);" in cpp
+        assert "L2C_INDEPENDENT_ITERATIONS" not in cpp
+
+    def test_math(self):
+        cpp = _generate("local t = {}\nfor i = 1, 9 do t[i] = math.sqrt(t[i]) end")
+        assert "_l2c_t_1[i - 1] = l2c::math_sqrt(_l2c_t_1[i - 1]);" in cpp
+
+    def test_disabled_for_table_runtime(self):
+        assert "l2c::number_span" not in _generate(DOT, runtime="table")
@@ -587,8 +587,8 @@ class TestInterproceduralPropagation:
         # After first iteration, no more changes should occur
         assert not changed1 or not changed2
 
-    def test_conflict_resolution_creates_any(self):
-        """Test conflicting types are merged into ANY type"""
+    def test_typed_argument_keeps_its_type(self):
+        """Test a parameter's type doesn't override an argument's own type"""
         from lua2cpp.core.types import TableTypeInfo
 
         scope_manager = ScopeManager()
@@ -604,12 +604,12 @@ class TestInterproceduralPropagation:
         function_registry.signatures["bar"].param_table_info[0] = param_info
         resolver.inferred_types["arg_y"] = Type(TypeKind.STRING)
 
-        # Run propagation - should create ANY type
+        # Run propagation - the parameter's type may come from another
+        # caller, so arg_y keeps its own STRING type
         changed = resolver._propagate_params_to_args()
 
-        assert changed is True
-        assert resolver.inferred_types["arg_y"].kind == TypeKind.ANY
-        assert len(resolver.inferred_types["arg_y"].subtypes) == 2
+        assert changed is False
+        assert resolver.inferred_types["arg_y"].kind == TypeKind.STRING
 
     def test_max_iteration_limit(self):
         """Test propagation stops after max iterations"""
@@ -665,6 +665,89 @@ class TestInterproceduralPropagation:
         assert changed2 is False
 
 
+class TestWorklistPropagation:
+    """Test the call graph worklist behind Pass 3"""
+
+    def _resolver(self):
+        scope_manager = ScopeManager()
+        symbol_table = SymbolTable(scope_manager)
+        return TypeResolver(scope_manager, symbol_table, MockFunctionSignatureRegistry())
+
+    def _call(self, resolver, caller, callee, args):
+        resolver.function_registry.signatures[callee].call_sites.append(
+            CallSiteInfo(caller_name=caller, arg_symbols=args))
+
+    def test_components_put_callers_first(self):
+        resolver = self._resolver()
+        for name in ("leaf", "even", "odd", "main"):
+            resolver.function_registry.register_function(name, ["x"])
+        self._call(resolver, "main", "even", ["n"])
+        self._call(resolver, "even", "odd", ["x"])
+        self._call(resolver, "odd", "even", ["x"])
+        self._call(resolver, "odd", "leaf", ["x"])
+
+        components = resolver._call_graph_components()
+
+        assert components == [["main"], ["even", "odd"], ["leaf"]]
+
+    def test_typed_argument_revisits_its_receivers(self):
+        resolver = self._resolver()
+        registry = resolver.function_registry
+        registry.register_function("typer", ["p"])
+        registry.register_function("user", ["q"])
+        self._call(resolver, "<chunk>", "typer", ["a"])
+        self._call(resolver, "<chunk>", "user", ["a"])
+        self._call(resolver, "<chunk>", "typer", ["n"])
+        resolver.inferred_types["n"] = Type(TypeKind.NUMBER)
+
+        resolver._propagate_types_interprocedurally()
+
+        # typer's parameter types a, which then reaches user's parameter
+        assert resolver.inferred_types["a"].kind == TypeKind.NUMBER
+        assert registry.get_param_table_info("user", 0).value_type.kind == TypeKind.NUMBER
+        assert resolver.propagation_stats["visits"] == 3
+
+    def test_conflicts_settle(self):
+        resolver = self._resolver()
+        registry = resolver.function_registry
+        registry.register_function("f", ["x"])
+        for symbol, kind in (("n", TypeKind.NUMBER), ("s", TypeKind.STRING), ("m", TypeKind.NUMBER)):
+            resolver.inferred_types[symbol] = Type(kind)
+            self._call(resolver, "f", "f", [symbol])
+
+        resolver._propagate_types_interprocedurally()
+
+        value_type = registry.get_param_table_info("f", 0).value_type
+        assert value_type.kind == TypeKind.ANY
+        assert [t.kind for t in value_type.subtypes] == [TypeKind.NUMBER, TypeKind.STRING]
+        assert resolver._merge_types(value_type, Type(TypeKind.STRING)) is value_type
+
+    def test_long_numeric_chain_stays_concrete(self):
+        # Each function passes its number parameter down a call chain; a
+        # string at the top unwinds the whole chain back to TValue
+        count = 300
+        lines = []
+        for i in reversed(range(count)):
+            call = f"f{i + 1}(a{i} + 1)" if i + 1 < count else f"a{i}"
+            lines.append(f"local function f{i}(a{i}) return {call} end")
+        resolver = self._resolver()
+        resolver.resolve_chunk(ast.parse("\n".join(lines) + "\nprint(f0(1))"))
+        assert resolver.function_registry.get_concrete_signature(f"f{count - 1}") == ["double"]
+
+        resolver = self._resolver()
+        resolver.resolve_chunk(ast.parse("\n".join(lines) + "\nprint(f0('1'))"))
+        assert resolver.function_registry.get_concrete_signature(f"f{count - 1}") == ["TValue"]
+
+    def test_pass_times_recorded(self):
+        resolver = self._resolver()
+        resolver.resolve_chunk(ast.parse("local function f(x) return x end\nprint(f(1))"))
+
+        names = [name for name, _ in resolver.pass_times]
+        assert names == ["signatures", "local types", "number arrays", "propagation", "validation"]
+        assert all(seconds >= 0 for _, seconds in resolver.pass_times)
+        assert resolver.propagation_stats["functions"] == 1
+
+
 class TestLocalTypeInference:
     """Test Pass 2: Local type inference within functions"""
 
@@ -938,3 +1021,41 @@ class TestLocalTypeInference:
         assert resolver.inferred_types['b'].kind == TypeKind.BOOLEAN
         assert resolver.inferred_types['result'].kind == TypeKind.BOOLEAN
 
+
+
+class TestNumberArrayInference:
+    """Test number-only table hints"""
+
+    @staticmethod
+    def _resolve(lua_code):
+        scope_manager = ScopeManager()
+        symbol_table = SymbolTable(scope_manager)
+        resolver = TypeResolver(scope_manager, symbol_table, MockFunctionSignatureRegistry())
+        tree = ast.parse(lua_code)
+        resolver._infer_number_arrays(tree)
+        return tree
+
+    @staticmethod
+    def _is_number_array(local_assign):
+        return bool(ASTAnnotationStore.get_annotation(local_assign.values[0], 'number_array'))
+
+    def test_numeric_stores_mark_constructor(self):
+        tree = self._resolve("local v = {}\nfor i = 1, 10 do v[i] = math.sqrt(i) end")
+        assert self._is_number_array(tree.body.body[0])
+
+    def test_accumulator_through_other_array(self):
+        tree = self._resolve(
+            "local u = {1, 2}\nlocal v = {}\nlocal sum = 0\n"
+            "for i = 1, 2 do sum = sum + u[i] * 2 v[i] = sum end"
+        )
+        assert self._is_number_array(tree.body.body[0])
+        assert self._is_number_array(tree.body.body[1])
+
+    def test_unknown_value_blocks_hint(self):
+        tree = self._resolve("local function f(x) local v = {} v[1] = x return v end")
+        local_assign = tree.body.body[0].body.body[0]
+        assert not self._is_number_array(local_assign)
+
+    def test_table_values_block_hint(self):
+        tree = self._resolve("local m = {}\nfor i = 1, 3 do m[i] = {} end")
+        assert not self._is_number_array(tree.body.body[0])